@@ -96,6 +96,51 @@ static void putstr(const char *ptr)
 	flush();
 }
 
+#if __LINUX_ARM_ARCH__ >= 7
+/*
+ * Time the decompression with the PMU cycle counter, if the CPU has
+ * one (ID_DFR0.PerfMon), and leave the PMU disabled again afterwards.
+ */
+static int cycles_ok;
+
+static void cycles_start(void)
+{
+	unsigned int dfr0;
+
+	asm volatile("mrc p15, 0, %0, c0, c1, 2" : "=r" (dfr0));
+	dfr0 = (dfr0 >> 24) & 0xf;
+	cycles_ok = dfr0 != 0 && dfr0 != 0xf;
+	if (!cycles_ok)
+		return;
+
+	/* PMCR.E | PMCR.C, then enable PMCCNTR */
+	asm volatile("mcr p15, 0, %0, c9, c12, 0" : : "r" (5));
+	asm volatile("mcr p15, 0, %0, c9, c12, 1" : : "r" (1 << 31));
+}
+
+static void cycles_stop(void)
+{
+	static const char hex[] = "0123456789abcdef";
+	char buf[] = " (0x00000000 cycles)";
+	unsigned int cycles;
+	int i;
+
+	if (!cycles_ok)
+		return;
+
+	asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (cycles));
+	asm volatile("mcr p15, 0, %0, c9, c12, 2" : : "r" (1 << 31));
+	asm volatile("mcr p15, 0, %0, c9, c12, 0" : : "r" (0));
+
+	for (i = 11; i >= 4; i--, cycles >>= 4)
+		buf[i] = hex[cycles & 0xf];
+	putstr(buf);
+}
+#else
+static inline void cycles_start(void) {}
+static inline void cycles_stop(void) {}
+#endif
+
 /*
  * gzip declarations
  */
@@ -159,10 +204,12 @@ decompress_kernel(unsigned long output_start, unsigned long free_mem_ptr_p,
 	arch_decomp_setup();
 
 	putstr("Uncompressing Linux...");
+	cycles_start();
 	ret = do_decompress(input_data, input_data_end - input_data,
 			    output_data, error);
 	if (ret)
 		error("decompressor returned an error");
-	else
-		putstr(" done, booting the kernel.\n");
+	putstr(" done");
+	cycles_stop();
+	putstr(", booting the kernel.\n");
 }
@@ -25,6 +25,13 @@
  */
 __wsum csum_partial(const void *buff, int len, __wsum sum);
 
+#ifdef CONFIG_NEON_CSUM
+/* the integer implementation behind the NEON csum_partial() */
+__wsum __csum_partial_arm(const void *buff, int len, __wsum sum);
+#else
+#define __csum_partial_arm(buff, len, sum)	csum_partial(buff, len, sum)
+#endif
+
 /*
  * the same as csum_partial, but copies from src while it
  * checksums, and handles user-space pointer exceptions correctly, when needed.
@@ -78,6 +78,16 @@
 #define PTE_HWTABLE_OFF		(PTE_HWTABLE_PTRS * sizeof(pte_t))
 #define PTE_HWTABLE_SIZE	(PTRS_PER_PTE * sizeof(u32))
 
+/*
+ * A 64K large page occupies LARGE_PTE_NR consecutive hardware entries,
+ * all holding the same descriptor.  The Linux PTEs are left untouched,
+ * so the generic code keeps seeing 4K pages.
+ */
+#define LARGE_PTE_ORDER		4
+#define LARGE_PTE_NR		(1 << LARGE_PTE_ORDER)
+#define LARGE_PTE_SIZE		(PAGE_SIZE << LARGE_PTE_ORDER)
+#define LARGE_PTE_MASK		(~(LARGE_PTE_SIZE-1))
+
 /*
  * PMD_SHIFT determines the size of the area a second-level page table can map
  * PGDIR_SHIFT determines what a third-level page table entry can map
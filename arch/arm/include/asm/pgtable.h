@@ -212,7 +212,33 @@ static inline pte_t *pmd_page_vaddr(pmd_t pmd)
 #define pte_page(pte)		pfn_to_page(pte_pfn(pte))
 #define mk_pte(page,prot)	pfn_pte(page_to_pfn(page), prot)
 
-#define pte_clear(mm,addr,ptep)	set_pte_ext(ptep, __pte(0), 0)
+#ifdef CONFIG_ARM_LARGE_PAGES
+extern void __pte_large_split(struct mm_struct *mm, unsigned long addr,
+			      pte_t *ptep);
+
+/*
+ * A 64K large page is built from LARGE_PTE_NR identical hardware
+ * entries.  Any change to one of the Linux PTEs it covers has to turn
+ * the whole block back into small pages first.
+ */
+static inline void pte_large_split(struct mm_struct *mm, unsigned long addr,
+				   pte_t *ptep)
+{
+	pteval_t hw = pte_val(ptep[PTE_HWTABLE_PTRS]);
+
+	if (unlikely((hw & PTE_TYPE_MASK) == PTE_TYPE_LARGE))
+		__pte_large_split(mm, addr, ptep);
+}
+#else
+static inline void pte_large_split(struct mm_struct *mm, unsigned long addr,
+				   pte_t *ptep) { }
+#endif
+
+#define pte_clear(mm,addr,ptep)					\
+	do {							\
+		pte_large_split(mm, addr, ptep);		\
+		set_pte_ext(ptep, __pte(0), 0);			\
+	} while (0)
 
 #define pte_isset(pte, val)	((u32)(val) == (val) ? pte_val(pte) & (val) \
 						: !!(pte_val(pte) & (val)))
@@ -249,6 +275,7 @@ static inline void set_pte_at(struct mm_struct *mm, unsigned long addr,
 		ext |= PTE_EXT_NG;
 	}
 
+	pte_large_split(mm, addr, ptep);
 	set_pte_ext(ptep, pteval, ext);
 }
 
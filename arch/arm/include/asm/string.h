@@ -15,6 +15,12 @@ extern char * strchr(const char * s, int c);
 #define __HAVE_ARCH_MEMCPY
 extern void * memcpy(void *, const void *, __kernel_size_t);
 
+#ifdef CONFIG_NEON_COPY_PAGE
+extern void *memcpy_neon(void *, const void *, __kernel_size_t);
+#else
+#define memcpy_neon(to, from, n)	memcpy(to, from, n)
+#endif
+
 #define __HAVE_ARCH_MEMMOVE
 extern void * memmove(void *, const void *, __kernel_size_t);
 
@@ -630,6 +630,15 @@ extern void flush_bp_all(void);
 #if __LINUX_ARM_ARCH__ < 6
 extern void update_mmu_cache(struct vm_area_struct *vma, unsigned long addr,
 	pte_t *ptep);
+#elif defined(CONFIG_ARM_LARGE_PAGES)
+extern void update_mmu_cache_large(struct vm_area_struct *vma,
+				   unsigned long addr, pte_t *ptep);
+
+static inline void update_mmu_cache(struct vm_area_struct *vma,
+				    unsigned long addr, pte_t *ptep)
+{
+	update_mmu_cache_large(vma, addr, ptep);
+}
 #else
 static inline void update_mmu_cache(struct vm_area_struct *vma,
 				    unsigned long addr, pte_t *ptep)
@@ -5,12 +5,16 @@
 
 #ifndef __ASSEMBLY__
 
+#include <linux/types.h>
+
 struct mm_struct;
 
 #ifdef CONFIG_VDSO
 
 void arm_install_vdso(struct mm_struct *mm, unsigned long addr);
 
+void arm_vdso_set_mmio_clocksource(const char *name, phys_addr_t counter);
+
 extern char vdso_start, vdso_end;
 
 extern unsigned int vdso_total_pages;
@@ -23,6 +27,11 @@ static inline void arm_install_vdso(struct mm_struct *mm, unsigned long addr)
 
 #define vdso_total_pages 0
 
+static inline void arm_vdso_set_mmio_clocksource(const char *name,
+						 phys_addr_t counter)
+{
+}
+
 #endif /* CONFIG_VDSO */
 
 #endif /* __ASSEMBLY__ */
@@ -24,13 +24,18 @@
 
 #include <asm/page.h>
 
+/* where the vDSO reads the clocksource from, if at all */
+#define VDSO_CLOCK_NONE		0
+#define VDSO_CLOCK_CNTVCT	1	/* ARM architected timer */
+#define VDSO_CLOCK_MMIO		2	/* 32-bit counter in the mmio page */
+
 /* Try to be cache-friendly on systems that don't implement the
  * generic timer: fit the unconditionally updated fields in the first
  * 32 bytes.
  */
 struct vdso_data {
 	u32 seq_count;		/* sequence count - odd during updates */
-	u16 tk_is_cntvct;	/* fall back to syscall if false */
+	u16 clock_mode;		/* fall back to syscall if VDSO_CLOCK_NONE */
 	u16 cs_shift;		/* clocksource shift */
 	u32 xtime_coarse_sec;	/* coarse time */
 	u32 xtime_coarse_nsec;
@@ -46,6 +51,12 @@ struct vdso_data {
 	u64 xtime_clock_snsec;	/* CLOCK_REALTIME sub-ns base */
 	u32 tz_minuteswest;	/* timezone info for gettimeofday(2) */
 	u32 tz_dsttime;
+
+	u32 mmio_offset;	/* counter offset in the page before us */
+	u32 cs_raw_mult;	/* CLOCK_MONOTONIC_RAW multiplier */
+	u32 raw_time_sec;	/* CLOCK_MONOTONIC_RAW base */
+	u32 raw_time_nsec;
+	u64 raw_clock_snsec;	/* CLOCK_MONOTONIC_RAW sub-ns base */
 };
 
 union vdso_data_store {
@@ -55,6 +55,9 @@ EXPORT_SYMBOL(arm_delay_ops);
 
 	/* networking */
 EXPORT_SYMBOL(csum_partial);
+#ifdef CONFIG_NEON_CSUM
+EXPORT_SYMBOL(__csum_partial_arm);
+#endif
 EXPORT_SYMBOL(csum_partial_copy_from_user);
 EXPORT_SYMBOL(csum_partial_copy_nocheck);
 EXPORT_SYMBOL(__csum_ipv6_magic);
@@ -10,6 +10,7 @@
 #include <linux/irq.h>
 #include <linux/memblock.h>
 #include <asm/pgtable.h>
+#include <linux/of_address.h>
 #include <linux/of_fdt.h>
 #include <asm/pgalloc.h>
 #include <asm/mmu_context.h>
@@ -35,6 +36,42 @@ static unsigned long dt_mem;
  * This prevents breakage of crash_notes attribute in kernel/ksysfs.c.
  */
 
+/*
+ * Regions under /reserved-memory with a fixed "reg" (ramoops, data kept
+ * for the next kernel across an upgrade) are left alone by kexec itself,
+ * but are still System RAM unless marked no-map.  Make sure none of the
+ * new image is loaded on top of them.
+ */
+static bool kexec_overlaps_reserved_mem(phys_addr_t start, size_t size)
+{
+	struct device_node *parent, *np;
+	struct resource res;
+	bool hit = false;
+	int i;
+
+	parent = of_find_node_by_path("/reserved-memory");
+	if (!parent)
+		return false;
+
+	for_each_available_child_of_node(parent, np) {
+		for (i = 0; !of_address_to_resource(np, i, &res); i++) {
+			if (start <= res.end && start + size > res.start) {
+				pr_err("kexec: segment %pa overlaps %s\n",
+				       &start, np->full_name);
+				hit = true;
+				break;
+			}
+		}
+		if (hit) {
+			of_node_put(np);
+			break;
+		}
+	}
+
+	of_node_put(parent);
+	return hit;
+}
+
 int machine_kexec_prepare(struct kimage *image)
 {
 	struct kexec_segment *current_segment;
@@ -61,6 +98,10 @@ int machine_kexec_prepare(struct kimage *image)
 					       current_segment->memsz))
 			return -EINVAL;
 
+		if (kexec_overlaps_reserved_mem(current_segment->mem,
+						current_segment->memsz))
+			return -EBUSY;
+
 		err = get_user(header, (__be32*)current_segment->buf);
 		if (err)
 			return err;
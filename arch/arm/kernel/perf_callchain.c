@@ -58,10 +58,73 @@ user_backtrace(struct frame_tail __user *tail,
 	return buftail.fp - 1;
 }
 
+/*
+ * Code built without -mapcs-frame, which is what current compilers
+ * generate for -fno-omit-frame-pointer, only saves an {fp, lr} pair per
+ * frame.  In ARM state GCC leaves fp pointing at the saved lr, i.e. one
+ * word into the record, and the saved fp has the same bias.
+ *
+ * Thumb code is not walked: where r7 points within a Thumb frame, and
+ * whether the frame holds an {r7, lr} pair at all, is up to the
+ * compiler and its version, so the walk would record garbage.
+ */
+struct frame_record {
+	unsigned long fp;
+	unsigned long lr;
+};
+
+static unsigned long
+user_backtrace_record(unsigned long fp, struct perf_callchain_entry *entry)
+{
+	struct frame_record __user *rec;
+	struct frame_record bufrec;
+	unsigned long err;
+
+	rec = (struct frame_record __user *)(fp - 4);
+	if (!access_ok(VERIFY_READ, rec, sizeof(bufrec)))
+		return 0;
+
+	pagefault_disable();
+	err = __copy_from_user_inatomic(&bufrec, rec, sizeof(bufrec));
+	pagefault_enable();
+
+	if (err)
+		return 0;
+
+	perf_callchain_store(entry, bufrec.lr);
+
+	if (bufrec.fp <= fp)
+		return 0;
+
+	return bufrec.fp;
+}
+
+/*
+ * An APCS frame saves {fp, ip, lr, pc} with ip holding the sp on entry,
+ * which sits right above the saved pc: check for that before trusting
+ * the layout.
+ */
+static bool user_frame_is_apcs(struct frame_tail __user *tail)
+{
+	unsigned long sp;
+	int err;
+
+	if (((unsigned long)tail & 0x3) ||
+	    !access_ok(VERIFY_READ, tail, sizeof(*tail)))
+		return false;
+
+	pagefault_disable();
+	err = __get_user(sp, &tail->sp);
+	pagefault_enable();
+
+	return !err && sp == (unsigned long)tail + 16;
+}
+
 void
 perf_callchain_user(struct perf_callchain_entry *entry, struct pt_regs *regs)
 {
 	struct frame_tail __user *tail;
+	unsigned long fp;
 
 	if (perf_guest_cbs && perf_guest_cbs->is_in_guest()) {
 		/* We don't support guest os callchain now */
@@ -70,14 +133,21 @@ perf_callchain_user(struct perf_callchain_entry *entry, struct pt_regs *regs)
 
 	perf_callchain_store(entry, regs->ARM_pc);
 
-	if (!current->mm)
+	if (!current->mm || thumb_mode(regs))
 		return;
 
 	tail = (struct frame_tail __user *)regs->ARM_fp - 1;
+	if (user_frame_is_apcs(tail)) {
+		while ((entry->nr < PERF_MAX_STACK_DEPTH) &&
+		       tail && !((unsigned long)tail & 0x3))
+			tail = user_backtrace(tail, entry);
+		return;
+	}
 
+	fp = regs->ARM_fp;
 	while ((entry->nr < PERF_MAX_STACK_DEPTH) &&
-	       tail && !((unsigned long)tail & 0x3))
-		tail = user_backtrace(tail, entry);
+	       fp > 4 && !(fp & 0x3))
+		fp = user_backtrace_record(fp, entry);
 }
 
 /*
@@ -20,7 +20,9 @@
 
 #include <linux/bitmap.h>
 #include <linux/export.h>
+#include <linux/hrtimer.h>
 #include <linux/kernel.h>
+#include <linux/moduleparam.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
@@ -78,12 +80,62 @@ static void cpu_pmu_disable_percpu_irq(void *data)
 	disable_percpu_irq(irq);
 }
 
+/*
+ * Without a usable PMU interrupt the overflow flags are polled from a
+ * per-cpu hrtimer every pmu_poll_us.  Samples then carry the PC at poll
+ * time instead of at overflow, which still gives usable statistical
+ * profiles.  pmu_poll_force=1 polls even when an interrupt is described,
+ * for boards where it isn't actually wired.
+ */
+static unsigned int pmu_poll_us = 1000;
+core_param(pmu_poll_us, pmu_poll_us, uint, 0444);
+static bool pmu_poll_force;
+core_param(pmu_poll_force, pmu_poll_force, bool, 0444);
+
+static DEFINE_PER_CPU(struct hrtimer, cpu_pmu_poll_timer);
+static irq_handler_t cpu_pmu_poll_handler;
+static bool cpu_pmu_polling;
+
+static enum hrtimer_restart cpu_pmu_poll(struct hrtimer *timer)
+{
+	struct pmu_hw_events __percpu *hw_events = cpu_pmu->hw_events;
+
+	/* Timers of an offlined CPU migrate, let them expire there */
+	if (timer != this_cpu_ptr(&cpu_pmu_poll_timer))
+		return HRTIMER_NORESTART;
+
+	cpu_pmu_poll_handler(0, this_cpu_ptr(&hw_events->percpu_pmu));
+	hrtimer_forward_now(timer, ns_to_ktime(pmu_poll_us * NSEC_PER_USEC));
+	return HRTIMER_RESTART;
+}
+
+static void cpu_pmu_poll_start(void *unused)
+{
+	hrtimer_start(this_cpu_ptr(&cpu_pmu_poll_timer),
+		      ns_to_ktime(pmu_poll_us * NSEC_PER_USEC),
+		      HRTIMER_MODE_REL_PINNED);
+}
+
+static void cpu_pmu_poll_stop(void)
+{
+	int cpu;
+
+	cpu_pmu_polling = false;
+	for_each_possible_cpu(cpu)
+		hrtimer_cancel(&per_cpu(cpu_pmu_poll_timer, cpu));
+}
+
 static void cpu_pmu_free_irq(struct arm_pmu *cpu_pmu)
 {
 	int i, irq, irqs;
 	struct platform_device *pmu_device = cpu_pmu->plat_device;
 	struct pmu_hw_events __percpu *hw_events = cpu_pmu->hw_events;
 
+	if (cpu_pmu_polling) {
+		cpu_pmu_poll_stop();
+		return;
+	}
+
 	irqs = min(pmu_device->num_resources, num_possible_cpus());
 
 	irq = platform_get_irq(pmu_device, 0);
@@ -116,8 +168,16 @@ static int cpu_pmu_request_irq(struct arm_pmu *cpu_pmu, irq_handler_t handler)
 		return -ENODEV;
 
 	irqs = min(pmu_device->num_resources, num_possible_cpus());
-	if (irqs < 1) {
-		pr_warn_once("perf/ARM: No irqs for PMU defined, sampling events not supported\n");
+	if (irqs < 1 || pmu_poll_force) {
+		if (!pmu_poll_us) {
+			pr_warn_once("perf/ARM: No irqs for PMU defined, sampling events not supported\n");
+			return 0;
+		}
+		pr_info_once("polling counter overflow every %u us\n",
+			     pmu_poll_us);
+		cpu_pmu_poll_handler = handler;
+		cpu_pmu_polling = true;
+		on_each_cpu(cpu_pmu_poll_start, NULL, 1);
 		return 0;
 	}
 
@@ -184,6 +244,9 @@ static int cpu_pmu_notify(struct notifier_block *b, unsigned long action,
 	if ((action & ~CPU_TASKS_FROZEN) != CPU_STARTING)
 		return NOTIFY_DONE;
 
+	if (cpu_pmu_polling)
+		cpu_pmu_poll_start(NULL);
+
 	if (pmu->reset)
 		pmu->reset(pmu);
 	else
@@ -211,6 +274,9 @@ static int cpu_pmu_init(struct arm_pmu *cpu_pmu)
 		struct pmu_hw_events *events = per_cpu_ptr(cpu_hw_events, cpu);
 		raw_spin_lock_init(&events->pmu_lock);
 		events->percpu_pmu = cpu_pmu;
+		hrtimer_init(&per_cpu(cpu_pmu_poll_timer, cpu),
+			     CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		per_cpu(cpu_pmu_poll_timer, cpu).function = cpu_pmu_poll;
 	}
 
 	cpu_pmu->hw_events	= cpu_hw_events;
@@ -221,8 +287,11 @@ static int cpu_pmu_init(struct arm_pmu *cpu_pmu)
 	if (cpu_pmu->reset)
 		on_each_cpu(cpu_pmu->reset, cpu_pmu, 1);
 
-	/* If no interrupts available, set the corresponding capability flag */
-	if (!platform_get_irq(cpu_pmu->plat_device, 0))
+	/*
+	 * If no interrupts available, set the corresponding capability flag,
+	 * unless overflow polling stands in for them.
+	 */
+	if (!platform_get_irq(cpu_pmu->plat_device, 0) && !pmu_poll_us)
 		cpu_pmu->pmu.capabilities |= PERF_PMU_CAP_NO_INTERRUPT;
 
 	return 0;
@@ -95,6 +95,14 @@ enum armv7_a5_perf_types {
 	ARMV7_A5_PERFCTR_PREFETCH_LINEFILL_DROP		= 0xc3,
 };
 
+/* ARMv7 Cortex-A7 specific event types */
+enum armv7_a7_perf_types {
+	ARMV7_A7_PERFCTR_BUS_READ_ACCESS		= 0x60,
+	ARMV7_A7_PERFCTR_BUS_WRITE_ACCESS		= 0x61,
+	ARMV7_A7_PERFCTR_PREFETCH_LINEFILL		= 0xc2,
+	ARMV7_A7_PERFCTR_PREFETCH_LINEFILL_DROP		= 0xc3,
+};
+
 /* ARMv7 Cortex-A15 specific event types */
 enum armv7_a15_perf_types {
 	ARMV7_A15_PERFCTR_L1_DCACHE_ACCESS_READ		= 0x40,
@@ -377,6 +385,8 @@ static const unsigned armv7_a7_perf_cache_map[PERF_COUNT_HW_CACHE_MAX]
 	[C(L1D)][C(OP_READ)][C(RESULT_MISS)]	= ARMV7_PERFCTR_L1_DCACHE_REFILL,
 	[C(L1D)][C(OP_WRITE)][C(RESULT_ACCESS)]	= ARMV7_PERFCTR_L1_DCACHE_ACCESS,
 	[C(L1D)][C(OP_WRITE)][C(RESULT_MISS)]	= ARMV7_PERFCTR_L1_DCACHE_REFILL,
+	[C(L1D)][C(OP_PREFETCH)][C(RESULT_ACCESS)]	= ARMV7_A7_PERFCTR_PREFETCH_LINEFILL,
+	[C(L1D)][C(OP_PREFETCH)][C(RESULT_MISS)]	= ARMV7_A7_PERFCTR_PREFETCH_LINEFILL_DROP,
 
 	[C(L1I)][C(OP_READ)][C(RESULT_ACCESS)]	= ARMV7_PERFCTR_L1_ICACHE_ACCESS,
 	[C(L1I)][C(OP_READ)][C(RESULT_MISS)]	= ARMV7_PERFCTR_L1_ICACHE_REFILL,
@@ -396,6 +406,10 @@ static const unsigned armv7_a7_perf_cache_map[PERF_COUNT_HW_CACHE_MAX]
 	[C(BPU)][C(OP_READ)][C(RESULT_MISS)]	= ARMV7_PERFCTR_PC_BRANCH_MIS_PRED,
 	[C(BPU)][C(OP_WRITE)][C(RESULT_ACCESS)]	= ARMV7_PERFCTR_PC_BRANCH_PRED,
 	[C(BPU)][C(OP_WRITE)][C(RESULT_MISS)]	= ARMV7_PERFCTR_PC_BRANCH_MIS_PRED,
+
+	/* Everything that leaves the core goes to memory, there is no L3 */
+	[C(NODE)][C(OP_READ)][C(RESULT_ACCESS)]	= ARMV7_A7_PERFCTR_BUS_READ_ACCESS,
+	[C(NODE)][C(OP_WRITE)][C(RESULT_ACCESS)]	= ARMV7_A7_PERFCTR_BUS_WRITE_ACCESS,
 };
 
 /*
@@ -57,6 +57,30 @@ static struct vm_special_mapping vdso_text_mapping = {
 	.name = "[vdso]",
 };
 
+static unsigned int vdso_text_pages __read_mostly;
+
+/*
+ * A memory mapped, 32-bit up counter the vDSO reads when the named
+ * clocksource drives timekeeping.  Its page is mapped read-only and
+ * uncached right before the data page; having no struct page, it is
+ * populated with io_remap_pfn_range() and never faults.
+ */
+static const char *vdso_mmio_name __read_mostly;
+static phys_addr_t vdso_mmio_phys __read_mostly;
+
+static struct page *vdso_mmio_page;
+static struct vm_special_mapping vdso_mmio_mapping = {
+	.name = "[vvar_mmio]",
+	.pages = &vdso_mmio_page,
+};
+
+void __init arm_vdso_set_mmio_clocksource(const char *name,
+					  phys_addr_t counter)
+{
+	vdso_mmio_name = name;
+	vdso_mmio_phys = counter;
+}
+
 struct elfinfo {
 	Elf32_Ehdr	*hdr;		/* ptr to ELF */
 	Elf32_Sym	*dynsym;	/* ptr to .dynsym section */
@@ -69,6 +93,9 @@ struct elfinfo {
  */
 static bool cntvct_ok __read_mostly;
 
+/* Either of the above, so the high precision entry points are kept */
+static bool vdso_clock_ok __read_mostly;
+
 static bool __init cntvct_functional(void)
 {
 	struct device_node *np;
@@ -163,11 +190,12 @@ static void __init patch_vdso(void *ehdr)
 	einfo.dynsym = find_section(einfo.hdr, ".dynsym", &einfo.dynsymsize);
 	einfo.dynstr = find_section(einfo.hdr, ".dynstr", NULL);
 
-	/* If the virtual counter is absent or non-functional we don't
-	 * want programs to incur the slight additional overhead of
-	 * dispatching through the VDSO only to fall back to syscalls.
+	/* If neither the virtual counter nor a memory mapped counter
+	 * is usable we don't want programs to incur the slight
+	 * additional overhead of dispatching through the VDSO only to
+	 * fall back to syscalls.
 	 */
-	if (!cntvct_ok) {
+	if (!vdso_clock_ok) {
 		vdso_nullpatch_one(&einfo, "__vdso_gettimeofday");
 		vdso_nullpatch_one(&einfo, "__vdso_clock_gettime");
 	}
@@ -205,11 +233,19 @@ static int __init vdso_init(void)
 
 	vdso_text_mapping.pages = vdso_text_pagelist;
 
+	vdso_text_pages = text_pages;
 	vdso_total_pages = 1; /* for the data/vvar page */
 	vdso_total_pages += text_pages;
 
 	cntvct_ok = cntvct_functional();
 
+	if (vdso_mmio_name) {
+		vdso_total_pages++;
+		vdso_data->mmio_offset = vdso_mmio_phys & ~PAGE_MASK;
+		pr_info("vdso: using %s counter\n", vdso_mmio_name);
+	}
+	vdso_clock_ok = cntvct_ok || vdso_mmio_name;
+
 	patch_vdso(&vdso_start);
 
 	return 0;
@@ -227,6 +263,20 @@ static int install_vvar(struct mm_struct *mm, unsigned long addr)
 	return IS_ERR(vma) ? PTR_ERR(vma) : 0;
 }
 
+static int install_vvar_mmio(struct mm_struct *mm, unsigned long addr)
+{
+	struct vm_area_struct *vma;
+
+	vma = _install_special_mapping(mm, addr, PAGE_SIZE,
+				       VM_READ | VM_MAYREAD,
+				       &vdso_mmio_mapping);
+	if (IS_ERR(vma))
+		return PTR_ERR(vma);
+
+	return io_remap_pfn_range(vma, addr, vdso_mmio_phys >> PAGE_SHIFT,
+				  PAGE_SIZE, pgprot_noncached(PAGE_READONLY));
+}
+
 /* assumes mmap_sem is write-locked */
 void arm_install_vdso(struct mm_struct *mm, unsigned long addr)
 {
@@ -238,12 +288,18 @@ void arm_install_vdso(struct mm_struct *mm, unsigned long addr)
 	if (vdso_text_pagelist == NULL)
 		return;
 
+	if (vdso_mmio_name) {
+		if (install_vvar_mmio(mm, addr))
+			return;
+		addr += PAGE_SIZE;
+	}
+
 	if (install_vvar(mm, addr))
 		return;
 
 	/* Account for vvar page. */
 	addr += PAGE_SIZE;
-	len = (vdso_total_pages - 1) << PAGE_SHIFT;
+	len = vdso_text_pages << PAGE_SHIFT;
 
 	vma = _install_special_mapping(mm, addr, len,
 		VM_READ | VM_EXEC | VM_MAYREAD | VM_MAYWRITE | VM_MAYEXEC,
@@ -267,7 +323,7 @@ static void vdso_write_end(struct vdso_data *vdata)
 
 static bool tk_is_cntvct(const struct timekeeper *tk)
 {
-	if (!IS_ENABLED(CONFIG_ARM_ARCH_TIMER))
+	if (!IS_ENABLED(CONFIG_ARM_ARCH_TIMER) || !cntvct_ok)
 		return false;
 
 	if (strcmp(tk->tkr_mono.clock->name, "arch_sys_counter") != 0)
@@ -276,13 +332,26 @@ static bool tk_is_cntvct(const struct timekeeper *tk)
 	return true;
 }
 
+static u16 tk_clock_mode(const struct timekeeper *tk)
+{
+	if (tk_is_cntvct(tk))
+		return VDSO_CLOCK_CNTVCT;
+
+	if (vdso_mmio_name &&
+	    strcmp(tk->tkr_mono.clock->name, vdso_mmio_name) == 0)
+		return VDSO_CLOCK_MMIO;
+
+	return VDSO_CLOCK_NONE;
+}
+
 /**
  * update_vsyscall - update the vdso data page
  *
  * Increment the sequence counter, making it odd, indicating to
  * userspace that an update is in progress.  Update the fields used
- * for coarse clocks and, if the architected system timer is in use,
- * the fields used for high precision clocks.  Increment the sequence
+ * for coarse clocks and, if the architected system timer or the
+ * memory mapped counter is in use, the fields used for high precision
+ * clocks.  Increment the sequence
  * counter again, making it even, indicating to userspace that the
  * update is finished.
  *
@@ -299,7 +368,7 @@ void update_vsyscall(struct timekeeper *tk)
 	struct timespec xtime_coarse;
 	struct timespec64 *wtm = &tk->wall_to_monotonic;
 
-	if (!cntvct_ok) {
+	if (!vdso_clock_ok) {
 		/* The entry points have been zeroed, so there is no
 		 * point in updating the data page.
 		 */
@@ -309,19 +378,23 @@ void update_vsyscall(struct timekeeper *tk)
 	vdso_write_begin(vdso_data);
 
 	xtime_coarse = __current_kernel_time();
-	vdso_data->tk_is_cntvct			= tk_is_cntvct(tk);
+	vdso_data->clock_mode			= tk_clock_mode(tk);
 	vdso_data->xtime_coarse_sec		= xtime_coarse.tv_sec;
 	vdso_data->xtime_coarse_nsec		= xtime_coarse.tv_nsec;
 	vdso_data->wtm_clock_sec		= wtm->tv_sec;
 	vdso_data->wtm_clock_nsec		= wtm->tv_nsec;
 
-	if (vdso_data->tk_is_cntvct) {
+	if (vdso_data->clock_mode != VDSO_CLOCK_NONE) {
 		vdso_data->cs_cycle_last	= tk->tkr_mono.cycle_last;
 		vdso_data->xtime_clock_sec	= tk->xtime_sec;
 		vdso_data->xtime_clock_snsec	= tk->tkr_mono.xtime_nsec;
 		vdso_data->cs_mult		= tk->tkr_mono.mult;
 		vdso_data->cs_shift		= tk->tkr_mono.shift;
 		vdso_data->cs_mask		= tk->tkr_mono.mask;
+		vdso_data->cs_raw_mult		= tk->tkr_raw.mult;
+		vdso_data->raw_time_sec		= tk->raw_time.tv_sec;
+		vdso_data->raw_time_nsec	= tk->raw_time.tv_nsec;
+		vdso_data->raw_clock_snsec	= tk->tkr_raw.xtime_nsec;
 	}
 
 	vdso_write_end(vdso_data);
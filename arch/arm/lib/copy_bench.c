@@ -0,0 +1,200 @@
+/*
+ *  linux/arch/arm/lib/copy_bench.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Memory copy bandwidth benchmark.  Loading the module times memcpy(),
+ * memcpy_neon() and, if a DMA_MEMCPY capable channel exists (SDMA on
+ * i.MX), a DMA engine copy for a range of sizes and logs MB/s for each.
+ * The DMA figures include mapping and completion overhead, which is
+ * what a driver offloading a copy would pay.  csum_partial() is timed
+ * against the integer routine behind it the same way.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/completion.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+#include <net/checksum.h>
+
+#define COPY_BENCH_MAX		SZ_1M
+
+static unsigned int iterations = 64;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "copies per size (default 64)");
+
+static bool use_dma = true;
+module_param(use_dma, bool, 0444);
+MODULE_PARM_DESC(use_dma, "also time a DMA engine memcpy channel");
+
+static void copy_bench_dma_callback(void *arg)
+{
+	complete(arg);
+}
+
+static int copy_bench_dma(struct dma_chan *chan, void *dst, void *src,
+			  size_t len)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct device *dev = chan->device->dev;
+	struct dma_async_tx_descriptor *tx;
+	dma_addr_t dma_src, dma_dst;
+	dma_cookie_t cookie;
+	int ret = -ENOMEM;
+
+	dma_src = dma_map_single(dev, src, len, DMA_TO_DEVICE);
+	if (dma_mapping_error(dev, dma_src))
+		return ret;
+	dma_dst = dma_map_single(dev, dst, len, DMA_FROM_DEVICE);
+	if (dma_mapping_error(dev, dma_dst))
+		goto err_unmap_src;
+
+	tx = chan->device->device_prep_dma_memcpy(chan, dma_dst, dma_src, len,
+						   DMA_PREP_INTERRUPT |
+						   DMA_CTRL_ACK);
+	if (!tx)
+		goto err_unmap_dst;
+
+	tx->callback = copy_bench_dma_callback;
+	tx->callback_param = &done;
+	cookie = dmaengine_submit(tx);
+	ret = dma_submit_error(cookie);
+	if (ret)
+		goto err_unmap_dst;
+	dma_async_issue_pending(chan);
+
+	if (!wait_for_completion_timeout(&done, msecs_to_jiffies(1000))) {
+		dmaengine_terminate_all(chan);
+		ret = -ETIMEDOUT;
+	}
+
+err_unmap_dst:
+	dma_unmap_single(dev, dma_dst, len, DMA_FROM_DEVICE);
+err_unmap_src:
+	dma_unmap_single(dev, dma_src, len, DMA_TO_DEVICE);
+	return ret;
+}
+
+/* bytes per microsecond is MB/s */
+static unsigned long copy_bench_rate(size_t len, u64 ns)
+{
+	return div64_u64((u64)len * iterations * NSEC_PER_USEC, ns ? ns : 1);
+}
+
+static int __init copy_bench_init(void)
+{
+	struct dma_chan *chan = NULL;
+	unsigned int order = get_order(COPY_BENCH_MAX);
+	unsigned long cpu, neon, dma;
+	__wsum csum_arm, csum_neon;
+	void *src, *dst;
+	size_t len;
+	unsigned int i;
+	ktime_t start;
+	int ret = -ENOMEM;
+
+	if (!iterations)
+		return -EINVAL;
+
+	src = (void *)__get_free_pages(GFP_KERNEL, order);
+	dst = (void *)__get_free_pages(GFP_KERNEL, order);
+	if (!src || !dst)
+		goto out;
+	prandom_bytes(src, COPY_BENCH_MAX);
+	memset(dst, 0, COPY_BENCH_MAX);
+
+	if (use_dma) {
+		dma_cap_mask_t mask;
+
+		dma_cap_zero(mask);
+		dma_cap_set(DMA_MEMCPY, mask);
+		chan = dma_request_channel(mask, NULL, NULL);
+		if (!chan)
+			pr_info("no DMA memcpy channel\n");
+	}
+
+	pr_info("%u iterations, %s\n", iterations,
+		chan ? dma_chan_name(chan) : "no DMA");
+	pr_info("%8s %10s %10s %10s\n", "size", "cpu MB/s", "neon MB/s",
+		"dma MB/s");
+
+	for (len = SZ_256; len <= COPY_BENCH_MAX; len <<= 2) {
+		start = ktime_get();
+		for (i = 0; i < iterations; i++)
+			memcpy(dst, src, len);
+		cpu = copy_bench_rate(len, ktime_to_ns(ktime_sub(ktime_get(),
+								 start)));
+
+		start = ktime_get();
+		for (i = 0; i < iterations; i++)
+			memcpy_neon(dst, src, len);
+		neon = copy_bench_rate(len, ktime_to_ns(ktime_sub(ktime_get(),
+								  start)));
+
+		dma = 0;
+		if (chan) {
+			start = ktime_get();
+			for (i = 0; i < iterations; i++)
+				if (copy_bench_dma(chan, dst, src, len))
+					break;
+			if (i == iterations)
+				dma = copy_bench_rate(len,
+					ktime_to_ns(ktime_sub(ktime_get(),
+							      start)));
+		}
+
+		pr_info("%8zu %10lu %10lu %10lu\n", len, cpu, neon, dma);
+		cond_resched();
+	}
+
+	pr_info("%8s %10s %10s\n", "size", "csum MB/s", "neon MB/s");
+	for (len = SZ_256; len <= COPY_BENCH_MAX; len <<= 2) {
+		csum_arm = csum_neon = 0;
+
+		start = ktime_get();
+		for (i = 0; i < iterations; i++)
+			csum_arm = __csum_partial_arm(src + 1, len - 1,
+						      csum_arm);
+		cpu = copy_bench_rate(len, ktime_to_ns(ktime_sub(ktime_get(),
+								 start)));
+
+		start = ktime_get();
+		for (i = 0; i < iterations; i++)
+			csum_neon = csum_partial(src + 1, len - 1, csum_neon);
+		neon = copy_bench_rate(len, ktime_to_ns(ktime_sub(ktime_get(),
+								  start)));
+
+		/* odd address and length check the NEON tail handling */
+		pr_info("%8zu %10lu %10lu%s\n", len, cpu, neon,
+			csum_fold(csum_arm) != csum_fold(csum_neon) ?
+			" MISMATCH" : "");
+		cond_resched();
+	}
+	ret = 0;
+
+	if (chan)
+		dma_release_channel(chan);
+out:
+	free_pages((unsigned long)dst, order);
+	free_pages((unsigned long)src, order);
+	return ret;
+}
+
+static void __exit copy_bench_exit(void)
+{
+}
+
+module_init(copy_bench_init);
+module_exit(copy_bench_exit);
+
+MODULE_DESCRIPTION("memcpy, NEON and DMA engine copy bandwidth");
+MODULE_LICENSE("GPL");
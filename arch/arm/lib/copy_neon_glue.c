@@ -0,0 +1,75 @@
+/*
+ *  linux/arch/arm/lib/copy_neon_glue.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Runtime selection of the NEON copy routines.  NEON can't be used in
+ * interrupt context, and kernel_neon_begin() may have to save the VFP
+ * state of the current task, so the ARM routines are kept for interrupt
+ * context and for copies below NEON_COPY_THRESHOLD.  neon_copy=0 on the
+ * command line, or in /sys/module/kernel/parameters, turns it off.
+ */
+#include <linux/export.h>
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/moduleparam.h>
+#include <linux/string.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#define NEON_COPY_THRESHOLD	1024
+
+extern void __memcpy_neon(void *to, const void *from, size_t n);
+extern void __copy_page_arm(void *to, const void *from);
+
+static bool neon_copy_hw __read_mostly;
+static bool neon_copy_enable __read_mostly = true;
+core_param(neon_copy, neon_copy_enable, bool, 0644);
+
+static inline bool neon_copy_usable(void)
+{
+	return neon_copy_hw && neon_copy_enable && !in_interrupt();
+}
+
+void copy_page(void *to, const void *from)
+{
+	if (!neon_copy_usable()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__memcpy_neon(to, from, PAGE_SIZE);
+	kernel_neon_end();
+}
+
+/*
+ * memcpy() for callers that know their copies are large, such as frame
+ * buffer updates.  Must not be called with NEON already in use.
+ */
+void *memcpy_neon(void *to, const void *from, size_t n)
+{
+	size_t bulk = n & ~63;
+
+	if (n < NEON_COPY_THRESHOLD || !neon_copy_usable())
+		return memcpy(to, from, n);
+
+	kernel_neon_begin();
+	__memcpy_neon(to, from, bulk);
+	kernel_neon_end();
+
+	if (n != bulk)
+		memcpy(to + bulk, from + bulk, n - bulk);
+	return to;
+}
+EXPORT_SYMBOL(memcpy_neon);
+
+/* runs after vfp_init() has set HWCAP_NEON */
+static int __init neon_copy_init(void)
+{
+	neon_copy_hw = cpu_has_neon();
+	return 0;
+}
+late_initcall(neon_copy_init);
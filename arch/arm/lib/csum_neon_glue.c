@@ -0,0 +1,59 @@
+/*
+ *  linux/arch/arm/lib/csum_neon_glue.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Runtime selection of the NEON csum_partial().  Kernel mode NEON is
+ * not available in interrupt context, which includes the softirq RX path
+ * and anything run with bottom halves disabled, so there the ARM routine
+ * is used.  Process context callers, such as checksum completion in
+ * udp_recvmsg() or the TCP copy to user with checksum, get NEON for
+ * buffers of at least NEON_CSUM_THRESHOLD bytes.  neon_csum=0 turns it
+ * off.
+ */
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/moduleparam.h>
+#include <net/checksum.h>
+#include <asm/neon.h>
+
+#define NEON_CSUM_THRESHOLD	256
+
+extern u64 __csum_partial_neon(const void *buff, int len);
+
+static bool neon_csum_hw __read_mostly;
+static bool neon_csum_enable __read_mostly = true;
+core_param(neon_csum, neon_csum_enable, bool, 0644);
+
+__wsum csum_partial(const void *buff, int len, __wsum sum)
+{
+	int bulk = len & ~63;
+	u64 s;
+
+	if (len < NEON_CSUM_THRESHOLD || !neon_csum_hw || !neon_csum_enable ||
+	    in_interrupt())
+		return __csum_partial_arm(buff, len, sum);
+
+	kernel_neon_begin();
+	s = __csum_partial_neon(buff, bulk);
+	kernel_neon_end();
+
+	s = (s & 0xffffffff) + (s >> 32);
+	s = (s & 0xffffffff) + (s >> 32);
+	sum = csum_add(sum, (__force __wsum)(u32)s);
+
+	/* bulk is even, so the tail keeps the byte lanes of the buffer */
+	if (len != bulk)
+		sum = __csum_partial_arm(buff + bulk, len - bulk, sum);
+	return sum;
+}
+
+/* runs after vfp_init() has set HWCAP_NEON */
+static int __init neon_csum_init(void)
+{
+	neon_csum_hw = cpu_has_neon();
+	return 0;
+}
+late_initcall(neon_csum_init);
@@ -29,6 +29,7 @@
 #include <linux/of_fdt.h>
 #include <linux/platform_device.h>
 #include <linux/proc_fs.h>
+#include <linux/slab.h>
 #include <linux/reboot.h>
 #include <linux/regulator/consumer.h>
 #include <linux/sched.h>
@@ -127,6 +128,25 @@ static struct clk *pll3_pfd1_540m_clk;
 static struct delayed_work low_bus_freq_handler;
 static struct delayed_work bus_freq_daemon;
 
+/*
+ * Load based scaling: the MMDC profiling counters are sampled every
+ * bus_load_sample_ms and a BUS_FREQ_HIGH request is held on behalf of the
+ * memory traffic while the controller is busy, on top of the driver
+ * requests. The request is taken as soon as the busy ratio reaches
+ * bus_load_up_threshold and dropped only after bus_load_down_samples
+ * samples in a row below bus_load_down_threshold.
+ */
+static struct delayed_work bus_load_work;
+static int bus_load_scaling;
+static int bus_load_high_vote;
+static unsigned int bus_load_up_threshold = 60;
+static unsigned int bus_load_down_threshold = 25;
+static unsigned int bus_load_down_samples = 5;
+static unsigned int bus_load_sample_ms = 100;
+static unsigned int bus_load_idle_samples;
+static unsigned int bus_load, bus_load_bw;
+static unsigned long bus_load_last;
+
 static RAW_NOTIFIER_HEAD(busfreq_notifier_chain);
 
 static bool check_m4_sleep(void)
@@ -784,16 +804,8 @@ static int set_high_bus_freq(int high_bus_freq)
 	return 0;
 }
 
-void request_bus_freq(enum bus_freq_mode mode)
+static void __request_bus_freq_count(enum bus_freq_mode mode)
 {
-	mutex_lock(&bus_freq_mutex);
-
-	if (mode == BUS_FREQ_ULTRA_LOW) {
-		dev_dbg(busfreq_dev, "This mode cannot be requested!\n");
-		mutex_unlock(&bus_freq_mutex);
-		return;
-	}
-
 	if (mode == BUS_FREQ_HIGH)
 		high_bus_count++;
 	else if (mode == BUS_FREQ_MED)
@@ -802,36 +814,147 @@ void request_bus_freq(enum bus_freq_mode mode)
 		audio_bus_count++;
 	else if (mode == BUS_FREQ_LOW)
 		low_bus_count++;
+}
 
+/* Called with bus_freq_mutex held, once the request has been counted. */
+static void __request_bus_freq_apply(enum bus_freq_mode mode)
+{
 	if (busfreq_suspended || !bus_freq_scaling_initialized ||
-		!bus_freq_scaling_is_active) {
-		mutex_unlock(&bus_freq_mutex);
+		!bus_freq_scaling_is_active)
 		return;
-	}
+
 	cancel_delayed_work_sync(&low_bus_freq_handler);
 
 	if ((mode == BUS_FREQ_HIGH) && (!high_bus_freq_mode)) {
 		set_high_bus_freq(1);
-		mutex_unlock(&bus_freq_mutex);
 		return;
 	}
 
 	if ((mode == BUS_FREQ_MED) && (!high_bus_freq_mode) &&
 		(!med_bus_freq_mode)) {
 		set_high_bus_freq(0);
-		mutex_unlock(&bus_freq_mutex);
 		return;
 	}
 	if ((mode == BUS_FREQ_AUDIO) && (!high_bus_freq_mode) &&
-		(!med_bus_freq_mode) && (!audio_bus_freq_mode)) {
+		(!med_bus_freq_mode) && (!audio_bus_freq_mode))
 		set_low_bus_freq();
+}
+
+void request_bus_freq(enum bus_freq_mode mode)
+{
+	mutex_lock(&bus_freq_mutex);
+
+	if (mode == BUS_FREQ_ULTRA_LOW) {
+		dev_dbg(busfreq_dev, "This mode cannot be requested!\n");
 		mutex_unlock(&bus_freq_mutex);
 		return;
 	}
+
+	__request_bus_freq_count(mode);
+	__request_bus_freq_apply(mode);
+
 	mutex_unlock(&bus_freq_mutex);
 }
 EXPORT_SYMBOL(request_bus_freq);
 
+struct busfreq_async_req {
+	struct list_head node;
+	enum bus_freq_mode mode;
+	void (*done)(void *data);
+	void *data;
+};
+
+static LIST_HEAD(busfreq_async_list);
+static DEFINE_SPINLOCK(busfreq_async_lock);
+
+/*
+ * Take all requests queued so far and serve them with a single
+ * transition, to the highest mode any of them asked for. BUS_FREQ_HIGH
+ * has the lowest value in enum bus_freq_mode.
+ */
+static void busfreq_async_handler(struct work_struct *work)
+{
+	struct busfreq_async_req *req, *tmp;
+	enum bus_freq_mode mode = BUS_FREQ_ULTRA_LOW;
+	LIST_HEAD(list);
+
+	spin_lock_irq(&busfreq_async_lock);
+	list_splice_init(&busfreq_async_list, &list);
+	spin_unlock_irq(&busfreq_async_lock);
+
+	if (list_empty(&list))
+		return;
+
+	mutex_lock(&bus_freq_mutex);
+	list_for_each_entry(req, &list, node) {
+		__request_bus_freq_count(req->mode);
+		if (req->mode < mode)
+			mode = req->mode;
+	}
+	__request_bus_freq_apply(mode);
+	mutex_unlock(&bus_freq_mutex);
+
+	list_for_each_entry_safe(req, tmp, &list, node) {
+		if (req->done)
+			req->done(req->data);
+		kfree(req);
+	}
+}
+
+static DECLARE_WORK(busfreq_async_work, busfreq_async_handler);
+
+/*
+ * Like request_bus_freq(), but does not wait for the DDR frequency change.
+ * @done is called, from a workqueue, once the bus runs in @mode or higher.
+ * Requests arriving while a transition is in progress are batched into
+ * the next one. The request must not be released before @done has run.
+ */
+int request_bus_freq_async(enum bus_freq_mode mode,
+			   void (*done)(void *data), void *data)
+{
+	struct busfreq_async_req *req;
+	unsigned long flags;
+
+	if (mode == BUS_FREQ_ULTRA_LOW) {
+		dev_dbg(busfreq_dev, "This mode cannot be requested!\n");
+		return -EINVAL;
+	}
+
+	/*
+	 * Nothing to change: count the request and complete it now. A queued
+	 * or running low bus handler has to be cancelled first, so leave that
+	 * case to the worker.
+	 */
+	if (mode == BUS_FREQ_HIGH && mutex_trylock(&bus_freq_mutex)) {
+		if (high_bus_freq_mode &&
+		    !work_busy(&low_bus_freq_handler.work)) {
+			high_bus_count++;
+			mutex_unlock(&bus_freq_mutex);
+			if (done)
+				done(data);
+			return 0;
+		}
+		mutex_unlock(&bus_freq_mutex);
+	}
+
+	req = kzalloc(sizeof(*req), GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	req->mode = mode;
+	req->done = done;
+	req->data = data;
+
+	spin_lock_irqsave(&busfreq_async_lock, flags);
+	list_add_tail(&req->node, &busfreq_async_list);
+	spin_unlock_irqrestore(&busfreq_async_lock, flags);
+
+	queue_work(system_highpri_wq, &busfreq_async_work);
+
+	return 0;
+}
+EXPORT_SYMBOL(request_bus_freq_async);
+
 void release_bus_freq(enum bus_freq_mode mode)
 {
 	mutex_lock(&bus_freq_mutex);
@@ -984,6 +1107,75 @@ static void bus_freq_daemon_handler(struct work_struct *work)
 	mutex_unlock(&bus_freq_mutex);
 }
 
+static void bus_load_handler(struct work_struct *work)
+{
+	struct imx_mmdc_perf perf;
+	unsigned long now = jiffies;
+	unsigned int elapsed;
+	u64 bytes;
+
+	if (imx_mmdc_perf_sample(&perf) || !perf.total_cycles)
+		goto out;
+
+	bus_load = div_u64((u64)perf.busy_cycles * 100, perf.total_cycles);
+
+	/* bandwidth in MB/s, only reported to userspace */
+	elapsed = jiffies_to_msecs(now - bus_load_last);
+	bytes = (u64)perf.read_bytes + perf.write_bytes;
+	if (elapsed)
+		bus_load_bw = div_u64(bytes * MSEC_PER_SEC, elapsed) >> 20;
+
+	if (bus_load >= bus_load_up_threshold) {
+		bus_load_idle_samples = 0;
+		if (!bus_load_high_vote) {
+			bus_load_high_vote = 1;
+			request_bus_freq(BUS_FREQ_HIGH);
+		}
+	} else if (bus_load < bus_load_down_threshold && bus_load_high_vote) {
+		if (++bus_load_idle_samples >= bus_load_down_samples) {
+			bus_load_idle_samples = 0;
+			bus_load_high_vote = 0;
+			release_bus_freq(BUS_FREQ_HIGH);
+		}
+	} else {
+		bus_load_idle_samples = 0;
+	}
+
+out:
+	bus_load_last = now;
+	queue_delayed_work(system_freezable_wq, &bus_load_work,
+			   msecs_to_jiffies(bus_load_sample_ms));
+}
+
+static int bus_load_start(void)
+{
+	int ret;
+
+	ret = imx_mmdc_perf_start();
+	if (ret)
+		return ret;
+
+	bus_load_idle_samples = 0;
+	bus_load_last = jiffies;
+	bus_load_scaling = 1;
+	queue_delayed_work(system_freezable_wq, &bus_load_work,
+			   msecs_to_jiffies(bus_load_sample_ms));
+
+	return 0;
+}
+
+static void bus_load_stop(void)
+{
+	cancel_delayed_work_sync(&bus_load_work);
+	imx_mmdc_perf_stop();
+	bus_load_scaling = 0;
+
+	if (bus_load_high_vote) {
+		bus_load_high_vote = 0;
+		release_bus_freq(BUS_FREQ_HIGH);
+	}
+}
+
 static ssize_t bus_freq_scaling_enable_show(struct device *dev,
 				struct device_attribute *attr, char *buf)
 {
@@ -1006,7 +1198,7 @@ static ssize_t bus_freq_scaling_enable_store(struct device *dev,
 		 * can enter low bus mode if
 		 * there is no high bus request pending
 		 */
-		schedule_delayed_work(&bus_freq_daemon,
+		queue_delayed_work(system_lowlat_wq, &bus_freq_daemon,
 			usecs_to_jiffies(5000000));
 	} else if (strncmp(buf, "0", 1) == 0) {
 		if (bus_freq_scaling_is_active)
@@ -1032,7 +1224,7 @@ static int bus_freq_pm_notify(struct notifier_block *nb, unsigned long event,
 		high_bus_count--;
 		if (cpu_is_imx7d() && imx_src_is_m4_enabled())
 			imx_mu_lpm_ready(true);
-		schedule_delayed_work(&bus_freq_daemon,
+		queue_delayed_work(system_lowlat_wq, &bus_freq_daemon,
 			usecs_to_jiffies(5000000));
 	}
 
@@ -1062,6 +1254,84 @@ static struct notifier_block imx_busfreq_reboot_notifier = {
 static DEVICE_ATTR(enable, 0644, bus_freq_scaling_enable_show,
 			bus_freq_scaling_enable_store);
 
+static ssize_t load_scaling_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", bus_load_scaling);
+}
+
+static ssize_t load_scaling_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t size)
+{
+	static DEFINE_MUTEX(load_scaling_lock);
+	bool enable;
+	int ret = 0;
+
+	if (strtobool(buf, &enable))
+		return -EINVAL;
+
+	mutex_lock(&load_scaling_lock);
+	if (enable && !bus_load_scaling)
+		ret = bus_load_start();
+	else if (!enable && bus_load_scaling)
+		bus_load_stop();
+	mutex_unlock(&load_scaling_lock);
+
+	return ret ? ret : size;
+}
+static DEVICE_ATTR_RW(load_scaling);
+
+#define BUS_LOAD_PARAM_ATTR(_name, _min, _max)				\
+static ssize_t load_##_name##_show(struct device *dev,			\
+				   struct device_attribute *attr,	\
+				   char *buf)				\
+{									\
+	return sprintf(buf, "%u\n", bus_load_##_name);			\
+}									\
+									\
+static ssize_t load_##_name##_store(struct device *dev,			\
+				    struct device_attribute *attr,	\
+				    const char *buf, size_t size)	\
+{									\
+	unsigned int val;						\
+									\
+	if (kstrtouint(buf, 0, &val) || val < (_min) || val > (_max))	\
+		return -EINVAL;						\
+									\
+	bus_load_##_name = val;						\
+	return size;							\
+}									\
+static DEVICE_ATTR_RW(load_##_name)
+
+BUS_LOAD_PARAM_ATTR(up_threshold, 1, 100);
+BUS_LOAD_PARAM_ATTR(down_threshold, 0, 100);
+BUS_LOAD_PARAM_ATTR(down_samples, 1, 100);
+/* the MMDC cycle counter wraps after about 8s at 528MHz */
+BUS_LOAD_PARAM_ATTR(sample_ms, 10, 1000);
+
+static ssize_t load_show(struct device *dev,
+			 struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "busy %u%% bandwidth %uMB/s%s\n", bus_load,
+		       bus_load_bw, bus_load_high_vote ? " (high)" : "");
+}
+static DEVICE_ATTR_RO(load);
+
+static struct attribute *bus_load_attrs[] = {
+	&dev_attr_load_scaling.attr,
+	&dev_attr_load_up_threshold.attr,
+	&dev_attr_load_down_threshold.attr,
+	&dev_attr_load_down_samples.attr,
+	&dev_attr_load_sample_ms.attr,
+	&dev_attr_load.attr,
+	NULL,
+};
+
+static const struct attribute_group bus_load_attr_group = {
+	.attrs = bus_load_attrs,
+};
+
 /*!
  * This is the probe routine for the bus frequency driver.
  *
@@ -1218,6 +1488,13 @@ static int busfreq_probe(struct platform_device *pdev)
 		return err;
 	}
 
+	err = sysfs_create_group(&busfreq_dev->kobj, &bus_load_attr_group);
+	if (err) {
+		dev_err(busfreq_dev,
+			"Unable to register load scaling entries for BUSFREQ");
+		return err;
+	}
+
 	if (of_property_read_u32(pdev->dev.of_node, "fsl,max_ddr_freq",
 			&ddr_normal_rate)) {
 		dev_err(busfreq_dev, "max_ddr_freq entry missing\n");
@@ -1238,11 +1515,12 @@ static int busfreq_probe(struct platform_device *pdev)
 
 	INIT_DELAYED_WORK(&low_bus_freq_handler, reduce_bus_freq_handler);
 	INIT_DELAYED_WORK(&bus_freq_daemon, bus_freq_daemon_handler);
+	INIT_DELAYED_WORK(&bus_load_work, bus_load_handler);
 	register_pm_notifier(&imx_bus_freq_pm_notifier);
 	register_reboot_notifier(&imx_busfreq_reboot_notifier);
 
 	/* enter low bus mode if no high speed device enabled */
-	schedule_delayed_work(&bus_freq_daemon,
+	queue_delayed_work(system_lowlat_wq, &bus_freq_daemon,
 		msecs_to_jiffies(10000));
 
 	/*
@@ -1308,6 +1586,12 @@ static int busfreq_probe(struct platform_device *pdev)
 		dev_err(busfreq_dev, "Busfreq init of ddr controller failed\n");
 		return err;
 	}
+
+	/* only the MMDC has profiling counters, not the i.MX7D DDRC */
+	if (of_property_read_bool(pdev->dev.of_node, "fsl,load-scaling") &&
+	    bus_load_start())
+		dev_warn(busfreq_dev, "load based scaling not supported\n");
+
 	return 0;
 }
 
@@ -1344,6 +1628,9 @@ static int __init busfreq_init(void)
 
 static void __exit busfreq_cleanup(void)
 {
+	if (bus_load_scaling)
+		bus_load_stop();
+	sysfs_remove_group(&busfreq_dev->kobj, &bus_load_attr_group);
 	sysfs_remove_file(&busfreq_dev->kobj, &dev_attr_enable.attr);
 
 	/* Unregister the device structure */
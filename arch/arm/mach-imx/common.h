@@ -166,12 +166,27 @@ int imx6q_set_lpm(enum mxc_cpu_pwr_mode mode);
 void imx6q_set_int_mem_clk_lpm(bool enable);
 void imx6sl_set_wait_clk(bool enter);
 void imx6_enet_mac_init(const char *enet_compat, const char *ocotp_compat);
+struct imx_mmdc_perf {
+	u32 total_cycles;
+	u32 busy_cycles;
+	u32 read_bytes;
+	u32 write_bytes;
+};
 #ifdef CONFIG_HAVE_IMX_MMDC
 int imx_mmdc_get_ddr_type(void);
 int imx_mmdc_get_lpddr2_2ch_mode(void);
+int imx_mmdc_perf_start(void);
+void imx_mmdc_perf_stop(void);
+int imx_mmdc_perf_sample(struct imx_mmdc_perf *perf);
 #else
 static inline int imx_mmdc_get_ddr_type(void) { return 0; }
 static inline int imx_mmdc_get_lpddr2_2ch_mode(void) { return 0; }
+static inline int imx_mmdc_perf_start(void) { return -ENODEV; }
+static inline void imx_mmdc_perf_stop(void) {}
+static inline int imx_mmdc_perf_sample(struct imx_mmdc_perf *perf)
+{
+	return -ENODEV;
+}
 #endif
 #ifdef CONFIG_HAVE_IMX_DDRC
 int imx_ddrc_get_ddr_type(void);
@@ -7,10 +7,15 @@
  */
 
 #include <linux/busfreq-imx.h>
+#include <linux/cpu.h>
 #include <linux/cpuidle.h>
 #include <linux/cpu_pm.h>
 #include <linux/delay.h>
+#include <linux/irqnr.h>
+#include <linux/kernel_stat.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/slab.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
 #include <linux/regulator/driver.h>
@@ -83,6 +88,132 @@ static const u32 imx6ul_mmdc_io_offset[] __initconst = {
 
 static void (*imx6ul_wfi_in_iram_fn)(void __iomem *iram_vbase);
 
+/*
+ * Wakeup prediction for the low power idle state. The menu governor only
+ * knows about timers, so periodic device interrupts keep waking the ARM
+ * right after it has been powered off. On every WAIT/low power idle
+ * entry a small window of the interrupt counters is scanned round robin
+ * to find active sources, which are then tracked in a few slots. A
+ * tracked interrupt that fired since the previous entry gets its interval
+ * updated. Interrupts firing at a stable interval are expected again, and
+ * low power idle is demoted to WAIT if one of them is due before the
+ * state's target residency.
+ */
+struct imx6ul_idle_irq {
+	unsigned int irq;
+	unsigned int count;
+	s64 last_us;
+	s64 seen_us;
+	u32 interval_us;
+	u32 deviation_us;
+};
+
+/* interrupts whose timing is tracked, and counters scanned per entry */
+#define IDLE_IRQ_SLOTS			8
+#define IDLE_IRQ_SCAN_CHUNK		16
+
+static struct imx6ul_idle_irq idle_irqs[IDLE_IRQ_SLOTS];
+static unsigned int idle_nr_tracked;
+static unsigned int *idle_scan_count;
+static unsigned int idle_scan_pos;
+static unsigned int idle_nr_irqs;
+static bool idle_predict = true;
+
+static u64 lpi_entries;
+static u64 lpi_demoted;
+static u64 lpi_misses;
+static u64 lpi_residency_us;
+
+/* intervals longer than this are not worth tracking */
+#define IDLE_IRQ_MAX_INTERVAL_US	(1 * USEC_PER_SEC)
+
+static void imx6ul_idle_track(unsigned int i, unsigned int count, s64 now)
+{
+	struct imx6ul_idle_irq *irq;
+	unsigned int n;
+
+	for (n = 0; n < idle_nr_tracked; n++)
+		if (idle_irqs[n].irq == i)
+			return;
+	if (idle_nr_tracked == IDLE_IRQ_SLOTS)
+		return;
+
+	/* the first counter change only anchors the interval */
+	irq = &idle_irqs[idle_nr_tracked++];
+	memset(irq, 0, sizeof(*irq));
+	irq->irq = i;
+	irq->count = count;
+	irq->seen_us = now;
+}
+
+static s64 imx6ul_idle_predict(s64 now)
+{
+	s64 next = S64_MAX;
+	unsigned int i, n;
+
+	for (n = 0; n < min_t(unsigned int, IDLE_IRQ_SCAN_CHUNK,
+			      idle_nr_irqs); n++) {
+		unsigned int count;
+
+		i = idle_scan_pos;
+		if (++idle_scan_pos == idle_nr_irqs)
+			idle_scan_pos = 0;
+
+		count = kstat_irqs_cpu(i, 0);
+		if (count == idle_scan_count[i])
+			continue;
+		idle_scan_count[i] = count;
+		imx6ul_idle_track(i, count, now);
+	}
+
+	for (n = 0; n < idle_nr_tracked; ) {
+		struct imx6ul_idle_irq *irq = &idle_irqs[n];
+		unsigned int count = kstat_irqs_cpu(irq->irq, 0);
+		s64 delta, due;
+
+		if (count != irq->count) {
+			delta = now - irq->last_us;
+			if (irq->last_us && delta < IDLE_IRQ_MAX_INTERVAL_US) {
+				u32 d = delta;
+
+				if (!irq->interval_us) {
+					irq->interval_us = d;
+				} else {
+					irq->deviation_us = (3 * irq->deviation_us +
+						abs((s32)(d - irq->interval_us))) / 4;
+					irq->interval_us = (3 * irq->interval_us +
+							    d) / 4;
+				}
+			} else {
+				irq->interval_us = 0;
+				irq->deviation_us = 0;
+			}
+			irq->count = count;
+			irq->last_us = now;
+			irq->seen_us = now;
+		} else if (now - irq->seen_us > IDLE_IRQ_MAX_INTERVAL_US) {
+			/* gone quiet, free the slot for another source */
+			*irq = idle_irqs[--idle_nr_tracked];
+			continue;
+		}
+		n++;
+
+		/* only trust sources with a stable period */
+		if (!irq->interval_us ||
+		    irq->deviation_us > irq->interval_us / 4)
+			continue;
+
+		due = irq->last_us + irq->interval_us - now;
+		/* overdue by a whole period, the source has stopped */
+		if (due < -(s64)irq->interval_us)
+			continue;
+		if (due < next)
+			next = max_t(s64, due, 0);
+	}
+
+	return next;
+}
+
 static int imx6ul_idle_finish(unsigned long val)
 {
 	imx6ul_wfi_in_iram_fn(wfi_iram_base);
@@ -94,11 +225,28 @@ static int imx6ul_enter_wait(struct cpuidle_device *dev,
 			    struct cpuidle_driver *drv, int index)
 {
 	int mode = get_bus_freq_mode();
+	s64 now = 0, next = S64_MAX;
+
+	if (idle_scan_count && idle_predict) {
+		now = ktime_to_us(ktime_get());
+		next = imx6ul_idle_predict(now);
+	}
+
+	if (index == 2 && mode == BUS_FREQ_LOW &&
+	    next < drv->states[index].target_residency) {
+		lpi_demoted++;
+		index = 1;
+	}
 
 	imx6q_set_lpm(WAIT_UNCLOCKED);
 	if ((index == 1) || ((mode != BUS_FREQ_LOW) && index == 2)) {
 		cpu_do_idle();
 	} else {
+		s64 residency;
+
+		if (!now)
+			now = ktime_to_us(ktime_get());
+
 		/*
 		 * i.MX6UL TO1.0 ARM power up uses IPG/2048 as clock source,
 		 * from TO1.1, PGC_CPU_PUPSCR bit [5] is re-defined to switch
@@ -121,6 +269,12 @@ static int imx6ul_enter_wait(struct cpuidle_device *dev,
 		if (cpu_is_imx6ul() && imx_get_soc_revision() >
 			IMX_CHIP_REVISION_1_0)
 			imx_gpc_switch_pupscr_clk(false);
+
+		residency = ktime_to_us(ktime_get()) - now;
+		lpi_entries++;
+		lpi_residency_us += residency;
+		if (residency < drv->states[index].target_residency)
+			lpi_misses++;
 	}
 
 	imx6q_set_lpm(WAIT_CLOCKED);
@@ -192,6 +346,56 @@ static struct cpuidle_driver imx6ul_cpuidle_driver = {
 	.safe_state_index = 0,
 };
 
+static ssize_t show_lpi_stats(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "entries %llu demoted %llu misses %llu residency %lluus\n",
+		       lpi_entries, lpi_demoted, lpi_misses, lpi_residency_us);
+}
+static DEVICE_ATTR(lpi_stats, 0444, show_lpi_stats, NULL);
+
+static ssize_t show_lpi_predict(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", idle_predict);
+}
+
+static ssize_t store_lpi_predict(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	if (strtobool(buf, &idle_predict))
+		return -EINVAL;
+
+	return count;
+}
+static DEVICE_ATTR(lpi_predict, 0644, show_lpi_predict, store_lpi_predict);
+
+static struct attribute *imx6ul_idle_attrs[] = {
+	&dev_attr_lpi_stats.attr,
+	&dev_attr_lpi_predict.attr,
+	NULL,
+};
+
+static struct attribute_group imx6ul_idle_attr_group = {
+	.name = "imx6ul_idle",
+	.attrs = imx6ul_idle_attrs,
+};
+
+static void __init imx6ul_idle_predict_init(void)
+{
+	idle_scan_count = kcalloc(nr_irqs, sizeof(*idle_scan_count),
+				  GFP_KERNEL);
+	if (!idle_scan_count)
+		return;
+	idle_nr_irqs = nr_irqs;
+
+	/* under /sys/devices/system/cpu, next to the cpuidle directory */
+	if (sysfs_create_group(&cpu_subsys.dev_root->kobj,
+			       &imx6ul_idle_attr_group))
+		pr_warn("%s: failed to create sysfs entries\n", __func__);
+}
+
 int __init imx6ul_cpuidle_init(void)
 {
 	void __iomem *anatop_base = (void __iomem *)IMX_IO_P2V(MX6Q_ANATOP_BASE_ADDR);
@@ -306,6 +510,8 @@ int __init imx6ul_cpuidle_init(void)
 	 */
 	val = readl_relaxed(anatop_base  + XTALOSC24M_OSC_CONFIG1);
 
+	imx6ul_idle_predict_init();
+
 	/* ARM power up time is reduced since TO1.1 */
 	if (imx_get_soc_revision() > IMX_CHIP_REVISION_1_0)
 		return cpuidle_register(&imx6ul_cpuidle_driver_v2, NULL);
@@ -11,6 +11,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/io.h>
 #include <linux/irq.h>
@@ -20,6 +21,7 @@
 #include <linux/platform_device.h>
 #include <linux/pm_domain.h>
 #include <linux/regulator/consumer.h>
+#include <linux/seq_file.h>
 #include <linux/irqchip/arm-gic.h>
 #include "common.h"
 #include "hardware.h"
@@ -84,8 +86,15 @@ struct disp_domain {
 	struct generic_pm_domain base;
 	struct clk *clk[GPC_CLK_MAX];
 	int num_clks;
+	u32 pup_delay_us;	/* power switch delay, from the ipg rate */
 };
 
+#ifdef CONFIG_PM_GENERIC_DOMAINS
+#define IMX_GPC_PD_GOV		(&simple_qos_governor)
+#else
+#define IMX_GPC_PD_GOV		NULL
+#endif
+
 static void __iomem *gpc_base;
 static u32 gpc_wake_irqs[IMR_NUM];
 static u32 gpc_saved_imrs[IMR_NUM];
@@ -707,15 +716,20 @@ static int imx6q_pm_pu_power_on(struct generic_pm_domain *genpd)
 	return 0;
 }
 
+static bool imx_gpc_has_dispmix(void)
+{
+	return (cpu_is_imx6sl() &&
+		imx_get_soc_revision() >= IMX_CHIP_REVISION_1_2) ||
+		cpu_is_imx6sx();
+}
+
 static int imx_pm_dispmix_on(struct generic_pm_domain *genpd)
 {
 	struct disp_domain *disp = container_of(genpd, struct disp_domain, base);
 	u32 val = readl_relaxed(gpc_base + GPC_CNTR);
 	int i;
-	u32 ipg_rate = clk_get_rate(ipg);
 
-	if ((cpu_is_imx6sl() &&
-		imx_get_soc_revision() >= IMX_CHIP_REVISION_1_2) || cpu_is_imx6sx()) {
+	if (imx_gpc_has_dispmix()) {
 
 		/* Enable reset clocks for all devices in the disp domain */
 		for (i = 0; i < disp->num_clks; i++)
@@ -729,8 +743,7 @@ static int imx_pm_dispmix_on(struct generic_pm_domain *genpd)
 		writel_relaxed(0x1, gpc_base + GPC_PGC_DISP_SR_OFFSET);
 
 		/* Wait power switch done */
-		udelay(2 * DEFAULT_IPG_RATE / ipg_rate +
-			GPC_PU_UP_DELAY_MARGIN);
+		udelay(disp->pup_delay_us);
 
 		/* Disable reset clocks for all devices in the disp domain */
 		for (i = 0; i < disp->num_clks; i++)
@@ -745,17 +758,12 @@ static int imx_pm_dispmix_off(struct generic_pm_domain *genpd)
 	u32 val = readl_relaxed(gpc_base + GPC_CNTR);
 	int i;
 
-	if ((cpu_is_imx6sl() &&
-		imx_get_soc_revision() >= IMX_CHIP_REVISION_1_2) || cpu_is_imx6sx()) {
+	if (imx_gpc_has_dispmix()) {
 
 		/* Enable reset clocks for all devices in the disp domain */
 		for (i = 0; i < disp->num_clks; i++)
 			clk_prepare_enable(disp->clk[i]);
 
-		writel_relaxed(0xFFFFFFFF,
-				gpc_base + GPC_PGC_DISP_PUPSCR_OFFSET);
-		writel_relaxed(0xFFFFFFFF,
-				gpc_base + GPC_PGC_DISP_PDNSCR_OFFSET);
 		writel_relaxed(0x1, gpc_base + GPC_PGC_DISP_PGCR_OFFSET);
 		writel_relaxed(0x10 | val, gpc_base + GPC_CNTR);
 		while (readl_relaxed(gpc_base + GPC_CNTR) & 0x10)
@@ -801,6 +809,69 @@ static struct genpd_onecell_data imx_gpc_onecell_data = {
 	.num_domains = ARRAY_SIZE(imx_gpc_domains),
 };
 
+/*
+ * The PGC lives in the always-on GPC, so the display switch timings
+ * only need programming once and the ipg rate is sampled here instead
+ * of on every power up.
+ */
+static void imx_gpc_dispmix_init(struct disp_domain *disp)
+{
+	unsigned long ipg_rate = 0;
+
+	if (!imx_gpc_has_dispmix())
+		return;
+
+	if (!IS_ERR_OR_NULL(ipg))
+		ipg_rate = clk_get_rate(ipg);
+	if (!ipg_rate)
+		ipg_rate = DEFAULT_IPG_RATE;
+
+	disp->pup_delay_us = 2 * DEFAULT_IPG_RATE / ipg_rate +
+			     GPC_PU_UP_DELAY_MARGIN;
+
+	writel_relaxed(0xFFFFFFFF, gpc_base + GPC_PGC_DISP_PUPSCR_OFFSET);
+	writel_relaxed(0xFFFFFFFF, gpc_base + GPC_PGC_DISP_PDNSCR_OFFSET);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int imx_gpc_domains_show(struct seq_file *s, void *unused)
+{
+	int i;
+
+	seq_puts(s, "domain     status  on_latency_ns  off_latency_ns\n");
+	for (i = 1; i < ARRAY_SIZE(imx_gpc_domains); i++) {
+		struct generic_pm_domain *genpd = imx_gpc_domains[i];
+
+		seq_printf(s, "%-10s %-7s %13lld %15lld\n", genpd->name,
+			   genpd->status == GPD_STATE_POWER_OFF ? "off" : "on",
+			   genpd->power_on_latency_ns,
+			   genpd->power_off_latency_ns);
+	}
+
+	return 0;
+}
+
+static int imx_gpc_domains_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, imx_gpc_domains_show, inode->i_private);
+}
+
+static const struct file_operations imx_gpc_domains_fops = {
+	.open		= imx_gpc_domains_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void imx_gpc_debugfs_init(void)
+{
+	debugfs_create_file("gpc_domains", S_IRUGO, NULL, NULL,
+			    &imx_gpc_domains_fops);
+}
+#else
+static inline void imx_gpc_debugfs_init(void) {}
+#endif
+
 static int imx_gpc_genpd_init(struct device *dev, struct regulator *pu_reg)
 {
 	struct clk *clk;
@@ -843,6 +914,8 @@ static int imx_gpc_genpd_init(struct device *dev, struct regulator *pu_reg)
 	}
 	imx6s_display_domain.num_clks = k;
 
+	imx_gpc_dispmix_init(&imx6s_display_domain);
+
 	is_off = IS_ENABLED(CONFIG_PM);
 	if (is_off && !(cpu_is_imx6q() &&
 		imx_get_soc_revision() == IMX_CHIP_REVISION_2_0)) {
@@ -855,8 +928,14 @@ static int imx_gpc_genpd_init(struct device *dev, struct regulator *pu_reg)
 		imx6q_pm_pu_power_on(&imx6q_pu_domain.base);
 	}
 
-	pm_genpd_init(&imx6q_pu_domain.base, NULL, is_off);
-	pm_genpd_init(&imx6s_display_domain.base, NULL, is_off);
+	/*
+	 * The power_on/off latencies are raised by genpd to the worst case
+	 * it measures, so the QoS governor keeps a domain powered whenever
+	 * a device's resume latency constraint could not be met.
+	 */
+	pm_genpd_init(&imx6q_pu_domain.base, IMX_GPC_PD_GOV, is_off);
+	pm_genpd_init(&imx6s_display_domain.base, IMX_GPC_PD_GOV, is_off);
+	imx_gpc_debugfs_init();
 
 	return of_genpd_add_provider_onecell(dev->of_node,
 					     &imx_gpc_onecell_data);
@@ -10,12 +10,17 @@
  * http://www.gnu.org/copyleft/gpl.html
  */
 
+#include <linux/hrtimer.h>
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/of_device.h>
+#include <linux/perf_event.h>
+#include <linux/spinlock.h>
+
+#include "common.h"
 
 #define MMDC_MAPSR		0x404
 #define BP_MMDC_MAPSR_PSD	0
@@ -27,13 +32,42 @@
 #define BM_MMDC_MDMISC_LPDDR2_2CH	0x4
 #define BP_MMDC_MDMISC_LPDDR2_2CH	0x2
 
+#define MMDC_MADPCR0		0x410
+#define BM_MMDC_MADPCR0_DBG_EN	(1 << 0)
+#define BM_MMDC_MADPCR0_DBG_RST	(1 << 1)
+#define BM_MMDC_MADPCR0_PRF_FRZ	(1 << 2)
+#define BM_MMDC_MADPCR0_CYC_OVF	(1 << 3)
+#define MMDC_MADPCR1		0x414
+#define MMDC_MADPSR0		0x418	/* total cycles */
+#define MMDC_MADPSR1		0x41c	/* busy cycles */
+#define MMDC_MADPSR2		0x420	/* read accesses */
+#define MMDC_MADPSR3		0x424	/* write accesses */
+#define MMDC_MADPSR4		0x428	/* read bytes */
+#define MMDC_MADPSR5		0x42c	/* write bytes */
+
 static int ddr_type;
 static int lpddr2_2ch_mode;
+static void __iomem *mmdc_base;
+
+/*
+ * The profiling counters are shared between the bus load sampling of
+ * busfreq and the perf PMU below, whichever comes first owns them.
+ */
+static DEFINE_SPINLOCK(mmdc_prof_lock);
+static bool mmdc_prof_sampling;
+static int mmdc_pmu_users;
+static u32 mmdc_pmu_filter;
+
+#ifdef CONFIG_PERF_EVENTS
+static void mmdc_pmu_init(struct platform_device *pdev);
+#else
+static inline void mmdc_pmu_init(struct platform_device *pdev) {}
+#endif
 
 static int imx_mmdc_probe(struct platform_device *pdev)
 {
 	struct device_node *np = pdev->dev.of_node;
-	void __iomem *mmdc_base, *reg;
+	void __iomem *reg;
 	u32 val;
 	int timeout = 0x400;
 
@@ -66,6 +100,8 @@ static int imx_mmdc_probe(struct platform_device *pdev)
 		return -EBUSY;
 	}
 
+	mmdc_pmu_init(pdev);
+
 	return 0;
 }
 
@@ -79,6 +115,366 @@ int imx_mmdc_get_lpddr2_2ch_mode(void)
 	return lpddr2_2ch_mode;
 }
 
+/*
+ * The profiling counters count the cycles and bytes of all AXI masters,
+ * MADPCR1 is left at zero so that no AXI ID is filtered out.
+ */
+int imx_mmdc_perf_start(void)
+{
+	int users;
+
+	if (!mmdc_base)
+		return -ENODEV;
+
+	spin_lock(&mmdc_prof_lock);
+	users = mmdc_pmu_users;
+	if (!users)
+		mmdc_prof_sampling = true;
+	spin_unlock(&mmdc_prof_lock);
+	if (users)
+		return -EBUSY;
+
+	writel_relaxed(0, mmdc_base + MMDC_MADPCR1);
+	writel_relaxed(BM_MMDC_MADPCR0_DBG_RST, mmdc_base + MMDC_MADPCR0);
+	writel_relaxed(BM_MMDC_MADPCR0_DBG_EN, mmdc_base + MMDC_MADPCR0);
+
+	return 0;
+}
+
+void imx_mmdc_perf_stop(void)
+{
+	if (!mmdc_base)
+		return;
+
+	writel_relaxed(0, mmdc_base + MMDC_MADPCR0);
+	spin_lock(&mmdc_prof_lock);
+	mmdc_prof_sampling = false;
+	spin_unlock(&mmdc_prof_lock);
+}
+
+/*
+ * Freeze the counters, read them and restart counting from zero, so
+ * that every call returns the traffic since the previous one.
+ */
+int imx_mmdc_perf_sample(struct imx_mmdc_perf *perf)
+{
+	u32 val;
+
+	if (!mmdc_base)
+		return -ENODEV;
+
+	writel_relaxed(BM_MMDC_MADPCR0_DBG_EN | BM_MMDC_MADPCR0_PRF_FRZ,
+		       mmdc_base + MMDC_MADPCR0);
+
+	val = readl_relaxed(mmdc_base + MMDC_MADPCR0);
+	perf->total_cycles = readl_relaxed(mmdc_base + MMDC_MADPSR0);
+	perf->busy_cycles = readl_relaxed(mmdc_base + MMDC_MADPSR1);
+	perf->read_bytes = readl_relaxed(mmdc_base + MMDC_MADPSR4);
+	perf->write_bytes = readl_relaxed(mmdc_base + MMDC_MADPSR5);
+
+	writel_relaxed(BM_MMDC_MADPCR0_DBG_RST, mmdc_base + MMDC_MADPCR0);
+	writel_relaxed(BM_MMDC_MADPCR0_DBG_EN, mmdc_base + MMDC_MADPCR0);
+
+	/* the cycle counter wrapped, no way to tell the real load */
+	if (val & BM_MMDC_MADPCR0_CYC_OVF)
+		return -EOVERFLOW;
+
+	return 0;
+}
+
+#ifdef CONFIG_PERF_EVENTS
+/*
+ * "mmdc" perf PMU.  The counters are 32 bits wide, free running and
+ * have no overflow interrupt: they are folded into the events from a
+ * timer often enough that even the byte counters of a fully loaded
+ * 64-bit DDR3 interface cannot wrap twice in between.  The AXI ID
+ * filter in MADPCR1 applies to all counters at once, so all events
+ * open at the same time have to ask for the same filter, e.g.
+ *
+ *   perf stat -a -e mmdc/read-bytes,axi_id=0x..,axi_id_mask=0x../ ...
+ *
+ * with the master IDs from the "AXI ID" table of the reference manual.
+ */
+#define MMDC_PMU_SLOTS		8
+#define MMDC_PMU_POLL_MS	100
+
+enum mmdc_pmu_event {
+	MMDC_EV_TOTAL_CYCLES,
+	MMDC_EV_BUSY_CYCLES,
+	MMDC_EV_READ_ACCESSES,
+	MMDC_EV_WRITE_ACCESSES,
+	MMDC_EV_READ_BYTES,
+	MMDC_EV_WRITE_BYTES,
+	MMDC_EV_TOTAL_BYTES,
+	MMDC_EV_MAX,
+};
+
+/* every event is the sum of up to two counters */
+static const u16 mmdc_pmu_regs[MMDC_EV_MAX][2] = {
+	[MMDC_EV_TOTAL_CYCLES]		= { MMDC_MADPSR0, },
+	[MMDC_EV_BUSY_CYCLES]		= { MMDC_MADPSR1, },
+	[MMDC_EV_READ_ACCESSES]		= { MMDC_MADPSR2, },
+	[MMDC_EV_WRITE_ACCESSES]	= { MMDC_MADPSR3, },
+	[MMDC_EV_READ_BYTES]		= { MMDC_MADPSR4, },
+	[MMDC_EV_WRITE_BYTES]		= { MMDC_MADPSR5, },
+	[MMDC_EV_TOTAL_BYTES]		= { MMDC_MADPSR4, MMDC_MADPSR5 },
+};
+
+static struct pmu mmdc_pmu;
+static struct hrtimer mmdc_pmu_timer;
+static struct perf_event *mmdc_pmu_events[MMDC_PMU_SLOTS];
+static int mmdc_pmu_active;
+
+/* the raw counters of an event, the second one in the upper half */
+static u64 mmdc_pmu_read_counters(struct perf_event *event)
+{
+	const u16 *regs = mmdc_pmu_regs[event->attr.config];
+	u64 val;
+
+	val = readl_relaxed(mmdc_base + regs[0]);
+	if (regs[1])
+		val |= (u64)readl_relaxed(mmdc_base + regs[1]) << 32;
+	return val;
+}
+
+static void mmdc_pmu_event_update(struct perf_event *event)
+{
+	struct hw_perf_event *hw = &event->hw;
+	u64 prev, now;
+
+	do {
+		prev = local64_read(&hw->prev_count);
+		now = mmdc_pmu_read_counters(event);
+	} while (local64_cmpxchg(&hw->prev_count, prev, now) != prev);
+
+	local64_add((u64)(u32)(now - prev) +
+		    (u32)((now >> 32) - (prev >> 32)), &event->count);
+}
+
+static enum hrtimer_restart mmdc_pmu_poll(struct hrtimer *timer)
+{
+	struct perf_event *event;
+	int i;
+
+	for (i = 0; i < MMDC_PMU_SLOTS; i++) {
+		event = mmdc_pmu_events[i];
+		if (event && !(event->hw.state & PERF_HES_STOPPED))
+			mmdc_pmu_event_update(event);
+	}
+
+	hrtimer_forward_now(timer, ms_to_ktime(MMDC_PMU_POLL_MS));
+	return HRTIMER_RESTART;
+}
+
+static void mmdc_pmu_event_destroy(struct perf_event *event)
+{
+	spin_lock(&mmdc_prof_lock);
+	mmdc_pmu_users--;
+	spin_unlock(&mmdc_prof_lock);
+}
+
+static int mmdc_pmu_event_init(struct perf_event *event)
+{
+	u64 filter = event->attr.config1;
+	int ret = 0;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (event->attr.exclude_user || event->attr.exclude_kernel ||
+	    event->attr.exclude_hv || event->attr.exclude_idle)
+		return -EOPNOTSUPP;
+
+	/* counted on the CPU advertised in cpumask */
+	if (event->cpu != 0)
+		return -EINVAL;
+
+	if (event->attr.config >= MMDC_EV_MAX || filter > U32_MAX)
+		return -EINVAL;
+
+	spin_lock(&mmdc_prof_lock);
+	if (mmdc_prof_sampling)
+		ret = -EBUSY;
+	else if (mmdc_pmu_users && mmdc_pmu_filter != filter)
+		ret = -EBUSY;
+	else {
+		mmdc_pmu_filter = filter;
+		mmdc_pmu_users++;
+	}
+	spin_unlock(&mmdc_prof_lock);
+	if (ret)
+		return ret;
+
+	event->destroy = mmdc_pmu_event_destroy;
+	return 0;
+}
+
+static void mmdc_pmu_event_start(struct perf_event *event, int flags)
+{
+	local64_set(&event->hw.prev_count, mmdc_pmu_read_counters(event));
+	event->hw.state = 0;
+}
+
+static void mmdc_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hw = &event->hw;
+
+	if (!(hw->state & PERF_HES_STOPPED)) {
+		mmdc_pmu_event_update(event);
+		hw->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	}
+}
+
+static int mmdc_pmu_event_add(struct perf_event *event, int flags)
+{
+	int i;
+
+	for (i = 0; i < MMDC_PMU_SLOTS; i++)
+		if (!mmdc_pmu_events[i])
+			break;
+	if (i == MMDC_PMU_SLOTS)
+		return -EAGAIN;
+
+	if (!mmdc_pmu_active++) {
+		writel_relaxed(mmdc_pmu_filter, mmdc_base + MMDC_MADPCR1);
+		writel_relaxed(BM_MMDC_MADPCR0_DBG_RST,
+			       mmdc_base + MMDC_MADPCR0);
+		writel_relaxed(BM_MMDC_MADPCR0_DBG_EN,
+			       mmdc_base + MMDC_MADPCR0);
+		hrtimer_start(&mmdc_pmu_timer, ms_to_ktime(MMDC_PMU_POLL_MS),
+			      HRTIMER_MODE_REL_PINNED);
+	}
+
+	mmdc_pmu_events[i] = event;
+	event->hw.idx = i;
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	if (flags & PERF_EF_START)
+		mmdc_pmu_event_start(event, PERF_EF_RELOAD);
+
+	return 0;
+}
+
+static void mmdc_pmu_event_del(struct perf_event *event, int flags)
+{
+	mmdc_pmu_event_stop(event, PERF_EF_UPDATE);
+	mmdc_pmu_events[event->hw.idx] = NULL;
+
+	if (!--mmdc_pmu_active) {
+		hrtimer_cancel(&mmdc_pmu_timer);
+		writel_relaxed(0, mmdc_base + MMDC_MADPCR0);
+	}
+}
+
+static void mmdc_pmu_event_read(struct perf_event *event)
+{
+	mmdc_pmu_event_update(event);
+}
+
+static ssize_t mmdc_pmu_cpumask_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "0\n");
+}
+static struct device_attribute mmdc_pmu_cpumask_attr =
+	__ATTR(cpumask, S_IRUGO, mmdc_pmu_cpumask_show, NULL);
+
+static struct attribute *mmdc_pmu_cpumask_attrs[] = {
+	&mmdc_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static struct attribute_group mmdc_pmu_cpumask_group = {
+	.attrs = mmdc_pmu_cpumask_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-7");
+PMU_FORMAT_ATTR(axi_id, "config1:0-15");
+PMU_FORMAT_ATTR(axi_id_mask, "config1:16-31");
+
+static struct attribute *mmdc_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	&format_attr_axi_id.attr,
+	&format_attr_axi_id_mask.attr,
+	NULL,
+};
+
+static struct attribute_group mmdc_pmu_format_group = {
+	.name = "format",
+	.attrs = mmdc_pmu_format_attrs,
+};
+
+PMU_EVENT_ATTR_STRING(total-cycles, mmdc_ev_total_cycles, "event=0x00");
+PMU_EVENT_ATTR_STRING(busy-cycles, mmdc_ev_busy_cycles, "event=0x01");
+PMU_EVENT_ATTR_STRING(read-accesses, mmdc_ev_read_accesses, "event=0x02");
+PMU_EVENT_ATTR_STRING(write-accesses, mmdc_ev_write_accesses, "event=0x03");
+PMU_EVENT_ATTR_STRING(read-bytes, mmdc_ev_read_bytes, "event=0x04");
+PMU_EVENT_ATTR_STRING(read-bytes.unit, mmdc_ev_read_bytes_unit, "MB");
+PMU_EVENT_ATTR_STRING(read-bytes.scale, mmdc_ev_read_bytes_scale, "0.000001");
+PMU_EVENT_ATTR_STRING(write-bytes, mmdc_ev_write_bytes, "event=0x05");
+PMU_EVENT_ATTR_STRING(write-bytes.unit, mmdc_ev_write_bytes_unit, "MB");
+PMU_EVENT_ATTR_STRING(write-bytes.scale, mmdc_ev_write_bytes_scale,
+		      "0.000001");
+PMU_EVENT_ATTR_STRING(total-bytes, mmdc_ev_total_bytes, "event=0x06");
+PMU_EVENT_ATTR_STRING(total-bytes.unit, mmdc_ev_total_bytes_unit, "MB");
+PMU_EVENT_ATTR_STRING(total-bytes.scale, mmdc_ev_total_bytes_scale,
+		      "0.000001");
+
+static struct attribute *mmdc_pmu_event_attrs[] = {
+	&mmdc_ev_total_cycles.attr.attr,
+	&mmdc_ev_busy_cycles.attr.attr,
+	&mmdc_ev_read_accesses.attr.attr,
+	&mmdc_ev_write_accesses.attr.attr,
+	&mmdc_ev_read_bytes.attr.attr,
+	&mmdc_ev_read_bytes_unit.attr.attr,
+	&mmdc_ev_read_bytes_scale.attr.attr,
+	&mmdc_ev_write_bytes.attr.attr,
+	&mmdc_ev_write_bytes_unit.attr.attr,
+	&mmdc_ev_write_bytes_scale.attr.attr,
+	&mmdc_ev_total_bytes.attr.attr,
+	&mmdc_ev_total_bytes_unit.attr.attr,
+	&mmdc_ev_total_bytes_scale.attr.attr,
+	NULL,
+};
+
+static struct attribute_group mmdc_pmu_events_group = {
+	.name = "events",
+	.attrs = mmdc_pmu_event_attrs,
+};
+
+static const struct attribute_group *mmdc_pmu_attr_groups[] = {
+	&mmdc_pmu_cpumask_group,
+	&mmdc_pmu_format_group,
+	&mmdc_pmu_events_group,
+	NULL,
+};
+
+static void mmdc_pmu_init(struct platform_device *pdev)
+{
+	int ret;
+
+	hrtimer_init(&mmdc_pmu_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	mmdc_pmu_timer.function = mmdc_pmu_poll;
+
+	mmdc_pmu = (struct pmu) {
+		.attr_groups	= mmdc_pmu_attr_groups,
+		.task_ctx_nr	= perf_invalid_context,
+		.event_init	= mmdc_pmu_event_init,
+		.add		= mmdc_pmu_event_add,
+		.del		= mmdc_pmu_event_del,
+		.start		= mmdc_pmu_event_start,
+		.stop		= mmdc_pmu_event_stop,
+		.read		= mmdc_pmu_event_read,
+	};
+
+	ret = perf_pmu_register(&mmdc_pmu, "mmdc", -1);
+	if (ret)
+		dev_warn(&pdev->dev, "failed to register perf PMU: %d\n", ret);
+}
+#endif
+
 static const struct of_device_id imx_mmdc_dt_ids[] = {
 	{ .compatible = "fsl,imx6q-mmdc", },
 	{ /* sentinel */ }
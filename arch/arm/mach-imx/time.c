@@ -33,6 +33,7 @@
 #include <linux/of_irq.h>
 
 #include <asm/mach/time.h>
+#include <asm/vdso.h>
 
 #include "common.h"
 #include "hardware.h"
@@ -83,6 +84,7 @@ static struct clock_event_device clockevent_mxc;
 static enum clock_event_mode clockevent_mode = CLOCK_EVT_MODE_UNUSED;
 
 static void __iomem *timer_base;
+static phys_addr_t timer_phys;
 
 static inline void gpt_irq_disable(void)
 {
@@ -135,7 +137,8 @@ static unsigned long imx_read_current_timer(void)
 static int __init mxc_clocksource_init(struct clk *timer_clk)
 {
 	unsigned int c = clk_get_rate(timer_clk);
-	void __iomem *reg = timer_base + (timer_is_v2() ? V2_TCN : MX1_2_TCN);
+	unsigned int tcn = timer_is_v2() ? V2_TCN : MX1_2_TCN;
+	void __iomem *reg = timer_base + tcn;
 
 	pr_info("mxc_clocksource_init %d\n", c);
 	imx_delay_timer.read_current_timer = &imx_read_current_timer;
@@ -145,6 +148,11 @@ static int __init mxc_clocksource_init(struct clk *timer_clk)
 	sched_clock_reg = reg;
 
 	sched_clock_register(mxc_read_sched_clock, 32, c);
+
+	/* let gettimeofday() and friends read the counter from user space */
+	if (timer_phys)
+		arm_vdso_set_mmio_clocksource("mxc_timer1", timer_phys + tcn);
+
 	return clocksource_mmio_init(reg, "mxc_timer1", c, 200, 32,
 			clocksource_mmio_readl_up);
 }
@@ -360,6 +368,7 @@ void __init mxc_timer_init(void __iomem *base, int irq)
 static void __init mxc_timer_init_dt(struct device_node *np)
 {
 	struct clk *clk_per, *clk_ipg;
+	struct resource res;
 	int irq;
 
 	if (timer_base)
@@ -367,6 +376,8 @@ static void __init mxc_timer_init_dt(struct device_node *np)
 
 	timer_base = of_iomap(np, 0);
 	WARN_ON(!timer_base);
+	if (!of_address_to_resource(np, 0, &res))
+		timer_phys = res.start;
 	irq = irq_of_parse_and_map(np, 0);
 
 	clk_ipg = of_clk_get_by_name(np, "ipg");
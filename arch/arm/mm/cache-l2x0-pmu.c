@@ -0,0 +1,308 @@
+/*
+ * arch/arm/mm/cache-l2x0-pmu.c - L310 event counter perf PMU
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The L310 has two 32-bit event counters, each of which can count one
+ * of the events below.  They are exposed as the "l2c_310" uncore PMU,
+ * e.g.
+ *
+ *   perf stat -a -e l2c_310/drreq/,l2c_310/drhit/ ...
+ *
+ * The counter overflow interrupt is folded into the combined L2
+ * interrupt, which most platforms do not even wire up, so the counters
+ * are read from a timer instead: even counting every cycle of a fast
+ * L2 clock they take several seconds to wrap.
+ */
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/perf_event.h>
+#include <linux/spinlock.h>
+
+#include <asm/hardware/cache-l2x0.h>
+
+#define L2X0_EVENT_CNT_CTRL_ENABLE	BIT(0)
+#define L2X0_EVENT_CNT_CTRL_RESET	(BIT(1) | BIT(2))
+#define L2X0_EVENT_CNT_CFG_SRC_SHIFT	2
+
+#define L2X0_PMU_COUNTERS	2
+#define L2X0_PMU_EVENT_MAX	0xf
+#define L2X0_PMU_POLL_MS	1000
+
+static void __iomem *l2x0_pmu_base;
+
+static struct pmu l2x0_pmu;
+static struct hrtimer l2x0_pmu_timer;
+static struct perf_event *l2x0_pmu_events[L2X0_PMU_COUNTERS];
+static int l2x0_pmu_active;
+static DEFINE_RAW_SPINLOCK(l2x0_pmu_lock);
+
+/* counter 1 sits one word below counter 0 for both registers */
+static inline void __iomem *l2x0_pmu_cfg(int idx)
+{
+	return l2x0_pmu_base + L2X0_EVENT_CNT0_CFG - 4 * idx;
+}
+
+static inline u32 l2x0_pmu_read_counter(int idx)
+{
+	return readl_relaxed(l2x0_pmu_base + L2X0_EVENT_CNT0_VAL - 4 * idx);
+}
+
+static void l2x0_pmu_event_update(struct perf_event *event)
+{
+	struct hw_perf_event *hw = &event->hw;
+	u64 prev, now;
+
+	do {
+		prev = local64_read(&hw->prev_count);
+		now = l2x0_pmu_read_counter(hw->idx);
+	} while (local64_cmpxchg(&hw->prev_count, prev, now) != prev);
+
+	local64_add((u32)(now - prev), &event->count);
+}
+
+static enum hrtimer_restart l2x0_pmu_poll(struct hrtimer *timer)
+{
+	struct perf_event *event;
+	int i;
+
+	for (i = 0; i < L2X0_PMU_COUNTERS; i++) {
+		event = l2x0_pmu_events[i];
+		if (event && !(event->hw.state & PERF_HES_STOPPED))
+			l2x0_pmu_event_update(event);
+	}
+
+	hrtimer_forward_now(timer, ms_to_ktime(L2X0_PMU_POLL_MS));
+	return HRTIMER_RESTART;
+}
+
+static int l2x0_pmu_event_init(struct perf_event *event)
+{
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (event->attr.exclude_user || event->attr.exclude_kernel ||
+	    event->attr.exclude_hv || event->attr.exclude_idle)
+		return -EOPNOTSUPP;
+
+	/* counted on the CPU advertised in cpumask */
+	if (event->cpu != 0)
+		return -EINVAL;
+
+	if (!event->attr.config || event->attr.config > L2X0_PMU_EVENT_MAX)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void l2x0_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hw = &event->hw;
+
+	local64_set(&hw->prev_count, l2x0_pmu_read_counter(hw->idx));
+	hw->state = 0;
+}
+
+static void l2x0_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hw = &event->hw;
+
+	if (!(hw->state & PERF_HES_STOPPED)) {
+		l2x0_pmu_event_update(event);
+		hw->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	}
+}
+
+static int l2x0_pmu_event_add(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hw = &event->hw;
+	unsigned long irqflags;
+	int i;
+
+	for (i = 0; i < L2X0_PMU_COUNTERS; i++)
+		if (!l2x0_pmu_events[i])
+			break;
+	if (i == L2X0_PMU_COUNTERS)
+		return -EAGAIN;
+
+	l2x0_pmu_events[i] = event;
+	hw->idx = i;
+	hw->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	/*
+	 * Counters are only reset when the first event comes in: each event
+	 * starts from whatever its counter holds, so the other one can keep
+	 * running undisturbed.
+	 */
+	raw_spin_lock_irqsave(&l2x0_pmu_lock, irqflags);
+	writel_relaxed(event->attr.config << L2X0_EVENT_CNT_CFG_SRC_SHIFT,
+		       l2x0_pmu_cfg(i));
+	if (!l2x0_pmu_active++) {
+		writel_relaxed(L2X0_EVENT_CNT_CTRL_RESET,
+			       l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+		writel_relaxed(L2X0_EVENT_CNT_CTRL_ENABLE,
+			       l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+		hrtimer_start(&l2x0_pmu_timer, ms_to_ktime(L2X0_PMU_POLL_MS),
+			      HRTIMER_MODE_REL_PINNED);
+	}
+	raw_spin_unlock_irqrestore(&l2x0_pmu_lock, irqflags);
+
+	if (flags & PERF_EF_START)
+		l2x0_pmu_event_start(event, PERF_EF_RELOAD);
+
+	return 0;
+}
+
+static void l2x0_pmu_event_del(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hw = &event->hw;
+	unsigned long irqflags;
+	bool last;
+
+	l2x0_pmu_event_stop(event, PERF_EF_UPDATE);
+	l2x0_pmu_events[hw->idx] = NULL;
+
+	raw_spin_lock_irqsave(&l2x0_pmu_lock, irqflags);
+	writel_relaxed(0, l2x0_pmu_cfg(hw->idx));
+	last = !--l2x0_pmu_active;
+	if (last)
+		writel_relaxed(0, l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+	raw_spin_unlock_irqrestore(&l2x0_pmu_lock, irqflags);
+
+	if (last)
+		hrtimer_cancel(&l2x0_pmu_timer);
+}
+
+static void l2x0_pmu_event_read(struct perf_event *event)
+{
+	l2x0_pmu_event_update(event);
+}
+
+static ssize_t l2x0_pmu_cpumask_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "0\n");
+}
+static struct device_attribute l2x0_pmu_cpumask_attr =
+	__ATTR(cpumask, S_IRUGO, l2x0_pmu_cpumask_show, NULL);
+
+static struct attribute *l2x0_pmu_cpumask_attrs[] = {
+	&l2x0_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static struct attribute_group l2x0_pmu_cpumask_group = {
+	.attrs = l2x0_pmu_cpumask_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-3");
+
+static struct attribute *l2x0_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	NULL,
+};
+
+static struct attribute_group l2x0_pmu_format_group = {
+	.name = "format",
+	.attrs = l2x0_pmu_format_attrs,
+};
+
+#define L2X0_PMU_EVENT_ATTR(_name, _config)				\
+	PMU_EVENT_ATTR_STRING(_name, l2x0_ev_##_name, "event=" #_config)
+
+L2X0_PMU_EVENT_ATTR(co, 0x1);
+L2X0_PMU_EVENT_ATTR(drhit, 0x2);
+L2X0_PMU_EVENT_ATTR(drreq, 0x3);
+L2X0_PMU_EVENT_ATTR(dwhit, 0x4);
+L2X0_PMU_EVENT_ATTR(dwreq, 0x5);
+L2X0_PMU_EVENT_ATTR(dwtreq, 0x6);
+L2X0_PMU_EVENT_ATTR(irhit, 0x7);
+L2X0_PMU_EVENT_ATTR(irreq, 0x8);
+L2X0_PMU_EVENT_ATTR(wa, 0x9);
+L2X0_PMU_EVENT_ATTR(ipfalloc, 0xa);
+L2X0_PMU_EVENT_ATTR(epfhit, 0xb);
+L2X0_PMU_EVENT_ATTR(epfalloc, 0xc);
+L2X0_PMU_EVENT_ATTR(srrcvd, 0xd);
+L2X0_PMU_EVENT_ATTR(srconf, 0xe);
+L2X0_PMU_EVENT_ATTR(epfrcvd, 0xf);
+
+static struct attribute *l2x0_pmu_event_attrs[] = {
+	&l2x0_ev_co.attr.attr,
+	&l2x0_ev_drhit.attr.attr,
+	&l2x0_ev_drreq.attr.attr,
+	&l2x0_ev_dwhit.attr.attr,
+	&l2x0_ev_dwreq.attr.attr,
+	&l2x0_ev_dwtreq.attr.attr,
+	&l2x0_ev_irhit.attr.attr,
+	&l2x0_ev_irreq.attr.attr,
+	&l2x0_ev_wa.attr.attr,
+	&l2x0_ev_ipfalloc.attr.attr,
+	&l2x0_ev_epfhit.attr.attr,
+	&l2x0_ev_epfalloc.attr.attr,
+	&l2x0_ev_srrcvd.attr.attr,
+	&l2x0_ev_srconf.attr.attr,
+	&l2x0_ev_epfrcvd.attr.attr,
+	NULL,
+};
+
+static struct attribute_group l2x0_pmu_events_group = {
+	.name = "events",
+	.attrs = l2x0_pmu_event_attrs,
+};
+
+static const struct attribute_group *l2x0_pmu_attr_groups[] = {
+	&l2x0_pmu_cpumask_group,
+	&l2x0_pmu_format_group,
+	&l2x0_pmu_events_group,
+	NULL,
+};
+
+/*
+ * Called from the L2 cache setup, which runs long before perf itself is
+ * initialised: only remember the controller here.
+ */
+void __init l2x0_pmu_register(void __iomem *base, u32 part)
+{
+	if (part == L2X0_CACHE_ID_PART_L310)
+		l2x0_pmu_base = base;
+}
+
+static int __init l2x0_pmu_init(void)
+{
+	int ret;
+
+	if (!l2x0_pmu_base)
+		return 0;
+
+	/* the counters may have been left running by the boot loader */
+	writel_relaxed(0, l2x0_pmu_base + L2X0_EVENT_CNT_CTRL);
+	writel_relaxed(0, l2x0_pmu_cfg(0));
+	writel_relaxed(0, l2x0_pmu_cfg(1));
+
+	hrtimer_init(&l2x0_pmu_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	l2x0_pmu_timer.function = l2x0_pmu_poll;
+
+	l2x0_pmu = (struct pmu) {
+		.attr_groups	= l2x0_pmu_attr_groups,
+		.task_ctx_nr	= perf_invalid_context,
+		.event_init	= l2x0_pmu_event_init,
+		.add		= l2x0_pmu_event_add,
+		.del		= l2x0_pmu_event_del,
+		.start		= l2x0_pmu_event_start,
+		.stop		= l2x0_pmu_event_stop,
+		.read		= l2x0_pmu_event_read,
+	};
+
+	ret = perf_pmu_register(&l2x0_pmu, "l2c_310", -1);
+	if (ret)
+		pr_warn("L2C-310: failed to register perf PMU: %d\n", ret);
+	return ret;
+}
+device_initcall(l2x0_pmu_init);
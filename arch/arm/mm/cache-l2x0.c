@@ -19,12 +19,14 @@
 #include <linux/cpu.h>
 #include <linux/err.h>
 #include <linux/init.h>
+#include <linux/kobject.h>
 #include <linux/smp.h>
 #include <linux/spinlock.h>
 #include <linux/log2.h>
 #include <linux/io.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
+#include <linux/sysfs.h>
 
 #include <asm/cacheflush.h>
 #include <asm/cp15.h>
@@ -52,6 +54,7 @@ static const struct l2c_init_data *l2x0_data;
 static DEFINE_RAW_SPINLOCK(l2x0_lock);
 static u32 l2x0_way_mask;	/* Bitmask of active ways */
 static u32 l2x0_size;
+static u32 l2x0_cache_id;
 static unsigned long sync_reg_offset = L2X0_CACHE_SYNC;
 
 struct l2x0_regs l2x0_saved_regs;
@@ -876,6 +879,9 @@ static int __init __l2c_init(const struct l2c_init_data *data,
 	pr_info("%s: CACHE_ID 0x%08x, AUX_CTRL 0x%08x\n",
 		data->type, cache_id, aux);
 
+	l2x0_cache_id = cache_id;
+	l2x0_pmu_register(l2x0_base, cache_id & L2X0_CACHE_ID_PART_MASK);
+
 	return 0;
 }
 
@@ -1703,3 +1709,123 @@ int __init l2x0_of_init(u32 aux_val, u32 aux_mask)
 	return __l2c_init(data, aux_val, aux_mask, cache_id);
 }
 #endif
+
+#ifdef CONFIG_SYSFS
+/*
+ * Runtime tuning of the L310 prefetch engine under /sys/kernel/l2c310/.
+ * The auxiliary control and RAM latency registers can only be written
+ * while the cache is disabled, so they are shown read-only; the prefetch
+ * control register may change at any time.  New values also go to
+ * l2x0_saved_regs, from where l2c310_configure() restores them on resume.
+ */
+struct l2c310_prefetch_attr {
+	struct kobj_attribute attr;
+	u32 mask;
+};
+
+static ssize_t l2c310_prefetch_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	struct l2c310_prefetch_attr *pa =
+		container_of(attr, struct l2c310_prefetch_attr, attr);
+	u32 val = readl_relaxed(l2x0_base + L310_PREFETCH_CTRL);
+
+	return sprintf(buf, "%u\n", (val & pa->mask) >> __ffs(pa->mask));
+}
+
+static ssize_t l2c310_prefetch_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct l2c310_prefetch_attr *pa =
+		container_of(attr, struct l2c310_prefetch_attr, attr);
+	unsigned revision = l2x0_cache_id & L2X0_CACHE_ID_RTL_MASK;
+	unsigned long flags;
+	u32 val;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &val);
+	if (ret)
+		return ret;
+	if (val > pa->mask >> __ffs(pa->mask))
+		return -EINVAL;
+
+	/* see the 752271 workaround in l2c310_fixup() */
+	if (val && (pa->mask & (L310_PREFETCH_CTRL_DBL_LINEFILL |
+				L310_PREFETCH_CTRL_DBL_LINEFILL_INCR)) &&
+	    revision >= L310_CACHE_ID_RTL_R3P0 &&
+	    revision < L310_CACHE_ID_RTL_R3P2)
+		return -EINVAL;
+
+	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	val = (readl_relaxed(l2x0_base + L310_PREFETCH_CTRL) & ~pa->mask) |
+	      (val << __ffs(pa->mask));
+	l2c_write_sec(val, l2x0_base, L310_PREFETCH_CTRL);
+	l2x0_saved_regs.prefetch_ctrl = val;
+	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+
+	return count;
+}
+
+#define L310_PREFETCH_ATTR(_name, _mask)				\
+static struct l2c310_prefetch_attr l2c310_attr_##_name = {		\
+	.attr	= __ATTR(_name, S_IRUGO | S_IWUSR, l2c310_prefetch_show,	\
+			 l2c310_prefetch_store),			\
+	.mask	= _mask,						\
+}
+
+L310_PREFETCH_ATTR(prefetch_offset, L310_PREFETCH_CTRL_OFFSET_MASK);
+L310_PREFETCH_ATTR(double_linefill, L310_PREFETCH_CTRL_DBL_LINEFILL);
+L310_PREFETCH_ATTR(double_linefill_incr, L310_PREFETCH_CTRL_DBL_LINEFILL_INCR);
+L310_PREFETCH_ATTR(double_linefill_wrap, L310_PREFETCH_CTRL_DBL_LINEFILL_WRAP);
+L310_PREFETCH_ATTR(prefetch_drop, L310_PREFETCH_CTRL_PREFETCH_DROP);
+L310_PREFETCH_ATTR(data_prefetch, L310_PREFETCH_CTRL_DATA_PREFETCH);
+L310_PREFETCH_ATTR(instr_prefetch, L310_PREFETCH_CTRL_INSTR_PREFETCH);
+
+static ssize_t l2c310_regs_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "aux_ctrl 0x%08x\ntag_latency 0x%08x\n"
+		       "data_latency 0x%08x\n",
+		       readl_relaxed(l2x0_base + L2X0_AUX_CTRL),
+		       readl_relaxed(l2x0_base + L310_TAG_LATENCY_CTRL),
+		       readl_relaxed(l2x0_base + L310_DATA_LATENCY_CTRL));
+}
+static struct kobj_attribute l2c310_attr_regs =
+	__ATTR(regs, S_IRUGO, l2c310_regs_show, NULL);
+
+static struct attribute *l2c310_attrs[] = {
+	&l2c310_attr_prefetch_offset.attr.attr,
+	&l2c310_attr_double_linefill.attr.attr,
+	&l2c310_attr_double_linefill_incr.attr.attr,
+	&l2c310_attr_double_linefill_wrap.attr.attr,
+	&l2c310_attr_prefetch_drop.attr.attr,
+	&l2c310_attr_data_prefetch.attr.attr,
+	&l2c310_attr_instr_prefetch.attr.attr,
+	&l2c310_attr_regs.attr,
+	NULL,
+};
+
+static const struct attribute_group l2c310_attr_group = {
+	.attrs = l2c310_attrs,
+};
+
+static int __init l2c310_sysfs_init(void)
+{
+	struct kobject *kobj;
+
+	/* the prefetch control register first appeared in r2p0 */
+	if (!l2x0_base ||
+	    (l2x0_cache_id & L2X0_CACHE_ID_PART_MASK) !=
+	    L2X0_CACHE_ID_PART_L310 ||
+	    (l2x0_cache_id & L2X0_CACHE_ID_RTL_MASK) < L310_CACHE_ID_RTL_R2P0)
+		return 0;
+
+	kobj = kobject_create_and_add("l2c310", kernel_kobj);
+	if (!kobj)
+		return -ENOMEM;
+
+	return sysfs_create_group(kobj, &l2c310_attr_group);
+}
+late_initcall(l2c310_sysfs_init);
+#endif
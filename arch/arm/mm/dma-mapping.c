@@ -17,6 +17,7 @@
 #include <linux/errno.h>
 #include <linux/list.h>
 #include <linux/init.h>
+#include <linux/moduleparam.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-contiguous.h>
@@ -826,6 +827,28 @@ static void dma_cache_maint_page(struct page *page, unsigned long offset,
 	} while (left);
 }
 
+/*
+ * Cleaning a large buffer line by line costs more than cleaning the
+ * whole cache by set/way.  That is only an option with a single CPU,
+ * since set/way operations are not broadcast, and without an outer
+ * cache, whose range operations would still be needed.  0 disables it.
+ */
+static unsigned int dma_cache_all_threshold = SZ_1M;
+core_param(dma_cache_all_threshold, dma_cache_all_threshold, uint, 0644);
+
+static bool dma_cache_all_ok(size_t size)
+{
+	if (!dma_cache_all_threshold || size < dma_cache_all_threshold)
+		return false;
+	if (num_possible_cpus() != 1)
+		return false;
+#ifdef CONFIG_OUTER_CACHE
+	if (outer_cache.clean_range)
+		return false;
+#endif
+	return true;
+}
+
 /*
  * Make an area consistent for devices.
  * Note: Drivers should NOT use this function directly, as it will break
@@ -837,7 +860,13 @@ static void __dma_page_cpu_to_dev(struct page *page, unsigned long off,
 {
 	phys_addr_t paddr;
 
-	dma_cache_maint_page(page, off, size, dir, dmac_map_area);
+	/* descriptors and small transfers: one lowmem range, no walk */
+	if (off + size <= PAGE_SIZE && !PageHighMem(page))
+		dmac_map_area(page_address(page) + off, size, dir);
+	else if (dma_cache_all_ok(size))
+		flush_cache_all();
+	else
+		dma_cache_maint_page(page, off, size, dir, dmac_map_area);
 
 	paddr = page_to_phys(page) + off;
 	if (dir == DMA_FROM_DEVICE) {
@@ -858,7 +887,11 @@ static void __dma_page_dev_to_cpu(struct page *page, unsigned long off,
 	if (dir != DMA_TO_DEVICE) {
 		outer_inv_range(paddr, paddr + size);
 
-		dma_cache_maint_page(page, off, size, dir, dmac_unmap_area);
+		if (off + size <= PAGE_SIZE && !PageHighMem(page))
+			dmac_unmap_area(page_address(page) + off, size, dir);
+		else
+			dma_cache_maint_page(page, off, size, dir,
+					     dmac_unmap_area);
 	}
 
 	/*
@@ -0,0 +1,137 @@
+/*
+ * arch/arm/mm/largepage.c
+ *
+ * 64K large page mappings for user memory with the short descriptor
+ * page table format.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A large page is described by 16 consecutive hardware PTEs holding the
+ * same descriptor.  Only the hardware half of the page table is changed
+ * on promotion: the Linux PTEs keep describing 4K pages, so the core VM
+ * never has to know about the larger mapping.  The price is that every
+ * update of one of the Linux PTEs has to split the block first, which
+ * set_pte_at() and pte_clear() do through pte_large_split().
+ */
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/vmstat.h>
+
+#include <asm/cacheflush.h>
+#include <asm/pgtable.h>
+#include <asm/tlbflush.h>
+
+/* bits carried over unchanged from the small page descriptor */
+#define PTE_LARGE_ATTR_MASK	(PTE_BUFFERABLE | PTE_CACHEABLE | \
+				 PTE_EXT_AP_MASK | PTE_EXT_APX | \
+				 PTE_EXT_SHARED | PTE_EXT_NG)
+
+static atomic_long_t large_ptes = ATOMIC_LONG_INIT(0);
+
+static inline pte_t *large_pte_first(pte_t *ptep)
+{
+	return (pte_t *)((unsigned long)ptep &
+			 ~(LARGE_PTE_NR * sizeof(pte_t) - 1));
+}
+
+static pteval_t small_to_large(pteval_t hw)
+{
+	return (hw & PAGE_MASK) | (hw & PTE_LARGE_ATTR_MASK) |
+	       ((hw & PTE_EXT_TEX(7)) << 6) |
+	       ((hw & PTE_EXT_XN) ? PTE_LARGE_XN : 0) |
+	       PTE_TYPE_LARGE;
+}
+
+/*
+ * Turn a large page back into small pages, break before make like the
+ * promotion below: all 16 hardware entries are cleared and the block is
+ * flushed from the TLB before any small page entry is written.  The
+ * Linux PTEs are made old, which lets set_pte_ext() install an empty
+ * hardware entry; the next access refaults and re-establishes the small
+ * page through handle_pte_fault().
+ */
+void __pte_large_split(struct mm_struct *mm, unsigned long addr,
+		       pte_t *ptep)
+{
+	/* flush_tlb_range() only looks at vm_mm, and VM_EXEC on some CPUs */
+	struct vm_area_struct vma = { .vm_mm = mm, .vm_flags = VM_EXEC };
+	unsigned long start = addr & LARGE_PTE_MASK;
+	pte_t *first = large_pte_first(ptep);
+	pte_t *hwpte = first + PTE_HWTABLE_PTRS;
+	int i;
+
+	for (i = 0; i < LARGE_PTE_NR; i++)
+		hwpte[i] = __pte(0);
+	clean_dcache_area(hwpte, LARGE_PTE_NR * sizeof(pte_t));
+	flush_tlb_range(&vma, start, start + LARGE_PTE_SIZE);
+
+	for (i = 0; i < LARGE_PTE_NR; i++)
+		set_pte_ext(first + i, pte_mkold(first[i]), 0);
+
+	atomic_long_dec(&large_ptes);
+	count_vm_event(LARGE_PTE_SPLIT);
+}
+
+/*
+ * Called after a user PTE has been established.  If that completed a
+ * naturally aligned block of present, young and physically contiguous
+ * pages whose hardware entries only differ in the address, replace the
+ * 16 small descriptors with one large page.
+ */
+void update_mmu_cache_large(struct vm_area_struct *vma, unsigned long addr,
+			    pte_t *ptep)
+{
+	unsigned long start = addr & LARGE_PTE_MASK;
+	pte_t *first = large_pte_first(ptep);
+	pte_t *hwpte = first + PTE_HWTABLE_PTRS;
+	unsigned long pfn;
+	pteval_t hw;
+	int i;
+
+	if (!(vma->vm_flags & VM_HUGEPAGE) || (vma->vm_flags & VM_SPECIAL))
+		return;
+	if (start < vma->vm_start || start + LARGE_PTE_SIZE > vma->vm_end)
+		return;
+
+	/* small page descriptors have bit 1 set, bit 0 is XN */
+	hw = pte_val(hwpte[0]);
+	if (!(hw & PTE_TYPE_SMALL))
+		return;
+
+	pfn = pte_pfn(first[0]);
+	if (pfn & (LARGE_PTE_NR - 1))
+		return;
+
+	for (i = 0; i < LARGE_PTE_NR; i++) {
+		if (!pte_valid_user(first[i]) || pte_pfn(first[i]) != pfn + i)
+			return;
+		if (pte_val(hwpte[i]) != hw + (i << PAGE_SHIFT))
+			return;
+	}
+
+	/*
+	 * Break before make: the small and large translations must never
+	 * be visible to the table walker at the same time.
+	 */
+	for (i = 0; i < LARGE_PTE_NR; i++)
+		hwpte[i] = __pte(0);
+	clean_dcache_area(hwpte, LARGE_PTE_NR * sizeof(pte_t));
+	flush_tlb_range(vma, start, start + LARGE_PTE_SIZE);
+
+	hw = small_to_large(hw);
+	for (i = 0; i < LARGE_PTE_NR; i++)
+		hwpte[i] = __pte(hw);
+	clean_dcache_area(hwpte, LARGE_PTE_NR * sizeof(pte_t));
+
+	atomic_long_inc(&large_ptes);
+	count_vm_event(LARGE_PTE_PROMOTE);
+}
+
+void arch_report_meminfo(struct seq_file *m)
+{
+	seq_printf(m, "LargePtes:      %8lu kB\n",
+		   atomic_long_read(&large_ptes) << (LARGE_PTE_ORDER +
+						     PAGE_SHIFT - 10));
+}
@@ -12,6 +12,8 @@
 #include <linux/wait.h>
 #include <linux/uprobes.h>
 #include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
 
 #include "../decode.h"
 #include "../decode-arm.h"
@@ -104,6 +106,72 @@ static void uprobe_write_pc(struct arch_uprobe *auprobe,
 	regs->uregs[pcreg] = autask->backup;
 }
 
+/*
+ * Most probes sit on function entry, so the usual prologue instructions
+ * are simulated rather than stepped out of line, which saves the second
+ * trap: "push {...}", "str rt, [sp, #-imm]!", "sub sp, sp, #imm",
+ * "add rd, sp, #imm" and "mov rd, sp".  The stores run in the context of
+ * the probed task from uprobe_notify_resume(), so they may fault in the
+ * stack; a store that cannot be done raises SIGSEGV on the instruction
+ * as it would have done natively.
+ */
+static void uprobe_simulate_fault(struct pt_regs *regs)
+{
+	regs->ARM_pc -= 4;
+	force_sig(SIGSEGV, current);
+}
+
+static void uprobe_simulate_push(probes_opcode_t insn,
+		struct arch_probes_insn *asi, struct pt_regs *regs)
+{
+	unsigned long reglist = insn & 0xffff;
+	unsigned long sp;
+	u32 vals[15];
+	int i, n = 0;
+
+	for (i = 0; i < 15; i++)
+		if (reglist & (1 << i))
+			vals[n++] = regs->uregs[i];
+
+	sp = regs->ARM_sp - 4 * n;
+	if (copy_to_user((void __user *)sp, vals, 4 * n)) {
+		uprobe_simulate_fault(regs);
+		return;
+	}
+	regs->ARM_sp = sp;
+}
+
+static void uprobe_simulate_str_sp_wb(probes_opcode_t insn,
+		struct arch_probes_insn *asi, struct pt_regs *regs)
+{
+	int rt = (insn >> 12) & 0xf;
+	unsigned long addr = regs->ARM_sp - (insn & 0xfff);
+
+	if (put_user(regs->uregs[rt], (u32 __user *)addr)) {
+		uprobe_simulate_fault(regs);
+		return;
+	}
+	regs->ARM_sp = addr;
+}
+
+static void uprobe_simulate_addsub_sp(probes_opcode_t insn,
+		struct arch_probes_insn *asi, struct pt_regs *regs)
+{
+	int rd = (insn >> 12) & 0xf;
+	u32 imm = ror32(insn & 0xff, 2 * ((insn >> 8) & 0xf));
+
+	if (insn & (1 << 23))
+		regs->uregs[rd] = regs->ARM_sp + imm;
+	else
+		regs->uregs[rd] = regs->ARM_sp - imm;
+}
+
+static void uprobe_simulate_mov_sp(probes_opcode_t insn,
+		struct arch_probes_insn *asi, struct pt_regs *regs)
+{
+	regs->uregs[(insn >> 12) & 0xf] = regs->ARM_sp;
+}
+
 enum probes_insn
 decode_pc_ro(probes_opcode_t insn, struct arch_probes_insn *asi,
 	     const struct decode_header *d)
@@ -158,6 +226,51 @@ decode_ldr(probes_opcode_t insn, struct arch_probes_insn *asi,
 	return decode_wb_pc(insn, asi, d, false);
 }
 
+static enum probes_insn
+uprobe_decode_dp_imm(probes_opcode_t insn, struct arch_probes_insn *asi,
+		     const struct decode_header *d)
+{
+	/* SUB/ADD rd, sp, #imm	cccc 0010 0100 1101 xxxx xxxx xxxx xxxx */
+	/*			cccc 0010 1000 1101 xxxx xxxx xxxx xxxx */
+	if (((insn & 0x0fff0000) == 0x024d0000 ||
+	     (insn & 0x0fff0000) == 0x028d0000) &&
+	    ((insn >> 12) & 0xf) != 15) {
+		asi->insn_handler = uprobe_simulate_addsub_sp;
+		return INSN_GOOD_NO_SLOT;
+	}
+
+	return decode_rd12rn16rm0rs8_rwflags(insn, asi, d);
+}
+
+static enum probes_insn
+uprobe_decode_dp_reg(probes_opcode_t insn, struct arch_probes_insn *asi,
+		     const struct decode_header *d)
+{
+	/* MOV rd, sp		cccc 0001 1010 0000 xxxx 0000 0000 1101 */
+	if ((insn & 0x0fff0fff) == 0x01a0000d &&
+	    ((insn >> 12) & 0xf) != 15) {
+		asi->insn_handler = uprobe_simulate_mov_sp;
+		return INSN_GOOD_NO_SLOT;
+	}
+
+	return decode_rd12rn16rm0rs8_rwflags(insn, asi, d);
+}
+
+static enum probes_insn
+uprobe_decode_store(probes_opcode_t insn, struct arch_probes_insn *asi,
+		    const struct decode_header *d)
+{
+	int rt = (insn >> 12) & 0xf;
+
+	/* STR rt, [sp, #-imm]!	cccc 0101 0010 1101 xxxx xxxx xxxx xxxx */
+	if ((insn & 0x0fff0000) == 0x052d0000 && rt != 13 && rt != 15) {
+		asi->insn_handler = uprobe_simulate_str_sp_wb;
+		return INSN_GOOD_NO_SLOT;
+	}
+
+	return decode_pc_ro(insn, asi, d);
+}
+
 enum probes_insn
 uprobe_decode_ldmstm(probes_opcode_t insn,
 		     struct arch_probes_insn *asi,
@@ -173,6 +286,13 @@ uprobe_decode_ldmstm(probes_opcode_t insn,
 	if (rn == 15)
 		return INSN_REJECTED;
 
+	/* PUSH (STMDB sp!)	cccc 1001 0010 1101 xxxx xxxx xxxx xxxx */
+	if ((insn & 0x0fff0000) == 0x092d0000 && reglist &&
+	    !(reglist & (1 << 15))) {
+		asi->insn_handler = uprobe_simulate_push;
+		return INSN_GOOD_NO_SLOT;
+	}
+
 	if (!(used & (1 << 15)))
 		return INSN_GOOD;
 
@@ -209,12 +329,12 @@ const union decode_action uprobes_probes_actions[] = {
 	[PROBES_LOAD_EXTRA] = {.decoder = decode_pc_ro},
 	[PROBES_LOAD] = {.decoder = decode_ldr},
 	[PROBES_STORE_EXTRA] = {.decoder = decode_pc_ro},
-	[PROBES_STORE] = {.decoder = decode_pc_ro},
+	[PROBES_STORE] = {.decoder = uprobe_decode_store},
 	[PROBES_MOV_IP_SP] = {.handler = simulate_mov_ipsp},
 	[PROBES_DATA_PROCESSING_REG] = {
-		.decoder = decode_rd12rn16rm0rs8_rwflags},
+		.decoder = uprobe_decode_dp_reg},
 	[PROBES_DATA_PROCESSING_IMM] = {
-		.decoder = decode_rd12rn16rm0rs8_rwflags},
+		.decoder = uprobe_decode_dp_imm},
 	[PROBES_MOV_HALFWORD] = {.handler = probes_simulate_nop},
 	[PROBES_SEV] = {.handler = probes_simulate_nop},
 	[PROBES_WFE] = {.handler = probes_simulate_nop},
@@ -115,7 +115,21 @@ static notrace int do_monotonic_coarse(struct timespec *ts,
 	return 0;
 }
 
+static notrace u64 get_cycles_now(struct vdso_data *vdata)
+{
+	const volatile u32 *counter;
+
+	if (vdata->clock_mode == VDSO_CLOCK_MMIO) {
+		counter = (void *)vdata - PAGE_SIZE + vdata->mmio_offset;
+		return *counter;
+	}
+
 #ifdef CONFIG_ARM_ARCH_TIMER
+	return arch_counter_get_cntvct();
+#else
+	return 0;
+#endif
+}
 
 static notrace u64 get_ns(struct vdso_data *vdata)
 {
@@ -123,7 +137,7 @@ static notrace u64 get_ns(struct vdso_data *vdata)
 	u64 cycle_now;
 	u64 nsec;
 
-	cycle_now = arch_counter_get_cntvct();
+	cycle_now = get_cycles_now(vdata);
 
 	cycle_delta = (cycle_now - vdata->cs_cycle_last) & vdata->cs_mask;
 
@@ -141,7 +155,7 @@ static notrace int do_realtime(struct timespec *ts, struct vdso_data *vdata)
 	do {
 		seq = vdso_read_begin(vdata);
 
-		if (!vdata->tk_is_cntvct)
+		if (vdata->clock_mode == VDSO_CLOCK_NONE)
 			return -1;
 
 		ts->tv_sec = vdata->xtime_clock_sec;
@@ -164,7 +178,7 @@ static notrace int do_monotonic(struct timespec *ts, struct vdso_data *vdata)
 	do {
 		seq = vdso_read_begin(vdata);
 
-		if (!vdata->tk_is_cntvct)
+		if (vdata->clock_mode == VDSO_CLOCK_NONE)
 			return -1;
 
 		ts->tv_sec = vdata->xtime_clock_sec;
@@ -182,19 +196,35 @@ static notrace int do_monotonic(struct timespec *ts, struct vdso_data *vdata)
 	return 0;
 }
 
-#else /* CONFIG_ARM_ARCH_TIMER */
-
-static notrace int do_realtime(struct timespec *ts, struct vdso_data *vdata)
+static notrace int do_monotonic_raw(struct timespec *ts,
+				    struct vdso_data *vdata)
 {
-	return -1;
-}
+	u64 cycle_delta;
+	u64 nsecs;
+	u32 seq;
 
-static notrace int do_monotonic(struct timespec *ts, struct vdso_data *vdata)
-{
-	return -1;
-}
+	do {
+		seq = vdso_read_begin(vdata);
+
+		if (vdata->clock_mode == VDSO_CLOCK_NONE)
+			return -1;
+
+		cycle_delta = (get_cycles_now(vdata) - vdata->cs_cycle_last) &
+			      vdata->cs_mask;
+		nsecs = cycle_delta * vdata->cs_raw_mult +
+			vdata->raw_clock_snsec;
+		nsecs >>= vdata->cs_shift;
 
-#endif /* CONFIG_ARM_ARCH_TIMER */
+		ts->tv_sec = vdata->raw_time_sec;
+		nsecs += vdata->raw_time_nsec;
+
+	} while (vdso_read_retry(vdata, seq));
+
+	ts->tv_nsec = 0;
+	timespec_add_ns(ts, nsecs);
+
+	return 0;
+}
 
 notrace int __vdso_clock_gettime(clockid_t clkid, struct timespec *ts)
 {
@@ -216,6 +246,9 @@ notrace int __vdso_clock_gettime(clockid_t clkid, struct timespec *ts)
 	case CLOCK_MONOTONIC:
 		ret = do_monotonic(ts, vdata);
 		break;
+	case CLOCK_MONOTONIC_RAW:
+		ret = do_monotonic_raw(ts, vdata);
+		break;
 	default:
 		break;
 	}
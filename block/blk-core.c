@@ -31,6 +31,7 @@
 #include <linux/list_sort.h>
 #include <linux/delay.h>
 #include <linux/ratelimit.h>
+#include <linux/sizes.h>
 #include <linux/pm_runtime.h>
 
 #define CREATE_TRACE_POINTS
@@ -110,6 +111,7 @@ void blk_rq_init(struct request_queue *q, struct request *rq)
 	rq->tag = -1;
 	rq->start_time = jiffies;
 	set_start_time_ns(rq);
+	blk_lat_hist_queued(rq);
 	rq->part = NULL;
 }
 EXPORT_SYMBOL(blk_rq_init);
@@ -2153,8 +2155,53 @@ void blk_account_io_completion(struct request *req, unsigned int bytes)
 	}
 }
 
+#ifdef CONFIG_BLK_DEV_LAT_HIST
+static unsigned int blk_lat_bucket(u64 ns)
+{
+	unsigned int b = fls64(div_u64(ns, NSEC_PER_USEC));
+
+	if (b)
+		b--;
+	return min_t(unsigned int, b, BLK_LAT_BUCKETS - 1);
+}
+
+void blk_lat_hist_account(struct request *rq)
+{
+	struct blk_lat_hist __percpu *hist = rq->q->lat_hist;
+	u64 now = sched_clock();
+	unsigned int op, size;
+
+	if (!hist || rq->cmd_type != REQ_TYPE_FS ||
+	    (rq->cmd_flags & REQ_FLUSH_SEQ))
+		return;
+
+	if (rq->cmd_flags & REQ_DISCARD)
+		op = BLK_LAT_DISCARD;
+	else if (rq_data_dir(rq) == WRITE)
+		op = BLK_LAT_WRITE;
+	else
+		op = BLK_LAT_READ;
+
+	if (rq->lat_bytes <= SZ_4K)
+		size = 0;
+	else if (rq->lat_bytes <= SZ_16K)
+		size = 1;
+	else if (rq->lat_bytes <= SZ_64K)
+		size = 2;
+	else
+		size = 3;
+
+	this_cpu_inc(hist->wait[op][size][blk_lat_bucket(rq->lat_issue_ns -
+							 rq->lat_queue_ns)]);
+	this_cpu_inc(hist->service[op][size][blk_lat_bucket(now -
+							    rq->lat_issue_ns)]);
+}
+#endif
+
 void blk_account_io_done(struct request *req)
 {
+	blk_lat_hist_done(req);
+
 	/*
 	 * Account IO completion.  flush_rq isn't accounted as a
 	 * normal IO on queueing nor completion.  Accounting the
@@ -2360,6 +2407,8 @@ void blk_dequeue_request(struct request *rq)
 		q->in_flight[rq_is_sync(rq)]++;
 		set_io_start_time_ns(rq);
 	}
+
+	blk_lat_hist_issued(rq);
 }
 
 /**
@@ -223,6 +223,121 @@ QUEUE_SYSFS_BIT_FNS(random, ADD_RANDOM, 0);
 QUEUE_SYSFS_BIT_FNS(iostats, IO_STAT, 0);
 #undef QUEUE_SYSFS_BIT_FNS
 
+#ifdef CONFIG_BLK_DEV_LAT_HIST
+static ssize_t queue_lat_hist_enable_show(struct request_queue *q, char *page)
+{
+	return queue_var_show(test_bit(QUEUE_FLAG_LAT_HIST, &q->queue_flags),
+			      page);
+}
+
+static ssize_t queue_lat_hist_enable_store(struct request_queue *q,
+					   const char *page, size_t count)
+{
+	struct blk_lat_hist __percpu *hist;
+	unsigned long val;
+	ssize_t ret;
+
+	ret = queue_var_store(&val, page, count);
+	if (ret < 0)
+		return ret;
+
+	/*
+	 * Writers are serialised by q->sysfs_lock.  Once allocated, the
+	 * counters stay until the queue is released.
+	 */
+	lockdep_assert_held(&q->sysfs_lock);
+	if (val && !q->lat_hist) {
+		hist = alloc_percpu(struct blk_lat_hist);
+		if (!hist)
+			return -ENOMEM;
+		if (cmpxchg(&q->lat_hist, NULL, hist))
+			free_percpu(hist);
+	}
+
+	spin_lock_irq(q->queue_lock);
+	if (val)
+		queue_flag_set(QUEUE_FLAG_LAT_HIST, q);
+	else
+		queue_flag_clear(QUEUE_FLAG_LAT_HIST, q);
+	spin_unlock_irq(q->queue_lock);
+
+	return ret;
+}
+
+static const char *const blk_lat_op_names[BLK_LAT_NR_OPS] = {
+	"read", "write", "discard",
+};
+
+static const char *const blk_lat_size_names[BLK_LAT_NR_SIZES] = {
+	"4k", "16k", "64k", "large",
+};
+
+static ssize_t queue_lat_hist_show(struct request_queue *q, char *page,
+				   bool service)
+{
+	unsigned int op, size, b;
+	ssize_t len = 0;
+	int cpu;
+
+	len += scnprintf(page + len, PAGE_SIZE - len, "usec");
+	for (b = 0; b < BLK_LAT_BUCKETS; b++)
+		len += scnprintf(page + len, PAGE_SIZE - len, " %lu",
+				 b ? 1UL << b : 0);
+	len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+
+	if (!q->lat_hist)
+		return len;
+
+	for (op = 0; op < BLK_LAT_NR_OPS; op++) {
+		for (size = 0; size < BLK_LAT_NR_SIZES; size++) {
+			len += scnprintf(page + len, PAGE_SIZE - len, "%s %s",
+					 blk_lat_op_names[op],
+					 blk_lat_size_names[size]);
+			for (b = 0; b < BLK_LAT_BUCKETS; b++) {
+				unsigned long sum = 0;
+
+				for_each_possible_cpu(cpu) {
+					struct blk_lat_hist *h;
+
+					h = per_cpu_ptr(q->lat_hist, cpu);
+					sum += service ? h->service[op][size][b] :
+							 h->wait[op][size][b];
+				}
+				len += scnprintf(page + len, PAGE_SIZE - len,
+						 " %lu", sum);
+			}
+			len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+		}
+	}
+
+	return len;
+}
+
+static ssize_t queue_lat_hist_wait_show(struct request_queue *q, char *page)
+{
+	return queue_lat_hist_show(q, page, false);
+}
+
+static ssize_t queue_lat_hist_service_show(struct request_queue *q,
+					   char *page)
+{
+	return queue_lat_hist_show(q, page, true);
+}
+
+/* Writing anything to either histogram clears both */
+static ssize_t queue_lat_hist_reset(struct request_queue *q,
+				    const char *page, size_t count)
+{
+	int cpu;
+
+	if (q->lat_hist)
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(q->lat_hist, cpu), 0,
+			       sizeof(struct blk_lat_hist));
+	return count;
+}
+#endif
+
 static ssize_t queue_nomerges_show(struct request_queue *q, char *page)
 {
 	return queue_var_show((blk_queue_nomerges(q) << 1) |
@@ -404,6 +519,26 @@ static struct queue_sysfs_entry queue_random_entry = {
 	.store = queue_store_random,
 };
 
+#ifdef CONFIG_BLK_DEV_LAT_HIST
+static struct queue_sysfs_entry queue_lat_hist_enable_entry = {
+	.attr = {.name = "lat_hist_enable", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_lat_hist_enable_show,
+	.store = queue_lat_hist_enable_store,
+};
+
+static struct queue_sysfs_entry queue_lat_hist_wait_entry = {
+	.attr = {.name = "lat_hist_wait", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_lat_hist_wait_show,
+	.store = queue_lat_hist_reset,
+};
+
+static struct queue_sysfs_entry queue_lat_hist_service_entry = {
+	.attr = {.name = "lat_hist_service", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_lat_hist_service_show,
+	.store = queue_lat_hist_reset,
+};
+#endif
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -427,6 +562,11 @@ static struct attribute *default_attrs[] = {
 	&queue_rq_affinity_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
+#ifdef CONFIG_BLK_DEV_LAT_HIST
+	&queue_lat_hist_enable_entry.attr,
+	&queue_lat_hist_wait_entry.attr,
+	&queue_lat_hist_service_entry.attr,
+#endif
 	NULL,
 };
 
@@ -522,6 +662,10 @@ static void blk_release_queue(struct kobject *kobj)
 
 	blk_trace_shutdown(q);
 
+#ifdef CONFIG_BLK_DEV_LAT_HIST
+	free_percpu(q->lat_hist);
+#endif
+
 	ida_simple_remove(&blk_queue_ida, q->id);
 	call_rcu(&q->rcu_head, blk_free_queue_rcu);
 }
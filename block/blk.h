@@ -281,4 +281,60 @@ static inline int blk_throtl_init(struct request_queue *q) { return 0; }
 static inline void blk_throtl_exit(struct request_queue *q) { }
 #endif /* CONFIG_BLK_DEV_THROTTLING */
 
+#ifdef CONFIG_BLK_DEV_LAT_HIST
+/*
+ * Bucket i counts latencies in [2^i, 2^(i+1)) microseconds, bucket 0 also
+ * counts anything below 1us and the last one anything above.
+ */
+#define BLK_LAT_BUCKETS		22
+
+enum {
+	BLK_LAT_READ,
+	BLK_LAT_WRITE,
+	BLK_LAT_DISCARD,
+	BLK_LAT_NR_OPS,
+};
+
+/* request size classes: up to 4KiB, 16KiB, 64KiB and larger */
+#define BLK_LAT_NR_SIZES	4
+
+struct blk_lat_hist {
+	unsigned long wait[BLK_LAT_NR_OPS][BLK_LAT_NR_SIZES][BLK_LAT_BUCKETS];
+	unsigned long service[BLK_LAT_NR_OPS][BLK_LAT_NR_SIZES][BLK_LAT_BUCKETS];
+};
+
+void blk_lat_hist_account(struct request *rq);
+
+static inline void blk_lat_hist_queued(struct request *rq)
+{
+	rq->lat_issue_ns = 0;
+	/* blk_rq_init(NULL, rq) users set up requests outside any queue */
+	if (rq->q && test_bit(QUEUE_FLAG_LAT_HIST, &rq->q->queue_flags))
+		rq->lat_queue_ns = sched_clock();
+	else
+		rq->lat_queue_ns = 0;
+}
+
+static inline void blk_lat_hist_issued(struct request *rq)
+{
+	if (rq->lat_queue_ns) {
+		rq->lat_issue_ns = sched_clock();
+		rq->lat_bytes = blk_rq_bytes(rq);
+	}
+}
+
+static inline void blk_lat_hist_done(struct request *rq)
+{
+	if (rq->lat_issue_ns) {
+		blk_lat_hist_account(rq);
+		rq->lat_queue_ns = 0;
+		rq->lat_issue_ns = 0;
+	}
+}
+#else
+static inline void blk_lat_hist_queued(struct request *rq) { }
+static inline void blk_lat_hist_issued(struct request *rq) { }
+static inline void blk_lat_hist_done(struct request *rq) { }
+#endif /* CONFIG_BLK_DEV_LAT_HIST */
+
 #endif /* BLK_INTERNAL_H */
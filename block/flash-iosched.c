@@ -0,0 +1,572 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  Based on the deadline i/o scheduler,
+ *  Copyright (C) 2002 Jens Axboe <axboe@kernel.dk>
+ *
+ *  eMMC and NAND have no seek cost, but writes are much slower than reads
+ *  and are cheapest when they fill an erase block in one go. This
+ *  scheduler therefore serves reads first, keeps write latency bounded
+ *  by an expiry time of its own rather than only by read starvation,
+ *  lets a write batch run on while it stays inside one erase block and
+ *  holds discards back so they are issued together.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+
+enum {
+	FLASH_READ,
+	FLASH_WRITE,
+	FLASH_DISCARD,
+	FLASH_NR_DIRS,
+};
+
+static const int read_expire = HZ / 4;	/* max time before a read is submitted. */
+static const int write_expire = HZ;	/* ditto for writes, these limits are SOFT! */
+static const int discard_expire = 2 * HZ; /* max time a discard is held back */
+static const int writes_starved = 4;	/* max times reads can starve a write */
+static const int fifo_batch = 16;	/* # of sequential requests treated as one
+					   by the above parameters. For throughput. */
+static const int discard_batch = 16;	/* # of discards issued together */
+
+struct flash_data {
+	struct request_queue *queue;
+
+	/*
+	 * requests are present on both sort_list and fifo_list
+	 */
+	struct rb_root sort_list[FLASH_NR_DIRS];
+	struct list_head fifo_list[FLASH_NR_DIRS];
+	unsigned int queued[FLASH_NR_DIRS];
+
+	/*
+	 * next in sort order, only set for the direction of the last batch
+	 */
+	struct request *next_rq[FLASH_NR_DIRS];
+	unsigned int batching;		/* number of sequential requests made */
+	sector_t last_sector;		/* end of the last request */
+	sector_t last_write;		/* start of the last write */
+	unsigned int starved;		/* times reads have starved writes */
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[FLASH_NR_DIRS];
+	int fifo_batch;
+	int writes_starved;
+	int front_merges;
+	int discard_batch;
+	int erase_block_kb;		/* < 0: use the queue's discard granularity */
+};
+
+static inline int flash_rq_dir(struct request *rq)
+{
+	if (rq->cmd_flags & REQ_DISCARD)
+		return FLASH_DISCARD;
+	return rq_data_dir(rq) == READ ? FLASH_READ : FLASH_WRITE;
+}
+
+/*
+ * The MMC layer reports the card's preferred erase size as discard
+ * granularity. It is only known once the card queue is set up, after the
+ * elevator was initialised, so it is looked up each time.
+ */
+static sector_t flash_erase_sectors(struct flash_data *fd)
+{
+	if (fd->erase_block_kb >= 0)
+		return (sector_t)fd->erase_block_kb << 1;
+	return fd->queue->limits.discard_granularity >> 9;
+}
+
+static bool flash_same_erase_block(struct flash_data *fd, sector_t a,
+				   sector_t b)
+{
+	sector_t erase_sectors = flash_erase_sectors(fd);
+
+	if (!erase_sectors)
+		return false;
+
+	sector_div(a, erase_sectors);
+	sector_div(b, erase_sectors);
+	return a == b;
+}
+
+/*
+ * get the request after `rq' in sector-sorted order
+ */
+static inline struct request *
+flash_latter_request(struct request *rq)
+{
+	struct rb_node *node = rb_next(&rq->rb_node);
+
+	if (node)
+		return rb_entry_rq(node);
+
+	return NULL;
+}
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	elv_rb_add(&fd->sort_list[flash_rq_dir(rq)], rq);
+}
+
+static inline void
+flash_del_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	const int dir = flash_rq_dir(rq);
+
+	if (fd->next_rq[dir] == rq)
+		fd->next_rq[dir] = flash_latter_request(rq);
+
+	elv_rb_del(&fd->sort_list[dir], rq);
+}
+
+/*
+ * add rq to rbtree and fifo
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int dir = flash_rq_dir(rq);
+
+	flash_add_rq_rb(fd, rq);
+
+	/*
+	 * set expire time and add to fifo list
+	 */
+	rq->fifo_time = jiffies + fd->fifo_expire[dir];
+	list_add_tail(&rq->queuelist, &fd->fifo_list[dir]);
+	fd->queued[dir]++;
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	fd->queued[flash_rq_dir(rq)]--;
+	rq_fifo_clear(rq);
+	flash_del_rq_rb(fd, rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *__rq;
+	int dir;
+
+	/*
+	 * check for front merge
+	 */
+	if (!fd->front_merges)
+		return ELEVATOR_NO_MERGE;
+
+	if (bio->bi_rw & REQ_DISCARD)
+		dir = FLASH_DISCARD;
+	else
+		dir = bio_data_dir(bio) == READ ? FLASH_READ : FLASH_WRITE;
+
+	__rq = elv_rb_find(&fd->sort_list[dir], bio_end_sector(bio));
+	if (__rq && elv_rq_merge_ok(__rq, bio)) {
+		*req = __rq;
+		return ELEVATOR_FRONT_MERGE;
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(&fd->sort_list[flash_rq_dir(req)], req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if (time_before(next->fifo_time, req->fifo_time)) {
+			list_move(&req->queuelist, &next->queuelist);
+			req->fifo_time = next->fifo_time;
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	flash_remove_request(q, next);
+}
+
+/*
+ * move an entry to dispatch queue
+ */
+static void
+flash_move_request(struct flash_data *fd, struct request *rq)
+{
+	struct request_queue *q = rq->q;
+	const int dir = flash_rq_dir(rq);
+	int i;
+
+	for (i = 0; i < FLASH_NR_DIRS; i++)
+		fd->next_rq[i] = NULL;
+	fd->next_rq[dir] = flash_latter_request(rq);
+
+	fd->last_sector = rq_end_sector(rq);
+	if (dir == FLASH_WRITE)
+		fd->last_write = blk_rq_pos(rq);
+
+	/*
+	 * take it off the sort and fifo list, move
+	 * to dispatch queue
+	 */
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+/*
+ * flash_check_fifo returns 1 if the oldest request of @dir has expired.
+ * Requires !list_empty(&fd->fifo_list[dir])
+ */
+static inline int flash_check_fifo(struct flash_data *fd, int dir)
+{
+	struct request *rq = rq_entry_fifo(fd->fifo_list[dir].next);
+
+	return time_after_eq(jiffies, rq->fifo_time);
+}
+
+/*
+ * Discards are held back until enough of them have gathered, the oldest
+ * one has expired, or there is nothing else to do.
+ */
+static bool flash_discards_due(struct flash_data *fd, int force)
+{
+	if (list_empty(&fd->fifo_list[FLASH_DISCARD]))
+		return false;
+
+	return force || fd->queued[FLASH_DISCARD] >= fd->discard_batch ||
+		flash_check_fifo(fd, FLASH_DISCARD) ||
+		(list_empty(&fd->fifo_list[FLASH_READ]) &&
+		 list_empty(&fd->fifo_list[FLASH_WRITE]));
+}
+
+/*
+ * Decide whether the batch that dispatched the last request may go on
+ * with @rq.
+ */
+static bool flash_continue_batch(struct flash_data *fd, struct request *rq)
+{
+	const int dir = flash_rq_dir(rq);
+
+	if (dir == FLASH_DISCARD)
+		return fd->batching < fd->discard_batch;
+
+	if (dir == FLASH_READ)
+		return fd->batching < fd->fifo_batch;
+
+	/*
+	 * A write that carries on in the erase block we are writing is
+	 * worth finishing even with reads waiting, it saves the card a
+	 * read-modify-write of that block later. Cap it so that huge erase
+	 * blocks can't starve reads.
+	 */
+	if (blk_rq_pos(rq) == fd->last_sector ||
+	    flash_same_erase_block(fd, blk_rq_pos(rq), fd->last_write))
+		return fd->batching < 4 * fd->fifo_batch;
+
+	/* otherwise a waiting read ends the write batch */
+	if (!list_empty(&fd->fifo_list[FLASH_READ]))
+		return false;
+
+	return fd->batching < fd->fifo_batch;
+}
+
+/*
+ * flash_dispatch_requests selects the best request according to
+ * read/write expire, fifo_batch, discard batching, etc
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int reads = !list_empty(&fd->fifo_list[FLASH_READ]);
+	const int writes = !list_empty(&fd->fifo_list[FLASH_WRITE]);
+	struct request *rq = NULL;
+	int dir, i;
+
+	/*
+	 * batches are reads XOR writes XOR discards
+	 */
+	for (i = 0; i < FLASH_NR_DIRS && !rq; i++)
+		rq = fd->next_rq[i];
+
+	if (rq && flash_continue_batch(fd, rq))
+		/* we have a next request and are still entitled to batch */
+		goto dispatch_request;
+
+	/*
+	 * at this point we are not running a batch. select the appropriate
+	 * direction
+	 */
+	if (flash_discards_due(fd, force)) {
+		dir = FLASH_DISCARD;
+		goto dispatch_find_request;
+	}
+
+	if (reads) {
+		BUG_ON(RB_EMPTY_ROOT(&fd->sort_list[FLASH_READ]));
+
+		/* a write past its deadline goes before further reads */
+		if (writes && (fd->starved++ >= fd->writes_starved ||
+			       flash_check_fifo(fd, FLASH_WRITE)))
+			goto dispatch_writes;
+
+		dir = FLASH_READ;
+
+		goto dispatch_find_request;
+	}
+
+	/*
+	 * there are either no reads or writes have been starved
+	 */
+
+	if (writes) {
+dispatch_writes:
+		BUG_ON(RB_EMPTY_ROOT(&fd->sort_list[FLASH_WRITE]));
+
+		fd->starved = 0;
+
+		dir = FLASH_WRITE;
+
+		goto dispatch_find_request;
+	}
+
+	return 0;
+
+dispatch_find_request:
+	/*
+	 * we are not running a batch, find best request for selected dir
+	 */
+	if (flash_check_fifo(fd, dir) || !fd->next_rq[dir]) {
+		/*
+		 * A deadline has expired, the last request was in another
+		 * direction, or we have run out of higher-sectored requests.
+		 * Start again from the request with the earliest expiry time.
+		 */
+		rq = rq_entry_fifo(fd->fifo_list[dir].next);
+	} else {
+		/*
+		 * The last req was the same dir and we have a next request in
+		 * sort order. No expired requests so continue on from here.
+		 */
+		rq = fd->next_rq[dir];
+	}
+
+	fd->batching = 0;
+
+dispatch_request:
+	/*
+	 * rq is the selected appropriate request.
+	 */
+	fd->batching++;
+	flash_move_request(fd, rq);
+
+	return 1;
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+	int i;
+
+	for (i = 0; i < FLASH_NR_DIRS; i++)
+		BUG_ON(!list_empty(&fd->fifo_list[i]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static int flash_init_queue(struct request_queue *q, struct elevator_type *e)
+{
+	struct flash_data *fd;
+	struct elevator_queue *eq;
+	int i;
+
+	eq = elevator_alloc(q, e);
+	if (!eq)
+		return -ENOMEM;
+
+	fd = kzalloc_node(sizeof(*fd), GFP_KERNEL, q->node);
+	if (!fd) {
+		kobject_put(&eq->kobj);
+		return -ENOMEM;
+	}
+	eq->elevator_data = fd;
+
+	fd->queue = q;
+	for (i = 0; i < FLASH_NR_DIRS; i++) {
+		INIT_LIST_HEAD(&fd->fifo_list[i]);
+		fd->sort_list[i] = RB_ROOT;
+	}
+	fd->fifo_expire[FLASH_READ] = read_expire;
+	fd->fifo_expire[FLASH_WRITE] = write_expire;
+	fd->fifo_expire[FLASH_DISCARD] = discard_expire;
+	fd->writes_starved = writes_starved;
+	fd->front_merges = 1;
+	fd->fifo_batch = fifo_batch;
+	fd->discard_batch = discard_batch;
+	fd->erase_block_kb = -1;
+
+	spin_lock_irq(q->queue_lock);
+	q->elevator = eq;
+	spin_unlock_irq(q->queue_lock);
+	return 0;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_read_expire_show, fd->fifo_expire[FLASH_READ], 1);
+SHOW_FUNCTION(flash_write_expire_show, fd->fifo_expire[FLASH_WRITE], 1);
+SHOW_FUNCTION(flash_discard_expire_show, fd->fifo_expire[FLASH_DISCARD], 1);
+SHOW_FUNCTION(flash_writes_starved_show, fd->writes_starved, 0);
+SHOW_FUNCTION(flash_front_merges_show, fd->front_merges, 0);
+SHOW_FUNCTION(flash_fifo_batch_show, fd->fifo_batch, 0);
+SHOW_FUNCTION(flash_discard_batch_show, fd->discard_batch, 0);
+#undef SHOW_FUNCTION
+
+/* shows the erase block size in use, whichever way it was obtained */
+static ssize_t flash_erase_block_kb_show(struct elevator_queue *e, char *page)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	return flash_var_show(flash_erase_sectors(fd) >> 1, page);
+}
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_read_expire_store, &fd->fifo_expire[FLASH_READ], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_write_expire_store, &fd->fifo_expire[FLASH_WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_discard_expire_store, &fd->fifo_expire[FLASH_DISCARD], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_writes_starved_store, &fd->writes_starved, INT_MIN, INT_MAX, 0);
+STORE_FUNCTION(flash_front_merges_store, &fd->front_merges, 0, 1, 0);
+STORE_FUNCTION(flash_fifo_batch_store, &fd->fifo_batch, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_discard_batch_store, &fd->discard_batch, 1, INT_MAX, 0);
+/* -1 goes back to the size reported by the driver, 0 disables */
+STORE_FUNCTION(flash_erase_block_kb_store, &fd->erase_block_kb, -1, INT_MAX >> 1, 0);
+#undef STORE_FUNCTION
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(read_expire),
+	FD_ATTR(write_expire),
+	FD_ATTR(discard_expire),
+	FD_ATTR(writes_starved),
+	FD_ATTR(front_merges),
+	FD_ATTR(fifo_batch),
+	FD_ATTR(discard_batch),
+	FD_ATTR(erase_block_kb),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	return elv_register(&iosched_flash);
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
@@ -17,6 +17,7 @@
  * This file is released under the GPLv2
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/delay.h>
 #include <linux/module.h>
@@ -25,6 +26,7 @@
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
+#include <linux/seq_file.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -275,10 +277,133 @@ EXPORT_SYMBOL_GPL(device_bind_driver);
 static atomic_t probe_count = ATOMIC_INIT(0);
 static DECLARE_WAIT_QUEUE_HEAD(probe_waitqueue);
 
+/*
+ * The slowest probe calls so far, slowest first, reported in debugfs as
+ * probe_times. Deferred probes show up once per attempt.
+ */
+#define PROBE_TIMES_MAX		32
+
+struct probe_time {
+	char dev[32];
+	char drv[24];
+	int ret;
+	s64 usecs;
+};
+
+static struct probe_time probe_times[PROBE_TIMES_MAX];
+static DEFINE_SPINLOCK(probe_times_lock);
+
+static void probe_times_add(struct device *dev, struct device_driver *drv,
+			    int ret, s64 usecs)
+{
+	struct probe_time *t = probe_times;
+	int i, j;
+
+	spin_lock(&probe_times_lock);
+	for (i = 0; i < PROBE_TIMES_MAX; i++)
+		if (usecs > t[i].usecs)
+			break;
+
+	if (i < PROBE_TIMES_MAX) {
+		for (j = PROBE_TIMES_MAX - 1; j > i; j--)
+			t[j] = t[j - 1];
+		strlcpy(t[i].dev, dev_name(dev), sizeof(t[i].dev));
+		strlcpy(t[i].drv, drv->name, sizeof(t[i].drv));
+		t[i].ret = ret;
+		t[i].usecs = usecs;
+	}
+	spin_unlock(&probe_times_lock);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int probe_times_show(struct seq_file *s, void *unused)
+{
+	int i;
+
+	seq_puts(s, "   usecs  ret  driver                   device\n");
+	spin_lock(&probe_times_lock);
+	for (i = 0; i < PROBE_TIMES_MAX && probe_times[i].usecs; i++)
+		seq_printf(s, "%8lld %4d  %-24s %s\n", probe_times[i].usecs,
+			   probe_times[i].ret, probe_times[i].drv,
+			   probe_times[i].dev);
+	spin_unlock(&probe_times_lock);
+
+	return 0;
+}
+
+static int probe_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, probe_times_show, NULL);
+}
+
+static const struct file_operations probe_times_fops = {
+	.open		= probe_times_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init probe_times_debugfs_init(void)
+{
+	debugfs_create_file("probe_times", S_IRUGO, NULL, NULL,
+			    &probe_times_fops);
+	return 0;
+}
+late_initcall(probe_times_debugfs_init);
+#endif
+
+#define ASYNC_DRV_NAMES_MAX_LEN	256
+static char async_probe_drv_names[ASYNC_DRV_NAMES_MAX_LEN];
+
+/*
+ * "driver_async_probe=drv1,drv2,..." makes the named drivers with the
+ * default probe type probe asynchronously. As for
+ * PROBE_PREFER_ASYNCHRONOUS, that is only the attach run by
+ * bus_add_driver(); devices added later are probed synchronously.
+ */
+static int __init save_async_options(char *buf)
+{
+	strlcpy(async_probe_drv_names, buf, ASYNC_DRV_NAMES_MAX_LEN);
+	return 1;
+}
+__setup("driver_async_probe=", save_async_options);
+
+static bool driver_async_probe_requested(struct device_driver *drv)
+{
+	const char *p = async_probe_drv_names;
+	size_t len = strlen(drv->name);
+
+	while (*p) {
+		if (!strncmp(p, drv->name, len) &&
+		    (p[len] == ',' || p[len] == '\0'))
+			return true;
+		p = strchrnul(p, ',');
+		if (*p)
+			p++;
+	}
+
+	return false;
+}
+
+bool driver_allows_async_probing(struct device_driver *drv)
+{
+	switch (drv->probe_type) {
+	case PROBE_PREFER_ASYNCHRONOUS:
+		return true;
+
+	case PROBE_FORCE_SYNCHRONOUS:
+		return false;
+
+	default:
+		return driver_async_probe_requested(drv);
+	}
+}
+
 static int really_probe(struct device *dev, struct device_driver *drv)
 {
 	int ret = 0;
 	int local_trigger_count = atomic_read(&deferred_trigger_count);
+	ktime_t calltime = ktime_get();
 
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
@@ -355,8 +480,14 @@ probe_failed:
 	 * Ignore errors returned by ->probe so that the next driver can try
 	 * its luck.
 	 */
+	probe_times_add(dev, drv, ret,
+			ktime_to_us(ktime_sub(ktime_get(), calltime)));
 	ret = 0;
+	goto out;
 done:
+	probe_times_add(dev, drv, 0,
+			ktime_to_us(ktime_sub(ktime_get(), calltime)));
+out:
 	atomic_dec(&probe_count);
 	wake_up(&probe_waitqueue);
 	return ret;
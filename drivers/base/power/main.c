@@ -17,6 +17,7 @@
  * subsystem list maintains.
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/kallsyms.h>
 #include <linux/export.h>
@@ -32,6 +33,7 @@
 #include <linux/cpufreq.h>
 #include <linux/cpuidle.h>
 #include <linux/timer.h>
+#include <linux/seq_file.h>
 
 #include "../base.h"
 #include "power.h"
@@ -187,18 +189,61 @@ void device_pm_move_last(struct device *dev)
 	list_move_tail(&dev->power.entry, &dpm_list);
 }
 
-static ktime_t initcall_debug_start(struct device *dev)
+/*
+ * The slowest device resume callbacks of the last system resume, slowest
+ * first, reported in debugfs as pm_resume_times.
+ */
+#define PM_RESUME_TIMES_MAX	16
+
+struct pm_resume_time {
+	char name[32];
+	const char *info;
+	s64 usecs;
+};
+
+static struct pm_resume_time pm_resume_times[PM_RESUME_TIMES_MAX];
+static DEFINE_SPINLOCK(pm_resume_times_lock);
+
+static void pm_resume_times_reset(void)
 {
-	ktime_t calltime = ktime_set(0, 0);
+	unsigned long flags;
 
+	spin_lock_irqsave(&pm_resume_times_lock, flags);
+	memset(pm_resume_times, 0, sizeof(pm_resume_times));
+	spin_unlock_irqrestore(&pm_resume_times_lock, flags);
+}
+
+static void pm_resume_times_add(struct device *dev, const char *info,
+				s64 usecs)
+{
+	struct pm_resume_time *t = pm_resume_times;
+	unsigned long flags;
+	int i, j;
+
+	spin_lock_irqsave(&pm_resume_times_lock, flags);
+	for (i = 0; i < PM_RESUME_TIMES_MAX; i++)
+		if (usecs > t[i].usecs)
+			break;
+
+	if (i < PM_RESUME_TIMES_MAX) {
+		for (j = PM_RESUME_TIMES_MAX - 1; j > i; j--)
+			t[j] = t[j - 1];
+		strlcpy(t[i].name, dev_name(dev), sizeof(t[i].name));
+		t[i].info = info;
+		t[i].usecs = usecs;
+	}
+	spin_unlock_irqrestore(&pm_resume_times_lock, flags);
+}
+
+static ktime_t initcall_debug_start(struct device *dev)
+{
 	if (pm_print_times_enabled) {
 		pr_info("calling  %s+ @ %i, parent: %s\n",
 			dev_name(dev), task_pid_nr(current),
 			dev->parent ? dev_name(dev->parent) : "none");
-		calltime = ktime_get();
 	}
 
-	return calltime;
+	return ktime_get();
 }
 
 static void initcall_debug_report(struct device *dev, ktime_t calltime,
@@ -214,6 +259,9 @@ static void initcall_debug_report(struct device *dev, ktime_t calltime,
 		pr_info("call %s+ returned %d after %Ld usecs\n", dev_name(dev),
 			error, (unsigned long long)nsecs >> 10);
 	}
+
+	if (state.event == PM_EVENT_RESUME)
+		pm_resume_times_add(dev, info, div_s64(nsecs, NSEC_PER_USEC));
 }
 
 /**
@@ -545,6 +593,9 @@ void dpm_resume_noirq(pm_message_t state)
 	struct device *dev;
 	ktime_t starttime = ktime_get();
 
+	if (state.event == PM_EVENT_RESUME)
+		pm_resume_times_reset();
+
 	trace_suspend_resume(TPS("dpm_resume_noirq"), state.event, true);
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
@@ -1717,3 +1768,43 @@ void dpm_for_each_dev(void *data, void (*fn)(struct device *, void *))
 	device_pm_unlock();
 }
 EXPORT_SYMBOL_GPL(dpm_for_each_dev);
+
+#ifdef CONFIG_DEBUG_FS
+static int pm_resume_times_show(struct seq_file *s, void *unused)
+{
+	struct pm_resume_time t[PM_RESUME_TIMES_MAX];
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&pm_resume_times_lock, flags);
+	memcpy(t, pm_resume_times, sizeof(t));
+	spin_unlock_irqrestore(&pm_resume_times_lock, flags);
+
+	seq_puts(s, "   usecs  phase                  device\n");
+	for (i = 0; i < PM_RESUME_TIMES_MAX && t[i].usecs; i++)
+		seq_printf(s, "%8lld  %-21s  %s\n", t[i].usecs,
+			   t[i].info ?: "", t[i].name);
+
+	return 0;
+}
+
+static int pm_resume_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pm_resume_times_show, NULL);
+}
+
+static const struct file_operations pm_resume_times_fops = {
+	.open		= pm_resume_times_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init pm_resume_times_debugfs_init(void)
+{
+	debugfs_create_file("pm_resume_times", S_IRUGO, NULL, NULL,
+			    &pm_resume_times_fops);
+	return 0;
+}
+late_initcall(pm_resume_times_debugfs_init);
+#endif
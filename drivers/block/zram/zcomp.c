@@ -11,8 +11,9 @@
 #include <linux/string.h>
 #include <linux/err.h>
 #include <linux/slab.h>
-#include <linux/wait.h>
-#include <linux/sched.h>
+#include <linux/percpu.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include "zcomp.h"
 #include "zcomp_lzo.h"
@@ -20,33 +21,11 @@
 #include "zcomp_lz4.h"
 #endif
 
-/*
- * single zcomp_strm backend
- */
-struct zcomp_strm_single {
-	struct mutex strm_lock;
-	struct zcomp_strm *zstrm;
-};
-
-/*
- * multi zcomp_strm backend
- */
-struct zcomp_strm_multi {
-	/* protect strm list */
-	spinlock_t strm_lock;
-	/* max possible number of zstrm streams */
-	int max_strm;
-	/* number of available zstrm streams */
-	int avail_strm;
-	/* list of available strms */
-	struct list_head idle_strm;
-	wait_queue_head_t strm_wait;
-};
-
 static struct zcomp_backend *backends[] = {
 	&zcomp_lzo,
 #ifdef CONFIG_ZRAM_LZ4_COMPRESS
 	&zcomp_lz4,
+	&zcomp_lz4hc,
 #endif
 	NULL
 };
@@ -93,176 +72,44 @@ static struct zcomp_strm *zcomp_strm_alloc(struct zcomp *comp)
 	return zstrm;
 }
 
-/*
- * get idle zcomp_strm or wait until other process release
- * (zcomp_strm_release()) one for us
- */
-static struct zcomp_strm *zcomp_strm_multi_find(struct zcomp *comp)
-{
-	struct zcomp_strm_multi *zs = comp->stream;
-	struct zcomp_strm *zstrm;
-
-	while (1) {
-		spin_lock(&zs->strm_lock);
-		if (!list_empty(&zs->idle_strm)) {
-			zstrm = list_entry(zs->idle_strm.next,
-					struct zcomp_strm, list);
-			list_del(&zstrm->list);
-			spin_unlock(&zs->strm_lock);
-			return zstrm;
-		}
-		/* zstrm streams limit reached, wait for idle stream */
-		if (zs->avail_strm >= zs->max_strm) {
-			spin_unlock(&zs->strm_lock);
-			wait_event(zs->strm_wait, !list_empty(&zs->idle_strm));
-			continue;
-		}
-		/* allocate new zstrm stream */
-		zs->avail_strm++;
-		spin_unlock(&zs->strm_lock);
-
-		zstrm = zcomp_strm_alloc(comp);
-		if (!zstrm) {
-			spin_lock(&zs->strm_lock);
-			zs->avail_strm--;
-			spin_unlock(&zs->strm_lock);
-			wait_event(zs->strm_wait, !list_empty(&zs->idle_strm));
-			continue;
-		}
-		break;
-	}
-	return zstrm;
-}
-
-/* add stream back to idle list and wake up waiter or free the stream */
-static void zcomp_strm_multi_release(struct zcomp *comp, struct zcomp_strm *zstrm)
-{
-	struct zcomp_strm_multi *zs = comp->stream;
-
-	spin_lock(&zs->strm_lock);
-	if (zs->avail_strm <= zs->max_strm) {
-		list_add(&zstrm->list, &zs->idle_strm);
-		spin_unlock(&zs->strm_lock);
-		wake_up(&zs->strm_wait);
-		return;
-	}
-
-	zs->avail_strm--;
-	spin_unlock(&zs->strm_lock);
-	zcomp_strm_free(comp, zstrm);
-}
-
-/* change max_strm limit */
-static bool zcomp_strm_multi_set_max_streams(struct zcomp *comp, int num_strm)
+static void zcomp_strm_percpu_destroy(struct zcomp *comp)
 {
-	struct zcomp_strm_multi *zs = comp->stream;
+	struct zcomp_strm * __percpu *stream = comp->stream;
 	struct zcomp_strm *zstrm;
+	int cpu;
 
-	spin_lock(&zs->strm_lock);
-	zs->max_strm = num_strm;
-	/*
-	 * if user has lowered the limit and there are idle streams,
-	 * immediately free as much streams (and memory) as we can.
-	 */
-	while (zs->avail_strm > num_strm && !list_empty(&zs->idle_strm)) {
-		zstrm = list_entry(zs->idle_strm.next,
-				struct zcomp_strm, list);
-		list_del(&zstrm->list);
-		zcomp_strm_free(comp, zstrm);
-		zs->avail_strm--;
+	for_each_possible_cpu(cpu) {
+		zstrm = *per_cpu_ptr(stream, cpu);
+		if (zstrm)
+			zcomp_strm_free(comp, zstrm);
 	}
-	spin_unlock(&zs->strm_lock);
-	return true;
+	free_percpu(stream);
 }
 
-static void zcomp_strm_multi_destroy(struct zcomp *comp)
-{
-	struct zcomp_strm_multi *zs = comp->stream;
-	struct zcomp_strm *zstrm;
-
-	while (!list_empty(&zs->idle_strm)) {
-		zstrm = list_entry(zs->idle_strm.next,
-				struct zcomp_strm, list);
-		list_del(&zstrm->list);
-		zcomp_strm_free(comp, zstrm);
-	}
-	kfree(zs);
-}
-
-static int zcomp_strm_multi_create(struct zcomp *comp, int max_strm)
+/*
+ * One stream per possible CPU, so CPU hotplug needs no handling. A
+ * stream is only shared when a writer is preempted or migrates while
+ * compressing, which is why it still has a mutex.
+ */
+static int zcomp_strm_percpu_create(struct zcomp *comp)
 {
+	struct zcomp_strm * __percpu *stream;
 	struct zcomp_strm *zstrm;
-	struct zcomp_strm_multi *zs;
-
-	comp->destroy = zcomp_strm_multi_destroy;
-	comp->strm_find = zcomp_strm_multi_find;
-	comp->strm_release = zcomp_strm_multi_release;
-	comp->set_max_streams = zcomp_strm_multi_set_max_streams;
-	zs = kmalloc(sizeof(struct zcomp_strm_multi), GFP_KERNEL);
-	if (!zs)
-		return -ENOMEM;
-
-	comp->stream = zs;
-	spin_lock_init(&zs->strm_lock);
-	INIT_LIST_HEAD(&zs->idle_strm);
-	init_waitqueue_head(&zs->strm_wait);
-	zs->max_strm = max_strm;
-	zs->avail_strm = 1;
-
-	zstrm = zcomp_strm_alloc(comp);
-	if (!zstrm) {
-		kfree(zs);
-		return -ENOMEM;
-	}
-	list_add(&zstrm->list, &zs->idle_strm);
-	return 0;
-}
-
-static struct zcomp_strm *zcomp_strm_single_find(struct zcomp *comp)
-{
-	struct zcomp_strm_single *zs = comp->stream;
-	mutex_lock(&zs->strm_lock);
-	return zs->zstrm;
-}
-
-static void zcomp_strm_single_release(struct zcomp *comp,
-		struct zcomp_strm *zstrm)
-{
-	struct zcomp_strm_single *zs = comp->stream;
-	mutex_unlock(&zs->strm_lock);
-}
+	int cpu;
 
-static bool zcomp_strm_single_set_max_streams(struct zcomp *comp, int num_strm)
-{
-	/* zcomp_strm_single support only max_comp_streams == 1 */
-	return false;
-}
-
-static void zcomp_strm_single_destroy(struct zcomp *comp)
-{
-	struct zcomp_strm_single *zs = comp->stream;
-	zcomp_strm_free(comp, zs->zstrm);
-	kfree(zs);
-}
-
-static int zcomp_strm_single_create(struct zcomp *comp)
-{
-	struct zcomp_strm_single *zs;
-
-	comp->destroy = zcomp_strm_single_destroy;
-	comp->strm_find = zcomp_strm_single_find;
-	comp->strm_release = zcomp_strm_single_release;
-	comp->set_max_streams = zcomp_strm_single_set_max_streams;
-	zs = kmalloc(sizeof(struct zcomp_strm_single), GFP_KERNEL);
-	if (!zs)
+	stream = alloc_percpu(struct zcomp_strm *);
+	if (!stream)
 		return -ENOMEM;
 
-	comp->stream = zs;
-	mutex_init(&zs->strm_lock);
-	zs->zstrm = zcomp_strm_alloc(comp);
-	if (!zs->zstrm) {
-		kfree(zs);
-		return -ENOMEM;
+	comp->stream = stream;
+	for_each_possible_cpu(cpu) {
+		zstrm = zcomp_strm_alloc(comp);
+		if (!zstrm) {
+			zcomp_strm_percpu_destroy(comp);
+			return -ENOMEM;
+		}
+		mutex_init(&zstrm->lock);
+		*per_cpu_ptr(stream, cpu) = zstrm;
 	}
 	return 0;
 }
@@ -286,19 +133,22 @@ ssize_t zcomp_available_show(const char *comp, char *buf)
 	return sz;
 }
 
-bool zcomp_set_max_streams(struct zcomp *comp, int num_strm)
-{
-	return comp->set_max_streams(comp, num_strm);
-}
-
+/*
+ * Take the current CPU's stream. zs_malloc() may sleep while the stream
+ * is held, so preemption stays enabled and the stream is locked instead.
+ */
 struct zcomp_strm *zcomp_strm_find(struct zcomp *comp)
 {
-	return comp->strm_find(comp);
+	struct zcomp_strm * __percpu *stream = comp->stream;
+	struct zcomp_strm *zstrm = *raw_cpu_ptr(stream);
+
+	mutex_lock(&zstrm->lock);
+	return zstrm;
 }
 
 void zcomp_strm_release(struct zcomp *comp, struct zcomp_strm *zstrm)
 {
-	comp->strm_release(comp, zstrm);
+	mutex_unlock(&zstrm->lock);
 }
 
 int zcomp_compress(struct zcomp *comp, struct zcomp_strm *zstrm,
@@ -316,19 +166,91 @@ int zcomp_decompress(struct zcomp *comp, const unsigned char *src,
 
 void zcomp_destroy(struct zcomp *comp)
 {
-	comp->destroy(comp);
+	zcomp_strm_percpu_destroy(comp);
 	kfree(comp);
 }
 
+/*
+ * Compress and decompress @nr pages with every available backend and
+ * print one line per backend:
+ *   name, input bytes, compressed bytes, compress and decompress rate
+ *   in KB/s.
+ */
+ssize_t zcomp_bench(void **pages, unsigned int nr, char *buf)
+{
+	struct zcomp_backend *backend;
+	unsigned char *dst, *out;
+	void *private;
+	u64 compr, comp_ns, decomp_ns, orig = (u64)nr * PAGE_SIZE;
+	ktime_t start;
+	ssize_t sz = 0;
+	size_t len;
+	unsigned int i;
+	int b, ret;
+
+	if (!nr)
+		return 0;
+
+	out = (void *)__get_free_page(GFP_KERNEL);
+	dst = (void *)__get_free_pages(GFP_KERNEL, 1);
+	if (!out || !dst) {
+		sz = -ENOMEM;
+		goto out;
+	}
+
+	for (b = 0; backends[b]; b++) {
+		backend = backends[b];
+		private = backend->create();
+		if (!private) {
+			sz = -ENOMEM;
+			goto out;
+		}
+
+		compr = comp_ns = decomp_ns = 0;
+		ret = 0;
+		for (i = 0; i < nr && !ret; i++) {
+			start = ktime_get();
+			ret = backend->compress(pages[i], dst, &len, private);
+			comp_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+			if (ret)
+				break;
+			compr += min_t(size_t, len, PAGE_SIZE);
+
+			start = ktime_get();
+			ret = backend->decompress(dst, len, out);
+			decomp_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		}
+		backend->destroy(private);
+
+		if (ret) {
+			sz += scnprintf(buf + sz, PAGE_SIZE - sz,
+					"%-8s error %d\n", backend->name, ret);
+			continue;
+		}
+
+		sz += scnprintf(buf + sz, PAGE_SIZE - sz,
+				"%-8s %8llu %8llu %8llu %8llu\n",
+				backend->name, orig, compr,
+				div64_u64(orig * (NSEC_PER_SEC >> 10),
+					  max_t(u64, comp_ns, 1)),
+				div64_u64(orig * (NSEC_PER_SEC >> 10),
+					  max_t(u64, decomp_ns, 1)));
+	}
+out:
+	free_page((unsigned long)out);
+	free_pages((unsigned long)dst, 1);
+	return sz;
+}
+
 /*
  * search available compressors for requested algorithm.
  * allocate new zcomp and initialize it. return compressing
  * backend pointer or ERR_PTR if things went bad. ERR_PTR(-EINVAL)
  * if requested algorithm is not supported, ERR_PTR(-ENOMEM) in
  * case of allocation error, or any other error potentially
- * returned by functions zcomp_strm_{multi,single}_create.
+ * returned by zcomp_strm_percpu_create.
  */
-struct zcomp *zcomp_create(const char *compress, int max_strm)
+struct zcomp *zcomp_create(const char *compress)
 {
 	struct zcomp *comp;
 	struct zcomp_backend *backend;
@@ -343,10 +265,7 @@ struct zcomp *zcomp_create(const char *compress, int max_strm)
 		return ERR_PTR(-ENOMEM);
 
 	comp->backend = backend;
-	if (max_strm > 1)
-		error = zcomp_strm_multi_create(comp, max_strm);
-	else
-		error = zcomp_strm_single_create(comp);
+	error = zcomp_strm_percpu_create(comp);
 	if (error) {
 		kfree(comp);
 		return ERR_PTR(error);
@@ -10,6 +10,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/lz4.h>
+#include <linux/vmalloc.h>
 
 #include "zcomp_lz4.h"
 
@@ -45,3 +46,32 @@ struct zcomp_backend zcomp_lz4 = {
 	.destroy = zcomp_lz4_destroy,
 	.name = "lz4",
 };
+
+/*
+ * lz4hc trades compression speed for ratio and decompresses with the
+ * plain lz4 decoder, so it suits pages that are read far more than written.
+ */
+static void *zcomp_lz4hc_create(void)
+{
+	return vzalloc(LZ4HC_MEM_COMPRESS);
+}
+
+static void zcomp_lz4hc_destroy(void *private)
+{
+	vfree(private);
+}
+
+static int zcomp_lz4hc_compress(const unsigned char *src, unsigned char *dst,
+		size_t *dst_len, void *private)
+{
+	/* return  : Success if return 0 */
+	return lz4hc_compress(src, PAGE_SIZE, dst, dst_len, private);
+}
+
+struct zcomp_backend zcomp_lz4hc = {
+	.compress = zcomp_lz4hc_compress,
+	.decompress = zcomp_lz4_decompress,
+	.create = zcomp_lz4hc_create,
+	.destroy = zcomp_lz4hc_destroy,
+	.name = "lz4hc",
+};
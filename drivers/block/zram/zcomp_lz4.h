@@ -13,5 +13,6 @@
 #include "zcomp.h"
 
 extern struct zcomp_backend zcomp_lz4;
+extern struct zcomp_backend zcomp_lz4hc;
 
 #endif /* _ZCOMP_LZ4_H_ */
@@ -15,6 +15,7 @@
 #ifndef _ZRAM_DRV_H_
 #define _ZRAM_DRV_H_
 
+#include <linux/rbtree.h>
 #include <linux/spinlock.h>
 #include <linux/zsmalloc.h>
 
@@ -65,18 +66,43 @@ static const size_t max_zpage_size = PAGE_SIZE / 4 * 3;
 
 /* Flags for zram pages (table[page_no].value) */
 enum zram_pageflags {
-	/* Page consists entirely of zeros */
-	ZRAM_ZERO = ZRAM_FLAG_SHIFT,
+	/* Page is filled with the same word, kept in table[].element */
+	ZRAM_SAME = ZRAM_FLAG_SHIFT,
 	ZRAM_ACCESS,	/* page is now accessed */
+	ZRAM_WB,	/* page is on the backing device, block in element */
+	ZRAM_UNDER_WB,	/* page is being written to the backing device */
+	ZRAM_HUGE,	/* page did not compress and is stored as is */
+	ZRAM_IDLE,	/* page was not accessed since the last idle marking */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
+/*
+ * A compressed object shared by all the pages that compress to the same
+ * data. Only used on devices with use_dedup set.
+ */
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 checksum;
+	unsigned int len;
+	unsigned long refcount;
+	unsigned long handle;
+};
+
+struct zram_hash {
+	spinlock_t lock;
+	struct rb_root rb_root;
+};
+
 /* Allocated for each disk page */
 struct zram_table_entry {
-	unsigned long handle;
+	union {
+		unsigned long handle;
+		unsigned long element;		/* ZRAM_SAME, ZRAM_WB */
+		struct zram_entry *entry;	/* with use_dedup */
+	};
 	unsigned long value;
 };
 
@@ -89,14 +115,22 @@ struct zram_stats {
 	atomic64_t failed_writes;	/* can happen when memory is too low */
 	atomic64_t invalid_io;	/* non-page-aligned I/O requests */
 	atomic64_t notify_free;	/* no. of swap slot free notifications */
-	atomic64_t zero_pages;		/* no. of zero filled pages */
+	atomic64_t same_pages;		/* no. of same element filled pages */
+	atomic64_t dup_pages;		/* no. of pages sharing an object */
+	atomic64_t dup_data_size;	/* compressed bytes not stored again */
 	atomic64_t pages_stored;	/* no. of pages currently stored */
+	atomic64_t bd_count;		/* no. of pages on the backing device */
+	atomic64_t bd_reads;		/* no. of reads from the backing device */
+	atomic64_t bd_writes;		/* no. of writes to the backing device */
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 };
 
 struct zram_meta {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
+	bool use_dedup;
+	struct zram_hash *hash;
+	unsigned int hash_size;		/* power of two */
 };
 
 struct zram {
@@ -109,7 +143,6 @@ struct zram {
 	 * the number of pages zram can consume for storing compressed data
 	 */
 	unsigned long limit_pages;
-	int max_comp_streams;
 
 	struct zram_stats stats;
 	atomic_t refcount; /* refcount for zram_meta */
@@ -121,5 +154,13 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[10];
+	bool use_dedup;	/* applied at the next disksize store */
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct file *backing_dev;
+	struct block_device *bdev;
+	unsigned int old_block_size;
+	unsigned long *bitmap;		/* blocks in use on bdev */
+	unsigned long nr_pages;		/* size of bdev in pages */
+#endif
 };
 #endif
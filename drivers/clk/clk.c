@@ -62,8 +62,8 @@ struct clk_core {
 	struct clk_core		*new_parent;
 	struct clk_core		*new_child;
 	unsigned long		flags;
-	unsigned int		enable_count;
-	unsigned int		prepare_count;
+	atomic_t		enable_count;
+	atomic_t		prepare_count;
 	unsigned long		accuracy;
 	int			phase;
 	struct hlist_head	children;
@@ -145,6 +145,38 @@ static void clk_enable_unlock(unsigned long flags)
 	spin_unlock_irqrestore(&enable_lock, flags);
 }
 
+/*
+ * prepare_count and enable_count only move to or from zero with the
+ * matching lock held; that is where the hardware and the parents are
+ * touched.  A clock that is already running can take or drop another
+ * reference locklessly, so runtime PM cycles of devices sharing a clock
+ * do not serialize on the global locks.
+ *
+ * A fast get that succeeds goes straight on to use the clock, so the
+ * 0 -> 1 increment must not become visible before the hardware has been
+ * set up: it is preceded by smp_mb__before_atomic(), which pairs with
+ * the full barrier of a successful atomic_inc_not_zero().
+ */
+static bool clk_count_get_fast(atomic_t *count)
+{
+	return atomic_inc_not_zero(count);
+}
+
+static bool clk_count_put_fast(atomic_t *count)
+{
+	int c = atomic_read(count);
+	int old;
+
+	while (c > 1) {
+		old = atomic_cmpxchg(count, c, c - 1);
+		if (old == c)
+			return true;
+		c = old;
+	}
+
+	return false;
+}
+
 /***        debugfs support        ***/
 
 #ifdef CONFIG_DEBUG_FS
@@ -175,7 +207,8 @@ static void clk_summary_show_one(struct seq_file *s, struct clk_core *c,
 	seq_printf(s, "%*s%-*s %11d %12d %11lu %10lu %-3d\n",
 		   level * 3 + 1, "",
 		   30 - level * 3, c->name,
-		   c->enable_count, c->prepare_count, clk_core_get_rate(c),
+		   atomic_read(&c->enable_count),
+		   atomic_read(&c->prepare_count), clk_core_get_rate(c),
 		   clk_core_get_accuracy(c), clk_core_get_phase(c));
 }
 
@@ -232,8 +265,8 @@ static void clk_dump_one(struct seq_file *s, struct clk_core *c, int level)
 
 	/* This should be JSON format, i.e. elements separated with a comma */
 	seq_printf(s, "\"%s\": { ", c->name);
-	seq_printf(s, "\"enable_count\": %d,", c->enable_count);
-	seq_printf(s, "\"prepare_count\": %d,", c->prepare_count);
+	seq_printf(s, "\"enable_count\": %d,", atomic_read(&c->enable_count));
+	seq_printf(s, "\"prepare_count\": %d,", atomic_read(&c->prepare_count));
 	seq_printf(s, "\"rate\": %lu,", clk_core_get_rate(c));
 	seq_printf(s, "\"accuracy\": %lu,", clk_core_get_accuracy(c));
 	seq_printf(s, "\"phase\": %d", clk_core_get_phase(c));
@@ -331,12 +364,12 @@ static int clk_debug_create_one(struct clk_core *clk, struct dentry *pdentry)
 		goto err_out;
 
 	d = debugfs_create_u32("clk_prepare_count", S_IRUGO, clk->dentry,
-			(u32 *)&clk->prepare_count);
+			(u32 *)&clk->prepare_count.counter);
 	if (!d)
 		goto err_out;
 
 	d = debugfs_create_u32("clk_enable_count", S_IRUGO, clk->dentry,
-			(u32 *)&clk->enable_count);
+			(u32 *)&clk->enable_count.counter);
 	if (!d)
 		goto err_out;
 
@@ -489,7 +522,7 @@ static void clk_unprepare_unused_subtree(struct clk_core *clk)
 	hlist_for_each_entry(child, &clk->children, child_node)
 		clk_unprepare_unused_subtree(child);
 
-	if (clk->prepare_count)
+	if (atomic_read(&clk->prepare_count))
 		return;
 
 	if (clk->flags & CLK_IGNORE_UNUSED)
@@ -512,13 +545,13 @@ static void clk_core_unprepare(struct clk_core *clk)
 	if (!clk)
 		return;
 
-	if (WARN_ON(clk->prepare_count == 0))
+	if (WARN_ON(atomic_read(&clk->prepare_count) == 0))
 		return;
 
-	if (--clk->prepare_count > 0)
+	if (!atomic_dec_and_test(&clk->prepare_count))
 		return;
 
-	WARN_ON(clk->enable_count > 0);
+	WARN_ON(atomic_read(&clk->enable_count) > 0);
 
 	trace_clk_unprepare(clk);
 
@@ -545,6 +578,9 @@ void clk_unprepare(struct clk *clk)
 	if (IS_ERR_OR_NULL(clk))
 		return;
 
+	if (clk_count_put_fast(&clk->core->prepare_count))
+		return;
+
 	clk_prepare_lock();
 	clk_core_unprepare(clk->core);
 	clk_prepare_unlock();
@@ -558,7 +594,7 @@ static int clk_core_prepare(struct clk_core *clk)
 	if (!clk)
 		return 0;
 
-	if (clk->prepare_count == 0) {
+	if (atomic_read(&clk->prepare_count) == 0) {
 		ret = clk_core_prepare(clk->parent);
 		if (ret)
 			return ret;
@@ -576,7 +612,8 @@ static int clk_core_prepare(struct clk_core *clk)
 		}
 	}
 
-	clk->prepare_count++;
+	smp_mb__before_atomic();
+	atomic_inc(&clk->prepare_count);
 
 	return 0;
 }
@@ -600,6 +637,9 @@ int clk_prepare(struct clk *clk)
 	if (!clk)
 		return 0;
 
+	if (clk_count_get_fast(&clk->core->prepare_count))
+		return 0;
+
 	clk_prepare_lock();
 	ret = clk_core_prepare(clk->core);
 	clk_prepare_unlock();
@@ -613,10 +653,10 @@ static void clk_core_disable(struct clk_core *clk)
 	if (!clk)
 		return;
 
-	if (WARN_ON(clk->enable_count == 0))
+	if (WARN_ON(atomic_read(&clk->enable_count) == 0))
 		return;
 
-	if (--clk->enable_count > 0)
+	if (!atomic_dec_and_test(&clk->enable_count))
 		return;
 
 	trace_clk_disable(clk);
@@ -656,6 +696,9 @@ void clk_disable(struct clk *clk)
 	if (IS_ERR_OR_NULL(clk))
 		return;
 
+	if (clk_count_put_fast(&clk->core->enable_count))
+		return;
+
 	flags = clk_enable_lock();
 	__clk_disable(clk);
 	clk_enable_unlock(flags);
@@ -669,10 +712,10 @@ static int clk_core_enable(struct clk_core *clk)
 	if (!clk)
 		return 0;
 
-	if (WARN_ON(clk->prepare_count == 0))
+	if (WARN_ON(atomic_read(&clk->prepare_count) == 0))
 		return -ESHUTDOWN;
 
-	if (clk->enable_count == 0) {
+	if (atomic_read(&clk->enable_count) == 0) {
 		ret = clk_core_enable(clk->parent);
 
 		if (ret)
@@ -691,7 +734,8 @@ static int clk_core_enable(struct clk_core *clk)
 		}
 	}
 
-	clk->enable_count++;
+	smp_mb__before_atomic();
+	atomic_inc(&clk->enable_count);
 	return 0;
 }
 
@@ -721,6 +765,9 @@ int clk_enable(struct clk *clk)
 	unsigned long flags;
 	int ret;
 
+	if (clk && clk_count_get_fast(&clk->core->enable_count))
+		return 0;
+
 	flags = clk_enable_lock();
 	ret = __clk_enable(clk);
 	clk_enable_unlock(flags);
@@ -749,7 +796,7 @@ static void clk_disable_unused_subtree(struct clk_core *clk)
 
 	flags = clk_enable_lock();
 
-	if (clk->enable_count)
+	if (atomic_read(&clk->enable_count))
 		goto unlock_out;
 
 	if (clk->flags & CLK_IGNORE_UNUSED)
@@ -874,7 +921,7 @@ EXPORT_SYMBOL_GPL(clk_get_parent_by_index);
 
 unsigned int __clk_get_enable_count(struct clk *clk)
 {
-	return !clk ? 0 : clk->core->enable_count;
+	return !clk ? 0 : atomic_read(&clk->core->enable_count);
 }
 
 static unsigned long clk_core_get_rate_nolock(struct clk_core *clk)
@@ -933,7 +980,7 @@ static bool clk_core_is_prepared(struct clk_core *clk)
 	 * fall back to software usage counter if it is missing
 	 */
 	if (!clk->ops->is_prepared) {
-		ret = clk->prepare_count ? 1 : 0;
+		ret = atomic_read(&clk->prepare_count) ? 1 : 0;
 		goto out;
 	}
 
@@ -962,7 +1009,7 @@ static bool clk_core_is_enabled(struct clk_core *clk)
 	 * fall back to software usage counter if .is_enabled is missing
 	 */
 	if (!clk->ops->is_enabled) {
-		ret = clk->enable_count ? 1 : 0;
+		ret = atomic_read(&clk->enable_count) ? 1 : 0;
 		goto out;
 	}
 
@@ -1489,11 +1536,11 @@ static struct clk_core *__clk_set_parent_before(struct clk_core *clk,
 	 * 2. enable two parents clock for .set_parent() operation if finding
 	 * flag CLK_SET_PARENT_ON
 	 */
-	if (clk->prepare_count || clk->flags & CLK_SET_PARENT_ON) {
+	if (atomic_read(&clk->prepare_count) || clk->flags & CLK_SET_PARENT_ON) {
 		clk_core_prepare(parent);
 		flags = clk_enable_lock();
 		clk_core_enable(parent);
-		if (clk->prepare_count) {
+		if (atomic_read(&clk->prepare_count)) {
 			clk_core_enable(clk);
 		} else {
 			clk_core_prepare(old_parent);
@@ -1520,11 +1567,11 @@ static void __clk_set_parent_after(struct clk_core *core,
 	 * Finish the migration of prepare state and undo the changes done
 	 * for preventing a race with clk_enable().
 	 */
-	if (core->prepare_count || core->flags & CLK_SET_PARENT_ON) {
+	if (atomic_read(&core->prepare_count) || core->flags & CLK_SET_PARENT_ON) {
 		flags = clk_enable_lock();
 		clk_core_disable(old_parent);
 		clk_core_unprepare(old_parent);
-		if (core->prepare_count) {
+		if (atomic_read(&core->prepare_count)) {
 			clk_core_disable(core);
 		} else {
 			clk_core_disable(parent);
@@ -1556,11 +1603,11 @@ static int __clk_set_parent(struct clk_core *clk, struct clk_core *parent,
 		clk_reparent(clk, old_parent);
 		clk_enable_unlock(flags);
 
-		if (clk->prepare_count || clk->flags & CLK_SET_PARENT_ON) {
+		if (atomic_read(&clk->prepare_count) || clk->flags & CLK_SET_PARENT_ON) {
 			flags = clk_enable_lock();
 			clk_core_disable(parent);
 			clk_core_unprepare(parent);
-			if (clk->prepare_count) {
+			if (atomic_read(&clk->prepare_count)) {
 				clk_core_disable(clk);
 			} else {
 				clk_core_disable(old_parent);
@@ -1706,7 +1753,7 @@ static struct clk_core *clk_calc_new_rates(struct clk_core *clk,
 
 	/* some clocks must be gated to change parent */
 	if (parent != old_parent &&
-	    (clk->flags & CLK_SET_PARENT_GATE) && clk->prepare_count) {
+	    (clk->flags & CLK_SET_PARENT_GATE) && atomic_read(&clk->prepare_count)) {
 		pr_debug("%s: %s not gated but wants to reparent\n",
 			 __func__, clk->name);
 		return NULL;
@@ -1862,7 +1909,7 @@ static int clk_core_set_rate_nolock(struct clk_core *clk,
 	if (rate == clk_core_get_rate_nolock(clk))
 		return 0;
 
-	if ((clk->flags & CLK_SET_RATE_GATE) && clk->prepare_count)
+	if ((clk->flags & CLK_SET_RATE_GATE) && atomic_read(&clk->prepare_count))
 		return -EBUSY;
 
 	/* calculate new rates and get the topmost changed clock */
@@ -2128,7 +2175,7 @@ static int clk_core_set_parent(struct clk_core *clk, struct clk_core *parent)
 	}
 
 	/* check that we are allowed to re-parent if the clock is in use */
-	if ((clk->flags & CLK_SET_PARENT_GATE) && clk->prepare_count) {
+	if ((clk->flags & CLK_SET_PARENT_GATE) && atomic_read(&clk->prepare_count)) {
 		ret = -EBUSY;
 		goto out;
 	}
@@ -2706,7 +2753,7 @@ void clk_unregister(struct clk *clk)
 
 	hlist_del_init(&clk->core->child_node);
 
-	if (clk->core->prepare_count)
+	if (atomic_read(&clk->core->prepare_count))
 		pr_warn("%s: unregistering prepared clock: %s\n",
 					__func__, clk->core->name);
 	kref_put(&clk->core->ref, __clk_release);
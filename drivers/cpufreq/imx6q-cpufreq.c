@@ -12,6 +12,7 @@
 #include <linux/cpu.h>
 #include <linux/cpufreq.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/pm_opp.h>
@@ -57,15 +58,25 @@ static u32 soc_opp_count;
 static bool ignore_dc_reg;
 static bool low_power_run_support;
 
-static int imx6q_set_target(struct cpufreq_policy *policy, unsigned int index)
+/*
+ * Measured transition times. trans_lat_ns[old * trans_num + new] holds the
+ * worst time seen for a change from OPP old to OPP new.
+ */
+static u32 *trans_lat_ns;
+static unsigned int trans_num;
+static u64 trans_count;
+static u64 trans_total_ns;
+static u32 trans_max_ns;
+
+static int __imx6q_set_target(struct cpufreq_policy *policy, unsigned int index,
+			      int old_index)
 {
 	struct dev_pm_opp *opp;
 	unsigned long freq_hz, volt, volt_old;
 	unsigned int old_freq, new_freq;
+	bool soc_same;
 	int ret;
 
-	mutex_lock(&set_cpufreq_lock);
-
 	new_freq = freq_table[index].frequency;
 	freq_hz = new_freq * 1000;
 	old_freq = policy->cur;
@@ -76,17 +87,14 @@ static int imx6q_set_target(struct cpufreq_policy *policy, unsigned int index)
 	 * from 24MHz to 198Mhz directly. busfreq will handle this
 	 * when exit from low bus mode.
 	 */
-	if (old_freq == FREQ_24_MHZ && new_freq == FREQ_198_MHZ) {
-		mutex_unlock(&set_cpufreq_lock);
+	if (old_freq == FREQ_24_MHZ && new_freq == FREQ_198_MHZ)
 		return 0;
-	};
 
 	rcu_read_lock();
 	opp = dev_pm_opp_find_freq_ceil(cpu_dev, &freq_hz);
 	if (IS_ERR(opp)) {
 		rcu_read_unlock();
 		dev_err(cpu_dev, "failed to find OPP for %ld\n", freq_hz);
-		mutex_unlock(&set_cpufreq_lock);
 		return PTR_ERR(opp);
 	}
 
@@ -108,27 +116,34 @@ static int imx6q_set_target(struct cpufreq_policy *policy, unsigned int index)
 		request_bus_freq(BUS_FREQ_HIGH);
 	}
 
+	/*
+	 * OPPs often share vddsoc/vddpu, and sometimes vddarm, with their
+	 * neighbours. Leave the regulators alone then, every PMIC access is
+	 * a bus transfer plus possibly a ramp delay.
+	 */
+	soc_same = old_index >= 0 &&
+		   imx6_soc_volt[old_index] == imx6_soc_volt[index];
+
 	/* scaling up?  scale voltage before frequency */
-	if (new_freq > old_freq) {
+	if (new_freq > old_freq && !soc_same) {
 		if (!IS_ERR(pu_reg)) {
 			ret = regulator_set_voltage_tol(pu_reg, imx6_soc_volt[index], 0);
 			if (ret) {
 				dev_err(cpu_dev, "failed to scale vddpu up: %d\n", ret);
-				mutex_unlock(&set_cpufreq_lock);
 				return ret;
 			}
 		}
 		ret = regulator_set_voltage_tol(soc_reg, imx6_soc_volt[index], 0);
 		if (ret) {
 			dev_err(cpu_dev, "failed to scale vddsoc up: %d\n", ret);
-			mutex_unlock(&set_cpufreq_lock);
 			return ret;
 		}
+	}
+	if (new_freq > old_freq && volt != volt_old) {
 		ret = regulator_set_voltage_tol(arm_reg, volt, 0);
 		if (ret) {
 			dev_err(cpu_dev,
 				"failed to scale vddarm up: %d\n", ret);
-			mutex_unlock(&set_cpufreq_lock);
 			return ret;
 		}
 	}
@@ -187,18 +202,19 @@ static int imx6q_set_target(struct cpufreq_policy *policy, unsigned int index)
 	if (ret) {
 		dev_err(cpu_dev, "failed to set clock rate: %d\n", ret);
 		regulator_set_voltage_tol(arm_reg, volt_old, 0);
-		mutex_unlock(&set_cpufreq_lock);
 		return ret;
 	}
 
 	/* scaling down?  scale voltage after frequency */
-	if (new_freq < old_freq) {
+	if (new_freq < old_freq && volt != volt_old) {
 		ret = regulator_set_voltage_tol(arm_reg, volt, 0);
 		if (ret) {
 			dev_warn(cpu_dev,
 				 "failed to scale vddarm down: %d\n", ret);
 			ret = 0;
 		}
+	}
+	if (new_freq < old_freq && !soc_same) {
 		ret = regulator_set_voltage_tol(soc_reg, imx6_soc_volt[index], 0);
 		if (ret) {
 			dev_warn(cpu_dev, "failed to scale vddsoc down: %d\n", ret);
@@ -223,10 +239,100 @@ static int imx6q_set_target(struct cpufreq_policy *policy, unsigned int index)
 		release_bus_freq(BUS_FREQ_HIGH);
 	}
 
-	mutex_unlock(&set_cpufreq_lock);
 	return 0;
 }
 
+static int imx6q_set_target(struct cpufreq_policy *policy, unsigned int index)
+{
+	ktime_t start;
+	u32 delta;
+	int old_index;
+	int ret;
+
+	mutex_lock(&set_cpufreq_lock);
+
+	old_index = cpufreq_frequency_table_get_index(policy, policy->cur);
+
+	start = ktime_get();
+	ret = __imx6q_set_target(policy, index, old_index);
+	delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (!ret && old_index >= 0 && trans_lat_ns) {
+		u32 *lat = &trans_lat_ns[old_index * trans_num + index];
+
+		if (delta > *lat)
+			*lat = delta;
+		if (delta > trans_max_ns)
+			trans_max_ns = delta;
+		trans_count++;
+		trans_total_ns += delta;
+	}
+
+	mutex_unlock(&set_cpufreq_lock);
+
+	return ret;
+}
+
+static ssize_t show_transition_latency_table(struct cpufreq_policy *policy,
+					     char *buf)
+{
+	ssize_t len = 0;
+	unsigned int i, j;
+
+	if (!trans_lat_ns)
+		return -ENODEV;
+
+	mutex_lock(&set_cpufreq_lock);
+
+	/* one row per source OPP, in microseconds, 0 for never measured */
+	len += scnprintf(buf + len, PAGE_SIZE - len, "   From  :    To\n");
+	len += scnprintf(buf + len, PAGE_SIZE - len, "         : ");
+	for (j = 0; j < trans_num; j++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%9u ",
+				 freq_table[j].frequency);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	for (i = 0; i < trans_num; i++) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%9u: ",
+				 freq_table[i].frequency);
+		for (j = 0; j < trans_num; j++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, "%9u ",
+					 trans_lat_ns[i * trans_num + j] / 1000);
+		len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+
+	mutex_unlock(&set_cpufreq_lock);
+
+	return len;
+}
+cpufreq_freq_attr_ro(transition_latency_table);
+
+static ssize_t show_transition_stats(struct cpufreq_policy *policy, char *buf)
+{
+	u64 count, total, avg = 0;
+	u32 max;
+
+	mutex_lock(&set_cpufreq_lock);
+	count = trans_count;
+	total = trans_total_ns;
+	max = trans_max_ns;
+	mutex_unlock(&set_cpufreq_lock);
+
+	if (count)
+		avg = div64_u64(total, count);
+
+	/* count, then average and worst transition time in nanoseconds */
+	return sprintf(buf, "%llu %llu %u\n", count, avg, max);
+}
+cpufreq_freq_attr_ro(transition_stats);
+
+static struct freq_attr *imx6q_cpufreq_attr[] = {
+	&cpufreq_freq_attr_scaling_available_freqs,
+	&transition_latency_table,
+	&transition_stats,
+	NULL,
+};
+
 static int imx6q_cpufreq_init(struct cpufreq_policy *policy)
 {
 	int ret;
@@ -255,7 +361,7 @@ static struct cpufreq_driver imx6q_cpufreq_driver = {
 	.get = cpufreq_generic_get,
 	.init = imx6q_cpufreq_init,
 	.name = "imx6q-cpufreq",
-	.attr = cpufreq_generic_attr,
+	.attr = imx6q_cpufreq_attr,
 };
 
 static int imx6_cpufreq_pm_notify(struct notifier_block *nb,
@@ -415,6 +521,14 @@ static int imx6q_cpufreq_probe(struct platform_device *pdev)
 	if (!IS_ERR(dc_reg) && !ignore_dc_reg)
 		regulator_set_voltage_tol(dc_reg, DC_VOLTAGE_MIN, 0);
 
+	trans_num = num;
+	trans_lat_ns = devm_kcalloc(cpu_dev, num * num, sizeof(*trans_lat_ns),
+				    GFP_KERNEL);
+	if (!trans_lat_ns) {
+		ret = -ENOMEM;
+		goto free_freq_table;
+	}
+
 	/* Make imx6_soc_volt array's size same as arm opp number */
 	imx6_soc_volt = devm_kzalloc(cpu_dev, sizeof(*imx6_soc_volt) * num, GFP_KERNEL);
 	if (imx6_soc_volt == NULL) {
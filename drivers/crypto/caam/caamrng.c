@@ -26,14 +26,18 @@
  * | (output buffer)   |
  * ---------------------
  *
- * The SharedDesc never changes, and each job descriptor points to one of two
- * buffers for each device, from which the data will be copied into the
- * requested destination
+ * The SharedDesc never changes, and each job descriptor points to one of
+ * rng_bufs buffers for each device, from which the data will be copied into
+ * the requested destination.  Buffers are read in turn and a drained one is
+ * resubmitted straight away, so all but the one being read from are being
+ * refilled in the job ring at any time.
  */
 
 #include <linux/hw_random.h>
 #include <linux/completion.h>
 #include <linux/atomic.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
 
 #include "compat.h"
 
@@ -54,12 +58,28 @@
 #define DESC_JOB_O_LEN			(CAAM_CMD_SZ * 2 + CAAM_PTR_SZ * 2)
 #define DESC_RNG_LEN			(4 * CAAM_CMD_SZ)
 
+#define RN_BUFS_MAX			8
+
+static unsigned int rng_bufs = 4;
+module_param(rng_bufs, uint, 0444);
+MODULE_PARM_DESC(rng_bufs, "Number of 64k buffers refilled in parallel (2-8)");
+
+/*
+ * The RNG4 output is entropy from the TRNG stretched through the DRBG, so
+ * by default only half of it is credited when khwrngd feeds the input pool.
+ */
+static unsigned short rng_quality = 512;
+module_param(rng_quality, ushort, 0444);
+MODULE_PARM_DESC(rng_quality,
+		 "Entropy credited per 1024 bits read, 0 to only mix it in");
+
 /* Buffer, its dma address and lock */
 struct buf_data {
-	u8 buf[RN_BUF_SIZE] ____cacheline_aligned;
+	u8 *buf;
 	dma_addr_t addr;
 	struct completion filled;
 	u32 hw_desc[DESC_JOB_O_LEN];
+	u64 submitted;
 #define BUF_NOT_EMPTY 0
 #define BUF_EMPTY 1
 #define BUF_PENDING 2  /* Empty, but with job pending --don't submit another */
@@ -73,7 +93,16 @@ struct caam_rng_ctx {
 	u32 sh_desc[DESC_RNG_LEN];
 	unsigned int cur_buf_idx;
 	int current_buf;
-	struct buf_data bufs[2];
+	int num_bufs;
+	struct buf_data bufs[RN_BUFS_MAX];
+
+	/* statistics, the job ones are only updated from rng_done() */
+	u64 bytes_read;
+	u64 read_waits;
+	u64 jobs_done;
+	u64 job_errors;
+	u64 busy_ns;
+	u64 last_done;
 };
 
 static struct caam_rng_ctx *rng_ctx;
@@ -91,29 +120,47 @@ static inline void rng_unmap_buf(struct device *jrdev, struct buf_data *bd)
 static inline void rng_unmap_ctx(struct caam_rng_ctx *ctx)
 {
 	struct device *jrdev = ctx->jrdev;
+	int i;
 
 	if (ctx->sh_desc_dma)
 		dma_unmap_single(jrdev, ctx->sh_desc_dma,
 				 desc_bytes(ctx->sh_desc), DMA_TO_DEVICE);
-	rng_unmap_buf(jrdev, &ctx->bufs[0]);
-	rng_unmap_buf(jrdev, &ctx->bufs[1]);
+	for (i = 0; i < ctx->num_bufs; i++)
+		rng_unmap_buf(jrdev, &ctx->bufs[i]);
 }
 
 static void rng_done(struct device *jrdev, u32 *desc, u32 err, void *context)
 {
+	struct caam_rng_ctx *ctx = context;
 	struct buf_data *bd;
+	u64 now = local_clock();
 
 	bd = (struct buf_data *)((char *)desc -
 	      offsetof(struct buf_data, hw_desc));
 
-	if (err)
-		caam_jr_strstatus(jrdev, err);
+	/*
+	 * The ring runs the jobs one after the other, so a job has only been
+	 * worked on since the previous one finished or since it was queued.
+	 */
+	ctx->busy_ns += now - max(bd->submitted, ctx->last_done);
+	ctx->last_done = now;
 
-	atomic_set(&bd->empty, BUF_NOT_EMPTY);
-	complete(&bd->filled);
+	if (err) {
+		caam_jr_strstatus(jrdev, err);
+		ctx->job_errors++;
+		atomic_set(&bd->empty, BUF_EMPTY);
+		complete(&bd->filled);
+		return;
+	}
 
 	/* Buffer refilled, invalidate cache */
 	dma_sync_single_for_cpu(jrdev, bd->addr, RN_BUF_SIZE, DMA_FROM_DEVICE);
+	ctx->jobs_done++;
+
+	/* pairs with smp_rmb() in caam_read() */
+	smp_wmb();
+	atomic_set(&bd->empty, BUF_NOT_EMPTY);
+	complete(&bd->filled);
 
 #ifdef DEBUG
 	print_hex_dump(KERN_ERR, "rng refreshed buf@: ",
@@ -121,20 +168,23 @@ static void rng_done(struct device *jrdev, u32 *desc, u32 err, void *context)
 #endif
 }
 
-static inline int submit_job(struct caam_rng_ctx *ctx, int to_current)
+static inline int submit_job(struct caam_rng_ctx *ctx, int buf_id)
 {
-	struct buf_data *bd = &ctx->bufs[!(to_current ^ ctx->current_buf)];
+	struct buf_data *bd = &ctx->bufs[buf_id];
 	struct device *jrdev = ctx->jrdev;
 	u32 *desc = bd->hw_desc;
 	int err;
 
-	dev_dbg(jrdev, "submitting job %d\n", !(to_current ^ ctx->current_buf));
+	dev_dbg(jrdev, "submitting job %d\n", buf_id);
 	init_completion(&bd->filled);
+	bd->submitted = local_clock();
+	/* note as pending before the job can complete */
+	atomic_set(&bd->empty, BUF_PENDING);
 	err = caam_jr_enqueue(jrdev, desc, rng_done, ctx);
-	if (err)
+	if (err) {
+		atomic_set(&bd->empty, BUF_EMPTY);
 		complete(&bd->filled); /* don't wait on failed job*/
-	else
-		atomic_inc(&bd->empty); /* note if pending */
+	}
 
 	return err;
 }
@@ -149,7 +199,7 @@ static int caam_read(struct hwrng *rng, void *data, size_t max, bool wait)
 	if (atomic_read(&bd->empty)) {
 		/* try to submit job if there wasn't one */
 		if (atomic_read(&bd->empty) == BUF_EMPTY) {
-			err = submit_job(ctx, 1);
+			err = submit_job(ctx, ctx->current_buf);
 			/* if can't submit job, can't even wait */
 			if (err)
 				return 0;
@@ -159,9 +209,16 @@ static int caam_read(struct hwrng *rng, void *data, size_t max, bool wait)
 			return 0;
 
 		/* waiting for pending job */
-		if (atomic_read(&bd->empty))
+		if (atomic_read(&bd->empty)) {
+			ctx->read_waits++;
 			wait_for_completion(&bd->filled);
+		}
+
+		/* the job failed */
+		if (atomic_read(&bd->empty))
+			return 0;
 	}
+	smp_rmb();
 
 	next_buf_idx = ctx->cur_buf_idx + max;
 	dev_dbg(ctx->jrdev, "%s: start reading at buffer %d, idx %d\n",
@@ -171,6 +228,7 @@ static int caam_read(struct hwrng *rng, void *data, size_t max, bool wait)
 	if (next_buf_idx < RN_BUF_SIZE) {
 		memcpy(data, bd->buf + ctx->cur_buf_idx, max);
 		ctx->cur_buf_idx = next_buf_idx;
+		ctx->bytes_read += max;
 		return max;
 	}
 
@@ -178,13 +236,14 @@ static int caam_read(struct hwrng *rng, void *data, size_t max, bool wait)
 	copied_idx = RN_BUF_SIZE - ctx->cur_buf_idx;
 	memcpy(data, bd->buf + ctx->cur_buf_idx, copied_idx);
 	ctx->cur_buf_idx = 0;
+	ctx->bytes_read += copied_idx;
 	atomic_set(&bd->empty, BUF_EMPTY);
 
 	/* ...refill... */
-	submit_job(ctx, 1);
+	submit_job(ctx, ctx->current_buf);
 
 	/* and use next buffer */
-	ctx->current_buf = !ctx->current_buf;
+	ctx->current_buf = (ctx->current_buf + 1) % ctx->num_bufs;
 	dev_dbg(ctx->jrdev, "switched to buffer %d\n", ctx->current_buf);
 
 	/* since there already is some data read, don't wait */
@@ -212,6 +271,7 @@ static inline int rng_create_sh_desc(struct caam_rng_ctx *ctx)
 					  DMA_TO_DEVICE);
 	if (dma_mapping_error(jrdev, ctx->sh_desc_dma)) {
 		dev_err(jrdev, "unable to map shared descriptor\n");
+		ctx->sh_desc_dma = 0;
 		return -ENOMEM;
 	}
 	dma_sync_single_for_device(jrdev, ctx->sh_desc_dma, desc_bytes(desc),
@@ -234,9 +294,14 @@ static inline int rng_create_job_desc(struct caam_rng_ctx *ctx, int buf_id)
 	init_job_desc_shared(desc, ctx->sh_desc_dma, sh_len, HDR_SHARE_DEFER |
 			     HDR_REVERSE);
 
+	bd->buf = kmalloc(RN_BUF_SIZE, GFP_KERNEL | GFP_DMA);
+	if (!bd->buf)
+		return -ENOMEM;
+
 	bd->addr = dma_map_single(jrdev, bd->buf, RN_BUF_SIZE, DMA_FROM_DEVICE);
 	if (dma_mapping_error(jrdev, bd->addr)) {
 		dev_err(jrdev, "unable to map dst\n");
+		bd->addr = 0;
 		return -ENOMEM;
 	}
 
@@ -248,20 +313,88 @@ static inline int rng_create_job_desc(struct caam_rng_ctx *ctx, int buf_id)
 	return 0;
 }
 
-static void caam_cleanup(struct hwrng *rng)
+/* Also undoes a partial caam_init_rng(): the unused buffers are zeroed */
+static void caam_rng_stop(struct caam_rng_ctx *ctx)
 {
 	int i;
 	struct buf_data *bd;
 
-	for (i = 0; i < 2; i++) {
-		bd = &rng_ctx->bufs[i];
+	for (i = 0; i < ctx->num_bufs; i++) {
+		bd = &ctx->bufs[i];
 		if (atomic_read(&bd->empty) == BUF_PENDING)
 			wait_for_completion(&bd->filled);
 	}
 
-	rng_unmap_ctx(rng_ctx);
+	rng_unmap_ctx(ctx);
+}
+
+static void caam_cleanup(struct hwrng *rng)
+{
+	caam_rng_stop(rng_ctx);
+}
+
+static void caam_free_bufs(struct caam_rng_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ctx->num_bufs; i++)
+		kfree(ctx->bufs[i].buf);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *caam_rng_dfs;
+
+static int caam_rng_stats_show(struct seq_file *m, void *v)
+{
+	struct caam_rng_ctx *ctx = m->private;
+	u64 generated = ctx->jobs_done * RN_BUF_SIZE;
+	u64 busy_us = div_u64(ctx->busy_ns, NSEC_PER_USEC);
+
+	seq_printf(m, "buffers:\t%d x %lu\n", ctx->num_bufs,
+		   (unsigned long)RN_BUF_SIZE);
+	seq_printf(m, "bytes_read:\t%llu\n", ctx->bytes_read);
+	seq_printf(m, "read_waits:\t%llu\n", ctx->read_waits);
+	seq_printf(m, "jobs:\t\t%llu\n", ctx->jobs_done);
+	seq_printf(m, "job_errors:\t%llu\n", ctx->job_errors);
+	/* bytes per microsecond are MB/s */
+	seq_printf(m, "throughput:\t%llu MB/s\n",
+		   busy_us ? div64_u64(generated, busy_us) : 0);
+	return 0;
+}
+
+static int caam_rng_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, caam_rng_stats_show, inode->i_private);
 }
 
+static const struct file_operations caam_rng_stats_fops = {
+	.open		= caam_rng_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void caam_rng_debugfs_init(struct caam_drv_private *ctrlpriv)
+{
+	caam_rng_dfs = debugfs_create_file("rng_stats", S_IRUSR,
+					   ctrlpriv->dfs_root, rng_ctx,
+					   &caam_rng_stats_fops);
+}
+
+static void caam_rng_debugfs_exit(void)
+{
+	debugfs_remove(caam_rng_dfs);
+}
+#else
+static inline void caam_rng_debugfs_init(struct caam_drv_private *ctrlpriv)
+{
+}
+
+static inline void caam_rng_debugfs_exit(void)
+{
+}
+#endif
+
 #ifdef CONFIG_CRYPTO_DEV_FSL_CAAM_RNG_TEST
 static inline void test_len(struct hwrng *rng, size_t len, bool wait)
 {
@@ -315,15 +448,14 @@ static int caam_init_buf(struct caam_rng_ctx *ctx, int buf_id)
 		return err;
 
 	atomic_set(&bd->empty, BUF_EMPTY);
-	submit_job(ctx, buf_id == ctx->current_buf);
-	wait_for_completion(&bd->filled);
+	submit_job(ctx, buf_id);
 
 	return 0;
 }
 
 static int caam_init_rng(struct caam_rng_ctx *ctx, struct device *jrdev)
 {
-	int err;
+	int err, i;
 
 	ctx->jrdev = jrdev;
 
@@ -333,16 +465,27 @@ static int caam_init_rng(struct caam_rng_ctx *ctx, struct device *jrdev)
 
 	ctx->current_buf = 0;
 	ctx->cur_buf_idx = 0;
+	ctx->num_bufs = clamp_t(unsigned int, rng_bufs, 2, RN_BUFS_MAX);
 
-	err = caam_init_buf(ctx, 0);
-	if (err)
-		return err;
+	for (i = 0; i < ctx->num_bufs; i++) {
+		err = caam_init_buf(ctx, i);
+		if (err)
+			goto err_unwind;
+	}
 
-	err = caam_init_buf(ctx, 1);
-	if (err)
-		return err;
+	/*
+	 * Only wait for the first buffer, which hwrng_register() reads from
+	 * to seed the pools; the others fill in the background.
+	 */
+	wait_for_completion(&ctx->bufs[0].filled);
 
 	return 0;
+
+err_unwind:
+	/* wait for the jobs already queued before the buffers go */
+	caam_rng_stop(ctx);
+	caam_free_bufs(ctx);
+	return err;
 }
 
 static struct hwrng caam_rng = {
@@ -353,8 +496,10 @@ static struct hwrng caam_rng = {
 
 static void __exit caam_rng_exit(void)
 {
+	caam_rng_debugfs_exit();
 	caam_jr_free(rng_ctx->jrdev);
 	hwrng_unregister(&caam_rng);
+	caam_free_bufs(rng_ctx);
 	kfree(rng_ctx);
 }
 
@@ -396,19 +541,43 @@ static int __init caam_rng_init(void)
 		pr_err("Job Ring Device allocation for transform failed\n");
 		return PTR_ERR(dev);
 	}
-	rng_ctx = kmalloc(sizeof(struct caam_rng_ctx), GFP_DMA);
-	if (!rng_ctx)
-		return -ENOMEM;
+	rng_ctx = kzalloc(sizeof(struct caam_rng_ctx), GFP_KERNEL | GFP_DMA);
+	if (!rng_ctx) {
+		err = -ENOMEM;
+		goto free_caam_alloc;
+	}
 	err = caam_init_rng(rng_ctx, dev);
 	if (err)
-		return err;
+		goto free_rng_ctx;
+
+	/*
+	 * With a quality set, hwrng_register() starts khwrngd, which credits
+	 * what it reads to the input pool right away instead of leaving the
+	 * pools to wait for interrupt and disk timings.
+	 */
+	caam_rng.quality = min_t(unsigned short, rng_quality, 1024);
 
 #ifdef CONFIG_CRYPTO_DEV_FSL_CAAM_RNG_TEST
 	self_test(&caam_rng);
 #endif
 
 	dev_info(dev, "registering rng-caam\n");
-	return hwrng_register(&caam_rng);
+	err = hwrng_register(&caam_rng);
+	if (err)
+		goto free_rng_bufs;
+
+	/* the stats file reads rng_ctx, don't expose it before this point */
+	caam_rng_debugfs_init(priv);
+	return 0;
+
+free_rng_bufs:
+	caam_rng_stop(rng_ctx);
+	caam_free_bufs(rng_ctx);
+free_rng_ctx:
+	kfree(rng_ctx);
+free_caam_alloc:
+	caam_jr_free(dev);
+	return err;
 }
 
 module_init(caam_rng_init);
@@ -23,6 +23,19 @@
 #define JOBR_INTC_COUNT_THLD 0
 #endif
 
+/* Most completions handled per tasklet run before yielding the CPU */
+#define JOBR_DEQUEUE_BUDGET 64
+
+/* Per job ring counters, exported through the "stats" sysfs file */
+struct caam_jr_stats {
+	unsigned long irqs;		/* Interrupts serviced */
+	unsigned long jobs;		/* Completed jobs dequeued */
+	unsigned long batches;		/* Output ring batches dequeued */
+	unsigned long max_batch;	/* Largest single batch */
+	unsigned long resched;		/* Tasklet runs that used the budget */
+	unsigned long enq_busy;		/* Enqueues refused, ring full */
+};
+
 /*
  * Storage for tracking each in-process entry moving across a ring
  * Each entry on an output ring needs one of these
@@ -58,6 +71,12 @@ struct caam_drv_private_jr {
 	int out_ring_read_index;	/* Output index "tail" */
 	int tail;			/* entinfo (s/w ring) tail index */
 	struct jr_outentry *outring;	/* Base of output ring, DMA-safe */
+
+	/* Interrupt coalescing thresholds, both nonzero to enable */
+	unsigned int intc_count;	/* Completions per interrupt */
+	unsigned int intc_time;		/* Timeout, in bus clocks / 64 */
+
+	struct caam_jr_stats stats;
 };
 
 /*
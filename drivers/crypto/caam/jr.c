@@ -62,6 +62,112 @@ static int caam_reset_hw_jr(struct device *dev)
 	return 0;
 }
 
+/*
+ * Program the coalescing thresholds; the interrupt and the tasklet are
+ * held off so their updates of the mask bit are not lost.
+ */
+static void caam_jr_set_coalescing(struct caam_drv_private_jr *jrp)
+{
+	u32 cfg;
+
+	disable_irq(jrp->irq);
+	tasklet_disable(&jrp->irqtask);
+
+	cfg = rd_reg32(&jrp->rregs->rconfig_lo);
+	cfg &= ~(JRCFG_ICEN | JRCFG_ICDCT_MASK | JRCFG_ICTT_MASK);
+	if (jrp->intc_count && jrp->intc_time)
+		cfg |= JRCFG_ICEN |
+		       (jrp->intc_count << JRCFG_ICDCT_SHIFT) |
+		       (jrp->intc_time << JRCFG_ICTT_SHIFT);
+	wr_reg32(&jrp->rregs->rconfig_lo, cfg);
+
+	tasklet_enable(&jrp->irqtask);
+	enable_irq(jrp->irq);
+}
+
+static ssize_t caam_jr_coalesce_store(struct device *dev, const char *buf,
+				      size_t count, unsigned int *thld,
+				      unsigned int max)
+{
+	struct caam_drv_private_jr *jrp = dev_get_drvdata(dev);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+	if (val > max)
+		return -EINVAL;
+
+	*thld = val;
+	caam_jr_set_coalescing(jrp);
+
+	return count;
+}
+
+static ssize_t coalesce_count_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct caam_drv_private_jr *jrp = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", jrp->intc_count);
+}
+
+static ssize_t coalesce_count_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct caam_drv_private_jr *jrp = dev_get_drvdata(dev);
+
+	return caam_jr_coalesce_store(dev, buf, count, &jrp->intc_count,
+				      JRCFG_ICDCT_MASK >> JRCFG_ICDCT_SHIFT);
+}
+static DEVICE_ATTR_RW(coalesce_count);
+
+static ssize_t coalesce_time_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct caam_drv_private_jr *jrp = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", jrp->intc_time);
+}
+
+static ssize_t coalesce_time_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct caam_drv_private_jr *jrp = dev_get_drvdata(dev);
+
+	return caam_jr_coalesce_store(dev, buf, count, &jrp->intc_time,
+				      JRCFG_ICTT_MASK >> JRCFG_ICTT_SHIFT);
+}
+static DEVICE_ATTR_RW(coalesce_time);
+
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct caam_drv_private_jr *jrp = dev_get_drvdata(dev);
+	struct caam_jr_stats *st = &jrp->stats;
+
+	return sprintf(buf,
+		       "irqs: %lu\njobs: %lu\nbatches: %lu\nmax_batch: %lu\n"
+		       "resched: %lu\nenq_busy: %lu\n",
+		       st->irqs, st->jobs, st->batches, st->max_batch,
+		       st->resched, st->enq_busy);
+}
+static DEVICE_ATTR_RO(stats);
+
+static struct attribute *caam_jr_attrs[] = {
+	&dev_attr_coalesce_count.attr,
+	&dev_attr_coalesce_time.attr,
+	&dev_attr_stats.attr,
+	NULL
+};
+
+static const struct attribute_group caam_jr_attr_group = {
+	.attrs = caam_jr_attrs,
+};
+
 /*
  * Shutdown JobR independent of platform property code
  */
@@ -112,6 +218,8 @@ static int caam_jr_remove(struct platform_device *pdev)
 	list_del(&jrpriv->list_node);
 	spin_unlock(&driver_data.jr_alloc_lock);
 
+	sysfs_remove_group(&jrdev->kobj, &caam_jr_attr_group);
+
 	/* Release ring */
 	ret = caam_jr_shutdown(jrdev);
 	if (ret)
@@ -146,6 +254,8 @@ static irqreturn_t caam_jr_interrupt(int irq, void *st_dev)
 		BUG();
 	}
 
+	jrp->stats.irqs++;
+
 	/* mask valid interrupts */
 	setbits32(&jrp->rregs->rconfig_lo, JRCFG_IMSK);
 
@@ -159,7 +269,15 @@ static irqreturn_t caam_jr_interrupt(int irq, void *st_dev)
 	return IRQ_HANDLED;
 }
 
-/* Deferred service handler, run as interrupt-fired tasklet */
+/*
+ * Deferred service handler, run as interrupt-fired tasklet.
+ *
+ * Completions are taken off the output ring in batches of whatever the
+ * ring holds, with a single cache sync and a single slot release per
+ * batch. Once JOBR_DEQUEUE_BUDGET jobs have been handled the tasklet
+ * reschedules itself with the interrupt still masked, so a busy ring is
+ * polled rather than interrupting once per job.
+ */
 static void caam_jr_dequeue(unsigned long devarg)
 {
 	int hw_idx, sw_idx, i, head, tail;
@@ -169,71 +287,94 @@ static void caam_jr_dequeue(unsigned long devarg)
 	u32 *userdesc, userstatus;
 	void *userarg;
 	dma_addr_t outbusaddr;
+	int done = 0, used, n;
 
 	outbusaddr = rd_reg64(&jrp->rregs->outring_base);
 
-	while (rd_reg32(&jrp->rregs->outring_used)) {
-
-		head = ACCESS_ONCE(jrp->head);
-
-		spin_lock(&jrp->outlock);
+	while (done < JOBR_DEQUEUE_BUDGET &&
+	       (used = rd_reg32(&jrp->rregs->outring_used))) {
+		used = min(used, JOBR_DEQUEUE_BUDGET - done);
 
-		sw_idx = tail = jrp->tail;
-		hw_idx = jrp->out_ring_read_index;
 		dma_sync_single_for_cpu(dev, outbusaddr,
 					sizeof(struct jr_outentry) * JOBR_DEPTH,
 					DMA_FROM_DEVICE);
 
-		for (i = 0; CIRC_CNT(head, tail + i, JOBR_DEPTH) >= 1; i++) {
-			sw_idx = (tail + i) & (JOBR_DEPTH - 1);
+		for (n = 0; n < used; n++) {
+			head = ACCESS_ONCE(jrp->head);
 
-			if (jrp->outring[hw_idx].desc ==
-			    jrp->entinfo[sw_idx].desc_addr_dma)
-				break; /* found */
-		}
-		/* we should never fail to find a matching descriptor */
-		BUG_ON(CIRC_CNT(head, tail + i, JOBR_DEPTH) <= 0);
-
-		/* Unmap just-run descriptor so we can post-process */
-		dma_unmap_single(dev, jrp->outring[hw_idx].desc,
-				 jrp->entinfo[sw_idx].desc_size,
-				 DMA_TO_DEVICE);
-
-		/* mark completed, avoid matching on a recycled desc addr */
-		jrp->entinfo[sw_idx].desc_addr_dma = 0;
-
-		/* Stash callback params for use outside of lock */
-		usercall = jrp->entinfo[sw_idx].callbk;
-		userarg = jrp->entinfo[sw_idx].cbkarg;
-		userdesc = jrp->entinfo[sw_idx].desc_addr_virt;
-		userstatus = jrp->outring[hw_idx].jrstatus;
-
-		smp_mb();
-
-		/* set done */
-		wr_reg32(&jrp->rregs->outring_rmvd, 1);
-
-		jrp->out_ring_read_index = (jrp->out_ring_read_index + 1) &
-					   (JOBR_DEPTH - 1);
-
-		/*
-		 * if this job completed out-of-order, do not increment
-		 * the tail.  Otherwise, increment tail by 1 plus the
-		 * number of subsequent jobs already completed out-of-order
-		 */
-		if (sw_idx == tail) {
-			do {
-				tail = (tail + 1) & (JOBR_DEPTH - 1);
-			} while (CIRC_CNT(head, tail, JOBR_DEPTH) >= 1 &&
-				 jrp->entinfo[tail].desc_addr_dma == 0);
-
-			jrp->tail = tail;
+			spin_lock(&jrp->outlock);
+
+			sw_idx = tail = jrp->tail;
+			hw_idx = jrp->out_ring_read_index;
+
+			for (i = 0; CIRC_CNT(head, tail + i, JOBR_DEPTH) >= 1;
+			     i++) {
+				sw_idx = (tail + i) & (JOBR_DEPTH - 1);
+
+				if (jrp->outring[hw_idx].desc ==
+				    jrp->entinfo[sw_idx].desc_addr_dma)
+					break; /* found */
+			}
+			/* we should never fail to find a matching descriptor */
+			BUG_ON(CIRC_CNT(head, tail + i, JOBR_DEPTH) <= 0);
+
+			/* Unmap just-run descriptor so we can post-process */
+			dma_unmap_single(dev, jrp->outring[hw_idx].desc,
+					 jrp->entinfo[sw_idx].desc_size,
+					 DMA_TO_DEVICE);
+
+			/* mark completed, avoid matching on recycled addr */
+			jrp->entinfo[sw_idx].desc_addr_dma = 0;
+
+			/* Stash callback params for use outside of lock */
+			usercall = jrp->entinfo[sw_idx].callbk;
+			userarg = jrp->entinfo[sw_idx].cbkarg;
+			userdesc = jrp->entinfo[sw_idx].desc_addr_virt;
+			userstatus = jrp->outring[hw_idx].jrstatus;
+
+			smp_mb();
+
+			jrp->out_ring_read_index =
+				(jrp->out_ring_read_index + 1) &
+				(JOBR_DEPTH - 1);
+
+			/*
+			 * if this job completed out-of-order, do not increment
+			 * the tail.  Otherwise, increment tail by 1 plus the
+			 * number of subsequent jobs already completed
+			 * out-of-order
+			 */
+			if (sw_idx == tail) {
+				do {
+					tail = (tail + 1) & (JOBR_DEPTH - 1);
+				} while (CIRC_CNT(head, tail, JOBR_DEPTH) >= 1 &&
+					 jrp->entinfo[tail].desc_addr_dma == 0);
+
+				jrp->tail = tail;
+			}
+
+			spin_unlock(&jrp->outlock);
+
+			/* Finally, execute user's callback */
+			usercall(dev, userdesc, userstatus, userarg);
 		}
 
-		spin_unlock(&jrp->outlock);
+		/* set done, for the whole batch */
+		wr_reg32(&jrp->rregs->outring_rmvd, used);
 
-		/* Finally, execute user's callback */
-		usercall(dev, userdesc, userstatus, userarg);
+		done += used;
+		jrp->stats.jobs += used;
+		jrp->stats.batches++;
+		if (used > jrp->stats.max_batch)
+			jrp->stats.max_batch = used;
+	}
+
+	/* Budget used up with work left: poll again, IRQs stay masked */
+	if (done >= JOBR_DEQUEUE_BUDGET &&
+	    rd_reg32(&jrp->rregs->outring_used)) {
+		jrp->stats.resched++;
+		tasklet_schedule(&jrp->irqtask);
+		return;
 	}
 
 	/* reenable / unmask IRQs */
@@ -351,6 +492,7 @@ int caam_jr_enqueue(struct device *dev, u32 *desc,
 
 	if (!rd_reg32(&jrp->rregs->inpring_avail) ||
 	    CIRC_SPACE(head, tail, JOBR_DEPTH) <= 0) {
+		jrp->stats.enq_busy++;
 		spin_unlock_bh(&jrp->inplock);
 		dma_unmap_single(dev, desc_dma, desc_size, DMA_TO_DEVICE);
 		return -EBUSY;
@@ -447,9 +589,9 @@ static int caam_jr_init(struct device *dev)
 	spin_lock_init(&jrp->outlock);
 
 	/* Select interrupt coalescing parameters */
-	setbits32(&jrp->rregs->rconfig_lo, JOBR_INTC |
-		  (JOBR_INTC_COUNT_THLD << JRCFG_ICDCT_SHIFT) |
-		  (JOBR_INTC_TIME_THLD << JRCFG_ICTT_SHIFT));
+	jrp->intc_count = JOBR_INTC_COUNT_THLD;
+	jrp->intc_time = JOBR_INTC_TIME_THLD;
+	caam_jr_set_coalescing(jrp);
 
 	return 0;
 
@@ -517,6 +659,8 @@ static int caam_jr_probe(struct platform_device *pdev)
 		return -EINVAL;
 	}
 
+	memset(&jrpriv->stats, 0, sizeof(jrpriv->stats));
+
 	/* Now do the platform independent part */
 	error = caam_jr_init(jrdev); /* now turn on hardware */
 	if (error) {
@@ -531,6 +675,9 @@ static int caam_jr_probe(struct platform_device *pdev)
 
 	atomic_set(&jrpriv->tfm_count, 0);
 
+	if (sysfs_create_group(&jrdev->kobj, &caam_jr_attr_group))
+		dev_warn(jrdev, "failed to create sysfs attributes\n");
+
 	device_init_wakeup(&pdev->dev, 1);
 	device_set_wakeup_enable(&pdev->dev, false);
 
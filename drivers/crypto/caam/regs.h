@@ -731,7 +731,9 @@ struct caam_job_ring {
 #define JRCFG_ICEN		0x02
 #define JRCFG_IMSK		0x01
 #define JRCFG_ICDCT_SHIFT	8
+#define JRCFG_ICDCT_MASK	(0xff << JRCFG_ICDCT_SHIFT)
 #define JRCFG_ICTT_SHIFT	16
+#define JRCFG_ICTT_MASK		(0xffff << JRCFG_ICTT_SHIFT)
 
 #define JRCR_RESET                  0x01
 
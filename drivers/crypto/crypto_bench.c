@@ -0,0 +1,470 @@
+/*
+ * Throughput and latency benchmark for crypto API implementations
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Runs the same operation on a list of implementations, given by their
+ * driver names as listed in /proc/crypto, for a range of request sizes
+ * and with a number of asynchronous requests kept in flight. Ciphers
+ * are measured encrypting in place, hashes computing a digest.
+ *
+ * Usage, from the "crypto_bench" debugfs directory:
+ *
+ *   echo "cbc-aes-dcp cbc-aes-neonbs cbc-aes-caam" > drivers
+ *   echo 4 > depth
+ *   echo 1 > run
+ *   cat results
+ *
+ * Each line of "results" holds, separated by spaces: driver name, request
+ * size, completed requests, bytes per second and the 50th, 90th and 99th
+ * percentile and maximum request latency in nanoseconds.
+ */
+
+#include <crypto/hash.h>
+#include <linux/completion.h>
+#include <linux/crypto.h>
+#include <linux/debugfs.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/random.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+
+#define BENCH_MAX_DEPTH		32
+#define BENCH_MAX_SAMPLES	4096
+#define BENCH_MAX_KEYLEN	64
+#define BENCH_DRIVERS_LEN	256
+#define BENCH_RESULTS_LEN	(4 * PAGE_SIZE)
+
+static const unsigned int bench_sizes[] = {
+	16, 64, 256, 1024, 4096, 8192,
+};
+
+#define BENCH_MAX_SIZE		8192
+
+struct bench_slot {
+	struct bench_run	*run;
+	union {
+		struct ablkcipher_request	*cipher;
+		struct ahash_request		*hash;
+	} req;
+	struct scatterlist	sg;
+	void			*buf;
+	u8			iv[32];
+	u8			result[64];
+	ktime_t			start;
+	u64			latency;
+	struct completion	done;
+	int			err;
+};
+
+struct bench_run {
+	struct crypto_ablkcipher	*cipher;
+	struct crypto_ahash		*hash;
+	struct bench_slot		slots[BENCH_MAX_DEPTH];
+	unsigned int			depth;
+	unsigned int			size;
+
+	u32				samples[BENCH_MAX_SAMPLES];
+	u64				ops;
+};
+
+static struct dentry *bench_dir;
+static DEFINE_MUTEX(bench_mutex);
+
+static char bench_drivers[BENCH_DRIVERS_LEN];
+static char *bench_results;
+static size_t bench_results_len;
+
+static u32 bench_msecs = 1000;
+static u32 bench_depth = 1;
+static u32 bench_keylen = 16;
+
+static void bench_complete(struct crypto_async_request *areq, int err)
+{
+	struct bench_slot *slot = areq->data;
+
+	/* Leaving the backlog, the final completion comes later. */
+	if (err == -EINPROGRESS)
+		return;
+
+	slot->latency = ktime_to_ns(ktime_sub(ktime_get(), slot->start));
+	slot->err = err;
+	complete(&slot->done);
+}
+
+static int bench_submit(struct bench_slot *slot)
+{
+	struct bench_run *run = slot->run;
+	int ret;
+
+	reinit_completion(&slot->done);
+	slot->start = ktime_get();
+
+	if (run->cipher)
+		ret = crypto_ablkcipher_encrypt(slot->req.cipher);
+	else
+		ret = crypto_ahash_digest(slot->req.hash);
+
+	if (ret == -EINPROGRESS || ret == -EBUSY)
+		return 0;
+
+	/* Done synchronously, the callback is not called. */
+	slot->latency = ktime_to_ns(ktime_sub(ktime_get(), slot->start));
+	slot->err = ret;
+	complete(&slot->done);
+
+	return ret;
+}
+
+static void bench_free_slots(struct bench_run *run)
+{
+	struct bench_slot *slot;
+	unsigned int i;
+
+	for (i = 0; i < run->depth; i++) {
+		slot = &run->slots[i];
+		if (run->cipher)
+			ablkcipher_request_free(slot->req.cipher);
+		else
+			ahash_request_free(slot->req.hash);
+		kfree(slot->buf);
+	}
+}
+
+static int bench_alloc_slots(struct bench_run *run)
+{
+	const u32 flags = CRYPTO_TFM_REQ_MAY_BACKLOG;
+	struct bench_slot *slot;
+	unsigned int i;
+
+	for (i = 0; i < bench_depth; i++) {
+		slot = &run->slots[i];
+		slot->run = run;
+		init_completion(&slot->done);
+
+		slot->buf = kmalloc(BENCH_MAX_SIZE, GFP_KERNEL);
+		if (!slot->buf)
+			goto err;
+		get_random_bytes(slot->buf, BENCH_MAX_SIZE);
+
+		if (run->cipher) {
+			slot->req.cipher = ablkcipher_request_alloc(run->cipher,
+								    GFP_KERNEL);
+			if (!slot->req.cipher)
+				goto err_buf;
+			ablkcipher_request_set_callback(slot->req.cipher, flags,
+							bench_complete, slot);
+		} else {
+			slot->req.hash = ahash_request_alloc(run->hash,
+							     GFP_KERNEL);
+			if (!slot->req.hash)
+				goto err_buf;
+			ahash_request_set_callback(slot->req.hash, flags,
+						   bench_complete, slot);
+		}
+
+		run->depth++;
+	}
+
+	return 0;
+
+err_buf:
+	kfree(slot->buf);
+err:
+	bench_free_slots(run);
+	return -ENOMEM;
+}
+
+static void bench_prepare(struct bench_slot *slot, unsigned int size)
+{
+	struct bench_run *run = slot->run;
+
+	sg_init_one(&slot->sg, slot->buf, size);
+
+	if (run->cipher)
+		ablkcipher_request_set_crypt(slot->req.cipher, &slot->sg,
+					     &slot->sg, size, slot->iv);
+	else
+		ahash_request_set_crypt(slot->req.hash, &slot->sg,
+					slot->result, size);
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void bench_record(struct bench_run *run, u64 latency)
+{
+	run->samples[run->ops % BENCH_MAX_SAMPLES] =
+		min_t(u64, latency, U32_MAX);
+	run->ops++;
+}
+
+/* Keep run->depth requests in flight for bench_msecs. */
+static int bench_one_size(struct bench_run *run, const char *name,
+			  unsigned int size)
+{
+	unsigned long end;
+	struct bench_slot *slot;
+	unsigned int i, n;
+	ktime_t start;
+	u64 us, bps;
+	int ret = 0;
+
+	run->ops = 0;
+	run->size = size;
+
+	for (i = 0; i < run->depth; i++)
+		bench_prepare(&run->slots[i], size);
+
+	start = ktime_get();
+	end = jiffies + msecs_to_jiffies(bench_msecs);
+
+	for (i = 0; i < run->depth; i++)
+		bench_submit(&run->slots[i]);
+
+	for (i = 0; ; i = (i + 1) % run->depth) {
+		slot = &run->slots[i];
+		wait_for_completion(&slot->done);
+		if (slot->err) {
+			ret = slot->err;
+			break;
+		}
+		bench_record(run, slot->latency);
+
+		if (time_after(jiffies, end))
+			break;
+
+		bench_submit(slot);
+	}
+
+	/* Drain whatever is still in flight. */
+	for (n = 1; n < run->depth; n++) {
+		slot = &run->slots[(i + n) % run->depth];
+		wait_for_completion(&slot->done);
+		if (!slot->err)
+			bench_record(run, slot->latency);
+	}
+
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
+	if (ret)
+		return ret;
+
+	n = min_t(u64, run->ops, BENCH_MAX_SAMPLES);
+	sort(run->samples, n, sizeof(u32), bench_cmp_u32, NULL);
+	bps = div64_u64(run->ops * size * USEC_PER_SEC, us ? us : 1);
+
+	bench_results_len += scnprintf(bench_results + bench_results_len,
+				       BENCH_RESULTS_LEN - bench_results_len,
+				       "%s %u %llu %llu %u %u %u %u\n",
+				       name, size, run->ops, bps,
+				       run->samples[n * 50 / 100],
+				       run->samples[n * 90 / 100],
+				       run->samples[n * 99 / 100],
+				       run->samples[n - 1]);
+
+	return 0;
+}
+
+static int bench_driver(const char *name)
+{
+	struct bench_run *run;
+	u8 key[BENCH_MAX_KEYLEN];
+	unsigned int i;
+	int ret;
+
+	run = kzalloc(sizeof(*run), GFP_KERNEL);
+	if (!run)
+		return -ENOMEM;
+
+	get_random_bytes(key, sizeof(key));
+
+	run->cipher = crypto_alloc_ablkcipher(name, 0, 0);
+	if (IS_ERR(run->cipher)) {
+		run->cipher = NULL;
+		run->hash = crypto_alloc_ahash(name, 0, 0);
+		if (IS_ERR(run->hash)) {
+			ret = PTR_ERR(run->hash);
+			goto out_free;
+		}
+		/* Keyed hashes need a key, the others refuse one. */
+		crypto_ahash_setkey(run->hash, key, bench_keylen);
+	} else {
+		ret = crypto_ablkcipher_setkey(run->cipher, key, bench_keylen);
+		if (ret)
+			goto out_free_tfm;
+	}
+
+	ret = bench_alloc_slots(run);
+	if (ret)
+		goto out_free_tfm;
+
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		/* Block ciphers only take whole blocks. */
+		if (run->cipher && bench_sizes[i] %
+		    crypto_ablkcipher_blocksize(run->cipher))
+			continue;
+
+		ret = bench_one_size(run, name, bench_sizes[i]);
+		if (ret)
+			break;
+	}
+
+	bench_free_slots(run);
+out_free_tfm:
+	if (run->cipher)
+		crypto_free_ablkcipher(run->cipher);
+	else
+		crypto_free_ahash(run->hash);
+out_free:
+	kfree(run);
+	return ret;
+}
+
+static ssize_t bench_run_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	char drivers[BENCH_DRIVERS_LEN], *cur, *name;
+	int ret;
+
+	if (bench_depth < 1 || bench_depth > BENCH_MAX_DEPTH ||
+	    bench_keylen > BENCH_MAX_KEYLEN || !bench_msecs)
+		return -EINVAL;
+
+	mutex_lock(&bench_mutex);
+
+	strlcpy(drivers, bench_drivers, sizeof(drivers));
+	bench_results_len = scnprintf(bench_results, BENCH_RESULTS_LEN,
+				      "# driver size ops bytes_per_sec "
+				      "p50_ns p90_ns p99_ns max_ns\n");
+
+	cur = drivers;
+	while ((name = strsep(&cur, " \t\n"))) {
+		if (!*name)
+			continue;
+
+		ret = bench_driver(name);
+		if (ret)
+			bench_results_len +=
+				scnprintf(bench_results + bench_results_len,
+					  BENCH_RESULTS_LEN - bench_results_len,
+					  "# %s: error %d\n", name, ret);
+	}
+
+	mutex_unlock(&bench_mutex);
+
+	return count;
+}
+
+static const struct file_operations bench_run_fops = {
+	.owner	= THIS_MODULE,
+	.open	= simple_open,
+	.write	= bench_run_write,
+	.llseek	= noop_llseek,
+};
+
+static ssize_t bench_drivers_read(struct file *file, char __user *ubuf,
+				  size_t count, loff_t *ppos)
+{
+	return simple_read_from_buffer(ubuf, count, ppos, bench_drivers,
+				       strlen(bench_drivers));
+}
+
+static ssize_t bench_drivers_write(struct file *file, const char __user *ubuf,
+				   size_t count, loff_t *ppos)
+{
+	if (count >= BENCH_DRIVERS_LEN)
+		return -EINVAL;
+
+	mutex_lock(&bench_mutex);
+	if (copy_from_user(bench_drivers, ubuf, count)) {
+		bench_drivers[0] = '\0';
+		mutex_unlock(&bench_mutex);
+		return -EFAULT;
+	}
+	bench_drivers[count] = '\0';
+	mutex_unlock(&bench_mutex);
+
+	return count;
+}
+
+static const struct file_operations bench_drivers_fops = {
+	.owner	= THIS_MODULE,
+	.open	= simple_open,
+	.read	= bench_drivers_read,
+	.write	= bench_drivers_write,
+	.llseek	= default_llseek,
+};
+
+static int bench_results_show(struct seq_file *s, void *unused)
+{
+	mutex_lock(&bench_mutex);
+	seq_write(s, bench_results, bench_results_len);
+	mutex_unlock(&bench_mutex);
+
+	return 0;
+}
+
+static int bench_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bench_results_show, NULL);
+}
+
+static const struct file_operations bench_results_fops = {
+	.owner		= THIS_MODULE,
+	.open		= bench_results_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init crypto_bench_init(void)
+{
+	bench_results = kzalloc(BENCH_RESULTS_LEN, GFP_KERNEL);
+	if (!bench_results)
+		return -ENOMEM;
+
+	bench_dir = debugfs_create_dir("crypto_bench", NULL);
+	if (IS_ERR_OR_NULL(bench_dir)) {
+		kfree(bench_results);
+		return -ENODEV;
+	}
+
+	debugfs_create_file("drivers", S_IRUSR | S_IWUSR, bench_dir, NULL,
+			    &bench_drivers_fops);
+	debugfs_create_file("run", S_IWUSR, bench_dir, NULL, &bench_run_fops);
+	debugfs_create_file("results", S_IRUSR, bench_dir, NULL,
+			    &bench_results_fops);
+	debugfs_create_u32("msecs", S_IRUSR | S_IWUSR, bench_dir,
+			   &bench_msecs);
+	debugfs_create_u32("depth", S_IRUSR | S_IWUSR, bench_dir,
+			   &bench_depth);
+	debugfs_create_u32("keylen", S_IRUSR | S_IWUSR, bench_dir,
+			   &bench_keylen);
+
+	return 0;
+}
+
+static void __exit crypto_bench_exit(void)
+{
+	debugfs_remove_recursive(bench_dir);
+	kfree(bench_results);
+}
+
+module_init(crypto_bench_init);
+module_exit(crypto_bench_exit);
+
+MODULE_DESCRIPTION("Crypto API implementation benchmark");
+MODULE_LICENSE("GPL");
@@ -20,10 +20,14 @@
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/stmp_device.h>
 #include <linux/clk.h>
 
 #include <crypto/aes.h>
+#include <crypto/algapi.h>
+#include <crypto/gf128mul.h>
+#include <crypto/scatterwalk.h>
 #include <crypto/sha.h>
 #include <crypto/internal/hash.h>
 
@@ -32,6 +36,12 @@
 
 #define DCP_ALIGNMENT	64
 
+/* Chained DMA descriptors per channel, one per scatterlist segment. */
+#define DCP_MAX_DESCS	32
+
+/* Saved state of each channel, used when switching between channels. */
+#define DCP_CONTEXT_SZ	(DCP_MAX_CHANS * 52)
+
 /* DCP DMA descriptor. */
 struct dcp_dma_desc {
 	uint32_t	next_cmd_addr;
@@ -44,15 +54,19 @@ struct dcp_dma_desc {
 	uint32_t	status;
 };
 
-/* Coherent aligned block for bounce buffering. */
+/* Aligned block for bounce buffering, indexed by channel for AES. */
 struct dcp_coherent_block {
-	uint8_t			aes_in_buf[DCP_BUF_SZ];
-	uint8_t			aes_out_buf[DCP_BUF_SZ];
+	uint8_t			aes_in_buf[DCP_MAX_CHANS][DCP_BUF_SZ];
+	uint8_t			aes_out_buf[DCP_MAX_CHANS][DCP_BUF_SZ];
 	uint8_t			sha_in_buf[DCP_BUF_SZ];
 
-	uint8_t			aes_key[2 * AES_KEYSIZE_128];
+	uint8_t			aes_key[DCP_MAX_CHANS][2 * AES_KEYSIZE_128];
+};
 
-	struct dcp_dma_desc	desc[DCP_MAX_CHANS];
+/* Descriptor chains and the context switch buffer, DMA coherent. */
+struct dcp_desc_block {
+	struct dcp_dma_desc	desc[DCP_MAX_CHANS][DCP_MAX_DESCS];
+	uint8_t			context[DCP_CONTEXT_SZ];
 };
 
 struct dcp {
@@ -62,6 +76,8 @@ struct dcp {
 	uint32_t			caps;
 
 	struct dcp_coherent_block	*coh;
+	struct dcp_desc_block		*descs;
+	dma_addr_t			descs_phys;
 
 	struct completion		completion[DCP_MAX_CHANS];
 	struct mutex			mutex[DCP_MAX_CHANS];
@@ -72,9 +88,14 @@ struct dcp {
 #endif
 };
 
+/*
+ * Channel 0 does the hashing, the other three channels each run their
+ * own AES request so that up to three requests are in flight at a time.
+ */
 enum dcp_chan {
 	DCP_CHAN_HASH_SHA	= 0,
-	DCP_CHAN_CRYPTO		= 2,
+	DCP_CHAN_CRYPTO		= 1,
+	DCP_CHAN_CRYPTO_LAST	= DCP_MAX_CHANS - 1,
 };
 
 struct dcp_async_ctx {
@@ -86,16 +107,39 @@ struct dcp_async_ctx {
 	struct mutex			mutex;
 	uint32_t			alg;
 	unsigned int			hot:1;
+	unsigned int			hmac:1;
+	unsigned int			hmac_pending:1;
 
 	/* Crypto-specific context */
 	struct crypto_ablkcipher	*fallback;
 	unsigned int			key_len;
-	uint8_t				key[AES_KEYSIZE_128];
+	uint8_t				key[2 * AES_KEYSIZE_128];
+};
+
+/* HMAC keys live past the hash context, which dcp_sha_init() clears. */
+struct dcp_hmac_ctx {
+	struct dcp_async_ctx		actx;
+	uint8_t				ipad[SHA256_BLOCK_SIZE];
+	uint8_t				opad[SHA256_BLOCK_SIZE];
+};
+
+/*
+ * CTR and XTS are not implemented by the DCP, they are built on top of
+ * its ECB mode with the counter and tweak handling done by the CPU.
+ */
+enum dcp_aes_mode {
+	DCP_AES_ECB,
+	DCP_AES_CBC,
+	DCP_AES_CTR,
+	DCP_AES_XTS,
 };
 
 struct dcp_aes_req_ctx {
-	unsigned int	enc:1;
-	unsigned int	ecb:1;
+	unsigned int		enc:1;
+	unsigned int		ecb:1;
+	enum dcp_aes_mode	mode;
+	int			chan;
+	uint32_t		fill;
 };
 
 struct dcp_sha_req_ctx {
@@ -118,6 +162,7 @@ static struct dcp *global_sdcp;
 #define MXS_DCP_CTRL				0x00
 #define MXS_DCP_CTRL_GATHER_RESIDUAL_WRITES	(1 << 23)
 #define MXS_DCP_CTRL_ENABLE_CONTEXT_CACHING	(1 << 22)
+#define MXS_DCP_CTRL_ENABLE_CONTEXT_SWITCHING	(1 << 21)
 
 #define MXS_DCP_STAT				0x10
 #define MXS_DCP_STAT_CLR			0x18
@@ -148,6 +193,7 @@ static struct dcp *global_sdcp;
 #define MXS_DCP_CONTROL0_CIPHER_INIT		(1 << 9)
 #define MXS_DCP_CONTROL0_ENABLE_HASH		(1 << 6)
 #define MXS_DCP_CONTROL0_ENABLE_CIPHER		(1 << 5)
+#define MXS_DCP_CONTROL0_CHAIN			(1 << 2)
 #define MXS_DCP_CONTROL0_DECR_SEMAPHORE		(1 << 1)
 #define MXS_DCP_CONTROL0_INTERRUPT		(1 << 0)
 
@@ -157,16 +203,29 @@ static struct dcp *global_sdcp;
 #define MXS_DCP_CONTROL1_CIPHER_MODE_ECB	(0 << 4)
 #define MXS_DCP_CONTROL1_CIPHER_SELECT_AES128	(0 << 0)
 
-static int mxs_dcp_start_dma(struct dcp_async_ctx *actx)
+static inline struct dcp_dma_desc *dcp_chan_desc(struct dcp *sdcp, int chan)
+{
+	return sdcp->descs->desc[chan];
+}
+
+static inline dma_addr_t dcp_chan_desc_phys(struct dcp *sdcp, int chan,
+					    int idx)
+{
+	return sdcp->descs_phys +
+	       offsetof(struct dcp_desc_block, desc[chan][idx]);
+}
+
+/*
+ * Run the descriptor chain starting at the first descriptor of the
+ * channel. Only the last descriptor of a chain decrements the semaphore
+ * and raises the interrupt.
+ */
+static int mxs_dcp_start_dma(int chan)
 {
 	struct dcp *sdcp = global_sdcp;
-	const int chan = actx->chan;
 	uint32_t stat;
 	unsigned long ret;
-	struct dcp_dma_desc *desc = &sdcp->coh->desc[actx->chan];
-
-	dma_addr_t desc_phys = dma_map_single(sdcp->dev, desc, sizeof(*desc),
-					      DMA_TO_DEVICE);
+	dma_addr_t desc_phys = dcp_chan_desc_phys(sdcp, chan, 0);
 
 	reinit_completion(&sdcp->completion[chan]);
 
@@ -194,34 +253,17 @@ static int mxs_dcp_start_dma(struct dcp_async_ctx *actx)
 		return -EINVAL;
 	}
 
-	dma_unmap_single(sdcp->dev, desc_phys, sizeof(*desc), DMA_TO_DEVICE);
-
 	return 0;
 }
 
 /*
  * Encryption (AES128)
  */
-static int mxs_dcp_run_aes(struct dcp_async_ctx *actx,
-			   struct ablkcipher_request *req, int init)
+static void mxs_dcp_aes_fill_desc(struct dcp_dma_desc *desc,
+				  struct dcp_aes_req_ctx *rctx, int init,
+				  dma_addr_t key_phys)
 {
-	struct dcp *sdcp = global_sdcp;
-	struct dcp_dma_desc *desc = &sdcp->coh->desc[actx->chan];
-	struct dcp_aes_req_ctx *rctx = ablkcipher_request_ctx(req);
-	int ret;
-
-	dma_addr_t key_phys = dma_map_single(sdcp->dev, sdcp->coh->aes_key,
-					     2 * AES_KEYSIZE_128,
-					     DMA_TO_DEVICE);
-	dma_addr_t src_phys = dma_map_single(sdcp->dev, sdcp->coh->aes_in_buf,
-					     DCP_BUF_SZ, DMA_TO_DEVICE);
-	dma_addr_t dst_phys = dma_map_single(sdcp->dev, sdcp->coh->aes_out_buf,
-					     DCP_BUF_SZ, DMA_FROM_DEVICE);
-
-	/* Fill in the DMA descriptor. */
-	desc->control0 = MXS_DCP_CONTROL0_DECR_SEMAPHORE |
-		    MXS_DCP_CONTROL0_INTERRUPT |
-		    MXS_DCP_CONTROL0_ENABLE_CIPHER;
+	desc->control0 = MXS_DCP_CONTROL0_ENABLE_CIPHER;
 
 	/* Payload contains the key. */
 	desc->control0 |= MXS_DCP_CONTROL0_PAYLOAD_KEY;
@@ -239,13 +281,38 @@ static int mxs_dcp_run_aes(struct dcp_async_ctx *actx,
 		desc->control1 |= MXS_DCP_CONTROL1_CIPHER_MODE_CBC;
 
 	desc->next_cmd_addr = 0;
-	desc->source = src_phys;
-	desc->destination = dst_phys;
-	desc->size = actx->fill;
 	desc->payload = key_phys;
 	desc->status = 0;
+}
 
-	ret = mxs_dcp_start_dma(actx);
+static int mxs_dcp_run_aes(struct ablkcipher_request *req, int init)
+{
+	struct dcp *sdcp = global_sdcp;
+	struct dcp_aes_req_ctx *rctx = ablkcipher_request_ctx(req);
+	const int chan = rctx->chan;
+	struct dcp_dma_desc *desc = dcp_chan_desc(sdcp, chan);
+	int ret;
+
+	dma_addr_t key_phys = dma_map_single(sdcp->dev,
+					     sdcp->coh->aes_key[chan],
+					     2 * AES_KEYSIZE_128,
+					     DMA_TO_DEVICE);
+	dma_addr_t src_phys = dma_map_single(sdcp->dev,
+					     sdcp->coh->aes_in_buf[chan],
+					     DCP_BUF_SZ, DMA_TO_DEVICE);
+	dma_addr_t dst_phys = dma_map_single(sdcp->dev,
+					     sdcp->coh->aes_out_buf[chan],
+					     DCP_BUF_SZ, DMA_FROM_DEVICE);
+
+	/* Fill in the DMA descriptor. */
+	mxs_dcp_aes_fill_desc(desc, rctx, init, key_phys);
+	desc->control0 |= MXS_DCP_CONTROL0_DECR_SEMAPHORE |
+			  MXS_DCP_CONTROL0_INTERRUPT;
+	desc->source = src_phys;
+	desc->destination = dst_phys;
+	desc->size = rctx->fill;
+
+	ret = mxs_dcp_start_dma(chan);
 
 	dma_unmap_single(sdcp->dev, key_phys, 2 * AES_KEYSIZE_128,
 			 DMA_TO_DEVICE);
@@ -255,6 +322,249 @@ static int mxs_dcp_run_aes(struct dcp_async_ctx *actx,
 	return ret;
 }
 
+/*
+ * Check whether the request can be processed in place on its own pages:
+ * every piece common to a source and a destination entry must be a whole
+ * number of AES blocks at a word aligned address. Returns the number of
+ * such pieces, or 0 if the data has to go through the bounce buffers.
+ */
+static int mxs_dcp_aes_sg_segments(struct ablkcipher_request *req)
+{
+	struct scatterlist *src = req->src, *dst = req->dst;
+	unsigned int soff = 0, doff = 0, len, left = req->nbytes;
+	int segs = 0;
+
+	if (!left || left % AES_BLOCK_SIZE)
+		return 0;
+
+	while (left) {
+		if (!src || !dst)
+			return 0;
+
+		if ((src->offset + soff) & 3 || (dst->offset + doff) & 3)
+			return 0;
+
+		len = min3(src->length - soff, dst->length - doff, left);
+		if (!len || len % AES_BLOCK_SIZE)
+			return 0;
+
+		segs++;
+		left -= len;
+		soff += len;
+		doff += len;
+
+		if (soff == src->length) {
+			src = sg_next(src);
+			soff = 0;
+		}
+		if (doff == dst->length) {
+			dst = sg_next(dst);
+			doff = 0;
+		}
+	}
+
+	return segs;
+}
+
+/*
+ * Encrypt the request straight from its scatterlists: every common piece
+ * of source and destination gets its own descriptor and up to
+ * DCP_MAX_DESCS descriptors are chained into a single DMA run. For CBC,
+ * the IV is loaded by the first descriptor and carried on by the channel
+ * context across the rest of the request.
+ */
+static int mxs_dcp_aes_sg_crypt(struct ablkcipher_request *req, int init)
+{
+	struct dcp *sdcp = global_sdcp;
+	struct dcp_aes_req_ctx *rctx = ablkcipher_request_ctx(req);
+	const int chan = rctx->chan;
+	struct dcp_dma_desc *desc = dcp_chan_desc(sdcp, chan);
+	const bool inplace = req->src == req->dst;
+	const int src_nents = sg_nents(req->src);
+	const int dst_nents = sg_nents(req->dst);
+	struct scatterlist *src, *dst;
+	unsigned int soff = 0, doff = 0, len, left = req->nbytes;
+	dma_addr_t key_phys;
+	int ret = 0, n = 0;
+
+	if (inplace) {
+		if (!dma_map_sg(sdcp->dev, req->src, src_nents,
+				DMA_BIDIRECTIONAL))
+			return -ENOMEM;
+	} else {
+		if (!dma_map_sg(sdcp->dev, req->src, src_nents,
+				DMA_TO_DEVICE))
+			return -ENOMEM;
+		if (!dma_map_sg(sdcp->dev, req->dst, dst_nents,
+				DMA_FROM_DEVICE)) {
+			dma_unmap_sg(sdcp->dev, req->src, src_nents,
+				     DMA_TO_DEVICE);
+			return -ENOMEM;
+		}
+	}
+
+	key_phys = dma_map_single(sdcp->dev, sdcp->coh->aes_key[chan],
+				  2 * AES_KEYSIZE_128, DMA_TO_DEVICE);
+
+	src = req->src;
+	dst = req->dst;
+
+	while (left) {
+		len = min3(sg_dma_len(src) - soff, sg_dma_len(dst) - doff,
+			   left);
+
+		mxs_dcp_aes_fill_desc(&desc[n], rctx, init, key_phys);
+		desc[n].source = sg_dma_address(src) + soff;
+		desc[n].destination = sg_dma_address(dst) + doff;
+		desc[n].size = len;
+		init = 0;
+
+		left -= len;
+		soff += len;
+		doff += len;
+
+		if (soff == sg_dma_len(src)) {
+			src = sg_next(src);
+			soff = 0;
+		}
+		if (doff == sg_dma_len(dst)) {
+			dst = sg_next(dst);
+			doff = 0;
+		}
+
+		if (++n < DCP_MAX_DESCS && left) {
+			desc[n - 1].control0 |= MXS_DCP_CONTROL0_CHAIN;
+			desc[n - 1].next_cmd_addr =
+				dcp_chan_desc_phys(sdcp, chan, n);
+			continue;
+		}
+
+		desc[n - 1].control0 |= MXS_DCP_CONTROL0_DECR_SEMAPHORE |
+					MXS_DCP_CONTROL0_INTERRUPT;
+
+		ret = mxs_dcp_start_dma(chan);
+		if (ret)
+			break;
+		n = 0;
+	}
+
+	dma_unmap_single(sdcp->dev, key_phys, 2 * AES_KEYSIZE_128,
+			 DMA_TO_DEVICE);
+
+	if (inplace) {
+		dma_unmap_sg(sdcp->dev, req->src, src_nents, DMA_BIDIRECTIONAL);
+	} else {
+		dma_unmap_sg(sdcp->dev, req->src, src_nents, DMA_TO_DEVICE);
+		dma_unmap_sg(sdcp->dev, req->dst, dst_nents, DMA_FROM_DEVICE);
+	}
+
+	return ret;
+}
+
+/*
+ * CTR: encrypt a buffer of counter blocks in ECB mode and XOR the
+ * resulting key stream into the data. The IV is left pointing at the
+ * next unused counter value.
+ */
+static int mxs_dcp_aes_ctr_crypt(struct ablkcipher_request *req)
+{
+	struct dcp *sdcp = global_sdcp;
+	struct dcp_async_ctx *actx = crypto_tfm_ctx(req->base.tfm);
+	struct dcp_aes_req_ctx *rctx = ablkcipher_request_ctx(req);
+	uint8_t *in_buf = sdcp->coh->aes_in_buf[rctx->chan];
+	uint8_t *out_buf = sdcp->coh->aes_out_buf[rctx->chan];
+	uint8_t *key = sdcp->coh->aes_key[rctx->chan];
+	unsigned int off, len, i;
+	int ret;
+
+	memcpy(key, actx->key, AES_KEYSIZE_128);
+	memset(key + AES_KEYSIZE_128, 0, AES_KEYSIZE_128);
+
+	for (off = 0; off < req->nbytes; off += len) {
+		len = min_t(unsigned int, req->nbytes - off, DCP_BUF_SZ);
+
+		for (i = 0; i < len; i += AES_BLOCK_SIZE) {
+			memcpy(in_buf + i, req->info, AES_BLOCK_SIZE);
+			crypto_inc(req->info, AES_BLOCK_SIZE);
+		}
+
+		rctx->fill = ALIGN(len, AES_BLOCK_SIZE);
+		ret = mxs_dcp_run_aes(req, 0);
+		if (ret)
+			return ret;
+
+		scatterwalk_map_and_copy(in_buf, req->src, off, len, 0);
+		crypto_xor(in_buf, out_buf, len);
+		scatterwalk_map_and_copy(in_buf, req->dst, off, len, 1);
+	}
+
+	return 0;
+}
+
+static void mxs_dcp_aes_xts_tweak(uint8_t *buf, unsigned int len, be128 *t)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i += AES_BLOCK_SIZE) {
+		crypto_xor(buf + i, (uint8_t *)t, AES_BLOCK_SIZE);
+		gf128mul_x_ble(t, t);
+	}
+}
+
+/*
+ * XTS: the initial tweak is the IV encrypted with the second half of
+ * the key. Each block is XORed with its tweak before and after the ECB
+ * pass with the first half of the key.
+ */
+static int mxs_dcp_aes_xts_crypt(struct ablkcipher_request *req)
+{
+	struct dcp *sdcp = global_sdcp;
+	struct dcp_async_ctx *actx = crypto_tfm_ctx(req->base.tfm);
+	struct dcp_aes_req_ctx *rctx = ablkcipher_request_ctx(req);
+	uint8_t *in_buf = sdcp->coh->aes_in_buf[rctx->chan];
+	uint8_t *out_buf = sdcp->coh->aes_out_buf[rctx->chan];
+	uint8_t *key = sdcp->coh->aes_key[rctx->chan];
+	const unsigned int enc = rctx->enc;
+	unsigned int off, len;
+	be128 t, start;
+	int ret;
+
+	if (req->nbytes % AES_BLOCK_SIZE)
+		return -EINVAL;
+
+	memcpy(key, actx->key + AES_KEYSIZE_128, AES_KEYSIZE_128);
+	memset(key + AES_KEYSIZE_128, 0, AES_KEYSIZE_128);
+	memcpy(in_buf, req->info, AES_BLOCK_SIZE);
+
+	rctx->enc = 1;
+	rctx->fill = AES_BLOCK_SIZE;
+	ret = mxs_dcp_run_aes(req, 0);
+	rctx->enc = enc;
+	if (ret)
+		return ret;
+
+	memcpy(&t, out_buf, AES_BLOCK_SIZE);
+	memcpy(key, actx->key, AES_KEYSIZE_128);
+
+	for (off = 0; off < req->nbytes; off += len) {
+		len = min_t(unsigned int, req->nbytes - off, DCP_BUF_SZ);
+
+		scatterwalk_map_and_copy(in_buf, req->src, off, len, 0);
+		start = t;
+		mxs_dcp_aes_xts_tweak(in_buf, len, &t);
+
+		rctx->fill = len;
+		ret = mxs_dcp_run_aes(req, 0);
+		if (ret)
+			return ret;
+
+		mxs_dcp_aes_xts_tweak(out_buf, len, &start);
+		scatterwalk_map_and_copy(out_buf, req->dst, off, len, 1);
+	}
+
+	return 0;
+}
+
 static int mxs_dcp_aes_block_crypt(struct crypto_async_request *arq)
 {
 	struct dcp *sdcp = global_sdcp;
@@ -268,20 +578,25 @@ static int mxs_dcp_aes_block_crypt(struct crypto_async_request *arq)
 	const int nents = sg_nents(req->src);
 
 	const int out_off = DCP_BUF_SZ;
-	uint8_t *in_buf = sdcp->coh->aes_in_buf;
-	uint8_t *out_buf = sdcp->coh->aes_out_buf;
+	uint8_t *in_buf = sdcp->coh->aes_in_buf[rctx->chan];
+	uint8_t *out_buf = sdcp->coh->aes_out_buf[rctx->chan];
 
 	uint8_t *out_tmp, *src_buf, *dst_buf = NULL;
 	uint32_t dst_off = 0;
 
-	uint8_t *key = sdcp->coh->aes_key;
+	uint8_t *key = sdcp->coh->aes_key[rctx->chan];
 
 	int ret = 0;
 	int split = 0;
 	unsigned int i, len, clen, rem = 0;
 	int init = 0;
 
-	actx->fill = 0;
+	if (rctx->mode == DCP_AES_CTR)
+		return mxs_dcp_aes_ctr_crypt(req);
+	if (rctx->mode == DCP_AES_XTS)
+		return mxs_dcp_aes_xts_crypt(req);
+
+	rctx->fill = 0;
 
 	/* Copy the key from the temporary location. */
 	memcpy(key, actx->key, actx->key_len);
@@ -295,44 +610,47 @@ static int mxs_dcp_aes_block_crypt(struct crypto_async_request *arq)
 		memset(key + AES_KEYSIZE_128, 0, AES_KEYSIZE_128);
 	}
 
+	if (mxs_dcp_aes_sg_segments(req))
+		return mxs_dcp_aes_sg_crypt(req, init);
+
 	for_each_sg(req->src, src, nents, i) {
 		src_buf = sg_virt(src);
 		len = sg_dma_len(src);
 
 		do {
-			if (actx->fill + len > out_off)
-				clen = out_off - actx->fill;
+			if (rctx->fill + len > out_off)
+				clen = out_off - rctx->fill;
 			else
 				clen = len;
 
-			memcpy(in_buf + actx->fill, src_buf, clen);
+			memcpy(in_buf + rctx->fill, src_buf, clen);
 			len -= clen;
 			src_buf += clen;
-			actx->fill += clen;
+			rctx->fill += clen;
 
 			/*
 			 * If we filled the buffer or this is the last SG,
 			 * submit the buffer.
 			 */
-			if (actx->fill == out_off || sg_is_last(src)) {
-				ret = mxs_dcp_run_aes(actx, req, init);
+			if (rctx->fill == out_off || sg_is_last(src)) {
+				ret = mxs_dcp_run_aes(req, init);
 				if (ret)
 					return ret;
 				init = 0;
 
 				out_tmp = out_buf;
-				while (dst && actx->fill) {
+				while (dst && rctx->fill) {
 					if (!split) {
 						dst_buf = sg_virt(dst);
 						dst_off = 0;
 					}
 					rem = min(sg_dma_len(dst) - dst_off,
-						  actx->fill);
+						  rctx->fill);
 
 					memcpy(dst_buf + dst_off, out_tmp, rem);
 					out_tmp += rem;
 					dst_off += rem;
-					actx->fill -= rem;
+					rctx->fill -= rem;
 
 					if (dst_off == sg_dma_len(dst)) {
 						dst = sg_next(dst);
@@ -351,7 +669,7 @@ static int mxs_dcp_aes_block_crypt(struct crypto_async_request *arq)
 static int dcp_chan_thread_aes(void *data)
 {
 	struct dcp *sdcp = global_sdcp;
-	const int chan = DCP_CHAN_CRYPTO;
+	const int chan = (long)data;
 
 	struct crypto_async_request *backlog;
 	struct crypto_async_request *arq;
@@ -401,55 +719,117 @@ static int mxs_dcp_block_fallback(struct ablkcipher_request *req, int enc)
 	return ret;
 }
 
-static int mxs_dcp_aes_enqueue(struct ablkcipher_request *req, int enc, int ecb)
+/* Queue on the least loaded AES channel; the queue lengths are a hint. */
+static int mxs_dcp_aes_pick_chan(struct dcp *sdcp)
+{
+	int chan, best = DCP_CHAN_CRYPTO;
+
+	for (chan = DCP_CHAN_CRYPTO + 1; chan <= DCP_CHAN_CRYPTO_LAST; chan++)
+		if (sdcp->queue[chan].qlen < sdcp->queue[best].qlen)
+			best = chan;
+
+	return best;
+}
+
+static int mxs_dcp_aes_enqueue(struct ablkcipher_request *req, int enc,
+			       enum dcp_aes_mode mode)
 {
 	struct dcp *sdcp = global_sdcp;
 	struct crypto_async_request *arq = &req->base;
 	struct dcp_async_ctx *actx = crypto_tfm_ctx(arq->tfm);
 	struct dcp_aes_req_ctx *rctx = ablkcipher_request_ctx(req);
+	const unsigned int hw_key_len = mode == DCP_AES_XTS ?
+					2 * AES_KEYSIZE_128 : AES_KEYSIZE_128;
 	int ret;
 
-	if (unlikely(actx->key_len != AES_KEYSIZE_128))
+	if (unlikely(actx->key_len != hw_key_len))
 		return mxs_dcp_block_fallback(req, enc);
 
-	rctx->enc = enc;
-	rctx->ecb = ecb;
-	actx->chan = DCP_CHAN_CRYPTO;
+	/* The CTR key stream is always produced by encryption. */
+	rctx->enc = enc || mode == DCP_AES_CTR;
+	rctx->ecb = mode != DCP_AES_CBC;
+	rctx->mode = mode;
+	rctx->chan = mxs_dcp_aes_pick_chan(sdcp);
 
-	mutex_lock(&sdcp->mutex[actx->chan]);
-	ret = crypto_enqueue_request(&sdcp->queue[actx->chan], &req->base);
-	mutex_unlock(&sdcp->mutex[actx->chan]);
+	mutex_lock(&sdcp->mutex[rctx->chan]);
+	ret = crypto_enqueue_request(&sdcp->queue[rctx->chan], &req->base);
+	mutex_unlock(&sdcp->mutex[rctx->chan]);
 
-	wake_up_process(sdcp->thread[actx->chan]);
+	wake_up_process(sdcp->thread[rctx->chan]);
 
 	return -EINPROGRESS;
 }
 
 static int mxs_dcp_aes_ecb_decrypt(struct ablkcipher_request *req)
 {
-	return mxs_dcp_aes_enqueue(req, 0, 1);
+	return mxs_dcp_aes_enqueue(req, 0, DCP_AES_ECB);
 }
 
 static int mxs_dcp_aes_ecb_encrypt(struct ablkcipher_request *req)
 {
-	return mxs_dcp_aes_enqueue(req, 1, 1);
+	return mxs_dcp_aes_enqueue(req, 1, DCP_AES_ECB);
 }
 
 static int mxs_dcp_aes_cbc_decrypt(struct ablkcipher_request *req)
 {
-	return mxs_dcp_aes_enqueue(req, 0, 0);
+	return mxs_dcp_aes_enqueue(req, 0, DCP_AES_CBC);
 }
 
 static int mxs_dcp_aes_cbc_encrypt(struct ablkcipher_request *req)
 {
-	return mxs_dcp_aes_enqueue(req, 1, 0);
+	return mxs_dcp_aes_enqueue(req, 1, DCP_AES_CBC);
+}
+
+static int mxs_dcp_aes_ctr_decrypt(struct ablkcipher_request *req)
+{
+	return mxs_dcp_aes_enqueue(req, 0, DCP_AES_CTR);
+}
+
+static int mxs_dcp_aes_ctr_encrypt(struct ablkcipher_request *req)
+{
+	return mxs_dcp_aes_enqueue(req, 1, DCP_AES_CTR);
+}
+
+static int mxs_dcp_aes_xts_decrypt(struct ablkcipher_request *req)
+{
+	return mxs_dcp_aes_enqueue(req, 0, DCP_AES_XTS);
+}
+
+static int mxs_dcp_aes_xts_encrypt(struct ablkcipher_request *req)
+{
+	return mxs_dcp_aes_enqueue(req, 1, DCP_AES_XTS);
+}
+
+/*
+ * If the requested AES key size is not supported by the hardware, but is
+ * supported by in-kernel software implementation, we use software
+ * fallback.
+ */
+static int mxs_dcp_aes_fallback_setkey(struct crypto_ablkcipher *tfm,
+				       const u8 *key, unsigned int len)
+{
+	struct dcp_async_ctx *actx = crypto_ablkcipher_ctx(tfm);
+	unsigned int ret;
+
+	actx->fallback->base.crt_flags &= ~CRYPTO_TFM_REQ_MASK;
+	actx->fallback->base.crt_flags |=
+		tfm->base.crt_flags & CRYPTO_TFM_REQ_MASK;
+
+	ret = crypto_ablkcipher_setkey(actx->fallback, key, len);
+	if (!ret)
+		return 0;
+
+	tfm->base.crt_flags &= ~CRYPTO_TFM_RES_MASK;
+	tfm->base.crt_flags |=
+		actx->fallback->base.crt_flags & CRYPTO_TFM_RES_MASK;
+
+	return ret;
 }
 
 static int mxs_dcp_aes_setkey(struct crypto_ablkcipher *tfm, const u8 *key,
 			      unsigned int len)
 {
 	struct dcp_async_ctx *actx = crypto_ablkcipher_ctx(tfm);
-	unsigned int ret;
 
 	/*
 	 * AES 128 is supposed by the hardware, store key into temporary
@@ -468,24 +848,27 @@ static int mxs_dcp_aes_setkey(struct crypto_ablkcipher *tfm, const u8 *key,
 		return -EINVAL;
 	}
 
-	/*
-	 * If the requested AES key size is not supported by the hardware,
-	 * but is supported by in-kernel software implementation, we use
-	 * software fallback.
-	 */
-	actx->fallback->base.crt_flags &= ~CRYPTO_TFM_REQ_MASK;
-	actx->fallback->base.crt_flags |=
-		tfm->base.crt_flags & CRYPTO_TFM_REQ_MASK;
+	return mxs_dcp_aes_fallback_setkey(tfm, key, len);
+}
 
-	ret = crypto_ablkcipher_setkey(actx->fallback, key, len);
-	if (!ret)
+/* XTS takes two AES keys, the hardware can do both halves if 128 bit. */
+static int mxs_dcp_aes_xts_setkey(struct crypto_ablkcipher *tfm,
+				  const u8 *key, unsigned int len)
+{
+	struct dcp_async_ctx *actx = crypto_ablkcipher_ctx(tfm);
+
+	actx->key_len = len;
+	if (len == 2 * AES_KEYSIZE_128) {
+		memcpy(actx->key, key, len);
 		return 0;
+	}
 
-	tfm->base.crt_flags &= ~CRYPTO_TFM_RES_MASK;
-	tfm->base.crt_flags |=
-		actx->fallback->base.crt_flags & CRYPTO_TFM_RES_MASK;
+	if (len != 2 * AES_KEYSIZE_192 && len != 2 * AES_KEYSIZE_256) {
+		tfm->base.crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
 
-	return ret;
+	return mxs_dcp_aes_fallback_setkey(tfm, key, len);
 }
 
 static int mxs_dcp_aes_fallback_init(struct crypto_tfm *tfm)
@@ -525,7 +908,7 @@ static int mxs_dcp_run_sha(struct ahash_request *req)
 	struct dcp_sha_req_ctx *rctx = ahash_request_ctx(req);
 	struct hash_alg_common *halg = crypto_hash_alg_common(tfm);
 
-	struct dcp_dma_desc *desc = &sdcp->coh->desc[actx->chan];
+	struct dcp_dma_desc *desc = dcp_chan_desc(sdcp, actx->chan);
 
 	dma_addr_t digest_phys = 0;
 	dma_addr_t buf_phys = dma_map_single(sdcp->dev, sdcp->coh->sha_in_buf,
@@ -554,7 +937,7 @@ static int mxs_dcp_run_sha(struct ahash_request *req)
 		desc->payload = digest_phys;
 	}
 
-	ret = mxs_dcp_start_dma(actx);
+	ret = mxs_dcp_start_dma(actx->chan);
 
 	if (rctx->fini)
 		dma_unmap_single(sdcp->dev, digest_phys, halg->digestsize,
@@ -565,6 +948,42 @@ static int mxs_dcp_run_sha(struct ahash_request *req)
 	return ret;
 }
 
+/* For some reason, the result is flipped. */
+static void dcp_sha_flip(uint8_t *digest, unsigned int len)
+{
+	unsigned int i;
+
+	for (i = 0; i < len / 2; i++)
+		swap(digest[i], digest[len - i - 1]);
+}
+
+/* Hash the outer pad followed by the inner digest into req->result. */
+static int dcp_sha_hmac_outer(struct ahash_request *req)
+{
+	struct dcp *sdcp = global_sdcp;
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct dcp_hmac_ctx *hctx = crypto_ahash_ctx(tfm);
+	struct dcp_sha_req_ctx *rctx = ahash_request_ctx(req);
+	const unsigned int bs = crypto_ahash_blocksize(tfm);
+	const unsigned int ds = crypto_ahash_digestsize(tfm);
+	uint8_t *in_buf = sdcp->coh->sha_in_buf;
+	int ret;
+
+	memcpy(in_buf, hctx->opad, bs);
+	memcpy(in_buf + bs, req->result, ds);
+
+	hctx->actx.fill = bs + ds;
+	rctx->init = 1;
+	ret = mxs_dcp_run_sha(req);
+	hctx->actx.fill = 0;
+	if (ret)
+		return ret;
+
+	dcp_sha_flip(req->result, ds);
+
+	return 0;
+}
+
 static int dcp_sha_req_to_buf(struct crypto_async_request *arq)
 {
 	struct dcp *sdcp = global_sdcp;
@@ -589,6 +1008,15 @@ static int dcp_sha_req_to_buf(struct crypto_async_request *arq)
 	if (fin)
 		rctx->fini = 0;
 
+	/* HMAC starts with the inner pad in front of the message. */
+	if (actx->hmac_pending) {
+		struct dcp_hmac_ctx *hctx = crypto_ahash_ctx(tfm);
+
+		memcpy(in_buf, hctx->ipad, crypto_ahash_blocksize(tfm));
+		actx->fill = crypto_ahash_blocksize(tfm);
+		actx->hmac_pending = 0;
+	}
+
 	for_each_sg(req->src, src, nents, i) {
 		src_buf = sg_virt(src);
 		len = sg_dma_len(src);
@@ -631,11 +1059,10 @@ static int dcp_sha_req_to_buf(struct crypto_async_request *arq)
 
 		actx->fill = 0;
 
-		/* For some reason, the result is flipped. */
-		for (i = 0; i < halg->digestsize / 2; i++) {
-			swap(req->result[i],
-			     req->result[halg->digestsize - i - 1]);
-		}
+		dcp_sha_flip(req->result, halg->digestsize);
+
+		if (actx->hmac)
+			return dcp_sha_hmac_outer(req);
 	}
 
 	return 0;
@@ -695,13 +1122,15 @@ static int dcp_sha_init(struct ahash_request *req)
 	 */
 	memset(actx, 0, sizeof(*actx));
 
-	if (strcmp(halg->base.cra_name, "sha1") == 0)
+	if (halg->digestsize == SHA1_DIGEST_SIZE)
 		actx->alg = MXS_DCP_CONTROL1_HASH_SELECT_SHA1;
 	else
 		actx->alg = MXS_DCP_CONTROL1_HASH_SELECT_SHA256;
 
 	actx->fill = 0;
 	actx->hot = 0;
+	actx->hmac = !strncmp(halg->base.cra_name, "hmac(", 5);
+	actx->hmac_pending = actx->hmac;
 	actx->chan = DCP_CHAN_HASH_SHA;
 
 	mutex_init(&actx->mutex);
@@ -802,6 +1231,50 @@ static int dcp_sha_digest(struct ahash_request *req)
 	return dcp_sha_finup(req);
 }
 
+static int dcp_sha_hmac_setkey(struct crypto_ahash *tfm, const u8 *key,
+			       unsigned int keylen)
+{
+	struct dcp_hmac_ctx *hctx = crypto_ahash_ctx(tfm);
+	const unsigned int bs = crypto_ahash_blocksize(tfm);
+	const char *name = crypto_ahash_digestsize(tfm) == SHA1_DIGEST_SIZE ?
+			   "sha1" : "sha256";
+	unsigned int i;
+	int ret;
+
+	memset(hctx->ipad, 0, bs);
+
+	/* Keys longer than a block are replaced by their digest. */
+	if (keylen > bs) {
+		struct crypto_shash *shash = crypto_alloc_shash(name, 0, 0);
+
+		if (IS_ERR(shash))
+			return PTR_ERR(shash);
+
+		{
+			SHASH_DESC_ON_STACK(desc, shash);
+
+			desc->tfm = shash;
+			desc->flags = 0;
+			ret = crypto_shash_digest(desc, key, keylen,
+						  hctx->ipad);
+		}
+
+		crypto_free_shash(shash);
+		if (ret)
+			return ret;
+	} else {
+		memcpy(hctx->ipad, key, keylen);
+	}
+
+	memcpy(hctx->opad, hctx->ipad, bs);
+	for (i = 0; i < bs; i++) {
+		hctx->ipad[i] ^= 0x36;
+		hctx->opad[i] ^= 0x5c;
+	}
+
+	return 0;
+}
+
 static int dcp_sha_cra_init(struct crypto_tfm *tfm)
 {
 	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
@@ -813,7 +1286,7 @@ static void dcp_sha_cra_exit(struct crypto_tfm *tfm)
 {
 }
 
-/* AES 128 ECB and AES 128 CBC */
+/* AES 128 ECB, CBC, CTR and XTS */
 static struct crypto_alg dcp_aes_algs[] = {
 	{
 		.cra_name		= "ecb(aes)",
@@ -862,6 +1335,54 @@ static struct crypto_alg dcp_aes_algs[] = {
 				.ivsize		= AES_BLOCK_SIZE,
 			},
 		},
+	}, {
+		.cra_name		= "ctr(aes)",
+		.cra_driver_name	= "ctr-aes-dcp",
+		.cra_priority		= 400,
+		.cra_alignmask		= 15,
+		.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER |
+					  CRYPTO_ALG_ASYNC |
+					  CRYPTO_ALG_NEED_FALLBACK,
+		.cra_init		= mxs_dcp_aes_fallback_init,
+		.cra_exit		= mxs_dcp_aes_fallback_exit,
+		.cra_blocksize		= 1,
+		.cra_ctxsize		= sizeof(struct dcp_async_ctx),
+		.cra_type		= &crypto_ablkcipher_type,
+		.cra_module		= THIS_MODULE,
+		.cra_u = {
+			.ablkcipher = {
+				.min_keysize	= AES_MIN_KEY_SIZE,
+				.max_keysize	= AES_MAX_KEY_SIZE,
+				.setkey		= mxs_dcp_aes_setkey,
+				.encrypt	= mxs_dcp_aes_ctr_encrypt,
+				.decrypt	= mxs_dcp_aes_ctr_decrypt,
+				.ivsize		= AES_BLOCK_SIZE,
+			},
+		},
+	}, {
+		.cra_name		= "xts(aes)",
+		.cra_driver_name	= "xts-aes-dcp",
+		.cra_priority		= 400,
+		.cra_alignmask		= 15,
+		.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER |
+					  CRYPTO_ALG_ASYNC |
+					  CRYPTO_ALG_NEED_FALLBACK,
+		.cra_init		= mxs_dcp_aes_fallback_init,
+		.cra_exit		= mxs_dcp_aes_fallback_exit,
+		.cra_blocksize		= AES_BLOCK_SIZE,
+		.cra_ctxsize		= sizeof(struct dcp_async_ctx),
+		.cra_type		= &crypto_ablkcipher_type,
+		.cra_module		= THIS_MODULE,
+		.cra_u = {
+			.ablkcipher = {
+				.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+				.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+				.setkey		= mxs_dcp_aes_xts_setkey,
+				.encrypt	= mxs_dcp_aes_xts_encrypt,
+				.decrypt	= mxs_dcp_aes_xts_decrypt,
+				.ivsize		= AES_BLOCK_SIZE,
+			},
+		},
 	},
 };
 
@@ -919,6 +1440,62 @@ static struct ahash_alg dcp_sha256_alg = {
 	},
 };
 
+/* HMAC-SHA1 */
+static struct ahash_alg dcp_hmac_sha1_alg = {
+	.init	= dcp_sha_init,
+	.update	= dcp_sha_update,
+	.final	= dcp_sha_final,
+	.finup	= dcp_sha_finup,
+	.digest	= dcp_sha_digest,
+	.export = dcp_sha_export,
+	.import = dcp_sha_import,
+	.setkey	= dcp_sha_hmac_setkey,
+	.halg	= {
+		.digestsize	= SHA1_DIGEST_SIZE,
+		.statesize	= sizeof(struct dcp_export_state),
+		.base		= {
+			.cra_name		= "hmac(sha1)",
+			.cra_driver_name	= "hmac-sha1-dcp",
+			.cra_priority		= 400,
+			.cra_alignmask		= 63,
+			.cra_flags		= CRYPTO_ALG_ASYNC,
+			.cra_blocksize		= SHA1_BLOCK_SIZE,
+			.cra_ctxsize		= sizeof(struct dcp_hmac_ctx),
+			.cra_module		= THIS_MODULE,
+			.cra_init		= dcp_sha_cra_init,
+			.cra_exit		= dcp_sha_cra_exit,
+		},
+	},
+};
+
+/* HMAC-SHA256 */
+static struct ahash_alg dcp_hmac_sha256_alg = {
+	.init	= dcp_sha_init,
+	.update	= dcp_sha_update,
+	.final	= dcp_sha_final,
+	.finup	= dcp_sha_finup,
+	.digest	= dcp_sha_digest,
+	.export = dcp_sha_export,
+	.import = dcp_sha_import,
+	.setkey	= dcp_sha_hmac_setkey,
+	.halg	= {
+		.digestsize	= SHA256_DIGEST_SIZE,
+		.statesize	= sizeof(struct dcp_export_state),
+		.base		= {
+			.cra_name		= "hmac(sha256)",
+			.cra_driver_name	= "hmac-sha256-dcp",
+			.cra_priority		= 400,
+			.cra_alignmask		= 63,
+			.cra_flags		= CRYPTO_ALG_ASYNC,
+			.cra_blocksize		= SHA256_BLOCK_SIZE,
+			.cra_ctxsize		= sizeof(struct dcp_hmac_ctx),
+			.cra_module		= THIS_MODULE,
+			.cra_init		= dcp_sha_cra_init,
+			.cra_exit		= dcp_sha_cra_exit,
+		},
+	},
+};
+
 static irqreturn_t mxs_dcp_irq(int irq, void *context)
 {
 	struct dcp *sdcp = context;
@@ -1017,6 +1594,12 @@ static int mxs_dcp_probe(struct platform_device *pdev)
 	/* Re-align the structure so it fits the DCP constraints. */
 	sdcp->coh = PTR_ALIGN(sdcp->coh, DCP_ALIGNMENT);
 
+	/* Descriptor chains are fetched by the DCP while it runs. */
+	sdcp->descs = dmam_alloc_coherent(dev, sizeof(*sdcp->descs),
+					  &sdcp->descs_phys, GFP_KERNEL);
+	if (!sdcp->descs)
+		return -ENOMEM;
+
 	/* Restart the DCP block. */
 	ret = stmp_reset_block(sdcp->base);
 	if (ret)
@@ -1024,7 +1607,8 @@ static int mxs_dcp_probe(struct platform_device *pdev)
 
 	/* Initialize control register. */
 	writel(MXS_DCP_CTRL_GATHER_RESIDUAL_WRITES |
-	       MXS_DCP_CTRL_ENABLE_CONTEXT_CACHING | 0xf,
+	       MXS_DCP_CTRL_ENABLE_CONTEXT_CACHING |
+	       MXS_DCP_CTRL_ENABLE_CONTEXT_SWITCHING | 0xf,
 	       sdcp->base + MXS_DCP_CTRL);
 
 	/* Enable all DCP DMA channels. */
@@ -1032,13 +1616,11 @@ static int mxs_dcp_probe(struct platform_device *pdev)
 	       sdcp->base + MXS_DCP_CHANNELCTRL);
 
 	/*
-	 * We do not enable context switching. Give the context buffer a
-	 * pointer to an illegal address so if context switching is
-	 * inadvertantly enabled, the DCP will return an error instead of
-	 * trashing good memory. The DCP DMA cannot access ROM, so any ROM
-	 * address will do.
+	 * Several channels run at the same time, so the DCP has to save the
+	 * cipher state of a channel when it switches to another one.
 	 */
-	writel(0xffff0000, sdcp->base + MXS_DCP_CONTEXT);
+	writel(sdcp->descs_phys + offsetof(struct dcp_desc_block, context),
+	       sdcp->base + MXS_DCP_CONTEXT);
 	for (i = 0; i < DCP_MAX_CHANS; i++)
 		writel(0xffffffff, sdcp->base + MXS_DCP_CH_N_STAT_CLR(i));
 	writel(0xffffffff, sdcp->base + MXS_DCP_STAT_CLR);
@@ -1061,12 +1643,15 @@ static int mxs_dcp_probe(struct platform_device *pdev)
 		return PTR_ERR(sdcp->thread[DCP_CHAN_HASH_SHA]);
 	}
 
-	sdcp->thread[DCP_CHAN_CRYPTO] = kthread_run(dcp_chan_thread_aes,
-						    NULL, "mxs_dcp_chan/aes");
-	if (IS_ERR(sdcp->thread[DCP_CHAN_CRYPTO])) {
-		dev_err(dev, "Error starting SHA thread!\n");
-		ret = PTR_ERR(sdcp->thread[DCP_CHAN_CRYPTO]);
-		goto err_destroy_sha_thread;
+	for (i = DCP_CHAN_CRYPTO; i <= DCP_CHAN_CRYPTO_LAST; i++) {
+		sdcp->thread[i] = kthread_run(dcp_chan_thread_aes,
+					      (void *)(long)i,
+					      "mxs_dcp_chan/aes%d", i);
+		if (IS_ERR(sdcp->thread[i])) {
+			dev_err(dev, "Error starting AES thread!\n");
+			ret = PTR_ERR(sdcp->thread[i]);
+			goto err_destroy_aes_thread;
+		}
 	}
 
 	/* Register the various crypto algorithms. */
@@ -1078,7 +1663,7 @@ static int mxs_dcp_probe(struct platform_device *pdev)
 		if (ret) {
 			/* Failed to register algorithm. */
 			dev_err(dev, "Failed to register AES crypto!\n");
-			goto err_destroy_aes_thread;
+			goto err_destroy_aes_threads;
 		}
 	}
 
@@ -1100,8 +1685,34 @@ static int mxs_dcp_probe(struct platform_device *pdev)
 		}
 	}
 
+	if (sdcp->caps & MXS_DCP_CAPABILITY1_SHA1) {
+		ret = crypto_register_ahash(&dcp_hmac_sha1_alg);
+		if (ret) {
+			dev_err(dev, "Failed to register %s hash!\n",
+				dcp_hmac_sha1_alg.halg.base.cra_name);
+			goto err_unregister_sha256;
+		}
+	}
+
+	if (sdcp->caps & MXS_DCP_CAPABILITY1_SHA256) {
+		ret = crypto_register_ahash(&dcp_hmac_sha256_alg);
+		if (ret) {
+			dev_err(dev, "Failed to register %s hash!\n",
+				dcp_hmac_sha256_alg.halg.base.cra_name);
+			goto err_unregister_hmac_sha1;
+		}
+	}
+
 	return 0;
 
+err_unregister_hmac_sha1:
+	if (sdcp->caps & MXS_DCP_CAPABILITY1_SHA1)
+		crypto_unregister_ahash(&dcp_hmac_sha1_alg);
+
+err_unregister_sha256:
+	if (sdcp->caps & MXS_DCP_CAPABILITY1_SHA256)
+		crypto_unregister_ahash(&dcp_sha256_alg);
+
 err_unregister_sha1:
 	if (sdcp->caps & MXS_DCP_CAPABILITY1_SHA1)
 		crypto_unregister_ahash(&dcp_sha1_alg);
@@ -1110,10 +1721,12 @@ err_unregister_aes:
 	if (sdcp->caps & MXS_DCP_CAPABILITY1_AES128)
 		crypto_unregister_algs(dcp_aes_algs, ARRAY_SIZE(dcp_aes_algs));
 
+err_destroy_aes_threads:
+	i = DCP_CHAN_CRYPTO_LAST + 1;
 err_destroy_aes_thread:
-	kthread_stop(sdcp->thread[DCP_CHAN_CRYPTO]);
+	while (--i >= DCP_CHAN_CRYPTO)
+		kthread_stop(sdcp->thread[i]);
 
-err_destroy_sha_thread:
 	kthread_stop(sdcp->thread[DCP_CHAN_HASH_SHA]);
 	return ret;
 }
@@ -1121,6 +1734,13 @@ err_destroy_sha_thread:
 static int mxs_dcp_remove(struct platform_device *pdev)
 {
 	struct dcp *sdcp = platform_get_drvdata(pdev);
+	int i;
+
+	if (sdcp->caps & MXS_DCP_CAPABILITY1_SHA256)
+		crypto_unregister_ahash(&dcp_hmac_sha256_alg);
+
+	if (sdcp->caps & MXS_DCP_CAPABILITY1_SHA1)
+		crypto_unregister_ahash(&dcp_hmac_sha1_alg);
 
 	if (sdcp->caps & MXS_DCP_CAPABILITY1_SHA256)
 		crypto_unregister_ahash(&dcp_sha256_alg);
@@ -1132,7 +1752,8 @@ static int mxs_dcp_remove(struct platform_device *pdev)
 		crypto_unregister_algs(dcp_aes_algs, ARRAY_SIZE(dcp_aes_algs));
 
 	kthread_stop(sdcp->thread[DCP_CHAN_HASH_SHA]);
-	kthread_stop(sdcp->thread[DCP_CHAN_CRYPTO]);
+	for (i = DCP_CHAN_CRYPTO; i <= DCP_CHAN_CRYPTO_LAST; i++)
+		kthread_stop(sdcp->thread[i]);
 
 #ifdef CONFIG_ARM
 	/* shut clocks off before finalizing shutdown */
@@ -70,6 +70,10 @@ static bool noverify;
 module_param(noverify, bool, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(noverify, "Disable random data setup and verification");
 
+static bool cpu_copy;
+module_param(cpu_copy, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(cpu_copy, "Do memcpy tests with the CPU instead of the channel, as a throughput baseline (default: off)");
+
 static bool verbose;
 module_param(verbose, bool, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(verbose, "Enable \"success\" result messages (default: off)");
@@ -85,6 +89,7 @@ MODULE_PARM_DESC(verbose, "Enable \"success\" result messages (default: off)");
  * @xor_sources:	number of xor source buffers
  * @pq_sources:		number of p+q source buffers
  * @timeout:		transfer timeout in msec, -1 for infinite timeout
+ * @cpu_copy:		run memcpy tests with memcpy() instead of the channel
  */
 struct dmatest_params {
 	unsigned int	buf_size;
@@ -97,6 +102,7 @@ struct dmatest_params {
 	unsigned int	pq_sources;
 	int		timeout;
 	bool		noverify;
+	bool		cpu_copy;
 };
 
 /**
@@ -529,6 +535,13 @@ static int dmatest_func(void *data)
 					  params->buf_size);
 		}
 
+		/* Same buffers, lengths and offsets, but no engine */
+		if (thread->type == DMA_MEMCPY && params->cpu_copy) {
+			memcpy(thread->dsts[0] + dst_off,
+			       thread->srcs[0] + src_off, len);
+			goto verify;
+		}
+
 		um = dmaengine_get_unmap_data(dev->dev, src_cnt+dst_cnt,
 					      GFP_KERNEL);
 		if (!um) {
@@ -651,6 +664,7 @@ static int dmatest_func(void *data)
 
 		dmaengine_unmap_put(um);
 
+verify:
 		if (params->noverify) {
 			verbose_result("test passed", total_tests, src_off,
 				       dst_off, len, 0);
@@ -874,6 +888,7 @@ static void run_threaded_test(struct dmatest_info *info)
 	params->pq_sources = pq_sources;
 	params->timeout = timeout;
 	params->noverify = noverify;
+	params->cpu_copy = cpu_copy;
 
 	request_channels(info, DMA_MEMCPY);
 	request_channels(info, DMA_XOR);
@@ -24,16 +24,20 @@
 #include <linux/mm.h>
 #include <linux/interrupt.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/regmap.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/semaphore.h>
 #include <linux/spinlock.h>
 #include <linux/device.h>
 #include <linux/genalloc.h>
 #include <linux/dma-mapping.h>
+#include <linux/dmapool.h>
 #include <linux/firmware.h>
 #include <linux/slab.h>
+#include <linux/sizes.h>
 #include <linux/platform_device.h>
 #include <linux/dmaengine.h>
 #include <linux/of.h>
@@ -50,6 +54,9 @@
 #include "dmaengine.h"
 #include "virt-dma.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/imx_sdma.h>
+
 /* SDMA registers */
 #define SDMA_H_C0PTR		0x000
 #define SDMA_H_INTR		0x004
@@ -288,9 +295,43 @@ struct sdma_context_data {
 
 #define NUM_BD (int)(PAGE_SIZE / sizeof(struct sdma_buffer_descriptor))
 #define SDMA_BD_MAX_CNT	0xfffc /* align with 4 bytes */
+#define SDMA_BD_POOL_SIZE	(NUM_BD * sizeof(struct sdma_buffer_descriptor))
 
 struct sdma_engine;
 
+/**
+ * struct sdma_channel_stats - per channel counters
+ *
+ * @transfers		completed non-cyclic descriptors
+ * @periods		completed periods of cyclic descriptors
+ * @bytes		bytes moved by completed descriptors and periods
+ * @irqs		channel interrupts seen
+ * @errors		non-cyclic descriptors finished with an error
+ * @bds			BDs of completed non-cyclic descriptors
+ * @busy_ns		start to completion time of those descriptors
+ * @start_ns		when the current descriptor was started
+ * @context_loads	context loads done through channel 0
+ * @context_ns		time spent in those loads
+ * @script_pc		start address of the script last loaded
+ *
+ * All fields are written and read with the channel's vc.lock held. That
+ * includes the context load counters, although the load itself is
+ * serialised by channel_0_lock.
+ */
+struct sdma_channel_stats {
+	u64				transfers;
+	u64				periods;
+	u64				bytes;
+	u64				irqs;
+	u64				errors;
+	u64				bds;
+	u64				busy_ns;
+	u64				start_ns;
+	u64				context_loads;
+	u64				context_ns;
+	int				script_pc;
+};
+
 struct sdma_desc {
 	struct virt_dma_desc		vd;
 	struct list_head		node;
@@ -299,6 +340,7 @@ struct sdma_desc {
 	unsigned int			num_bd;
 	dma_addr_t			bd_phys;
 	bool				bd_iram;
+	bool				bd_pooled;
 	unsigned int                    buf_tail;
 	struct sdma_channel		*sdmac;
 	struct sdma_buffer_descriptor	*bd;
@@ -317,6 +359,7 @@ struct sdma_desc {
  * @buf_tail		ID of the buffer that was processed
  * @num_bd		max NUM_BD. number of descriptors currently handling
  * @bd_iram		flag indicating the memory location of buffer descriptor
+ * @bd_pool		cache of BD arrays up to NUM_BD entries for this channel
  */
 struct sdma_channel {
 	struct virt_dma_chan		vc;
@@ -346,6 +389,9 @@ struct sdma_channel {
 	u32				bd_size_sum;
 	bool				src_dualfifo;
 	bool				dst_dualfifo;
+	struct dma_pool			*bd_pool;
+	unsigned int			priority;
+	struct sdma_channel_stats	stats;
 };
 
 #define IMX_DMA_SG_LOOP		BIT(0)
@@ -420,6 +466,16 @@ struct sdma_engine {
 	bool				bd0_iram;
 	struct sdma_buffer_descriptor	*bd0;
 	bool				suspend_off;
+	/* copy of the loaded RAM image, downloaded again after power off */
+	void				*ram_code;
+	u32				ram_code_size;
+	u32				ram_code_start_addr;
+	/* channel 0 runs, protected by channel_0_lock */
+	u64				ch0_runs;
+	u64				ch0_timeouts;
+	u64				ch0_ns;
+	u64				ch0_max_ns;
+	struct dentry			*debugfs;
 };
 
 static struct sdma_driver_data sdma_imx31 = {
@@ -659,6 +715,7 @@ static int sdma_run_channel0(struct sdma_engine *sdma)
 {
 	int ret;
 	unsigned long timeout = 500;
+	u64 start = ktime_get_ns(), ns;
 
 	sdma_enable_channel(sdma, 0);
 
@@ -673,8 +730,15 @@ static int sdma_run_channel0(struct sdma_engine *sdma)
 		writel_relaxed(ret, sdma->regs + SDMA_H_INTR);
 	} else {
 		dev_err(sdma->dev, "Timeout waiting for CH0 ready\n");
+		sdma->ch0_timeouts++;
 	}
 
+	ns = ktime_get_ns() - start;
+	sdma->ch0_runs++;
+	sdma->ch0_ns += ns;
+	sdma->ch0_max_ns = max(sdma->ch0_max_ns, ns);
+	trace_sdma_run_channel0(ns, ret ? 0 : -ETIMEDOUT);
+
 	/* Set bits of CONFIG register with dynamic context switching */
 	if (readl(sdma->regs + SDMA_H_CONFIG) == 0)
 		writel_relaxed(SDMA_H_CONFIG_CSM, sdma->regs + SDMA_H_CONFIG);
@@ -809,6 +873,19 @@ static void mxc_sdma_handle_channel_normal(struct sdma_channel *sdmac)
 	sdmac->chn_real_count = sdmac->desc->des_real_count;
 }
 
+static void sdma_account_desc(struct sdma_channel *sdmac,
+			      struct sdma_desc *desc)
+{
+	struct sdma_channel_stats *stats = &sdmac->stats;
+
+	stats->transfers++;
+	stats->bytes += desc->des_real_count;
+	stats->bds += desc->num_bd;
+	stats->busy_ns += ktime_get_ns() - stats->start_ns;
+	if (sdmac->status == DMA_ERROR)
+		stats->errors++;
+}
+
 static irqreturn_t sdma_int_handler(int irq, void *dev_id)
 {
 	struct sdma_engine *sdma = dev_id;
@@ -825,12 +902,21 @@ static irqreturn_t sdma_int_handler(int irq, void *dev_id)
 		struct sdma_desc *desc;
 
 		spin_lock(&sdmac->vc.lock);
+		sdmac->stats.irqs++;
 		desc = sdmac->desc;
 		if (desc) {
 			if (sdmac->flags & IMX_DMA_SG_LOOP) {
+				sdmac->stats.periods++;
+				sdmac->stats.bytes += desc->des_count;
+				trace_sdma_channel_irq(channel, desc->des_count,
+						       sdmac->status);
 				vchan_cyclic_callback(&desc->vd);
 			} else {
 				mxc_sdma_handle_channel_normal(sdmac);
+				sdma_account_desc(sdmac, desc);
+				trace_sdma_channel_irq(channel,
+						       desc->des_real_count,
+						       sdmac->status);
 				vchan_cookie_complete(&desc->vd);
 				if (!list_empty(&sdmac->pending))
 					list_del(&desc->node);
@@ -956,6 +1042,7 @@ static int sdma_load_context(struct sdma_channel *sdmac)
 	struct sdma_buffer_descriptor *bd0 = sdma->bd0;
 	int ret;
 	unsigned long flags;
+	u64 start;
 
 	if (sdmac->context_loaded)
 		return 0;
@@ -1003,10 +1090,16 @@ static int sdma_load_context(struct sdma_channel *sdmac)
 	bd0->mode.count = sizeof(*context) / 4;
 	bd0->buffer_addr = sdma->context_phys;
 	bd0->ext_buffer_addr = 2048 + (sizeof(*context) / 4) * channel;
+	start = ktime_get_ns();
 	ret = sdma_run_channel0(sdma);
 
 	spin_unlock_irqrestore(&sdma->channel_0_lock, flags);
 
+	spin_lock_irqsave(&sdmac->vc.lock, flags);
+	sdmac->stats.context_loads++;
+	sdmac->stats.context_ns += ktime_get_ns() - start;
+	sdmac->stats.script_pc = load_address;
+	spin_unlock_irqrestore(&sdmac->vc.lock, flags);
 	sdmac->context_loaded = true;
 
 	return ret;
@@ -1177,6 +1270,7 @@ static int sdma_set_channel_priority(struct sdma_channel *sdmac,
 	}
 
 	writel_relaxed(priority, sdma->regs + SDMA_CHNPRI_0 + 4 * channel);
+	sdmac->priority = priority;
 
 	return 0;
 }
@@ -1188,10 +1282,22 @@ static int sdma_alloc_bd(struct sdma_desc *desc)
 	unsigned long flags;
 
 	desc->bd_iram = true;
+	desc->bd_pooled = false;
 	desc->bd = gen_pool_dma_alloc(desc->sdmac->sdma->iram_pool, bd_size,
 				      &desc->bd_phys);
 	if (!desc->bd) {
 		desc->bd_iram = false;
+		/*
+		 * Blocks freed back to the pool are reused by the next prep,
+		 * so steady-state transfers never hit the coherent allocator.
+		 */
+		if (desc->sdmac->bd_pool && bd_size <= SDMA_BD_POOL_SIZE) {
+			desc->bd = dma_pool_alloc(desc->sdmac->bd_pool,
+						  GFP_ATOMIC, &desc->bd_phys);
+			desc->bd_pooled = !!desc->bd;
+		}
+	}
+	if (!desc->bd) {
 		desc->bd = dma_alloc_coherent(NULL, bd_size, &desc->bd_phys, GFP_ATOMIC);
 		if (!desc->bd)
 			return ret;
@@ -1214,6 +1320,9 @@ static void sdma_free_bd(struct sdma_desc *desc)
 		if (desc->bd_iram)
 			gen_pool_free(desc->sdmac->sdma->iram_pool,
 				     (unsigned long)desc->bd, bd_size);
+		else if (desc->bd_pooled)
+			dma_pool_free(desc->sdmac->bd_pool, desc->bd,
+				      desc->bd_phys);
 		else
 			dma_free_coherent(NULL, bd_size, desc->bd,
 					  desc->bd_phys);
@@ -1385,6 +1494,13 @@ static int sdma_alloc_chan_resources(struct dma_chan *chan)
 	if (ret)
 		goto err_out;
 
+	sdmac->bd_pool = dma_pool_create("sdma_bd", sdmac->sdma->dev,
+					 SDMA_BD_POOL_SIZE, 32, 0);
+	if (!sdmac->bd_pool) {
+		ret = -ENOMEM;
+		goto err_out;
+	}
+
 	sdmac->bd_size_sum = 0;
 
 	return 0;
@@ -1412,6 +1528,13 @@ static void sdma_free_chan_resources(struct dma_chan *chan)
 
 	sdma_set_channel_priority(sdmac, 0);
 
+	if (sdmac->bd_pool) {
+		/* make sure no completion is still freeing descriptors */
+		tasklet_kill(&sdmac->vc.task);
+		dma_pool_destroy(sdmac->bd_pool);
+		sdmac->bd_pool = NULL;
+	}
+
 	clk_disable(sdma->clk_ipg);
 	clk_disable(sdma->clk_ahb);
 }
@@ -1658,6 +1781,7 @@ static struct dma_async_tx_descriptor *sdma_prep_dma_cyclic(
 	int i = 0, buf = 0;
 	int num_periods = 0;
 	struct sdma_desc *desc;
+	bool period_irq = flags & DMA_PREP_INTERRUPT;
 
 	dev_dbg(sdma->dev, "%s channel: %d\n", __func__, channel);
 
@@ -1704,7 +1828,15 @@ static struct dma_async_tx_descriptor *sdma_prep_dma_cyclic(
 		else
 			bd->mode.command = sdmac->word_size;
 
-		param = BD_DONE | BD_EXTD | BD_CONT | BD_INTR;
+		/*
+		 * Without period interrupts only the buffer halves interrupt,
+		 * which is as often as the BDs have to be handed back to the
+		 * script. The position is read from the BDs in between.
+		 */
+		param = BD_DONE | BD_EXTD | BD_CONT;
+		if (period_irq || sdmac->peripheral_type == IMX_DMATYPE_UART ||
+		    i + 1 == num_periods || i + 1 == num_periods / 2)
+			param |= BD_INTR;
 		if (i + 1 == num_periods)
 			param |= BD_WRAP;
 
@@ -1772,6 +1904,26 @@ static enum dma_status sdma_wait_tasklet(struct dma_chan *chan)
 	return sdmac->status;
 }
 
+/*
+ * The script clears BD_DONE as it finishes each BD, before the interrupt
+ * handler gets to re-arm it, so walking the BDs from buf_tail gives the
+ * current period even when periods do not raise an interrupt.
+ */
+static u32 sdma_cyclic_residue(struct sdma_channel *sdmac,
+			       struct sdma_desc *desc)
+{
+	unsigned int idx = desc->buf_tail;
+	unsigned int n;
+
+	for (n = 0; n < desc->num_bd; n++) {
+		if (desc->bd[idx].mode.status & BD_DONE)
+			break;
+		idx = (idx + 1) % desc->num_bd;
+	}
+
+	return (desc->num_bd - idx) * sdmac->period_len;
+}
+
 static enum dma_status sdma_tx_status(struct dma_chan *chan,
 				      dma_cookie_t cookie,
 				      struct dma_tx_state *txstate)
@@ -1799,7 +1951,7 @@ static enum dma_status sdma_tx_status(struct dma_chan *chan,
 	if (vd) {
 		if ((sdmac->flags & IMX_DMA_SG_LOOP)) {
 			if (sdmac->peripheral_type != IMX_DMATYPE_UART)
-				residue = (desc->num_bd - desc->buf_tail) * sdmac->period_len;
+				residue = sdma_cyclic_residue(sdmac, desc);
 			else
 				residue = desc->des_count - desc->des_real_count;
 		} else
@@ -1838,6 +1990,9 @@ static void sdma_start_desc(struct sdma_channel *sdmac)
 	}
 	sdma->channel_control[channel].base_bd_ptr = desc->bd_phys;
 	sdma->channel_control[channel].current_bd_ptr = desc->bd_phys;
+	sdmac->stats.start_ns = ktime_get_ns();
+	trace_sdma_start_desc(channel, desc->num_bd, desc->des_count,
+			      sdmac->flags & IMX_DMA_SG_LOOP);
 	sdma_enable_channel(sdma, sdmac->channel);
 }
 
@@ -1852,6 +2007,78 @@ static void sdma_issue_pending(struct dma_chan *chan)
 	spin_unlock_irqrestore(&sdmac->vc.lock, flags);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int sdma_debugfs_show(struct seq_file *s, void *data)
+{
+	struct sdma_engine *sdma = s->private;
+	struct sdma_channel_stats stats;
+	unsigned long flags;
+	u64 avg_bd_ns;
+	int i;
+
+	spin_lock_irqsave(&sdma->channel_0_lock, flags);
+	seq_printf(s, "ch0: runs %llu timeouts %llu avg %llu ns max %llu ns\n",
+		   sdma->ch0_runs, sdma->ch0_timeouts,
+		   sdma->ch0_runs ? div64_u64(sdma->ch0_ns, sdma->ch0_runs) : 0,
+		   sdma->ch0_max_ns);
+	spin_unlock_irqrestore(&sdma->channel_0_lock, flags);
+
+	seq_puts(s, "ch  prio type pc    transfers periods   bytes        irqs      errors avg_bd_ns ctx_loads ctx_ns\n");
+	for (i = 1; i < MAX_DMA_CHANNELS; i++) {
+		struct sdma_channel *sdmac = &sdma->channel[i];
+
+		spin_lock_irqsave(&sdmac->vc.lock, flags);
+		stats = sdmac->stats;
+		spin_unlock_irqrestore(&sdmac->vc.lock, flags);
+
+		if (!stats.irqs && !stats.context_loads)
+			continue;
+
+		avg_bd_ns = stats.bds ? div64_u64(stats.busy_ns, stats.bds) : 0;
+		seq_printf(s, "%-3d %-4u %-4d %-5d %-9llu %-9llu %-12llu %-9llu %-6llu %-9llu %-9llu %llu\n",
+			   i, sdmac->priority,
+			   sdmac->peripheral_type, stats.script_pc,
+			   stats.transfers, stats.periods, stats.bytes,
+			   stats.irqs, stats.errors, avg_bd_ns,
+			   stats.context_loads, stats.context_ns);
+	}
+
+	return 0;
+}
+
+static int sdma_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sdma_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations sdma_debugfs_operations = {
+	.open		= sdma_debugfs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void sdma_init_debugfs(struct sdma_engine *sdma)
+{
+	sdma->debugfs = debugfs_create_file(dev_name(sdma->dev), S_IRUGO,
+					    NULL, sdma,
+					    &sdma_debugfs_operations);
+}
+
+static void sdma_remove_debugfs(struct sdma_engine *sdma)
+{
+	debugfs_remove(sdma->debugfs);
+}
+#else
+static inline void sdma_init_debugfs(struct sdma_engine *sdma)
+{
+}
+
+static inline void sdma_remove_debugfs(struct sdma_engine *sdma)
+{
+}
+#endif
+
 #define SDMA_SCRIPT_ADDRS_ARRAY_SIZE_V1	34
 #define SDMA_SCRIPT_ADDRS_ARRAY_SIZE_V2	38
 #define SDMA_SCRIPT_ADDRS_ARRAY_SIZE_V3	41
@@ -1873,28 +2100,22 @@ static void sdma_add_scripts(struct sdma_engine *sdma,
 			saddr_arr[i] = addr_arr[i];
 }
 
-static void sdma_load_firmware(const struct firmware *fw, void *context)
+static int sdma_parse_firmware(struct sdma_engine *sdma, const u8 *data,
+			       size_t size)
 {
-	struct sdma_engine *sdma = context;
 	const struct sdma_firmware_header *header;
 	const struct sdma_script_start_addrs *addr;
 	unsigned short *ram_code;
 
-	if (!fw) {
-		dev_info(sdma->dev, "external firmware not found, using ROM firmware\n");
-		/* In this case we just use the ROM firmware. */
-		return;
-	}
-
-	if (fw->size < sizeof(*header))
-		goto err_firmware;
+	if (size < sizeof(*header))
+		return -EINVAL;
 
-	header = (struct sdma_firmware_header *)fw->data;
+	header = (struct sdma_firmware_header *)data;
 
 	if (header->magic != SDMA_FIRMWARE_MAGIC)
-		goto err_firmware;
-	if (header->ram_code_start + header->ram_code_size > fw->size)
-		goto err_firmware;
+		return -EINVAL;
+	if (header->ram_code_start + header->ram_code_size > size)
+		return -EINVAL;
 	switch (header->version_major) {
 	case 1:
 		sdma->script_number = SDMA_SCRIPT_ADDRS_ARRAY_SIZE_V1;
@@ -1910,7 +2131,7 @@ static void sdma_load_firmware(const struct firmware *fw, void *context)
 		break;
 	default:
 		dev_err(sdma->dev, "unknown firmware version\n");
-		goto err_firmware;
+		return -EINVAL;
 	}
 
 	addr = (void *)header + header->script_addrs_start;
@@ -1927,14 +2148,81 @@ static void sdma_load_firmware(const struct firmware *fw, void *context)
 
 	sdma_add_scripts(sdma, addr);
 
+	if (!sdma->ram_code) {
+		sdma->ram_code = kmemdup(ram_code, header->ram_code_size,
+					 GFP_KERNEL);
+		sdma->ram_code_size = header->ram_code_size;
+		sdma->ram_code_start_addr = addr->ram_code_start_addr;
+	}
+
 	dev_info(sdma->dev, "loaded firmware %d.%d\n",
 			header->version_major,
 			header->version_minor);
 
-err_firmware:
+	return 0;
+}
+
+static void sdma_load_firmware(const struct firmware *fw, void *context)
+{
+	struct sdma_engine *sdma = context;
+
+	if (!fw) {
+		dev_info(sdma->dev, "external firmware not found, using ROM firmware\n");
+		/* In this case we just use the ROM firmware. */
+		return;
+	}
+
+	sdma_parse_firmware(sdma, fw->data, fw->size);
 	release_firmware(fw);
 }
 
+/*
+ * The bootloader may leave the firmware image in a reserved memory region
+ * referenced by "memory-region".
+ */
+static int sdma_load_firmware_region(struct sdma_engine *sdma)
+{
+	struct device_node *np;
+	struct resource res;
+	void __iomem *region;
+	void *data;
+	size_t size;
+	int ret;
+
+	if (!sdma->dev->of_node)
+		return -ENODEV;
+
+	np = of_parse_phandle(sdma->dev->of_node, "memory-region", 0);
+	if (!np)
+		return -ENODEV;
+
+	ret = of_address_to_resource(np, 0, &res);
+	of_node_put(np);
+	if (ret)
+		return ret;
+
+	size = resource_size(&res);
+	data = kmalloc(size, GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	region = ioremap(res.start, size);
+	if (!region) {
+		kfree(data);
+		return -ENOMEM;
+	}
+	memcpy_fromio(data, region, size);
+	iounmap(region);
+
+	ret = sdma_parse_firmware(sdma, data, size);
+	if (ret)
+		dev_warn(sdma->dev, "no valid firmware in memory region %pR\n",
+			 &res);
+	kfree(data);
+
+	return ret;
+}
+
 #define EVENT_REMAP_CELLS 3
 
 static int sdma_event_remap(struct sdma_engine *sdma)
@@ -2013,6 +2301,28 @@ static int sdma_get_firmware(struct sdma_engine *sdma,
 	return ret;
 }
 
+/*
+ * At probe time, try the sources that do not need the firmware loader:
+ * the bootloader's memory region, then request_firmware_direct() which
+ * finds images linked in with CONFIG_EXTRA_FIRMWARE. Only when neither has
+ * the image, wait for the loader in the background.
+ */
+static int sdma_get_firmware_early(struct sdma_engine *sdma,
+				   const char *fw_name)
+{
+	const struct firmware *fw;
+
+	if (!sdma_load_firmware_region(sdma))
+		return 0;
+
+	if (!request_firmware_direct(&fw, fw_name, sdma->dev)) {
+		sdma_load_firmware(fw, sdma);
+		return 0;
+	}
+
+	return sdma_get_firmware(sdma, fw_name);
+}
+
 static int sdma_init(struct sdma_engine *sdma)
 {
 	int i, ret, ccbsize;
@@ -2117,6 +2427,176 @@ static struct dma_chan *sdma_xlate(struct of_phandle_args *dma_spec,
 	return dma_request_channel(mask, sdma_filter_fn, &data);
 }
 
+static unsigned int memcpy_threshold = SZ_16K;
+module_param(memcpy_threshold, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(memcpy_threshold,
+		 "imx_sdma_memcpy() leaves shorter copies to the CPU (default: 16384)");
+
+static DEFINE_MUTEX(sdma_memcpy_lock);
+static struct sdma_engine *sdma_memcpy_engine;
+static struct dma_chan *sdma_memcpy_chan;
+
+static bool sdma_memcpy_filter(struct dma_chan *chan, void *param)
+{
+	if (chan->device != param)
+		return false;
+
+	/* no slave data: alloc_chan_resources sets up a memory channel */
+	chan->private = NULL;
+
+	return true;
+}
+
+static void sdma_memcpy_callback(void *param)
+{
+	complete(param);
+}
+
+/* Called with sdma_memcpy_lock held */
+static struct dma_chan *sdma_memcpy_get_chan(void)
+{
+	dma_cap_mask_t mask;
+
+	if (!sdma_memcpy_chan && sdma_memcpy_engine) {
+		dma_cap_zero(mask);
+		dma_cap_set(DMA_MEMCPY, mask);
+		sdma_memcpy_chan = dma_request_channel(mask,
+				sdma_memcpy_filter,
+				&sdma_memcpy_engine->dma_device);
+	}
+
+	return sdma_memcpy_chan;
+}
+
+/* Called with sdma_memcpy_lock held, @dma_src already mapped */
+static int sdma_memcpy_offload(struct dma_chan *chan, void *dst,
+			       dma_addr_t dma_src, size_t len)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct device *dev = chan->device->dev;
+	struct dma_async_tx_descriptor *tx;
+	dma_addr_t dma_dst;
+	dma_cookie_t cookie;
+	int ret = -ENOMEM;
+
+	dma_dst = dma_map_single(dev, dst, len, DMA_FROM_DEVICE);
+	if (dma_mapping_error(dev, dma_dst))
+		return ret;
+
+	tx = chan->device->device_prep_dma_memcpy(chan, dma_dst, dma_src, len,
+						   DMA_PREP_INTERRUPT |
+						   DMA_CTRL_ACK);
+	if (!tx)
+		goto err_unmap_dst;
+
+	tx->callback = sdma_memcpy_callback;
+	tx->callback_param = &done;
+	cookie = dmaengine_submit(tx);
+	ret = dma_submit_error(cookie);
+	if (ret)
+		goto err_unmap_dst;
+	dma_async_issue_pending(chan);
+
+	if (!wait_for_completion_timeout(&done, msecs_to_jiffies(1000))) {
+		dmaengine_terminate_all(chan);
+		ret = -ETIMEDOUT;
+	} else if (dma_async_is_tx_complete(chan, cookie, NULL, NULL) !=
+		   DMA_COMPLETE) {
+		ret = -EIO;
+	}
+
+err_unmap_dst:
+	dma_unmap_single(dev, dma_dst, len, DMA_FROM_DEVICE);
+	return ret;
+}
+
+/**
+ * imx_sdma_memcpy - copy a large lowmem buffer with the SDMA engine
+ * @dst: destination, kernel linear mapping
+ * @src: source, kernel linear mapping
+ * @len: number of bytes
+ *
+ * Behaves like memcpy() but may sleep. Copies shorter than the
+ * memcpy_threshold parameter, misaligned or non-linear buffers, and
+ * copies issued while the engine is busy with another one are done by
+ * the CPU, as is any copy the engine fails to complete.
+ */
+void imx_sdma_memcpy(void *dst, const void *src, size_t len)
+{
+	struct dma_chan *chan;
+	dma_addr_t dma_src;
+	int ret;
+
+	might_sleep();
+
+	if (len < memcpy_threshold ||
+	    !virt_addr_valid(dst) || !virt_addr_valid(dst + len - 1) ||
+	    !virt_addr_valid(src) || !virt_addr_valid(src + len - 1))
+		goto cpu;
+
+	if (!mutex_trylock(&sdma_memcpy_lock))
+		goto cpu;
+
+	chan = sdma_memcpy_get_chan();
+	if (chan && is_dma_copy_aligned(chan->device, (unsigned long)src,
+					(unsigned long)dst, len)) {
+		dma_src = dma_map_single(chan->device->dev, (void *)src, len,
+					 DMA_TO_DEVICE);
+		if (!dma_mapping_error(chan->device->dev, dma_src)) {
+			ret = sdma_memcpy_offload(chan, dst, dma_src, len);
+			dma_unmap_single(chan->device->dev, dma_src, len,
+					 DMA_TO_DEVICE);
+			if (!ret) {
+				mutex_unlock(&sdma_memcpy_lock);
+				return;
+			}
+		}
+	}
+	mutex_unlock(&sdma_memcpy_lock);
+
+cpu:
+	memcpy(dst, src, len);
+}
+EXPORT_SYMBOL_GPL(imx_sdma_memcpy);
+
+/**
+ * imx_sdma_memcpy_fromio - copy out of a memory-mapped flash window with SDMA
+ * @dst: destination, kernel linear mapping
+ * @src: bus address of the source, e.g. in the QSPI AHB window
+ * @len: number of bytes
+ *
+ * May sleep.  Returns 0 once the data is in @dst, or a negative error if
+ * nothing could be copied: the engine is busy or missing, or @dst is not
+ * suitable for DMA.  The caller then does the copy itself.
+ */
+int imx_sdma_memcpy_fromio(void *dst, phys_addr_t src, size_t len)
+{
+	struct dma_chan *chan;
+	int ret = -ENODEV;
+
+	might_sleep();
+
+	if (!virt_addr_valid(dst) || !virt_addr_valid(dst + len - 1))
+		return -EINVAL;
+
+	if (!mutex_trylock(&sdma_memcpy_lock))
+		return -EBUSY;
+
+	chan = sdma_memcpy_get_chan();
+	if (chan) {
+		if (is_dma_copy_aligned(chan->device, (unsigned long)src,
+					(unsigned long)dst, len))
+			ret = sdma_memcpy_offload(chan, dst, (dma_addr_t)src,
+						  len);
+		else
+			ret = -EINVAL;
+	}
+	mutex_unlock(&sdma_memcpy_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(imx_sdma_memcpy_fromio);
+
 static int sdma_probe(struct platform_device *pdev)
 {
 	const struct of_device_id *of_id =
@@ -2235,7 +2715,7 @@ static int sdma_probe(struct platform_device *pdev)
 		sdma_add_scripts(sdma, pdata->script_addrs);
 
 	if (pdata) {
-		ret = sdma_get_firmware(sdma, pdata->fw_name);
+		ret = sdma_get_firmware_early(sdma, pdata->fw_name);
 		if (ret)
 			dev_warn(&pdev->dev, "failed to get firmware from platform data\n");
 	} else {
@@ -2249,7 +2729,7 @@ static int sdma_probe(struct platform_device *pdev)
 		if (ret)
 			dev_warn(&pdev->dev, "failed to get firmware name\n");
 		else {
-			ret = sdma_get_firmware(sdma, fw_name);
+			ret = sdma_get_firmware_early(sdma, fw_name);
 			if (ret)
 				dev_warn(&pdev->dev, "failed to get firmware from device tree\n");
 		}
@@ -2303,6 +2783,11 @@ static int sdma_probe(struct platform_device *pdev)
 	}
 
 	platform_set_drvdata(pdev, sdma);
+	sdma_init_debugfs(sdma);
+
+	mutex_lock(&sdma_memcpy_lock);
+	sdma_memcpy_engine = sdma;
+	mutex_unlock(&sdma_memcpy_lock);
 	dev_info(sdma->dev, "initialized\n");
 
 	return 0;
@@ -2319,8 +2804,18 @@ static int sdma_remove(struct platform_device *pdev)
 	struct sdma_engine *sdma = platform_get_drvdata(pdev);
 	int i;
 
+	sdma_remove_debugfs(sdma);
+
+	mutex_lock(&sdma_memcpy_lock);
+	if (sdma_memcpy_chan)
+		dma_release_channel(sdma_memcpy_chan);
+	sdma_memcpy_chan = NULL;
+	sdma_memcpy_engine = NULL;
+	mutex_unlock(&sdma_memcpy_lock);
+
 	dma_async_device_unregister(&sdma->dma_device);
 	kfree(sdma->script_addrs);
+	kfree(sdma->ram_code);
 	/* Kill the tasklet */
 	for (i = 0; i < MAX_DMA_CHANNELS; i++) {
 		struct sdma_channel *sdmac = &sdma->channel[i];
@@ -2334,6 +2829,26 @@ static int sdma_remove(struct platform_device *pdev)
 	return 0;
 }
 
+/*
+ * Stop every channel and the scheduler, so that nothing is transferred
+ * into memory the next kernel (kexec) already owns.  sdma_init() of the
+ * next kernel loads channel 0 from scratch.
+ */
+static void sdma_shutdown(struct platform_device *pdev)
+{
+	struct sdma_engine *sdma = platform_get_drvdata(pdev);
+
+	clk_enable(sdma->clk_ipg);
+	clk_enable(sdma->clk_ahb);
+
+	writel_relaxed(0, sdma->regs + SDMA_H_INTRMSK);
+	writel_relaxed(~0, sdma->regs + SDMA_H_STATSTOP);
+	writel_relaxed(0, sdma->regs + SDMA_H_C0PTR);
+
+	clk_disable(sdma->clk_ipg);
+	clk_disable(sdma->clk_ahb);
+}
+
 #ifdef CONFIG_PM_SLEEP
 static int sdma_suspend(struct device *dev)
 {
@@ -2414,7 +2929,18 @@ static int sdma_resume(struct device *dev)
 	/* prepare priority for channel0 to start */
 	sdma_set_channel_priority(&sdma->channel[0], MXC_SDMA_DEFAULT_PRIORITY);
 
-	ret = sdma_get_firmware(sdma, sdma->fw_name);
+	/*
+	 * The SDMA RAM was powered off with the mix. Download the image kept
+	 * from the first load: going through the firmware loader here would
+	 * take long, and the context restore below would race with it.
+	 */
+	if (sdma->ram_code) {
+		ret = sdma_load_script(sdma, sdma->ram_code,
+				       sdma->ram_code_size,
+				       sdma->ram_code_start_addr);
+	} else {
+		ret = sdma_get_firmware(sdma, sdma->fw_name);
+	}
 	if (ret) {
 		dev_warn(&pdev->dev, "failed to get firware\n");
 		return ret;
@@ -2445,6 +2971,7 @@ static struct platform_driver sdma_driver = {
 	},
 	.id_table	= sdma_devtypes,
 	.remove		= sdma_remove,
+	.shutdown	= sdma_shutdown,
 	.probe		= sdma_probe,
 };
 
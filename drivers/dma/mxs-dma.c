@@ -27,6 +27,7 @@
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/of_dma.h>
+#include <linux/dma/mxs-dma.h>
 #include <linux/list.h>
 #include <asm/irq.h>
 
@@ -67,7 +68,7 @@
  * COMMAND:		0..1	(2)
  * CHAIN:		2	(1)
  * IRQ:			3	(1)
- * NAND_LOCK:		4	(1) - not implemented
+ * NAND_LOCK:		4	(1)
  * NAND_WAIT4READY:	5	(1) - not implemented
  * DEC_SEM:		6	(1)
  * WAIT4END:		7	(1)
@@ -80,6 +81,7 @@
 #define BM_CCW_COMMAND		(3 << 0)
 #define CCW_CHAIN		(1 << 2)
 #define CCW_IRQ			(1 << 3)
+#define CCW_NAND_LOCK		(1 << 4)
 #define CCW_DEC_SEM		(1 << 6)
 #define CCW_WAIT4END		(1 << 7)
 #define CCW_HALT_ON_TERM	(1 << 8)
@@ -514,6 +516,11 @@ static void mxs_dma_free_chan_resources(struct dma_chan *chan)
  *            ......
  *            ->device_prep_slave_sg(DMA_PREP_INTERRUPT | DMA_CTRL_ACK); // Last
  *            ......
+ *    [4] A chain that has been prepared but not submitted yet can be extended
+ *        by another sequence as in [2] or [3], whose first command is then
+ *        prepared with DMA_PREP_INTERRUPT as well.  Adding
+ *        MXS_DMA_CTRL_NAND_LOCK to it keeps the GPMI locked to the channel
+ *        from the last command of the old chain into the new one.
  */
 static struct dma_async_tx_descriptor *mxs_dma_prep_slave_sg(
 		struct dma_chan *chan, struct scatterlist *sgl,
@@ -553,6 +560,8 @@ static struct dma_async_tx_descriptor *mxs_dma_prep_slave_sg(
 		ccw->bits |= CCW_CHAIN;
 		ccw->bits &= ~CCW_IRQ;
 		ccw->bits &= ~CCW_DEC_SEM;
+		if (flags & MXS_DMA_CTRL_NAND_LOCK)
+			ccw->bits |= CCW_NAND_LOCK;
 	} else {
 		idx = 0;
 	}
@@ -24,17 +24,25 @@
 #include <linux/uaccess.h>
 #include <linux/delay.h>
 #include <linux/dmaengine.h>
+#include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
+#include <linux/file.h>
 #include <linux/sched.h>
+#include <linux/workqueue.h>
 #include <linux/module.h>
 #include <linux/pxp_device.h>
 #include <linux/atomic.h>
 #include <linux/platform_data/dma-imx.h>
 
+#ifdef CONFIG_SW_SYNC
+#include "../../staging/android/sw_sync.h"
+#endif
+
 #define BUFFER_HASH_ORDER 4
 
 static struct pxp_buffer_hash bufhash;
 static struct pxp_irq_info irq_info[NR_PXP_VIRT_CHANNEL];
+static struct miscdevice pxp_device_miscdev;
 
 static int pxp_ht_create(struct pxp_buffer_hash *hash, int order)
 {
@@ -249,6 +257,22 @@ static void pxp_free_dma_buffer(struct pxp_buf_obj *obj)
 	}
 }
 
+static void pxp_buffer_object_release(struct kref *kref)
+{
+	struct pxp_buf_obj *obj = container_of(kref, struct pxp_buf_obj,
+					       refcount);
+
+	if (obj->attach) {
+		dma_buf_unmap_attachment(obj->attach, obj->sgt,
+					 DMA_BIDIRECTIONAL);
+		dma_buf_detach(obj->dmabuf, obj->attach);
+		dma_buf_put(obj->dmabuf);
+	} else {
+		pxp_free_dma_buffer(obj);
+	}
+	kfree(obj);
+}
+
 static int
 pxp_buffer_object_free(int id, void *ptr, void *data)
 {
@@ -261,12 +285,176 @@ pxp_buffer_object_free(int id, void *ptr, void *data)
 		return ret;
 
 	pxp_ht_remove_item(&bufhash, obj);
-	pxp_free_dma_buffer(obj);
-	kfree(obj);
+	kref_put(&obj->refcount, pxp_buffer_object_release);
 
 	return 0;
 }
 
+#ifdef CONFIG_SW_SYNC
+/* how long a fenced start waits for its in-fence before going ahead */
+#define PXP_FENCE_TIMEOUT_MS	1000
+
+static DEFINE_SPINLOCK(pxp_fence_lock);	/* irq_info[].timeline */
+
+struct pxp_fenced_start {
+	struct work_struct work;
+	struct dma_chan *chan;
+	struct sync_fence *fence;
+};
+
+static void pxp_fence_chan_init(struct dma_chan *chan)
+{
+	struct sw_sync_timeline *timeline;
+
+	timeline = sw_sync_timeline_create(dma_chan_name(chan));
+
+	spin_lock_irq(&pxp_fence_lock);
+	irq_info[chan->chan_id].timeline = timeline;
+	irq_info[chan->chan_id].submitted = 0;
+	spin_unlock_irq(&pxp_fence_lock);
+}
+
+/* Runs the pending fenced starts, then signals what is left with error */
+static void pxp_fence_chan_release(struct pxp_chan_obj *obj)
+{
+	int chan_id = obj->chan->chan_id;
+	struct sw_sync_timeline *timeline;
+
+	if (obj->start_wq) {
+		destroy_workqueue(obj->start_wq);
+		obj->start_wq = NULL;
+	}
+
+	spin_lock_irq(&pxp_fence_lock);
+	timeline = irq_info[chan_id].timeline;
+	irq_info[chan_id].timeline = NULL;
+	spin_unlock_irq(&pxp_fence_lock);
+
+	if (timeline)
+		sync_timeline_destroy(&timeline->obj);
+}
+
+static void pxp_fence_task_done(int chan_id)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pxp_fence_lock, flags);
+	if (irq_info[chan_id].timeline)
+		sw_sync_timeline_inc(irq_info[chan_id].timeline, 1);
+	spin_unlock_irqrestore(&pxp_fence_lock, flags);
+}
+
+static void pxp_fenced_start_work(struct work_struct *work)
+{
+	struct pxp_fenced_start *start =
+		container_of(work, struct pxp_fenced_start, work);
+
+	if (start->fence) {
+		if (sync_fence_wait(start->fence, PXP_FENCE_TIMEOUT_MS) < 0)
+			pr_warn("%s: in-fence not signalled, starting anyway\n",
+				dma_chan_name(start->chan));
+		sync_fence_put(start->fence);
+	}
+
+	dma_async_issue_pending(start->chan);
+	kfree(start);
+}
+
+static int pxp_ioc_start_fenced(struct pxp_file *priv, unsigned long arg)
+{
+	struct pxp_fenced_start *start;
+	struct pxp_fence_desc desc;
+	struct pxp_chan_obj *obj;
+	struct sync_fence *fence;
+	struct sync_pt *pt;
+	int chan_id, fd, ret;
+
+	if (copy_from_user(&desc, (void __user *)arg, sizeof(desc)))
+		return -EFAULT;
+
+	obj = pxp_channel_object_lookup(priv, desc.handle);
+	if (!obj)
+		return -EINVAL;
+	chan_id = obj->chan->chan_id;
+	if (!irq_info[chan_id].timeline)
+		return -ENOMEM;
+
+	mutex_lock(&obj->start_lock);
+	if (!obj->start_wq)
+		obj->start_wq = alloc_ordered_workqueue("pxp_start%d", 0,
+							chan_id);
+	mutex_unlock(&obj->start_lock);
+	if (!obj->start_wq)
+		return -ENOMEM;
+
+	start = kzalloc(sizeof(*start), GFP_KERNEL);
+	if (!start)
+		return -ENOMEM;
+	INIT_WORK(&start->work, pxp_fenced_start_work);
+	start->chan = obj->chan;
+
+	if (desc.in_fence >= 0) {
+		start->fence = sync_fence_fdget(desc.in_fence);
+		if (!start->fence) {
+			ret = -EINVAL;
+			goto err_free;
+		}
+	}
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		ret = fd;
+		goto err_fence;
+	}
+
+	mutex_lock(&obj->start_lock);
+	/* signals once everything configured so far has completed */
+	pt = sw_sync_pt_create(irq_info[chan_id].timeline,
+			       irq_info[chan_id].submitted);
+	if (!pt) {
+		ret = -ENOMEM;
+		goto err_unlock;
+	}
+	fence = sync_fence_create("pxp", pt);
+	if (!fence) {
+		sync_pt_free(pt);
+		ret = -ENOMEM;
+		goto err_unlock;
+	}
+
+	desc.out_fence = fd;
+	if (copy_to_user((void __user *)arg, &desc, sizeof(desc))) {
+		sync_fence_put(fence);
+		ret = -EFAULT;
+		goto err_unlock;
+	}
+
+	sync_fence_install(fence, fd);
+	queue_work(obj->start_wq, &start->work);
+	mutex_unlock(&obj->start_lock);
+	return 0;
+
+err_unlock:
+	mutex_unlock(&obj->start_lock);
+	put_unused_fd(fd);
+err_fence:
+	if (start->fence)
+		sync_fence_put(start->fence);
+err_free:
+	kfree(start);
+	return ret;
+}
+#else
+static inline void pxp_fence_chan_init(struct dma_chan *chan) { }
+static inline void pxp_fence_chan_release(struct pxp_chan_obj *obj) { }
+static inline void pxp_fence_task_done(int chan_id) { }
+
+static int pxp_ioc_start_fenced(struct pxp_file *priv, unsigned long arg)
+{
+	return -ENOTTY;
+}
+#endif
+
 static int
 pxp_channel_object_free(int id, void *ptr, void *data)
 {
@@ -275,6 +463,7 @@ pxp_channel_object_free(int id, void *ptr, void *data)
 	int chan_id;
 
 	chan_id = obj->chan->chan_id;
+	pxp_fence_chan_release(obj);
 	wait_event(irq_info[chan_id].waitq,
 		atomic_read(&irq_info[chan_id].irq_pending) == 0);
 
@@ -311,6 +500,7 @@ static void pxp_dma_done(void *arg)
 
 	atomic_dec(&irq_info[chan_id].irq_pending);
 	irq_info[chan_id].hist_status = tx_desc->hist_status;
+	pxp_fence_task_done(chan_id);
 
 	wake_up(&(irq_info[chan_id].waitq));
 }
@@ -491,8 +681,19 @@ static int pxp_ioc_config_chan(struct pxp_file *priv, unsigned long arg)
 		}
 	}
 
+	/*
+	 * dma_async_issue_pending() starts everything queued on the channel,
+	 * so a task must not be queued behind a fenced start that has not
+	 * been issued yet: it would skip its own start and wait for that
+	 * fence instead.
+	 */
+	mutex_lock(&obj->start_lock);
+	if (obj->start_wq)
+		flush_workqueue(obj->start_wq);
+
 	cookie = txd->tx_submit(txd);
 	if (cookie < 0) {
+		mutex_unlock(&obj->start_lock);
 		pr_err("Error tx_submit\n");
 		kfree(pxp_conf);
 		kfree(sg);
@@ -500,6 +701,8 @@ static int pxp_ioc_config_chan(struct pxp_file *priv, unsigned long arg)
 	}
 
 	atomic_inc(&irq_info[chan_id].irq_pending);
+	irq_info[chan_id].submitted++;
+	mutex_unlock(&obj->start_lock);
 
 	kfree(pxp_conf);
 	kfree(sg);
@@ -507,6 +710,224 @@ static int pxp_ioc_config_chan(struct pxp_file *priv, unsigned long arg)
 	return 0;
 }
 
+/* dma-buf exporter for buffers allocated with PXP_IOC_GET_PHYMEM */
+static struct sg_table *pxp_dmabuf_map(struct dma_buf_attachment *attach,
+				       enum dma_data_direction dir)
+{
+	struct pxp_buf_obj *obj = attach->dmabuf->priv;
+	struct sg_table *sgt;
+	int ret;
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	ret = sg_alloc_table(sgt, 1, GFP_KERNEL);
+	if (ret) {
+		kfree(sgt);
+		return ERR_PTR(ret);
+	}
+
+	sg_set_page(sgt->sgl, pfn_to_page(PFN_DOWN(obj->offset)),
+		    PAGE_ALIGN(obj->size), 0);
+
+	if (!dma_map_sg(attach->dev, sgt->sgl, sgt->orig_nents, dir)) {
+		sg_free_table(sgt);
+		kfree(sgt);
+		return ERR_PTR(-EIO);
+	}
+
+	return sgt;
+}
+
+static void pxp_dmabuf_unmap(struct dma_buf_attachment *attach,
+			     struct sg_table *sgt,
+			     enum dma_data_direction dir)
+{
+	dma_unmap_sg(attach->dev, sgt->sgl, sgt->orig_nents, dir);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void pxp_dmabuf_release(struct dma_buf *dmabuf)
+{
+	struct pxp_buf_obj *obj = dmabuf->priv;
+
+	kref_put(&obj->refcount, pxp_buffer_object_release);
+}
+
+static void *pxp_dmabuf_kmap(struct dma_buf *dmabuf, unsigned long pgnum)
+{
+	struct pxp_buf_obj *obj = dmabuf->priv;
+
+	return obj->virtual + pgnum * PAGE_SIZE;
+}
+
+static int pxp_dmabuf_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
+{
+	struct pxp_buf_obj *obj = dmabuf->priv;
+
+	if (vma->vm_pgoff + vma_pages(vma) >
+	    PAGE_ALIGN(obj->size) >> PAGE_SHIFT)
+		return -EINVAL;
+
+	switch (obj->mem_type) {
+	case MEMORY_TYPE_UNCACHED:
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+		break;
+	case MEMORY_TYPE_WC:
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+		break;
+	case MEMORY_TYPE_CACHED:
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       PFN_DOWN(obj->offset) + vma->vm_pgoff,
+			       vma->vm_end - vma->vm_start,
+			       vma->vm_page_prot) ? -EAGAIN : 0;
+}
+
+static const struct dma_buf_ops pxp_dmabuf_ops = {
+	.map_dma_buf = pxp_dmabuf_map,
+	.unmap_dma_buf = pxp_dmabuf_unmap,
+	.release = pxp_dmabuf_release,
+	.kmap_atomic = pxp_dmabuf_kmap,
+	.kmap = pxp_dmabuf_kmap,
+	.mmap = pxp_dmabuf_mmap,
+};
+
+static int pxp_ioc_export_dmabuf(struct pxp_file *priv, unsigned long arg)
+{
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct pxp_dmabuf_desc desc;
+	struct pxp_buf_obj *obj;
+	struct dma_buf *dmabuf;
+	int fd;
+
+	if (copy_from_user(&desc, (void __user *)arg, sizeof(desc)))
+		return -EFAULT;
+
+	obj = pxp_buffer_object_lookup(priv, desc.handle);
+	if (!obj)
+		return -EINVAL;
+
+	/* re-exporting an imported buffer is the original exporter's job */
+	if (obj->attach)
+		return -EINVAL;
+
+	exp_info.ops = &pxp_dmabuf_ops;
+	exp_info.size = PAGE_ALIGN(obj->size);
+	exp_info.flags = O_RDWR;
+	exp_info.priv = obj;
+
+	kref_get(&obj->refcount);
+	dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf)) {
+		kref_put(&obj->refcount, pxp_buffer_object_release);
+		return PTR_ERR(dmabuf);
+	}
+
+	fd = dma_buf_fd(dmabuf, desc.flags & O_CLOEXEC);
+	if (fd < 0) {
+		/* drops the reference taken for the dma-buf */
+		dma_buf_put(dmabuf);
+		return fd;
+	}
+
+	desc.fd = fd;
+	desc.size = obj->size;
+	desc.phys_addr = obj->offset;
+
+	/* the fd is installed already, userspace owns it from here on */
+	if (copy_to_user((void __user *)arg, &desc, sizeof(desc)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*
+ * Import a dma-buf, e.g. a V4L2 capture buffer or a DRM framebuffer. The
+ * PXP has no MMU, so only buffers contiguous in bus address space work.
+ */
+static int pxp_ioc_import_dmabuf(struct pxp_file *priv, unsigned long arg)
+{
+	struct pxp_dmabuf_desc desc;
+	struct pxp_buf_obj *obj;
+	struct scatterlist *sg;
+	dma_addr_t next;
+	unsigned int i;
+	int ret;
+
+	if (copy_from_user(&desc, (void __user *)arg, sizeof(desc)))
+		return -EFAULT;
+
+	obj = kzalloc(sizeof(*obj), GFP_KERNEL);
+	if (!obj)
+		return -ENOMEM;
+	kref_init(&obj->refcount);
+
+	obj->dmabuf = dma_buf_get(desc.fd);
+	if (IS_ERR(obj->dmabuf)) {
+		ret = PTR_ERR(obj->dmabuf);
+		goto err_free;
+	}
+
+	obj->attach = dma_buf_attach(obj->dmabuf,
+				     pxp_device_miscdev.this_device);
+	if (IS_ERR(obj->attach)) {
+		ret = PTR_ERR(obj->attach);
+		goto err_put;
+	}
+
+	obj->sgt = dma_buf_map_attachment(obj->attach, DMA_BIDIRECTIONAL);
+	if (IS_ERR(obj->sgt)) {
+		ret = PTR_ERR(obj->sgt);
+		goto err_detach;
+	}
+
+	next = sg_dma_address(obj->sgt->sgl);
+	for_each_sg(obj->sgt->sgl, sg, obj->sgt->nents, i) {
+		if (sg_dma_address(sg) != next) {
+			pr_err("%s: dma-buf is not contiguous\n", __func__);
+			ret = -EINVAL;
+			goto err_unmap;
+		}
+		next += sg_dma_len(sg);
+	}
+
+	obj->offset = sg_dma_address(obj->sgt->sgl);
+	obj->size = obj->dmabuf->size;
+
+	ret = pxp_buffer_handle_create(priv, obj, &obj->handle);
+	if (ret)
+		goto err_unmap;
+
+	desc.handle = obj->handle;
+	desc.size = obj->size;
+	desc.phys_addr = obj->offset;
+
+	if (copy_to_user((void __user *)arg, &desc, sizeof(desc))) {
+		pxp_buffer_handle_delete(priv, obj->handle);
+		kref_put(&obj->refcount, pxp_buffer_object_release);
+		return -EFAULT;
+	}
+
+	return 0;
+
+err_unmap:
+	dma_buf_unmap_attachment(obj->attach, obj->sgt, DMA_BIDIRECTIONAL);
+err_detach:
+	dma_buf_detach(obj->dmabuf, obj->attach);
+err_put:
+	dma_buf_put(obj->dmabuf);
+err_free:
+	kfree(obj);
+	return ret;
+}
+
 static int pxp_device_open(struct inode *inode, struct file *filp)
 {
 	struct pxp_file *priv;
@@ -624,6 +1045,7 @@ static long pxp_device_ioctl(struct file *filp,
 				return -ENOMEM;
 			}
 			obj->chan = chan;
+			mutex_init(&obj->start_lock);
 
 			ret = pxp_channel_handle_create(file_priv, obj,
 							&obj->handle);
@@ -640,6 +1062,7 @@ static long pxp_device_ioctl(struct file *filp,
 				kfree(obj);
 				return -EFAULT;
 			}
+			pxp_fence_chan_init(chan);
 
 			break;
 		}
@@ -657,6 +1080,7 @@ static long pxp_device_ioctl(struct file *filp,
 			if (!obj)
 				return -EINVAL;
 
+			pxp_fence_chan_release(obj);
 			pxp_channel_handle_delete(file_priv, obj->handle);
 			dma_release_channel(obj->chan);
 			kfree(obj);
@@ -708,6 +1132,7 @@ static long pxp_device_ioctl(struct file *filp,
 				return -ENOMEM;
 			obj->size = buffer.size;
 			obj->mem_type = buffer.mtype;
+			kref_init(&obj->refcount);
 
 			ret = pxp_alloc_dma_buffer(obj);
 			if (ret == -1) {
@@ -759,8 +1184,7 @@ static long pxp_device_ioctl(struct file *filp,
 				return ret;
 
 			pxp_ht_remove_item(&bufhash, obj);
-			pxp_free_dma_buffer(obj);
-			kfree(obj);
+			kref_put(&obj->refcount, pxp_buffer_object_release);
 
 			break;
 		}
@@ -777,7 +1201,7 @@ static long pxp_device_ioctl(struct file *filp,
 				return -EACCES;
 
 			obj = pxp_buffer_object_lookup(file_priv, flush.handle);
-			if (!obj)
+			if (!obj || obj->attach)
 				return -EINVAL;
 
 			switch (flush.type) {
@@ -834,6 +1258,12 @@ static long pxp_device_ioctl(struct file *filp,
 				return -EFAULT;
 			break;
 		}
+	case PXP_IOC_IMPORT_DMABUF:
+		return pxp_ioc_import_dmabuf(file_priv, arg);
+	case PXP_IOC_EXPORT_DMABUF:
+		return pxp_ioc_export_dmabuf(file_priv, arg);
+	case PXP_IOC_START_FENCED:
+		return pxp_ioc_start_fenced(file_priv, arg);
 	default:
 		break;
 	}
@@ -862,6 +1292,11 @@ int register_pxp_device(void)
 	if (ret)
 		return ret;
 
+	/* dma-buf attachments are made on behalf of the misc device */
+	pxp_device_miscdev.this_device->coherent_dma_mask = DMA_BIT_MASK(32);
+	pxp_device_miscdev.this_device->dma_mask =
+		&pxp_device_miscdev.this_device->coherent_dma_mask;
+
 	ret = pxp_ht_create(&bufhash, BUFFER_HASH_ORDER);
 	if (ret)
 		return ret;
@@ -1368,11 +1368,11 @@ static void pxp_clk_disable(struct pxps *pxp)
 		clk_disable_unprepare(pxp->ipg_clk);
 		clk_disable_unprepare(pxp->axi_clk);
 		pxp->clk_stat = CLK_STAT_OFF;
+		/* pairs with the get done when the clocks were turned on */
+		pm_runtime_put_sync_suspend(pxp->dev);
 	} else
 		spin_unlock_irqrestore(&pxp->lock, flags);
 
-	pm_runtime_put_sync_suspend(pxp->dev);
-
 	mutex_unlock(&pxp->clk_mutex);
 }
 
@@ -1383,15 +1383,17 @@ static inline void clkoff_callback(struct work_struct *w)
 	pxp_clk_disable(pxp);
 }
 
+/*
+ * Armed only when the task queue runs dry, so a busy PxP does not touch
+ * the timer once per frame. If work arrived in the meantime, the next
+ * idle transition re-arms it.
+ */
 static void pxp_clkoff_timer(unsigned long arg)
 {
 	struct pxps *pxp = (struct pxps *)arg;
 
 	if ((pxp->pxp_ongoing == 0) && list_empty(&head))
 		schedule_work(&pxp->work);
-	else
-		mod_timer(&pxp->clk_timer,
-			  jiffies + msecs_to_jiffies(timeout_in_ms));
 }
 
 static struct pxp_tx_desc *pxpdma_first_queued(struct pxp_channel *pxp_chan)
@@ -1416,6 +1418,8 @@ static void __pxpdma_dostart(struct pxp_channel *pxp_chan)
 	memset(&pxp->pxp_conf_state.proc_data, 0,  sizeof(struct pxp_proc_data));
 	/* S0 */
 	desc = list_first_entry(&head, struct pxp_tx_desc, list);
+	/* several tasks can be queued, take the layer count of this one */
+	pxp->pxp_conf_state.layer_nr = desc->len;
 	memcpy(&pxp->pxp_conf_state.s0_param,
 	       &desc->layer_param.s0_param, sizeof(struct pxp_layer_param));
 	memcpy(&pxp->pxp_conf_state.proc_data,
@@ -1502,16 +1506,14 @@ static void __pxpdma_dostart(struct pxp_channel *pxp_chan)
 		 pxp->pxp_conf_state.out_param.paddr);
 }
 
-static void pxpdma_dostart_work(struct pxps *pxp)
+/* called with pxp->lock held, starts the first task on the queue */
+static void __pxpdma_dostart_work(struct pxps *pxp)
 {
 	struct pxp_channel *pxp_chan = NULL;
-	unsigned long flags;
 	struct pxp_tx_desc *desc = NULL;
 	struct pxp_config_data *config_data = &pxp->pxp_conf_state;
 	struct pxp_proc_data *proc_data = &config_data->proc_data;
 
-	spin_lock_irqsave(&pxp->lock, flags);
-
 	desc = list_entry(head.next, struct pxp_tx_desc, list);
 	pxp_chan = to_pxp_channel(desc->txd.chan);
 
@@ -1525,10 +1527,29 @@ static void pxpdma_dostart_work(struct pxps *pxp)
 			pxp_start2(pxp);
 	} else
 		pxp_start(pxp);
+}
 
+static void pxpdma_dostart_work(struct pxps *pxp)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pxp->lock, flags);
+	__pxpdma_dostart_work(pxp);
 	spin_unlock_irqrestore(&pxp->lock, flags);
 }
 
+/*
+ * Legacy (PS/AS/OUT) tasks need nothing from the dispatch thread between
+ * them, so the interrupt handler starts the next one right away instead
+ * of waking the thread and waiting for it to be scheduled. Standard mode
+ * tasks (WFE, dithering) still go through the thread, which does the LUT
+ * cleanup after each of them.
+ */
+static bool pxp_task_can_chain(struct pxp_tx_desc *desc)
+{
+	return !(desc->proc_data.working_mode & PXP_MODE_STANDARD);
+}
+
 static void pxpdma_dequeue(struct pxp_channel *pxp_chan, struct pxps *pxp)
 {
 	unsigned long flags;
@@ -1607,6 +1628,7 @@ static irqreturn_t pxp_irq(int irq, void *dev_id)
 	u32 hist_status;
 	u32 pixel_nums;
 	int pxp_irq_status = 0;
+	bool chained;
 
 	dump_pxp_reg(pxp);
 
@@ -1681,6 +1703,15 @@ static irqreturn_t pxp_irq(int irq, void *dev_id)
 	desc->hist_status = hist_status;
 	desc->pixel_nums = pixel_nums;
 
+	/* keep the PxP busy while the callback and cleanup run */
+	list_del_init(&desc->list);
+	chained = pxp_task_can_chain(desc) && !list_empty(&head) &&
+		  pxp_task_can_chain(list_first_entry(&head,
+						      struct pxp_tx_desc,
+						      list));
+	if (chained)
+		__pxpdma_dostart_work(pxp);
+
 	if ((desc->txd.flags & DMA_PREP_INTERRUPT) && callback)
 		callback(callback_param);
 
@@ -1690,13 +1721,15 @@ static irqreturn_t pxp_irq(int irq, void *dev_id)
 		list_del_init(&child->list);
 		kmem_cache_free(tx_desc_cache, (void *)child);
 	}
-	list_del_init(&desc->list);
 	kmem_cache_free(tx_desc_cache, (void *)desc);
 
-
 	complete(&pxp->complete);
-	pxp->pxp_ongoing = 0;
-	mod_timer(&pxp->clk_timer, jiffies + msecs_to_jiffies(timeout_in_ms));
+	if (!chained) {
+		pxp->pxp_ongoing = 0;
+		if (list_empty(&head))
+			mod_timer(&pxp->clk_timer,
+				  jiffies + msecs_to_jiffies(timeout_in_ms));
+	}
 
 	spin_unlock_irqrestore(&pxp->lock, flags);
 
@@ -5116,6 +5149,7 @@ static int pxp_dispatch_thread(void *argv)
 	struct pxps *pxp = (struct pxps *)argv;
 	struct pxp_channel *pending = NULL;
 	unsigned long flags;
+	int busy;
 
 	set_freezable();
 
@@ -5135,7 +5169,21 @@ static int pxp_dispatch_thread(void *argv)
 		spin_unlock_irqrestore(&pxp->lock, flags);
 		init_completion(&pxp->complete);
 		pxpdma_dostart_work(pxp);
-		ret = wait_for_completion_timeout(&pxp->complete, 2 * HZ);
+
+		/*
+		 * Every finished task completes once; the interrupt handler
+		 * may have started the next one itself, in which case the
+		 * PxP is still busy and the timeout applies to that task.
+		 */
+		do {
+			ret = wait_for_completion_timeout(&pxp->complete,
+							  2 * HZ);
+			if (ret == 0)
+				break;
+			spin_lock_irqsave(&pxp->lock, flags);
+			busy = pxp->pxp_ongoing;
+			spin_unlock_irqrestore(&pxp->lock, flags);
+		} while (busy);
 		if (ret == 0) {
 			printk(KERN_EMERG "%s: task is timeout\n\n", __func__);
 			break;
@@ -263,6 +263,22 @@ static void bgpio_set_multiple_with_clear(struct gpio_chip *gc,
 		bgc->write_reg(bgc->reg_clr, clear_mask);
 }
 
+static int bgpio_get_multiple(struct gpio_chip *gc, unsigned long *mask,
+			      unsigned long *bits)
+{
+	struct bgpio_chip *bgc = to_bgpio_chip(gc);
+	unsigned long val = bgc->read_reg(bgc->reg_dat);
+	int i;
+
+	for_each_set_bit(i, mask, bgc->bits) {
+		if (val & bgc->pin2mask(bgc, i))
+			__set_bit(i, bits);
+		else
+			__clear_bit(i, bits);
+	}
+	return 0;
+}
+
 static int bgpio_simple_dir_in(struct gpio_chip *gc, unsigned int gpio)
 {
 	return 0;
@@ -438,6 +454,7 @@ static int bgpio_setup_io(struct bgpio_chip *bgc,
 	}
 
 	bgc->gc.get = bgpio_get;
+	bgc->gc.get_multiple = bgpio_get_multiple;
 
 	return 0;
 }
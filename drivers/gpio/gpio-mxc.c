@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
@@ -27,8 +28,14 @@
 #include <linux/irqdomain.h>
 #include <linux/irqchip/chained_irq.h>
 #include <linux/gpio.h>
+#include <linux/kfifo.h>
 #include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/miscdevice.h>
+#include <linux/uaccess.h>
+#include <linux/mxc_gpio.h>
 #include <linux/basic_mmio_gpio.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
@@ -66,6 +73,11 @@ struct mxc_gpio_port {
 	struct irq_domain *domain;
 	struct bgpio_chip bgc;
 	u32 both_edges;
+#ifdef CONFIG_GPIO_MXC_CDEV
+	struct miscdevice misc;
+	char misc_name[16];
+	unsigned long watched;
+#endif
 };
 
 static struct mxc_gpio_hwdata imx1_imx21_gpio_hwdata = {
@@ -231,11 +243,53 @@ static int gpio_set_irq_type(struct irq_data *d, u32 type)
 	return 0;
 }
 
-static void mxc_flip_edge(struct mxc_gpio_port *port, u32 gpio)
+#ifdef CONFIG_GPIO_MXC_CDEV
+/*
+ * Time and line levels of the bank interrupt being handled on this CPU,
+ * taken once on entry to the chained handler for the user space event
+ * queue.  With emulated both-edge triggers the level comes from the
+ * trigger that fired rather than from the pad status register, which
+ * may already have moved on.
+ */
+struct mxc_gpio_stamp {
+	u64 timestamp;
+	u32 level;
+};
+
+static DEFINE_PER_CPU(struct mxc_gpio_stamp, mxc_gpio_stamps);
+
+static inline void mxc_gpio_stamp(struct mxc_gpio_port *port, u32 irq_stat)
+{
+	struct mxc_gpio_stamp *s;
+
+	if (!(irq_stat & port->watched))
+		return;
+
+	s = this_cpu_ptr(&mxc_gpio_stamps);
+	s->timestamp = ktime_get_ns();
+	s->level = readl(port->base + GPIO_PSR);
+}
+
+static inline void mxc_gpio_stamp_level(u32 gpio, int level)
+{
+	struct mxc_gpio_stamp *s = this_cpu_ptr(&mxc_gpio_stamps);
+
+	if (level)
+		s->level |= BIT(gpio);
+	else
+		s->level &= ~BIT(gpio);
+}
+#else
+static inline void mxc_gpio_stamp(struct mxc_gpio_port *port, u32 irq_stat) {}
+static inline void mxc_gpio_stamp_level(u32 gpio, int level) {}
+#endif
+
+/* returns the level the interrupt triggered on, or a negative error */
+static int mxc_flip_edge(struct mxc_gpio_port *port, u32 gpio)
 {
 	void __iomem *reg = port->base;
 	u32 bit, val;
-	int edge;
+	int edge, level;
 
 	reg += GPIO_ICR1 + ((gpio & 0x10) >> 2); /* lower or upper register */
 	bit = gpio & 0xf;
@@ -244,26 +298,36 @@ static void mxc_flip_edge(struct mxc_gpio_port *port, u32 gpio)
 	val &= ~(0x3 << (bit << 1));
 	if (edge == GPIO_INT_HIGH_LEV) {
 		edge = GPIO_INT_LOW_LEV;
+		level = 1;
 		pr_debug("mxc: switch GPIO %d to low trigger\n", gpio);
 	} else if (edge == GPIO_INT_LOW_LEV) {
 		edge = GPIO_INT_HIGH_LEV;
+		level = 0;
 		pr_debug("mxc: switch GPIO %d to high trigger\n", gpio);
 	} else {
 		pr_err("mxc: invalid configuration for GPIO %d: %x\n",
 		       gpio, edge);
-		return;
+		return -EINVAL;
 	}
 	writel(val | (edge << (bit << 1)), reg);
+	return level;
 }
 
 /* handle 32 interrupts in one status register */
 static void mxc_gpio_irq_handler(struct mxc_gpio_port *port, u32 irq_stat)
 {
+	int level;
+
+	mxc_gpio_stamp(port, irq_stat);
+
 	while (irq_stat != 0) {
 		int irqoffset = fls(irq_stat) - 1;
 
-		if (port->both_edges & (1 << irqoffset))
-			mxc_flip_edge(port, irqoffset);
+		if (port->both_edges & (1 << irqoffset)) {
+			level = mxc_flip_edge(port, irqoffset);
+			if (level >= 0)
+				mxc_gpio_stamp_level(irqoffset, level);
+		}
 
 		generic_handle_irq(irq_find_mapping(port->domain, irqoffset));
 
@@ -400,6 +464,376 @@ static int mxc_gpio_to_irq(struct gpio_chip *gc, unsigned offset)
 	return irq_find_mapping(port->domain, offset);
 }
 
+#ifdef CONFIG_GPIO_MXC_CDEV
+#define MXC_GPIO_EVENTS		256
+
+/* the lines of one bank claimed through one open file */
+struct mxc_gpio_user {
+	struct mxc_gpio_port *port;
+	struct mutex lock;	/* serialises REQUEST and WATCH */
+	u32 lines;
+	u32 outputs;
+
+	/* edge events, filled from the line interrupts */
+	u32 watched;
+	u32 both;		/* lines watched for both edges */
+	u32 rising;		/* lines watched for rising edges only */
+	u32 last_level;
+	u32 dropped;
+	spinlock_t event_lock;
+	struct mutex read_lock;
+	wait_queue_head_t wait;
+	DECLARE_KFIFO(events, struct mxc_gpio_event, MXC_GPIO_EVENTS);
+};
+
+static irqreturn_t mxc_gpio_user_irq(int irq, void *dev_id)
+{
+	struct mxc_gpio_user *user = dev_id;
+	struct mxc_gpio_stamp *s = this_cpu_ptr(&mxc_gpio_stamps);
+	u32 line = irqd_to_hwirq(irq_get_irq_data(irq));
+	struct mxc_gpio_event ev = {
+		.timestamp	= s->timestamp,
+		.line		= line,
+	};
+
+	if (user->both & BIT(line))
+		ev.level = !!(s->level & BIT(line));
+	else
+		ev.level = !!(user->rising & BIT(line));
+
+	spin_lock(&user->event_lock);
+	/* the same level twice in a row means an edge went by unseen */
+	if (user->both & BIT(line) &&
+	    ev.level == !!(user->last_level & BIT(line)))
+		user->dropped++;
+	if (ev.level)
+		user->last_level |= BIT(line);
+	else
+		user->last_level &= ~BIT(line);
+
+	ev.dropped = user->dropped;
+	if (kfifo_put(&user->events, ev))
+		user->dropped = 0;
+	else
+		user->dropped++;
+	spin_unlock(&user->event_lock);
+
+	wake_up_interruptible(&user->wait);
+	return IRQ_HANDLED;
+}
+
+static void mxc_gpio_user_unwatch(struct mxc_gpio_user *user, u32 lines)
+{
+	struct mxc_gpio_port *port = user->port;
+	unsigned long mask = lines & user->watched;
+	int i;
+
+	for_each_set_bit(i, &mask, 32) {
+		free_irq(irq_find_mapping(port->domain, i), user);
+		clear_bit(i, &port->watched);
+	}
+	user->watched &= ~lines;
+	user->both &= ~lines;
+	user->rising &= ~lines;
+}
+
+static int mxc_gpio_user_watch(struct mxc_gpio_user *user,
+			       struct mxc_gpio_watch *w)
+{
+	struct mxc_gpio_port *port = user->port;
+	unsigned base = port->bgc.gc.base;
+	unsigned long mask = w->lines;
+	unsigned long flags;
+	u32 watched = 0;
+	int i, ret = 0;
+
+	if (w->lines & ~(user->lines & ~user->outputs) ||
+	    w->lines & user->watched)
+		return -EINVAL;
+
+	switch (w->edges) {
+	case MXC_GPIO_EDGE_RISING:
+		flags = IRQF_TRIGGER_RISING;
+		break;
+	case MXC_GPIO_EDGE_FALLING:
+		flags = IRQF_TRIGGER_FALLING;
+		break;
+	case MXC_GPIO_EDGE_BOTH:
+		flags = IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	for_each_set_bit(i, &mask, 32) {
+		if (gpio_get_value(base + i))
+			user->last_level |= BIT(i);
+		else
+			user->last_level &= ~BIT(i);
+		if (w->edges == MXC_GPIO_EDGE_BOTH)
+			user->both |= BIT(i);
+		else if (w->edges == MXC_GPIO_EDGE_RISING)
+			user->rising |= BIT(i);
+
+		set_bit(i, &port->watched);
+		ret = request_irq(irq_find_mapping(port->domain, i),
+				  mxc_gpio_user_irq, flags, "mxc_gpio-user",
+				  user);
+		if (ret) {
+			clear_bit(i, &port->watched);
+			break;
+		}
+		watched |= BIT(i);
+		user->watched |= BIT(i);
+	}
+
+	/* also drops the edge selection of the line that failed */
+	if (ret)
+		mxc_gpio_user_unwatch(user, watched | BIT(i));
+	return ret;
+}
+
+static void mxc_gpio_user_free(struct mxc_gpio_user *user, u32 lines)
+{
+	unsigned base = user->port->bgc.gc.base;
+	unsigned long mask = lines;
+	int i;
+
+	mxc_gpio_user_unwatch(user, lines);
+	for_each_set_bit(i, &mask, 32)
+		gpio_free(base + i);
+	user->lines &= ~lines;
+	user->outputs &= ~lines;
+}
+
+static int mxc_gpio_user_request(struct mxc_gpio_user *user,
+				 struct mxc_gpio_request *req)
+{
+	unsigned base = user->port->bgc.gc.base;
+	unsigned long mask = req->lines;
+	u32 claimed = 0;
+	int i, ret = 0;
+
+	if (req->outputs & ~req->lines || req->lines & user->lines)
+		return -EINVAL;
+
+	for_each_set_bit(i, &mask, 32) {
+		ret = gpio_request(base + i, "mxc_gpio-user");
+		if (ret)
+			break;
+		claimed |= BIT(i);
+
+		if (req->outputs & BIT(i))
+			ret = gpio_direction_output(base + i,
+						    !!(req->values & BIT(i)));
+		else
+			ret = gpio_direction_input(base + i);
+		if (ret)
+			break;
+	}
+
+	user->lines |= claimed;
+	user->outputs |= claimed & req->outputs;
+	if (ret)
+		mxc_gpio_user_free(user, claimed);
+	return ret;
+}
+
+static int mxc_gpio_user_sequence(struct mxc_gpio_user *user,
+				  struct mxc_gpio_sequence *seq)
+{
+	struct gpio_chip *gc = &user->port->bgc.gc;
+	const u32 __user *p = (const u32 __user *)(unsigned long)seq->values;
+	unsigned long mask, bits;
+	u32 buf[64];
+	u32 i, n;
+
+	if (seq->mask & ~user->outputs ||
+	    seq->delay_ns > MXC_GPIO_SEQUENCE_MAX_DELAY)
+		return -EINVAL;
+
+	while (seq->count) {
+		n = min_t(u32, seq->count, ARRAY_SIZE(buf));
+		if (copy_from_user(buf, p, n * sizeof(*buf)))
+			return -EFAULT;
+
+		for (i = 0; i < n; i++) {
+			mask = seq->mask;
+			bits = buf[i];
+			gc->set_multiple(gc, &mask, &bits);
+			if (seq->delay_ns)
+				ndelay(seq->delay_ns);
+		}
+
+		p += n;
+		seq->count -= n;
+		if (fatal_signal_pending(current))
+			return -EINTR;
+		cond_resched();
+	}
+	return 0;
+}
+
+static long mxc_gpio_user_ioctl(struct file *file, unsigned int cmd,
+				unsigned long arg)
+{
+	struct mxc_gpio_user *user = file->private_data;
+	struct gpio_chip *gc = &user->port->bgc.gc;
+	void __user *argp = (void __user *)arg;
+	struct mxc_gpio_request req;
+	struct mxc_gpio_values val;
+	struct mxc_gpio_sequence seq;
+	struct mxc_gpio_watch watch;
+	unsigned long mask, bits = 0;
+	int ret;
+
+	switch (cmd) {
+	case MXC_GPIO_IOC_REQUEST:
+		if (copy_from_user(&req, argp, sizeof(req)))
+			return -EFAULT;
+		mutex_lock(&user->lock);
+		ret = mxc_gpio_user_request(user, &req);
+		mutex_unlock(&user->lock);
+		return ret;
+
+	case MXC_GPIO_IOC_GET:
+		if (copy_from_user(&val, argp, sizeof(val)))
+			return -EFAULT;
+		if (val.mask & ~user->lines)
+			return -EINVAL;
+		mask = val.mask;
+		ret = gc->get_multiple(gc, &mask, &bits);
+		if (ret)
+			return ret;
+		val.values = bits & val.mask;
+		return copy_to_user(argp, &val, sizeof(val)) ? -EFAULT : 0;
+
+	case MXC_GPIO_IOC_SET:
+		if (copy_from_user(&val, argp, sizeof(val)))
+			return -EFAULT;
+		if (val.mask & ~user->outputs)
+			return -EINVAL;
+		mask = val.mask;
+		bits = val.values;
+		gc->set_multiple(gc, &mask, &bits);
+		return 0;
+
+	case MXC_GPIO_IOC_SEQUENCE:
+		if (copy_from_user(&seq, argp, sizeof(seq)))
+			return -EFAULT;
+		return mxc_gpio_user_sequence(user, &seq);
+
+	case MXC_GPIO_IOC_WATCH:
+		if (copy_from_user(&watch, argp, sizeof(watch)))
+			return -EFAULT;
+		mutex_lock(&user->lock);
+		ret = mxc_gpio_user_watch(user, &watch);
+		mutex_unlock(&user->lock);
+		return ret;
+	}
+
+	return -ENOTTY;
+}
+
+static int mxc_gpio_user_open(struct inode *inode, struct file *file)
+{
+	struct mxc_gpio_port *port =
+		container_of(file->private_data, struct mxc_gpio_port, misc);
+	struct mxc_gpio_user *user;
+
+	user = kzalloc(sizeof(*user), GFP_KERNEL);
+	if (!user)
+		return -ENOMEM;
+
+	user->port = port;
+	mutex_init(&user->lock);
+	spin_lock_init(&user->event_lock);
+	mutex_init(&user->read_lock);
+	init_waitqueue_head(&user->wait);
+	INIT_KFIFO(user->events);
+	file->private_data = user;
+	return nonseekable_open(inode, file);
+}
+
+static ssize_t mxc_gpio_user_read(struct file *file, char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct mxc_gpio_user *user = file->private_data;
+	unsigned int copied;
+	int ret;
+
+	if (count < sizeof(struct mxc_gpio_event))
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&user->read_lock))
+		return -ERESTARTSYS;
+
+	while (kfifo_is_empty(&user->events)) {
+		if (file->f_flags & O_NONBLOCK) {
+			ret = -EAGAIN;
+			goto out;
+		}
+		ret = wait_event_interruptible(user->wait,
+					       !kfifo_is_empty(&user->events));
+		if (ret)
+			goto out;
+	}
+
+	ret = kfifo_to_user(&user->events, buf, count, &copied);
+out:
+	mutex_unlock(&user->read_lock);
+	return ret ? ret : copied;
+}
+
+static unsigned int mxc_gpio_user_poll(struct file *file, poll_table *wait)
+{
+	struct mxc_gpio_user *user = file->private_data;
+
+	poll_wait(file, &user->wait, wait);
+	return kfifo_is_empty(&user->events) ? 0 : POLLIN | POLLRDNORM;
+}
+
+static int mxc_gpio_user_release(struct inode *inode, struct file *file)
+{
+	struct mxc_gpio_user *user = file->private_data;
+
+	mxc_gpio_user_free(user, user->lines);
+	kfree(user);
+	return 0;
+}
+
+static const struct file_operations mxc_gpio_user_fops = {
+	.owner		= THIS_MODULE,
+	.open		= mxc_gpio_user_open,
+	.release	= mxc_gpio_user_release,
+	.read		= mxc_gpio_user_read,
+	.poll		= mxc_gpio_user_poll,
+	.unlocked_ioctl	= mxc_gpio_user_ioctl,
+	.llseek		= no_llseek,
+};
+
+static void mxc_gpio_cdev_register(struct mxc_gpio_port *port,
+				   struct device *dev)
+{
+	int err;
+
+	snprintf(port->misc_name, sizeof(port->misc_name), "mxc_gpio%d",
+		 port->bgc.gc.base / 32);
+	port->misc.minor = MISC_DYNAMIC_MINOR;
+	port->misc.name = port->misc_name;
+	port->misc.fops = &mxc_gpio_user_fops;
+	port->misc.parent = dev;
+
+	err = misc_register(&port->misc);
+	if (err)
+		dev_warn(dev, "failed to register %s: %d\n",
+			 port->misc_name, err);
+}
+#else
+static inline void mxc_gpio_cdev_register(struct mxc_gpio_port *port,
+					  struct device *dev) {}
+#endif
+
 static int mxc_gpio_probe(struct platform_device *pdev)
 {
 	struct device_node *np = pdev->dev.of_node;
@@ -480,6 +914,8 @@ static int mxc_gpio_probe(struct platform_device *pdev)
 
 	list_add_tail(&port->node, &mxc_gpio_ports);
 
+	mxc_gpio_cdev_register(port, &pdev->dev);
+
 	return 0;
 
 out_irqdesc_free:
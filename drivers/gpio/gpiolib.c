@@ -1208,6 +1208,116 @@ int gpiod_get_value(const struct gpio_desc *desc)
 }
 EXPORT_SYMBOL_GPL(gpiod_get_value);
 
+/*
+ * read multiple inputs on the same chip;
+ * use the chip's get_multiple function if available;
+ * otherwise read the inputs one after the other;
+ * @mask: bit mask array, as for gpio_chip_set_multiple()
+ * @bits: bit value array receiving the values of the inputs in mask
+ */
+static int gpio_chip_get_multiple(struct gpio_chip *chip,
+				  unsigned long *mask, unsigned long *bits)
+{
+	int i;
+
+	if (chip->get_multiple)
+		return chip->get_multiple(chip, mask, bits);
+	if (!chip->get)
+		return -EIO;
+
+	for_each_set_bit(i, mask, chip->ngpio) {
+		if (chip->get(chip, i))
+			__set_bit(i, bits);
+		else
+			__clear_bit(i, bits);
+	}
+	return 0;
+}
+
+static int gpiod_get_array_priv(bool raw, bool can_sleep,
+				unsigned int array_size,
+				struct gpio_desc **desc_array,
+				int *value_array)
+{
+	int i = 0;
+
+	while (i < array_size) {
+		struct gpio_chip *chip = desc_array[i]->chip;
+		unsigned long mask[BITS_TO_LONGS(chip->ngpio)];
+		unsigned long bits[BITS_TO_LONGS(chip->ngpio)];
+		int first = i, ret;
+
+		if (!can_sleep)
+			WARN_ON(chip->can_sleep);
+
+		memset(mask, 0, sizeof(mask));
+		do {
+			__set_bit(gpio_chip_hwgpio(desc_array[i]), mask);
+			i++;
+		} while ((i < array_size) && (desc_array[i]->chip == chip));
+
+		ret = gpio_chip_get_multiple(chip, mask, bits);
+		if (ret)
+			return ret;
+
+		for (; first < i; first++) {
+			struct gpio_desc *desc = desc_array[first];
+			int value = test_bit(gpio_chip_hwgpio(desc), bits);
+
+			if (!raw && test_bit(FLAG_ACTIVE_LOW, &desc->flags))
+				value = !value;
+			trace_gpio_value(desc_to_gpio(desc), 1, value);
+			value_array[first] = value;
+		}
+	}
+	return 0;
+}
+
+/**
+ * gpiod_get_raw_array_value() - read values from an array of GPIOs
+ * @array_size: number of elements in the descriptor / value arrays
+ * @desc_array: array of GPIO descriptors whose values will be read
+ * @value_array: array to store the read values
+ *
+ * Read the raw values of the GPIOs, i.e. the values of the physical lines
+ * without regard for their ACTIVE_LOW status.  GPIOs of the same chip are
+ * read at once if the chip supports it.  Returns 0 or a negative errno.
+ *
+ * This function should be called from contexts where we cannot sleep, and will
+ * complain if the GPIO chip functions potentially sleep.
+ */
+int gpiod_get_raw_array_value(unsigned int array_size,
+			      struct gpio_desc **desc_array, int *value_array)
+{
+	if (!desc_array)
+		return -EINVAL;
+	return gpiod_get_array_priv(true, false, array_size, desc_array,
+				    value_array);
+}
+EXPORT_SYMBOL_GPL(gpiod_get_raw_array_value);
+
+/**
+ * gpiod_get_array_value() - read values from an array of GPIOs
+ * @array_size: number of elements in the descriptor / value arrays
+ * @desc_array: array of GPIO descriptors whose values will be read
+ * @value_array: array to store the read values
+ *
+ * Read the logical values of the GPIOs, i.e. taking their ACTIVE_LOW status
+ * into account.  Returns 0 or a negative errno.
+ *
+ * This function should be called from contexts where we cannot sleep, and will
+ * complain if the GPIO chip functions potentially sleep.
+ */
+int gpiod_get_array_value(unsigned int array_size,
+			  struct gpio_desc **desc_array, int *value_array)
+{
+	if (!desc_array)
+		return -EINVAL;
+	return gpiod_get_array_priv(false, false, array_size, desc_array,
+				    value_array);
+}
+EXPORT_SYMBOL_GPL(gpiod_get_array_value);
+
 /*
  *  _gpio_set_open_drain_value() - Set the open drain gpio's value.
  * @desc: gpio descriptor whose state need to be set.
@@ -22,6 +22,7 @@
 #include <linux/mutex.h>
 #include <linux/export.h>
 #include <linux/dma-buf.h>
+#include <linux/dma-contiguous.h>
 #include <linux/dma-mapping.h>
 
 #include <drm/drmP.h>
@@ -124,6 +125,132 @@ error:
 }
 EXPORT_SYMBOL_GPL(drm_gem_cma_create);
 
+#ifdef CONFIG_DMA_CMA
+static int drm_gem_cma_alloc_cached(struct drm_gem_cma_object *cma_obj)
+{
+	struct device *dev = cma_obj->base.dev->dev;
+	size_t size = cma_obj->base.size;
+	int count = size >> PAGE_SHIFT;
+	struct page *pages;
+	dma_addr_t paddr;
+
+	pages = dma_alloc_from_contiguous(dev, count, get_order(size));
+	if (!pages)
+		return -ENOMEM;
+
+	/* the buffer must be reachable through the linear mapping */
+	if (PageHighMem(pages))
+		goto error;
+
+	/* don't leak stale data to userspace; the map flushes it out */
+	memset(page_address(pages), 0, size);
+
+	paddr = dma_map_page(dev, pages, 0, size, DMA_BIDIRECTIONAL);
+	if (dma_mapping_error(dev, paddr))
+		goto error;
+
+	cma_obj->pages = pages;
+	cma_obj->vaddr = page_address(pages);
+	cma_obj->paddr = paddr;
+	cma_obj->cached = true;
+
+	return 0;
+
+error:
+	dma_release_from_contiguous(dev, pages, count);
+	return -ENOMEM;
+}
+#else
+static int drm_gem_cma_alloc_cached(struct drm_gem_cma_object *cma_obj)
+{
+	return -ENODEV;
+}
+#endif
+
+/**
+ * drm_gem_cma_create_cached - allocate a cacheable object with the given size
+ * @drm: DRM device
+ * @size: size of the object to allocate
+ *
+ * This function creates a CMA GEM object backed by contiguous memory that is
+ * mapped cacheable, both in the kernel and when mmap()ed to userspace. This
+ * makes CPU reads from the buffer fast, at the cost of explicit cache
+ * maintenance: CPU access must be bracketed by drm_gem_cma_cpu_prep() and
+ * drm_gem_cma_cpu_fini() before the buffer is handed to a device.
+ *
+ * If no CMA area can provide the cacheable memory the object falls back to a
+ * writecombined allocation; ->cached tells which one was used.
+ *
+ * Returns:
+ * A struct drm_gem_cma_object * on success or an ERR_PTR()-encoded negative
+ * error code on failure.
+ */
+struct drm_gem_cma_object *drm_gem_cma_create_cached(struct drm_device *drm,
+						     size_t size)
+{
+	struct drm_gem_cma_object *cma_obj;
+
+	size = round_up(size, PAGE_SIZE);
+
+	cma_obj = __drm_gem_cma_create(drm, size);
+	if (IS_ERR(cma_obj))
+		return cma_obj;
+
+	if (!drm_gem_cma_alloc_cached(cma_obj))
+		return cma_obj;
+
+	cma_obj->vaddr = dma_alloc_writecombine(drm->dev, size,
+			&cma_obj->paddr, GFP_KERNEL | __GFP_NOWARN);
+	if (!cma_obj->vaddr) {
+		dev_err(drm->dev, "failed to allocate buffer with size %zu\n",
+			size);
+		drm_gem_cma_free_object(&cma_obj->base);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	return cma_obj;
+}
+EXPORT_SYMBOL_GPL(drm_gem_cma_create_cached);
+
+/**
+ * drm_gem_cma_cpu_prep - prepare a CMA GEM object for CPU access
+ * @cma_obj: CMA GEM object
+ * @dir: DMA_FROM_DEVICE to read, DMA_TO_DEVICE to write, or both
+ *
+ * Invalidates the CPU caches for the buffer so that the CPU sees data
+ * written by devices. This is a no-op for writecombined objects.
+ */
+void drm_gem_cma_cpu_prep(struct drm_gem_cma_object *cma_obj,
+			  enum dma_data_direction dir)
+{
+	if (!cma_obj->cached)
+		return;
+
+	dma_sync_single_for_cpu(cma_obj->base.dev->dev, cma_obj->paddr,
+				cma_obj->base.size, dir);
+}
+EXPORT_SYMBOL_GPL(drm_gem_cma_cpu_prep);
+
+/**
+ * drm_gem_cma_cpu_fini - finish CPU access to a CMA GEM object
+ * @cma_obj: CMA GEM object
+ * @dir: direction passed to the matching drm_gem_cma_cpu_prep()
+ *
+ * Writes back the CPU caches for the buffer so that devices, e.g. the
+ * display controller at the next flip, see what the CPU wrote. This is a
+ * no-op for writecombined objects.
+ */
+void drm_gem_cma_cpu_fini(struct drm_gem_cma_object *cma_obj,
+			  enum dma_data_direction dir)
+{
+	if (!cma_obj->cached)
+		return;
+
+	dma_sync_single_for_device(cma_obj->base.dev->dev, cma_obj->paddr,
+				   cma_obj->base.size, dir);
+}
+EXPORT_SYMBOL_GPL(drm_gem_cma_cpu_fini);
+
 /**
  * drm_gem_cma_create_with_handle - allocate an object with the given size and
  *     return a GEM handle to it
@@ -189,7 +316,12 @@ void drm_gem_cma_free_object(struct drm_gem_object *gem_obj)
 
 	cma_obj = to_drm_gem_cma_obj(gem_obj);
 
-	if (cma_obj->vaddr) {
+	if (cma_obj->cached) {
+		dma_unmap_page(gem_obj->dev->dev, cma_obj->paddr,
+			       cma_obj->base.size, DMA_BIDIRECTIONAL);
+		dma_release_from_contiguous(gem_obj->dev->dev, cma_obj->pages,
+					    cma_obj->base.size >> PAGE_SHIFT);
+	} else if (cma_obj->vaddr) {
 		dma_free_writecombine(gem_obj->dev->dev, cma_obj->base.size,
 				      cma_obj->vaddr, cma_obj->paddr);
 	} else if (gem_obj->import_attach) {
@@ -327,6 +459,18 @@ static int drm_gem_cma_mmap_obj(struct drm_gem_cma_object *cma_obj,
 	vma->vm_flags &= ~VM_PFNMAP;
 	vma->vm_pgoff = 0;
 
+	if (cma_obj->cached) {
+		vma->vm_page_prot = vm_get_page_prot(vma->vm_flags);
+		ret = remap_pfn_range(vma, vma->vm_start,
+				      page_to_pfn(cma_obj->pages),
+				      vma->vm_end - vma->vm_start,
+				      vma->vm_page_prot);
+		if (ret)
+			drm_gem_vm_close(vma);
+
+		return ret;
+	}
+
 	ret = dma_mmap_writecombine(cma_obj->base.dev->dev, vma,
 				    cma_obj->vaddr, cma_obj->paddr,
 				    vma->vm_end - vma->vm_start);
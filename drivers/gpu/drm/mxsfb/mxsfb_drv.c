@@ -0,0 +1,597 @@
+/*
+ * Copyright 2015 Freescale Semiconductor, Inc. All Rights Reserved.
+ *
+ * i.MX23/i.MX28/i.MX6SX eLCDIF DRM driver
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/clk.h>
+#include <linux/fence.h>
+#include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/module.h>
+#include <linux/of_device.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+
+#include <drm/drmP.h>
+#include <drm/drm_atomic.h>
+#include <drm/drm_atomic_helper.h>
+#include <drm/drm_crtc_helper.h>
+#include <drm/drm_fb_cma_helper.h>
+#include <drm/drm_gem_cma_helper.h>
+#include <drm/mxsfb_drm.h>
+
+#include "mxsfb_drv.h"
+#include "mxsfb_regs.h"
+
+enum mxsfb_devtype {
+	MXSFB_V3,
+	MXSFB_V4,
+	MXSFB_V4_AS,
+};
+
+static const struct mxsfb_devdata mxsfb_devdata[] = {
+	[MXSFB_V3] = {
+		.transfer_count	= LCDC_V3_TRANSFER_COUNT,
+		.cur_buf	= LCDC_V3_CUR_BUF,
+		.next_buf	= LCDC_V3_NEXT_BUF,
+		.debug0		= LCDC_V3_DEBUG0,
+		.hs_wdth_mask	= 0xff,
+		.hs_wdth_shift	= 24,
+		.ipversion	= 3,
+	},
+	[MXSFB_V4] = {
+		.transfer_count	= LCDC_V4_TRANSFER_COUNT,
+		.cur_buf	= LCDC_V4_CUR_BUF,
+		.next_buf	= LCDC_V4_NEXT_BUF,
+		.debug0		= LCDC_V4_DEBUG0,
+		.hs_wdth_mask	= 0x3fff,
+		.hs_wdth_shift	= 18,
+		.ipversion	= 4,
+	},
+	[MXSFB_V4_AS] = {
+		.transfer_count	= LCDC_V4_TRANSFER_COUNT,
+		.cur_buf	= LCDC_V4_CUR_BUF,
+		.next_buf	= LCDC_V4_NEXT_BUF,
+		.debug0		= LCDC_V4_DEBUG0,
+		.hs_wdth_mask	= 0x3fff,
+		.hs_wdth_shift	= 18,
+		.ipversion	= 4,
+		.has_overlay	= true,
+	},
+};
+
+/* -----------------------------------------------------------------------------
+ * Atomic commit
+ */
+
+struct mxsfb_commit {
+	struct work_struct work;
+	struct drm_device *drm;
+	struct drm_atomic_state *state;
+};
+
+static void mxsfb_atomic_complete(struct mxsfb_commit *commit)
+{
+	struct drm_device *drm = commit->drm;
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+	struct drm_atomic_state *old_state = commit->state;
+	struct drm_plane_state *plane_state;
+	struct drm_plane *plane;
+	int i;
+
+	/* Wait for rendering into the new framebuffers to finish. */
+	for_each_plane_in_state(old_state, plane, plane_state, i) {
+		if (!plane->state->fence)
+			continue;
+
+		fence_wait(plane->state->fence, false);
+		fence_put(plane->state->fence);
+		plane->state->fence = NULL;
+	}
+
+	/* Apply the atomic update. */
+	drm_atomic_helper_commit_modeset_disables(drm, old_state);
+	drm_atomic_helper_commit_planes(drm, old_state);
+	drm_atomic_helper_commit_modeset_enables(drm, old_state);
+
+	drm_atomic_helper_wait_for_vblanks(drm, old_state);
+
+	drm_atomic_helper_cleanup_planes(drm, old_state);
+
+	drm_atomic_state_free(old_state);
+
+	/* Complete the commit, wake up any waiter. */
+	spin_lock(&mxsfb->commit_wait.lock);
+	mxsfb->commit_pending = false;
+	wake_up_all_locked(&mxsfb->commit_wait);
+	spin_unlock(&mxsfb->commit_wait.lock);
+
+	kfree(commit);
+}
+
+static void mxsfb_atomic_work(struct work_struct *work)
+{
+	struct mxsfb_commit *commit =
+		container_of(work, struct mxsfb_commit, work);
+
+	mxsfb_atomic_complete(commit);
+}
+
+/*
+ * The atomic helper commit cannot run asynchronously yet. Do the same
+ * steps from a worker so page flips return to userspace right away and
+ * the event is sent from the frame done interrupt.
+ */
+static int mxsfb_atomic_commit(struct drm_device *drm,
+			       struct drm_atomic_state *state, bool async)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+	struct mxsfb_commit *commit;
+	int ret;
+
+	ret = drm_atomic_helper_prepare_planes(drm, state);
+	if (ret)
+		return ret;
+
+	commit = kzalloc(sizeof(*commit), GFP_KERNEL);
+	if (commit == NULL) {
+		ret = -ENOMEM;
+		goto err_cleanup;
+	}
+
+	INIT_WORK(&commit->work, mxsfb_atomic_work);
+	commit->drm = drm;
+	commit->state = state;
+
+	/*
+	 * There is a single CRTC: a nonblocking update that would have to
+	 * wait for the previous one is refused like a legacy page flip.
+	 */
+	spin_lock(&mxsfb->commit_wait.lock);
+	if (async && mxsfb->commit_pending)
+		ret = -EBUSY;
+	else
+		ret = wait_event_interruptible_locked(mxsfb->commit_wait,
+						      !mxsfb->commit_pending);
+	if (ret == 0)
+		mxsfb->commit_pending = true;
+	spin_unlock(&mxsfb->commit_wait.lock);
+
+	if (ret) {
+		kfree(commit);
+		goto err_cleanup;
+	}
+
+	/* Swap the state, this is the point of no return. */
+	drm_atomic_helper_swap_state(drm, state);
+
+	if (async)
+		queue_work(mxsfb->commit_wq, &commit->work);
+	else
+		mxsfb_atomic_complete(commit);
+
+	return 0;
+
+err_cleanup:
+	drm_atomic_helper_cleanup_planes(drm, state);
+	return ret;
+}
+
+static void mxsfb_fb_output_poll_changed(struct drm_device *drm)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+
+	if (mxsfb->fbdev)
+		drm_fbdev_cma_hotplug_event(mxsfb->fbdev);
+}
+
+static const struct drm_mode_config_funcs mxsfb_mode_config_funcs = {
+	.fb_create = drm_fb_cma_create,
+	.output_poll_changed = mxsfb_fb_output_poll_changed,
+	.atomic_check = drm_atomic_helper_check,
+	.atomic_commit = mxsfb_atomic_commit,
+};
+
+/* -----------------------------------------------------------------------------
+ * DRM driver
+ */
+
+static int mxsfb_load(struct drm_device *drm, unsigned long flags)
+{
+	struct platform_device *pdev = to_platform_device(drm->dev);
+	const struct of_device_id *of_id;
+	struct mxsfb_drm_private *mxsfb;
+	struct resource *res;
+	int ret;
+
+	mxsfb = devm_kzalloc(&pdev->dev, sizeof(*mxsfb), GFP_KERNEL);
+	if (!mxsfb)
+		return -ENOMEM;
+
+	of_id = of_match_device(drm->dev->driver->of_match_table, drm->dev);
+	mxsfb->devdata = &mxsfb_devdata[(uintptr_t)of_id->data];
+	init_waitqueue_head(&mxsfb->commit_wait);
+	drm->dev_private = mxsfb;
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	mxsfb->base = devm_ioremap_resource(drm->dev, res);
+	if (IS_ERR(mxsfb->base))
+		return PTR_ERR(mxsfb->base);
+
+	mxsfb->clk = devm_clk_get(drm->dev, "pix");
+	if (IS_ERR(mxsfb->clk))
+		return PTR_ERR(mxsfb->clk);
+
+	mxsfb->clk_axi = devm_clk_get(drm->dev, "axi");
+	if (IS_ERR(mxsfb->clk_axi))
+		mxsfb->clk_axi = NULL;
+
+	mxsfb->clk_disp_axi = devm_clk_get(drm->dev, "disp_axi");
+	if (IS_ERR(mxsfb->clk_disp_axi))
+		mxsfb->clk_disp_axi = NULL;
+
+	mxsfb->commit_wq = alloc_ordered_workqueue("mxsfb-drm", 0);
+	if (!mxsfb->commit_wq)
+		return -ENOMEM;
+
+	/* the register interface needs the bus clocks at all times */
+	clk_prepare_enable(mxsfb->clk_axi);
+	clk_prepare_enable(mxsfb->clk_disp_axi);
+
+	drm_mode_config_init(drm);
+
+	ret = mxsfb_create_output(drm);
+	if (ret) {
+		if (ret != -EPROBE_DEFER)
+			dev_err(drm->dev, "failed to create output: %d\n", ret);
+		goto err_config_cleanup;
+	}
+
+	ret = mxsfb_create_crtc(drm);
+	if (ret) {
+		dev_err(drm->dev, "failed to create crtc: %d\n", ret);
+		goto err_config_cleanup;
+	}
+
+	drm->mode_config.min_width = MXSFB_MIN_XRES;
+	drm->mode_config.min_height = MXSFB_MIN_YRES;
+	drm->mode_config.max_width = MXSFB_MAX_XRES;
+	drm->mode_config.max_height = MXSFB_MAX_YRES;
+	drm->mode_config.funcs = &mxsfb_mode_config_funcs;
+
+	drm_mode_config_reset(drm);
+
+	ret = drm_vblank_init(drm, drm->mode_config.num_crtc);
+	if (ret < 0) {
+		dev_err(drm->dev, "failed to initialize vblank\n");
+		goto err_config_cleanup;
+	}
+
+	ret = drm_irq_install(drm, platform_get_irq(pdev, 0));
+	if (ret < 0) {
+		dev_err(drm->dev, "failed to install IRQ handler\n");
+		goto err_vblank_cleanup;
+	}
+
+	platform_set_drvdata(pdev, drm);
+
+	drm_kms_helper_poll_init(drm);
+
+	mxsfb->fbdev = drm_fbdev_cma_init(drm, 32,
+					  drm->mode_config.num_crtc,
+					  drm->mode_config.num_connector);
+	if (IS_ERR(mxsfb->fbdev)) {
+		dev_warn(drm->dev, "fbdev emulation not available\n");
+		mxsfb->fbdev = NULL;
+	}
+
+	return 0;
+
+err_vblank_cleanup:
+	drm_vblank_cleanup(drm);
+err_config_cleanup:
+	drm_mode_config_cleanup(drm);
+	if (mxsfb->mode)
+		drm_mode_destroy(drm, mxsfb->mode);
+	clk_disable_unprepare(mxsfb->clk_disp_axi);
+	clk_disable_unprepare(mxsfb->clk_axi);
+	destroy_workqueue(mxsfb->commit_wq);
+	drm->dev_private = NULL;
+
+	return ret;
+}
+
+static int mxsfb_unload(struct drm_device *drm)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+
+	if (mxsfb->fbdev)
+		drm_fbdev_cma_fini(mxsfb->fbdev);
+
+	flush_workqueue(mxsfb->commit_wq);
+	drm_kms_helper_poll_fini(drm);
+	drm_mode_config_cleanup(drm);
+	drm_vblank_cleanup(drm);
+	drm_irq_uninstall(drm);
+
+	if (mxsfb->mode)
+		drm_mode_destroy(drm, mxsfb->mode);
+
+	clk_disable_unprepare(mxsfb->clk_disp_axi);
+	clk_disable_unprepare(mxsfb->clk_axi);
+	destroy_workqueue(mxsfb->commit_wq);
+
+	drm->dev_private = NULL;
+
+	return 0;
+}
+
+static void mxsfb_preclose(struct drm_device *drm, struct drm_file *file)
+{
+	mxsfb_crtc_cancel_page_flip(drm->dev_private, file);
+}
+
+static void mxsfb_lastclose(struct drm_device *drm)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+
+	drm_fbdev_cma_restore_mode(mxsfb->fbdev);
+}
+
+static int mxsfb_ioctl_gem_new(struct drm_device *drm, void *data,
+			       struct drm_file *file)
+{
+	struct drm_mxsfb_gem_new *args = data;
+	struct drm_gem_cma_object *cma_obj;
+	int ret;
+
+	if (args->flags & ~MXSFB_BO_FLAGS) {
+		DRM_ERROR("invalid flags: %08x\n", args->flags);
+		return -EINVAL;
+	}
+
+	if (!args->size)
+		return -EINVAL;
+
+	if (args->flags & MXSFB_BO_CACHED)
+		cma_obj = drm_gem_cma_create_cached(drm, args->size);
+	else
+		cma_obj = drm_gem_cma_create(drm, args->size);
+	if (IS_ERR(cma_obj))
+		return PTR_ERR(cma_obj);
+
+	ret = drm_gem_handle_create(file, &cma_obj->base, &args->handle);
+
+	/* drop reference from allocate - handle holds it now */
+	drm_gem_object_unreference_unlocked(&cma_obj->base);
+
+	return ret;
+}
+
+static int mxsfb_ioctl_gem_info(struct drm_device *drm, void *data,
+				struct drm_file *file)
+{
+	struct drm_mxsfb_gem_info *args = data;
+	struct drm_gem_object *obj;
+
+	obj = drm_gem_object_lookup(drm, file, args->handle);
+	if (!obj)
+		return -ENOENT;
+
+	args->flags = to_drm_gem_cma_obj(obj)->cached ? MXSFB_BO_CACHED : 0;
+
+	drm_gem_object_unreference_unlocked(obj);
+
+	return 0;
+}
+
+static enum dma_data_direction mxsfb_prep_dir(u32 op)
+{
+	switch (op) {
+	case MXSFB_PREP_READ:
+		return DMA_FROM_DEVICE;
+	case MXSFB_PREP_WRITE:
+		return DMA_TO_DEVICE;
+	default:
+		return DMA_BIDIRECTIONAL;
+	}
+}
+
+static int mxsfb_ioctl_gem_cpu_prep(struct drm_device *drm, void *data,
+				    struct drm_file *file)
+{
+	struct drm_mxsfb_gem_cpu_prep *args = data;
+	struct drm_gem_object *obj;
+
+	if (!args->op || (args->op & ~MXSFB_PREP_FLAGS)) {
+		DRM_ERROR("invalid op: %08x\n", args->op);
+		return -EINVAL;
+	}
+
+	obj = drm_gem_object_lookup(drm, file, args->handle);
+	if (!obj)
+		return -ENOENT;
+
+	drm_gem_cma_cpu_prep(to_drm_gem_cma_obj(obj), mxsfb_prep_dir(args->op));
+
+	drm_gem_object_unreference_unlocked(obj);
+
+	return 0;
+}
+
+static int mxsfb_ioctl_gem_cpu_fini(struct drm_device *drm, void *data,
+				    struct drm_file *file)
+{
+	struct drm_mxsfb_gem_cpu_fini *args = data;
+	struct drm_gem_object *obj;
+
+	if (!args->op || (args->op & ~MXSFB_PREP_FLAGS)) {
+		DRM_ERROR("invalid op: %08x\n", args->op);
+		return -EINVAL;
+	}
+
+	obj = drm_gem_object_lookup(drm, file, args->handle);
+	if (!obj)
+		return -ENOENT;
+
+	drm_gem_cma_cpu_fini(to_drm_gem_cma_obj(obj), mxsfb_prep_dir(args->op));
+
+	drm_gem_object_unreference_unlocked(obj);
+
+	return 0;
+}
+
+static const struct drm_ioctl_desc mxsfb_ioctls[DRM_MXSFB_NUM_IOCTLS] = {
+	DRM_IOCTL_DEF_DRV(MXSFB_GEM_NEW, mxsfb_ioctl_gem_new,
+			  DRM_UNLOCKED | DRM_AUTH | DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(MXSFB_GEM_INFO, mxsfb_ioctl_gem_info,
+			  DRM_UNLOCKED | DRM_AUTH | DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(MXSFB_GEM_CPU_PREP, mxsfb_ioctl_gem_cpu_prep,
+			  DRM_UNLOCKED | DRM_AUTH | DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(MXSFB_GEM_CPU_FINI, mxsfb_ioctl_gem_cpu_fini,
+			  DRM_UNLOCKED | DRM_AUTH | DRM_RENDER_ALLOW),
+};
+
+static irqreturn_t mxsfb_irq_handler(int irq, void *data)
+{
+	struct drm_device *drm = data;
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+	u32 reg;
+
+	reg = readl(mxsfb->base + LCDC_CTRL1);
+	if (!(reg & CTRL1_CUR_FRAME_DONE_IRQ))
+		return IRQ_NONE;
+
+	writel(CTRL1_CUR_FRAME_DONE_IRQ, mxsfb->base + LCDC_CTRL1 + REG_CLR);
+
+	mxsfb_crtc_handle_vblank(mxsfb);
+
+	return IRQ_HANDLED;
+}
+
+static void mxsfb_irq_preinstall(struct drm_device *drm)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+
+	writel(CTRL1_IRQ_ENABLE_MASK, mxsfb->base + LCDC_CTRL1 + REG_CLR);
+	writel(CTRL1_IRQ_STATUS_MASK, mxsfb->base + LCDC_CTRL1 + REG_CLR);
+}
+
+static int mxsfb_enable_vblank(struct drm_device *drm, int crtc)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+
+	/* Clear and enable VBLANK IRQ */
+	writel(CTRL1_CUR_FRAME_DONE_IRQ, mxsfb->base + LCDC_CTRL1 + REG_CLR);
+	writel(CTRL1_CUR_FRAME_DONE_IRQ_EN, mxsfb->base + LCDC_CTRL1 + REG_SET);
+
+	return 0;
+}
+
+static void mxsfb_disable_vblank(struct drm_device *drm, int crtc)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+
+	writel(CTRL1_CUR_FRAME_DONE_IRQ_EN, mxsfb->base + LCDC_CTRL1 + REG_CLR);
+}
+
+static const struct file_operations fops = {
+	.owner              = THIS_MODULE,
+	.open               = drm_open,
+	.release            = drm_release,
+	.unlocked_ioctl     = drm_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl       = drm_compat_ioctl,
+#endif
+	.poll               = drm_poll,
+	.read               = drm_read,
+	.llseek             = no_llseek,
+	.mmap               = drm_gem_cma_mmap,
+};
+
+static struct drm_driver mxsfb_driver = {
+	.driver_features	= DRIVER_GEM | DRIVER_MODESET | DRIVER_PRIME |
+				  DRIVER_ATOMIC | DRIVER_HAVE_IRQ,
+	.load			= mxsfb_load,
+	.unload			= mxsfb_unload,
+	.preclose		= mxsfb_preclose,
+	.lastclose		= mxsfb_lastclose,
+	.irq_handler		= mxsfb_irq_handler,
+	.irq_preinstall		= mxsfb_irq_preinstall,
+	.irq_uninstall		= mxsfb_irq_preinstall,
+	.get_vblank_counter	= drm_vblank_count,
+	.enable_vblank		= mxsfb_enable_vblank,
+	.disable_vblank		= mxsfb_disable_vblank,
+	.gem_free_object	= drm_gem_cma_free_object,
+	.gem_vm_ops		= &drm_gem_cma_vm_ops,
+	.prime_handle_to_fd	= drm_gem_prime_handle_to_fd,
+	.prime_fd_to_handle	= drm_gem_prime_fd_to_handle,
+	.gem_prime_import	= drm_gem_prime_import,
+	.gem_prime_export	= drm_gem_prime_export,
+	.gem_prime_get_sg_table	= drm_gem_cma_prime_get_sg_table,
+	.gem_prime_import_sg_table = drm_gem_cma_prime_import_sg_table,
+	.gem_prime_vmap		= drm_gem_cma_prime_vmap,
+	.gem_prime_vunmap	= drm_gem_cma_prime_vunmap,
+	.gem_prime_mmap		= drm_gem_cma_prime_mmap,
+	.dumb_create		= drm_gem_cma_dumb_create,
+	.dumb_map_offset	= drm_gem_cma_dumb_map_offset,
+	.dumb_destroy		= drm_gem_dumb_destroy,
+	.ioctls			= mxsfb_ioctls,
+	.num_ioctls		= DRM_MXSFB_NUM_IOCTLS,
+	.fops			= &fops,
+	.name			= "mxsfb-drm",
+	.desc			= "MXSFB Controller DRM",
+	.date			= "20150903",
+	.major			= 1,
+	.minor			= 0,
+};
+
+static const struct of_device_id mxsfb_dt_ids[] = {
+	{ .compatible = "fsl,imx23-lcdif", .data = (void *)MXSFB_V3, },
+	{ .compatible = "fsl,imx28-lcdif", .data = (void *)MXSFB_V4, },
+	{ .compatible = "fsl,imx6sx-lcdif", .data = (void *)MXSFB_V4_AS, },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, mxsfb_dt_ids);
+
+static int mxsfb_probe(struct platform_device *pdev)
+{
+	if (!pdev->dev.of_node)
+		return -ENODEV;
+
+	/* nothing else waits for the display to come back */
+	device_enable_async_suspend(&pdev->dev);
+
+	return drm_platform_init(&mxsfb_driver, pdev);
+}
+
+static int mxsfb_remove(struct platform_device *pdev)
+{
+	drm_put_dev(platform_get_drvdata(pdev));
+
+	return 0;
+}
+
+static struct platform_driver mxsfb_platform_driver = {
+	.probe		= mxsfb_probe,
+	.remove		= mxsfb_remove,
+	.driver	= {
+		.name		= "mxsfb-drm",
+		.of_match_table	= mxsfb_dt_ids,
+	},
+};
+
+module_platform_driver(mxsfb_platform_driver);
+
+MODULE_DESCRIPTION("Freescale MXS DRM/KMS driver");
+MODULE_LICENSE("GPL");
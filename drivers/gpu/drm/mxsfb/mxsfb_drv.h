@@ -0,0 +1,87 @@
+/*
+ * Copyright 2015 Freescale Semiconductor, Inc. All Rights Reserved.
+ *
+ * i.MX23/i.MX28/i.MX6SX eLCDIF DRM driver
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __MXSFB_DRV_H__
+#define __MXSFB_DRV_H__
+
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#include <drm/drmP.h>
+#include <drm/drm_crtc.h>
+#include <drm/drm_fb_cma_helper.h>
+
+/* CPU dependent register offsets and features */
+struct mxsfb_devdata {
+	unsigned int	transfer_count;
+	unsigned int	cur_buf;
+	unsigned int	next_buf;
+	unsigned int	debug0;
+	unsigned int	hs_wdth_mask;
+	unsigned int	hs_wdth_shift;
+	unsigned int	ipversion;
+	bool		has_overlay;
+};
+
+struct mxsfb_drm_private {
+	const struct mxsfb_devdata	*devdata;
+
+	void __iomem			*base;	/* registers */
+	struct clk			*clk;
+	struct clk			*clk_axi;
+	struct clk			*clk_disp_axi;
+
+	struct drm_crtc			crtc;
+	struct drm_plane		primary;
+	struct drm_plane		overlay;
+	struct drm_encoder		encoder;
+	struct drm_connector		connector;
+	struct drm_panel		*panel;
+	struct drm_fbdev_cma		*fbdev;
+
+	/* legacy "display" node timings, used when there is no panel */
+	struct drm_display_mode		*mode;
+	u32				bus_width;	/* STMLCDIF_* */
+	u32				vm_flags;	/* DISPLAY_FLAGS_* */
+	u32				dotclk_delay;
+
+	/* pending vblank event, protected by drm->event_lock */
+	struct drm_pending_vblank_event	*event;
+
+	/* nonblocking commit tracking */
+	struct workqueue_struct		*commit_wq;
+	wait_queue_head_t		commit_wait;
+	bool				commit_pending;
+};
+
+static inline struct mxsfb_drm_private *
+crtc_to_mxsfb(struct drm_crtc *crtc)
+{
+	return container_of(crtc, struct mxsfb_drm_private, crtc);
+}
+
+static inline bool mxsfb_is_v4(struct mxsfb_drm_private *mxsfb)
+{
+	return mxsfb->devdata->ipversion >= 4;
+}
+
+int mxsfb_create_crtc(struct drm_device *drm);
+void mxsfb_crtc_handle_vblank(struct mxsfb_drm_private *mxsfb);
+void mxsfb_crtc_cancel_page_flip(struct mxsfb_drm_private *mxsfb,
+				 struct drm_file *file);
+
+int mxsfb_create_output(struct drm_device *drm);
+
+#endif /* __MXSFB_DRV_H__ */
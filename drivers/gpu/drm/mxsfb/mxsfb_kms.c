@@ -0,0 +1,509 @@
+/*
+ * Copyright 2015 Freescale Semiconductor, Inc. All Rights Reserved.
+ *
+ * This code is based on drivers/video/fbdev/mxsfb.c:
+ * Copyright (C) 2010 Juergen Beisert, Pengutronix
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/clk.h>
+#include <linux/io.h>
+#include <video/display_timing.h>
+
+#include <drm/drmP.h>
+#include <drm/drm_atomic.h>
+#include <drm/drm_atomic_helper.h>
+#include <drm/drm_crtc_helper.h>
+#include <drm/drm_fb_cma_helper.h>
+#include <drm/drm_gem_cma_helper.h>
+#include <drm/drm_plane_helper.h>
+
+#include "mxsfb_drv.h"
+#include "mxsfb_regs.h"
+
+static const uint32_t mxsfb_primary_formats[] = {
+	DRM_FORMAT_XRGB8888,
+	DRM_FORMAT_RGB565,
+};
+
+static const uint32_t mxsfb_overlay_formats[] = {
+	DRM_FORMAT_ARGB8888,
+	DRM_FORMAT_XRGB8888,
+	DRM_FORMAT_RGB565,
+	DRM_FORMAT_ARGB1555,
+	DRM_FORMAT_XRGB1555,
+	DRM_FORMAT_ARGB4444,
+	DRM_FORMAT_XRGB4444,
+};
+
+static bool mxsfb_needs_modeset(struct drm_crtc_state *state)
+{
+	return state->mode_changed || state->active_changed;
+}
+
+/* mask and shift depends on architecture */
+static inline u32 set_hsync_pulse_width(struct mxsfb_drm_private *mxsfb,
+					u32 val)
+{
+	return (val & mxsfb->devdata->hs_wdth_mask) <<
+		mxsfb->devdata->hs_wdth_shift;
+}
+
+static dma_addr_t mxsfb_plane_paddr(struct drm_plane_state *state)
+{
+	struct drm_framebuffer *fb = state->fb;
+	struct drm_gem_cma_object *gem = drm_fb_cma_get_gem_obj(fb, 0);
+
+	/*
+	 * The controller has no stride register, atomic_check makes sure
+	 * the fb pitch matches the mode so only a vertical offset is left.
+	 */
+	return gem->paddr + fb->offsets[0] +
+		(state->src_y >> 16) * fb->pitches[0];
+}
+
+static void mxsfb_set_pixel_fmt(struct mxsfb_drm_private *mxsfb,
+				struct drm_framebuffer *fb, u32 *ctrl)
+{
+	switch (fb->pixel_format) {
+	case DRM_FORMAT_RGB565:
+		*ctrl |= CTRL_SET_WORD_LENGTH(0);
+		writel(CTRL1_SET_BYTE_PACKAGING(0xf),
+		       mxsfb->base + LCDC_CTRL1);
+		break;
+	case DRM_FORMAT_XRGB8888:
+	default:
+		*ctrl |= CTRL_SET_WORD_LENGTH(3);
+		/* 24 bit to 18 bit mapping on a 16 bit bus */
+		if (mxsfb->bus_width == STMLCDIF_16BIT)
+			*ctrl |= CTRL_DF24;
+		/* do not use packed pixels = one pixel per word instead */
+		writel(CTRL1_SET_BYTE_PACKAGING(0x7),
+		       mxsfb->base + LCDC_CTRL1);
+		break;
+	}
+}
+
+/* -----------------------------------------------------------------------------
+ * CRTC
+ */
+
+static void mxsfb_crtc_enable(struct drm_crtc *crtc)
+{
+	struct mxsfb_drm_private *mxsfb = crtc_to_mxsfb(crtc);
+	struct drm_display_mode *m = &crtc->state->adjusted_mode;
+	struct drm_plane_state *primary = crtc->primary->state;
+	u32 hsync_len = m->crtc_hsync_end - m->crtc_hsync_start;
+	u32 vsync_len = m->crtc_vsync_end - m->crtc_vsync_start;
+	u32 ctrl, vdctrl0, vdctrl4;
+	dma_addr_t paddr;
+	int ret;
+
+	ret = clk_set_rate(mxsfb->clk, m->crtc_clock * 1000);
+	if (ret)
+		dev_err(crtc->dev->dev, "lcd pixel rate set failed: %d\n", ret);
+	clk_prepare_enable(mxsfb->clk);
+
+	/* clear the FIFOs */
+	writel(CTRL1_FIFO_CLEAR, mxsfb->base + LCDC_CTRL1 + REG_SET);
+
+	ctrl = CTRL_BYPASS_COUNT | CTRL_SET_BUS_WIDTH(mxsfb->bus_width);
+	mxsfb_set_pixel_fmt(mxsfb, primary->fb, &ctrl);
+	writel(ctrl, mxsfb->base + LCDC_CTRL);
+
+	writel(TRANSFER_COUNT_SET_VCOUNT(m->crtc_vdisplay) |
+	       TRANSFER_COUNT_SET_HCOUNT(m->crtc_hdisplay),
+	       mxsfb->base + mxsfb->devdata->transfer_count);
+
+	vdctrl0 = VDCTRL0_ENABLE_PRESENT |	/* always in DOTCLOCK mode */
+		  VDCTRL0_VSYNC_PERIOD_UNIT |
+		  VDCTRL0_VSYNC_PULSE_WIDTH_UNIT |
+		  VDCTRL0_SET_VSYNC_PULSE_WIDTH(vsync_len);
+	if (m->flags & DRM_MODE_FLAG_PHSYNC)
+		vdctrl0 |= VDCTRL0_HSYNC_ACT_HIGH;
+	if (m->flags & DRM_MODE_FLAG_PVSYNC)
+		vdctrl0 |= VDCTRL0_VSYNC_ACT_HIGH;
+	if (mxsfb->vm_flags & DISPLAY_FLAGS_DE_HIGH)
+		vdctrl0 |= VDCTRL0_ENABLE_ACT_HIGH;
+	if (mxsfb->vm_flags & DISPLAY_FLAGS_PIXDATA_NEGEDGE)
+		vdctrl0 |= VDCTRL0_DOTCLK_ACT_FALLING;
+	writel(vdctrl0, mxsfb->base + LCDC_VDCTRL0);
+
+	/* frame length in lines */
+	writel(m->crtc_vtotal, mxsfb->base + LCDC_VDCTRL1);
+
+	/* line length in units of clocks or pixels */
+	writel(set_hsync_pulse_width(mxsfb, hsync_len) |
+	       VDCTRL2_SET_HSYNC_PERIOD(m->crtc_htotal),
+	       mxsfb->base + LCDC_VDCTRL2);
+
+	writel(SET_HOR_WAIT_CNT(m->crtc_htotal - m->crtc_hsync_start) |
+	       SET_VERT_WAIT_CNT(m->crtc_vtotal - m->crtc_vsync_start),
+	       mxsfb->base + LCDC_VDCTRL3);
+
+	vdctrl4 = SET_DOTCLK_H_VALID_DATA_CNT(m->crtc_hdisplay);
+	if (mxsfb_is_v4(mxsfb))
+		vdctrl4 |= VDCTRL4_SET_DOTCLK_DLY(mxsfb->dotclk_delay);
+	writel(vdctrl4, mxsfb->base + LCDC_VDCTRL4);
+
+	paddr = mxsfb_plane_paddr(primary);
+	writel(paddr, mxsfb->base + mxsfb->devdata->cur_buf);
+	writel(paddr, mxsfb->base + mxsfb->devdata->next_buf);
+
+	if (mxsfb_is_v4(mxsfb))
+		writel(CTRL2_OUTSTANDING_REQS__REQ_16,
+		       mxsfb->base + LCDC_V4_CTRL2 + REG_SET);
+
+	writel(CTRL_DOTCLK_MODE, mxsfb->base + LCDC_CTRL + REG_SET);
+
+	/* enable the SYNC signals first, then the DMA engine */
+	writel(vdctrl4 | VDCTRL4_SYNC_SIGNALS_ON, mxsfb->base + LCDC_VDCTRL4);
+
+	writel(CTRL_MASTER, mxsfb->base + LCDC_CTRL + REG_SET);
+	writel(CTRL_RUN, mxsfb->base + LCDC_CTRL + REG_SET);
+
+	/* Recovery on underflow */
+	writel(CTRL1_RECOVERY_ON_UNDERFLOW, mxsfb->base + LCDC_CTRL1 + REG_SET);
+
+	drm_crtc_vblank_on(crtc);
+}
+
+static void mxsfb_crtc_disable(struct drm_crtc *crtc)
+{
+	struct mxsfb_drm_private *mxsfb = crtc_to_mxsfb(crtc);
+	unsigned int loop;
+	u32 reg;
+
+	drm_crtc_vblank_off(crtc);
+
+	/*
+	 * Even if we disable the controller here, it will still continue
+	 * until its FIFOs are running out of data
+	 */
+	writel(CTRL_DOTCLK_MODE, mxsfb->base + LCDC_CTRL + REG_CLR);
+
+	loop = 1000;
+	while (loop) {
+		reg = readl(mxsfb->base + LCDC_CTRL);
+		if (!(reg & CTRL_RUN))
+			break;
+		loop--;
+	}
+
+	writel(CTRL_MASTER, mxsfb->base + LCDC_CTRL + REG_CLR);
+
+	reg = readl(mxsfb->base + LCDC_VDCTRL4);
+	writel(reg & ~VDCTRL4_SYNC_SIGNALS_ON, mxsfb->base + LCDC_VDCTRL4);
+
+	clk_disable_unprepare(mxsfb->clk);
+}
+
+static bool mxsfb_crtc_mode_fixup(struct drm_crtc *crtc,
+				  const struct drm_display_mode *mode,
+				  struct drm_display_mode *adjusted_mode)
+{
+	return true;
+}
+
+static int mxsfb_crtc_atomic_check(struct drm_crtc *crtc,
+				   struct drm_crtc_state *state)
+{
+	struct drm_display_mode *m = &state->adjusted_mode;
+
+	if (!state->enable)
+		return 0;
+
+	if (m->hdisplay < MXSFB_MIN_XRES || m->vdisplay < MXSFB_MIN_YRES ||
+	    m->flags & DRM_MODE_FLAG_INTERLACE)
+		return -EINVAL;
+
+	/* the controller cannot scan out without a primary buffer */
+	if (!(state->plane_mask & (1 << drm_plane_index(crtc->primary))))
+		return -EINVAL;
+
+	return 0;
+}
+
+static void mxsfb_crtc_atomic_flush(struct drm_crtc *crtc)
+{
+	struct mxsfb_drm_private *mxsfb = crtc_to_mxsfb(crtc);
+	struct drm_pending_vblank_event *event = crtc->state->event;
+	struct drm_device *drm = crtc->dev;
+	unsigned long flags;
+
+	if (!event)
+		return;
+
+	crtc->state->event = NULL;
+	event->pipe = drm_crtc_index(crtc);
+
+	/*
+	 * The new buffers were written to the NEXT_BUF registers, they are
+	 * latched at the end of the current frame. Complete the event from
+	 * that interrupt, or right away if the CRTC is not scanning out.
+	 */
+	if (crtc->state->active && drm_crtc_vblank_get(crtc) == 0) {
+		spin_lock_irqsave(&drm->event_lock, flags);
+		WARN_ON(mxsfb->event);
+		mxsfb->event = event;
+		spin_unlock_irqrestore(&drm->event_lock, flags);
+	} else {
+		spin_lock_irqsave(&drm->event_lock, flags);
+		drm_crtc_send_vblank_event(crtc, event);
+		spin_unlock_irqrestore(&drm->event_lock, flags);
+	}
+}
+
+void mxsfb_crtc_handle_vblank(struct mxsfb_drm_private *mxsfb)
+{
+	struct drm_crtc *crtc = &mxsfb->crtc;
+	struct drm_device *drm = crtc->dev;
+	struct drm_pending_vblank_event *event;
+	unsigned long flags;
+
+	drm_crtc_handle_vblank(crtc);
+
+	spin_lock_irqsave(&drm->event_lock, flags);
+	event = mxsfb->event;
+	mxsfb->event = NULL;
+	if (event)
+		drm_crtc_send_vblank_event(crtc, event);
+	spin_unlock_irqrestore(&drm->event_lock, flags);
+
+	if (event)
+		drm_crtc_vblank_put(crtc);
+}
+
+void mxsfb_crtc_cancel_page_flip(struct mxsfb_drm_private *mxsfb,
+				 struct drm_file *file)
+{
+	struct drm_crtc *crtc = &mxsfb->crtc;
+	struct drm_device *drm = crtc->dev;
+	struct drm_pending_vblank_event *event;
+	unsigned long flags;
+
+	spin_lock_irqsave(&drm->event_lock, flags);
+	event = mxsfb->event;
+	if (event && event->base.file_priv == file) {
+		mxsfb->event = NULL;
+		event->base.destroy(&event->base);
+	} else {
+		event = NULL;
+	}
+	spin_unlock_irqrestore(&drm->event_lock, flags);
+
+	if (event)
+		drm_crtc_vblank_put(crtc);
+}
+
+static const struct drm_crtc_helper_funcs mxsfb_crtc_helper_funcs = {
+	.mode_fixup = mxsfb_crtc_mode_fixup,
+	.disable = mxsfb_crtc_disable,
+	.enable = mxsfb_crtc_enable,
+	.atomic_check = mxsfb_crtc_atomic_check,
+	.atomic_flush = mxsfb_crtc_atomic_flush,
+};
+
+static const struct drm_crtc_funcs mxsfb_crtc_funcs = {
+	.page_flip = drm_atomic_helper_page_flip,
+	.set_config = drm_atomic_helper_set_config,
+	.destroy = drm_crtc_cleanup,
+	.reset = drm_atomic_helper_crtc_reset,
+	.atomic_duplicate_state = drm_atomic_helper_crtc_duplicate_state,
+	.atomic_destroy_state = drm_atomic_helper_crtc_destroy_state,
+};
+
+/* -----------------------------------------------------------------------------
+ * Planes
+ */
+
+static int mxsfb_plane_atomic_check(struct drm_plane *plane,
+				    struct drm_plane_state *state)
+{
+	struct drm_framebuffer *fb = state->fb;
+	struct drm_crtc_state *crtc_state;
+	struct drm_display_mode *m;
+	int cpp;
+
+	if (!fb || !state->crtc)
+		return 0;
+
+	crtc_state = drm_atomic_get_crtc_state(state->state, state->crtc);
+	if (IS_ERR(crtc_state))
+		return PTR_ERR(crtc_state);
+
+	if (!crtc_state->enable)
+		return 0;
+
+	/*
+	 * Neither the main surface nor the AS can be positioned or scaled,
+	 * and there is no stride register: the plane must cover the whole
+	 * mode and the fb lines must be exactly one mode line long.
+	 */
+	m = &crtc_state->adjusted_mode;
+	cpp = drm_format_plane_cpp(fb->pixel_format, 0);
+
+	if (state->crtc_x || state->crtc_y ||
+	    state->crtc_w != m->hdisplay || state->crtc_h != m->vdisplay)
+		return -EINVAL;
+
+	if (state->src_x || state->src_y & 0xffff ||
+	    state->src_w != state->crtc_w << 16 ||
+	    state->src_h != state->crtc_h << 16)
+		return -EINVAL;
+
+	if (fb->pitches[0] != state->crtc_w * cpp)
+		return -EINVAL;
+
+	/* the scanout format of the main surface is set at modeset time */
+	if (plane->type == DRM_PLANE_TYPE_PRIMARY &&
+	    !mxsfb_needs_modeset(crtc_state) && plane->state->fb &&
+	    plane->state->fb->pixel_format != fb->pixel_format)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void mxsfb_primary_atomic_update(struct drm_plane *plane,
+					struct drm_plane_state *old_state)
+{
+	struct mxsfb_drm_private *mxsfb = plane->dev->dev_private;
+	struct drm_plane_state *state = plane->state;
+
+	/* CRTC enable programs both buffers itself */
+	if (!state->crtc || !state->fb || !mxsfb->crtc.state->active)
+		return;
+
+	writel(mxsfb_plane_paddr(state),
+	       mxsfb->base + mxsfb->devdata->next_buf);
+}
+
+static void mxsfb_primary_atomic_disable(struct drm_plane *plane,
+					 struct drm_plane_state *old_state)
+{
+	/* the CRTC cannot run without its primary plane, see atomic_check */
+}
+
+static const struct drm_plane_helper_funcs mxsfb_primary_helper_funcs = {
+	.atomic_check = mxsfb_plane_atomic_check,
+	.atomic_update = mxsfb_primary_atomic_update,
+	.atomic_disable = mxsfb_primary_atomic_disable,
+};
+
+static void mxsfb_overlay_atomic_update(struct drm_plane *plane,
+					struct drm_plane_state *old_state)
+{
+	struct mxsfb_drm_private *mxsfb = plane->dev->dev_private;
+	struct drm_plane_state *state = plane->state;
+	dma_addr_t paddr;
+	u32 ctrl;
+
+	if (!state->crtc || !state->fb)
+		return;
+
+	switch (state->fb->pixel_format) {
+	case DRM_FORMAT_ARGB8888:
+		ctrl = AS_CTRL_FORMAT_ARGB8888 | AS_CTRL_ALPHA_CTRL_EMBEDDED;
+		break;
+	case DRM_FORMAT_XRGB8888:
+		ctrl = AS_CTRL_FORMAT_RGB888 | AS_CTRL_ALPHA_CTRL_OVERRIDE;
+		break;
+	case DRM_FORMAT_RGB565:
+		ctrl = AS_CTRL_FORMAT_RGB565 | AS_CTRL_ALPHA_CTRL_OVERRIDE;
+		break;
+	case DRM_FORMAT_ARGB1555:
+		ctrl = AS_CTRL_FORMAT_ARGB1555 | AS_CTRL_ALPHA_CTRL_EMBEDDED;
+		break;
+	case DRM_FORMAT_XRGB1555:
+		ctrl = AS_CTRL_FORMAT_RGB555 | AS_CTRL_ALPHA_CTRL_OVERRIDE;
+		break;
+	case DRM_FORMAT_ARGB4444:
+		ctrl = AS_CTRL_FORMAT_ARGB4444 | AS_CTRL_ALPHA_CTRL_EMBEDDED;
+		break;
+	case DRM_FORMAT_XRGB4444:
+	default:
+		ctrl = AS_CTRL_FORMAT_RGB444 | AS_CTRL_ALPHA_CTRL_OVERRIDE;
+		break;
+	}
+	/* formats without alpha are shown fully opaque */
+	ctrl |= AS_CTRL_ALPHA(0xff) | AS_CTRL_AS_ENABLE;
+
+	paddr = mxsfb_plane_paddr(state);
+	writel(paddr, mxsfb->base + LCDC_AS_NEXT_BUF);
+	/* a surface being switched on has no current buffer to flip from */
+	if (!old_state->fb)
+		writel(paddr, mxsfb->base + LCDC_AS_BUF);
+	writel(ctrl, mxsfb->base + LCDC_AS_CTRL);
+}
+
+static void mxsfb_overlay_atomic_disable(struct drm_plane *plane,
+					 struct drm_plane_state *old_state)
+{
+	struct mxsfb_drm_private *mxsfb = plane->dev->dev_private;
+
+	writel(0, mxsfb->base + LCDC_AS_CTRL);
+}
+
+static const struct drm_plane_helper_funcs mxsfb_overlay_helper_funcs = {
+	.atomic_check = mxsfb_plane_atomic_check,
+	.atomic_update = mxsfb_overlay_atomic_update,
+	.atomic_disable = mxsfb_overlay_atomic_disable,
+};
+
+static const struct drm_plane_funcs mxsfb_plane_funcs = {
+	.update_plane = drm_atomic_helper_update_plane,
+	.disable_plane = drm_atomic_helper_disable_plane,
+	.destroy = drm_plane_cleanup,
+	.reset = drm_atomic_helper_plane_reset,
+	.atomic_duplicate_state = drm_atomic_helper_plane_duplicate_state,
+	.atomic_destroy_state = drm_atomic_helper_plane_destroy_state,
+};
+
+int mxsfb_create_crtc(struct drm_device *drm)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+	int ret;
+
+	ret = drm_universal_plane_init(drm, &mxsfb->primary, 1,
+				       &mxsfb_plane_funcs,
+				       mxsfb_primary_formats,
+				       ARRAY_SIZE(mxsfb_primary_formats),
+				       DRM_PLANE_TYPE_PRIMARY);
+	if (ret)
+		return ret;
+
+	drm_plane_helper_add(&mxsfb->primary, &mxsfb_primary_helper_funcs);
+
+	if (mxsfb->devdata->has_overlay) {
+		ret = drm_universal_plane_init(drm, &mxsfb->overlay, 1,
+					       &mxsfb_plane_funcs,
+					       mxsfb_overlay_formats,
+					       ARRAY_SIZE(mxsfb_overlay_formats),
+					       DRM_PLANE_TYPE_OVERLAY);
+		if (ret)
+			return ret;
+
+		drm_plane_helper_add(&mxsfb->overlay,
+				     &mxsfb_overlay_helper_funcs);
+
+		/* start with the AS off whatever the bootloader left */
+		writel(0, mxsfb->base + LCDC_AS_CTRL);
+	}
+
+	ret = drm_crtc_init_with_planes(drm, &mxsfb->crtc, &mxsfb->primary,
+					NULL, &mxsfb_crtc_funcs);
+	if (ret)
+		return ret;
+
+	drm_crtc_helper_add(&mxsfb->crtc, &mxsfb_crtc_helper_funcs);
+
+	return 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright 2015 Freescale Semiconductor, Inc. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/of.h>
+#include <linux/of_graph.h>
+#include <video/display_timing.h>
+#include <video/of_videomode.h>
+#include <video/videomode.h>
+
+#include <drm/drmP.h>
+#include <drm/drm_atomic_helper.h>
+#include <drm/drm_crtc_helper.h>
+#include <drm/drm_panel.h>
+
+#include "mxsfb_drv.h"
+#include "mxsfb_regs.h"
+
+static inline struct mxsfb_drm_private *
+connector_to_mxsfb(struct drm_connector *connector)
+{
+	return container_of(connector, struct mxsfb_drm_private, connector);
+}
+
+static inline struct mxsfb_drm_private *
+encoder_to_mxsfb(struct drm_encoder *encoder)
+{
+	return container_of(encoder, struct mxsfb_drm_private, encoder);
+}
+
+static int mxsfb_connector_get_modes(struct drm_connector *connector)
+{
+	struct mxsfb_drm_private *mxsfb = connector_to_mxsfb(connector);
+	struct drm_display_mode *mode;
+
+	if (mxsfb->panel)
+		return mxsfb->panel->funcs->get_modes(mxsfb->panel);
+
+	mode = drm_mode_duplicate(connector->dev, mxsfb->mode);
+	if (!mode)
+		return 0;
+
+	mode->type |= DRM_MODE_TYPE_PREFERRED;
+	drm_mode_probed_add(connector, mode);
+
+	return 1;
+}
+
+static enum drm_mode_status
+mxsfb_connector_mode_valid(struct drm_connector *connector,
+			   struct drm_display_mode *mode)
+{
+	if (mode->hdisplay < MXSFB_MIN_XRES || mode->vdisplay < MXSFB_MIN_YRES)
+		return MODE_BAD;
+
+	if (mode->flags & DRM_MODE_FLAG_INTERLACE)
+		return MODE_NO_INTERLACE;
+
+	return MODE_OK;
+}
+
+static struct drm_encoder *
+mxsfb_connector_best_encoder(struct drm_connector *connector)
+{
+	return &connector_to_mxsfb(connector)->encoder;
+}
+
+static const struct drm_connector_helper_funcs mxsfb_connector_helper_funcs = {
+	.get_modes = mxsfb_connector_get_modes,
+	.mode_valid = mxsfb_connector_mode_valid,
+	.best_encoder = mxsfb_connector_best_encoder,
+};
+
+static enum drm_connector_status
+mxsfb_connector_detect(struct drm_connector *connector, bool force)
+{
+	return connector_status_connected;
+}
+
+static void mxsfb_connector_destroy(struct drm_connector *connector)
+{
+	struct mxsfb_drm_private *mxsfb = connector_to_mxsfb(connector);
+
+	if (mxsfb->panel)
+		drm_panel_detach(mxsfb->panel);
+	drm_connector_cleanup(connector);
+}
+
+static const struct drm_connector_funcs mxsfb_connector_funcs = {
+	.dpms = drm_atomic_helper_connector_dpms,
+	.detect = mxsfb_connector_detect,
+	.fill_modes = drm_helper_probe_single_connector_modes,
+	.destroy = mxsfb_connector_destroy,
+	.reset = drm_atomic_helper_connector_reset,
+	.atomic_duplicate_state = drm_atomic_helper_connector_duplicate_state,
+	.atomic_destroy_state = drm_atomic_helper_connector_destroy_state,
+};
+
+static void mxsfb_encoder_enable(struct drm_encoder *encoder)
+{
+	struct mxsfb_drm_private *mxsfb = encoder_to_mxsfb(encoder);
+
+	if (mxsfb->panel) {
+		drm_panel_prepare(mxsfb->panel);
+		drm_panel_enable(mxsfb->panel);
+	}
+}
+
+static void mxsfb_encoder_disable(struct drm_encoder *encoder)
+{
+	struct mxsfb_drm_private *mxsfb = encoder_to_mxsfb(encoder);
+
+	if (mxsfb->panel) {
+		drm_panel_disable(mxsfb->panel);
+		drm_panel_unprepare(mxsfb->panel);
+	}
+}
+
+static bool mxsfb_encoder_mode_fixup(struct drm_encoder *encoder,
+				     const struct drm_display_mode *mode,
+				     struct drm_display_mode *adjusted)
+{
+	return true;
+}
+
+static void mxsfb_encoder_mode_set(struct drm_encoder *encoder,
+				   struct drm_display_mode *mode,
+				   struct drm_display_mode *adjusted)
+{
+}
+
+static const struct drm_encoder_helper_funcs mxsfb_encoder_helper_funcs = {
+	.mode_fixup = mxsfb_encoder_mode_fixup,
+	.mode_set = mxsfb_encoder_mode_set,
+	.disable = mxsfb_encoder_disable,
+	.enable = mxsfb_encoder_enable,
+};
+
+static const struct drm_encoder_funcs mxsfb_encoder_funcs = {
+	.destroy = drm_encoder_cleanup,
+};
+
+static int mxsfb_parse_bus_width(struct device *dev, u32 width, u32 *out)
+{
+	switch (width) {
+	case 16:
+		*out = STMLCDIF_16BIT;
+		break;
+	case 18:
+		*out = STMLCDIF_18BIT;
+		break;
+	case 24:
+		*out = STMLCDIF_24BIT;
+		break;
+	default:
+		dev_err(dev, "invalid bus-width value %u\n", width);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Boards described for the fbdev driver have a "display" phandle holding
+ * the bus width and a display-timings node; use its native mode.
+ */
+static int mxsfb_parse_display_node(struct drm_device *drm)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+	struct device_node *np;
+	struct videomode vm;
+	u32 width;
+	int ret;
+
+	np = of_parse_phandle(drm->dev->of_node, "display", 0);
+	if (!np) {
+		dev_err(drm->dev, "no panel endpoint nor display phandle\n");
+		return -ENODEV;
+	}
+
+	ret = of_property_read_u32(np, "bus-width", &width);
+	if (ret) {
+		dev_err(drm->dev, "failed to get property bus-width\n");
+		goto out;
+	}
+
+	ret = mxsfb_parse_bus_width(drm->dev, width, &mxsfb->bus_width);
+	if (ret)
+		goto out;
+
+	ret = of_get_videomode(np, &vm, OF_USE_NATIVE_MODE);
+	if (ret) {
+		dev_err(drm->dev, "failed to get display timings\n");
+		goto out;
+	}
+
+	mxsfb->mode = drm_mode_create(drm);
+	if (!mxsfb->mode) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	drm_display_mode_from_videomode(&vm, mxsfb->mode);
+	drm_mode_set_name(mxsfb->mode);
+	mxsfb->vm_flags = vm.flags;
+
+out:
+	of_node_put(np);
+	return ret;
+}
+
+int mxsfb_create_output(struct drm_device *drm)
+{
+	struct mxsfb_drm_private *mxsfb = drm->dev_private;
+	struct device_node *ep, *np;
+	u32 width = 24;
+	int ret;
+
+	ep = of_graph_get_next_endpoint(drm->dev->of_node, NULL);
+	if (ep) {
+		np = of_graph_get_remote_port_parent(ep);
+		of_node_put(ep);
+		if (!np)
+			return -EINVAL;
+
+		mxsfb->panel = of_drm_find_panel(np);
+		of_property_read_u32(np, "bus-width", &width);
+		of_node_put(np);
+
+		if (!mxsfb->panel)
+			return -EPROBE_DEFER;
+
+		ret = mxsfb_parse_bus_width(drm->dev, width, &mxsfb->bus_width);
+		if (ret)
+			return ret;
+
+		mxsfb->vm_flags = DISPLAY_FLAGS_DE_HIGH;
+	} else {
+		ret = mxsfb_parse_display_node(drm);
+		if (ret)
+			return ret;
+	}
+
+	of_property_read_u32(drm->dev->of_node, "fsl,dotclk-delay",
+			     &mxsfb->dotclk_delay);
+
+	drm_encoder_helper_add(&mxsfb->encoder, &mxsfb_encoder_helper_funcs);
+	ret = drm_encoder_init(drm, &mxsfb->encoder, &mxsfb_encoder_funcs,
+			       DRM_MODE_ENCODER_NONE);
+	if (ret)
+		return ret;
+
+	mxsfb->encoder.possible_crtcs = 0x1;
+
+	mxsfb->connector.dpms = DRM_MODE_DPMS_OFF;
+	mxsfb->connector.polled = DRM_CONNECTOR_POLL_CONNECT;
+	drm_connector_helper_add(&mxsfb->connector,
+				 &mxsfb_connector_helper_funcs);
+	ret = drm_connector_init(drm, &mxsfb->connector,
+				 &mxsfb_connector_funcs,
+				 DRM_MODE_CONNECTOR_Unknown);
+	if (ret)
+		goto err_encoder_cleanup;
+
+	drm_mode_connector_attach_encoder(&mxsfb->connector, &mxsfb->encoder);
+	drm_connector_register(&mxsfb->connector);
+
+	if (mxsfb->panel)
+		drm_panel_attach(mxsfb->panel, &mxsfb->connector);
+
+	return 0;
+
+err_encoder_cleanup:
+	drm_encoder_cleanup(&mxsfb->encoder);
+
+	return ret;
+}
@@ -70,6 +70,7 @@
  * the appropriate.
  */
 #define DMA_THRESHOLD	16
+#define DMA_MIN_LEN	5
 #define DMA_TIMEOUT	1000
 
 /* IMX I2C registers:
@@ -121,6 +122,11 @@
 /** Variables ******************************************************************
 *******************************************************************************/
 
+static unsigned int dma_threshold = DMA_THRESHOLD;
+module_param(dma_threshold, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_threshold,
+		 "Shortest message in bytes done by DMA (default: 16, minimum: 5)");
+
 /*
  * sorted list of clock divider, register value pairs
  * taken from table 26-5, p.26-9, Freescale i.MX
@@ -195,6 +201,21 @@ struct imx_i2c_dma {
 	enum dma_data_direction dma_data_dir;
 };
 
+/*
+ * PIO messages are run from the interrupt handler, one state per byte on
+ * the bus. IDLE is also used while a DMA message is in flight, the
+ * handler then only records the status for i2c_imx_trx_complete().
+ */
+enum imx_i2c_state {
+	IMX_I2C_STATE_IDLE,
+	IMX_I2C_STATE_WRITE,
+	IMX_I2C_STATE_READ_ADDR,
+	IMX_I2C_STATE_READ_BLOCK_LEN,
+	IMX_I2C_STATE_READ,
+	IMX_I2C_STATE_DONE,
+	IMX_I2C_STATE_FAILED,
+};
+
 struct imx_i2c_struct {
 	struct i2c_adapter	adapter;
 	struct clk		*clk;
@@ -209,6 +230,15 @@ struct imx_i2c_struct {
 	const struct imx_i2c_hwdata	*hwdata;
 
 	struct imx_i2c_dma	*dma;
+
+	/* PIO messages run by i2c_imx_isr() */
+	enum imx_i2c_state	state;
+	struct i2c_msg		*msg;
+	struct i2c_msg		*last_msg;
+	unsigned int		msgs_left;
+	unsigned int		msg_buf_idx;
+	int			isr_result;
+	bool			is_lastmsg;
 };
 
 static const struct imx_i2c_hwdata imx1_i2c_hwdata  = {
@@ -579,25 +609,231 @@ static void i2c_imx_stop(struct imx_i2c_struct *i2c_imx)
 	clk_disable_unprepare(i2c_imx->clk);
 }
 
+static void i2c_imx_msg_done(struct imx_i2c_struct *i2c_imx, int result)
+{
+	i2c_imx->isr_result = result;
+	i2c_imx->state = result ? IMX_I2C_STATE_FAILED : IMX_I2C_STATE_DONE;
+	wake_up(&i2c_imx->queue);
+}
+
+/* Send the slave address of i2c_imx->msg, i2c_imx_isr() does the rest */
+static void i2c_imx_msg_start(struct imx_i2c_struct *i2c_imx)
+{
+	struct i2c_msg *msg = i2c_imx->msg;
+
+	i2c_imx->msg_buf_idx = 0;
+	i2c_imx->is_lastmsg = msg == i2c_imx->last_msg;
+
+	if (msg->flags & I2C_M_RD) {
+		i2c_imx->state = IMX_I2C_STATE_READ_ADDR;
+		imx_i2c_write_reg((msg->addr << 1) | 0x01, i2c_imx,
+				  IMX_I2C_I2DR);
+	} else {
+		i2c_imx->state = IMX_I2C_STATE_WRITE;
+		imx_i2c_write_reg(msg->addr << 1, i2c_imx, IMX_I2C_I2DR);
+	}
+}
+
+/*
+ * The message is on the bus: chain the next one of the batch with a
+ * repeated start right here, the bus stays busy so there is nothing to
+ * wait for.
+ */
+static void i2c_imx_msg_next(struct imx_i2c_struct *i2c_imx)
+{
+	unsigned int temp;
+
+	if (!i2c_imx->msgs_left) {
+		i2c_imx_msg_done(i2c_imx, 0);
+		return;
+	}
+
+	temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
+	temp |= I2CR_RSTA;
+	imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
+
+	i2c_imx->msg++;
+	i2c_imx->msgs_left--;
+	i2c_imx_msg_start(i2c_imx);
+}
+
+/* Set up the end of the message before I2DR is read for byte @i */
+static void i2c_imx_read_prepare(struct imx_i2c_struct *i2c_imx,
+				 unsigned int i)
+{
+	struct i2c_msg *msg = i2c_imx->msg;
+	unsigned int temp;
+
+	if (i == msg->len - 1) {
+		temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
+		if (i2c_imx->is_lastmsg) {
+			/*
+			 * It must generate STOP before read I2DR to prevent
+			 * controller from generating another clock cycle
+			 */
+			temp &= ~(I2CR_MSTA | I2CR_MTX);
+		} else {
+			/*
+			 * For i2c master receiver repeat restart operation like:
+			 * read -> repeat MSTA -> read/write
+			 * The controller must set MTX before read the last byte in
+			 * the first read operation, otherwise the first read cost
+			 * one extra clock cycle.
+			 */
+			temp |= I2CR_MTX;
+		}
+		imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
+	} else if (i == msg->len - 2) {
+		temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
+		temp |= I2CR_TXAK;
+		imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
+	}
+}
+
+static void i2c_imx_msg_isr(struct imx_i2c_struct *i2c_imx,
+			    unsigned int status)
+{
+	struct i2c_msg *msg = i2c_imx->msg;
+	unsigned int temp;
+	u8 len;
+
+	/* check for arbitration lost */
+	if (status & I2SR_IAL) {
+		temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2SR);
+		temp &= ~I2SR_IAL;
+		imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2SR);
+		i2c_imx_msg_done(i2c_imx, -EAGAIN);
+		return;
+	}
+
+	switch (i2c_imx->state) {
+	case IMX_I2C_STATE_WRITE:
+		if (status & I2SR_RXAK) {
+			i2c_imx_msg_done(i2c_imx, -EIO);  /* No ACK */
+			return;
+		}
+		if (i2c_imx->msg_buf_idx < msg->len) {
+			imx_i2c_write_reg(msg->buf[i2c_imx->msg_buf_idx++],
+					  i2c_imx, IMX_I2C_I2DR);
+			return;
+		}
+		i2c_imx_msg_next(i2c_imx);
+		return;
+
+	case IMX_I2C_STATE_READ_ADDR:
+		if (status & I2SR_RXAK) {
+			i2c_imx_msg_done(i2c_imx, -EIO);  /* No ACK */
+			return;
+		}
+
+		/* setup bus to read data */
+		temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
+		temp &= ~I2CR_MTX;
+
+		/*
+		 * Reset the I2CR_TXAK flag initially for SMBus block read
+		 * since the length is unknown
+		 */
+		if ((msg->len - 1) || (msg->flags & I2C_M_RECV_LEN))
+			temp &= ~I2CR_TXAK;
+		imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
+
+		i2c_imx->state = (msg->flags & I2C_M_RECV_LEN) ?
+			IMX_I2C_STATE_READ_BLOCK_LEN : IMX_I2C_STATE_READ;
+		imx_i2c_read_reg(i2c_imx, IMX_I2C_I2DR); /* dummy read */
+		if (!msg->len)
+			i2c_imx_msg_next(i2c_imx);
+		return;
+
+	case IMX_I2C_STATE_READ_BLOCK_LEN:
+		/*
+		 * First byte is the length of remaining packet
+		 * in the SMBus block data read. Add it to
+		 * msgs->len.
+		 */
+		len = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2DR);
+		if ((len == 0) || (len > I2C_SMBUS_BLOCK_MAX)) {
+			i2c_imx_msg_done(i2c_imx, -EPROTO);
+			return;
+		}
+		msg->len += len;
+		i2c_imx_read_prepare(i2c_imx, 0);
+		msg->buf[0] = len;
+		i2c_imx->msg_buf_idx = 1;
+		i2c_imx->state = IMX_I2C_STATE_READ;
+		return;
+
+	case IMX_I2C_STATE_READ:
+		i2c_imx_read_prepare(i2c_imx, i2c_imx->msg_buf_idx);
+		msg->buf[i2c_imx->msg_buf_idx++] =
+			imx_i2c_read_reg(i2c_imx, IMX_I2C_I2DR);
+		if (i2c_imx->msg_buf_idx == msg->len)
+			i2c_imx_msg_next(i2c_imx);
+		return;
+
+	default:
+		/* a late interrupt for a message that already finished */
+		return;
+	}
+}
+
 static irqreturn_t i2c_imx_isr(int irq, void *dev_id)
 {
 	struct imx_i2c_struct *i2c_imx = dev_id;
-	unsigned int temp;
+	unsigned int status, temp;
 
-	temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2SR);
-	if (temp & I2SR_IIF) {
-		/* save status register */
-		i2c_imx->i2csr = temp;
-		temp &= ~I2SR_IIF;
+	status = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2SR);
+	if (status & I2SR_IIF) {
+		temp = status & ~I2SR_IIF;
 		temp |= (i2c_imx->hwdata->i2sr_clr_opcode & I2SR_IIF);
 		imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2SR);
-		wake_up(&i2c_imx->queue);
+
+		if (i2c_imx->state == IMX_I2C_STATE_IDLE) {
+			/* save status register */
+			i2c_imx->i2csr = status;
+			wake_up(&i2c_imx->queue);
+		} else {
+			i2c_imx_msg_isr(i2c_imx, status);
+		}
 		return IRQ_HANDLED;
 	}
 
 	return IRQ_NONE;
 }
 
+/*
+ * Wait for i2c_imx_isr() to run the messages. Each byte used to get
+ * HZ / 10 of its own when they were waited for one by one.
+ */
+static int i2c_imx_msg_wait(struct imx_i2c_struct *i2c_imx, unsigned int len)
+{
+	int result;
+
+	wait_event_timeout(i2c_imx->queue,
+			   i2c_imx->state == IMX_I2C_STATE_DONE ||
+			   i2c_imx->state == IMX_I2C_STATE_FAILED,
+			   (len + 1) * HZ / 10);
+
+	switch (i2c_imx->state) {
+	case IMX_I2C_STATE_DONE:
+		result = 0;
+		break;
+	case IMX_I2C_STATE_FAILED:
+		result = i2c_imx->isr_result;
+		dev_dbg(&i2c_imx->adapter.dev, "<%s> failed: %d\n",
+			__func__, result);
+		break;
+	default:
+		dev_dbg(&i2c_imx->adapter.dev, "<%s> Timeout\n", __func__);
+		result = -ETIMEDOUT;
+		break;
+	}
+
+	i2c_imx->state = IMX_I2C_STATE_IDLE;
+
+	return result;
+}
+
 static int i2c_imx_dma_write(struct imx_i2c_struct *i2c_imx,
 					struct i2c_msg *msgs)
 {
@@ -671,6 +907,26 @@ static int i2c_imx_dma_read(struct imx_i2c_struct *i2c_imx,
 	struct imx_i2c_dma *dma = i2c_imx->dma;
 	struct device *dev = &i2c_imx->adapter.dev;
 
+	dev_dbg(dev, "<%s> write slave address: addr=0x%x\n",
+		__func__, (msgs->addr << 1) | 0x01);
+
+	/* write slave address */
+	imx_i2c_write_reg((msgs->addr << 1) | 0x01, i2c_imx, IMX_I2C_I2DR);
+	result = i2c_imx_trx_complete(i2c_imx);
+	if (result)
+		return result;
+	result = i2c_imx_acked(i2c_imx);
+	if (result)
+		return result;
+
+	dev_dbg(dev, "<%s> setup bus\n", __func__);
+
+	/* setup bus to read data */
+	temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
+	temp &= ~(I2CR_MTX | I2CR_TXAK);
+	imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
+	imx_i2c_read_reg(i2c_imx, IMX_I2C_I2DR); /* dummy read */
+
 	temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
 	temp |= I2CR_DMAEN;
 	imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
@@ -749,146 +1005,57 @@ static int i2c_imx_dma_read(struct imx_i2c_struct *i2c_imx,
 	return 0;
 }
 
-static int i2c_imx_write(struct imx_i2c_struct *i2c_imx, struct i2c_msg *msgs)
+static bool i2c_imx_use_dma(struct imx_i2c_struct *i2c_imx,
+			    struct i2c_msg *msg)
 {
-	int i, result;
-
-	dev_dbg(&i2c_imx->adapter.dev, "<%s> write slave address: addr=0x%x\n",
-		__func__, msgs->addr << 1);
-
-	/* write slave address */
-	imx_i2c_write_reg(msgs->addr << 1, i2c_imx, IMX_I2C_I2DR);
-	result = i2c_imx_trx_complete(i2c_imx);
-	if (result)
-		return result;
-	result = i2c_imx_acked(i2c_imx);
-	if (result)
-		return result;
-	dev_dbg(&i2c_imx->adapter.dev, "<%s> write data\n", __func__);
-
-	/* write data */
-	for (i = 0; i < msgs->len; i++) {
-		dev_dbg(&i2c_imx->adapter.dev,
-			"<%s> write byte: B%d=0x%X\n",
-			__func__, i, msgs->buf[i]);
-		imx_i2c_write_reg(msgs->buf[i], i2c_imx, IMX_I2C_I2DR);
-		result = i2c_imx_trx_complete(i2c_imx);
-		if (result)
-			return result;
-		result = i2c_imx_acked(i2c_imx);
-		if (result)
-			return result;
-	}
-	return 0;
+	return i2c_imx->dma && !(msg->flags & I2C_M_RECV_LEN) &&
+	       msg->len >= max_t(unsigned int, dma_threshold, DMA_MIN_LEN);
 }
 
-static int i2c_imx_read(struct imx_i2c_struct *i2c_imx, struct i2c_msg *msgs, bool is_lastmsg)
+/*
+ * Run @num PIO messages back to back from the interrupt handler, with a
+ * repeated start in between, so that e.g. a register address write and
+ * the read that follows are a single wake-up. @last is the final
+ * message of the whole transfer, its end generates STOP.
+ */
+static int i2c_imx_pio_xfer(struct imx_i2c_struct *i2c_imx,
+			    struct i2c_msg *msgs, int num,
+			    struct i2c_msg *last)
 {
+	unsigned int len = 0;
 	int i, result;
-	unsigned int temp;
-	int block_data = msgs->flags & I2C_M_RECV_LEN;
-
-	dev_dbg(&i2c_imx->adapter.dev,
-		"<%s> write slave address: addr=0x%x\n",
-		__func__, (msgs->addr << 1) | 0x01);
 
-	/* write slave address */
-	imx_i2c_write_reg((msgs->addr << 1) | 0x01, i2c_imx, IMX_I2C_I2DR);
-	result = i2c_imx_trx_complete(i2c_imx);
-	if (result)
-		return result;
-	result = i2c_imx_acked(i2c_imx);
-	if (result)
-		return result;
-
-	dev_dbg(&i2c_imx->adapter.dev, "<%s> setup bus\n", __func__);
-
-	/* setup bus to read data */
-	temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
-	temp &= ~I2CR_MTX;
-
-	/*
-	 * Reset the I2CR_TXAK flag initially for SMBus block read since the
-	 * length is unknown
-	 */
-	if ((msgs->len - 1) || block_data)
-		temp &= ~I2CR_TXAK;
-	imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
-	imx_i2c_read_reg(i2c_imx, IMX_I2C_I2DR); /* dummy read */
+	for (i = 0; i < num; i++) {
+		len += msgs[i].len + 1;
+		if (msgs[i].flags & I2C_M_RECV_LEN)
+			len += I2C_SMBUS_BLOCK_MAX;
+	}
 
-	dev_dbg(&i2c_imx->adapter.dev, "<%s> read data\n", __func__);
+	dev_dbg(&i2c_imx->adapter.dev, "<%s> %d message(s), addr=0x%x\n",
+		__func__, num, msgs->addr << 1);
 
-	if (i2c_imx->dma && msgs->len >= DMA_THRESHOLD && !block_data)
-		return i2c_imx_dma_read(i2c_imx, msgs, is_lastmsg);
+	i2c_imx->msg = msgs;
+	i2c_imx->last_msg = last;
+	i2c_imx->msgs_left = num - 1;
+	i2c_imx_msg_start(i2c_imx);
 
-	/* read data */
-	for (i = 0; i < msgs->len; i++) {
-		u8 len = 0;
+	result = i2c_imx_msg_wait(i2c_imx, len);
+	if (result)
+		return result;
 
-		result = i2c_imx_trx_complete(i2c_imx);
-		if (result)
-			return result;
-		/*
-		 * First byte is the length of remaining packet
-		 * in the SMBus block data read. Add it to
-		 * msgs->len.
-		 */
-		if ((!i) && block_data) {
-			len = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2DR);
-			if ((len == 0) || (len > I2C_SMBUS_BLOCK_MAX))
-				return -EPROTO;
-			dev_dbg(&i2c_imx->adapter.dev,
-				"<%s> read length: 0x%X\n",
-				__func__, len);
-			msgs->len += len;
-		}
-		if (i == (msgs->len - 1)) {
-			if (is_lastmsg) {
-				/*
-				 * It must generate STOP before read I2DR to prevent
-				 * controller from generating another clock cycle
-				 */
-				dev_dbg(&i2c_imx->adapter.dev,
-					"<%s> clear MSTA\n", __func__);
-				temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
-				temp &= ~(I2CR_MSTA | I2CR_MTX);
-				imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
-				i2c_imx_bus_busy(i2c_imx, 0);
-				i2c_imx->stopped = 1;
-			} else {
-				/*
-				 * For i2c master receiver repeat restart operation like:
-				 * read -> repeat MSTA -> read/write
-				 * The controller must set MTX before read the last byte in
-				 * the first read operation, otherwise the first read cost
-				 * one extra clock cycle.
-				 */
-				temp = readb(i2c_imx->base + IMX_I2C_I2CR);
-				temp |= I2CR_MTX;
-				writeb(temp, i2c_imx->base + IMX_I2C_I2CR);
-			}
-		} else if (i == (msgs->len - 2)) {
-			dev_dbg(&i2c_imx->adapter.dev,
-				"<%s> set TXAK\n", __func__);
-			temp = imx_i2c_read_reg(i2c_imx, IMX_I2C_I2CR);
-			temp |= I2CR_TXAK;
-			imx_i2c_write_reg(temp, i2c_imx, IMX_I2C_I2CR);
-		}
-		if ((!i) && block_data)
-			msgs->buf[0] = len;
-		else
-			msgs->buf[i] =  imx_i2c_read_reg(i2c_imx, IMX_I2C_I2DR);
-		dev_dbg(&i2c_imx->adapter.dev,
-			"<%s> read byte: B%d=0x%X\n",
-			__func__, i, msgs->buf[i]);
+	/* the interrupt handler generated STOP before the last byte */
+	if (&msgs[num - 1] == last && (last->flags & I2C_M_RD) && last->len) {
+		i2c_imx_bus_busy(i2c_imx, 0);
+		i2c_imx->stopped = 1;
 	}
+
 	return 0;
 }
 
 static int i2c_imx_xfer(struct i2c_adapter *adapter,
 						struct i2c_msg *msgs, int num)
 {
-	unsigned int i, temp;
+	unsigned int i, n, temp;
 	int result;
 	bool is_lastmsg = false;
 	struct imx_i2c_struct *i2c_imx = i2c_get_adapdata(adapter);
@@ -935,13 +1102,21 @@ static int i2c_imx_xfer(struct i2c_adapter *adapter,
 			(temp & I2SR_SRW ? 1 : 0), (temp & I2SR_IIF ? 1 : 0),
 			(temp & I2SR_RXAK ? 1 : 0));
 #endif
-		if (msgs[i].flags & I2C_M_RD)
-			result = i2c_imx_read(i2c_imx, &msgs[i], is_lastmsg);
-		else {
-			if (i2c_imx->dma && msgs[i].len >= DMA_THRESHOLD)
-				result = i2c_imx_dma_write(i2c_imx, &msgs[i]);
+		if (i2c_imx_use_dma(i2c_imx, &msgs[i])) {
+			if (msgs[i].flags & I2C_M_RD)
+				result = i2c_imx_dma_read(i2c_imx, &msgs[i],
+							  is_lastmsg);
 			else
-				result = i2c_imx_write(i2c_imx, &msgs[i]);
+				result = i2c_imx_dma_write(i2c_imx, &msgs[i]);
+		} else {
+			/* batch up to the next DMA message */
+			for (n = 1; i + n < num; n++)
+				if (i2c_imx_use_dma(i2c_imx, &msgs[i + n]))
+					break;
+
+			result = i2c_imx_pio_xfer(i2c_imx, &msgs[i], n,
+						  &msgs[num - 1]);
+			i += n - 1;
 		}
 		if (result)
 			goto fail0;
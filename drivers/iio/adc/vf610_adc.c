@@ -27,6 +27,9 @@
 #include <linux/io.h>
 #include <linux/clk.h>
 #include <linux/completion.h>
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/sizes.h>
 #include <linux/of.h>
 #include <linux/of_irq.h>
 #include <linux/regulator/consumer.h>
@@ -36,6 +39,11 @@
 #include <linux/iio/iio.h>
 #include <linux/iio/sysfs.h>
 #include <linux/iio/driver.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/buffer-dma.h>
+#include <linux/iio/trigger.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 
 /* This will be the driver name the kernel reports */
 #define DRIVER_NAME "vf610-adc"
@@ -98,6 +106,12 @@
 #define VF610_ADC_CALF			0x2
 #define VF610_ADC_TIMEOUT		msecs_to_jiffies(100)
 
+#define VF610_ADC_MAX_CHANS		16
+#define VF610_ADC_SCAN_TIMESTAMP	VF610_ADC_MAX_CHANS
+
+/* Longest transfer handed to the DMA engine in one segment */
+#define VF610_ADC_DMA_MAX_SEG		SZ_32K
+
 enum clk_sel {
 	VF610_ADCIOC_BUSCLK_SET,
 	VF610_ADCIOC_ALTCLK_SET,
@@ -144,6 +158,22 @@ struct vf610_adc {
 	u32 sample_freq_avail[5];
 
 	struct completion completion;
+
+	/* buffered capture, sequenced from the conversion interrupt */
+	u8 scan_chans[VF610_ADC_MAX_CHANS];
+	unsigned int scan_num;
+	unsigned int scan_pos;
+	bool continuous;
+	s64 timestamp;
+	/* channel data plus the 8-byte aligned timestamp */
+	u16 buffer[VF610_ADC_MAX_CHANS + 4] __aligned(8);
+
+	/* block buffer filled by DMA, used when an "rx" channel exists */
+	phys_addr_t regs_phys;
+	struct dma_chan *dma_chan;
+	struct iio_buffer *dma_buffer;
+	struct list_head dma_active;
+	spinlock_t dma_lock;
 };
 
 static const u32 vf610_hw_avgs[] = { 1, 4, 8, 16, 32 };
@@ -155,12 +185,19 @@ static const u32 vf610_hw_avgs[] = { 1, 4, 8, 16, 32 };
 	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),		\
 	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |	\
 				BIT(IIO_CHAN_INFO_SAMP_FREQ),	\
+	.scan_index = (_idx),					\
+	.scan_type = {						\
+		.sign = 'u',					\
+		.realbits = 12,					\
+		.storagebits = 16,				\
+	},							\
 }
 
 #define VF610_ADC_TEMPERATURE_CHAN(_idx, _chan_type) {	\
 	.type = (_chan_type),	\
 	.channel = (_idx),		\
 	.info_mask_separate = BIT(IIO_CHAN_INFO_PROCESSED),	\
+	.scan_index = -1,	\
 }
 
 static const struct iio_chan_spec vf610_adc_iio_channels[] = {
@@ -184,6 +221,9 @@ static const struct iio_chan_spec vf610_adc_iio_channels[] = {
 	/* sentinel */
 };
 
+static const struct iio_chan_spec vf610_adc_timestamp_chan =
+	IIO_CHAN_SOFT_TIMESTAMP(VF610_ADC_SCAN_TIMESTAMP);
+
 static inline void vf610_adc_calculate_rates(struct vf610_adc *info)
 {
 	unsigned long adck_rate, ipg_rate = clk_get_rate(info->clk);
@@ -432,20 +472,275 @@ static int vf610_adc_read_data(struct vf610_adc *info)
 	return result;
 }
 
+static inline void vf610_adc_start_chan(struct vf610_adc *info,
+					unsigned int pos)
+{
+	writel(VF610_ADC_ADCHC(info->scan_chans[pos]) | VF610_ADC_AIEN,
+	       info->regs + VF610_REG_ADC_HC0);
+}
+
+/*
+ * Store the sample of the current scan element and convert the next one.
+ * Once the scan is complete it is pushed and, in continuous mode, the
+ * sequence starts over at once; a triggered scan waits for the next
+ * trigger instead.
+ */
+static void vf610_adc_scan_next(struct iio_dev *indio_dev)
+{
+	struct vf610_adc *info = iio_priv(indio_dev);
+
+	info->buffer[info->scan_pos++] = info->value;
+	if (info->scan_pos < info->scan_num) {
+		vf610_adc_start_chan(info, info->scan_pos);
+		return;
+	}
+
+	info->scan_pos = 0;
+
+	if (!info->continuous) {
+		iio_push_to_buffers_with_timestamp(indio_dev, info->buffer,
+						   info->timestamp);
+		iio_trigger_notify_done(indio_dev->trig);
+		return;
+	}
+
+	/* a single channel keeps converting by itself */
+	if (info->scan_num > 1)
+		vf610_adc_start_chan(info, 0);
+
+	iio_push_to_buffers_with_timestamp(indio_dev, info->buffer,
+					   iio_get_time_ns());
+}
+
 static irqreturn_t vf610_adc_isr(int irq, void *dev_id)
 {
-	struct vf610_adc *info = (struct vf610_adc *)dev_id;
+	struct iio_dev *indio_dev = dev_id;
+	struct vf610_adc *info = iio_priv(indio_dev);
 	int coco;
 
 	coco = readl(info->regs + VF610_REG_ADC_HS);
 	if (coco & VF610_ADC_HS_COCO0) {
 		info->value = vf610_adc_read_data(info);
-		complete(&info->completion);
+		if (iio_buffer_enabled(indio_dev))
+			vf610_adc_scan_next(indio_dev);
+		else
+			complete(&info->completion);
 	}
 
 	return IRQ_HANDLED;
 }
 
+static irqreturn_t vf610_adc_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct vf610_adc *info = iio_priv(indio_dev);
+
+	/* the conversion interrupt completes the scan and the trigger */
+	info->timestamp = pf->timestamp;
+	info->scan_pos = 0;
+	vf610_adc_start_chan(info, 0);
+
+	return IRQ_HANDLED;
+}
+
+static int vf610_adc_buffer_postenable(struct iio_dev *indio_dev)
+{
+	struct vf610_adc *info = iio_priv(indio_dev);
+	unsigned int i;
+
+	info->scan_num = 0;
+	for_each_set_bit(i, indio_dev->active_scan_mask, indio_dev->masklength)
+		info->scan_chans[info->scan_num++] =
+			indio_dev->channels[i].channel;
+
+	if (!info->scan_num)
+		return -EINVAL;
+
+	info->scan_pos = 0;
+	info->continuous = indio_dev->currentmode != INDIO_BUFFER_TRIGGERED;
+
+	if (!info->continuous)
+		return iio_triggered_buffer_postenable(indio_dev);
+
+	writel(readl(info->regs + VF610_REG_ADC_GC) | VF610_ADC_ADCON,
+	       info->regs + VF610_REG_ADC_GC);
+	vf610_adc_start_chan(info, 0);
+
+	return 0;
+}
+
+static int vf610_adc_buffer_predisable(struct iio_dev *indio_dev)
+{
+	struct vf610_adc *info = iio_priv(indio_dev);
+	int ret = 0;
+
+	if (!info->continuous)
+		ret = iio_triggered_buffer_predisable(indio_dev);
+
+	writel(VF610_ADC_CONV_DISABLE, info->regs + VF610_REG_ADC_HC0);
+	writel(readl(info->regs + VF610_REG_ADC_GC) & ~VF610_ADC_ADCON,
+	       info->regs + VF610_REG_ADC_GC);
+
+	return ret;
+}
+
+static const struct iio_buffer_setup_ops vf610_adc_buffer_ops = {
+	.postenable = &vf610_adc_buffer_postenable,
+	.predisable = &vf610_adc_buffer_predisable,
+};
+
+/*
+ * The channel completes descriptors in submission order, so the block that
+ * is done is the oldest active one.  An abort may have given it back, and
+ * possibly freed it, already: only blocks still on the list are touched.
+ */
+static void vf610_adc_dma_done(void *data)
+{
+	struct vf610_adc *info = data;
+	struct iio_dma_buffer_block *block;
+	unsigned long flags;
+
+	spin_lock_irqsave(&info->dma_lock, flags);
+	block = list_first_entry_or_null(&info->dma_active,
+					 struct iio_dma_buffer_block, head);
+	if (block)
+		list_del(&block->head);
+	spin_unlock_irqrestore(&info->dma_lock, flags);
+
+	if (!block)
+		return;
+
+	block->block.timestamp = iio_get_time_ns();
+	block->block.flags = IIO_BUFFER_BLOCK_FLAG_TIMESTAMP_VALID;
+	iio_dma_buffer_block_done(block);
+}
+
+static int vf610_adc_dma_submit(struct iio_dma_buffer_queue *queue,
+				struct iio_dma_buffer_block *block)
+{
+	struct iio_dev *indio_dev = queue->driver_data;
+	struct vf610_adc *info = iio_priv(indio_dev);
+	struct dma_async_tx_descriptor *desc;
+	unsigned int nents, i, len;
+	struct scatterlist *sg;
+	struct sg_table sgt;
+	dma_cookie_t cookie;
+	int ret;
+
+	/* split the block to stay within the engine's segment limit */
+	nents = DIV_ROUND_UP(block->block.size, VF610_ADC_DMA_MAX_SEG);
+	ret = sg_alloc_table(&sgt, nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	for_each_sg(sgt.sgl, sg, nents, i) {
+		len = min_t(unsigned int, VF610_ADC_DMA_MAX_SEG,
+			    block->block.size - i * VF610_ADC_DMA_MAX_SEG);
+		sg_dma_address(sg) = block->phys_addr + i * VF610_ADC_DMA_MAX_SEG;
+		sg_dma_len(sg) = len;
+	}
+
+	/* the descriptor keeps its own copy of the segments */
+	desc = dmaengine_prep_slave_sg(info->dma_chan, sgt.sgl, nents,
+				       DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	sg_free_table(&sgt);
+	if (!desc)
+		return -ENOMEM;
+
+	desc->callback = vf610_adc_dma_done;
+	desc->callback_param = info;
+
+	spin_lock_irq(&info->dma_lock);
+	list_add_tail(&block->head, &info->dma_active);
+	spin_unlock_irq(&info->dma_lock);
+
+	cookie = dmaengine_submit(desc);
+	if (dma_submit_error(cookie)) {
+		spin_lock_irq(&info->dma_lock);
+		list_del(&block->head);
+		spin_unlock_irq(&info->dma_lock);
+		return -EIO;
+	}
+
+	dma_async_issue_pending(info->dma_chan);
+
+	return 0;
+}
+
+static void vf610_adc_dma_abort(struct iio_dma_buffer_queue *queue)
+{
+	struct iio_dev *indio_dev = queue->driver_data;
+	struct vf610_adc *info = iio_priv(indio_dev);
+	LIST_HEAD(aborted);
+
+	dmaengine_terminate_all(info->dma_chan);
+
+	spin_lock_irq(&info->dma_lock);
+	list_splice_init(&info->dma_active, &aborted);
+	spin_unlock_irq(&info->dma_lock);
+
+	iio_dma_buffer_block_list_abort(queue, &aborted);
+}
+
+static const struct iio_dma_buffer_ops vf610_adc_dma_buffer_ops = {
+	.submit = vf610_adc_dma_submit,
+	.abort = vf610_adc_dma_abort,
+};
+
+static int vf610_adc_dma_postenable(struct iio_dev *indio_dev)
+{
+	struct vf610_adc *info = iio_priv(indio_dev);
+	struct dma_slave_config config = {
+		.direction = DMA_DEV_TO_MEM,
+		.src_addr = info->regs_phys + VF610_REG_ADC_R0,
+		.src_addr_width = DMA_SLAVE_BUSWIDTH_2_BYTES,
+		.src_maxburst = 1,
+	};
+	unsigned int bit;
+	int ret;
+
+	bit = find_first_bit(indio_dev->active_scan_mask,
+			     indio_dev->masklength);
+	if (bit >= indio_dev->masklength)
+		return -EINVAL;
+	info->scan_chans[0] = indio_dev->channels[bit].channel;
+
+	ret = dmaengine_slave_config(info->dma_chan, &config);
+	if (ret)
+		return ret;
+
+	ret = iio_dma_buffer_enable(indio_dev->buffer, indio_dev);
+	if (ret)
+		return ret;
+
+	/* each conversion raises a DMA request instead of an interrupt */
+	writel(readl(info->regs + VF610_REG_ADC_GC) | VF610_ADC_ADCON |
+	       VF610_ADC_DMAEN, info->regs + VF610_REG_ADC_GC);
+	writel(VF610_ADC_ADCHC(info->scan_chans[0]),
+	       info->regs + VF610_REG_ADC_HC0);
+
+	return 0;
+}
+
+static int vf610_adc_dma_predisable(struct iio_dev *indio_dev)
+{
+	struct vf610_adc *info = iio_priv(indio_dev);
+
+	writel(VF610_ADC_CONV_DISABLE, info->regs + VF610_REG_ADC_HC0);
+	writel(readl(info->regs + VF610_REG_ADC_GC) &
+	       ~(VF610_ADC_ADCON | VF610_ADC_DMAEN),
+	       info->regs + VF610_REG_ADC_GC);
+
+	return iio_dma_buffer_disable(indio_dev->buffer, indio_dev);
+}
+
+static const struct iio_buffer_setup_ops vf610_adc_dma_setup_ops = {
+	.postenable = &vf610_adc_dma_postenable,
+	.predisable = &vf610_adc_dma_predisable,
+	.validate_scan_mask = &iio_validate_scan_mask_onehot,
+};
+
 static ssize_t vf610_show_samp_freq_avail(struct device *dev,
 				struct device_attribute *attr, char *buf)
 {
@@ -488,6 +783,11 @@ static int vf610_read_raw(struct iio_dev *indio_dev,
 	case IIO_CHAN_INFO_RAW:
 	case IIO_CHAN_INFO_PROCESSED:
 		mutex_lock(&indio_dev->mlock);
+		if (iio_buffer_enabled(indio_dev)) {
+			mutex_unlock(&indio_dev->mlock);
+			return -EBUSY;
+		}
+
 		reinit_completion(&info->completion);
 
 		hc_cfg = VF610_ADC_ADCHC(chan->channel);
@@ -592,6 +892,17 @@ static const struct iio_info vf610_adc_iio_info = {
 	.attrs = &vf610_attribute_group,
 };
 
+static void vf610_adc_free_dma(struct vf610_adc *info)
+{
+	if (info->dma_buffer)
+		iio_dma_buffer_free(info->dma_buffer);
+	info->dma_buffer = NULL;
+
+	if (info->dma_chan)
+		dma_release_channel(info->dma_chan);
+	info->dma_chan = NULL;
+}
+
 static const struct of_device_id vf610_adc_match[] = {
 	{ .compatible = "fsl,vf610-adc", },
 	{ /* sentinel */ }
@@ -602,6 +913,7 @@ static int vf610_adc_probe(struct platform_device *pdev)
 {
 	struct vf610_adc *info;
 	struct iio_dev *indio_dev;
+	struct iio_chan_spec *chans;
 	struct resource *mem;
 	int irq;
 	int ret;
@@ -620,6 +932,7 @@ static int vf610_adc_probe(struct platform_device *pdev)
 	info->regs = devm_ioremap_resource(&pdev->dev, mem);
 	if (IS_ERR(info->regs))
 		return PTR_ERR(info->regs);
+	info->regs_phys = mem->start;
 
 	irq = platform_get_irq(pdev, 0);
 	if (irq < 0) {
@@ -629,7 +942,7 @@ static int vf610_adc_probe(struct platform_device *pdev)
 
 	ret = devm_request_irq(info->dev, irq,
 				vf610_adc_isr, 0,
-				dev_name(&pdev->dev), info);
+				dev_name(&pdev->dev), indio_dev);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "failed requesting irq, irq = %d\n", irq);
 		return ret;
@@ -658,17 +971,50 @@ static int vf610_adc_probe(struct platform_device *pdev)
 
 	ret  = of_property_read_u32(pdev->dev.of_node,
 					"num-channels", &channels);
-	if (ret)
+	if (ret || channels > ARRAY_SIZE(vf610_adc_iio_channels))
 		channels = ARRAY_SIZE(vf610_adc_iio_channels);
 
+	/*
+	 * With a DMA channel, a single channel is streamed into the block
+	 * buffer; otherwise scans go through the kfifo.
+	 */
+	INIT_LIST_HEAD(&info->dma_active);
+	spin_lock_init(&info->dma_lock);
+	info->dma_chan = dma_request_slave_channel(&pdev->dev, "rx");
+	if (info->dma_chan) {
+		info->dma_buffer = iio_dma_buffer_alloc(
+				info->dma_chan->device->dev,
+				&vf610_adc_dma_buffer_ops, indio_dev);
+		if (IS_ERR(info->dma_buffer)) {
+			info->dma_buffer = NULL;
+			dma_release_channel(info->dma_chan);
+			info->dma_chan = NULL;
+		}
+	}
+
+	/* the timestamp follows whatever subset of channels is exposed */
+	chans = devm_kcalloc(&pdev->dev, channels + 1, sizeof(*chans),
+			     GFP_KERNEL);
+	if (!chans) {
+		ret = -ENOMEM;
+		goto error_adc_clk_enable;
+	}
+	memcpy(chans, vf610_adc_iio_channels, channels * sizeof(*chans));
+
 	indio_dev->name = dev_name(&pdev->dev);
 	indio_dev->dev.parent = &pdev->dev;
 	indio_dev->dev.of_node = pdev->dev.of_node;
 	indio_dev->info = &vf610_adc_iio_info;
 	indio_dev->modes = INDIO_DIRECT_MODE;
-	indio_dev->channels = vf610_adc_iio_channels;
+	indio_dev->channels = chans;
 	indio_dev->num_channels = (int)channels;
 
+	/* DMA blocks hold raw samples, stamped once per block */
+	if (!info->dma_buffer) {
+		chans[channels] = vf610_adc_timestamp_chan;
+		indio_dev->num_channels++;
+	}
+
 	ret = clk_prepare_enable(info->clk);
 	if (ret) {
 		dev_err(&pdev->dev,
@@ -679,18 +1025,39 @@ static int vf610_adc_probe(struct platform_device *pdev)
 	vf610_adc_cfg_init(info);
 	vf610_adc_hw_init(info);
 
+	if (info->dma_buffer) {
+		iio_device_attach_buffer(indio_dev, info->dma_buffer);
+		indio_dev->modes |= INDIO_BUFFER_HARDWARE;
+		indio_dev->setup_ops = &vf610_adc_dma_setup_ops;
+	} else {
+		ret = iio_triggered_buffer_setup(indio_dev,
+						 &iio_pollfunc_store_time,
+						 &vf610_adc_trigger_handler,
+						 &vf610_adc_buffer_ops);
+		if (ret < 0) {
+			dev_err(&pdev->dev, "Couldn't initialise the buffer\n");
+			goto error_iio_device_register;
+		}
+
+		/* Without a trigger the buffer runs in continuous mode */
+		indio_dev->modes |= INDIO_BUFFER_SOFTWARE;
+	}
+
 	ret = iio_device_register(indio_dev);
 	if (ret) {
 		dev_err(&pdev->dev, "Couldn't register the device.\n");
-		goto error_iio_device_register;
+		goto error_buffer_cleanup;
 	}
 
 	return 0;
 
-
+error_buffer_cleanup:
+	if (!info->dma_buffer)
+		iio_triggered_buffer_cleanup(indio_dev);
 error_iio_device_register:
 	clk_disable_unprepare(info->clk);
 error_adc_clk_enable:
+	vf610_adc_free_dma(info);
 	regulator_disable(info->vref);
 
 	return ret;
@@ -702,6 +1069,9 @@ static int vf610_adc_remove(struct platform_device *pdev)
 	struct vf610_adc *info = iio_priv(indio_dev);
 
 	iio_device_unregister(indio_dev);
+	if (!info->dma_buffer)
+		iio_triggered_buffer_cleanup(indio_dev);
+	vf610_adc_free_dma(info);
 	regulator_disable(info->vref);
 	clk_disable_unprepare(info->clk);
 
@@ -0,0 +1,681 @@
+/*
+ * Block based DMA buffer for the industrial I/O subsystem
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * The buffer is made of blocks of coherent memory which the driver fills by
+ * DMA. Userspace allocates them with IIO_BLOCK_ALLOC_IOCTL, maps them with
+ * mmap() and passes them back and forth with the enqueue and dequeue ioctls,
+ * so samples are never copied. If no blocks have been allocated when the
+ * buffer is enabled, two blocks are set up internally and the data is
+ * copied out through read() as with any other IIO buffer.
+ */
+
+#include <linux/slab.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/dma-mapping.h>
+#include <linux/uaccess.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/buffer-dma.h>
+
+/* Upper bounds for a single allocation request */
+#define IIO_DMA_BUFFER_MAX_BLOCKS	64
+#define IIO_DMA_BUFFER_MAX_BLOCK_SIZE	(16 * 1024 * 1024)
+
+/* Blocks used for read() access when userspace did not allocate any */
+#define IIO_DMA_BUFFER_FILEIO_BLOCKS	2
+
+/* Default number of datums shared by the read() blocks */
+#define IIO_DMA_BUFFER_DEFAULT_LENGTH	4096
+
+static void iio_dma_buffer_block_release(struct kref *kref)
+{
+	struct iio_dma_buffer_block *block =
+		container_of(kref, struct iio_dma_buffer_block, kref);
+
+	dma_free_coherent(block->dev, block->size, block->vaddr,
+			  block->phys_addr);
+	put_device(block->dev);
+	kfree(block);
+}
+
+static void iio_dma_buffer_block_put(struct iio_dma_buffer_block *block)
+{
+	kref_put(&block->kref, iio_dma_buffer_block_release);
+}
+
+static struct iio_dma_buffer_block *
+iio_dma_buffer_alloc_block(struct iio_dma_buffer_queue *queue, size_t size)
+{
+	struct iio_dma_buffer_block *block;
+
+	block = kzalloc(sizeof(*block), GFP_KERNEL);
+	if (!block)
+		return NULL;
+
+	block->size = PAGE_ALIGN(size);
+	block->vaddr = dma_alloc_coherent(queue->dev, block->size,
+					  &block->phys_addr, GFP_KERNEL);
+	if (!block->vaddr) {
+		kfree(block);
+		return NULL;
+	}
+
+	block->dev = get_device(queue->dev);
+	block->queue = queue;
+	block->block.size = size;
+	block->state = IIO_BLOCK_STATE_DEQUEUED;
+	INIT_LIST_HEAD(&block->head);
+	kref_init(&block->kref);
+
+	return block;
+}
+
+/* Must be called with the queue lock held and the buffer disabled */
+static void iio_dma_buffer_free_blocks(struct iio_dma_buffer_queue *queue)
+{
+	unsigned int i;
+
+	INIT_LIST_HEAD(&queue->incoming);
+	INIT_LIST_HEAD(&queue->outgoing);
+
+	for (i = 0; i < queue->num_blocks; i++) {
+		/* mappings keep the memory until they go away */
+		queue->blocks[i]->queue = NULL;
+		iio_dma_buffer_block_put(queue->blocks[i]);
+	}
+
+	kfree(queue->blocks);
+	queue->blocks = NULL;
+	queue->num_blocks = 0;
+	queue->fileio = false;
+	queue->fileio_pos = 0;
+}
+
+static int iio_dma_buffer_alloc_blocks_locked(struct iio_dma_buffer_queue *queue,
+					      size_t size, unsigned int count)
+{
+	struct iio_dma_buffer_block **blocks;
+	unsigned int i;
+
+	blocks = kcalloc(count, sizeof(*blocks), GFP_KERNEL);
+	if (!blocks)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		blocks[i] = iio_dma_buffer_alloc_block(queue, size);
+		if (!blocks[i])
+			break;
+
+		blocks[i]->block.id = i;
+		blocks[i]->block.data.offset = blocks[i]->size * i;
+	}
+
+	if (!i) {
+		kfree(blocks);
+		return -ENOMEM;
+	}
+
+	queue->blocks = blocks;
+	queue->num_blocks = i;
+
+	return 0;
+}
+
+/**
+ * iio_dma_buffer_block_done() - hand a filled block back to the queue
+ * @block: the block, with bytes_used set to the amount of valid data
+ *
+ * May be called from any context, usually the DMA completion callback.
+ */
+void iio_dma_buffer_block_done(struct iio_dma_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = block->queue;
+	unsigned long flags;
+
+	spin_lock_irqsave(&queue->list_lock, flags);
+	block->state = IIO_BLOCK_STATE_DONE;
+	list_add_tail(&block->head, &queue->outgoing);
+	spin_unlock_irqrestore(&queue->list_lock, flags);
+
+	wake_up_interruptible_poll(&queue->buffer.pollq, POLLIN | POLLRDNORM);
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_block_done);
+
+/**
+ * iio_dma_buffer_block_list_abort() - give back blocks whose transfer stopped
+ * @queue: the queue the blocks belong to
+ * @list: list of blocks, linked through their head member
+ *
+ * The blocks are returned empty and the list is left empty.
+ */
+void iio_dma_buffer_block_list_abort(struct iio_dma_buffer_queue *queue,
+				     struct list_head *list)
+{
+	struct iio_dma_buffer_block *block, *_block;
+
+	list_for_each_entry_safe(block, _block, list, head) {
+		list_del(&block->head);
+		block->block.bytes_used = 0;
+		block->block.flags = 0;
+		iio_dma_buffer_block_done(block);
+	}
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_block_list_abort);
+
+/* Must be called with the queue lock held */
+static int iio_dma_buffer_submit_block(struct iio_dma_buffer_queue *queue,
+				       struct iio_dma_buffer_block *block)
+{
+	int ret;
+
+	if (!queue->ops)
+		return -ENODEV;
+
+	block->state = IIO_BLOCK_STATE_ACTIVE;
+	block->block.bytes_used = block->block.size;
+	block->block.flags = 0;
+
+	ret = queue->ops->submit(queue, block);
+	if (ret)
+		block->state = IIO_BLOCK_STATE_DEQUEUED;
+
+	return ret;
+}
+
+/* Must be called with the queue lock held */
+static int iio_dma_buffer_queue_block(struct iio_dma_buffer_queue *queue,
+				      struct iio_dma_buffer_block *block)
+{
+	if (queue->active)
+		return iio_dma_buffer_submit_block(queue, block);
+
+	block->state = IIO_BLOCK_STATE_QUEUED;
+	list_add_tail(&block->head, &queue->incoming);
+
+	return 0;
+}
+
+static int iio_dma_buffer_fileio_alloc(struct iio_dma_buffer_queue *queue)
+{
+	size_t size;
+	unsigned int i;
+	int ret;
+
+	size = queue->buffer.bytes_per_datum * queue->buffer.length /
+		IIO_DMA_BUFFER_FILEIO_BLOCKS;
+	if (!size)
+		return -EINVAL;
+
+	ret = iio_dma_buffer_alloc_blocks_locked(queue, size,
+						 IIO_DMA_BUFFER_FILEIO_BLOCKS);
+	if (ret)
+		return ret;
+
+	queue->fileio = true;
+	for (i = 0; i < queue->num_blocks; i++) {
+		queue->blocks[i]->state = IIO_BLOCK_STATE_QUEUED;
+		list_add_tail(&queue->blocks[i]->head, &queue->incoming);
+	}
+
+	return 0;
+}
+
+/**
+ * iio_dma_buffer_enable() - start filling the queued blocks
+ * @buffer: the DMA buffer
+ * @indio_dev: the device the buffer is attached to
+ *
+ * To be called from the driver's postenable callback.
+ */
+int iio_dma_buffer_enable(struct iio_buffer *buffer,
+			  struct iio_dev *indio_dev)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block, *_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (!queue->num_blocks) {
+		ret = iio_dma_buffer_fileio_alloc(queue);
+		if (ret)
+			goto out_unlock;
+	}
+
+	queue->active = true;
+	list_for_each_entry_safe(block, _block, &queue->incoming, head) {
+		list_del_init(&block->head);
+		ret = iio_dma_buffer_submit_block(queue, block);
+		if (ret)
+			break;
+	}
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_enable);
+
+/**
+ * iio_dma_buffer_disable() - stop filling blocks
+ * @buffer: the DMA buffer
+ * @indio_dev: the device the buffer is attached to
+ *
+ * To be called from the driver's predisable callback. Blocks being filled
+ * are given back empty; internal read() blocks are freed.
+ */
+int iio_dma_buffer_disable(struct iio_buffer *buffer,
+			   struct iio_dev *indio_dev)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+
+	mutex_lock(&queue->lock);
+
+	queue->active = false;
+	if (queue->ops && queue->ops->abort)
+		queue->ops->abort(queue);
+
+	if (queue->fileio)
+		iio_dma_buffer_free_blocks(queue);
+
+	mutex_unlock(&queue->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_disable);
+
+static int iio_dma_buffer_alloc_blocks(struct iio_buffer *buffer,
+				       struct iio_buffer_block_alloc_req *req)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	int ret;
+
+	if (req->type || !req->count || !req->size ||
+	    req->size > IIO_DMA_BUFFER_MAX_BLOCK_SIZE)
+		return -EINVAL;
+
+	if (buffer->bytes_per_datum && req->size % buffer->bytes_per_datum)
+		return -EINVAL;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->num_blocks) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	ret = iio_dma_buffer_alloc_blocks_locked(queue, req->size,
+			min_t(u32, req->count, IIO_DMA_BUFFER_MAX_BLOCKS));
+	if (ret)
+		goto out_unlock;
+
+	req->count = queue->num_blocks;
+	req->id = 0;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+
+static int iio_dma_buffer_free_blocks_ioctl(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+
+	mutex_lock(&queue->lock);
+	iio_dma_buffer_free_blocks(queue);
+	mutex_unlock(&queue->lock);
+
+	return 0;
+}
+
+static int iio_dma_buffer_query_block(struct iio_buffer *buffer,
+				      struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->fileio || block->id >= queue->num_blocks)
+		ret = -EINVAL;
+	else
+		*block = queue->blocks[block->id]->block;
+
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+
+static int iio_dma_buffer_enqueue_block(struct iio_buffer *buffer,
+					struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->fileio || block->id >= queue->num_blocks) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	dma_block = queue->blocks[block->id];
+	if (dma_block->state != IIO_BLOCK_STATE_DEQUEUED) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	ret = iio_dma_buffer_queue_block(queue, dma_block);
+	if (!ret)
+		*block = dma_block->block;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+
+static int iio_dma_buffer_dequeue_block(struct iio_buffer *buffer,
+					struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->fileio) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	spin_lock_irq(&queue->list_lock);
+	dma_block = list_first_entry_or_null(&queue->outgoing,
+					     struct iio_dma_buffer_block, head);
+	if (dma_block) {
+		list_del_init(&dma_block->head);
+		dma_block->state = IIO_BLOCK_STATE_DEQUEUED;
+	}
+	spin_unlock_irq(&queue->list_lock);
+
+	if (dma_block)
+		*block = dma_block->block;
+	else
+		ret = -EAGAIN;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+
+static void iio_dma_buffer_vm_open(struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_block *block = vma->vm_private_data;
+
+	kref_get(&block->kref);
+}
+
+static void iio_dma_buffer_vm_close(struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_block *block = vma->vm_private_data;
+
+	iio_dma_buffer_block_put(block);
+}
+
+static const struct vm_operations_struct iio_dma_buffer_vm_ops = {
+	.open = iio_dma_buffer_vm_open,
+	.close = iio_dma_buffer_vm_close,
+};
+
+static int iio_dma_buffer_mmap(struct iio_buffer *buffer,
+			       struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+	struct iio_dma_buffer_block *block = NULL;
+	unsigned int i;
+	int ret;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->fileio) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	for (i = 0; i < queue->num_blocks; i++) {
+		if (queue->blocks[i]->block.data.offset == offset) {
+			block = queue->blocks[i];
+			break;
+		}
+	}
+
+	if (!block || vma->vm_end - vma->vm_start > block->size) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	/* the offset only selects the block */
+	vma->vm_pgoff = 0;
+	ret = dma_mmap_coherent(block->dev, vma, block->vaddr,
+				block->phys_addr, vma->vm_end - vma->vm_start);
+	if (ret)
+		goto out_unlock;
+
+	vma->vm_ops = &iio_dma_buffer_vm_ops;
+	vma->vm_private_data = block;
+	kref_get(&block->kref);
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+
+static int iio_dma_buffer_read(struct iio_buffer *buffer, size_t n,
+			       char __user *user_buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block;
+	size_t avail;
+	int ret;
+
+	if (n < buffer->bytes_per_datum)
+		return -EINVAL;
+
+	mutex_lock(&queue->lock);
+
+	if (!queue->fileio) {
+		ret = queue->num_blocks ? -EBUSY : 0;
+		goto out_unlock;
+	}
+
+	spin_lock_irq(&queue->list_lock);
+	block = list_first_entry_or_null(&queue->outgoing,
+					 struct iio_dma_buffer_block, head);
+	spin_unlock_irq(&queue->list_lock);
+	if (!block) {
+		ret = 0;
+		goto out_unlock;
+	}
+
+	n = rounddown(n, buffer->bytes_per_datum);
+	avail = block->block.bytes_used - queue->fileio_pos;
+	if (n > avail)
+		n = avail;
+
+	if (copy_to_user(user_buffer, block->vaddr + queue->fileio_pos, n)) {
+		ret = -EFAULT;
+		goto out_unlock;
+	}
+
+	queue->fileio_pos += n;
+	if (queue->fileio_pos == block->block.bytes_used) {
+		queue->fileio_pos = 0;
+
+		spin_lock_irq(&queue->list_lock);
+		list_del_init(&block->head);
+		spin_unlock_irq(&queue->list_lock);
+
+		ret = iio_dma_buffer_queue_block(queue, block);
+		if (ret)
+			goto out_unlock;
+	}
+
+	ret = n;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+
+/*
+ * With mmap based access the unit is a block, so that poll() and the
+ * dequeue ioctl also report blocks given back empty by an abort.
+ */
+static size_t iio_dma_buffer_data_available(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block;
+	size_t bytes = 0, count = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&queue->list_lock, flags);
+	list_for_each_entry(block, &queue->outgoing, head) {
+		bytes += block->block.bytes_used;
+		count++;
+	}
+	spin_unlock_irqrestore(&queue->list_lock, flags);
+
+	if (!queue->fileio || !buffer->bytes_per_datum)
+		return count;
+
+	return (bytes - queue->fileio_pos) / buffer->bytes_per_datum;
+}
+
+static int iio_dma_buffer_store_to(struct iio_buffer *buffer, const void *data)
+{
+	/* samples only ever arrive by DMA */
+	return -EINVAL;
+}
+
+static int iio_dma_buffer_set_bytes_per_datum(struct iio_buffer *buffer,
+					      size_t bpd)
+{
+	buffer->bytes_per_datum = bpd;
+
+	return 0;
+}
+
+static int iio_dma_buffer_set_length(struct iio_buffer *buffer, int length)
+{
+	/* a read() block must hold at least one datum */
+	if (length < IIO_DMA_BUFFER_FILEIO_BLOCKS)
+		length = IIO_DMA_BUFFER_FILEIO_BLOCKS;
+	buffer->length = length;
+
+	return 0;
+}
+
+static void iio_dma_buffer_release(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+
+	mutex_lock(&queue->lock);
+	iio_dma_buffer_free_blocks(queue);
+	mutex_unlock(&queue->lock);
+
+	mutex_destroy(&queue->lock);
+	kfree(queue);
+}
+
+static const struct iio_buffer_access_funcs iio_dma_buffer_access_funcs = {
+	.store_to = iio_dma_buffer_store_to,
+	.read_first_n = iio_dma_buffer_read,
+	.data_available = iio_dma_buffer_data_available,
+	.set_bytes_per_datum = iio_dma_buffer_set_bytes_per_datum,
+	.set_length = iio_dma_buffer_set_length,
+	.release = iio_dma_buffer_release,
+
+	.alloc_blocks = iio_dma_buffer_alloc_blocks,
+	.free_blocks = iio_dma_buffer_free_blocks_ioctl,
+	.query_block = iio_dma_buffer_query_block,
+	.enqueue_block = iio_dma_buffer_enqueue_block,
+	.dequeue_block = iio_dma_buffer_dequeue_block,
+	.mmap = iio_dma_buffer_mmap,
+};
+
+/**
+ * iio_dma_buffer_alloc() - allocate a DMA buffer
+ * @dev: device the block memory is allocated for, usually the DMA
+ *	 controller
+ * @ops: driver callbacks
+ * @driver_data: driver private data, stored in the queue
+ *
+ * Returns the buffer, to be attached with iio_device_attach_buffer(), or
+ * an ERR_PTR on failure.
+ */
+struct iio_buffer *iio_dma_buffer_alloc(struct device *dev,
+					const struct iio_dma_buffer_ops *ops,
+					void *driver_data)
+{
+	struct iio_dma_buffer_queue *queue;
+
+	queue = kzalloc(sizeof(*queue), GFP_KERNEL);
+	if (!queue)
+		return ERR_PTR(-ENOMEM);
+
+	iio_buffer_init(&queue->buffer);
+	queue->buffer.access = &iio_dma_buffer_access_funcs;
+	queue->buffer.length = IIO_DMA_BUFFER_DEFAULT_LENGTH;
+
+	queue->dev = dev;
+	queue->ops = ops;
+	queue->driver_data = driver_data;
+
+	mutex_init(&queue->lock);
+	spin_lock_init(&queue->list_lock);
+	INIT_LIST_HEAD(&queue->incoming);
+	INIT_LIST_HEAD(&queue->outgoing);
+
+	return &queue->buffer;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_alloc);
+
+/**
+ * iio_dma_buffer_free() - release a DMA buffer
+ * @buffer: buffer returned by iio_dma_buffer_alloc()
+ *
+ * Detaches the driver from the buffer, which is freed once the last
+ * reference to it is gone. Must be called before the DMA channel is
+ * released.
+ */
+void iio_dma_buffer_free(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+
+	mutex_lock(&queue->lock);
+	queue->ops = NULL;
+	iio_dma_buffer_free_blocks(queue);
+	mutex_unlock(&queue->lock);
+
+	iio_buffer_put(buffer);
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_free);
+
+MODULE_DESCRIPTION("Block based DMA buffer for IIO");
+MODULE_LICENSE("GPL v2");
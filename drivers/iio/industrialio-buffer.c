@@ -21,6 +21,8 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/uaccess.h>
 
 #include <linux/iio/iio.h>
 #include "iio_core.h"
@@ -159,6 +161,109 @@ unsigned int iio_buffer_poll(struct file *filp,
 	return 0;
 }
 
+/**
+ * iio_buffer_ioctl() - block based buffer access ioctls
+ *
+ * Blocks can only be allocated or freed while the buffer is disabled.
+ * Dequeueing waits for a filled block unless the file is non-blocking.
+ */
+long iio_buffer_ioctl(struct iio_dev *indio_dev, struct file *filp,
+		      unsigned int cmd, unsigned long arg)
+{
+	struct iio_buffer *rb = indio_dev->buffer;
+	void __user *user = (void __user *)arg;
+	struct iio_buffer_block_alloc_req req;
+	struct iio_buffer_block block;
+	int ret;
+
+	if (!rb || !rb->access->alloc_blocks)
+		return -EINVAL;
+
+	switch (cmd) {
+	case IIO_BLOCK_ALLOC_IOCTL:
+		if (copy_from_user(&req, user, sizeof(req)))
+			return -EFAULT;
+
+		mutex_lock(&indio_dev->mlock);
+		if (iio_buffer_is_active(rb))
+			ret = -EBUSY;
+		else
+			ret = rb->access->alloc_blocks(rb, &req);
+		mutex_unlock(&indio_dev->mlock);
+		if (ret)
+			return ret;
+
+		if (copy_to_user(user, &req, sizeof(req)))
+			return -EFAULT;
+		return 0;
+	case IIO_BLOCK_FREE_IOCTL:
+		mutex_lock(&indio_dev->mlock);
+		if (iio_buffer_is_active(rb))
+			ret = -EBUSY;
+		else
+			ret = rb->access->free_blocks(rb);
+		mutex_unlock(&indio_dev->mlock);
+		return ret;
+	case IIO_BLOCK_QUERY_IOCTL:
+	case IIO_BLOCK_ENQUEUE_IOCTL:
+		if (copy_from_user(&block, user, sizeof(block)))
+			return -EFAULT;
+
+		if (cmd == IIO_BLOCK_QUERY_IOCTL)
+			ret = rb->access->query_block(rb, &block);
+		else
+			ret = rb->access->enqueue_block(rb, &block);
+		if (ret)
+			return ret;
+
+		if (copy_to_user(user, &block, sizeof(block)))
+			return -EFAULT;
+		return 0;
+	case IIO_BLOCK_DEQUEUE_IOCTL:
+		do {
+			if (!(filp->f_flags & O_NONBLOCK)) {
+				ret = wait_event_interruptible(rb->pollq,
+					iio_buffer_ready(indio_dev, rb, 1, 0));
+				if (ret)
+					return ret;
+			}
+
+			if (!indio_dev->info)
+				return -ENODEV;
+
+			ret = rb->access->dequeue_block(rb, &block);
+		} while (ret == -EAGAIN && !(filp->f_flags & O_NONBLOCK));
+		if (ret)
+			return ret;
+
+		if (copy_to_user(user, &block, sizeof(block)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * iio_buffer_mmap() - map a buffer block into userspace
+ */
+int iio_buffer_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct iio_dev *indio_dev = filp->private_data;
+	struct iio_buffer *rb = indio_dev->buffer;
+
+	if (!indio_dev->info)
+		return -ENODEV;
+
+	if (!rb || !rb->access->mmap)
+		return -EINVAL;
+
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	return rb->access->mmap(rb, vma);
+}
+
 /**
  * iio_buffer_wakeup_poll - Wakes up the buffer waitqueue
  * @indio_dev: The IIO device
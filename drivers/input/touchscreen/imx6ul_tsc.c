@@ -21,6 +21,7 @@
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 
 /* ADC configuration registers field define */
 #define ADC_AIEN		(0x1 << 7)
@@ -32,6 +33,9 @@
 #define ADC_CLK_DIV_8		(0x03 << 5)
 #define ADC_SHORT_SAMPLE_MODE	(0x0 << 4)
 #define ADC_HARDWARE_TRIGGER	(0x1 << 13)
+#define ADC_AVGS_SHIFT		14
+#define ADC_AVGS_MASK		(0x3 << 14)
+#define ADC_AVGE		(0x1 << 5)
 #define SELECT_CHANNEL_4	0x04
 #define SELECT_CHANNEL_1	0x01
 #define DISABLE_CONVERSION_INT	(0x0 << 7)
@@ -86,6 +90,12 @@ struct imx6ul_tsc {
 
 	int measure_delay_time;
 	int pre_charge_time;
+	/* 0 when hardware averaging is off, else log2(samples) - 2 */
+	int average_select;
+	bool average_enable;
+	/* minimum time between two reported measurements, 0 for none */
+	u32 report_interval_us;
+	ktime_t last_report;
 
 	struct completion completion;
 };
@@ -107,7 +117,8 @@ static void imx6ul_adc_init(struct imx6ul_tsc *tsc)
 	adc_cfg = readl(tsc->adc_regs + REG_ADC_CFG);
 	adc_cfg |= ADC_12BIT_MODE | ADC_IPG_CLK;
 	adc_cfg |= ADC_CLK_DIV_8 | ADC_SHORT_SAMPLE_MODE;
-	adc_cfg &= ~ADC_HARDWARE_TRIGGER;
+	adc_cfg &= ~(ADC_HARDWARE_TRIGGER | ADC_AVGS_MASK);
+	adc_cfg |= tsc->average_select << ADC_AVGS_SHIFT;
 	writel(adc_cfg, tsc->adc_regs + REG_ADC_CFG);
 
 	/* enable calibration interrupt */
@@ -115,8 +126,11 @@ static void imx6ul_adc_init(struct imx6ul_tsc *tsc)
 	adc_hc |= ADC_CONV_DISABLE;
 	writel(adc_hc, tsc->adc_regs + REG_ADC_HC0);
 
-	/* start ADC calibration */
+	/* start ADC calibration, averaging also applies to it */
 	adc_gc = readl(tsc->adc_regs + REG_ADC_GC);
+	adc_gc &= ~ADC_AVGE;
+	if (tsc->average_enable)
+		adc_gc |= ADC_AVGE;
 	adc_gc |= ADC_CAL;
 	writel(adc_gc, tsc->adc_regs + REG_ADC_GC);
 
@@ -231,6 +245,26 @@ static bool tsc_wait_detect_mode(struct imx6ul_tsc *tsc)
 	return true;
 }
 
+/*
+ * Hold the threaded handler, and so the interrupt line, until the report
+ * interval is over. Measurements completing meanwhile are merged into one
+ * interrupt and only the latest position gets reported.
+ */
+static void tsc_limit_report_rate(struct imx6ul_tsc *tsc)
+{
+	s64 elapsed;
+
+	if (!tsc->report_interval_us)
+		return;
+
+	elapsed = ktime_us_delta(ktime_get(), tsc->last_report);
+	if (elapsed >= 0 && elapsed < tsc->report_interval_us)
+		usleep_range(tsc->report_interval_us - elapsed,
+			     tsc->report_interval_us - elapsed + 500);
+
+	tsc->last_report = ktime_get();
+}
+
 static irqreturn_t tsc_irq_fn(int irq, void *dev_id)
 {
 	struct imx6ul_tsc *tsc = dev_id;
@@ -264,11 +298,13 @@ static irqreturn_t tsc_irq_fn(int irq, void *dev_id)
 			input_report_key(tsc->input, BTN_TOUCH, 1);
 			input_report_abs(tsc->input, ABS_X, x);
 			input_report_abs(tsc->input, ABS_Y, y);
+			input_sync(tsc->input);
+
+			tsc_limit_report_rate(tsc);
 		} else {
 			input_report_key(tsc->input, BTN_TOUCH, 0);
+			input_sync(tsc->input);
 		}
-
-		input_sync(tsc->input);
 	}
 
 	return IRQ_HANDLED;
@@ -336,6 +372,9 @@ static int imx6ul_tsc_probe(struct platform_device *pdev)
 	int err;
 	int tsc_irq;
 	int adc_irq;
+	u32 average_samples;
+	u32 report_rate;
+	u32 fuzz_x = 0, fuzz_y = 0;
 
 	tsc = devm_kzalloc(&pdev->dev, sizeof(struct imx6ul_tsc), GFP_KERNEL);
 	if (!tsc)
@@ -351,9 +390,13 @@ static int imx6ul_tsc_probe(struct platform_device *pdev)
 	input_dev->open = imx6ul_tsc_open;
 	input_dev->close = imx6ul_tsc_close;
 
+	/* movements within the fuzz are dropped by the input core */
+	of_property_read_u32(np, "touchscreen-fuzz-x", &fuzz_x);
+	of_property_read_u32(np, "touchscreen-fuzz-y", &fuzz_y);
+
 	input_set_capability(input_dev, EV_KEY, BTN_TOUCH);
-	input_set_abs_params(input_dev, ABS_X, 0, 0xFFF, 0, 0);
-	input_set_abs_params(input_dev, ABS_Y, 0, 0xFFF, 0, 0);
+	input_set_abs_params(input_dev, ABS_X, 0, 0xFFF, fuzz_x, 0);
+	input_set_abs_params(input_dev, ABS_Y, 0, 0xFFF, fuzz_y, 0);
 
 	input_set_drvdata(input_dev, tsc);
 
@@ -440,6 +483,34 @@ static int imx6ul_tsc_probe(struct platform_device *pdev)
 	if (err)
 		tsc->pre_charge_time = 0xfff;
 
+	err = of_property_read_u32(np, "touchscreen-average-samples",
+				   &average_samples);
+	if (err)
+		average_samples = 1;
+
+	switch (average_samples) {
+	case 1:
+		tsc->average_enable = false;
+		tsc->average_select = 0;
+		break;
+	case 4:
+	case 8:
+	case 16:
+	case 32:
+		tsc->average_enable = true;
+		tsc->average_select = ilog2(average_samples) - 2;
+		break;
+	default:
+		dev_err(&pdev->dev,
+			"touchscreen-average-samples (%u) must be 1, 4, 8, 16 or 32\n",
+			average_samples);
+		return -EINVAL;
+	}
+
+	err = of_property_read_u32(np, "report-rate", &report_rate);
+	if (!err && report_rate)
+		tsc->report_interval_us = USEC_PER_SEC / report_rate;
+
 	err = input_register_device(tsc->input);
 	if (err) {
 		dev_err(&pdev->dev,
@@ -21,6 +21,8 @@
 #include <asm/dma.h>
 #include <linux/busfreq-imx.h>
 #include <linux/clk.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/delay.h>
 #include <linux/device.h>
@@ -41,6 +43,7 @@
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/time.h>
 #include <linux/media-bus-format.h>
@@ -59,6 +62,14 @@
 
 #define MAX_VIDEO_MEM 64
 
+/* buffers held back by the driver in deep buffering mode */
+#define MX6S_DEEP_BUFS	4
+
+static bool deep_buffering;
+module_param(deep_buffering, bool, 0644);
+MODULE_PARM_DESC(deep_buffering,
+	"Keep spare buffers queued ahead of the CSI DMA to hide IRQ latency");
+
 /* reset values */
 #define CSICR1_RESET_VAL	0x40000800
 #define CSICR2_RESET_VAL	0x0
@@ -295,6 +306,20 @@ struct mx6s_csi_mux {
 	u8 req_bit;
 };
 
+struct mx6s_csi_stats {
+	u32 frames;
+	u32 dropped_nobuf;
+	u32 rxfifo_overflow;
+	u32 hresp_err;
+	u32 addr_change_err;
+	u32 base_addr_mismatch;
+	u32 both_done_skip;
+	u32 irq_time_max_us;
+	u32 frame_interval_us;
+	u32 frame_interval_max_us;
+	ktime_t last_done;
+};
+
 struct mx6s_csi_dev {
 	struct device		*dev;
 	struct video_device *vdev;
@@ -307,6 +332,8 @@ struct mx6s_csi_dev {
 
 	struct mutex		lock;
 	spinlock_t			slock;
+	/* the bus runs in high mode, as requested at open */
+	struct completion	bus_freq_done;
 
 	/* clock */
 	struct clk	*clk_disp_axi;
@@ -340,6 +367,9 @@ struct mx6s_csi_dev {
 
 	bool csi_mux_mipi;
 	struct mx6s_csi_mux csi_mux;
+
+	struct mx6s_csi_stats	stats;
+	struct dentry		*debugfs_dir;
 };
 
 static inline int csi_read(struct mx6s_csi_dev *csi, unsigned int offset)
@@ -651,9 +681,12 @@ static int mx6s_videobuf_prepare(struct vb2_buffer *vb)
 		       0xaa, vb2_get_plane_payload(vb, 0));
 #endif
 
+	/*
+	 * USERPTR and DMABUF planes have no kernel mapping, check their
+	 * size anyway: the CSI writes a whole frame into them.
+	 */
 	vb2_set_plane_payload(vb, 0, csi_dev->pix.sizeimage);
-	if (vb2_plane_vaddr(vb, 0) &&
-	    vb2_get_plane_payload(vb, 0) > vb2_plane_size(vb, 0)) {
+	if (vb2_get_plane_payload(vb, 0) > vb2_plane_size(vb, 0)) {
 		ret = -EINVAL;
 		goto out;
 	}
@@ -858,6 +891,11 @@ static int mx6s_start_streaming(struct vb2_queue *vq, unsigned int count)
 	if (count < 2)
 		return -ENOBUFS;
 
+	/* the CSI DMA needs the bandwidth of the high bus mode */
+	wait_for_completion(&csi_dev->bus_freq_done);
+
+	memset(&csi_dev->stats, 0, sizeof(csi_dev->stats));
+
 	/*
 	 * I didn't manage to properly enable/disable
 	 * a per frame basis during running transfers,
@@ -984,11 +1022,13 @@ static void mx6s_csi_frame_done(struct mx6s_csi_dev *csi_dev,
 		phys = vb2_dma_contig_plane_dma_addr(vb, 0);
 		if (bufnum == 1) {
 			if (csi_read(csi_dev, CSI_CSIDMASA_FB2) != phys) {
+				csi_dev->stats.base_addr_mismatch++;
 				dev_err(csi_dev->dev, "%lx != %x\n", phys,
 					csi_read(csi_dev, CSI_CSIDMASA_FB2));
 			}
 		} else {
 			if (csi_read(csi_dev, CSI_CSIDMASA_FB1) != phys) {
+				csi_dev->stats.base_addr_mismatch++;
 				dev_err(csi_dev->dev, "%lx != %x\n", phys,
 					csi_read(csi_dev, CSI_CSIDMASA_FB1));
 			}
@@ -1004,6 +1044,7 @@ static void mx6s_csi_frame_done(struct mx6s_csi_dev *csi_dev,
 			vb2_buffer_done(vb, VB2_BUF_STATE_ERROR);
 		else
 			vb2_buffer_done(vb, VB2_BUF_STATE_DONE);
+		csi_dev->stats.frames++;
 	}
 
 	csi_dev->frame_count++;
@@ -1020,6 +1061,7 @@ static void mx6s_csi_frame_done(struct mx6s_csi_dev *csi_dev,
 		ibuf = list_first_entry(&csi_dev->discard,
 					struct mx6s_buf_internal, queue);
 		ibuf->bufnum = bufnum;
+		csi_dev->stats.dropped_nobuf++;
 
 		list_move_tail(csi_dev->discard.next, &csi_dev->active_bufs);
 
@@ -1045,8 +1087,10 @@ static void mx6s_csi_frame_done(struct mx6s_csi_dev *csi_dev,
 static irqreturn_t mx6s_csi_irq_handler(int irq, void *data)
 {
 	struct mx6s_csi_dev *csi_dev =  data;
+	struct mx6s_csi_stats *stats = &csi_dev->stats;
 	unsigned long status;
-	u32 cr1, cr3, cr18;
+	ktime_t start = ktime_get();
+	u32 cr1, cr3, cr18, us;
 
 	spin_lock(&csi_dev->slock);
 
@@ -1062,11 +1106,15 @@ static irqreturn_t mx6s_csi_irq_handler(int irq, void *data)
 		return IRQ_HANDLED;
 	}
 
-	if (status & BIT_RFF_OR_INT)
+	if (status & BIT_RFF_OR_INT) {
+		stats->rxfifo_overflow++;
 		dev_warn(csi_dev->dev, "%s Rx fifo overflow\n", __func__);
-	if (status & BIT_HRESP_ERR_INT)
+	}
+	if (status & BIT_HRESP_ERR_INT) {
+		stats->hresp_err++;
 		dev_warn(csi_dev->dev, "%s Hresponse error detected\n",
 			__func__);
+	}
 
 	if (status & (BIT_RFF_OR_INT|BIT_HRESP_ERR_INT)) {
 		/* software reset */
@@ -1096,6 +1144,8 @@ static irqreturn_t mx6s_csi_irq_handler(int irq, void *data)
 	}
 
 	if (status & BIT_ADDR_CH_ERR_INT) {
+		stats->addr_change_err++;
+
 		/* Disable csi  */
 		cr18 = csi_read(csi_dev, CSI_CSICR18);
 		cr18 &= ~BIT_CSI_ENABLE;
@@ -1122,6 +1172,7 @@ static irqreturn_t mx6s_csi_irq_handler(int irq, void *data)
 		 * when csi work in field0 and field1 will write to
 		 * new base address.
 		 * PDM TKT230775 */
+		stats->both_done_skip++;
 		pr_debug("Skip two frames\n");
 	} else if (status & BIT_DMA_TSF_DONE_FB1) {
 		mx6s_csi_frame_done(csi_dev, 0, false);
@@ -1129,11 +1180,36 @@ static irqreturn_t mx6s_csi_irq_handler(int irq, void *data)
 		mx6s_csi_frame_done(csi_dev, 1, false);
 	}
 
+	/*
+	 * A DMA done interrupt serviced late shows up as a stretched
+	 * frame interval; two in a row collapse into the skip above.
+	 */
+	if (status & (BIT_DMA_TSF_DONE_FB1 | BIT_DMA_TSF_DONE_FB2)) {
+		if (stats->last_done.tv64) {
+			us = ktime_us_delta(start, stats->last_done);
+			stats->frame_interval_us = us;
+			if (us > stats->frame_interval_max_us)
+				stats->frame_interval_max_us = us;
+		}
+		stats->last_done = start;
+	}
+
+	us = ktime_us_delta(ktime_get(), start);
+	if (us > stats->irq_time_max_us)
+		stats->irq_time_max_us = us;
+
 	spin_unlock(&csi_dev->slock);
 
 	return IRQ_HANDLED;
 }
 
+static void mx6s_csi_bus_freq_done(void *data)
+{
+	struct mx6s_csi_dev *csi_dev = data;
+
+	complete_all(&csi_dev->bus_freq_done);
+}
+
 /*
  * File operations for the device
  */
@@ -1154,13 +1230,19 @@ static int mx6s_csi_open(struct file *file)
 		goto unlock;
 
 	q->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	q->io_modes = VB2_MMAP | VB2_USERPTR;
+	q->io_modes = VB2_MMAP | VB2_USERPTR | VB2_DMABUF;
 	q->drv_priv = csi_dev;
 	q->ops = &mx6s_videobuf_ops;
 	q->mem_ops = &vb2_dma_contig_memops;
 	q->buf_struct_size = sizeof(struct mx6s_buffer);
 	q->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
 	q->lock = &csi_dev->lock;
+	/*
+	 * In deep buffering mode streaming starts only once the two CSI base
+	 * addresses are loaded and spare buffers are waiting behind them, so
+	 * a late DMA done interrupt still finds a buffer to switch to.
+	 */
+	q->min_buffers_needed = deep_buffering ? MX6S_DEEP_BUFS : 2;
 
 	ret = vb2_queue_init(q);
 	if (ret < 0)
@@ -1168,7 +1250,17 @@ static int mx6s_csi_open(struct file *file)
 
 	pm_runtime_get_sync(csi_dev->dev);
 
-	request_bus_freq(BUS_FREQ_HIGH);
+	/*
+	 * Don't hold up open for the DDR frequency change, the sensor is
+	 * powered up meanwhile and streaming waits for it to be done.
+	 */
+	wait_for_completion(&csi_dev->bus_freq_done);
+	reinit_completion(&csi_dev->bus_freq_done);
+	if (request_bus_freq_async(BUS_FREQ_HIGH, mx6s_csi_bus_freq_done,
+				   csi_dev)) {
+		request_bus_freq(BUS_FREQ_HIGH);
+		complete_all(&csi_dev->bus_freq_done);
+	}
 
 	v4l2_subdev_call(sd, core, s_power, 1);
 	mx6s_csi_init(csi_dev);
@@ -1200,6 +1292,7 @@ static int mx6s_csi_close(struct file *file)
 
 	file->private_data = NULL;
 
+	wait_for_completion(&csi_dev->bus_freq_done);
 	release_bus_freq(BUS_FREQ_HIGH);
 
 	pm_runtime_put_sync_suspend(csi_dev->dev);
@@ -1324,7 +1417,7 @@ static int mx6s_vidioc_querybuf(struct file *file, void *priv,
 
 	ret = vb2_querybuf(&csi_dev->vb2_vidq, p);
 
-	if (!ret) {
+	if (!ret && p->memory == V4L2_MEMORY_MMAP) {
 		/* return physical address */
 		struct vb2_buffer *vb = csi_dev->vb2_vidq.bufs[p->index];
 		if (p->flags & V4L2_BUF_FLAG_MAPPED)
@@ -1333,6 +1426,16 @@ static int mx6s_vidioc_querybuf(struct file *file, void *priv,
 	return ret;
 }
 
+static int mx6s_vidioc_expbuf(struct file *file, void *priv,
+			      struct v4l2_exportbuffer *eb)
+{
+	struct mx6s_csi_dev *csi_dev = video_drvdata(file);
+
+	WARN_ON(priv != file->private_data);
+
+	return vb2_expbuf(&csi_dev->vb2_vidq, eb);
+}
+
 static int mx6s_vidioc_qbuf(struct file *file, void *priv,
 			   struct v4l2_buffer *p)
 {
@@ -1657,6 +1760,7 @@ static const struct v4l2_ioctl_ops mx6s_csi_ioctl_ops = {
 	.vidioc_querybuf      = mx6s_vidioc_querybuf,
 	.vidioc_qbuf          = mx6s_vidioc_qbuf,
 	.vidioc_dqbuf         = mx6s_vidioc_dqbuf,
+	.vidioc_expbuf        = mx6s_vidioc_expbuf,
 	.vidioc_g_std         = mx6s_vidioc_g_std,
 	.vidioc_s_std         = mx6s_vidioc_s_std,
 	.vidioc_querystd      = mx6s_vidioc_querystd,
@@ -1775,6 +1879,76 @@ static int mx6sx_register_subdevs(struct mx6s_csi_dev *csi_dev)
 	return ret;
 }
 
+static int mx6s_csi_stats_show(struct seq_file *m, void *v)
+{
+	struct mx6s_csi_dev *csi_dev = m->private;
+	struct mx6s_csi_stats stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&csi_dev->slock, flags);
+	stats = csi_dev->stats;
+	spin_unlock_irqrestore(&csi_dev->slock, flags);
+
+	seq_printf(m, "frames captured:       %u\n", stats.frames);
+	seq_printf(m, "dropped (no buffer):   %u\n", stats.dropped_nobuf);
+	seq_printf(m, "skipped (FB1+FB2):     %u\n", stats.both_done_skip);
+	seq_printf(m, "rx fifo overflow:      %u\n", stats.rxfifo_overflow);
+	seq_printf(m, "hresp error:           %u\n", stats.hresp_err);
+	seq_printf(m, "base addr change err:  %u\n", stats.addr_change_err);
+	seq_printf(m, "base addr mismatch:    %u\n",
+		   stats.base_addr_mismatch);
+	seq_printf(m, "frame interval (us):   %u\n", stats.frame_interval_us);
+	seq_printf(m, "max frame interval:    %u\n",
+		   stats.frame_interval_max_us);
+	seq_printf(m, "max irq time (us):     %u\n", stats.irq_time_max_us);
+	seq_printf(m, "deep buffering:        %s\n",
+		   csi_dev->vb2_vidq.min_buffers_needed > 2 ? "on" : "off");
+
+	return 0;
+}
+
+static int mx6s_csi_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mx6s_csi_stats_show, inode->i_private);
+}
+
+/* any write clears the counters */
+static ssize_t mx6s_csi_stats_write(struct file *file, const char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct mx6s_csi_dev *csi_dev = m->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&csi_dev->slock, flags);
+	memset(&csi_dev->stats, 0, sizeof(csi_dev->stats));
+	spin_unlock_irqrestore(&csi_dev->slock, flags);
+
+	return count;
+}
+
+static const struct file_operations mx6s_csi_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= mx6s_csi_stats_open,
+	.read		= seq_read,
+	.write		= mx6s_csi_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void mx6s_csi_debugfs_init(struct mx6s_csi_dev *csi_dev)
+{
+	csi_dev->debugfs_dir = debugfs_create_dir(dev_name(csi_dev->dev),
+						  NULL);
+	if (IS_ERR_OR_NULL(csi_dev->debugfs_dir)) {
+		csi_dev->debugfs_dir = NULL;
+		return;
+	}
+
+	debugfs_create_file("stats", S_IRUGO | S_IWUSR, csi_dev->debugfs_dir,
+			    csi_dev, &mx6s_csi_stats_fops);
+}
+
 static int mx6s_csi_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -1844,6 +2018,9 @@ static int mx6s_csi_probe(struct platform_device *pdev)
 	/* initialize locks */
 	mutex_init(&csi_dev->lock);
 	spin_lock_init(&csi_dev->slock);
+	init_completion(&csi_dev->bus_freq_done);
+	/* no request is in flight until the first open */
+	complete_all(&csi_dev->bus_freq_done);
 
 	/* Allocate memory for video device */
 	vdev = video_device_alloc();
@@ -1889,6 +2066,8 @@ static int mx6s_csi_probe(struct platform_device *pdev)
 	if (ret < 0)
 		goto err_irq;
 
+	mx6s_csi_debugfs_init(csi_dev);
+
 	pm_runtime_enable(csi_dev->dev);
 	return 0;
 
@@ -1905,6 +2084,7 @@ static int mx6s_csi_remove(struct platform_device *pdev)
 	struct mx6s_csi_dev *csi_dev =
 				container_of(v4l2_dev, struct mx6s_csi_dev, v4l2_dev);
 
+	debugfs_remove_recursive(csi_dev->debugfs_dir);
 	v4l2_async_notifier_unregister(&csi_dev->subdev_notifier);
 
 	video_unregister_device(csi_dev->vdev);
@@ -0,0 +1,1128 @@
+/*
+ * V4L2 mem2mem driver for the i.MX PxP (Pixel Pipeline).
+ *
+ * Copyright (C) 2015 Freescale Semiconductor, Inc.
+ *
+ * Based on m2m-deinterlace.c and vim2m.c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Each job is one PxP transaction per source/destination buffer pair,
+ * submitted through the PxP dmaengine channel; scaling, rotation, flip
+ * and color space conversion are then programmed by pxp_config() in the
+ * PxP DMA driver. All buffer pairs that are ready when a job starts are
+ * submitted as one batch and kicked off with a single issue_pending, so
+ * the PxP runs them back to back without waiting for the m2m core to
+ * schedule every frame.
+ */
+
+#include <linux/module.h>
+#include <linux/completion.h>
+#include <linux/slab.h>
+#include <linux/dmaengine.h>
+#include <linux/of.h>
+#include <linux/of_platform.h>
+#include <linux/platform_device.h>
+#include <linux/pxp_dma.h>
+#include <linux/workqueue.h>
+#include <linux/platform_data/dma-imx.h>
+
+#include <media/v4l2-common.h>
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-device.h>
+#include <media/v4l2-event.h>
+#include <media/v4l2-ioctl.h>
+#include <media/v4l2-mem2mem.h>
+#include <media/videobuf2-dma-contig.h>
+
+#define MEM2MEM_NAME		"pxp-m2m"
+
+MODULE_DESCRIPTION("i.MX PxP mem2mem scaler, rotator and color space converter");
+MODULE_AUTHOR("Freescale Semiconductor, Inc.");
+MODULE_LICENSE("GPL");
+MODULE_VERSION("0.1");
+
+static bool debug;
+module_param(debug, bool, 0644);
+
+/* The PxP processes 8x8 blocks */
+#define MIN_W		8
+#define MIN_H		8
+#define MAX_W		4096
+#define MAX_H		4096
+#define W_ALIGN		3
+#define H_ALIGN		3
+
+/* Buffer pairs submitted to the PxP by one device_run */
+#define MAX_BATCH	8
+
+/* Flags that indicate a format can be used for capture/output */
+#define MEM2MEM_CAPTURE	(1 << 0)
+#define MEM2MEM_OUTPUT	(1 << 1)
+
+#define dprintk(dev, fmt, arg...) \
+	v4l2_dbg(1, debug, &dev->v4l2_dev, "%s: " fmt, __func__, ## arg)
+
+static void pxp_m2m_dev_release(struct device *dev)
+{}
+
+static struct platform_device pxp_m2m_pdev = {
+	.name		= MEM2MEM_NAME,
+	.dev.release	= pxp_m2m_dev_release,
+};
+
+struct pxp_m2m_fmt {
+	char	*name;
+	u32	fourcc;
+	/* format as understood by the PxP DMA driver */
+	u32	pxp_fmt;
+	/* bits per pixel of all planes, and bytes per pixel of the first */
+	int	depth;
+	int	cpp;
+	bool	yuv;
+	/* Types the format can be used for */
+	u32	types;
+};
+
+static struct pxp_m2m_fmt formats[] = {
+	{
+		.name	 = "RGB565",
+		.fourcc	 = V4L2_PIX_FMT_RGB565,
+		.pxp_fmt = PXP_PIX_FMT_RGB565,
+		.depth	 = 16,
+		.cpp	 = 2,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "RGB555",
+		.fourcc	 = V4L2_PIX_FMT_RGB555,
+		.pxp_fmt = PXP_PIX_FMT_RGB555,
+		.depth	 = 16,
+		.cpp	 = 2,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "RGB24",
+		.fourcc	 = V4L2_PIX_FMT_RGB24,
+		.pxp_fmt = PXP_PIX_FMT_RGB24,
+		.depth	 = 24,
+		.cpp	 = 3,
+		.types	 = MEM2MEM_CAPTURE,
+	}, {
+		.name	 = "RGB32",
+		.fourcc	 = V4L2_PIX_FMT_RGB32,
+		.pxp_fmt = PXP_PIX_FMT_RGB32,
+		.depth	 = 32,
+		.cpp	 = 4,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "UYVY 4:2:2",
+		.fourcc	 = V4L2_PIX_FMT_UYVY,
+		.pxp_fmt = PXP_PIX_FMT_UYVY,
+		.depth	 = 16,
+		.cpp	 = 2,
+		.yuv	 = true,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "VYUY 4:2:2",
+		.fourcc	 = V4L2_PIX_FMT_VYUY,
+		.pxp_fmt = PXP_PIX_FMT_VYUY,
+		.depth	 = 16,
+		.cpp	 = 2,
+		.yuv	 = true,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "YUYV 4:2:2",
+		.fourcc	 = V4L2_PIX_FMT_YUYV,
+		.pxp_fmt = PXP_PIX_FMT_YUYV,
+		.depth	 = 16,
+		.cpp	 = 2,
+		.yuv	 = true,
+		.types	 = MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "YVYU 4:2:2",
+		.fourcc	 = V4L2_PIX_FMT_YVYU,
+		.pxp_fmt = PXP_PIX_FMT_YVYU,
+		.depth	 = 16,
+		.cpp	 = 2,
+		.yuv	 = true,
+		.types	 = MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "Greyscale 8-bit",
+		.fourcc	 = V4L2_PIX_FMT_GREY,
+		.pxp_fmt = PXP_PIX_FMT_GREY,
+		.depth	 = 8,
+		.cpp	 = 1,
+		.yuv	 = true,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "Y/CbCr 4:2:0",
+		.fourcc	 = V4L2_PIX_FMT_NV12,
+		.pxp_fmt = PXP_PIX_FMT_NV12,
+		.depth	 = 12,
+		.cpp	 = 1,
+		.yuv	 = true,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "Y/CrCb 4:2:0",
+		.fourcc	 = V4L2_PIX_FMT_NV21,
+		.pxp_fmt = PXP_PIX_FMT_NV21,
+		.depth	 = 12,
+		.cpp	 = 1,
+		.yuv	 = true,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "Y/CbCr 4:2:2",
+		.fourcc	 = V4L2_PIX_FMT_NV16,
+		.pxp_fmt = PXP_PIX_FMT_NV16,
+		.depth	 = 16,
+		.cpp	 = 1,
+		.yuv	 = true,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "Y/CrCb 4:2:2",
+		.fourcc	 = V4L2_PIX_FMT_NV61,
+		.pxp_fmt = PXP_PIX_FMT_NV61,
+		.depth	 = 16,
+		.cpp	 = 1,
+		.yuv	 = true,
+		.types	 = MEM2MEM_CAPTURE | MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "YUV 4:2:0 Planar",
+		.fourcc	 = V4L2_PIX_FMT_YUV420,
+		.pxp_fmt = PXP_PIX_FMT_YUV420P,
+		.depth	 = 12,
+		.cpp	 = 1,
+		.yuv	 = true,
+		.types	 = MEM2MEM_OUTPUT,
+	}, {
+		.name	 = "YUV 4:2:2 Planar",
+		.fourcc	 = V4L2_PIX_FMT_YUV422P,
+		.pxp_fmt = PXP_PIX_FMT_YUV422P,
+		.depth	 = 16,
+		.cpp	 = 1,
+		.yuv	 = true,
+		.types	 = MEM2MEM_OUTPUT,
+	},
+};
+
+#define NUM_FORMATS ARRAY_SIZE(formats)
+
+/* Per-queue, driver-specific private data */
+struct pxp_m2m_q_data {
+	unsigned int		width;
+	unsigned int		height;
+	unsigned int		bytesperline;
+	unsigned int		sizeimage;
+	struct pxp_m2m_fmt	*fmt;
+};
+
+enum {
+	V4L2_M2M_SRC = 0,
+	V4L2_M2M_DST = 1,
+};
+
+struct pxp_m2m_dev {
+	struct v4l2_device	v4l2_dev;
+	struct video_device	vfd;
+
+	struct mutex		dev_mutex;
+
+	struct dma_chan		*dma_chan;
+	struct work_struct	finish_work;
+
+	struct v4l2_m2m_dev	*m2m_dev;
+	struct vb2_alloc_ctx	*alloc_ctx;
+};
+
+struct pxp_m2m_ctx;
+
+/* One buffer pair of the batch currently on the PxP */
+struct pxp_m2m_run {
+	struct pxp_m2m_ctx	*ctx;
+	struct vb2_buffer	*src;
+	struct vb2_buffer	*dst;
+};
+
+struct pxp_m2m_ctx {
+	struct v4l2_fh		fh;
+	struct pxp_m2m_dev	*dev;
+
+	struct v4l2_ctrl_handler hdl;
+	int			hflip;
+	int			vflip;
+	int			rotate;
+	u32			bgcolor;
+
+	enum v4l2_colorspace	colorspace;
+	struct pxp_m2m_q_data	q_data[2];
+
+	/* written by device_run, completed from the PxP interrupt */
+	struct pxp_m2m_run	runs[MAX_BATCH];
+	unsigned int		num_runs;
+	unsigned int		num_done;
+	/* done when no buffer of the ctx is on the PxP */
+	struct completion	batch_done;
+};
+
+static inline struct pxp_m2m_ctx *file2ctx(struct file *file)
+{
+	return container_of(file->private_data, struct pxp_m2m_ctx, fh);
+}
+
+static struct pxp_m2m_q_data *get_q_data(struct pxp_m2m_ctx *ctx,
+					 enum v4l2_buf_type type)
+{
+	switch (type) {
+	case V4L2_BUF_TYPE_VIDEO_OUTPUT:
+		return &ctx->q_data[V4L2_M2M_SRC];
+	case V4L2_BUF_TYPE_VIDEO_CAPTURE:
+		return &ctx->q_data[V4L2_M2M_DST];
+	default:
+		BUG();
+	}
+	return NULL;
+}
+
+static struct pxp_m2m_fmt *find_format(u32 fourcc, u32 type)
+{
+	unsigned int k;
+
+	for (k = 0; k < NUM_FORMATS; k++) {
+		if ((formats[k].types & type) && formats[k].fourcc == fourcc)
+			return &formats[k];
+	}
+
+	return NULL;
+}
+
+/*
+ * mem2mem callbacks
+ */
+static int pxp_m2m_job_ready(void *priv)
+{
+	struct pxp_m2m_ctx *ctx = priv;
+
+	if (v4l2_m2m_num_src_bufs_ready(ctx->fh.m2m_ctx) < 1 ||
+	    v4l2_m2m_num_dst_bufs_ready(ctx->fh.m2m_ctx) < 1) {
+		dprintk(ctx->dev, "Not enough buffers available\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+static void pxp_m2m_job_abort(void *priv)
+{
+	struct pxp_m2m_ctx *ctx = priv;
+
+	/*
+	 * Transactions already handed to the PxP cannot be pulled back,
+	 * the PxP driver's terminate_all leaves them queued.  Wait for the
+	 * last one of the batch instead, the buffers are ours again then.
+	 */
+	dprintk(ctx->dev, "Aborting task\n");
+	wait_for_completion(&ctx->batch_done);
+}
+
+static void pxp_m2m_finish_work(struct work_struct *work)
+{
+	struct pxp_m2m_dev *pcdev =
+		container_of(work, struct pxp_m2m_dev, finish_work);
+	struct pxp_m2m_ctx *ctx = v4l2_m2m_get_curr_priv(pcdev->m2m_dev);
+
+	if (!ctx)
+		return;
+
+	v4l2_m2m_job_finish(pcdev->m2m_dev, ctx->fh.m2m_ctx);
+}
+
+/*
+ * Called from the PxP interrupt handler with the PxP lock held. Buffers
+ * can be completed from here, but finishing the job may start the next
+ * one, which allocates descriptors and takes the PxP lock again, so that
+ * is left to a work item.
+ */
+static void pxp_m2m_dma_callback(void *data)
+{
+	struct pxp_m2m_run *run = data;
+	struct pxp_m2m_ctx *ctx = run->ctx;
+	struct vb2_buffer *src_vb = run->src, *dst_vb = run->dst;
+
+	dst_vb->v4l2_buf.timestamp = src_vb->v4l2_buf.timestamp;
+	dst_vb->v4l2_buf.flags &= ~V4L2_BUF_FLAG_TSTAMP_SRC_MASK;
+	dst_vb->v4l2_buf.flags |=
+		src_vb->v4l2_buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK;
+	dst_vb->v4l2_buf.timecode = src_vb->v4l2_buf.timecode;
+
+	v4l2_m2m_buf_done(src_vb, VB2_BUF_STATE_DONE);
+	v4l2_m2m_buf_done(dst_vb, VB2_BUF_STATE_DONE);
+
+	if (++ctx->num_done == ctx->num_runs) {
+		complete_all(&ctx->batch_done);
+		schedule_work(&ctx->dev->finish_work);
+	}
+}
+
+static int pxp_m2m_submit(struct pxp_m2m_ctx *ctx, struct pxp_m2m_run *run)
+{
+	struct pxp_m2m_q_data *s_q_data = &ctx->q_data[V4L2_M2M_SRC];
+	struct pxp_m2m_q_data *d_q_data = &ctx->q_data[V4L2_M2M_DST];
+	struct dma_chan *chan = ctx->dev->dma_chan;
+	struct dma_async_tx_descriptor *txd;
+	struct pxp_proc_data *proc_data;
+	struct pxp_layer_param *param;
+	struct pxp_tx_desc *desc;
+	struct scatterlist sg[2];
+	dma_cookie_t cookie;
+
+	/* sg[0] is S0 and sg[1] the output, addresses are set below */
+	sg_init_table(sg, 2);
+
+	txd = chan->device->device_prep_slave_sg(chan, sg, 2, DMA_MEM_TO_DEV,
+						 DMA_PREP_INTERRUPT, NULL);
+	if (!txd)
+		return -EIO;
+
+	txd->callback = pxp_m2m_dma_callback;
+	txd->callback_param = run;
+
+	desc = to_tx_desc(txd);
+
+	proc_data = &desc->proc_data;
+	memset(proc_data, 0, sizeof(*proc_data));
+	proc_data->srect.width = s_q_data->width;
+	proc_data->srect.height = s_q_data->height;
+	/* drect is in S0 orientation, the output layer is post-rotation */
+	if (ctx->rotate == 90 || ctx->rotate == 270) {
+		proc_data->drect.width = d_q_data->height;
+		proc_data->drect.height = d_q_data->width;
+	} else {
+		proc_data->drect.width = d_q_data->width;
+		proc_data->drect.height = d_q_data->height;
+	}
+	proc_data->scaling = proc_data->srect.width != proc_data->drect.width ||
+			     proc_data->srect.height != proc_data->drect.height;
+	proc_data->hflip = ctx->hflip;
+	proc_data->vflip = ctx->vflip;
+	proc_data->rotate = ctx->rotate;
+	proc_data->bgcolor = ctx->bgcolor;
+
+	param = &desc->layer_param.s0_param;
+	memset(param, 0, sizeof(*param));
+	param->width = s_q_data->width;
+	param->height = s_q_data->height;
+	param->stride = s_q_data->width;
+	param->pixel_fmt = s_q_data->fmt->pxp_fmt;
+	param->paddr = vb2_dma_contig_plane_dma_addr(run->src, 0);
+
+	desc = desc->next;
+	param = &desc->layer_param.out_param;
+	memset(param, 0, sizeof(*param));
+	param->width = d_q_data->width;
+	param->height = d_q_data->height;
+	param->stride = d_q_data->width;
+	param->pixel_fmt = d_q_data->fmt->pxp_fmt;
+	param->paddr = vb2_dma_contig_plane_dma_addr(run->dst, 0);
+
+	cookie = dmaengine_submit(txd);
+	if (dma_submit_error(cookie)) {
+		v4l2_warn(&ctx->dev->v4l2_dev, "PxP submit error %d\n",
+			  cookie);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void pxp_m2m_device_run(void *priv)
+{
+	struct pxp_m2m_ctx *ctx = priv;
+	struct pxp_m2m_dev *pcdev = ctx->dev;
+	struct v4l2_m2m_ctx *m2m_ctx = ctx->fh.m2m_ctx;
+	unsigned int n;
+
+	n = min(v4l2_m2m_num_src_bufs_ready(m2m_ctx),
+		v4l2_m2m_num_dst_bufs_ready(m2m_ctx));
+	n = min_t(unsigned int, n, MAX_BATCH);
+
+	ctx->num_runs = 0;
+	ctx->num_done = 0;
+	reinit_completion(&ctx->batch_done);
+
+	/* nothing completes before dma_async_issue_pending() below */
+	while (ctx->num_runs < n) {
+		struct pxp_m2m_run *run = &ctx->runs[ctx->num_runs];
+
+		run->ctx = ctx;
+		run->src = v4l2_m2m_src_buf_remove(m2m_ctx);
+		run->dst = v4l2_m2m_dst_buf_remove(m2m_ctx);
+
+		if (pxp_m2m_submit(ctx, run)) {
+			v4l2_m2m_buf_done(run->src, VB2_BUF_STATE_ERROR);
+			v4l2_m2m_buf_done(run->dst, VB2_BUF_STATE_ERROR);
+			break;
+		}
+
+		ctx->num_runs++;
+	}
+
+	dprintk(pcdev, "submitted %u of %u buffer pairs\n", ctx->num_runs, n);
+
+	if (!ctx->num_runs) {
+		complete_all(&ctx->batch_done);
+		schedule_work(&pcdev->finish_work);
+		return;
+	}
+
+	dma_async_issue_pending(pcdev->dma_chan);
+}
+
+/*
+ * video ioctls
+ */
+static int vidioc_querycap(struct file *file, void *priv,
+			   struct v4l2_capability *cap)
+{
+	strlcpy(cap->driver, MEM2MEM_NAME, sizeof(cap->driver));
+	strlcpy(cap->card, MEM2MEM_NAME, sizeof(cap->card));
+	snprintf(cap->bus_info, sizeof(cap->bus_info),
+		 "platform:%s", MEM2MEM_NAME);
+	cap->device_caps = V4L2_CAP_VIDEO_M2M | V4L2_CAP_STREAMING;
+	cap->capabilities = cap->device_caps | V4L2_CAP_DEVICE_CAPS;
+
+	return 0;
+}
+
+static int enum_fmt(struct v4l2_fmtdesc *f, u32 type)
+{
+	int i, num = 0;
+
+	for (i = 0; i < NUM_FORMATS; ++i) {
+		if (formats[i].types & type) {
+			if (num == f->index)
+				break;
+			++num;
+		}
+	}
+
+	if (i == NUM_FORMATS)
+		return -EINVAL;
+
+	strlcpy(f->description, formats[i].name, sizeof(f->description));
+	f->pixelformat = formats[i].fourcc;
+
+	return 0;
+}
+
+static int vidioc_enum_fmt_vid_cap(struct file *file, void *priv,
+				   struct v4l2_fmtdesc *f)
+{
+	return enum_fmt(f, MEM2MEM_CAPTURE);
+}
+
+static int vidioc_enum_fmt_vid_out(struct file *file, void *priv,
+				   struct v4l2_fmtdesc *f)
+{
+	return enum_fmt(f, MEM2MEM_OUTPUT);
+}
+
+static enum v4l2_colorspace pxp_m2m_dst_colorspace(struct pxp_m2m_ctx *ctx,
+						   struct pxp_m2m_fmt *d_fmt)
+{
+	struct pxp_m2m_fmt *s_fmt = ctx->q_data[V4L2_M2M_SRC].fmt;
+
+	/* the PxP CSCs use fixed BT.601 coefficients */
+	if (s_fmt->yuv == d_fmt->yuv)
+		return ctx->colorspace;
+	return d_fmt->yuv ? V4L2_COLORSPACE_SMPTE170M : V4L2_COLORSPACE_SRGB;
+}
+
+static int vidioc_g_fmt(struct pxp_m2m_ctx *ctx, struct v4l2_format *f)
+{
+	struct pxp_m2m_q_data *q_data;
+	struct vb2_queue *vq;
+
+	vq = v4l2_m2m_get_vq(ctx->fh.m2m_ctx, f->type);
+	if (!vq)
+		return -EINVAL;
+
+	q_data = get_q_data(ctx, f->type);
+
+	f->fmt.pix.width	= q_data->width;
+	f->fmt.pix.height	= q_data->height;
+	f->fmt.pix.field	= V4L2_FIELD_NONE;
+	f->fmt.pix.pixelformat	= q_data->fmt->fourcc;
+	f->fmt.pix.bytesperline	= q_data->bytesperline;
+	f->fmt.pix.sizeimage	= q_data->sizeimage;
+	if (f->type == V4L2_BUF_TYPE_VIDEO_CAPTURE)
+		f->fmt.pix.colorspace = pxp_m2m_dst_colorspace(ctx,
+							       q_data->fmt);
+	else
+		f->fmt.pix.colorspace = ctx->colorspace;
+
+	return 0;
+}
+
+static int vidioc_g_fmt_vid_out(struct file *file, void *priv,
+				struct v4l2_format *f)
+{
+	return vidioc_g_fmt(file2ctx(file), f);
+}
+
+static int vidioc_g_fmt_vid_cap(struct file *file, void *priv,
+				struct v4l2_format *f)
+{
+	return vidioc_g_fmt(file2ctx(file), f);
+}
+
+/* The PxP has no pitch of its own here, lines are always packed */
+static int vidioc_try_fmt(struct v4l2_format *f, struct pxp_m2m_fmt *fmt)
+{
+	v4l_bound_align_image(&f->fmt.pix.width, MIN_W, MAX_W, W_ALIGN,
+			      &f->fmt.pix.height, MIN_H, MAX_H, H_ALIGN, 0);
+
+	f->fmt.pix.field = V4L2_FIELD_NONE;
+	f->fmt.pix.bytesperline = f->fmt.pix.width * fmt->cpp;
+	f->fmt.pix.sizeimage = f->fmt.pix.width * f->fmt.pix.height *
+			       fmt->depth / 8;
+
+	return 0;
+}
+
+static int vidioc_try_fmt_vid_cap(struct file *file, void *priv,
+				  struct v4l2_format *f)
+{
+	struct pxp_m2m_ctx *ctx = file2ctx(file);
+	struct pxp_m2m_fmt *fmt;
+
+	fmt = find_format(f->fmt.pix.pixelformat, MEM2MEM_CAPTURE);
+	if (!fmt) {
+		fmt = &formats[0];
+		f->fmt.pix.pixelformat = fmt->fourcc;
+	}
+
+	f->fmt.pix.colorspace = pxp_m2m_dst_colorspace(ctx, fmt);
+
+	return vidioc_try_fmt(f, fmt);
+}
+
+static int vidioc_try_fmt_vid_out(struct file *file, void *priv,
+				  struct v4l2_format *f)
+{
+	struct pxp_m2m_fmt *fmt;
+
+	fmt = find_format(f->fmt.pix.pixelformat, MEM2MEM_OUTPUT);
+	if (!fmt) {
+		fmt = &formats[0];
+		f->fmt.pix.pixelformat = fmt->fourcc;
+	}
+
+	if (!f->fmt.pix.colorspace)
+		f->fmt.pix.colorspace = fmt->yuv ? V4L2_COLORSPACE_SMPTE170M :
+						   V4L2_COLORSPACE_SRGB;
+
+	return vidioc_try_fmt(f, fmt);
+}
+
+static int vidioc_s_fmt(struct pxp_m2m_ctx *ctx, struct v4l2_format *f)
+{
+	struct pxp_m2m_q_data *q_data;
+	struct vb2_queue *vq;
+
+	vq = v4l2_m2m_get_vq(ctx->fh.m2m_ctx, f->type);
+	if (!vq)
+		return -EINVAL;
+
+	q_data = get_q_data(ctx, f->type);
+
+	if (vb2_is_busy(vq)) {
+		v4l2_err(&ctx->dev->v4l2_dev, "%s queue busy\n", __func__);
+		return -EBUSY;
+	}
+
+	q_data->fmt = find_format(f->fmt.pix.pixelformat,
+				  f->type == V4L2_BUF_TYPE_VIDEO_CAPTURE ?
+				  MEM2MEM_CAPTURE : MEM2MEM_OUTPUT);
+	q_data->width		= f->fmt.pix.width;
+	q_data->height		= f->fmt.pix.height;
+	q_data->bytesperline	= f->fmt.pix.bytesperline;
+	q_data->sizeimage	= f->fmt.pix.sizeimage;
+
+	dprintk(ctx->dev,
+		"Setting format for type %d, wxh: %dx%d, fmt: %d\n",
+		f->type, q_data->width, q_data->height, q_data->fmt->fourcc);
+
+	return 0;
+}
+
+static int vidioc_s_fmt_vid_cap(struct file *file, void *priv,
+				struct v4l2_format *f)
+{
+	int ret;
+
+	ret = vidioc_try_fmt_vid_cap(file, priv, f);
+	if (ret)
+		return ret;
+
+	return vidioc_s_fmt(file2ctx(file), f);
+}
+
+static int vidioc_s_fmt_vid_out(struct file *file, void *priv,
+				struct v4l2_format *f)
+{
+	struct pxp_m2m_ctx *ctx = file2ctx(file);
+	int ret;
+
+	ret = vidioc_try_fmt_vid_out(file, priv, f);
+	if (ret)
+		return ret;
+
+	ret = vidioc_s_fmt(ctx, f);
+	if (!ret)
+		ctx->colorspace = f->fmt.pix.colorspace;
+
+	return ret;
+}
+
+static int pxp_m2m_s_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct pxp_m2m_ctx *ctx =
+		container_of(ctrl->handler, struct pxp_m2m_ctx, hdl);
+
+	switch (ctrl->id) {
+	case V4L2_CID_HFLIP:
+		ctx->hflip = ctrl->val;
+		break;
+	case V4L2_CID_VFLIP:
+		ctx->vflip = ctrl->val;
+		break;
+	case V4L2_CID_ROTATE:
+		ctx->rotate = ctrl->val;
+		break;
+	case V4L2_CID_BG_COLOR:
+		ctx->bgcolor = ctrl->val;
+		break;
+	default:
+		v4l2_err(&ctx->dev->v4l2_dev, "Invalid control\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct v4l2_ctrl_ops pxp_m2m_ctrl_ops = {
+	.s_ctrl = pxp_m2m_s_ctrl,
+};
+
+static const struct v4l2_ioctl_ops pxp_m2m_ioctl_ops = {
+	.vidioc_querycap	= vidioc_querycap,
+
+	.vidioc_enum_fmt_vid_cap = vidioc_enum_fmt_vid_cap,
+	.vidioc_g_fmt_vid_cap	= vidioc_g_fmt_vid_cap,
+	.vidioc_try_fmt_vid_cap	= vidioc_try_fmt_vid_cap,
+	.vidioc_s_fmt_vid_cap	= vidioc_s_fmt_vid_cap,
+
+	.vidioc_enum_fmt_vid_out = vidioc_enum_fmt_vid_out,
+	.vidioc_g_fmt_vid_out	= vidioc_g_fmt_vid_out,
+	.vidioc_try_fmt_vid_out	= vidioc_try_fmt_vid_out,
+	.vidioc_s_fmt_vid_out	= vidioc_s_fmt_vid_out,
+
+	.vidioc_reqbufs		= v4l2_m2m_ioctl_reqbufs,
+	.vidioc_querybuf	= v4l2_m2m_ioctl_querybuf,
+	.vidioc_qbuf		= v4l2_m2m_ioctl_qbuf,
+	.vidioc_dqbuf		= v4l2_m2m_ioctl_dqbuf,
+	.vidioc_expbuf		= v4l2_m2m_ioctl_expbuf,
+	.vidioc_create_bufs	= v4l2_m2m_ioctl_create_bufs,
+
+	.vidioc_streamon	= v4l2_m2m_ioctl_streamon,
+	.vidioc_streamoff	= v4l2_m2m_ioctl_streamoff,
+
+	.vidioc_subscribe_event = v4l2_ctrl_subscribe_event,
+	.vidioc_unsubscribe_event = v4l2_event_unsubscribe,
+};
+
+/*
+ * Queue operations
+ */
+static int pxp_m2m_queue_setup(struct vb2_queue *vq,
+			       const struct v4l2_format *fmt,
+			       unsigned int *nbuffers, unsigned int *nplanes,
+			       unsigned int sizes[], void *alloc_ctxs[])
+{
+	struct pxp_m2m_ctx *ctx = vb2_get_drv_priv(vq);
+	struct pxp_m2m_q_data *q_data;
+
+	q_data = get_q_data(ctx, vq->type);
+
+	*nplanes = 1;
+	sizes[0] = q_data->sizeimage;
+	alloc_ctxs[0] = ctx->dev->alloc_ctx;
+
+	dprintk(ctx->dev, "get %d buffer(s) of size %d each.\n",
+		*nbuffers, sizes[0]);
+
+	return 0;
+}
+
+static int pxp_m2m_buf_prepare(struct vb2_buffer *vb)
+{
+	struct pxp_m2m_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+	struct pxp_m2m_q_data *q_data;
+
+	q_data = get_q_data(ctx, vb->vb2_queue->type);
+
+	if (vb2_plane_size(vb, 0) < q_data->sizeimage) {
+		dprintk(ctx->dev, "data will not fit into plane (%lu < %lu)\n",
+			vb2_plane_size(vb, 0), (long)q_data->sizeimage);
+		return -EINVAL;
+	}
+
+	vb2_set_plane_payload(vb, 0, q_data->sizeimage);
+
+	return 0;
+}
+
+static void pxp_m2m_buf_queue(struct vb2_buffer *vb)
+{
+	struct pxp_m2m_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+
+	v4l2_m2m_buf_queue(ctx->fh.m2m_ctx, vb);
+}
+
+static void pxp_m2m_stop_streaming(struct vb2_queue *q)
+{
+	struct pxp_m2m_ctx *ctx = vb2_get_drv_priv(q);
+	struct vb2_buffer *vb;
+
+	/* the PxP may still be reading or writing the batch buffers */
+	wait_for_completion(&ctx->batch_done);
+
+	for (;;) {
+		if (V4L2_TYPE_IS_OUTPUT(q->type))
+			vb = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
+		else
+			vb = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
+		if (!vb)
+			return;
+		v4l2_m2m_buf_done(vb, VB2_BUF_STATE_ERROR);
+	}
+}
+
+static struct vb2_ops pxp_m2m_qops = {
+	.queue_setup	 = pxp_m2m_queue_setup,
+	.buf_prepare	 = pxp_m2m_buf_prepare,
+	.buf_queue	 = pxp_m2m_buf_queue,
+	.stop_streaming	 = pxp_m2m_stop_streaming,
+	.wait_prepare	 = vb2_ops_wait_prepare,
+	.wait_finish	 = vb2_ops_wait_finish,
+};
+
+static int queue_init(void *priv, struct vb2_queue *src_vq,
+		      struct vb2_queue *dst_vq)
+{
+	struct pxp_m2m_ctx *ctx = priv;
+	int ret;
+
+	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	src_vq->io_modes = VB2_MMAP | VB2_USERPTR | VB2_DMABUF;
+	src_vq->drv_priv = ctx;
+	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	src_vq->ops = &pxp_m2m_qops;
+	src_vq->mem_ops = &vb2_dma_contig_memops;
+	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	src_vq->lock = &ctx->dev->dev_mutex;
+
+	ret = vb2_queue_init(src_vq);
+	if (ret)
+		return ret;
+
+	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	dst_vq->io_modes = VB2_MMAP | VB2_USERPTR | VB2_DMABUF;
+	dst_vq->drv_priv = ctx;
+	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	dst_vq->ops = &pxp_m2m_qops;
+	dst_vq->mem_ops = &vb2_dma_contig_memops;
+	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	dst_vq->lock = &ctx->dev->dev_mutex;
+
+	return vb2_queue_init(dst_vq);
+}
+
+/*
+ * File operations
+ */
+static int pxp_m2m_open(struct file *file)
+{
+	struct pxp_m2m_dev *pcdev = video_drvdata(file);
+	struct pxp_m2m_ctx *ctx;
+	struct v4l2_ctrl_handler *hdl;
+	struct pxp_m2m_q_data *q_data;
+	int ret = 0;
+
+	if (mutex_lock_interruptible(&pcdev->dev_mutex))
+		return -ERESTARTSYS;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx) {
+		ret = -ENOMEM;
+		goto open_unlock;
+	}
+
+	v4l2_fh_init(&ctx->fh, video_devdata(file));
+	file->private_data = &ctx->fh;
+	ctx->dev = pcdev;
+	init_completion(&ctx->batch_done);
+	complete_all(&ctx->batch_done);
+
+	hdl = &ctx->hdl;
+	v4l2_ctrl_handler_init(hdl, 4);
+	v4l2_ctrl_new_std(hdl, &pxp_m2m_ctrl_ops, V4L2_CID_HFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(hdl, &pxp_m2m_ctrl_ops, V4L2_CID_VFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(hdl, &pxp_m2m_ctrl_ops, V4L2_CID_ROTATE,
+			  0, 270, 90, 0);
+	v4l2_ctrl_new_std(hdl, &pxp_m2m_ctrl_ops, V4L2_CID_BG_COLOR,
+			  0, 0xffffff, 1, 0);
+	if (hdl->error) {
+		ret = hdl->error;
+		v4l2_ctrl_handler_free(hdl);
+		kfree(ctx);
+		goto open_unlock;
+	}
+	ctx->fh.ctrl_handler = hdl;
+	v4l2_ctrl_handler_setup(hdl);
+
+	q_data = &ctx->q_data[V4L2_M2M_SRC];
+	q_data->fmt = &formats[0];
+	q_data->width = 640;
+	q_data->height = 480;
+	q_data->bytesperline = q_data->width * q_data->fmt->cpp;
+	q_data->sizeimage = q_data->width * q_data->height *
+			    q_data->fmt->depth / 8;
+	ctx->q_data[V4L2_M2M_DST] = *q_data;
+	ctx->colorspace = V4L2_COLORSPACE_SRGB;
+
+	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(pcdev->m2m_dev, ctx, &queue_init);
+	if (IS_ERR(ctx->fh.m2m_ctx)) {
+		ret = PTR_ERR(ctx->fh.m2m_ctx);
+
+		v4l2_ctrl_handler_free(hdl);
+		kfree(ctx);
+		goto open_unlock;
+	}
+
+	v4l2_fh_add(&ctx->fh);
+
+	dprintk(pcdev, "Created instance %p, m2m_ctx: %p\n",
+		ctx, ctx->fh.m2m_ctx);
+
+open_unlock:
+	mutex_unlock(&pcdev->dev_mutex);
+	return ret;
+}
+
+static int pxp_m2m_release(struct file *file)
+{
+	struct pxp_m2m_dev *pcdev = video_drvdata(file);
+	struct pxp_m2m_ctx *ctx = file2ctx(file);
+
+	dprintk(pcdev, "Releasing instance %p\n", ctx);
+
+	v4l2_fh_del(&ctx->fh);
+	v4l2_fh_exit(&ctx->fh);
+	v4l2_ctrl_handler_free(&ctx->hdl);
+	mutex_lock(&pcdev->dev_mutex);
+	v4l2_m2m_ctx_release(ctx->fh.m2m_ctx);
+	mutex_unlock(&pcdev->dev_mutex);
+	kfree(ctx);
+
+	return 0;
+}
+
+static const struct v4l2_file_operations pxp_m2m_fops = {
+	.owner		= THIS_MODULE,
+	.open		= pxp_m2m_open,
+	.release	= pxp_m2m_release,
+	.poll		= v4l2_m2m_fop_poll,
+	.unlocked_ioctl	= video_ioctl2,
+	.mmap		= v4l2_m2m_fop_mmap,
+};
+
+static struct video_device pxp_m2m_videodev = {
+	.name		= MEM2MEM_NAME,
+	.vfl_dir	= VFL_DIR_M2M,
+	.fops		= &pxp_m2m_fops,
+	.ioctl_ops	= &pxp_m2m_ioctl_ops,
+	.minor		= -1,
+	.release	= video_device_release_empty,
+};
+
+static struct v4l2_m2m_ops m2m_ops = {
+	.device_run	= pxp_m2m_device_run,
+	.job_ready	= pxp_m2m_job_ready,
+	.job_abort	= pxp_m2m_job_abort,
+};
+
+static bool chan_filter(struct dma_chan *chan, void *arg)
+{
+	return imx_dma_is_pxp(chan);
+}
+
+/*
+ * dma_request_channel() gives no reason for a failure: wait only while
+ * the PxP DMA device exists but its driver has not bound it yet.
+ */
+static int pxp_m2m_dma_error(void)
+{
+	struct platform_device *pxp;
+	struct device_node *np;
+	int ret = -ENODEV;
+
+	np = of_find_compatible_node(NULL, NULL, "fsl,imx6dl-pxp-dma");
+	if (!np || !of_device_is_available(np))
+		goto out;
+
+	ret = -EPROBE_DEFER;
+	pxp = of_find_device_by_node(np);
+	if (pxp) {
+		/* bound but without a free channel: another client has it */
+		if (pxp->dev.driver)
+			ret = -EBUSY;
+		put_device(&pxp->dev);
+	}
+out:
+	of_node_put(np);
+	return ret;
+}
+
+static int pxp_m2m_probe(struct platform_device *pdev)
+{
+	struct pxp_m2m_dev *pcdev;
+	struct video_device *vfd;
+	dma_cap_mask_t mask;
+	int ret;
+
+	pcdev = devm_kzalloc(&pdev->dev, sizeof(*pcdev), GFP_KERNEL);
+	if (!pcdev)
+		return -ENOMEM;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_SLAVE, mask);
+	dma_cap_set(DMA_PRIVATE, mask);
+	pcdev->dma_chan = dma_request_channel(mask, chan_filter, NULL);
+	if (!pcdev->dma_chan) {
+		ret = pxp_m2m_dma_error();
+		if (ret != -EPROBE_DEFER)
+			dev_err(&pdev->dev, "no PxP DMA channel: %d\n", ret);
+		return ret;
+	}
+
+	INIT_WORK(&pcdev->finish_work, pxp_m2m_finish_work);
+
+	ret = v4l2_device_register(&pdev->dev, &pcdev->v4l2_dev);
+	if (ret)
+		goto rel_dma;
+
+	mutex_init(&pcdev->dev_mutex);
+
+	/* buffers are allocated for and mapped by the PxP itself */
+	pcdev->alloc_ctx =
+		vb2_dma_contig_init_ctx(pcdev->dma_chan->device->dev);
+	if (IS_ERR(pcdev->alloc_ctx)) {
+		v4l2_err(&pcdev->v4l2_dev, "Failed to alloc vb2 context\n");
+		ret = PTR_ERR(pcdev->alloc_ctx);
+		goto unreg_dev;
+	}
+
+	pcdev->m2m_dev = v4l2_m2m_init(&m2m_ops);
+	if (IS_ERR(pcdev->m2m_dev)) {
+		v4l2_err(&pcdev->v4l2_dev, "Failed to init mem2mem device\n");
+		ret = PTR_ERR(pcdev->m2m_dev);
+		goto err_ctx;
+	}
+
+	vfd = &pcdev->vfd;
+	*vfd = pxp_m2m_videodev;
+	vfd->lock = &pcdev->dev_mutex;
+	vfd->v4l2_dev = &pcdev->v4l2_dev;
+	video_set_drvdata(vfd, pcdev);
+
+	ret = video_register_device(vfd, VFL_TYPE_GRABBER, -1);
+	if (ret) {
+		v4l2_err(&pcdev->v4l2_dev, "Failed to register video device\n");
+		goto err_m2m;
+	}
+
+	v4l2_info(&pcdev->v4l2_dev, "Device registered as /dev/video%d\n",
+		  vfd->num);
+
+	platform_set_drvdata(pdev, pcdev);
+
+	return 0;
+
+err_m2m:
+	v4l2_m2m_release(pcdev->m2m_dev);
+err_ctx:
+	vb2_dma_contig_cleanup_ctx(pcdev->alloc_ctx);
+unreg_dev:
+	v4l2_device_unregister(&pcdev->v4l2_dev);
+rel_dma:
+	dma_release_channel(pcdev->dma_chan);
+
+	return ret;
+}
+
+static int pxp_m2m_remove(struct platform_device *pdev)
+{
+	struct pxp_m2m_dev *pcdev = platform_get_drvdata(pdev);
+
+	v4l2_info(&pcdev->v4l2_dev, "Removing " MEM2MEM_NAME);
+	video_unregister_device(&pcdev->vfd);
+	flush_work(&pcdev->finish_work);
+	v4l2_m2m_release(pcdev->m2m_dev);
+	vb2_dma_contig_cleanup_ctx(pcdev->alloc_ctx);
+	v4l2_device_unregister(&pcdev->v4l2_dev);
+	dma_release_channel(pcdev->dma_chan);
+
+	return 0;
+}
+
+static struct platform_driver pxp_m2m_pdrv = {
+	.probe		= pxp_m2m_probe,
+	.remove		= pxp_m2m_remove,
+	.driver		= {
+		.name	= MEM2MEM_NAME,
+	},
+};
+
+static void __exit pxp_m2m_exit(void)
+{
+	platform_driver_unregister(&pxp_m2m_pdrv);
+	platform_device_unregister(&pxp_m2m_pdev);
+}
+
+static int __init pxp_m2m_init(void)
+{
+	int ret;
+
+	ret = platform_device_register(&pxp_m2m_pdev);
+	if (ret)
+		return ret;
+
+	ret = platform_driver_register(&pxp_m2m_pdrv);
+	if (ret)
+		platform_device_unregister(&pxp_m2m_pdev);
+
+	return ret;
+}
+
+module_init(pxp_m2m_init);
+module_exit(pxp_m2m_exit);
@@ -70,6 +70,31 @@ MODULE_ALIAS("mmc:block");
 
 static DEFINE_MUTEX(block_mutex);
 
+/* Why mmc_blk_prep_packed_list() stopped adding requests to a pack */
+enum mmc_blk_pack_stop {
+	MMC_PACK_STOP_EMPTY,		/* no more requests queued */
+	MMC_PACK_STOP_ENTRIES,		/* entry limit reached */
+	MMC_PACK_STOP_DIR,		/* next request has another direction */
+	MMC_PACK_STOP_REQ_SIZE,		/* next request too large to pack */
+	MMC_PACK_STOP_BLOCKS,		/* host transfer size limit */
+	MMC_PACK_STOP_SEGS,		/* host segment limit */
+	MMC_PACK_STOP_OTHER,		/* flush, discard, reliable write, ... */
+	MMC_PACK_STOP_NR,
+};
+
+static const char * const mmc_blk_pack_stop_names[MMC_PACK_STOP_NR] = {
+	"empty", "entries", "direction", "req_size", "blocks", "segments",
+	"other",
+};
+
+struct mmc_blk_packed_stats {
+	unsigned long	packed_cmds;	/* packed commands issued */
+	unsigned long	packed_reqs;	/* requests sent in them */
+	unsigned long	packed_sectors;	/* sectors, including headers */
+	unsigned long	single_reqs;	/* candidates that went alone */
+	unsigned long	stop[MMC_PACK_STOP_NR];
+};
+
 /*
  * The defaults come from config options but can be overriden by module
  * or bootarg options.
@@ -122,6 +147,14 @@ struct mmc_blk_data {
 	struct device_attribute force_ro;
 	struct device_attribute power_ro_lock;
 	int	area_type;
+
+	/*
+	 * Packing limits, 0 means no limit beyond the card's and the
+	 * host's. Only used with MMC_BLK_PACKED_CMD.
+	 */
+	unsigned int	packed_max_entries;
+	unsigned int	packed_max_req_sectors;
+	struct mmc_blk_packed_stats packed_stats;
 };
 
 static DEFINE_MUTEX(open_lock);
@@ -183,7 +216,7 @@ static void mmc_blk_put(struct mmc_blk_data *md)
 	md->usage--;
 	if (md->usage == 0) {
 		int devidx = mmc_get_devidx(md->disk);
-		blk_cleanup_queue(md->queue.queue);
+		mmc_free_queue(&md->queue);
 
 		__clear_bit(devidx, dev_use);
 
@@ -291,6 +324,92 @@ out:
 	return ret;
 }
 
+static ssize_t packed_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct mmc_blk_packed_stats *st = &md->packed_stats;
+	unsigned long cmds = st->packed_cmds;
+	ssize_t ret;
+	int i;
+
+	ret = snprintf(buf, PAGE_SIZE,
+		       "packed_cmds: %lu\npacked_reqs: %lu\n"
+		       "packed_sectors: %lu\nsingle_reqs: %lu\n"
+		       "reqs_per_cmd: %lu.%02lu\n",
+		       cmds, st->packed_reqs, st->packed_sectors,
+		       st->single_reqs,
+		       cmds ? st->packed_reqs / cmds : 0,
+		       cmds ? (st->packed_reqs * 100 / cmds) % 100 : 0);
+	for (i = 0; i < MMC_PACK_STOP_NR; i++)
+		ret += snprintf(buf + ret, PAGE_SIZE - ret, "stop_%s: %lu\n",
+				mmc_blk_pack_stop_names[i], st->stop[i]);
+
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t packed_stats_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mmc_blk_data *md;
+	unsigned long set;
+
+	if (kstrtoul(buf, 0, &set) || set)
+		return -EINVAL;
+
+	md = mmc_blk_get(dev_to_disk(dev));
+	memset(&md->packed_stats, 0, sizeof(md->packed_stats));
+	mmc_blk_put(md);
+	return count;
+}
+
+static DEVICE_ATTR(packed_stats, S_IRUGO | S_IWUSR, packed_stats_show,
+		   packed_stats_store);
+
+#define MMC_BLK_PACKED_ATTR(name)					\
+static ssize_t name##_show(struct device *dev,				\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));	\
+	ssize_t ret = snprintf(buf, PAGE_SIZE, "%u\n", md->name);	\
+									\
+	mmc_blk_put(md);						\
+	return ret;							\
+}									\
+									\
+static ssize_t name##_store(struct device *dev,				\
+		struct device_attribute *attr, const char *buf,		\
+		size_t count)						\
+{									\
+	struct mmc_blk_data *md;					\
+	unsigned int val;						\
+									\
+	if (kstrtouint(buf, 0, &val))					\
+		return -EINVAL;						\
+									\
+	md = mmc_blk_get(dev_to_disk(dev));				\
+	md->name = val;							\
+	mmc_blk_put(md);						\
+	return count;							\
+}									\
+									\
+static DEVICE_ATTR(name, S_IRUGO | S_IWUSR, name##_show, name##_store)
+
+MMC_BLK_PACKED_ATTR(packed_max_entries);
+MMC_BLK_PACKED_ATTR(packed_max_req_sectors);
+
+static struct attribute *mmc_blk_packed_attrs[] = {
+	&dev_attr_packed_stats.attr,
+	&dev_attr_packed_max_entries.attr,
+	&dev_attr_packed_max_req_sectors.attr,
+	NULL,
+};
+
+static const struct attribute_group mmc_blk_packed_attr_group = {
+	.attrs = mmc_blk_packed_attrs,
+};
+
 static int mmc_blk_open(struct block_device *bdev, fmode_t mode)
 {
 	struct mmc_blk_data *md = mmc_blk_get(bdev->bd_disk);
@@ -1084,7 +1203,7 @@ out:
 		goto retry;
 	if (!err)
 		mmc_blk_reset_success(md, type);
-	blk_end_request(req, err, blk_rq_bytes(req));
+	mmc_queue_end_request(req, err, blk_rq_bytes(req));
 
 	return err ? 0 : 1;
 }
@@ -1151,7 +1270,7 @@ out_retry:
 	if (!err)
 		mmc_blk_reset_success(md, type);
 out:
-	blk_end_request(req, err, blk_rq_bytes(req));
+	mmc_queue_end_request(req, err, blk_rq_bytes(req));
 
 	return err ? 0 : 1;
 }
@@ -1166,7 +1285,7 @@ static int mmc_blk_issue_flush(struct mmc_queue *mq, struct request *req)
 	if (ret)
 		ret = -EIO;
 
-	blk_end_request_all(req, ret);
+	mmc_queue_end_request_all(req, ret);
 
 	return ret ? 0 : 1;
 }
@@ -1551,9 +1670,11 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 	struct request *cur = req, *next = NULL;
 	struct mmc_blk_data *md = mq->data;
 	struct mmc_queue_req *mqrq = mq->mqrq_cur;
+	struct mmc_blk_packed_stats *st = &md->packed_stats;
 	bool en_rel_wr = card->ext_csd.rel_param & EXT_CSD_WR_REL_PARAM_EN;
 	unsigned int req_sectors = 0, phys_segments = 0;
-	unsigned int max_blk_count, max_phys_segs;
+	unsigned int max_blk_count, max_phys_segs, max_req_sectors;
+	enum mmc_blk_pack_stop stop = MMC_PACK_STOP_OTHER;
 	bool put_back = true;
 	u8 max_packed_rw = 0;
 	u8 reqs = 0;
@@ -1565,7 +1686,16 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 	    mmc_host_packed_wr(card->host))
 		max_packed_rw = card->ext_csd.max_packed_writes;
 
-	if (max_packed_rw == 0)
+	if (md->packed_max_entries)
+		max_packed_rw = min_t(unsigned int, max_packed_rw,
+				      md->packed_max_entries);
+
+	if (max_packed_rw < 2)
+		goto no_packed;
+
+	/* large requests gain nothing from being packed */
+	max_req_sectors = md->packed_max_req_sectors;
+	if (max_req_sectors && blk_rq_sectors(cur) > max_req_sectors)
 		goto no_packed;
 
 	if (mmc_req_rel_wr(cur) &&
@@ -1594,14 +1724,16 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 
 	do {
 		if (reqs >= max_packed_rw - 1) {
+			stop = MMC_PACK_STOP_ENTRIES;
 			put_back = false;
 			break;
 		}
 
 		spin_lock_irq(q->queue_lock);
-		next = blk_fetch_request(q);
+		next = mmc_queue_fetch(mq);
 		spin_unlock_irq(q->queue_lock);
 		if (!next) {
+			stop = MMC_PACK_STOP_EMPTY;
 			put_back = false;
 			break;
 		}
@@ -1614,20 +1746,32 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 		    next->cmd_flags & REQ_FLUSH)
 			break;
 
-		if (rq_data_dir(cur) != rq_data_dir(next))
+		if (rq_data_dir(cur) != rq_data_dir(next)) {
+			stop = MMC_PACK_STOP_DIR;
 			break;
+		}
 
 		if (mmc_req_rel_wr(next) &&
 		    (md->flags & MMC_BLK_REL_WR) && !en_rel_wr)
 			break;
 
+		if (max_req_sectors &&
+		    blk_rq_sectors(next) > max_req_sectors) {
+			stop = MMC_PACK_STOP_REQ_SIZE;
+			break;
+		}
+
 		req_sectors += blk_rq_sectors(next);
-		if (req_sectors > max_blk_count)
+		if (req_sectors > max_blk_count) {
+			stop = MMC_PACK_STOP_BLOCKS;
 			break;
+		}
 
 		phys_segments +=  next->nr_phys_segments;
-		if (phys_segments > max_phys_segs)
+		if (phys_segments > max_phys_segs) {
+			stop = MMC_PACK_STOP_SEGS;
 			break;
+		}
 
 		list_add_tail(&next->queuelist, &mqrq->packed->list);
 		cur = next;
@@ -1636,17 +1780,24 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 
 	if (put_back) {
 		spin_lock_irq(q->queue_lock);
-		blk_requeue_request(q, next);
+		mmc_queue_requeue(mq, next);
 		spin_unlock_irq(q->queue_lock);
 	}
 
+	st->stop[stop]++;
+
 	if (reqs > 0) {
 		list_add(&req->queuelist, &mqrq->packed->list);
 		mqrq->packed->nr_entries = ++reqs;
 		mqrq->packed->retries = reqs;
+		st->packed_cmds++;
+		st->packed_reqs += reqs;
+		st->packed_sectors += req_sectors;
 		return reqs;
 	}
 
+	st->single_reqs++;
+
 no_packed:
 	mqrq->cmd_type = MMC_PACKED_NONE;
 	return 0;
@@ -1756,11 +1907,12 @@ static int mmc_blk_cmd_err(struct mmc_blk_data *md, struct mmc_card *card,
 
 		blocks = mmc_sd_num_wr_blocks(card);
 		if (blocks != (u32)-1) {
-			ret = blk_end_request(req, 0, blocks << 9);
+			ret = mmc_queue_end_request(req, 0, blocks << 9);
 		}
 	} else {
 		if (!mmc_packed_cmd(mq_rq->cmd_type))
-			ret = blk_end_request(req, 0, brq->data.bytes_xfered);
+			ret = mmc_queue_end_request(req, 0,
+						    brq->data.bytes_xfered);
 	}
 	return ret;
 }
@@ -1789,7 +1941,7 @@ static int mmc_blk_end_packed_req(struct mmc_queue_req *mq_rq)
 			return ret;
 		}
 		list_del_init(&prq->queuelist);
-		blk_end_request(prq, 0, blk_rq_bytes(prq));
+		mmc_queue_end_request(prq, 0, blk_rq_bytes(prq));
 		i++;
 	}
 
@@ -1807,7 +1959,7 @@ static void mmc_blk_abort_packed_req(struct mmc_queue_req *mq_rq)
 	while (!list_empty(&packed->list)) {
 		prq = list_entry_rq(packed->list.next);
 		list_del_init(&prq->queuelist);
-		blk_end_request(prq, -EIO, blk_rq_bytes(prq));
+		mmc_queue_end_request(prq, -EIO, blk_rq_bytes(prq));
 	}
 
 	mmc_blk_clear_packed(mq_rq);
@@ -1827,7 +1979,7 @@ static void mmc_blk_revert_packed_req(struct mmc_queue *mq,
 		if (prq->queuelist.prev != &packed->list) {
 			list_del_init(&prq->queuelist);
 			spin_lock_irq(q->queue_lock);
-			blk_requeue_request(mq->queue, prq);
+			mmc_queue_requeue(mq, prq);
 			spin_unlock_irq(q->queue_lock);
 		} else {
 			list_del_init(&prq->queuelist);
@@ -1903,7 +2055,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 				ret = mmc_blk_end_packed_req(mq_rq);
 				break;
 			} else {
-				ret = blk_end_request(req, 0,
+				ret = mmc_queue_end_request(req, 0,
 						brq->data.bytes_xfered);
 			}
 
@@ -1960,7 +2112,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 			 * time, so we only reach here after trying to
 			 * read a single sector.
 			 */
-			ret = blk_end_request(req, -EIO,
+			ret = mmc_queue_end_request(req, -EIO,
 						brq->data.blksz);
 			if (!ret)
 				goto start_new_req;
@@ -2004,7 +2156,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 		if (mmc_card_removed(card))
 			req->cmd_flags |= REQ_QUIET;
 		while (ret)
-			ret = blk_end_request(req, -EIO,
+			ret = mmc_queue_end_request(req, -EIO,
 					blk_rq_cur_bytes(req));
 	}
 
@@ -2012,7 +2164,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 	if (rqc) {
 		if (mmc_card_removed(card)) {
 			rqc->cmd_flags |= REQ_QUIET;
-			blk_end_request_all(rqc, -EIO);
+			mmc_queue_end_request_all(rqc, -EIO);
 		} else {
 			/*
 			 * If current request is packed, it needs to put back.
@@ -2045,7 +2197,7 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 	ret = mmc_blk_part_switch(card, md);
 	if (ret) {
 		if (req) {
-			blk_end_request_all(req, -EIO);
+			mmc_queue_end_request_all(req, -EIO);
 		}
 		ret = 0;
 		goto out;
@@ -2320,6 +2472,9 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 			mmc_packed_clean(&md->queue);
 		if (md->disk->flags & GENHD_FL_UP) {
 			device_remove_file(disk_to_dev(md->disk), &md->force_ro);
+			if (md->flags & MMC_BLK_PACKED_CMD)
+				sysfs_remove_group(&disk_to_dev(md->disk)->kobj,
+						   &mmc_blk_packed_attr_group);
 			if ((md->area_type & MMC_BLK_DATA_AREA_BOOT) &&
 					card->ext_csd.boot_ro_lockable)
 				device_remove_file(disk_to_dev(md->disk),
@@ -2380,8 +2535,19 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 		if (ret)
 			goto power_ro_lock_fail;
 	}
+
+	if (md->flags & MMC_BLK_PACKED_CMD) {
+		ret = sysfs_create_group(&disk_to_dev(md->disk)->kobj,
+					 &mmc_blk_packed_attr_group);
+		if (ret)
+			goto packed_attrs_fail;
+	}
 	return ret;
 
+packed_attrs_fail:
+	if ((md->area_type & MMC_BLK_DATA_AREA_BOOT) &&
+	    card->ext_csd.boot_ro_lockable)
+		device_remove_file(disk_to_dev(md->disk), &md->power_ro_lock);
 power_ro_lock_fail:
 	device_remove_file(disk_to_dev(md->disk), &md->force_ro);
 force_ro_fail:
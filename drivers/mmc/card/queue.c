@@ -23,6 +23,13 @@
 
 #define MMC_QUEUE_BOUNCESZ	65536
 
+/* Requests blk-mq may hand out before ->queue_rq() has to push back */
+#define MMC_QUEUE_MQ_DEPTH	64
+
+static bool use_blk_mq = IS_ENABLED(CONFIG_MMC_BLOCK_MQ);
+module_param(use_blk_mq, bool, 0444);
+MODULE_PARM_DESC(use_blk_mq, "Use blk-mq for MMC block queues");
+
 /*
  * Prepare a MMC request. This just filters out odd stuff.
  */
@@ -60,7 +67,7 @@ static int mmc_queue_thread(void *d)
 
 		spin_lock_irq(q->queue_lock);
 		set_current_state(TASK_INTERRUPTIBLE);
-		req = blk_fetch_request(q);
+		req = mmc_queue_fetch(mq);
 		mq->mqrq_cur->req = req;
 		spin_unlock_irq(q->queue_lock);
 
@@ -102,27 +109,76 @@ static int mmc_queue_thread(void *d)
 	return 0;
 }
 
-/*
- * Generic MMC request handler.  This is called for any queue on a
- * particular host.  When the host is not busy, we look for a request
- * on any queue on this host, and attempt to issue it.  This may
- * not be the queue we were asked to process.
+/**
+ * mmc_queue_fetch - take the next request to issue
+ * @mq: MMC queue
+ *
+ * Called with the queue lock held.
  */
-static void mmc_request_fn(struct request_queue *q)
+struct request *mmc_queue_fetch(struct mmc_queue *mq)
 {
-	struct mmc_queue *mq = q->queuedata;
 	struct request *req;
+
+	if (!mq->use_mq)
+		return blk_fetch_request(mq->queue);
+
+	if (list_empty(&mq->mq_list))
+		return NULL;
+
+	req = list_first_entry(&mq->mq_list, struct request, queuelist);
+	list_del_init(&req->queuelist);
+	return req;
+}
+
+/**
+ * mmc_queue_requeue - put a fetched request back in front of the queue
+ * @mq: MMC queue
+ * @req: request returned by mmc_queue_fetch()
+ *
+ * Called with the queue lock held.
+ */
+void mmc_queue_requeue(struct mmc_queue *mq, struct request *req)
+{
+	if (!mq->use_mq)
+		blk_requeue_request(mq->queue, req);
+	else
+		list_add(&req->queuelist, &mq->mq_list);
+}
+
+/*
+ * Same as blk_end_request() and blk_end_request_all(), for both kinds of
+ * request queue.
+ */
+bool mmc_queue_end_request(struct request *req, int error,
+			   unsigned int nr_bytes)
+{
+	if (!req->q->mq_ops)
+		return blk_end_request(req, error, nr_bytes);
+
+	if (blk_update_request(req, error, nr_bytes))
+		return true;
+
+	__blk_mq_end_request(req, error);
+	return false;
+}
+
+void mmc_queue_end_request_all(struct request *req, int error)
+{
+	if (!req->q->mq_ops)
+		blk_end_request_all(req, error);
+	else
+		blk_mq_end_request(req, error);
+}
+
+/*
+ * Let the queue thread know that there is a new request, whether it is
+ * idle or waiting for the previous request to complete.
+ */
+static void mmc_queue_kick(struct mmc_queue *mq)
+{
 	unsigned long flags;
 	struct mmc_context_info *cntx;
 
-	if (!mq) {
-		while ((req = blk_fetch_request(q)) != NULL) {
-			req->cmd_flags |= REQ_QUIET;
-			__blk_end_request_all(req, -EIO);
-		}
-		return;
-	}
-
 	cntx = &mq->card->host->context_info;
 	if (!mq->mqrq_cur->req && mq->mqrq_prev->req) {
 		/*
@@ -140,6 +196,88 @@ static void mmc_request_fn(struct request_queue *q)
 		wake_up_process(mq->thread);
 }
 
+/*
+ * Generic MMC request handler.  This is called for any queue on a
+ * particular host.  When the host is not busy, we look for a request
+ * on any queue on this host, and attempt to issue it.  This may
+ * not be the queue we were asked to process.
+ */
+static void mmc_request_fn(struct request_queue *q)
+{
+	struct mmc_queue *mq = q->queuedata;
+	struct request *req;
+
+	if (!mq) {
+		while ((req = blk_fetch_request(q)) != NULL) {
+			req->cmd_flags |= REQ_QUIET;
+			__blk_end_request_all(req, -EIO);
+		}
+		return;
+	}
+
+	mmc_queue_kick(mq);
+}
+
+static int mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
+			   const struct blk_mq_queue_data *bd)
+{
+	struct request_queue *q = hctx->queue;
+	struct mmc_queue *mq = q->queuedata;
+	struct request *req = bd->rq;
+	unsigned long flags;
+
+	if (!mq || mmc_prep_request(q, req) != BLKPREP_OK) {
+		req->cmd_flags |= REQ_QUIET;
+		return BLK_MQ_RQ_QUEUE_ERROR;
+	}
+
+	blk_mq_start_request(req);
+
+	spin_lock_irqsave(q->queue_lock, flags);
+	list_add_tail(&req->queuelist, &mq->mq_list);
+	mmc_queue_kick(mq);
+	spin_unlock_irqrestore(q->queue_lock, flags);
+
+	return BLK_MQ_RQ_QUEUE_OK;
+}
+
+static struct blk_mq_ops mmc_mq_ops = {
+	.queue_rq	= mmc_mq_queue_rq,
+	.map_queue	= blk_mq_map_queue,
+};
+
+/*
+ * One hardware queue per card queue: the host runs one request at a time
+ * anyway, and the queue thread keeps the next one prepared in parallel.
+ */
+static struct request_queue *mmc_mq_init_queue(struct mmc_queue *mq)
+{
+	struct request_queue *q;
+	int ret;
+
+	memset(&mq->tag_set, 0, sizeof(mq->tag_set));
+	mq->tag_set.ops = &mmc_mq_ops;
+	mq->tag_set.nr_hw_queues = 1;
+	mq->tag_set.queue_depth = MMC_QUEUE_MQ_DEPTH;
+	mq->tag_set.numa_node = NUMA_NO_NODE;
+	mq->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_SG_MERGE;
+	mq->tag_set.driver_data = mq;
+
+	ret = blk_mq_alloc_tag_set(&mq->tag_set);
+	if (ret)
+		return NULL;
+
+	q = blk_mq_init_queue(&mq->tag_set);
+	if (IS_ERR(q)) {
+		blk_mq_free_tag_set(&mq->tag_set);
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&mq->mq_list);
+	mq->use_mq = true;
+	return q;
+}
+
 static struct scatterlist *mmc_alloc_sg(int sg_len, int *err)
 {
 	struct scatterlist *sg;
@@ -198,7 +336,10 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 		limit = (u64)dma_max_pfn(mmc_dev(host)) << PAGE_SHIFT;
 
 	mq->card = card;
-	mq->queue = blk_init_queue(mmc_request_fn, lock);
+	if (use_blk_mq)
+		mq->queue = mmc_mq_init_queue(mq);
+	else
+		mq->queue = blk_init_queue(mmc_request_fn, lock);
 	if (!mq->queue)
 		return -ENOMEM;
 
@@ -206,7 +347,8 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 	mq->mqrq_prev = mqrq_prev;
 	mq->queue->queuedata = mq;
 
-	blk_queue_prep_rq(mq->queue, mmc_prep_request);
+	if (!mq->use_mq)
+		blk_queue_prep_rq(mq->queue, mmc_prep_request);
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
 	queue_flag_clear_unlocked(QUEUE_FLAG_ADD_RANDOM, mq->queue);
 	if (mmc_can_erase(card))
@@ -314,10 +456,21 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 	kfree(mqrq_prev->bounce_buf);
 	mqrq_prev->bounce_buf = NULL;
 
-	blk_cleanup_queue(mq->queue);
+	mmc_free_queue(mq);
 	return ret;
 }
 
+/**
+ * mmc_free_queue - release the request queue of a cleaned up MMC queue
+ * @mq: MMC queue
+ */
+void mmc_free_queue(struct mmc_queue *mq)
+{
+	blk_cleanup_queue(mq->queue);
+	if (mq->use_mq)
+		blk_mq_free_tag_set(&mq->tag_set);
+}
+
 void mmc_cleanup_queue(struct mmc_queue *mq)
 {
 	struct request_queue *q = mq->queue;
@@ -332,10 +485,29 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	kthread_stop(mq->thread);
 
 	/* Empty the queue */
-	spin_lock_irqsave(q->queue_lock, flags);
-	q->queuedata = NULL;
-	blk_start_queue(q);
-	spin_unlock_irqrestore(q->queue_lock, flags);
+	if (mq->use_mq) {
+		struct request *req;
+		LIST_HEAD(abort);
+
+		spin_lock_irqsave(q->queue_lock, flags);
+		q->queuedata = NULL;
+		list_splice_init(&mq->mq_list, &abort);
+		spin_unlock_irqrestore(q->queue_lock, flags);
+
+		while (!list_empty(&abort)) {
+			req = list_first_entry(&abort, struct request,
+					       queuelist);
+			list_del_init(&req->queuelist);
+			req->cmd_flags |= REQ_QUIET;
+			blk_mq_end_request(req, -EIO);
+		}
+		blk_mq_start_stopped_hw_queues(q, true);
+	} else {
+		spin_lock_irqsave(q->queue_lock, flags);
+		q->queuedata = NULL;
+		blk_start_queue(q);
+		spin_unlock_irqrestore(q->queue_lock, flags);
+	}
 
 	kfree(mqrq_cur->bounce_sg);
 	mqrq_cur->bounce_sg = NULL;
@@ -418,9 +590,13 @@ void mmc_queue_suspend(struct mmc_queue *mq)
 	if (!(mq->flags & MMC_QUEUE_SUSPENDED)) {
 		mq->flags |= MMC_QUEUE_SUSPENDED;
 
-		spin_lock_irqsave(q->queue_lock, flags);
-		blk_stop_queue(q);
-		spin_unlock_irqrestore(q->queue_lock, flags);
+		if (mq->use_mq) {
+			blk_mq_stop_hw_queues(q);
+		} else {
+			spin_lock_irqsave(q->queue_lock, flags);
+			blk_stop_queue(q);
+			spin_unlock_irqrestore(q->queue_lock, flags);
+		}
 
 		down(&mq->thread_sem);
 	}
@@ -440,9 +616,13 @@ void mmc_queue_resume(struct mmc_queue *mq)
 
 		up(&mq->thread_sem);
 
-		spin_lock_irqsave(q->queue_lock, flags);
-		blk_start_queue(q);
-		spin_unlock_irqrestore(q->queue_lock, flags);
+		if (mq->use_mq) {
+			blk_mq_start_stopped_hw_queues(q, true);
+		} else {
+			spin_lock_irqsave(q->queue_lock, flags);
+			blk_start_queue(q);
+			spin_unlock_irqrestore(q->queue_lock, flags);
+		}
 	}
 }
 
@@ -1,6 +1,8 @@
 #ifndef MMC_QUEUE_H
 #define MMC_QUEUE_H
 
+#include <linux/blk-mq.h>
+
 #define MMC_REQ_SPECIAL_MASK	(REQ_DISCARD | REQ_FLUSH)
 
 struct request;
@@ -58,11 +60,20 @@ struct mmc_queue {
 	struct mmc_queue_req	mqrq[2];
 	struct mmc_queue_req	*mqrq_cur;
 	struct mmc_queue_req	*mqrq_prev;
+
+	/*
+	 * With blk-mq, ->queue_rq() only moves requests to mq_list, under
+	 * the queue lock, and the queue thread issues them from there.
+	 */
+	bool			use_mq;
+	struct blk_mq_tag_set	tag_set;
+	struct list_head	mq_list;
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
 			  const char *);
 extern void mmc_cleanup_queue(struct mmc_queue *);
+extern void mmc_free_queue(struct mmc_queue *);
 extern void mmc_queue_suspend(struct mmc_queue *);
 extern void mmc_queue_resume(struct mmc_queue *);
 
@@ -71,6 +82,11 @@ extern unsigned int mmc_queue_map_sg(struct mmc_queue *,
 extern void mmc_queue_bounce_pre(struct mmc_queue_req *);
 extern void mmc_queue_bounce_post(struct mmc_queue_req *);
 
+extern struct request *mmc_queue_fetch(struct mmc_queue *);
+extern void mmc_queue_requeue(struct mmc_queue *, struct request *);
+extern bool mmc_queue_end_request(struct request *, int, unsigned int);
+extern void mmc_queue_end_request_all(struct request *, int);
+
 extern int mmc_packed_init(struct mmc_queue *, struct mmc_card *);
 extern void mmc_packed_clean(struct mmc_queue *);
 
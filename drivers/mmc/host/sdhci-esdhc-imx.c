@@ -19,6 +19,7 @@
 #include <linux/gpio.h>
 #include <linux/module.h>
 #include <linux/slab.h>
+#include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
 #include <linux/mmc/mmc.h>
 #include <linux/mmc/sdio.h>
@@ -32,6 +33,9 @@
 #include "sdhci-pltfm.h"
 #include "sdhci-esdhc.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/esdhc_imx.h>
+
 #define ESDHC_SYS_CTRL_DTOCV_MASK	0x0f
 #define	ESDHC_CTRL_D3CD			0x08
 #define ESDHC_BURST_LEN_EN_INCR		(1 << 27)
@@ -238,6 +242,11 @@ struct pltfm_imx_data {
 		WAIT_FOR_INT,        /* sent CMD12, waiting for response INT */
 	} multiblock_status;
 	u32 is_ddr;
+	/* result of the last successful manual tuning */
+	bool tuning_cached;
+	bool tuned_cid_valid;
+	u32 tuned_delay;
+	u32 tuned_cid[4];
 };
 
 static const struct platform_device_id imx_esdhc_devtype[] = {
@@ -706,6 +715,7 @@ static inline void esdhc_pltfm_set_clock(struct sdhci_host *host,
 			writel(val & ~ESDHC_VENDOR_SPEC_FRC_SDCLK_ON,
 					host->ioaddr + ESDHC_VENDOR_SPEC);
 		}
+		trace_esdhc_set_clock(host->mmc, 0);
 		return;
 	}
 
@@ -733,6 +743,7 @@ static inline void esdhc_pltfm_set_clock(struct sdhci_host *host,
 	host->mmc->actual_clock = host_clock / pre_div / div;
 	dev_dbg(mmc_dev(host->mmc), "desired SD clock: %d, actual: %d\n",
 		clock, host->mmc->actual_clock);
+	trace_esdhc_set_clock(host->mmc, clock);
 
 	if (imx_data->is_ddr)
 		pre_div >>= 2;
@@ -821,10 +832,69 @@ static void esdhc_post_tuning(struct sdhci_host *host)
 	writel(reg, host->ioaddr + ESDHC_MIX_CTRL);
 }
 
+/*
+ * The delay cell found by tuning only depends on the card and the board, so
+ * it is remembered and tried first the next time tuning is needed (resume,
+ * power cycle). The cache is dropped when the card has a different CID or
+ * when the core asks for re-tuning, which it does after CRC errors.
+ */
+static bool esdhc_tuning_cache_valid(struct sdhci_host *host)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct pltfm_imx_data *imx_data = pltfm_host->priv;
+	struct mmc_card *card = host->mmc->card;
+
+	if (host->mmc->doing_retune)
+		imx_data->tuning_cached = false;
+
+	if (card && imx_data->tuned_cid_valid &&
+	    memcmp(card->raw_cid, imx_data->tuned_cid,
+		   sizeof(imx_data->tuned_cid)))
+		imx_data->tuning_cached = false;
+
+	return imx_data->tuning_cached;
+}
+
+static void esdhc_tuning_cache_store(struct sdhci_host *host, u32 delay)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct pltfm_imx_data *imx_data = pltfm_host->priv;
+	struct mmc_card *card = host->mmc->card;
+
+	imx_data->tuned_delay = delay;
+	imx_data->tuning_cached = true;
+
+	/* the card is not known yet while it is first initialized */
+	imx_data->tuned_cid_valid = !!card;
+	if (card)
+		memcpy(imx_data->tuned_cid, card->raw_cid,
+		       sizeof(imx_data->tuned_cid));
+}
+
 static int esdhc_executing_tuning(struct sdhci_host *host, u32 opcode)
 {
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct pltfm_imx_data *imx_data = pltfm_host->priv;
+	u64 start = trace_esdhc_tuning_enabled() ? local_clock() : 0;
 	int min, max, avg, ret;
 
+	/* a single tuning block is enough to check the cached delay */
+	if (esdhc_tuning_cache_valid(host)) {
+		avg = imx_data->tuned_delay;
+		esdhc_prepare_tuning(host, avg);
+		ret = mmc_send_tuning(host->mmc);
+		esdhc_post_tuning(host);
+		if (!ret) {
+			esdhc_tuning_cache_store(host, avg);
+			dev_dbg(mmc_dev(host->mmc),
+				"tunning reused cached delay 0x%x\n", avg);
+			trace_esdhc_tuning(host->mmc, opcode, avg, true,
+					   local_clock() - start, 0);
+			return 0;
+		}
+		imx_data->tuning_cached = false;
+	}
+
 	/* find the mininum delay first which can pass tuning */
 	min = ESDHC_TUNE_CTRL_MIN;
 	while (min < ESDHC_TUNE_CTRL_MAX) {
@@ -854,6 +924,11 @@ static int esdhc_executing_tuning(struct sdhci_host *host, u32 opcode)
 	dev_dbg(mmc_dev(host->mmc), "tunning %s at 0x%x ret %d\n",
 		ret ? "failed" : "passed", avg, ret);
 
+	if (!ret)
+		esdhc_tuning_cache_store(host, avg);
+
+	trace_esdhc_tuning(host->mmc, opcode, avg, false,
+			   local_clock() - start, ret);
 	return ret;
 }
 
@@ -1088,6 +1163,12 @@ sdhci_esdhc_imx_probe_dt(struct platform_device *pdev,
 	if (of_property_read_u32(np, "fsl,delay-line", &boarddata->delay_line))
 		boarddata->delay_line = 0;
 
+	/* delay cell found by the bootloader, checked before it is used */
+	if (!of_property_read_u32(np, "fsl,tuning-delay-cell",
+				  &imx_data->tuned_delay) &&
+	    imx_data->tuned_delay <= ESDHC_TUNE_CTRL_MAX)
+		imx_data->tuning_cached = true;
+
 	mmc_of_parse_voltage(np, &host->ocr_mask);
 
 	/* sdr50 and sdr104 needs work on 1.8v signal voltage */
@@ -1120,7 +1201,13 @@ sdhci_esdhc_imx_probe_dt(struct platform_device *pdev,
 
 	if (of_get_property(np, "wifi-host", NULL)) {
 		wifi_mmc_host = host->mmc;
-		host->quirks2 |= SDHCI_QUIRK2_SDIO_IRQ_THREAD;
+		/*
+		 * The in-band interrupt of the Wi-Fi card goes through the
+		 * sdio_irq kthread, unless the board says its card copes with
+		 * being serviced straight from the host's threaded handler.
+		 */
+		if (!of_property_read_bool(np, "fsl,sdio-async-irq"))
+			host->quirks2 |= SDHCI_QUIRK2_SDIO_IRQ_THREAD;
 		dev_info(mmc_dev(host->mmc), "assigned as wifi host\n");
 	}
 
@@ -1334,6 +1421,9 @@ static int sdhci_esdhc_imx_probe(struct platform_device *pdev)
 	pm_suspend_ignore_children(&pdev->dev, 1);
 	pm_runtime_enable(&pdev->dev);
 
+	/* card re-initialisation is slow, do not serialise it */
+	device_enable_async_suspend(&pdev->dev);
+
 	return 0;
 
 disable_clk:
@@ -1407,6 +1497,21 @@ int sdhci_esdhc_resume(struct device *dev)
 }
 #endif
 
+/*
+ * Quiesce the controller for a kexec'd kernel: no interrupts and no
+ * ADMA in flight.  It stays resumed, nothing may use it any more.
+ */
+static void sdhci_esdhc_imx_shutdown(struct platform_device *pdev)
+{
+	struct sdhci_host *host = platform_get_drvdata(pdev);
+
+	pm_runtime_get_sync(&pdev->dev);
+
+	sdhci_writel(host, 0, SDHCI_INT_ENABLE);
+	sdhci_writel(host, 0, SDHCI_SIGNAL_ENABLE);
+	host->ops->reset(host, SDHCI_RESET_ALL);
+}
+
 #ifdef CONFIG_PM
 static int sdhci_esdhc_runtime_suspend(struct device *dev)
 {
@@ -1459,10 +1564,13 @@ static struct platform_driver sdhci_esdhc_imx_driver = {
 		.name	= "sdhci-esdhc-imx",
 		.of_match_table = imx_esdhc_dt_ids,
 		.pm	= &sdhci_esdhc_pmops,
+		/* the root mount waits for outstanding probes */
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.id_table	= imx_esdhc_devtype,
 	.probe		= sdhci_esdhc_imx_probe,
 	.remove		= sdhci_esdhc_imx_remove,
+	.shutdown	= sdhci_esdhc_imx_shutdown,
 };
 
 module_platform_driver(sdhci_esdhc_imx_driver);
@@ -467,11 +467,29 @@ static void sdhci_adma_mark_end(void *desc)
 	dma_desc->cmd |= cpu_to_le16(ADMA2_END);
 }
 
-static int sdhci_adma_table_pre(struct sdhci_host *host,
-	struct mmc_data *data)
+static void *sdhci_adma_slot_table(struct sdhci_host *host, int slot)
 {
-	int direction;
+	return host->adma_table + slot * host->adma_table_sz;
+}
+
+static dma_addr_t sdhci_adma_slot_addr(struct sdhci_host *host, int slot)
+{
+	return host->adma_addr + slot * host->adma_table_sz;
+}
 
+static void *sdhci_adma_slot_align(struct sdhci_host *host, int slot)
+{
+	return host->align_buffer + slot * host->align_buffer_sz;
+}
+
+/*
+ * Write the descriptor table of ADMA slot @slot for @data, whose scatterlist
+ * is mapped to @sg_count entries. The tables and bounce buffers are coherent
+ * memory, so nothing has to be synced afterwards.
+ */
+static void sdhci_adma_table_build(struct sdhci_host *host,
+	struct mmc_data *data, int slot, int sg_count)
+{
 	void *desc;
 	void *align;
 	dma_addr_t addr;
@@ -488,27 +506,12 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	 * We currently guess that it is LE.
 	 */
 
-	if (data->flags & MMC_DATA_READ)
-		direction = DMA_FROM_DEVICE;
-	else
-		direction = DMA_TO_DEVICE;
+	desc = sdhci_adma_slot_table(host, slot);
+	align = sdhci_adma_slot_align(host, slot);
 
-	host->align_addr = dma_map_single(mmc_dev(host->mmc),
-		host->align_buffer, host->align_buffer_sz, direction);
-	if (dma_mapping_error(mmc_dev(host->mmc), host->align_addr))
-		goto fail;
-	BUG_ON(host->align_addr & host->align_mask);
-
-	host->sg_count = sdhci_pre_dma_transfer(host, data);
-	if (host->sg_count < 0)
-		goto unmap_align;
+	align_addr = host->align_addr + slot * host->align_buffer_sz;
 
-	desc = host->adma_table;
-	align = host->align_buffer;
-
-	align_addr = host->align_addr;
-
-	for_each_sg(data->sg, sg, host->sg_count, i) {
+	for_each_sg(data->sg, sg, sg_count, i) {
 		addr = sg_dma_address(sg);
 		len = sg_dma_len(sg);
 
@@ -553,14 +556,15 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 		 * If this triggers then we have a calculation bug
 		 * somewhere. :/
 		 */
-		WARN_ON((desc - host->adma_table) >= host->adma_table_sz);
+		WARN_ON((desc - sdhci_adma_slot_table(host, slot)) >=
+			host->adma_table_sz);
 	}
 
 	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
 		/*
 		* Mark the last descriptor as the terminating descriptor
 		*/
-		if (desc != host->adma_table) {
+		if (desc != sdhci_adma_slot_table(host, slot)) {
 			desc -= host->desc_sz;
 			sdhci_adma_mark_end(desc);
 		}
@@ -572,22 +576,29 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 		/* nop, end, valid */
 		sdhci_adma_write_desc(host, desc, 0, 0, ADMA2_NOP_END_VALID);
 	}
+}
 
-	/*
-	 * Resync align buffer as we might have changed it.
-	 */
-	if (data->flags & MMC_DATA_WRITE) {
-		dma_sync_single_for_device(mmc_dev(host->mmc),
-			host->align_addr, host->align_buffer_sz, direction);
+static int sdhci_adma_table_pre(struct sdhci_host *host,
+	struct mmc_data *data)
+{
+	/* The table may already have been written by sdhci_pre_req() */
+	if (data == host->adma_pre_data) {
+		host->adma_pre_data = NULL;
+		host->adma_slot = host->adma_pre_slot;
+		host->sg_count = sdhci_pre_dma_transfer(host, data);
+		return host->sg_count < 0 ? -EINVAL : 0;
 	}
 
-	return 0;
+	/* Leave the slot prepared for the next request alone */
+	if (host->adma_pre_data)
+		host->adma_slot = host->adma_pre_slot ^ 1;
+
+	host->sg_count = sdhci_pre_dma_transfer(host, data);
+	if (host->sg_count < 0)
+		return -EINVAL;
 
-unmap_align:
-	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
-		host->align_buffer_sz, direction);
-fail:
-	return -EINVAL;
+	sdhci_adma_table_build(host, data, host->adma_slot, host->sg_count);
+	return 0;
 }
 
 static void sdhci_adma_table_post(struct sdhci_host *host,
@@ -607,9 +618,6 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 	else
 		direction = DMA_TO_DEVICE;
 
-	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
-		host->align_buffer_sz, direction);
-
 	/* Do a quick scan of the SG list for any unaligned mappings */
 	has_unaligned = false;
 	for_each_sg(data->sg, sg, host->sg_count, i)
@@ -622,7 +630,7 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 		dma_sync_sg_for_cpu(mmc_dev(host->mmc), data->sg,
 			data->sg_len, direction);
 
-		align = host->align_buffer;
+		align = sdhci_adma_slot_align(host, host->adma_slot);
 
 		for_each_sg(data->sg, sg, host->sg_count, i) {
 			if (sg_dma_address(sg) & host->align_mask) {
@@ -828,11 +836,12 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 				WARN_ON(1);
 				host->flags &= ~SDHCI_REQ_USE_DMA;
 			} else {
-				sdhci_writel(host, host->adma_addr,
-					SDHCI_ADMA_ADDRESS);
+				dma_addr_t addr = sdhci_adma_slot_addr(host,
+							host->adma_slot);
+
+				sdhci_writel(host, addr, SDHCI_ADMA_ADDRESS);
 				if (host->flags & SDHCI_USE_64_BIT_DMA)
-					sdhci_writel(host,
-						     (u64)host->adma_addr >> 32,
+					sdhci_writel(host, (u64)addr >> 32,
 						     SDHCI_ADMA_ADDRESS_HI);
 			}
 		} else {
@@ -2118,6 +2127,10 @@ static void sdhci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
 	struct sdhci_host *host = mmc_priv(mmc);
 	struct mmc_data *data = mrq->data;
 
+	/* A prepared request may be dropped without being issued */
+	if (data == host->adma_pre_data)
+		host->adma_pre_data = NULL;
+
 	if (host->flags & SDHCI_REQ_USE_DMA) {
 		if (data->host_cookie == COOKIE_GIVEN ||
 				data->host_cookie == COOKIE_MAPPED)
@@ -2157,11 +2170,28 @@ static void sdhci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
 			       bool is_first_req)
 {
 	struct sdhci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	int sg_count;
 
-	mrq->data->host_cookie = COOKIE_UNMAPPED;
+	data->host_cookie = COOKIE_UNMAPPED;
 
-	if (host->flags & SDHCI_REQ_USE_DMA)
-		sdhci_pre_dma_transfer(host, mrq->data);
+	if (!(host->flags & SDHCI_REQ_USE_DMA))
+		return;
+
+	sg_count = sdhci_pre_dma_transfer(host, data);
+
+	/*
+	 * Write the ADMA table now, while the current request is still in
+	 * flight, into the slot the current request does not use.
+	 */
+	if (sg_count > 0 && (host->flags & SDHCI_USE_ADMA) &&
+	    !(host->quirks & SDHCI_QUIRK_32BIT_ADMA_SIZE)) {
+		int slot = host->adma_slot ^ 1;
+
+		sdhci_adma_table_build(host, data, slot, sg_count);
+		host->adma_pre_slot = slot;
+		host->adma_pre_data = data;
+	}
 }
 
 static void sdhci_card_event(struct mmc_host *mmc)
@@ -2388,7 +2418,7 @@ static void sdhci_cmd_irq(struct sdhci_host *host, u32 intmask, u32 *mask)
 static void sdhci_adma_show_error(struct sdhci_host *host)
 {
 	const char *name = mmc_hostname(host->mmc);
-	void *desc = host->adma_table;
+	void *desc = sdhci_adma_slot_table(host, host->adma_slot);
 
 	sdhci_dumpregs(host);
 
@@ -3001,32 +3031,35 @@ int sdhci_add_host(struct sdhci_host *host)
 			host->align_sz = SDHCI_ADMA2_32_ALIGN;
 			host->align_mask = SDHCI_ADMA2_32_ALIGN - 1;
 		}
+		/*
+		 * All descriptor tables followed by all bounce buffers in one
+		 * coherent allocation, so that the bounce buffers need not be
+		 * mapped and synced for every request.
+		 */
+		host->adma_table_sz = ALIGN(host->adma_table_sz,
+					    host->align_sz);
 		host->adma_table = dma_alloc_coherent(mmc_dev(mmc),
-						      host->adma_table_sz,
-						      &host->adma_addr,
-						      GFP_KERNEL);
-		host->align_buffer = kmalloc(host->align_buffer_sz, GFP_KERNEL);
-		if (!host->adma_table || !host->align_buffer) {
-			if (host->adma_table)
-				dma_free_coherent(mmc_dev(mmc),
-						  host->adma_table_sz,
-						  host->adma_table,
-						  host->adma_addr);
-			kfree(host->align_buffer);
+				SDHCI_ADMA_SLOTS * (host->adma_table_sz +
+						    host->align_buffer_sz),
+				&host->adma_addr, GFP_KERNEL);
+		if (!host->adma_table) {
 			pr_warn("%s: Unable to allocate ADMA buffers - falling back to standard DMA\n",
 				mmc_hostname(mmc));
 			host->flags &= ~SDHCI_USE_ADMA;
-			host->adma_table = NULL;
-			host->align_buffer = NULL;
 		} else if (host->adma_addr & host->align_mask) {
 			pr_warn("%s: unable to allocate aligned ADMA descriptor\n",
 				mmc_hostname(mmc));
 			host->flags &= ~SDHCI_USE_ADMA;
-			dma_free_coherent(mmc_dev(mmc), host->adma_table_sz,
-					  host->adma_table, host->adma_addr);
-			kfree(host->align_buffer);
+			dma_free_coherent(mmc_dev(mmc),
+				SDHCI_ADMA_SLOTS * (host->adma_table_sz +
+						    host->align_buffer_sz),
+				host->adma_table, host->adma_addr);
 			host->adma_table = NULL;
-			host->align_buffer = NULL;
+		} else {
+			host->align_buffer = host->adma_table +
+				SDHCI_ADMA_SLOTS * host->adma_table_sz;
+			host->align_addr = host->adma_addr +
+				SDHCI_ADMA_SLOTS * host->adma_table_sz;
 		}
 	}
 
@@ -3485,9 +3518,10 @@ void sdhci_remove_host(struct sdhci_host *host, int dead)
 		regulator_disable(mmc->supply.vqmmc);
 
 	if (host->adma_table)
-		dma_free_coherent(mmc_dev(mmc), host->adma_table_sz,
+		dma_free_coherent(mmc_dev(mmc),
+				  SDHCI_ADMA_SLOTS * (host->adma_table_sz +
+						      host->align_buffer_sz),
 				  host->adma_table, host->adma_addr);
-	kfree(host->align_buffer);
 
 	host->adma_table = NULL;
 	host->align_buffer = NULL;
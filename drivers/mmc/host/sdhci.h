@@ -310,6 +310,12 @@ struct sdhci_adma2_64_desc {
  */
 #define SDHCI_MAX_SEGS		128
 
+/*
+ * ADMA descriptor tables and bounce buffers: one for the request in flight
+ * and one for the next request, prepared in ->pre_req().
+ */
+#define SDHCI_ADMA_SLOTS	2
+
 enum sdhci_cookie {
 	COOKIE_UNMAPPED,
 	COOKIE_MAPPED,
@@ -471,14 +477,18 @@ struct sdhci_host {
 
 	int sg_count;		/* Mapped sg entries */
 
-	void *adma_table;	/* ADMA descriptor table */
-	void *align_buffer;	/* Bounce buffer */
+	void *adma_table;	/* ADMA descriptor tables */
+	void *align_buffer;	/* Bounce buffers */
 
 	size_t adma_table_sz;	/* ADMA descriptor table size */
 	size_t align_buffer_sz;	/* Bounce buffer size */
 
-	dma_addr_t adma_addr;	/* Mapped ADMA descr. table */
-	dma_addr_t align_addr;	/* Mapped bounce buffer */
+	dma_addr_t adma_addr;	/* Mapped ADMA descr. tables */
+	dma_addr_t align_addr;	/* Mapped bounce buffers */
+
+	int adma_slot;		/* ADMA slot of the current request */
+	int adma_pre_slot;	/* ADMA slot prepared for adma_pre_data */
+	struct mmc_data *adma_pre_data;	/* Data with a prepared ADMA table */
 
 	unsigned int desc_sz;	/* ADMA descriptor size */
 	unsigned int align_sz;	/* ADMA alignment */
@@ -23,6 +23,7 @@
 #include <linux/slab.h>
 #include <linux/pm_runtime.h>
 #include <linux/debugfs.h>
+#include <linux/dma/mxs-dma.h>
 
 
 #include "gpmi-nand.h"
@@ -281,6 +282,15 @@ int bch_create_debugfs(struct gpmi_nand_data *this)
 		return -EINVAL;
 	}
 
+	/* how often the ECC path still copies through the bounce buffers */
+	if (!debugfs_create_u32("bounce_reads", S_IRUGO,
+				dbg_root, &this->bounce_reads) ||
+	    !debugfs_create_u32("bounce_writes", S_IRUGO,
+				dbg_root, &this->bounce_writes)) {
+		dev_err(this->dev, "failed to create bounce counters\n");
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -965,11 +975,17 @@ static void gpmi_compute_edo_timing(struct gpmi_nand_data *this,
 	hw->sample_delay_factor = delay;
 }
 
-static int enable_edo_mode(struct gpmi_nand_data *this, int mode)
+/*
+ * Switch the chip to ONFI timing @mode and set up the matching GPMI clock
+ * and timing, which gpmi_begin() applies on the next chip select. Mode 0
+ * goes back to the safe timing used to probe the chip.
+ */
+static int gpmi_set_timing_mode(struct gpmi_nand_data *this, int mode)
 {
 	struct resources  *r = &this->resources;
 	struct nand_chip *nand = &this->nand;
 	struct mtd_info	 *mtd = &this->mtd;
+	const struct nand_sdr_timings *sdr;
 	uint8_t *feature;
 	unsigned long rate;
 	int ret;
@@ -984,63 +1000,128 @@ static int enable_edo_mode(struct gpmi_nand_data *this, int mode)
 	feature[0] = mode;
 	ret = nand->onfi_set_features(mtd, nand,
 				ONFI_FEATURE_ADDR_TIMING_MODE, feature);
-	if (ret)
-		goto err_out;
-
-	/* [2] send GET FEATURE command to double-check the timing mode */
-	memset(feature, 0, ONFI_SUBFEATURE_PARAM_LEN);
-	ret = nand->onfi_get_features(mtd, nand,
+	if (!ret) {
+		/* [2] send GET FEATURE command to double-check the mode */
+		memset(feature, 0, ONFI_SUBFEATURE_PARAM_LEN);
+		ret = nand->onfi_get_features(mtd, nand,
 				ONFI_FEATURE_ADDR_TIMING_MODE, feature);
-	if (ret || feature[0] != mode)
-		goto err_out;
+		if (!ret && feature[0] != mode)
+			ret = -EINVAL;
+	}
 
 	nand->select_chip(mtd, -1);
+	kfree(feature);
+
+	/* the safe timing works whatever mode the chip is left in */
+	if (ret && mode) {
+		dev_err(this->dev, "mode:%d ,failed in set feature.\n", mode);
+		return -EINVAL;
+	}
+
+	/*
+	 * [3] set the main IO clock: 100MHz for mode 5, 80MHz for mode 4
+	 *     (asynchronous EDO), 100MHz for modes 1 to 3, which are derived
+	 *     from the ONFI timing tables with the DLL sample delay.
+	 */
+	if (mode >= 4) {
+		rate = (mode == 5) ? 100000000 : 80000000;
+		this->flags |= GPMI_ASYNC_EDO_ENABLED;
+	} else if (mode) {
+		sdr = onfi_async_timing_mode_to_sdr_timings(mode);
+		if (IS_ERR(sdr))
+			return PTR_ERR(sdr);
+
+		this->timing.data_setup_in_ns =
+			DIV_ROUND_UP(max(sdr->tDS_min, sdr->tWP_min), 1000);
+		this->timing.data_hold_in_ns = DIV_ROUND_UP(
+			max3(sdr->tDH_min, sdr->tWH_min, sdr->tREH_min), 1000);
+		this->timing.address_setup_in_ns = DIV_ROUND_UP(
+			max3(sdr->tCLS_min, sdr->tCS_min, sdr->tALS_min), 1000);
+		this->timing.gpmi_sample_delay_in_ns =
+			this->safe_timing.gpmi_sample_delay_in_ns;
+		this->timing.tREA_in_ns = DIV_ROUND_UP(sdr->tREA_max, 1000);
+		this->timing.tRLOH_in_ns = sdr->tRLOH_min / 1000;
+		this->timing.tRHOH_in_ns = sdr->tRHOH_min / 1000;
+		rate = 100000000;
+		this->flags &= ~GPMI_ASYNC_EDO_ENABLED;
+	} else {
+		this->timing = this->safe_timing;
+		rate = this->safe_clk_rate;
+		this->flags &= ~GPMI_ASYNC_EDO_ENABLED;
+	}
 
 	pm_runtime_get_sync(this->dev);
 	clk_disable_unprepare(r->clock[0]);
-	/* [3] set the main IO clock, 100MHz for mode 5, 80MHz for mode 4. */
-	rate = (mode == 5) ? 100000000 : 80000000;
 	clk_set_rate(r->clock[0], rate);
 	clk_prepare_enable(r->clock[0]);
 	pm_runtime_mark_last_busy(this->dev);
-        pm_runtime_put_autosuspend(this->dev);	
+	pm_runtime_put_autosuspend(this->dev);
 
 	/* Let the gpmi_begin() re-compute the timing again. */
 	this->flags &= ~GPMI_TIMING_INIT_OK;
-
-	this->flags |= GPMI_ASYNC_EDO_ENABLED;
 	this->timing_mode = mode;
-	kfree(feature);
-	dev_info(this->dev, "enable the asynchronous EDO mode %d\n", mode);
 	return 0;
+}
 
-err_out:
+/*
+ * Training pass: read the ONFI parameter page back a few times at the new
+ * timing and compare it with the copy nand_scan_ident() read at the safe
+ * timing.
+ */
+static int gpmi_verify_timing(struct gpmi_nand_data *this)
+{
+	struct nand_chip *nand = &this->nand;
+	struct mtd_info	 *mtd = &this->mtd;
+	size_t len = sizeof(nand->onfi_params);
+	uint8_t *buf;
+	int i, ret = 0;
+
+	buf = kmalloc(len, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	nand->select_chip(mtd, 0);
+	for (i = 0; i < GPMI_TIMING_TRAINING_READS && !ret; i++) {
+		nand->cmdfunc(mtd, NAND_CMD_PARAM, 0, -1);
+		nand->read_buf(mtd, buf, len);
+		if (memcmp(buf, &nand->onfi_params, len))
+			ret = -EIO;
+	}
 	nand->select_chip(mtd, -1);
-	kfree(feature);
-	dev_err(this->dev, "mode:%d ,failed in set feature.\n", mode);
-	return -EINVAL;
+
+	kfree(buf);
+	return ret;
 }
 
 int gpmi_extra_init(struct gpmi_nand_data *this)
 {
 	struct nand_chip *chip = &this->nand;
+	int modes, mode;
 
-	/* Enable the asynchronous EDO feature. */
-	if ((GPMI_IS_MX6(this) || GPMI_IS_MX7(this))
-			&& chip->onfi_version) {
-		int mode = onfi_get_async_timing_mode(chip);
-
-		/* We only support the timing mode 4 and mode 5. */
-		if (mode & ONFI_TIMING_MODE_5)
-			mode = 5;
-		else if (mode & ONFI_TIMING_MODE_4)
-			mode = 4;
-		else
-			return 0;
+	if (!(GPMI_IS_MX6(this) || GPMI_IS_MX7(this)) || !chip->onfi_version)
+		return 0;
+
+	if (!this->safe_clk_rate)
+		this->safe_clk_rate = clk_get_rate(this->resources.clock[0]);
+
+	/* Try the fastest advertised timing mode first, then step down. */
+	modes = onfi_get_async_timing_mode(chip) & GENMASK(5, 0);
+	for (mode = fls(modes) - 1; mode > 0; mode--) {
+		if (!(modes & BIT(mode)))
+			continue;
 
-		return enable_edo_mode(this, mode);
+		if (gpmi_set_timing_mode(this, mode))
+			continue;
+
+		if (!gpmi_verify_timing(this)) {
+			dev_info(this->dev, "enable the asynchronous %s mode %d\n",
+				(mode >= 4) ? "EDO" : "timing", mode);
+			return 0;
+		}
+		dev_warn(this->dev, "timing mode %d failed training\n", mode);
 	}
-	return 0;
+
+	return gpmi_set_timing_mode(this, 0);
 }
 
 /* Begin the I/O */
@@ -1174,7 +1255,8 @@ static inline void set_dma_type(struct gpmi_nand_data *this,
 	this->dma_type = type;
 }
 
-int gpmi_send_command(struct gpmi_nand_data *this)
+static struct dma_async_tx_descriptor *
+gpmi_prep_command(struct gpmi_nand_data *this)
 {
 	struct dma_chan *channel = get_dma_chan(this);
 	struct dma_async_tx_descriptor *desc;
@@ -1195,24 +1277,85 @@ int gpmi_send_command(struct gpmi_nand_data *this)
 					(struct scatterlist *)pio,
 					ARRAY_SIZE(pio), DMA_TRANS_NONE, 0);
 	if (!desc)
-		return -EINVAL;
+		return NULL;
 
 	/* [2] send out the COMMAND + ADDRESS string stored in @buffer */
 	sgl = &this->cmd_sgl;
 
 	sg_init_one(sgl, this->cmd_buffer, this->command_length);
 	dma_map_sg(this->dev, sgl, 1, DMA_TO_DEVICE);
-	desc = dmaengine_prep_slave_sg(channel,
+	return dmaengine_prep_slave_sg(channel,
 				sgl, 1, DMA_MEM_TO_DEV,
 				DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+}
+
+int gpmi_send_command(struct gpmi_nand_data *this)
+{
+	struct dma_async_tx_descriptor *desc;
+	int ret;
+
+	ret = gpmi_flush_command(this);
+	if (ret)
+		return ret;
+
+	desc = gpmi_prep_command(this);
 	if (!desc)
 		return -EINVAL;
 
-	/* [3] submit the DMA */
 	set_dma_type(this, DMA_FOR_COMMAND);
 	return start_dma_without_bch_irq(this, desc);
 }
 
+/*
+ * Prepare the chain for a command that is always followed by a data phase,
+ * the SEQIN of a program, but leave it to that data phase to start it: the
+ * whole transfer then costs one DMA completion instead of two.
+ */
+int gpmi_queue_command(struct gpmi_nand_data *this)
+{
+	struct dma_async_tx_descriptor *desc;
+	int ret;
+
+	ret = gpmi_flush_command(this);
+	if (ret)
+		return ret;
+
+	desc = gpmi_prep_command(this);
+	if (!desc)
+		return -EINVAL;
+
+	this->cmd_desc = desc;
+	return 0;
+}
+
+/* Run a queued command on its own, before anything but its data phase */
+int gpmi_flush_command(struct gpmi_nand_data *this)
+{
+	struct dma_async_tx_descriptor *desc = this->cmd_desc;
+
+	if (!desc)
+		return 0;
+
+	this->cmd_desc = NULL;
+	set_dma_type(this, DMA_FOR_COMMAND);
+	return start_dma_without_bch_irq(this, desc);
+}
+
+/*
+ * Flags for the first descriptor of a data phase.  A queued command is
+ * chained in front of it with the NAND kept locked across the join, and its
+ * buffer is unmapped by the completion of the data phase.
+ */
+static unsigned long gpmi_chain_queued(struct gpmi_nand_data *this)
+{
+	if (!this->cmd_desc)
+		return 0;
+
+	this->cmd_desc = NULL;
+	this->cmd_chained = true;
+	return DMA_PREP_INTERRUPT | MXS_DMA_CTRL_NAND_LOCK;
+}
+
 int gpmi_send_data(struct gpmi_nand_data *this)
 {
 	struct dma_async_tx_descriptor *desc;
@@ -1234,7 +1377,8 @@ int gpmi_send_data(struct gpmi_nand_data *this)
 		| BF_GPMI_CTRL0_XFER_COUNT(this->upper_len);
 	pio[1] = 0;
 	desc = dmaengine_prep_slave_sg(channel, (struct scatterlist *)pio,
-					ARRAY_SIZE(pio), DMA_TRANS_NONE, 0);
+					ARRAY_SIZE(pio), DMA_TRANS_NONE,
+					gpmi_chain_queued(this));
 	if (!desc)
 		return -EINVAL;
 
@@ -1268,7 +1412,8 @@ int gpmi_read_data(struct gpmi_nand_data *this)
 	pio[1] = 0;
 	desc = dmaengine_prep_slave_sg(channel,
 					(struct scatterlist *)pio,
-					ARRAY_SIZE(pio), DMA_TRANS_NONE, 0);
+					ARRAY_SIZE(pio), DMA_TRANS_NONE,
+					gpmi_chain_queued(this));
 	if (!desc)
 		return -EINVAL;
 
@@ -1322,7 +1467,7 @@ int gpmi_send_page(struct gpmi_nand_data *this,
 	desc = dmaengine_prep_slave_sg(channel,
 					(struct scatterlist *)pio,
 					ARRAY_SIZE(pio), DMA_TRANS_NONE,
-					DMA_CTRL_ACK);
+					gpmi_chain_queued(this) | DMA_CTRL_ACK);
 	if (!desc)
 		return -EINVAL;
 
@@ -1356,7 +1501,7 @@ int gpmi_read_page(struct gpmi_nand_data *this,
 	pio[1] = 0;
 	desc = dmaengine_prep_slave_sg(channel,
 				(struct scatterlist *)pio, 2,
-				DMA_TRANS_NONE, 0);
+				DMA_TRANS_NONE, gpmi_chain_queued(this));
 	if (!desc)
 		return -EINVAL;
 
@@ -20,6 +20,7 @@
  */
 #include <linux/clk.h>
 #include <linux/slab.h>
+#include <linux/highmem.h>
 #include <linux/interrupt.h>
 #include <linux/module.h>
 #include <linux/mtd/partitions.h>
@@ -28,9 +29,14 @@
 #include <linux/of_mtd.h>
 #include <linux/busfreq-imx.h>
 #include <linux/pm_runtime.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
 #include "gpmi-nand.h"
 #include "bch-regs.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/gpmi_nand.h>
+
 /* Resource names for the GPMI NAND driver. */
 #define GPMI_NAND_GPMI_REGS_ADDR_RES_NAME  "gpmi-nand"
 #define GPMI_NAND_BCH_REGS_ADDR_RES_NAME   "bch"
@@ -619,6 +625,11 @@ static void dma_irq_callback(void *param)
 	struct gpmi_nand_data *this = param;
 	struct completion *dma_c = &this->dma_done;
 
+	if (this->cmd_chained) {
+		dma_unmap_sg(this->dev, &this->cmd_sgl, 1, DMA_TO_DEVICE);
+		this->cmd_chained = false;
+	}
+
 	switch (this->dma_type) {
 	case DMA_FOR_COMMAND:
 		dma_unmap_sg(this->dev, &this->cmd_sgl, 1, DMA_TO_DEVICE);
@@ -904,19 +915,52 @@ static int init_hardware(struct gpmi_nand_data *this)
 		return ret;
 
 	this->timing = safe_timing;
+	this->safe_timing = safe_timing;
 	return 0;
 }
 
+/*
+ * The BCH engine takes a single payload address, so a vmalloc'ed buffer
+ * (as UBI uses) can only be handed to it directly when the page data lies
+ * within one physical page. The vmalloc alias is maintained explicitly for
+ * the benefit of aliasing (VIVT) caches.
+ */
+static bool gpmi_map_vmalloc(struct gpmi_nand_data *this, void *buf,
+			unsigned length, enum dma_data_direction dir,
+			dma_addr_t *phys)
+{
+	struct device *dev = this->dev;
+
+	if (!is_vmalloc_addr(buf) || offset_in_page(buf) + length > PAGE_SIZE)
+		return false;
+
+	if (dir == DMA_TO_DEVICE)
+		flush_kernel_vmap_range(buf, length);
+	else
+		invalidate_kernel_vmap_range(buf, length);
+
+	*phys = dma_map_page(dev, vmalloc_to_page(buf), offset_in_page(buf),
+				length, dir);
+	return !dma_mapping_error(dev, *phys);
+}
+
 static int read_page_prepare(struct gpmi_nand_data *this,
 			void *destination, unsigned length,
 			void *alt_virt, dma_addr_t alt_phys, unsigned alt_size,
 			void **use_virt, dma_addr_t *use_phys)
 {
 	struct device *dev = this->dev;
+	dma_addr_t dest_phys;
 
-	if (virt_addr_valid(destination)) {
-		dma_addr_t dest_phys;
+	if (gpmi_map_vmalloc(this, destination, length,
+				DMA_FROM_DEVICE, &dest_phys)) {
+		*use_virt = destination;
+		*use_phys = dest_phys;
+		this->direct_dma_map_ok = true;
+		return 0;
+	}
 
+	if (virt_addr_valid(destination)) {
 		dest_phys = dma_map_single(dev, destination,
 						length, DMA_FROM_DEVICE);
 		if (dma_mapping_error(dev, dest_phys)) {
@@ -936,6 +980,7 @@ map_failed:
 	*use_virt = alt_virt;
 	*use_phys = alt_phys;
 	this->direct_dma_map_ok = false;
+	this->bounce_reads++;
 	return 0;
 }
 
@@ -944,8 +989,15 @@ static inline void read_page_end(struct gpmi_nand_data *this,
 			void *alt_virt, dma_addr_t alt_phys, unsigned alt_size,
 			void *used_virt, dma_addr_t used_phys)
 {
-	if (this->direct_dma_map_ok)
+	if (!this->direct_dma_map_ok)
+		return;
+
+	if (is_vmalloc_addr(destination)) {
+		dma_unmap_page(this->dev, used_phys, length, DMA_FROM_DEVICE);
+		invalidate_kernel_vmap_range(destination, length);
+	} else {
 		dma_unmap_single(this->dev, used_phys, length, DMA_FROM_DEVICE);
+	}
 }
 
 static inline void read_page_swap_end(struct gpmi_nand_data *this,
@@ -963,10 +1015,16 @@ static int send_page_prepare(struct gpmi_nand_data *this,
 			const void **use_virt, dma_addr_t *use_phys)
 {
 	struct device *dev = this->dev;
+	dma_addr_t source_phys;
 
-	if (virt_addr_valid(source)) {
-		dma_addr_t source_phys;
+	if (gpmi_map_vmalloc(this, (void *)source, length,
+				DMA_TO_DEVICE, &source_phys)) {
+		*use_virt = source;
+		*use_phys = source_phys;
+		return 0;
+	}
 
+	if (virt_addr_valid(source)) {
 		source_phys = dma_map_single(dev, (void *)source, length,
 						DMA_TO_DEVICE);
 		if (dma_mapping_error(dev, source_phys)) {
@@ -989,6 +1047,7 @@ map_failed:
 
 	*use_virt = alt_virt;
 	*use_phys = alt_phys;
+	this->bounce_writes++;
 	return 0;
 }
 
@@ -998,7 +1057,13 @@ static void send_page_end(struct gpmi_nand_data *this,
 			const void *used_virt, dma_addr_t used_phys)
 {
 	struct device *dev = this->dev;
-	if (used_virt == source)
+
+	if (used_virt != source)
+		return;
+
+	if (is_vmalloc_addr(source))
+		dma_unmap_page(dev, used_phys, length, DMA_TO_DEVICE);
+	else
 		dma_unmap_single(dev, used_phys, length, DMA_TO_DEVICE);
 }
 
@@ -1102,7 +1167,16 @@ static void gpmi_cmd_ctrl(struct mtd_info *mtd, int data, unsigned int ctrl)
 	if (!this->command_length)
 		return;
 
-	ret = gpmi_send_command(this);
+	/*
+	 * The SEQIN that starts a page program is chained with the data that
+	 * follows it.  A read can't be: nand_command_lp() sends READ0 and its
+	 * address, and READSTART after it, as two separate commands, and the
+	 * ready wait in between is a poll of gpmi_dev_ready().
+	 */
+	if (this->cmd_buffer[0] == NAND_CMD_SEQIN)
+		ret = gpmi_queue_command(this);
+	else
+		ret = gpmi_send_command(this);
 	if (ret)
 		dev_err(this->dev, "Chip: %u, Error %d\n",
 			this->current_chip, ret);
@@ -1115,6 +1189,8 @@ static int gpmi_dev_ready(struct mtd_info *mtd)
 	struct nand_chip *chip = mtd->priv;
 	struct gpmi_nand_data *this = chip->priv;
 
+	gpmi_flush_command(this);
+
 	return gpmi_is_ready(this, this->current_chip);
 }
 
@@ -1123,6 +1199,8 @@ static void gpmi_select_chip(struct mtd_info *mtd, int chipnr)
 	struct nand_chip *chip = mtd->priv;
 	struct gpmi_nand_data *this = chip->priv;
 
+	gpmi_flush_command(this);
+
 	if ((this->current_chip < 0) && (chipnr >= 0))
 		gpmi_begin(this);
 	else if ((this->current_chip >= 0) && (chipnr < 0))
@@ -1213,6 +1291,37 @@ static void block_mark_swapping(struct gpmi_nand_data *this,
 	p[1] = (p[1] & mask) | (from_oob >> (8 - bit));
 }
 
+/*
+ * Count the zero bits in @len bytes at @buf, giving up as soon as there
+ * are more than @limit. Erased data is almost all ones, so whole words of
+ * ones are skipped and only the words that differ are counted.
+ */
+static unsigned int gpmi_count_zero_bits(const void *buf, unsigned int len,
+					unsigned int limit)
+{
+	const u8 *b = buf;
+	const unsigned long *p;
+	unsigned int count = 0;
+
+	for (; len && !IS_ALIGNED((unsigned long)b, sizeof(long)); len--, b++)
+		count += hweight8((u8)~*b);
+
+	for (p = (const unsigned long *)b; len >= sizeof(long);
+	     len -= sizeof(long), p++) {
+		if (likely(*p == ~0UL))
+			continue;
+
+		count += hweight_long(~*p);
+		if (count > limit)
+			return count;
+	}
+
+	for (b = (const u8 *)p; len; len--, b++)
+		count += hweight8((u8)~*b);
+
+	return count;
+}
+
 static bool gpmi_erased_check(struct gpmi_nand_data *this,
 			unsigned char *data, unsigned int chunk, int page,
 			unsigned int *max_bitflips)
@@ -1221,36 +1330,42 @@ static bool gpmi_erased_check(struct gpmi_nand_data *this,
 	struct mtd_info	*mtd = &this->mtd;
 	struct bch_geometry *geo = &this->bch_geometry;
 	int base = geo->ecc_chunkn_size * chunk;
-	unsigned int flip_bits = 0, flip_bits_noecc = 0;
-	uint64_t *buf = (uint64_t *)this->data_buffer_dma;
+	unsigned int flip_bits, flip_bits_noecc;
+	uint8_t *buf = (uint8_t *)this->data_buffer_dma;
 	unsigned int threshold;
-	int i;
+
+	/*
+	 * BCH on these SoCs already reported an erased chunk for up to
+	 * ecc_strength zero bits, so an uncorrectable one cannot pass the
+	 * (lower) software threshold either.
+	 */
+	if (GPMI_IS_MX6QP(this) || GPMI_IS_MX7(this) || GPMI_IS_MX6UL(this))
+		return false;
 
 	threshold = geo->gf_len / 2;
 	if (threshold > geo->ecc_strength)
 		threshold = geo->ecc_strength;
 
 	/* Count bitflips */
-	for (i = 0; i < geo->ecc_chunkn_size; i++) {
-		flip_bits += hweight8(~data[base + i]);
-		if (flip_bits > threshold)
-			return false;
-	}
+	flip_bits = gpmi_count_zero_bits(data + base, geo->ecc_chunkn_size,
+					threshold);
+	if (flip_bits > threshold)
+		return false;
 
 	/*
 	 * Read out the whole page with ECC disabled, and check it again,
 	 * This is more strict then just read out a chunk, and it makes
-	 * the code more simple.
+	 * the code more simple. The page is still held in the chip's
+	 * data (or cache) register, so no new array read is needed, which
+	 * also keeps a READ CACHE SEQUENTIAL in progress intact.
 	 */
-	chip->cmdfunc(mtd, NAND_CMD_READ0, 0, page);
-	chip->read_buf(mtd, (uint8_t *)buf, mtd->writesize);
+	chip->cmdfunc(mtd, NAND_CMD_RNDOUT, 0, -1);
+	chip->read_buf(mtd, buf, mtd->writesize);
 
 	/* Count the bitflips for the no ECC buffer */
-	for (i = 0; i < mtd->writesize / 8; i++) {
-		flip_bits_noecc += hweight64(~buf[i]);
-		if (flip_bits_noecc > threshold)
-			return false;
-	}
+	flip_bits_noecc = gpmi_count_zero_bits(buf, mtd->writesize, threshold);
+	if (flip_bits_noecc > threshold)
+		return false;
 
 	/* Tell the upper layer the bitflips we corrected. */
 	mtd->ecc_stats.corrected += flip_bits;
@@ -1281,9 +1396,12 @@ static int gpmi_ecc_read_page(struct mtd_info *mtd, struct nand_chip *chip,
 	unsigned int  i;
 	unsigned char *status;
 	unsigned int  max_bitflips = 0;
+	unsigned int  corrected = 0, failed = 0;
+	u64           start;
 	int           ret;
 	int flag = 0;
 
+	start = trace_gpmi_read_page_enabled() ? local_clock() : 0;
 	dev_dbg(this->dev, "page number is : %d\n", page);
 	ret = read_page_prepare(this, buf, nfc_geo->payload_size,
 					this->payload_virt, this->payload_phys,
@@ -1331,9 +1449,11 @@ static int gpmi_ecc_read_page(struct mtd_info *mtd, struct nand_chip *chip,
 						page, &max_bitflips))
 				break;
 			mtd->ecc_stats.failed++;
+			failed++;
 			continue;
 		}
 		mtd->ecc_stats.corrected += *status;
+		corrected += *status;
 		max_bitflips = max_t(unsigned int, max_bitflips, *status);
 	}
 
@@ -1361,6 +1481,10 @@ static int gpmi_ecc_read_page(struct mtd_info *mtd, struct nand_chip *chip,
 	if (flag)
 		memset(buf, 0xff, nfc_geo->payload_size);
 
+	/* start is 0 if tracing was turned on during the read */
+	if (trace_gpmi_read_page_enabled() && start)
+		trace_gpmi_read_page(page, local_clock() - start, corrected,
+				     max_bitflips, failed);
 	return max_bitflips;
 }
 
@@ -1492,6 +1616,7 @@ static int gpmi_ecc_write_page(struct mtd_info *mtd, struct nand_chip *chip,
 	dma_addr_t payload_phys;
 	const void *auxiliary_virt;
 	dma_addr_t auxiliary_phys;
+	u64        start;
 	int        ret;
 
 	dev_dbg(this->dev, "ecc write page.\n");
@@ -1540,9 +1665,12 @@ static int gpmi_ecc_write_page(struct mtd_info *mtd, struct nand_chip *chip,
 	}
 
 	/* Ask the NFC. */
+	start = trace_gpmi_write_page_enabled() ? local_clock() : 0;
 	ret = gpmi_send_page(this, payload_phys, auxiliary_phys);
 	if (ret)
 		dev_err(this->dev, "Error in ECC-based write: %d\n", ret);
+	if (trace_gpmi_write_page_enabled() && start)
+		trace_gpmi_write_page(local_clock() - start, ret);
 
 	if (!this->swap_block_mark) {
 		send_page_end(this, chip->oob_poi, mtd->oobsize,
@@ -2228,6 +2356,15 @@ static int gpmi_init_last(struct gpmi_nand_data *this)
 		chip->options |= NAND_SUBPAGE_READ;
 	}
 
+	/*
+	 * The ECC read chain only waits for ready and clocks the page out,
+	 * so it works behind READ CACHE SEQUENTIAL too: let sequential reads
+	 * load the next page while BCH decodes the current one.
+	 */
+	if (chip->onfi_version && (le16_to_cpu(chip->onfi_params.opt_cmd)
+				   & ONFI_OPT_CMD_READ_CACHE))
+		chip->options |= NAND_CACHE_READ;
+
 	/*
 	 * Can we enable the extra features? such as EDO or Sync mode.
 	 *
@@ -144,6 +144,8 @@ struct gpmi_nand_data {
 	/* flags */
 #define GPMI_ASYNC_EDO_ENABLED	(1 << 0)
 #define GPMI_TIMING_INIT_OK	(1 << 1)
+/* parameter page reads that must match before a timing mode is used */
+#define GPMI_TIMING_TRAINING_READS	4
 	int			flags;
 	const struct gpmi_devdata *devdata;
 
@@ -157,6 +159,9 @@ struct gpmi_nand_data {
 	/* Flash Hardware */
 	struct nand_timing	timing;
 	int			timing_mode;
+	/* timing and IO clock the chip was probed with */
+	struct nand_timing	safe_timing;
+	unsigned long		safe_clk_rate;
 
 	/* BCH */
 	struct bch_geometry	bch_geometry;
@@ -180,9 +185,15 @@ struct gpmi_nand_data {
 
 	/* for DMA operations */
 	bool			direct_dma_map_ok;
+	/* ECC page transfers that had to go through the bounce buffers */
+	u32			bounce_reads;
+	u32			bounce_writes;
 
 	struct scatterlist	cmd_sgl;
 	char			*cmd_buffer;
+	/* command chain waiting for its data phase, see gpmi_queue_command() */
+	struct dma_async_tx_descriptor *cmd_desc;
+	bool			cmd_chained;
 
 	struct scatterlist	data_sgl;
 	char			*data_buffer_dma;
@@ -295,6 +306,8 @@ extern int bch_create_debugfs(struct gpmi_nand_data *);
 extern int bch_set_geometry(struct gpmi_nand_data *);
 extern int gpmi_is_ready(struct gpmi_nand_data *, unsigned chip);
 extern int gpmi_send_command(struct gpmi_nand_data *);
+extern int gpmi_queue_command(struct gpmi_nand_data *);
+extern int gpmi_flush_command(struct gpmi_nand_data *);
 extern void gpmi_begin(struct gpmi_nand_data *);
 extern void gpmi_end(struct gpmi_nand_data *);
 extern int gpmi_read_data(struct gpmi_nand_data *);
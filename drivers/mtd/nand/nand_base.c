@@ -1534,6 +1534,21 @@ static int nand_setup_read_retry(struct mtd_info *mtd, int retry_mode)
 	return chip->setup_read_retry(mtd, retry_mode);
 }
 
+/*
+ * Can the page after @page be fetched by READ CACHE SEQUENTIAL while @page
+ * is read out? Only for whole page ECC reads that stay within the block.
+ */
+static bool nand_cache_read_next(struct mtd_info *mtd, struct mtd_oob_ops *ops,
+				 int page, uint32_t readlen)
+{
+	struct nand_chip *chip = mtd->priv;
+	int pages_per_block = 1 << (chip->phys_erase_shift - chip->page_shift);
+
+	return NAND_HAS_CACHE_READ(chip) && ops->mode != MTD_OPS_RAW &&
+		!ops->oobbuf && readlen >= 2 * mtd->writesize &&
+		(page + 1) % pages_per_block;
+}
+
 /**
  * nand_do_read_ops - [INTERN] Read data with ECC
  * @mtd: MTD device structure
@@ -1558,6 +1573,9 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	unsigned int max_bitflips = 0;
 	int retry_mode = 0;
 	bool ecc_fail = false;
+	/* the chip is in a READ CACHE sequence, the next page is loading */
+	bool cache_read = false;
+	bool cache_allowed = true;
 
 	chipnr = (int)(from >> chip->chip_shift);
 	chip->select_chip(mtd, chipnr);
@@ -1585,7 +1603,7 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 			use_bufpoi = 0;
 
 		/* Is the current page in the buffer? */
-		if (realpage != chip->pagebuf || oob) {
+		if (realpage != chip->pagebuf || oob || cache_read) {
 			bufpoi = use_bufpoi ? chip->buffers->databuf : buf;
 
 			if (use_bufpoi && aligned)
@@ -1593,7 +1611,22 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 						 __func__, buf);
 
 read_retry:
-			chip->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
+			if (!cache_read)
+				chip->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
+
+			/*
+			 * Move this page to the cache register and, if more
+			 * follow, start loading the next page meanwhile.
+			 */
+			if (cache_read || (cache_allowed && aligned && !col &&
+			    nand_cache_read_next(mtd, ops, page, readlen))) {
+				cache_read = nand_cache_read_next(mtd, ops,
+								  page,
+								  readlen);
+				chip->cmdfunc(mtd, cache_read ?
+					      NAND_CMD_READCACHESEQ :
+					      NAND_CMD_READCACHEEND, -1, -1);
+			}
 
 			/*
 			 * Now read the page into the buffer.  Absent an error,
@@ -1654,6 +1687,14 @@ read_retry:
 
 			if (mtd->ecc_stats.failed - ecc_failures) {
 				if (retry_mode + 1 < chip->read_retries) {
+					/* re-read this page from the array */
+					if (cache_read) {
+						chip->cmdfunc(mtd,
+							NAND_CMD_READCACHEEND,
+							-1, -1);
+						cache_read = false;
+					}
+					cache_allowed = false;
 					retry_mode++;
 					ret = nand_setup_read_retry(mtd,
 							retry_mode);
@@ -1703,6 +1744,10 @@ read_retry:
 			chip->select_chip(mtd, chipnr);
 		}
 	}
+
+	/* an error stopped us in a READ CACHE sequence, close it */
+	if (cache_read)
+		chip->cmdfunc(mtd, NAND_CMD_READCACHEEND, -1, -1);
 	chip->select_chip(mtd, -1);
 
 	ops->retlen = ops->len - (size_t) readlen;
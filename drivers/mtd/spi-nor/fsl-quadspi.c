@@ -28,6 +28,7 @@
 #include <linux/mtd/spi-nor.h>
 #include <linux/mutex.h>
 #include <linux/pm_qos.h>
+#include <linux/platform_data/dma-imx.h>
 
 /* Controller needs driver to swap endian */
 #define QUADSPI_QUIRK_SWAP_ENDIAN	(1 << 0)
@@ -78,6 +79,8 @@
 #define QUADSPI_BUF1CR			0x14
 #define QUADSPI_BUF2CR			0x18
 #define QUADSPI_BUFXCR_INVALID_MSTRID	0xe
+#define QUADSPI_BUFXCR_MSTRID_MASK	0xf
+#define QUADSPI_BUFXCR_ADATSZ_SHIFT	8
 
 #define QUADSPI_BUF3CR			0x1c
 #define QUADSPI_BUF3CR_ALLMST_SHIFT	31
@@ -223,6 +226,12 @@
 
 #define QUADSPI_MIN_IOMAP SZ_4M
 
+/* Reads at least this long go through SDMA rather than the CPU */
+#define QUADSPI_DMA_MIN_LEN	SZ_4K
+
+/* AHB buffers 0-2 can be dedicated to a bus master each */
+#define QUADSPI_AHB_MASTER_BUFS	3
+
 /* dynamic lut configs */
 #define MAX_LUT_REGS 4
 struct lut_desc {
@@ -322,6 +331,10 @@ struct fsl_qspi {
 	u32 ddr_smp;
 	struct mutex lock;
 	struct pm_qos_request pm_qos_req;
+	bool ahb_persistent;	/* ahb_addr maps all the chips */
+	int ahb_nbufs;
+	u32 ahb_mstrid[QUADSPI_AHB_MASTER_BUFS];
+	u32 ahb_size[QUADSPI_AHB_MASTER_BUFS];
 };
 
 static inline int needs_swap_endian(struct fsl_qspi *q)
@@ -780,24 +793,35 @@ static void fsl_qspi_init_abh_read(struct fsl_qspi *q)
 {
 	void __iomem *base = q->iobase;
 	struct spi_nor *nor = &q->nor[0];
-	u32 reg, reg2;
-	int seqid;
+	u32 reg, reg2, top = 0;
+	int seqid, i;
 
-	/* AHB configuration for access buffer 0/1/2 .*/
-	writel(QUADSPI_BUFXCR_INVALID_MSTRID, base + QUADSPI_BUF0CR);
-	writel(QUADSPI_BUFXCR_INVALID_MSTRID, base + QUADSPI_BUF1CR);
-	writel(QUADSPI_BUFXCR_INVALID_MSTRID, base + QUADSPI_BUF2CR);
 	/*
-	 * Set ADATSZ with the maximum AHB buffer size to improve the
-	 * read performance.
+	 * Buffers 0-2 are given to the masters listed in "fsl,ahb-buffers",
+	 * so that e.g. the core and SDMA do not keep evicting each other's
+	 * prefetched lines.  Each prefetches as much as it holds.  BUFxIND
+	 * is the end of buffer x, unused buffers are left empty.
 	 */
-	writel(QUADSPI_BUF3CR_ALLMST_MASK | ((q->devtype_data->ahb_buf_size / 8)
-			<< QUADSPI_BUF3CR_ADATSZ_SHIFT), base + QUADSPI_BUF3CR);
+	for (i = 0; i < QUADSPI_AHB_MASTER_BUFS; i++) {
+		if (i < q->ahb_nbufs) {
+			writel(q->ahb_mstrid[i] | ((q->ahb_size[i] / 8)
+				<< QUADSPI_BUFXCR_ADATSZ_SHIFT),
+				base + QUADSPI_BUF0CR + 4 * i);
+			top += q->ahb_size[i];
+		} else {
+			writel(QUADSPI_BUFXCR_INVALID_MSTRID,
+				base + QUADSPI_BUF0CR + 4 * i);
+		}
+		writel(top, base + QUADSPI_BUF0IND + 4 * i);
+	}
 
-	/* We only use the buffer3 */
-	writel(0, base + QUADSPI_BUF0IND);
-	writel(0, base + QUADSPI_BUF1IND);
-	writel(0, base + QUADSPI_BUF2IND);
+	/*
+	 * Buffer 3 serves all the other masters with the rest. Set ADATSZ
+	 * with its whole size to improve the read performance.
+	 */
+	writel(QUADSPI_BUF3CR_ALLMST_MASK |
+		(((q->devtype_data->ahb_buf_size - top) / 8)
+			<< QUADSPI_BUF3CR_ADATSZ_SHIFT), base + QUADSPI_BUF3CR);
 
 	/* Set the default lut sequence for AHB Read. */
 	seqid = fsl_qspi_get_seqid(q, nor->read_opcode);
@@ -1024,9 +1048,13 @@ static int fsl_qspi_read(struct spi_nor *nor, loff_t from,
 {
 	struct fsl_qspi *q = nor->priv;
 	u8 cmd = nor->read_opcode;
+	void __iomem *src;
+	size_t head, body;
 
 	/* if necessary,ioremap buffer before AHB read, */
-	if (!q->ahb_addr) {
+	if (q->ahb_persistent) {
+		/* the whole window is mapped */
+	} else if (!q->ahb_addr) {
 		q->memmap_offs = q->chip_base_addr + from;
 		q->memmap_len = len > QUADSPI_MIN_IOMAP ? len : QUADSPI_MIN_IOMAP;
 
@@ -1058,9 +1086,30 @@ static int fsl_qspi_read(struct spi_nor *nor, loff_t from,
 		cmd, q->ahb_addr + q->chip_base_addr + from - q->memmap_offs,
 		len);
 
+	src = q->ahb_addr + q->chip_base_addr + from - q->memmap_offs;
+
+	/*
+	 * Let SDMA move the cache line aligned middle of long reads: it
+	 * bursts from the AHB window while the core would stall on every
+	 * uncached load.  Anything it cannot take is copied by the CPU.
+	 */
+	if (len >= QUADSPI_DMA_MIN_LEN) {
+		head = PTR_ALIGN(buf, L1_CACHE_BYTES) - buf;
+		body = round_down(len - head, L1_CACHE_BYTES);
+
+		if (!imx_sdma_memcpy_fromio(buf + head, q->memmap_phy +
+					    q->chip_base_addr + from + head,
+					    body)) {
+			memcpy(buf, src, head);
+			memcpy(buf + head + body, src + head + body,
+			       len - head - body);
+			*retlen += len;
+			return 0;
+		}
+	}
+
 	/* Read out the data directly from the AHB buffer.*/
-	memcpy(buf, q->ahb_addr + q->chip_base_addr + from - q->memmap_offs,
-		len);
+	memcpy(buf, src, len);
 
 	*retlen += len;
 	return 0;
@@ -1109,6 +1158,45 @@ static void fsl_qspi_unprep(struct spi_nor *nor, enum spi_nor_ops ops)
 	mutex_unlock(&q->lock);
 }
 
+/*
+ * "fsl,ahb-buffers" lists up to three <master-id size> pairs, size in
+ * bytes, which get AHB buffers 0-2; buffer 3 keeps what is left.
+ */
+static void fsl_qspi_parse_ahb_buffers(struct fsl_qspi *q)
+{
+	struct device_node *np = q->dev->of_node;
+	u32 cells[2 * QUADSPI_AHB_MASTER_BUFS];
+	u32 total = 0;
+	int n, i;
+
+	n = of_property_count_u32_elems(np, "fsl,ahb-buffers");
+	if (n <= 0)
+		return;
+
+	if (n % 2 || n > ARRAY_SIZE(cells) ||
+	    of_property_read_u32_array(np, "fsl,ahb-buffers", cells, n))
+		goto invalid;
+
+	for (i = 0; i < n / 2; i++) {
+		q->ahb_mstrid[i] = cells[2 * i];
+		q->ahb_size[i] = cells[2 * i + 1];
+		if (q->ahb_mstrid[i] & ~QUADSPI_BUFXCR_MSTRID_MASK ||
+		    !q->ahb_size[i] || q->ahb_size[i] % 8)
+			goto invalid;
+		total += q->ahb_size[i];
+	}
+
+	/* buffer 3 must keep some room for the other masters */
+	if (total >= q->devtype_data->ahb_buf_size)
+		goto invalid;
+
+	q->ahb_nbufs = n / 2;
+	return;
+
+invalid:
+	dev_warn(q->dev, "ignoring invalid fsl,ahb-buffers\n");
+}
+
 static int fsl_qspi_probe(struct platform_device *pdev)
 {
 	struct device_node *np = pdev->dev.of_node;
@@ -1174,6 +1262,8 @@ static int fsl_qspi_probe(struct platform_device *pdev)
 	if (ret)
 		q->ddr_smp = 0;
 
+	fsl_qspi_parse_ahb_buffers(q);
+
 	ret = fsl_qspi_clk_prep_enable(q);
 	if (ret) {
 		dev_err(dev, "can not enable the clock\n");
@@ -1287,6 +1377,23 @@ static int fsl_qspi_probe(struct platform_device *pdev)
 	if (ret)
 		goto last_init_failed;
 
+	/*
+	 * Map all the chips once, as device memory like the on-demand
+	 * windows: the AHB space must not be touched speculatively while
+	 * the clocks are off.  Fall back to mapping windows on demand if
+	 * there is no room for it.
+	 */
+	if (!q->ahb_addr) {
+		q->memmap_len = q->nor_size * (nor - q->nor + 1);
+		q->ahb_addr = ioremap_nocache(q->memmap_phy, q->memmap_len);
+		if (q->ahb_addr) {
+			q->memmap_offs = 0;
+			q->ahb_persistent = true;
+		} else {
+			dev_info(dev, "mapping the AHB window on demand\n");
+		}
+	}
+
 	fsl_qspi_clk_disable_unprep(q);
 	return 0;
 
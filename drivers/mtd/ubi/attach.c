@@ -87,6 +87,8 @@
 #include <linux/crc32.h>
 #include <linux/math64.h>
 #include <linux/random.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include "ubi.h"
 
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
@@ -95,6 +97,29 @@ static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
 static struct ubi_ec_hdr *ech;
 static struct ubi_vid_hdr *vidh;
 
+/* How many PEBs are read ahead by the scanning workers at a time */
+#define SCAN_BATCH 1024
+
+/* Maximum number of threads reading PEB headers in parallel */
+#define SCAN_MAX_WORKERS 4
+
+/**
+ * struct scan_hdrs - result of reading the headers of a PEB.
+ * @bad: what 'ubi_io_is_bad()' returned
+ * @ec_err: what 'ubi_io_read_ec_hdr()' returned
+ * @vid_err: what 'ubi_io_read_vid_hdr()' returned, only valid if the EC
+ *           header is not empty
+ * @ech: the EC header
+ * @vidh: the VID header
+ */
+struct scan_hdrs {
+	int bad;
+	int ec_err;
+	int vid_err;
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_hdr *vidh;
+};
+
 /**
  * add_to_list - add physical eraseblock to a list.
  * @ai: attaching information
@@ -804,28 +829,59 @@ out_unlock:
 }
 
 /**
- * scan_peb - scan and process UBI headers of a PEB.
+ * read_peb_hdrs - read UBI headers of a PEB.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock number
+ * @hdrs: where to store the headers and the read results
+ *
+ * This function only does the I/O part of scanning PEB @pnum and does not
+ * touch the attaching information, so it may be called for different PEBs
+ * concurrently. The headers are read to the buffers @hdrs points to, and the
+ * return codes of the I/O functions are stored in @hdrs to be looked at by
+ * 'analyse_peb()'. The VID header is not read if the PEB is bad or its EC
+ * header is empty.
+ */
+static void read_peb_hdrs(struct ubi_device *ubi, int pnum,
+			  struct scan_hdrs *hdrs)
+{
+	hdrs->ec_err = hdrs->vid_err = 0;
+	hdrs->bad = ubi_io_is_bad(ubi, pnum);
+	if (hdrs->bad)
+		return;
+
+	hdrs->ec_err = ubi_io_read_ec_hdr(ubi, pnum, hdrs->ech, 0);
+	if (hdrs->ec_err < 0 || hdrs->ec_err == UBI_IO_FF ||
+	    hdrs->ec_err == UBI_IO_FF_BITFLIPS)
+		return;
+
+	hdrs->vid_err = ubi_io_read_vid_hdr(ubi, pnum, hdrs->vidh, 0);
+}
+
+/**
+ * analyse_peb - process UBI headers of a PEB.
  * @ubi: UBI device description object
  * @ai: attaching information
  * @pnum: the physical eraseblock number
+ * @hdrs: headers of the PEB as read by 'read_peb_hdrs()'
  * @vid: The volume ID of the found volume will be stored in this pointer
  * @sqnum: The sqnum of the found volume will be stored in this pointer
  *
- * This function reads UBI headers of PEB @pnum, checks them, and adds
- * information about this PEB to the corresponding list or RB-tree in the
- * "attaching info" structure. Returns zero if the physical eraseblock was
- * successfully handled and a negative error code in case of failure.
+ * This function checks the UBI headers of PEB @pnum and adds information
+ * about this PEB to the corresponding list or RB-tree in the "attaching info"
+ * structure. Returns zero if the physical eraseblock was successfully handled
+ * and a negative error code in case of failure.
  */
-static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
-		    int pnum, int *vid, unsigned long long *sqnum)
+static int analyse_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
+		       int pnum, const struct scan_hdrs *hdrs, int *vid,
+		       unsigned long long *sqnum)
 {
+	struct ubi_ec_hdr *ech = hdrs->ech;
+	struct ubi_vid_hdr *vidh = hdrs->vidh;
 	long long uninitialized_var(ec);
 	int err, bitflips = 0, vol_id = -1, ec_err = 0;
 
-	dbg_bld("scan PEB %d", pnum);
-
 	/* Skip bad physical eraseblocks */
-	err = ubi_io_is_bad(ubi, pnum);
+	err = hdrs->bad;
 	if (err < 0)
 		return err;
 	else if (err) {
@@ -833,7 +889,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = hdrs->ec_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -916,7 +972,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidh, 0);
+	err = hdrs->vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1054,6 +1110,188 @@ adjust_mean_ec:
 	return 0;
 }
 
+/**
+ * scan_peb - scan and process UBI headers of a PEB.
+ * @ubi: UBI device description object
+ * @ai: attaching information
+ * @pnum: the physical eraseblock number
+ * @vid: The volume ID of the found volume will be stored in this pointer
+ * @sqnum: The sqnum of the found volume will be stored in this pointer
+ *
+ * This function reads UBI headers of PEB @pnum, checks them, and adds
+ * information about this PEB to the corresponding list or RB-tree in the
+ * "attaching info" structure. Returns zero if the physical eraseblock was
+ * successfully handled and a negative error code in case of failure.
+ */
+static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
+		    int pnum, int *vid, unsigned long long *sqnum)
+{
+	struct scan_hdrs hdrs = { .ech = ech, .vidh = vidh };
+
+	dbg_bld("scan PEB %d", pnum);
+
+	read_peb_hdrs(ubi, pnum, &hdrs);
+	return analyse_peb(ubi, ai, pnum, &hdrs, vid, sqnum);
+}
+
+/**
+ * struct scan_slot - headers of a PEB read ahead by a scanning worker.
+ * @hdrs: the read results, pointing to @ech and @vidh
+ * @ech: copy of the EC header
+ * @vidh: copy of the VID header
+ */
+struct scan_slot {
+	struct scan_hdrs hdrs;
+	struct ubi_ec_hdr ech;
+	struct ubi_vid_hdr vidh;
+};
+
+/**
+ * struct scan_batch - a range of PEBs read by the scanning workers.
+ * @ubi: UBI device description object
+ * @slots: one slot per PEB of the batch
+ * @first: the first PEB of the batch
+ * @count: how many PEBs the batch contains
+ * @next: index of the next slot to be read
+ */
+struct scan_batch {
+	struct ubi_device *ubi;
+	struct scan_slot *slots;
+	int first;
+	int count;
+	atomic_t next;
+};
+
+/**
+ * struct scan_worker - a scanning worker.
+ * @work: the work item, unused for the worker run by the attaching thread
+ * @batch: the batch being read
+ * @ech: EC header I/O buffer
+ * @vidh: VID header I/O buffer
+ */
+struct scan_worker {
+	struct work_struct work;
+	struct scan_batch *batch;
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_hdr *vidh;
+};
+
+/**
+ * read_batch - read headers of the PEBs of a batch.
+ * @w: the scanning worker
+ *
+ * The workers pick PEBs of the batch one by one until none is left, so the
+ * PEBs are shared out evenly no matter how long each worker is stalled in
+ * the MTD layer.
+ */
+static void read_batch(struct scan_worker *w)
+{
+	struct scan_batch *b = w->batch;
+	struct scan_hdrs hdrs = { .ech = w->ech, .vidh = w->vidh };
+	int i;
+
+	while ((i = atomic_inc_return(&b->next) - 1) < b->count) {
+		struct scan_slot *slot = &b->slots[i];
+
+		cond_resched();
+
+		dbg_bld("read PEB %d", b->first + i);
+		read_peb_hdrs(b->ubi, b->first + i, &hdrs);
+
+		slot->hdrs = hdrs;
+		slot->hdrs.ech = &slot->ech;
+		slot->hdrs.vidh = &slot->vidh;
+		memcpy(&slot->ech, w->ech, UBI_EC_HDR_SIZE);
+		memcpy(&slot->vidh, w->vidh, UBI_VID_HDR_SIZE);
+	}
+}
+
+static void scan_worker_fn(struct work_struct *work)
+{
+	read_batch(container_of(work, struct scan_worker, work));
+}
+
+/**
+ * scan_parallel - scan PEBs using several threads.
+ * @ubi: UBI device description object
+ * @ai: attach info object
+ * @start: start scanning at this PEB
+ *
+ * The PEBs are scanned in batches of %SCAN_BATCH. The headers of the PEBs of
+ * a batch are read by the attaching thread together with up to
+ * %SCAN_MAX_WORKERS - 1 work items on the unbound workqueue, so that the
+ * header CRC checks, ECC correction and the waiting for the flash of the
+ * different PEBs overlap. The headers are then analysed in PEB order by the
+ * attaching thread, which is the only one touching @ai, so the result is
+ * exactly the same as for sequential scanning.
+ *
+ * This function returns zero in case of success, a negative error code in case
+ * of failure and %1 if it could not allocate its resources, in which case the
+ * caller should scan sequentially.
+ */
+static int scan_parallel(struct ubi_device *ubi, struct ubi_attach_info *ai,
+			 int start)
+{
+	int err, pnum, i, nr = min_t(int, num_online_cpus(), SCAN_MAX_WORKERS);
+	struct scan_worker *workers;
+	struct scan_batch batch;
+
+	batch.ubi = ubi;
+	batch.slots = vmalloc(SCAN_BATCH * sizeof(struct scan_slot));
+	if (!batch.slots)
+		return 1;
+
+	err = 1;
+	workers = kcalloc(nr, sizeof(struct scan_worker), GFP_KERNEL);
+	if (!workers)
+		goto out_slots;
+
+	for (i = 0; i < nr; i++) {
+		INIT_WORK(&workers[i].work, scan_worker_fn);
+		workers[i].batch = &batch;
+		workers[i].ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+		workers[i].vidh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+		if (!workers[i].ech || !workers[i].vidh)
+			goto out_workers;
+	}
+
+	dbg_gen("scanning with %d threads", nr);
+
+	for (pnum = start; pnum < ubi->peb_count; pnum += batch.count) {
+		batch.first = pnum;
+		batch.count = min_t(int, SCAN_BATCH, ubi->peb_count - pnum);
+		atomic_set(&batch.next, 0);
+
+		for (i = 1; i < nr; i++)
+			queue_work(system_unbound_wq, &workers[i].work);
+		read_batch(&workers[0]);
+		for (i = 1; i < nr; i++)
+			flush_work(&workers[i].work);
+
+		for (i = 0; i < batch.count; i++) {
+			cond_resched();
+
+			dbg_gen("process PEB %d", pnum + i);
+			err = analyse_peb(ubi, ai, pnum + i,
+					  &batch.slots[i].hdrs, NULL, NULL);
+			if (err < 0)
+				goto out_workers;
+		}
+	}
+
+	err = 0;
+
+out_workers:
+	for (i = 0; i < nr; i++) {
+		ubi_free_vid_hdr(ubi, workers[i].vidh);
+		kfree(workers[i].ech);
+	}
+	kfree(workers);
+out_slots:
+	vfree(batch.slots);
+	return err;
+}
+
 /**
  * late_analysis - analyze the overall situation with PEB.
  * @ubi: UBI device description object
@@ -1243,7 +1481,18 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!vidh)
 		goto out_ech;
 
-	for (pnum = start; pnum < ubi->peb_count; pnum++) {
+	/*
+	 * Read the headers with several threads if we can, but fall back to
+	 * the plain loop on UP systems or if we are short of memory.
+	 */
+	err = 1;
+	if (num_online_cpus() > 1)
+		err = scan_parallel(ubi, ai, start);
+	if (err < 0)
+		goto out_vidh;
+
+	for (pnum = err ? start : ubi->peb_count; pnum < ubi->peb_count;
+	     pnum++) {
 		cond_resched();
 
 		dbg_gen("process PEB %d", pnum);
@@ -42,6 +42,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/major.h>
+#include <linux/math64.h>
 #include "ubi.h"
 
 /* Maximum length of the 'mtd=' parameter */
@@ -118,6 +119,9 @@ static struct class_attribute ubi_version =
 
 static ssize_t dev_attribute_show(struct device *dev,
 				  struct device_attribute *attr, char *buf);
+static ssize_t dev_attribute_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count);
 
 /* UBI device attributes (correspond to files in '/<sysfs>/class/ubi/ubiX') */
 static struct device_attribute dev_eraseblock_size =
@@ -142,6 +146,16 @@ static struct device_attribute dev_bgt_enabled =
 	__ATTR(bgt_enabled, S_IRUGO, dev_attribute_show, NULL);
 static struct device_attribute dev_mtd_num =
 	__ATTR(mtd_num, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_bgt_idle_ms =
+	__ATTR(bgt_idle_ms, S_IRUGO | S_IWUSR, dev_attribute_show,
+	       dev_attribute_store);
+static struct device_attribute dev_bgt_rate =
+	__ATTR(bgt_rate, S_IRUGO | S_IWUSR, dev_attribute_show,
+	       dev_attribute_store);
+static struct device_attribute dev_erase_stats =
+	__ATTR(erase_stats, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_wl_stats =
+	__ATTR(wl_stats, S_IRUGO, dev_attribute_show, NULL);
 
 /**
  * ubi_volume_notify - send a volume change notification.
@@ -378,13 +392,66 @@ static ssize_t dev_attribute_show(struct device *dev,
 		ret = sprintf(buf, "%d\n", ubi->thread_enabled);
 	else if (attr == &dev_mtd_num)
 		ret = sprintf(buf, "%d\n", ubi->mtd->index);
-	else
+	else if (attr == &dev_bgt_idle_ms)
+		ret = sprintf(buf, "%u\n", ubi->bgt_idle_ms);
+	else if (attr == &dev_bgt_rate)
+		ret = sprintf(buf, "%u\n", ubi->bgt_rate);
+	else if (attr == &dev_erase_stats || attr == &dev_wl_stats) {
+		unsigned long works;
+		u64 ns;
+
+		/* Number of works and total time spent in them in microseconds */
+		spin_lock(&ubi->wl_lock);
+		if (attr == &dev_erase_stats) {
+			works = ubi->erase_works;
+			ns = ubi->erase_time_ns;
+		} else {
+			works = ubi->wl_works;
+			ns = ubi->wl_time_ns;
+		}
+		spin_unlock(&ubi->wl_lock);
+		ret = sprintf(buf, "%lu %llu\n", works,
+			      (unsigned long long)div_u64(ns, NSEC_PER_USEC));
+	} else
 		ret = -EINVAL;
 
 	ubi_put_device(ubi);
 	return ret;
 }
 
+static ssize_t dev_attribute_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct ubi_device *ubi;
+	unsigned int val;
+	int err;
+
+	err = kstrtouint(buf, 0, &val);
+	if (err)
+		return err;
+
+	/* See the comment in 'dev_attribute_show()' */
+	ubi = container_of(dev, struct ubi_device, dev);
+	ubi = ubi_get_device(ubi->ubi_num);
+	if (!ubi)
+		return -ENODEV;
+
+	if (attr == &dev_bgt_idle_ms)
+		ubi->bgt_idle_ms = val;
+	else if (attr == &dev_bgt_rate)
+		ubi->bgt_rate = val;
+	else
+		err = -EINVAL;
+
+	/* Let the background thread pick up the new settings */
+	if (!err && ubi->bgt_thread)
+		wake_up_process(ubi->bgt_thread);
+
+	ubi_put_device(ubi);
+	return err ? err : count;
+}
+
 static void dev_release(struct device *dev)
 {
 	struct ubi_device *ubi = container_of(dev, struct ubi_device, dev);
@@ -445,6 +512,18 @@ static int ubi_sysfs_init(struct ubi_device *ubi, int *ref)
 	if (err)
 		return err;
 	err = device_create_file(&ubi->dev, &dev_mtd_num);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_bgt_idle_ms);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_bgt_rate);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_erase_stats);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_wl_stats);
 	return err;
 }
 
@@ -454,6 +533,10 @@ static int ubi_sysfs_init(struct ubi_device *ubi, int *ref)
  */
 static void ubi_sysfs_close(struct ubi_device *ubi)
 {
+	device_remove_file(&ubi->dev, &dev_wl_stats);
+	device_remove_file(&ubi->dev, &dev_erase_stats);
+	device_remove_file(&ubi->dev, &dev_bgt_rate);
+	device_remove_file(&ubi->dev, &dev_bgt_idle_ms);
 	device_remove_file(&ubi->dev, &dev_mtd_num);
 	device_remove_file(&ubi->dev, &dev_bgt_enabled);
 	device_remove_file(&ubi->dev, &dev_min_io_size);
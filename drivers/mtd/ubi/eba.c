@@ -210,6 +210,7 @@ static int leb_read_lock(struct ubi_device *ubi, int vol_id, int lnum)
 	if (IS_ERR(le))
 		return PTR_ERR(le);
 	down_read(&le->mutex);
+	ubi->last_fg_io = jiffies;
 	return 0;
 }
 
@@ -252,6 +253,7 @@ static int leb_write_lock(struct ubi_device *ubi, int vol_id, int lnum)
 	if (IS_ERR(le))
 		return PTR_ERR(le);
 	down_write(&le->mutex);
+	ubi->last_fg_io = jiffies;
 	return 0;
 }
 
@@ -14,6 +14,13 @@
  *
  */
 
+/*
+ * The fastmap is rewritten in the background as soon as only one in
+ * FM_POOL_REFILL_RATIO PEBs of the user pool is left, so that writers
+ * seldom find the pool empty and have to wait for the update.
+ */
+#define FM_POOL_REFILL_RATIO 8
+
 /**
  * update_fastmap_work_fn - calls ubi_update_fastmap from a work queue
  * @wrk: the work description object
@@ -192,8 +199,18 @@ again:
 	/* We check here also for the WL pool because at this point we can
 	 * refill the WL pool synchronous. */
 	if (pool->used == pool->size || wl_pool->used == wl_pool->size) {
+		int scheduled = ubi->fm_work_scheduled;
+
 		spin_unlock(&ubi->wl_lock);
 		up_read(&ubi->fm_eba_sem);
+
+		/* A background update is already on its way, wait for it
+		 * instead of writing yet another fastmap right after it. */
+		if (scheduled) {
+			flush_work(&ubi->fm_work);
+			goto again;
+		}
+
 		ret = ubi_update_fastmap(ubi);
 		if (ret) {
 			ubi_msg(ubi, "Unable to write a new fastmap: %i", ret);
@@ -219,6 +236,12 @@ again:
 	ubi_assert(pool->used < pool->size);
 	ret = pool->pebs[pool->used++];
 	prot_queue_add(ubi, ubi->lookuptbl[ret]);
+
+	if (pool->size - pool->used <= pool->size / FM_POOL_REFILL_RATIO &&
+	    !ubi->fm_work_scheduled) {
+		ubi->fm_work_scheduled = 1;
+		schedule_work(&ubi->fm_work);
+	}
 	spin_unlock(&ubi->wl_lock);
 out:
 	return ret;
@@ -474,7 +474,8 @@ struct ubi_debug_info {
  * @wl_lock: protects the @used, @free, @pq, @pq_head, @lookuptbl, @move_from,
  *	     @move_to, @move_to_put @erase_pending, @wl_scheduled, @works,
  *	     @erroneous, @erroneous_peb_count, @fm_work_scheduled, @fm_pool,
- *	     and @fm_wl_pool fields
+ *	     @fm_wl_pool, @erase_works, @erase_time_ns, @wl_works and
+ *	     @wl_time_ns fields
  * @move_mutex: serializes eraseblock moves
  * @work_sem: used to wait for all the scheduled works to finish and prevent
  * new works from being submitted
@@ -489,6 +490,15 @@ struct ubi_debug_info {
  * @bgt_thread: background thread description object
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
+ * @bgt_idle_ms: hold back background works until there was no foreground I/O
+ *               for this many milliseconds, zero to run them right away
+ * @bgt_rate: maximum number of background works per second, zero for no limit
+ * @bgt_last_work: when the background thread did its last work (jiffies)
+ * @last_fg_io: when a logical eraseblock was last locked for I/O (jiffies)
+ * @erase_works: number of erase works done
+ * @erase_time_ns: total time spent in erase works
+ * @wl_works: number of wear-leveling works done
+ * @wl_time_ns: total time spent in wear-leveling works
  *
  * @flash_size: underlying MTD device size (in bytes)
  * @peb_count: count of physical eraseblocks on the MTD device
@@ -592,6 +602,14 @@ struct ubi_device {
 	struct task_struct *bgt_thread;
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
+	unsigned int bgt_idle_ms;
+	unsigned int bgt_rate;
+	unsigned long bgt_last_work;
+	unsigned long last_fg_io;
+	unsigned long erase_works;
+	u64 erase_time_ns;
+	unsigned long wl_works;
+	u64 wl_time_ns;
 
 	/* I/O sub-system's stuff */
 	long long flash_size;
@@ -102,6 +102,7 @@
 #include <linux/crc32.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include "ubi.h"
 #include "wl.h"
 
@@ -135,6 +136,13 @@
  */
 #define WL_MAX_FAILURES 32
 
+/*
+ * Maximum time the background thread may hold back pending works because of
+ * foreground I/O (see @bgt_idle_ms of &struct ubi_device). This makes sure
+ * wear-leveling still makes progress under a constant write load.
+ */
+#define WL_MAX_DEFER (10 * HZ)
+
 static int self_check_ec(struct ubi_device *ubi, int pnum, int ec);
 static int self_check_in_wl_tree(const struct ubi_device *ubi,
 				 struct ubi_wl_entry *e, struct rb_root *root);
@@ -191,6 +199,11 @@ static void wl_entry_destroy(struct ubi_device *ubi, struct ubi_wl_entry *e)
 	kmem_cache_free(ubi_wl_entry_slab, e);
 }
 
+static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
+			int shutdown);
+static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
+				int shutdown);
+
 /**
  * do_work - do one pending work.
  * @ubi: UBI device description object
@@ -202,6 +215,9 @@ static int do_work(struct ubi_device *ubi)
 {
 	int err;
 	struct ubi_work *wrk;
+	int (*func)(struct ubi_device *ubi, struct ubi_work *wrk, int shutdown);
+	ktime_t start;
+	u64 ns;
 
 	cond_resched();
 
@@ -230,11 +246,24 @@ static int do_work(struct ubi_device *ubi)
 	 * after this call as it will have been freed or reused by that
 	 * time by the worker function.
 	 */
-	err = wrk->func(ubi, wrk, 0);
+	func = wrk->func;
+	start = ktime_get();
+	err = func(ubi, wrk, 0);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 	if (err)
 		ubi_err(ubi, "work failed with error code %d", err);
 	up_read(&ubi->work_sem);
 
+	spin_lock(&ubi->wl_lock);
+	if (func == erase_worker) {
+		ubi->erase_works += 1;
+		ubi->erase_time_ns += ns;
+	} else if (func == wear_leveling_worker) {
+		ubi->wl_works += 1;
+		ubi->wl_time_ns += ns;
+	}
+	spin_unlock(&ubi->wl_lock);
+
 	return err;
 }
 
@@ -565,9 +594,6 @@ static void schedule_ubi_work(struct ubi_device *ubi, struct ubi_work *wrk)
 	up_read(&ubi->work_sem);
 }
 
-static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
-			int shutdown);
-
 /**
  * schedule_erase - schedule an erase work.
  * @ubi: UBI device description object
@@ -1403,6 +1429,41 @@ static void tree_destroy(struct ubi_device *ubi, struct rb_root *root)
 	}
 }
 
+/**
+ * bgt_delay - find out how long the background thread should wait.
+ * @ubi: UBI device description object
+ * @defer_start: when the thread started holding back works, zero if it did not
+ *
+ * Pending works are held back while there was foreground I/O during the last
+ * @ubi->bgt_idle_ms milliseconds, for at most %WL_MAX_DEFER, and they are
+ * spaced out so that no more than @ubi->bgt_rate of them run per second. Works
+ * needed to produce free PEBs are not affected, writers run those themselves.
+ * Returns the number of jiffies to wait before doing the next work.
+ */
+static long bgt_delay(struct ubi_device *ubi, unsigned long *defer_start)
+{
+	unsigned long now = jiffies, next;
+	unsigned int idle_ms = ubi->bgt_idle_ms, rate = ubi->bgt_rate;
+
+	if (idle_ms) {
+		next = ubi->last_fg_io + msecs_to_jiffies(idle_ms);
+		if (!*defer_start)
+			*defer_start = now;
+		if (time_before(now, next) &&
+		    time_before(now, *defer_start + WL_MAX_DEFER))
+			return min_t(long, next - now,
+				     *defer_start + WL_MAX_DEFER - now);
+	}
+
+	if (rate) {
+		next = ubi->bgt_last_work + DIV_ROUND_UP(HZ, rate);
+		if (time_before(now, next))
+			return next - now;
+	}
+
+	return 0;
+}
+
 /**
  * ubi_thread - UBI background thread.
  * @u: the UBI device description object pointer
@@ -1411,6 +1472,7 @@ int ubi_thread(void *u)
 {
 	int failures = 0;
 	struct ubi_device *ubi = u;
+	unsigned long defer_start = 0;
 
 	ubi_msg(ubi, "background thread \"%s\" started, PID %d",
 		ubi->bgt_name, task_pid_nr(current));
@@ -1418,6 +1480,7 @@ int ubi_thread(void *u)
 	set_freezable();
 	for (;;) {
 		int err;
+		long delay;
 
 		if (kthread_should_stop())
 			break;
@@ -1431,11 +1494,20 @@ int ubi_thread(void *u)
 			set_current_state(TASK_INTERRUPTIBLE);
 			spin_unlock(&ubi->wl_lock);
 			schedule();
+			defer_start = 0;
 			continue;
 		}
 		spin_unlock(&ubi->wl_lock);
 
+		delay = bgt_delay(ubi, &defer_start);
+		if (delay) {
+			schedule_timeout_interruptible(delay);
+			continue;
+		}
+
 		err = do_work(ubi);
+		defer_start = 0;
+		ubi->bgt_last_work = jiffies;
 		if (err) {
 			ubi_err(ubi, "%s: work failed with error code %d",
 				ubi->bgt_name, err);
@@ -1502,6 +1574,7 @@ int ubi_wl_init(struct ubi_device *ubi, struct ubi_attach_info *ai)
 	init_rwsem(&ubi->work_sem);
 	ubi->max_ec = ai->max_ec;
 	INIT_LIST_HEAD(&ubi->works);
+	ubi->last_fg_io = ubi->bgt_last_work = jiffies;
 
 	sprintf(ubi->bgt_name, UBI_BGT_NAME_PATTERN, ubi->ubi_num);
 
@@ -55,6 +55,7 @@
 
 #include "gc_hal_kernel_linux.h"
 #include <linux/pagemap.h>
+#include <linux/math64.h>
 #include <linux/seq_file.h>
 #include <linux/mman.h>
 #include <linux/slab.h>
@@ -250,6 +251,159 @@ int gc_meminfo_show(struct seq_file* m, void* data)
     return 0;
 }
 
+/*******************************************************************************
+**
+** Show video memory and GPU time per process.
+**
+**  Contiguous: video memory from the reserved contiguous pool.
+**  Virtual: video memory from the virtual (MMU mapped) pool.
+**  NonPaged: driver internal non paged memory.
+**  GPU time: GPU busy time charged to the process, see _GpuTimeUpdate().
+*/
+static int
+gc_usage_show(struct seq_file *m, void *data)
+{
+    gcsINFO_NODE *node = m->private;
+    gckGALDEVICE device = node->device;
+    gckKERNEL kernel = _GetValidKernel(device);
+    gcsDATABASE_PTR database;
+    gctUINT8 name[24];
+    gctUINT64 busyTime;
+    gctUINT32 commits;
+    gctINT i, pid;
+
+    seq_printf(m, "%-8s%-16s%12s%12s%12s%12s%12s%10s\n",
+               "PID", "NAME", "Contiguous", "MaxContig", "Virtual",
+               "NonPaged", "GPU(ms)", "Commits");
+
+    /* Acquire the database mutex. */
+    gcmkVERIFY_OK(
+        gckOS_AcquireMutex(kernel->os, kernel->db->dbMutex, gcvINFINITE));
+
+    /* Walk the databases. */
+    for (i = 0; i < gcmCOUNTOF(kernel->db->db); ++i)
+    {
+        for (database = kernel->db->db[i];
+             database != gcvNULL;
+             database = database->next)
+        {
+            pid = database->processID;
+
+            gcmkVERIFY_OK(gckOS_ZeroMemory(name, gcmSIZEOF(name)));
+            gcmkVERIFY_OK(gckOS_GetProcessNameByPid(pid, gcmSIZEOF(name), name));
+
+            gckOS_QueryProcessGpuTime(kernel->os, pid, &busyTime, &commits);
+
+            seq_printf(m, "%-8d%-16.15s%12llu%12llu%12llu%12llu%12llu%10u\n",
+                       pid, name,
+                       database->vidMemPool[gcvPOOL_CONTIGUOUS].bytes,
+                       database->vidMemPool[gcvPOOL_CONTIGUOUS].maxBytes,
+                       database->vidMemPool[gcvPOOL_VIRTUAL].bytes,
+                       database->nonPaged.bytes,
+                       busyTime / 1000000,
+                       commits);
+        }
+    }
+
+    /* Release the database mutex. */
+    gcmkVERIFY_OK(gckOS_ReleaseMutex(kernel->os, kernel->db->dbMutex));
+
+    return 0;
+}
+
+/*******************************************************************************
+**
+** Show fragmentation of the reserved contiguous pool (gcvPOOL_SYSTEM).
+**
+** Free blocks are bucketed by power of two size. An allocation larger than
+** the largest free block fails even when enough memory is free in total.
+*/
+#define gcdFRAG_BUCKETS     12
+
+static int
+gc_vidmem_frag_show(struct seq_file *m, void *data)
+{
+    gcsINFO_NODE *node = m->private;
+    gckGALDEVICE device = node->device;
+    gckKERNEL kernel = _GetValidKernel(device);
+    gckVIDMEM memory;
+    gcuVIDMEM_NODE_PTR free;
+    gctSIZE_T largest = 0, freeBytes, totalBytes, minFreeBytes;
+    gctUINT32 count[gcdFRAG_BUCKETS] = {0};
+    gctUINT32 blocks = 0;
+    gctUINT i;
+
+    if (gcmIS_ERROR(gckKERNEL_GetVideoMemoryPool(kernel, gcvPOOL_SYSTEM, &memory)))
+    {
+        seq_printf(m, "No contiguous pool.\n");
+        return 0;
+    }
+
+    gcmkVERIFY_OK(gckOS_AcquireMutex(memory->os, memory->mutex, gcvINFINITE));
+
+    for (i = 0; i < gcmCOUNTOF(memory->sentinel); i++)
+    {
+        /* The sentinel of each free list has zero bytes. */
+        for (free = memory->sentinel[i].VidMem.nextFree;
+             free != gcvNULL && free->VidMem.bytes != 0;
+             free = free->VidMem.nextFree)
+        {
+            gctSIZE_T bytes = free->VidMem.bytes;
+            gctUINT bucket = 0;
+
+            /* Bucket 0 holds blocks below 8KB, the last one 8MB and up. */
+            while (bucket < gcdFRAG_BUCKETS - 1 && bytes >= (8192UL << bucket))
+            {
+                bucket++;
+            }
+
+            count[bucket]++;
+            blocks++;
+
+            if (bytes > largest)
+            {
+                largest = bytes;
+            }
+        }
+    }
+
+    freeBytes    = memory->freeBytes;
+    totalBytes   = memory->bytes;
+    minFreeBytes = memory->minFreeBytes;
+
+    gcmkVERIFY_OK(gckOS_ReleaseMutex(memory->os, memory->mutex));
+
+    seq_printf(m, "Total       : %10zu B\n", totalBytes);
+    seq_printf(m, "Free        : %10zu B\n", freeBytes);
+    seq_printf(m, "Lowest free : %10zu B\n", minFreeBytes);
+    seq_printf(m, "Largest free: %10zu B\n", largest);
+    seq_printf(m, "Free blocks : %10u\n", blocks);
+
+    /* 0% when all free memory is one block, towards 100% when scattered. */
+    seq_printf(m, "Fragmented  : %10zu %%\n",
+               freeBytes ? 100 - (gctSIZE_T)div64_u64((u64)largest * 100, freeBytes) : 0);
+
+    seq_printf(m, "\nFree block sizes:\n");
+
+    for (i = 0; i < gcdFRAG_BUCKETS; i++)
+    {
+        if (i == 0)
+        {
+            seq_printf(m, "  %8s - %7luK: %u\n", "0", 8UL, count[i]);
+        }
+        else if (i == gcdFRAG_BUCKETS - 1)
+        {
+            seq_printf(m, "  %7luK - %8s: %u\n", 4UL << i, "", count[i]);
+        }
+        else
+        {
+            seq_printf(m, "  %7luK - %7luK: %u\n", 4UL << i, 8UL << i, count[i]);
+        }
+    }
+
+    return 0;
+}
+
 static int
 _ShowRecord(
     IN struct seq_file *file,
@@ -471,6 +625,8 @@ static gcsINFO InfoList[] =
     {"info", gc_info_show},
     {"clients", gc_clients_show},
     {"meminfo", gc_meminfo_show},
+    {"usage", gc_usage_show},
+    {"vidmem_frag", gc_vidmem_frag_show},
     {"idle", gc_idle_show},
     {"database", gc_db_show},
     {"version", gc_version_show},
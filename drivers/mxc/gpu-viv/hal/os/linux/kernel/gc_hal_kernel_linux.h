@@ -179,6 +179,22 @@ typedef struct _gcsUSER_MAPPING
 }
 gcsUSER_MAPPING;
 
+/* Number of processes tracked for GPU busy time. */
+#define gcdGPU_TIME_PROCESSES       32
+
+typedef struct _gcsGPU_TIME
+{
+    /* Process owning this slot, 0 when unused. */
+    gctUINT32                   processID;
+
+    /* GPU busy time charged to this process, in ns. */
+    gctUINT64                   busyTime;
+
+    /* Number of commits from this process. */
+    gctUINT32                   commits;
+}
+gcsGPU_TIME;
+
 typedef struct _gcsINTEGER_DB * gcsINTEGER_DB_PTR;
 typedef struct _gcsINTEGER_DB
 {
@@ -249,6 +265,12 @@ struct _gckOS
 
     /* IOMMU. */
     gckIOMMU                    iommu;
+
+    /* Per-process GPU busy time, charged to the last committing process. */
+    spinlock_t                  gpuTimeLock;
+    gcsGPU_TIME                 gpuTime[gcdGPU_TIME_PROCESSES];
+    gctUINT32                   gpuTimeOwner;
+    gctUINT64                   gpuTimeStart;
 };
 
 typedef struct _gcsSIGNAL * gcsSIGNAL_PTR;
@@ -324,6 +346,14 @@ gckOS_FreeAllocators(
     gckOS Os
     );
 
+void
+gckOS_QueryProcessGpuTime(
+    IN gckOS Os,
+    IN gctUINT32 ProcessID,
+    OUT gctUINT64 * BusyTime,
+    OUT gctUINT32 * Commits
+    );
+
 gceSTATUS
 _HandleOuterCache(
     IN gckOS Os,
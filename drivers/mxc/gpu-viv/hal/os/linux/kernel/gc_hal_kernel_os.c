@@ -705,6 +705,8 @@ gckOS_Construct(
     /* Initialize signal id database lock. */
     spin_lock_init(&os->signalDB.lock);
 
+    spin_lock_init(&os->gpuTimeLock);
+
     /* Initialize signal id database. */
     idr_init(&os->signalDB.idr);
 
@@ -6103,6 +6105,12 @@ gckOS_CacheFlush(
 ********************************* Broadcasting *********************************
 *******************************************************************************/
 
+static void
+_GpuTimeUpdate(
+    IN gckOS Os,
+    IN gctUINT32 NewOwner
+    );
+
 /*******************************************************************************
 **
 **  gckOS_Broadcast
@@ -6189,6 +6197,8 @@ gckOS_Broadcast(
                                            1,
                                            gcvDB_IDLE,
                                            gcvNULL, gcvNULL, 0));
+
+        _GpuTimeUpdate(Os, 0);
         break;
 
     case gcvBROADCAST_GPU_COMMIT:
@@ -6200,6 +6210,8 @@ gckOS_Broadcast(
                                            gcvDB_IDLE,
                                            gcvNULL, gcvNULL, 0));
 
+        _GpuTimeUpdate(Os, _GetProcessID());
+
         /* Put GPU ON. */
         gcmkONERROR(
             gckHARDWARE_SetPowerManagementState(Hardware, gcvPOWER_ON_AUTO));
@@ -6245,6 +6257,112 @@ OnError:
     return status;
 }
 
+/*******************************************************************************
+**
+**  GPU busy time accounting.
+**
+**  The hardware does not tell which process a command buffer belongs to once
+**  it is queued, so the time from a commit until the next commit or until the
+**  GPU goes idle is charged to the committing process. With several processes
+**  sharing the GPU this is an approximation, but it finds the heavy users.
+*/
+static gcsGPU_TIME *
+_GpuTimeSlot(
+    IN gckOS Os,
+    IN gctUINT32 ProcessID
+    )
+{
+    gcsGPU_TIME *slot = gcvNULL;
+    gctINT i;
+
+    for (i = 0; i < gcdGPU_TIME_PROCESSES; i++)
+    {
+        gcsGPU_TIME *entry = &Os->gpuTime[i];
+
+        if (entry->processID == ProcessID)
+        {
+            return entry;
+        }
+
+        /* Reuse an empty slot, or else the one with the least time. */
+        if (slot == gcvNULL
+        ||  (slot->processID != 0
+            && (entry->processID == 0 || entry->busyTime < slot->busyTime))
+        )
+        {
+            slot = entry;
+        }
+    }
+
+    slot->processID = ProcessID;
+    slot->busyTime  = 0;
+    slot->commits   = 0;
+
+    return slot;
+}
+
+static void
+_GpuTimeUpdate(
+    IN gckOS Os,
+    IN gctUINT32 NewOwner
+    )
+{
+    gctUINT64 now = ktime_get_ns();
+    unsigned long flags;
+
+    spin_lock_irqsave(&Os->gpuTimeLock, flags);
+
+    if (Os->gpuTimeOwner != 0)
+    {
+        _GpuTimeSlot(Os, Os->gpuTimeOwner)->busyTime += now - Os->gpuTimeStart;
+    }
+
+    if (NewOwner != 0)
+    {
+        _GpuTimeSlot(Os, NewOwner)->commits++;
+    }
+
+    Os->gpuTimeOwner = NewOwner;
+    Os->gpuTimeStart = now;
+
+    spin_unlock_irqrestore(&Os->gpuTimeLock, flags);
+}
+
+void
+gckOS_QueryProcessGpuTime(
+    IN gckOS Os,
+    IN gctUINT32 ProcessID,
+    OUT gctUINT64 * BusyTime,
+    OUT gctUINT32 * Commits
+    )
+{
+    unsigned long flags;
+    gctINT i;
+
+    *BusyTime = 0;
+    *Commits  = 0;
+
+    spin_lock_irqsave(&Os->gpuTimeLock, flags);
+
+    for (i = 0; i < gcdGPU_TIME_PROCESSES; i++)
+    {
+        if (Os->gpuTime[i].processID == ProcessID)
+        {
+            *BusyTime = Os->gpuTime[i].busyTime;
+            *Commits  = Os->gpuTime[i].commits;
+            break;
+        }
+    }
+
+    /* Include the period still running. */
+    if (Os->gpuTimeOwner == ProcessID)
+    {
+        *BusyTime += ktime_get_ns() - Os->gpuTimeStart;
+    }
+
+    spin_unlock_irqrestore(&Os->gpuTimeLock, flags);
+}
+
 /*******************************************************************************
 **
 **  gckOS_BroadcastHurry
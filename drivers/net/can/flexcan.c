@@ -46,6 +46,11 @@
 
 /* 8 for RX fifo and 2 error handling */
 #define FLEXCAN_NAPI_WEIGHT		(8 + 2)
+/*
+ * Frames are drained from the RX mailboxes in the irq handler, so poll
+ * only empties rx_queue; stay within NAPI_POLL_WEIGHT.
+ */
+#define FLEXCAN_NAPI_WEIGHT_MB		NAPI_POLL_WEIGHT
 
 /* FLEXCAN module configuration register (CANMCR) bits */
 #define FLEXCAN_MCR_MDIS		BIT(31)
@@ -151,16 +156,22 @@
 	 FLEXCAN_ESR_WAK_INT)
 
 /* FLEXCAN interrupt flag register (IFLAG) bits */
+/* TX mailboxes, the controller sends them in CAN ID priority order */
+#define FLEXCAN_TX_BUF_COUNT		8
 /* Errata ERR005829 step7: Reserve first valid MB */
 #define FLEXCAN_TX_BUF_RESERVED		8
-#define FLEXCAN_TX_BUF_ID		9
+#define FLEXCAN_TX_BUF_FIRST		9
+/* Mailbox RX: MB0 reserved (ERR005829), MB1..55 receive, MB56..63 transmit */
+#define FLEXCAN_MB_TX_BUF_RESERVED	0
+#define FLEXCAN_MB_RX_FIRST		1
+#define FLEXCAN_MB_RX_LAST		(FLEXCAN_MB_TX_BUF_FIRST - 1)
+#define FLEXCAN_MB_TX_BUF_FIRST		(64 - FLEXCAN_TX_BUF_COUNT)
 #define FLEXCAN_IFLAG_BUF(x)		BIT(x)
 #define FLEXCAN_IFLAG_RX_FIFO_OVERFLOW	BIT(7)
 #define FLEXCAN_IFLAG_RX_FIFO_WARN	BIT(6)
 #define FLEXCAN_IFLAG_RX_FIFO_AVAILABLE	BIT(5)
 #define FLEXCAN_IFLAG_DEFAULT \
-	(FLEXCAN_IFLAG_RX_FIFO_OVERFLOW | FLEXCAN_IFLAG_RX_FIFO_AVAILABLE | \
-	 FLEXCAN_IFLAG_BUF(FLEXCAN_TX_BUF_ID))
+	(FLEXCAN_IFLAG_RX_FIFO_OVERFLOW | FLEXCAN_IFLAG_RX_FIFO_AVAILABLE)
 
 /* FLEXCAN message buffers */
 #define FLEXCAN_MB_CNT_CODE(x)		(((x) & 0xf) << 24)
@@ -169,6 +180,7 @@
 #define FLEXCAN_MB_CODE_RX_FULL		(0x2 << 24)
 #define FLEXCAN_MB_CODE_RX_OVERRRUN	(0x6 << 24)
 #define FLEXCAN_MB_CODE_RX_RANSWER	(0xa << 24)
+#define FLEXCAN_MB_CODE_RX_BUSY_BIT	(0x1 << 24)
 
 #define FLEXCAN_MB_CODE_TX_INACTIVE	(0x8 << 24)
 #define FLEXCAN_MB_CODE_TX_ABORT	(0x9 << 24)
@@ -185,6 +197,9 @@
 
 #define FLEXCAN_TIMEOUT_US             (50)
 
+/* frames read from the RX mailboxes but not yet handed to NAPI */
+#define FLEXCAN_RX_QUEUE_LEN		512
+
 /*
  * FLEXCAN hardware feature flags
  *
@@ -203,6 +218,7 @@
 #define FLEXCAN_HAS_V10_FEATURES	BIT(1) /* For core version >= 10 */
 #define FLEXCAN_HAS_BROKEN_ERR_STATE	BIT(2) /* [TR]WRN_INT not connected */
 #define FLEXCAN_HAS_MECR_FEATURES	BIT(3) /* Memory error detection */
+#define FLEXCAN_HAS_RX_MAILBOX		BIT(4) /* Receive into MBs, not FIFO */
 
 /* Structure of the message buffer */
 struct flexcan_mb {
@@ -250,6 +266,13 @@ struct flexcan_devtype_data {
 	u32 features;	/* hardware controller features */
 };
 
+/* RX mailbox timestamp of a queued frame, used to keep them in order */
+struct flexcan_skb_cb {
+	u16 timestamp;
+};
+
+#define FLEXCAN_SKB_CB(skb)	((struct flexcan_skb_cb *)(skb)->cb)
+
 struct flexcan_stop_mode {
 	struct regmap *gpr;
 	u8 req_gpr;
@@ -264,6 +287,19 @@ struct flexcan_priv {
 	void __iomem *base;
 	u32 reg_esr;
 	u32 reg_ctrl_default;
+	u32 reg_imask1_default;
+	u32 reg_imask2_default;
+	u8 tx_mb_first;
+	u8 tx_mb_reserved_idx;
+
+	/* TX mailbox ring, indices are relative to tx_mb_first */
+	spinlock_t tx_lock;
+	u32 tx_pending;
+	unsigned int tx_next;
+	u8 tx_dlc[FLEXCAN_TX_BUF_COUNT];
+
+	/* frames drained from the RX mailboxes, oldest first */
+	struct sk_buff_head rx_queue;
 
 	struct clk *clk_ipg;
 	struct clk *clk_per;
@@ -279,10 +315,11 @@ static struct flexcan_devtype_data fsl_p1010_devtype_data = {
 };
 static struct flexcan_devtype_data fsl_imx28_devtype_data;
 static struct flexcan_devtype_data fsl_imx6q_devtype_data = {
-	.features = FLEXCAN_HAS_V10_FEATURES,
+	.features = FLEXCAN_HAS_V10_FEATURES | FLEXCAN_HAS_RX_MAILBOX,
 };
 static struct flexcan_devtype_data fsl_vf610_devtype_data = {
-	.features = FLEXCAN_HAS_V10_FEATURES | FLEXCAN_HAS_MECR_FEATURES,
+	.features = FLEXCAN_HAS_V10_FEATURES | FLEXCAN_HAS_MECR_FEATURES |
+		FLEXCAN_HAS_RX_MAILBOX,
 };
 
 static const struct can_bittiming_const flexcan_bittiming_const = {
@@ -325,6 +362,20 @@ static inline void flexcan_write(u32 val, void __iomem *addr)
 }
 #endif
 
+static inline bool flexcan_use_rx_mailbox(const struct flexcan_priv *priv)
+{
+	return priv->devtype_data->features & FLEXCAN_HAS_RX_MAILBOX;
+}
+
+static inline void flexcan_ack_mb(struct flexcan_regs __iomem *regs,
+				  unsigned int n)
+{
+	if (n < 32)
+		flexcan_write(BIT(n), &regs->iflag1);
+	else
+		flexcan_write(BIT(n - 32), &regs->iflag2);
+}
+
 static inline void flexcan_enter_stop_mode(struct flexcan_priv *priv)
 {
 	/* enable stop request */
@@ -502,18 +553,43 @@ static int flexcan_get_berr_counter(const struct net_device *dev,
 	return err;
 }
 
+/*
+ * The controller arbitrates between pending TX mailboxes by CAN ID and
+ * falls back to the lowest mailbox number for equal IDs. A frame must
+ * therefore never be put below a pending one, or two frames with the
+ * same ID could leave in the wrong order. The ring is filled upwards, and
+ * once it wraps the queue stays stopped until every mailbox is done.
+ */
+static bool flexcan_tx_ring_full(const struct flexcan_priv *priv)
+{
+	return priv->tx_next == 0 && priv->tx_pending;
+}
+
 static int flexcan_start_xmit(struct sk_buff *skb, struct net_device *dev)
 {
-	const struct flexcan_priv *priv = netdev_priv(dev);
+	struct flexcan_priv *priv = netdev_priv(dev);
 	struct flexcan_regs __iomem *regs = priv->base;
 	struct can_frame *cf = (struct can_frame *)skb->data;
+	struct flexcan_mb __iomem *mb;
+	unsigned long flags;
+	unsigned int idx;
 	u32 can_id;
 	u32 ctrl = FLEXCAN_MB_CNT_CODE(0xc) | (cf->can_dlc << 16);
 
 	if (can_dropped_invalid_skb(dev, skb))
 		return NETDEV_TX_OK;
 
-	netif_stop_queue(dev);
+	spin_lock_irqsave(&priv->tx_lock, flags);
+
+	idx = priv->tx_next;
+	if (unlikely(flexcan_tx_ring_full(priv))) {
+		/* the queue is stopped before this can happen */
+		netif_stop_queue(dev);
+		spin_unlock_irqrestore(&priv->tx_lock, flags);
+		netdev_err(dev, "BUG! TX ring full when queue awake!\n");
+		return NETDEV_TX_BUSY;
+	}
+	mb = &regs->cantxfg[priv->tx_mb_first + idx];
 
 	if (cf->can_id & CAN_EFF_FLAG) {
 		can_id = cf->can_id & CAN_EFF_MASK;
@@ -527,29 +603,79 @@ static int flexcan_start_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	if (cf->can_dlc > 0) {
 		u32 data = be32_to_cpup((__be32 *)&cf->data[0]);
-		flexcan_write(data, &regs->cantxfg[FLEXCAN_TX_BUF_ID].data[0]);
+		flexcan_write(data, &mb->data[0]);
 	}
 	if (cf->can_dlc > 3) {
 		u32 data = be32_to_cpup((__be32 *)&cf->data[4]);
-		flexcan_write(data, &regs->cantxfg[FLEXCAN_TX_BUF_ID].data[1]);
+		flexcan_write(data, &mb->data[1]);
 	}
 
-	can_put_echo_skb(skb, dev, 0);
+	priv->tx_pending |= BIT(idx);
+	priv->tx_next = (idx + 1) % FLEXCAN_TX_BUF_COUNT;
+	if (flexcan_tx_ring_full(priv))
+		netif_stop_queue(dev);
+
+	/* the echo skb is gone on completion when loopback is off */
+	priv->tx_dlc[idx] = cf->can_dlc;
+	netdev_sent_queue(dev, cf->can_dlc);
+	can_put_echo_skb(skb, dev, idx);
 
-	flexcan_write(can_id, &regs->cantxfg[FLEXCAN_TX_BUF_ID].can_id);
-	flexcan_write(ctrl, &regs->cantxfg[FLEXCAN_TX_BUF_ID].can_ctrl);
+	flexcan_write(can_id, &mb->can_id);
+	flexcan_write(ctrl, &mb->can_ctrl);
 
 	/* Errata ERR005829 step8:
 	 * Write twice INACTIVE(0x8) code to first MB.
 	 */
 	flexcan_write(FLEXCAN_MB_CODE_TX_INACTIVE,
-		      &regs->cantxfg[FLEXCAN_TX_BUF_RESERVED].can_ctrl);
+		      &regs->cantxfg[priv->tx_mb_reserved_idx].can_ctrl);
 	flexcan_write(FLEXCAN_MB_CODE_TX_INACTIVE,
-		      &regs->cantxfg[FLEXCAN_TX_BUF_RESERVED].can_ctrl);
+		      &regs->cantxfg[priv->tx_mb_reserved_idx].can_ctrl);
+
+	spin_unlock_irqrestore(&priv->tx_lock, flags);
 
 	return NETDEV_TX_OK;
 }
 
+static void flexcan_irq_tx(struct net_device *dev, u64 reg_iflag)
+{
+	struct net_device_stats *stats = &dev->stats;
+	struct flexcan_priv *priv = netdev_priv(dev);
+	struct flexcan_regs __iomem *regs = priv->base;
+	unsigned int i, pkts = 0, bytes = 0;
+	u32 done;
+
+	done = (reg_iflag >> priv->tx_mb_first) &
+		GENMASK(FLEXCAN_TX_BUF_COUNT - 1, 0);
+	if (!done)
+		return;
+
+	spin_lock(&priv->tx_lock);
+
+	for (i = 0; i < FLEXCAN_TX_BUF_COUNT; i++) {
+		if (!(done & BIT(i)))
+			continue;
+
+		can_get_echo_skb(dev, i);
+		bytes += priv->tx_dlc[i];
+		pkts++;
+		/* after sending a RTR frame mailbox is in RX mode */
+		flexcan_write(FLEXCAN_MB_CODE_TX_INACTIVE,
+			      &regs->cantxfg[priv->tx_mb_first + i].can_ctrl);
+		flexcan_ack_mb(regs, priv->tx_mb_first + i);
+	}
+	priv->tx_pending &= ~done;
+
+	stats->tx_bytes += bytes;
+	stats->tx_packets += pkts;
+	netdev_completed_queue(dev, pkts, bytes);
+	can_led_event(dev, CAN_LED_EVENT_TX);
+
+	if (!flexcan_tx_ring_full(priv))
+		netif_wake_queue(dev);
+
+	spin_unlock(&priv->tx_lock);
+}
+
 static void do_bus_err(struct net_device *dev,
 		       struct can_frame *cf, u32 reg_esr)
 {
@@ -661,15 +787,11 @@ static int flexcan_poll_state(struct net_device *dev, u32 reg_esr)
 	return 1;
 }
 
-static void flexcan_read_fifo(const struct net_device *dev,
-			      struct can_frame *cf)
+static void flexcan_mb_to_frame(struct flexcan_mb __iomem *mb, u32 reg_ctrl,
+				struct can_frame *cf)
 {
-	const struct flexcan_priv *priv = netdev_priv(dev);
-	struct flexcan_regs __iomem *regs = priv->base;
-	struct flexcan_mb __iomem *mb = &regs->cantxfg[0];
-	u32 reg_ctrl, reg_id;
+	u32 reg_id;
 
-	reg_ctrl = flexcan_read(&mb->can_ctrl);
 	reg_id = flexcan_read(&mb->can_id);
 	if (reg_ctrl & FLEXCAN_MB_CNT_IDE)
 		cf->can_id = ((reg_id >> 0) & CAN_EFF_MASK) | CAN_EFF_FLAG;
@@ -682,6 +804,16 @@ static void flexcan_read_fifo(const struct net_device *dev,
 
 	*(__be32 *)(cf->data + 0) = cpu_to_be32(flexcan_read(&mb->data[0]));
 	*(__be32 *)(cf->data + 4) = cpu_to_be32(flexcan_read(&mb->data[1]));
+}
+
+static void flexcan_read_fifo(const struct net_device *dev,
+			      struct can_frame *cf)
+{
+	const struct flexcan_priv *priv = netdev_priv(dev);
+	struct flexcan_regs __iomem *regs = priv->base;
+	struct flexcan_mb __iomem *mb = &regs->cantxfg[0];
+
+	flexcan_mb_to_frame(mb, flexcan_read(&mb->can_ctrl), cf);
 
 	/* mark as read */
 	flexcan_write(FLEXCAN_IFLAG_RX_FIFO_AVAILABLE, &regs->iflag1);
@@ -711,6 +843,132 @@ static int flexcan_read_frame(struct net_device *dev)
 	return 1;
 }
 
+/* insert behind the newest frame that is not younger than @skb */
+static void flexcan_rx_queue_add_sorted(struct sk_buff_head *head,
+					struct sk_buff *skb)
+{
+	u16 timestamp = FLEXCAN_SKB_CB(skb)->timestamp;
+	struct sk_buff *pos;
+
+	skb_queue_reverse_walk(head, pos) {
+		if ((s16)(timestamp - FLEXCAN_SKB_CB(pos)->timestamp) >= 0) {
+			__skb_queue_after(head, pos, skb);
+			return;
+		}
+	}
+
+	__skb_queue_head(head, skb);
+}
+
+/*
+ * Read one RX mailbox into @batch. The mailbox is locked by reading its
+ * control word and released again by reading the free running timer, so
+ * this is kept as short as possible to hand it back to the controller.
+ */
+static void flexcan_read_mailbox(struct net_device *dev, unsigned int n,
+				 struct sk_buff_head *batch)
+{
+	struct flexcan_priv *priv = netdev_priv(dev);
+	struct flexcan_regs __iomem *regs = priv->base;
+	struct flexcan_mb __iomem *mb = &regs->cantxfg[n];
+	struct net_device_stats *stats = &dev->stats;
+	struct can_frame *cf, dummy;
+	struct sk_buff *skb = NULL;
+	unsigned int timeout = FLEXCAN_TIMEOUT_US;
+	u32 reg_ctrl, code;
+
+	/* the controller is still moving a frame into the mailbox */
+	while ((reg_ctrl = flexcan_read(&mb->can_ctrl)) &
+	       FLEXCAN_MB_CODE_RX_BUSY_BIT) {
+		if (!timeout--) {
+			if (net_ratelimit())
+				netdev_err(dev, "mailbox %u stuck busy\n", n);
+			goto out_unlock;
+		}
+		udelay(1);
+	}
+
+	code = reg_ctrl & FLEXCAN_MB_CNT_CODE(0xf);
+	if (code != FLEXCAN_MB_CODE_RX_FULL &&
+	    code != FLEXCAN_MB_CODE_RX_OVERRRUN)
+		goto out_unlock;
+
+	if (code == FLEXCAN_MB_CODE_RX_OVERRRUN) {
+		stats->rx_over_errors++;
+		stats->rx_errors++;
+	}
+
+	if (skb_queue_len(&priv->rx_queue) + skb_queue_len(batch) <
+	    FLEXCAN_RX_QUEUE_LEN)
+		skb = alloc_can_skb(dev, &cf);
+	if (unlikely(!skb)) {
+		cf = &dummy;
+		stats->rx_dropped++;
+	}
+
+	flexcan_mb_to_frame(mb, reg_ctrl, cf);
+
+	if (skb) {
+		FLEXCAN_SKB_CB(skb)->timestamp =
+			FLEXCAN_MB_CNT_TIMESTAMP(reg_ctrl);
+		flexcan_rx_queue_add_sorted(batch, skb);
+	}
+
+ out_unlock:
+	flexcan_ack_mb(regs, n);
+	flexcan_read(&regs->timer);
+}
+
+/*
+ * Drain every filled RX mailbox from the interrupt handler, so they are
+ * free again before the next frames arrive, and queue the frames for
+ * NAPI in the order they were received on the bus.
+ */
+static void flexcan_irq_mailbox(struct net_device *dev, u64 reg_iflag)
+{
+	struct flexcan_priv *priv = netdev_priv(dev);
+	struct sk_buff_head batch;
+	unsigned int n;
+
+	__skb_queue_head_init(&batch);
+
+	for (n = FLEXCAN_MB_RX_FIRST; n <= FLEXCAN_MB_RX_LAST; n++) {
+		if (reg_iflag & BIT_ULL(n))
+			flexcan_read_mailbox(dev, n, &batch);
+	}
+
+	if (skb_queue_empty(&batch))
+		return;
+
+	spin_lock(&priv->rx_queue.lock);
+	skb_queue_splice_tail(&batch, &priv->rx_queue);
+	spin_unlock(&priv->rx_queue.lock);
+
+	napi_schedule(&priv->napi);
+}
+
+static int flexcan_poll_rx_queue(struct net_device *dev, int quota)
+{
+	struct flexcan_priv *priv = netdev_priv(dev);
+	struct net_device_stats *stats = &dev->stats;
+	struct sk_buff *skb;
+	int work_done = 0;
+
+	while (work_done < quota &&
+	       (skb = skb_dequeue(&priv->rx_queue))) {
+		struct can_frame *cf = (struct can_frame *)skb->data;
+
+		stats->rx_packets++;
+		stats->rx_bytes += cf->can_dlc;
+		netif_receive_skb(skb);
+
+		can_led_event(dev, CAN_LED_EVENT_RX);
+		work_done++;
+	}
+
+	return work_done;
+}
+
 static int flexcan_poll(struct napi_struct *napi, int quota)
 {
 	struct net_device *dev = napi->dev;
@@ -728,12 +986,17 @@ static int flexcan_poll(struct napi_struct *napi, int quota)
 	/* handle state changes */
 	work_done += flexcan_poll_state(dev, reg_esr);
 
-	/* handle RX-FIFO */
-	reg_iflag1 = flexcan_read(&regs->iflag1);
-	while (reg_iflag1 & FLEXCAN_IFLAG_RX_FIFO_AVAILABLE &&
-	       work_done < quota) {
-		work_done += flexcan_read_frame(dev);
+	if (flexcan_use_rx_mailbox(priv)) {
+		/* frames already drained from the mailboxes */
+		work_done += flexcan_poll_rx_queue(dev, quota - work_done);
+	} else {
+		/* handle RX-FIFO */
 		reg_iflag1 = flexcan_read(&regs->iflag1);
+		while (reg_iflag1 & FLEXCAN_IFLAG_RX_FIFO_AVAILABLE &&
+		       work_done < quota) {
+			work_done += flexcan_read_frame(dev);
+			reg_iflag1 = flexcan_read(&regs->iflag1);
+		}
 	}
 
 	/* report bus errors */
@@ -743,8 +1006,13 @@ static int flexcan_poll(struct napi_struct *napi, int quota)
 	if (work_done < quota) {
 		napi_complete(napi);
 		/* enable IRQs */
-		flexcan_write(FLEXCAN_IFLAG_DEFAULT, &regs->imask1);
+		flexcan_write(priv->reg_imask1_default, &regs->imask1);
 		flexcan_write(priv->reg_ctrl_default, &regs->ctrl);
+
+		/* frames queued by the irq handler while we were running */
+		if (flexcan_use_rx_mailbox(priv) &&
+		    !skb_queue_empty(&priv->rx_queue))
+			napi_reschedule(napi);
 	}
 
 	return work_done;
@@ -753,12 +1021,15 @@ static int flexcan_poll(struct napi_struct *napi, int quota)
 static irqreturn_t flexcan_irq(int irq, void *dev_id)
 {
 	struct net_device *dev = dev_id;
-	struct net_device_stats *stats = &dev->stats;
 	struct flexcan_priv *priv = netdev_priv(dev);
 	struct flexcan_regs __iomem *regs = priv->base;
 	u32 reg_iflag1, reg_esr;
+	u64 reg_iflag;
 
 	reg_iflag1 = flexcan_read(&regs->iflag1);
+	reg_iflag = reg_iflag1;
+	if (flexcan_use_rx_mailbox(priv))
+		reg_iflag |= (u64)flexcan_read(&regs->iflag2) << 32;
 	reg_esr = flexcan_read(&regs->esr);
 	/* ACK all bus error and state change IRQ sources */
 	if (reg_esr & FLEXCAN_ESR_ALL_INT)
@@ -767,13 +1038,17 @@ static irqreturn_t flexcan_irq(int irq, void *dev_id)
 	if (reg_esr & FLEXCAN_ESR_WAK_INT)
 		flexcan_exit_stop_mode(priv);
 
+	if (flexcan_use_rx_mailbox(priv))
+		flexcan_irq_mailbox(dev, reg_iflag);
+
 	/*
 	 * schedule NAPI in case of:
-	 * - rx IRQ
+	 * - rx IRQ (RX FIFO mode only)
 	 * - state change IRQ
 	 * - bus error IRQ and bus error reporting is activated
 	 */
-	if ((reg_iflag1 & FLEXCAN_IFLAG_RX_FIFO_AVAILABLE) ||
+	if ((!flexcan_use_rx_mailbox(priv) &&
+	     (reg_iflag1 & FLEXCAN_IFLAG_RX_FIFO_AVAILABLE)) ||
 	    (reg_esr & FLEXCAN_ESR_ERR_STATE) ||
 	    flexcan_has_and_handle_berr(priv, reg_esr)) {
 		/*
@@ -781,31 +1056,25 @@ static irqreturn_t flexcan_irq(int irq, void *dev_id)
 		 * save them for later use.
 		 */
 		priv->reg_esr = reg_esr & FLEXCAN_ESR_ERR_BUS;
-		flexcan_write(FLEXCAN_IFLAG_DEFAULT &
-			~FLEXCAN_IFLAG_RX_FIFO_AVAILABLE, &regs->imask1);
+		if (!flexcan_use_rx_mailbox(priv))
+			flexcan_write(priv->reg_imask1_default &
+				~FLEXCAN_IFLAG_RX_FIFO_AVAILABLE,
+				&regs->imask1);
 		flexcan_write(priv->reg_ctrl_default & ~FLEXCAN_CTRL_ERR_ALL,
 		       &regs->ctrl);
 		napi_schedule(&priv->napi);
 	}
 
 	/* FIFO overflow */
-	if (reg_iflag1 & FLEXCAN_IFLAG_RX_FIFO_OVERFLOW) {
+	if (!flexcan_use_rx_mailbox(priv) &&
+	    (reg_iflag1 & FLEXCAN_IFLAG_RX_FIFO_OVERFLOW)) {
 		flexcan_write(FLEXCAN_IFLAG_RX_FIFO_OVERFLOW, &regs->iflag1);
 		dev->stats.rx_over_errors++;
 		dev->stats.rx_errors++;
 	}
 
 	/* transmission complete interrupt */
-	if (reg_iflag1 & (1 << FLEXCAN_TX_BUF_ID)) {
-		stats->tx_bytes += can_get_echo_skb(dev, 0);
-		stats->tx_packets++;
-		can_led_event(dev, CAN_LED_EVENT_TX);
-		/* after sending a RTR frame mailbox is in RX mode */
-		flexcan_write(FLEXCAN_MB_CODE_TX_INACTIVE,
-			      &regs->cantxfg[FLEXCAN_TX_BUF_ID].can_ctrl);
-		flexcan_write((1 << FLEXCAN_TX_BUF_ID), &regs->iflag1);
-		netif_wake_queue(dev);
-	}
+	flexcan_irq_tx(dev, reg_iflag);
 
 	return IRQ_HANDLED;
 }
@@ -859,6 +1128,7 @@ static int flexcan_chip_start(struct net_device *dev)
 	struct flexcan_priv *priv = netdev_priv(dev);
 	struct flexcan_regs __iomem *regs = priv->base;
 	u32 reg_mcr, reg_ctrl, reg_crl2, reg_mecr;
+	u64 imask;
 	int err, i;
 
 	/* enable module */
@@ -877,7 +1147,7 @@ static int flexcan_chip_start(struct net_device *dev)
 	 * MCR
 	 *
 	 * enable freeze
-	 * enable fifo
+	 * enable fifo (unless receiving into mailboxes)
 	 * halt now
 	 * only supervisor access
 	 * enable warning int
@@ -886,12 +1156,14 @@ static int flexcan_chip_start(struct net_device *dev)
 	 * enable self wakeup
 	 */
 	reg_mcr = flexcan_read(&regs->mcr);
-	reg_mcr &= ~FLEXCAN_MCR_MAXMB(0xff);
-	reg_mcr |= FLEXCAN_MCR_FRZ | FLEXCAN_MCR_FEN | FLEXCAN_MCR_HALT |
+	reg_mcr &= ~(FLEXCAN_MCR_MAXMB(0xff) | FLEXCAN_MCR_FEN);
+	reg_mcr |= FLEXCAN_MCR_FRZ | FLEXCAN_MCR_HALT |
 		FLEXCAN_MCR_SUPV | FLEXCAN_MCR_WRN_EN |
 		FLEXCAN_MCR_IDAM_C | FLEXCAN_MCR_SRX_DIS |
 		FLEXCAN_MCR_WAK_MSK | FLEXCAN_MCR_SLF_WAK |
-		FLEXCAN_MCR_MAXMB(FLEXCAN_TX_BUF_ID);
+		FLEXCAN_MCR_MAXMB(priv->tx_mb_first + FLEXCAN_TX_BUF_COUNT - 1);
+	if (!flexcan_use_rx_mailbox(priv))
+		reg_mcr |= FLEXCAN_MCR_FEN;
 	netdev_dbg(dev, "%s: writing mcr=0x%08x", __func__, reg_mcr);
 	flexcan_write(reg_mcr, &regs->mcr);
 
@@ -901,16 +1173,15 @@ static int flexcan_chip_start(struct net_device *dev)
 	 * disable timer sync feature
 	 *
 	 * disable auto busoff recovery
-	 * transmit lowest buffer first
+	 * transmit highest priority (lowest CAN ID) buffer first
 	 *
 	 * enable tx and rx warning interrupt
 	 * enable bus off interrupt
 	 * (== FLEXCAN_CTRL_ERR_STATE)
 	 */
 	reg_ctrl = flexcan_read(&regs->ctrl);
-	reg_ctrl &= ~FLEXCAN_CTRL_TSYN;
-	reg_ctrl |= FLEXCAN_CTRL_BOFF_REC | FLEXCAN_CTRL_LBUF |
-		FLEXCAN_CTRL_ERR_STATE;
+	reg_ctrl &= ~(FLEXCAN_CTRL_TSYN | FLEXCAN_CTRL_LBUF);
+	reg_ctrl |= FLEXCAN_CTRL_BOFF_REC | FLEXCAN_CTRL_ERR_STATE;
 	/*
 	 * enable the "error interrupt" (FLEXCAN_CTRL_ERR_MSK),
 	 * on most Flexcan cores, too. Otherwise we don't get
@@ -927,19 +1198,32 @@ static int flexcan_chip_start(struct net_device *dev)
 	netdev_dbg(dev, "%s: writing ctrl=0x%08x", __func__, reg_ctrl);
 	flexcan_write(reg_ctrl, &regs->ctrl);
 
-	/* clear and invalidate all mailboxes first */
-	for (i = FLEXCAN_TX_BUF_ID; i < ARRAY_SIZE(regs->cantxfg); i++) {
-		flexcan_write(FLEXCAN_MB_CODE_RX_INACTIVE,
-			      &regs->cantxfg[i].can_ctrl);
+	if (flexcan_use_rx_mailbox(priv)) {
+		/* arm all RX mailboxes, they are read by timestamp order */
+		for (i = FLEXCAN_MB_RX_FIRST; i <= FLEXCAN_MB_RX_LAST; i++) {
+			flexcan_write(FLEXCAN_MB_CODE_RX_EMPTY,
+				      &regs->cantxfg[i].can_ctrl);
+		}
+	} else {
+		/* clear and invalidate all mailboxes first */
+		for (i = priv->tx_mb_first; i < ARRAY_SIZE(regs->cantxfg); i++) {
+			flexcan_write(FLEXCAN_MB_CODE_RX_INACTIVE,
+				      &regs->cantxfg[i].can_ctrl);
+		}
 	}
 
 	/* Errata ERR005829: mark first TX mailbox as INACTIVE */
 	flexcan_write(FLEXCAN_MB_CODE_TX_INACTIVE,
-		      &regs->cantxfg[FLEXCAN_TX_BUF_RESERVED].can_ctrl);
+		      &regs->cantxfg[priv->tx_mb_reserved_idx].can_ctrl);
 
-	/* mark TX mailbox as INACTIVE */
-	flexcan_write(FLEXCAN_MB_CODE_TX_INACTIVE,
-		      &regs->cantxfg[FLEXCAN_TX_BUF_ID].can_ctrl);
+	/* mark TX mailboxes as INACTIVE */
+	for (i = 0; i < FLEXCAN_TX_BUF_COUNT; i++) {
+		flexcan_write(FLEXCAN_MB_CODE_TX_INACTIVE,
+			      &regs->cantxfg[priv->tx_mb_first + i].can_ctrl);
+	}
+	priv->tx_pending = 0;
+	priv->tx_next = 0;
+	netdev_reset_queue(dev);
 
 	/* acceptance mask/acceptance code (accept everything) */
 	flexcan_write(0x0, &regs->rxgmask);
@@ -985,8 +1269,17 @@ static int flexcan_chip_start(struct net_device *dev)
 
 	priv->can.state = CAN_STATE_ERROR_ACTIVE;
 
-	/* enable FIFO interrupts */
-	flexcan_write(FLEXCAN_IFLAG_DEFAULT, &regs->imask1);
+	/* enable FIFO or RX mailbox interrupts */
+	imask = GENMASK_ULL(priv->tx_mb_first + FLEXCAN_TX_BUF_COUNT - 1,
+			    priv->tx_mb_first);
+	if (flexcan_use_rx_mailbox(priv))
+		imask |= GENMASK_ULL(FLEXCAN_MB_RX_LAST, FLEXCAN_MB_RX_FIRST);
+	else
+		imask |= FLEXCAN_IFLAG_DEFAULT;
+	priv->reg_imask1_default = lower_32_bits(imask);
+	priv->reg_imask2_default = upper_32_bits(imask);
+	flexcan_write(priv->reg_imask2_default, &regs->imask2);
+	flexcan_write(priv->reg_imask1_default, &regs->imask1);
 
 	/* print chip status */
 	netdev_dbg(dev, "%s: reading mcr=0x%08x ctrl=0x%08x\n", __func__,
@@ -1017,10 +1310,13 @@ static void flexcan_chip_stop(struct net_device *dev)
 	flexcan_chip_disable(priv);
 
 	/* Disable all interrupts */
+	flexcan_write(0, &regs->imask2);
 	flexcan_write(0, &regs->imask1);
 	flexcan_write(priv->reg_ctrl_default & ~FLEXCAN_CTRL_ERR_ALL,
 		      &regs->ctrl);
 
+	skb_queue_purge(&priv->rx_queue);
+
 	flexcan_transceiver_disable(priv);
 	priv->can.state = CAN_STATE_STOPPED;
 
@@ -1303,7 +1599,7 @@ static int flexcan_probe(struct platform_device *pdev)
 		return -ENODEV;
 	}
 
-	dev = alloc_candev(sizeof(struct flexcan_priv), 1);
+	dev = alloc_candev(sizeof(struct flexcan_priv), FLEXCAN_TX_BUF_COUNT);
 	if (!dev)
 		return -ENOMEM;
 
@@ -1326,8 +1622,20 @@ static int flexcan_probe(struct platform_device *pdev)
 	priv->devtype_data = devtype_data;
 
 	priv->reg_xceiver = reg_xceiver;
-
-	netif_napi_add(dev, &priv->napi, flexcan_poll, FLEXCAN_NAPI_WEIGHT);
+	skb_queue_head_init(&priv->rx_queue);
+	spin_lock_init(&priv->tx_lock);
+
+	if (flexcan_use_rx_mailbox(priv)) {
+		priv->tx_mb_first = FLEXCAN_MB_TX_BUF_FIRST;
+		priv->tx_mb_reserved_idx = FLEXCAN_MB_TX_BUF_RESERVED;
+		netif_napi_add(dev, &priv->napi, flexcan_poll,
+			       FLEXCAN_NAPI_WEIGHT_MB);
+	} else {
+		priv->tx_mb_first = FLEXCAN_TX_BUF_FIRST;
+		priv->tx_mb_reserved_idx = FLEXCAN_TX_BUF_RESERVED;
+		netif_napi_add(dev, &priv->napi, flexcan_poll,
+			       FLEXCAN_NAPI_WEIGHT);
+	}
 
 	platform_set_drvdata(pdev, dev);
 	SET_NETDEV_DEV(dev, &pdev->dev);
@@ -13,6 +13,7 @@
 #define	FEC_H
 /****************************************************************************/
 
+#include <linux/bpf.h>
 #include <linux/clocksource.h>
 #include <linux/net_tstamp.h>
 #include <linux/pm_qos.h>
@@ -380,6 +381,21 @@ struct bufdesc_ex {
 #define FEC_ITR_ICFT_DEFAULT	200  /* Set 200 frame count threshold */
 #define FEC_ITR_ICTT_DEFAULT	1000 /* Set 1000us timer threshold */
 
+/* Adaptive interrupt coalescing: the rate seen by NAPI is sampled every
+ * FEC_ITR_ADAPT_INTERVAL and picks one of three levels. LOW disables
+ * coalescing, MID caps it at FEC_ITR_ADAPT_MID_*, HIGH uses the static
+ * rx/tx-usecs and frames settings.
+ */
+#define FEC_ITR_ADAPT_INTERVAL		(HZ / 10)
+#define FEC_ITR_ADAPT_LOW_PPS		2000
+#define FEC_ITR_ADAPT_HIGH_PPS		20000
+#define FEC_ITR_ADAPT_MID_FRAMES	16
+#define FEC_ITR_ADAPT_MID_USECS		100
+
+#define FEC_ITR_LEVEL_LOW	0
+#define FEC_ITR_LEVEL_MID	1
+#define FEC_ITR_LEVEL_HIGH	2
+
 #define FEC_VLAN_TAG_LEN	0x04
 #define FEC_ETHTYPE_LEN		0x02
 
@@ -442,6 +458,8 @@ struct bufdesc_ex {
  * to wait mode.
  */
 #define FEC_QUIRK_BUG_WAITMODE         (1 << 13)
+/* Controller has interrupt coalescing registers */
+#define FEC_QUIRK_HAS_COALESCE		(1 << 14)
 
 struct fec_enet_stop_mode {
 	struct regmap *gpr;
@@ -449,10 +467,48 @@ struct fec_enet_stop_mode {
 	u8 req_bit;
 };
 
+/* IEEE 1588 timer channel, one per ENET_1588_EVENTn pin */
+#define FEC_PTP_CHANNELS	4
+
+struct fec_ptp_channel {
+	enum ptp_pin_function func;	/* PTP_PF_NONE when idle */
+	unsigned int index;		/* extts or perout request index */
+	u32 period;			/* perout only, in ns */
+	u32 next;			/* perout only, compare after next */
+};
+
+/* Latency histograms: bucket n counts events that took less than 2^n us,
+ * the last bucket everything from 2^(FEC_LAT_HIST_BUCKETS - 2) us on.
+ */
+#define FEC_LAT_HIST_BUCKETS	12
+
+/* ethtool private flags */
+#define FEC_PRIV_FLAG_LAT_HIST	(1 << 0)
+
+/* Per-queue software counters, exported through ethtool -S */
+struct fec_enet_rxq_stats {
+	unsigned long copybreak;
+	unsigned long page_reuse;
+	unsigned long page_alloc;
+	unsigned long alloc_failed;
+	unsigned long budget_exhausted;
+	unsigned long bpf_drop;
+	unsigned long bpf_redirect;
+};
+
+struct fec_enet_txq_stats {
+	unsigned long queue_stopped;
+	unsigned long queue_woken;
+	unsigned long tx_bounce;	/* buffers copied for alignment */
+};
+
 struct fec_enet_priv_tx_q {
 	int index;
 	unsigned char *tx_bounce[TX_RING_SIZE];
 	struct  sk_buff *tx_skbuff[TX_RING_SIZE];
+	/* xmit time in ns, only kept with FEC_PRIV_FLAG_LAT_HIST */
+	u64 tx_ts[TX_RING_SIZE];
+	struct fec_enet_txq_stats stats;
 
 	dma_addr_t	bd_dma;
 	struct bufdesc	*tx_bd_base;
@@ -467,15 +523,27 @@ struct fec_enet_priv_tx_q {
 	dma_addr_t tso_hdrs_dma;
 };
 
+/* Each RX descriptor owns one DMA-mapped page and hands FEC_ENET_RX_FRSIZE
+ * sized slices of it to the stack, flipping to the next slice when the
+ * page can be recycled.
+ */
+struct fec_enet_rx_buffer {
+	struct page *page;
+	unsigned int page_offset;
+	dma_addr_t dma;
+};
+
 struct fec_enet_priv_rx_q {
 	int index;
-	struct  sk_buff *rx_skbuff[RX_RING_SIZE];
+	struct fec_enet_rx_buffer rx_buf[RX_RING_SIZE];
 
 	dma_addr_t	bd_dma;
 	struct bufdesc	*rx_bd_base;
 	uint rx_ring_size;
 
 	struct bufdesc	*cur_rx;
+
+	struct fec_enet_rxq_stats stats;
 };
 
 /* The FEC buffer descriptors track the ring buffers.  The rx_bd_base and
@@ -510,6 +578,11 @@ struct fec_enet_private {
 	unsigned int total_tx_ring_size;
 	unsigned int total_rx_ring_size;
 
+	/* all the descriptor rings, from iram_dma_alloc_coherent() */
+	void *bd_base;
+	dma_addr_t bd_dma;
+	size_t bd_size;
+
 	unsigned long work_tx;
 	unsigned long work_rx;
 	unsigned long work_ts;
@@ -571,8 +644,28 @@ struct fec_enet_private {
 	unsigned int tx_time_itr;
 	unsigned int itr_clk_rate;
 
+	/* adaptive interrupt coalesce */
+	bool use_adaptive_rx_coal;
+	bool use_adaptive_tx_coal;
+	bool itr_busy;
+	unsigned int rx_itr_level;
+	unsigned int tx_itr_level;
+	unsigned int itr_rx_frames;
+	unsigned int itr_tx_frames;
+	unsigned long itr_last_update;
+
 	u32 rx_copybreak;
 
+	/* software statistics */
+	u32 priv_flags;
+	unsigned long napi_polls;
+	unsigned long napi_budget_exhausted;
+	unsigned long mdio_ops;
+	unsigned long mdio_timeouts;
+	u64 irq_ts;
+	unsigned long irq_napi_hist[FEC_LAT_HIST_BUCKETS];
+	unsigned long xmit_compl_hist[FEC_LAT_HIST_BUCKETS];
+
 	/* ptp clock period in ns*/
 	unsigned int ptp_inc;
 
@@ -582,7 +675,23 @@ struct fec_enet_private {
 	int pps_enable;
 	unsigned int next_counter;
 
+	/* external timestamps and periodic outputs */
+	struct fec_ptp_channel ptp_chan[FEC_PTP_CHANNELS];
+	struct ptp_pin_desc ptp_pins[FEC_PTP_CHANNELS];
+	/* FEC_ATIME_CTRL as last written, without the capture bit */
+	u32 ptp_ctrl;
+
 	struct fec_enet_stop_mode gpr;
+
+#ifdef CONFIG_FEC_CAPTURE
+	struct fec_enet_capture *capture;
+	bool capture_active;
+#endif
+
+#ifdef CONFIG_FEC_RX_BPF
+	struct bpf_prog __rcu *rx_prog;
+	int rx_redirect_ifindex;
+#endif
 };
 
 void fec_ptp_init(struct platform_device *pdev);
@@ -591,5 +700,63 @@ int fec_ptp_set(struct net_device *ndev, struct ifreq *ifr);
 int fec_ptp_get(struct net_device *ndev, struct ifreq *ifr);
 uint fec_ptp_check_pps_event(struct fec_enet_private *fep);
 
+#ifdef CONFIG_FEC_CAPTURE
+void fec_capture_init(struct fec_enet_private *fep);
+void fec_capture_remove(struct fec_enet_private *fep);
+void fec_capture_ring_reset(struct fec_enet_private *fep,
+			    struct fec_enet_priv_rx_q *rxq);
+int fec_capture_rx(struct fec_enet_private *fep,
+		   struct fec_enet_priv_rx_q *rxq, int budget);
+void fec_enet_set_capture(struct net_device *ndev, bool on);
+
+/* Only the first RX ring can be captured */
+static inline bool fec_capture_active(struct fec_enet_private *fep, int queue)
+{
+	return queue == 0 && fep->capture_active;
+}
+#else
+static inline void fec_capture_init(struct fec_enet_private *fep) {}
+static inline void fec_capture_remove(struct fec_enet_private *fep) {}
+static inline void fec_capture_ring_reset(struct fec_enet_private *fep,
+					  struct fec_enet_priv_rx_q *rxq) {}
+static inline int fec_capture_rx(struct fec_enet_private *fep,
+				 struct fec_enet_priv_rx_q *rxq, int budget)
+{
+	return 0;
+}
+static inline bool fec_capture_active(struct fec_enet_private *fep, int queue)
+{
+	return false;
+}
+#endif
+
+#ifdef CONFIG_FEC_RX_BPF
+void fec_rx_bpf_init(struct fec_enet_private *fep);
+void fec_rx_bpf_remove(struct fec_enet_private *fep);
+u32 __fec_rx_bpf_run(struct fec_enet_private *fep, void *data, u32 len);
+void fec_rx_bpf_redirect(struct fec_enet_private *fep, struct sk_buff *skb);
+
+static inline u32 fec_rx_bpf_run(struct fec_enet_private *fep,
+				 void *data, u32 len)
+{
+	if (likely(!rcu_access_pointer(fep->rx_prog)))
+		return BPF_RX_PASS;
+	return __fec_rx_bpf_run(fep, data, len);
+}
+#else
+static inline void fec_rx_bpf_init(struct fec_enet_private *fep) {}
+static inline void fec_rx_bpf_remove(struct fec_enet_private *fep) {}
+static inline u32 fec_rx_bpf_run(struct fec_enet_private *fep,
+				 void *data, u32 len)
+{
+	return BPF_RX_PASS;
+}
+static inline void fec_rx_bpf_redirect(struct fec_enet_private *fep,
+				       struct sk_buff *skb)
+{
+	kfree_skb(skb);
+}
+#endif
+
 /****************************************************************************/
 #endif /* FEC_H */
@@ -0,0 +1,486 @@
+/*
+ * Fast Ethernet Controller (ENET) zero-copy RX capture device.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * While capture is active the first RX ring is detached from the network
+ * stack: every descriptor points into a coherent buffer that userspace has
+ * mmap()ed, NAPI only fills in struct fec_capture_meta for each received
+ * frame, and a descriptor is only handed back to the controller once
+ * userspace has returned its slot. See include/uapi/linux/fec_capture.h.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/netdevice.h>
+#include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/rtnetlink.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/dma-mapping.h>
+#include <linux/fec_capture.h>
+
+#include "fec.h"
+
+#define FEC_CAPTURE_SLOT_SIZE	FEC_ENET_RX_FRSIZE
+
+/*
+ * An open file keeps this around past fec_capture_remove(), which only
+ * clears fep: every file operation checks it under the lock.
+ */
+struct fec_enet_capture {
+	struct kref kref;
+	struct device *dev;
+	struct fec_enet_private *fep;
+	struct miscdevice misc;
+	char name[16];
+
+	struct mutex lock;
+	bool busy;
+
+	void *area;
+	dma_addr_t area_dma;
+	size_t area_size;
+	unsigned int nr_slots;
+	unsigned int data_offset;
+	struct fec_capture_meta *meta;
+
+	/* Owned by NAPI: oldest slot held by userspace and how many */
+	unsigned int dirty;
+	unsigned int user_count;
+	bool reset;
+
+	wait_queue_head_t wait;
+	struct fec_capture_stats stats;
+};
+
+static inline struct bufdesc *
+fec_capture_bd(struct fec_enet_private *fep, struct fec_enet_priv_rx_q *rxq,
+	       unsigned int index)
+{
+	return (struct bufdesc *)((char *)rxq->rx_bd_base +
+				  index * fep->bufdesc_size);
+}
+
+static inline unsigned int
+fec_capture_bd_index(struct fec_enet_private *fep,
+		     struct fec_enet_priv_rx_q *rxq, struct bufdesc *bdp)
+{
+	return ((char *)bdp - (char *)rxq->rx_bd_base) / fep->bufdesc_size;
+}
+
+static void fec_capture_arm(struct fec_enet_private *fep, struct bufdesc *bdp)
+{
+	if (fep->bufdesc_ex) {
+		struct bufdesc_ex *ebdp = (struct bufdesc_ex *)bdp;
+
+		ebdp->cbd_esc = BD_ENET_RX_INT;
+		ebdp->cbd_prot = 0;
+		ebdp->cbd_bdu = 0;
+	}
+	bdp->cbd_sc = (bdp->cbd_sc & BD_SC_WRAP) | BD_ENET_RX_EMPTY;
+}
+
+/* Called from fec_enet_bd_init() whenever the controller is (re)started
+ * with capture active. Every slot goes back to the controller; if
+ * userspace still held some, it is told through POLLERR to resume at 0.
+ */
+void fec_capture_ring_reset(struct fec_enet_private *fep,
+			    struct fec_enet_priv_rx_q *rxq)
+{
+	struct fec_enet_capture *cap = fep->capture;
+	struct bufdesc *bdp;
+	unsigned int i;
+
+	for (i = 0; i < rxq->rx_ring_size; i++) {
+		bdp = fec_capture_bd(fep, rxq, i);
+		cap->meta[i].status = FEC_CAPTURE_KERNEL;
+		bdp->cbd_bufaddr = cap->area_dma + cap->data_offset +
+				   i * FEC_CAPTURE_SLOT_SIZE;
+		bdp->cbd_sc = 0;
+		fec_capture_arm(fep, bdp);
+	}
+
+	if (cap->user_count)
+		cap->reset = true;
+	cap->dirty = 0;
+	cap->user_count = 0;
+	wake_up_interruptible(&cap->wait);
+}
+
+/* Give the controller back every slot userspace has returned, in order */
+static void fec_capture_refill(struct fec_enet_private *fep,
+			       struct fec_enet_priv_rx_q *rxq)
+{
+	struct fec_enet_capture *cap = fep->capture;
+	unsigned int armed = 0;
+
+	while (cap->user_count) {
+		if (READ_ONCE(cap->meta[cap->dirty].status) !=
+		    FEC_CAPTURE_KERNEL)
+			break;
+
+		fec_capture_arm(fep, fec_capture_bd(fep, rxq, cap->dirty));
+		if (++cap->dirty == cap->nr_slots)
+			cap->dirty = 0;
+		cap->user_count--;
+		armed++;
+	}
+
+	if (armed)
+		writel(0, fep->hwp + FEC_R_DES_ACTIVE(rxq->index));
+	else if (cap->user_count == cap->nr_slots)
+		cap->stats.ring_full++;
+}
+
+static u64 fec_capture_hwtstamp(struct fec_enet_private *fep, unsigned ts)
+{
+	unsigned long flags;
+	u64 ns;
+
+	spin_lock_irqsave(&fep->tmreg_lock, flags);
+	ns = timecounter_cyc2time(&fep->tc, ts);
+	spin_unlock_irqrestore(&fep->tmreg_lock, flags);
+
+	return ns;
+}
+
+/* NAPI receive for a captured ring: publish metadata, never touch data */
+int fec_capture_rx(struct fec_enet_private *fep,
+		   struct fec_enet_priv_rx_q *rxq, int budget)
+{
+	struct fec_enet_capture *cap = fep->capture;
+	struct bufdesc *bdp = rxq->cur_rx;
+	struct fec_capture_meta *meta;
+	unsigned short status;
+	int pkt_received = 0;
+	u16 flags;
+
+	while (!((status = bdp->cbd_sc) & BD_ENET_RX_EMPTY)) {
+		/* Every slot is with userspace, nothing new can be here */
+		if (cap->user_count == cap->nr_slots)
+			break;
+
+		if (pkt_received >= budget)
+			break;
+		pkt_received++;
+
+		writel(FEC_ENET_RXF, fep->hwp + FEC_IEVENT);
+
+		meta = &cap->meta[fec_capture_bd_index(fep, rxq, bdp)];
+		flags = 0;
+
+		status ^= BD_ENET_RX_LAST;
+		if (status & (BD_ENET_RX_LG | BD_ENET_RX_SH | BD_ENET_RX_NO |
+			      BD_ENET_RX_CR | BD_ENET_RX_OV | BD_ENET_RX_LAST |
+			      BD_ENET_RX_CL)) {
+			flags |= FEC_CAPTURE_F_ERROR;
+			cap->stats.errors++;
+		}
+
+		if (fep->bufdesc_ex) {
+			struct bufdesc_ex *ebdp = (struct bufdesc_ex *)bdp;
+
+			if (ebdp->cbd_esc & BD_ENET_RX_VLAN)
+				flags |= FEC_CAPTURE_F_VLAN;
+			if (fep->hwts_rx_en) {
+				meta->ts_ns = fec_capture_hwtstamp(fep,
+								   ebdp->ts);
+				flags |= FEC_CAPTURE_F_HWTSTAMP;
+			}
+		}
+		if (!(flags & FEC_CAPTURE_F_HWTSTAMP))
+			meta->ts_ns = ktime_get_real_ns();
+
+		/* The packet length includes FCS */
+		meta->len = bdp->cbd_datlen > 4 ? bdp->cbd_datlen - 4 : 0;
+		meta->flags = flags;
+		cap->stats.frames++;
+
+		/* Publish the metadata before the slot changes hands */
+		wmb();
+		WRITE_ONCE(meta->status, FEC_CAPTURE_USER);
+		cap->user_count++;
+
+		bdp = fec_capture_bd(fep, rxq,
+				     (fec_capture_bd_index(fep, rxq, bdp) + 1) %
+				     cap->nr_slots);
+	}
+	rxq->cur_rx = bdp;
+
+	if (pkt_received)
+		wake_up_interruptible(&cap->wait);
+
+	fec_capture_refill(fep, rxq);
+
+	return pkt_received;
+}
+
+static void fec_capture_free(struct kref *kref)
+{
+	struct fec_enet_capture *cap = container_of(kref,
+						    struct fec_enet_capture,
+						    kref);
+
+	put_device(cap->dev);
+	kfree(cap);
+}
+
+static int fec_capture_open(struct inode *inode, struct file *file)
+{
+	struct fec_enet_capture *cap = container_of(file->private_data,
+						    struct fec_enet_capture,
+						    misc);
+	int ret = 0;
+
+	mutex_lock(&cap->lock);
+	if (!cap->fep) {
+		ret = -ENODEV;
+		goto out;
+	}
+	if (cap->busy) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	cap->area = dma_alloc_coherent(cap->dev, cap->area_size,
+				       &cap->area_dma, GFP_KERNEL);
+	if (!cap->area) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memset(cap->area, 0, cap->area_size);
+	cap->meta = cap->area;
+	memset(&cap->stats, 0, sizeof(cap->stats));
+	cap->reset = false;
+	cap->busy = true;
+	kref_get(&cap->kref);
+
+out:
+	mutex_unlock(&cap->lock);
+	return ret ? ret : nonseekable_open(inode, file);
+}
+
+static int fec_capture_release(struct inode *inode, struct file *file)
+{
+	struct fec_enet_capture *cap = container_of(file->private_data,
+						    struct fec_enet_capture,
+						    misc);
+
+	mutex_lock(&cap->lock);
+	if (cap->fep) {
+		rtnl_lock();
+		fec_enet_set_capture(cap->fep->netdev, false);
+		rtnl_unlock();
+	}
+
+	dma_free_coherent(cap->dev, cap->area_size, cap->area, cap->area_dma);
+	cap->area = NULL;
+	cap->meta = NULL;
+	cap->busy = false;
+	mutex_unlock(&cap->lock);
+
+	kref_put(&cap->kref, fec_capture_free);
+	return 0;
+}
+
+static int fec_capture_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fec_enet_capture *cap = container_of(file->private_data,
+						    struct fec_enet_capture,
+						    misc);
+	size_t size = vma->vm_end - vma->vm_start;
+
+	if (vma->vm_pgoff || size > cap->area_size)
+		return -EINVAL;
+
+	/* the area stays until release, the device may be gone already */
+	return dma_mmap_coherent(cap->dev, vma, cap->area, cap->area_dma,
+				 size);
+}
+
+static unsigned int fec_capture_poll(struct file *file, poll_table *wait)
+{
+	struct fec_enet_capture *cap = container_of(file->private_data,
+						    struct fec_enet_capture,
+						    misc);
+	struct fec_enet_private *fep;
+	struct fec_enet_priv_rx_q *rxq;
+	unsigned int mask = 0;
+	unsigned int last;
+
+	poll_wait(file, &cap->wait, wait);
+
+	mutex_lock(&cap->lock);
+	fep = cap->fep;
+	if (!fep) {
+		mask = POLLERR | POLLHUP;
+		goto out;
+	}
+	if (!fep->capture_active) {
+		mask = POLLERR;
+		goto out;
+	}
+	rxq = fep->rx_queue[0];
+
+	/* Slots returned since the last NAPI run are re-armed from there */
+	if (READ_ONCE(cap->user_count) &&
+	    READ_ONCE(cap->meta[READ_ONCE(cap->dirty)].status) ==
+	    FEC_CAPTURE_KERNEL)
+		napi_schedule(&fep->napi);
+
+	if (cap->reset) {
+		cap->reset = false;
+		mask |= POLLERR;
+	}
+
+	/* Like TPACKET rings: readable while the newest slot is unreturned */
+	last = fec_capture_bd_index(fep, rxq, READ_ONCE(rxq->cur_rx));
+	last = last ? last - 1 : cap->nr_slots - 1;
+	if (READ_ONCE(cap->meta[last].status) == FEC_CAPTURE_USER)
+		mask |= POLLIN | POLLRDNORM;
+out:
+	mutex_unlock(&cap->lock);
+	return mask;
+}
+
+static long fec_capture_ioctl(struct file *file, unsigned int cmd,
+			      unsigned long arg)
+{
+	struct fec_enet_capture *cap = container_of(file->private_data,
+						    struct fec_enet_capture,
+						    misc);
+	void __user *argp = (void __user *)arg;
+	struct fec_capture_info info;
+	struct net_device *ndev;
+	int ret = 0;
+
+	mutex_lock(&cap->lock);
+	if (!cap->fep) {
+		mutex_unlock(&cap->lock);
+		return -ENODEV;
+	}
+	ndev = cap->fep->netdev;
+
+	switch (cmd) {
+	case FEC_CAPTURE_GET_INFO:
+		memset(&info, 0, sizeof(info));
+		info.nr_slots = cap->nr_slots;
+		info.slot_size = FEC_CAPTURE_SLOT_SIZE;
+		info.meta_offset = 0;
+		info.data_offset = cap->data_offset;
+		info.mmap_size = cap->area_size;
+		if (copy_to_user(argp, &info, sizeof(info)))
+			ret = -EFAULT;
+		break;
+	case FEC_CAPTURE_START:
+	case FEC_CAPTURE_STOP:
+		rtnl_lock();
+		if (cmd == FEC_CAPTURE_START && !netif_running(ndev))
+			ret = -ENETDOWN;
+		else
+			fec_enet_set_capture(ndev, cmd == FEC_CAPTURE_START);
+		rtnl_unlock();
+		break;
+	case FEC_CAPTURE_GET_STATS:
+		if (copy_to_user(argp, &cap->stats, sizeof(cap->stats)))
+			ret = -EFAULT;
+		break;
+	default:
+		ret = -ENOTTY;
+		break;
+	}
+	mutex_unlock(&cap->lock);
+
+	return ret;
+}
+
+static const struct file_operations fec_capture_fops = {
+	.owner		= THIS_MODULE,
+	.open		= fec_capture_open,
+	.release	= fec_capture_release,
+	.mmap		= fec_capture_mmap,
+	.poll		= fec_capture_poll,
+	.unlocked_ioctl	= fec_capture_ioctl,
+	.llseek		= no_llseek,
+};
+
+void fec_capture_init(struct fec_enet_private *fep)
+{
+	struct fec_enet_capture *cap;
+	int ret;
+
+	cap = kzalloc(sizeof(*cap), GFP_KERNEL);
+	if (!cap)
+		return;
+
+	kref_init(&cap->kref);
+	cap->dev = get_device(&fep->pdev->dev);
+	cap->fep = fep;
+	cap->nr_slots = fep->rx_queue[0]->rx_ring_size;
+	cap->data_offset = PAGE_ALIGN(cap->nr_slots *
+				      sizeof(struct fec_capture_meta));
+	cap->area_size = cap->data_offset +
+			 cap->nr_slots * FEC_CAPTURE_SLOT_SIZE;
+	mutex_init(&cap->lock);
+	init_waitqueue_head(&cap->wait);
+
+	snprintf(cap->name, sizeof(cap->name), "fec_capture%d", fep->dev_id);
+	cap->misc.minor = MISC_DYNAMIC_MINOR;
+	cap->misc.name = cap->name;
+	cap->misc.fops = &fec_capture_fops;
+	cap->misc.parent = &fep->pdev->dev;
+
+	ret = misc_register(&cap->misc);
+	if (ret) {
+		netdev_warn(fep->netdev, "capture device disabled: %d\n", ret);
+		kref_put(&cap->kref, fec_capture_free);
+		return;
+	}
+
+	fep->capture = cap;
+}
+
+/*
+ * No new opens after misc_deregister().  A file still open loses the
+ * controller: capture is handed back to the stack and the file only
+ * gets -ENODEV and POLLHUP from now on.  Its buffer goes at release.
+ */
+void fec_capture_remove(struct fec_enet_private *fep)
+{
+	struct fec_enet_capture *cap = fep->capture;
+
+	if (!cap)
+		return;
+
+	misc_deregister(&cap->misc);
+
+	mutex_lock(&cap->lock);
+	if (cap->busy) {
+		rtnl_lock();
+		fec_enet_set_capture(fep->netdev, false);
+		rtnl_unlock();
+	}
+	cap->fep = NULL;
+	mutex_unlock(&cap->lock);
+	wake_up_interruptible(&cap->wait);
+
+	fep->capture = NULL;
+	kref_put(&cap->kref, fec_capture_free);
+}
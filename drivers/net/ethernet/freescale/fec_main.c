@@ -41,6 +41,7 @@
 #include <linux/udp.h>
 #include <linux/icmp.h>
 #include <linux/spinlock.h>
+#include <linux/genalloc.h>
 #include <linux/workqueue.h>
 #include <linux/bitops.h>
 #include <linux/io.h>
@@ -60,6 +61,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/busfreq-imx.h>
 #include <linux/prefetch.h>
+#include <net/busy_poll.h>
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
 
@@ -67,8 +69,13 @@
 
 #include "fec.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/fec.h>
+
 static void set_multicast_list(struct net_device *ndev);
 static void fec_enet_itr_coal_init(struct net_device *ndev);
+static void fec_enet_itr_coal_set(struct net_device *ndev);
+static void fec_enet_itr_adapt(struct net_device *ndev, int pkts, int budget);
 
 #define DRIVER_NAME	"fec"
 
@@ -113,12 +120,12 @@ static struct platform_device_id fec_devtype[] = {
 				FEC_QUIRK_HAS_BUFDESC_EX | FEC_QUIRK_HAS_CSUM |
 				FEC_QUIRK_HAS_VLAN | FEC_QUIRK_HAS_AVB |
 				FEC_QUIRK_ERR007885 | FEC_QUIRK_BUG_CAPTURE |
-				FEC_QUIRK_HAS_RACC,
+				FEC_QUIRK_HAS_RACC | FEC_QUIRK_HAS_COALESCE,
 	}, {
 		.name = "imx6ul-fec",
 		.driver_data = FEC_QUIRK_ENET_MAC | FEC_QUIRK_HAS_GBIT |
 				FEC_QUIRK_HAS_BUFDESC_EX | FEC_QUIRK_HAS_CSUM |
-				FEC_QUIRK_HAS_VLAN,
+				FEC_QUIRK_HAS_VLAN | FEC_QUIRK_HAS_COALESCE,
 	}, {
 		/* sentinel */
 	}
@@ -219,6 +226,9 @@ MODULE_PARM_DESC(macaddr, "FEC Ethernet MAC address");
 
 #define COPYBREAK_DEFAULT	256
 
+/* Headroom in front of each RX slice, kept aligned for every rx_align */
+#define FEC_ENET_RX_HEADROOM	ALIGN(NET_SKB_PAD, 64)
+
 #define TSO_HEADER_SIZE		128
 /* Max number of allowed TCP segments for software TSO */
 #define FEC_MAX_TSO_SEGS	100
@@ -308,6 +318,30 @@ static int fec_enet_get_free_txdesc_num(struct fec_enet_private *fep,
 	return entries >= 0 ? entries : entries + txq->tx_ring_size;
 }
 
+static int fec_enet_get_busy_txdesc_num(struct fec_enet_private *fep,
+					struct fec_enet_priv_tx_q *txq)
+{
+	return txq->tx_ring_size - 2 - fec_enet_get_free_txdesc_num(fep, txq);
+}
+
+static void fec_enet_lat_hist_add(unsigned long *hist, u64 start_ns)
+{
+	u64 us = div_u64(ktime_get_ns() - start_ns, NSEC_PER_USEC);
+
+	if (us >= 1 << (FEC_LAT_HIST_BUCKETS - 2))
+		hist[FEC_LAT_HIST_BUCKETS - 1]++;
+	else
+		hist[fls((u32)us)]++;
+}
+
+static inline void fec_enet_tx_stamp(struct fec_enet_private *fep,
+				     struct fec_enet_priv_tx_q *txq,
+				     unsigned int index)
+{
+	txq->tx_ts[index] = (fep->priv_flags & FEC_PRIV_FLAG_LAT_HIST) ?
+			    ktime_get_ns() : 0;
+}
+
 static void swap_buffer(void *bufaddr, int len)
 {
 	int i;
@@ -428,6 +462,7 @@ fec_enet_txq_submit_frag_skb(struct fec_enet_priv_tx_q *txq,
 		index = fec_enet_get_bd_index(txq->tx_bd_base, bdp, fep);
 		if (((unsigned long) bufaddr) & fep->tx_align ||
 			fep->quirks & FEC_QUIRK_SWAP_FRAME) {
+			txq->stats.tx_bounce++;
 			memcpy(txq->tx_bounce[index], bufaddr, frag_len);
 			bufaddr = txq->tx_bounce[index];
 
@@ -503,6 +538,7 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 	index = fec_enet_get_bd_index(txq->tx_bd_base, bdp, fep);
 	if (((unsigned long) bufaddr) & fep->tx_align ||
 		fep->quirks & FEC_QUIRK_SWAP_FRAME) {
+		txq->stats.tx_bounce++;
 		memcpy(txq->tx_bounce[index], skb->data, buflen);
 		bufaddr = txq->tx_bounce[index];
 
@@ -554,6 +590,7 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 	index = fec_enet_get_bd_index(txq->tx_bd_base, last_bdp, fep);
 	/* Save skb pointer */
 	txq->tx_skbuff[index] = skb;
+	fec_enet_tx_stamp(fep, txq, index);
 
 	bdp->cbd_datlen = buflen;
 	bdp->cbd_bufaddr = addr;
@@ -568,6 +605,7 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 	bdp = fec_enet_get_nextdesc(last_bdp, fep, queue);
 
 	skb_tx_timestamp(skb);
+	netdev_tx_sent_queue(netdev_get_tx_queue(ndev, queue), skb->len);
 
 	/* Make sure the update to bdp and tx_skbuff are performed before
 	 * cur_tx.
@@ -575,9 +613,6 @@ static int fec_enet_txq_submit_skb(struct fec_enet_priv_tx_q *txq,
 	wmb();
 	txq->cur_tx = bdp;
 
-	/* Trigger transmission start */
-	writel(0, fep->hwp + FEC_X_DES_ACTIVE(queue));
-
 	return 0;
 }
 
@@ -601,6 +636,7 @@ fec_enet_txq_put_data_tso(struct fec_enet_priv_tx_q *txq, struct sk_buff *skb,
 
 	if (((unsigned long) data) & fep->tx_align ||
 		fep->quirks & FEC_QUIRK_SWAP_FRAME) {
+		txq->stats.tx_bounce++;
 		memcpy(txq->tx_bounce[index], data, size);
 		data = txq->tx_bounce[index];
 
@@ -664,6 +700,7 @@ fec_enet_txq_put_hdr_tso(struct fec_enet_priv_tx_q *txq,
 	dmabuf = txq->tso_hdrs_dma + index * TSO_HEADER_SIZE;
 	if (((unsigned long)bufaddr) & fep->tx_align ||
 		fep->quirks & FEC_QUIRK_SWAP_FRAME) {
+		txq->stats.tx_bounce++;
 		memcpy(txq->tx_bounce[index], skb->data, hdr_len);
 		bufaddr = txq->tx_bounce[index];
 
@@ -706,6 +743,7 @@ static int fec_enet_txq_submit_tso(struct fec_enet_priv_tx_q *txq,
 	int total_len, data_left;
 	struct bufdesc *bdp = txq->cur_tx;
 	unsigned short queue = skb_get_queue_mapping(skb);
+	struct bufdesc *used;
 	struct tso_t tso;
 	unsigned int index = 0;
 	int ret;
@@ -765,10 +803,37 @@ static int fec_enet_txq_submit_tso(struct fec_enet_priv_tx_q *txq,
 
 	/* Save skb pointer */
 	txq->tx_skbuff[index] = skb;
+	fec_enet_tx_stamp(fep, txq, index);
 
 	skb_tx_timestamp(skb);
+	netdev_tx_sent_queue(netdev_get_tx_queue(ndev, queue), skb->len);
+
+	/* Make sure the update to bdp and tx_skbuff are performed before
+	 * cur_tx.
+	 */
+	wmb();
 	txq->cur_tx = bdp;
 
+	return 0;
+
+err_release:
+	/* The skb is already freed, give back the descriptors filled so far */
+	for (used = txq->cur_tx; used != bdp;
+	     used = fec_enet_get_nextdesc(used, fep, queue)) {
+		used->cbd_sc &= BD_SC_WRAP;
+		if (used->cbd_bufaddr &&
+		    !IS_TSO_HEADER(txq, used->cbd_bufaddr))
+			dma_unmap_single(&fep->pdev->dev, used->cbd_bufaddr,
+					 used->cbd_datlen, DMA_TO_DEVICE);
+		used->cbd_bufaddr = 0;
+	}
+
+	return NETDEV_TX_OK;
+}
+
+static void fec_enet_txq_trigger(struct fec_enet_private *fep,
+				 unsigned short queue)
+{
 	/* Trigger transmission start */
 	if (!(fep->quirks & FEC_QUIRK_ERR007885) ||
 	    !readl(fep->hwp + FEC_X_DES_ACTIVE(queue)) ||
@@ -776,12 +841,6 @@ static int fec_enet_txq_submit_tso(struct fec_enet_priv_tx_q *txq,
 	    !readl(fep->hwp + FEC_X_DES_ACTIVE(queue)) ||
 	    !readl(fep->hwp + FEC_X_DES_ACTIVE(queue)))
 		writel(0, fep->hwp + FEC_X_DES_ACTIVE(queue));
-
-	return 0;
-
-err_release:
-	/* TODO: Release all used data descriptors for TSO */
-	return ret;
 }
 
 static netdev_tx_t
@@ -792,6 +851,7 @@ fec_enet_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	unsigned short queue;
 	struct fec_enet_priv_tx_q *txq;
 	struct netdev_queue *nq;
+	bool xmit_more = skb->xmit_more;
 	int ret;
 
 	queue = skb_get_queue_mapping(skb);
@@ -802,18 +862,34 @@ fec_enet_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 		ret = fec_enet_txq_submit_tso(txq, skb, ndev);
 	else
 		ret = fec_enet_txq_submit_skb(txq, skb, ndev);
-	if (ret)
+	if (ret) {
+		/* frames held back by xmit_more still have to go out */
+		fec_enet_txq_trigger(fep, queue);
 		return ret;
+	}
 
 	entries_free = fec_enet_get_free_txdesc_num(fep, txq);
-	if (entries_free <= txq->tx_stop_threshold)
+	if (entries_free <= txq->tx_stop_threshold) {
 		netif_tx_stop_queue(nq);
+		txq->stats.queue_stopped++;
+	}
+
+	/* The stack tells us more frames are on the way: ring the doorbell
+	 * once for the whole burst, unless the queue just got stopped.
+	 */
+	if (!xmit_more || netif_xmit_stopped(nq))
+		fec_enet_txq_trigger(fep, queue);
 
 	return NETDEV_TX_OK;
 }
 
 /* Init RX & TX buffer descriptors
  */
+static inline dma_addr_t fec_enet_rx_buf_dma(struct fec_enet_rx_buffer *rx_buf)
+{
+	return rx_buf->dma + rx_buf->page_offset + FEC_ENET_RX_HEADROOM;
+}
+
 static void fec_enet_bd_init(struct net_device *dev)
 {
 	struct fec_enet_private *fep = netdev_priv(dev);
@@ -831,6 +907,9 @@ static void fec_enet_bd_init(struct net_device *dev)
 		for (i = 0; i < rxq->rx_ring_size; i++) {
 
 			/* Initialize the BD for every fragment in the page. */
+			if (rxq->rx_buf[i].page)
+				bdp->cbd_bufaddr =
+					fec_enet_rx_buf_dma(&rxq->rx_buf[i]);
 			if (bdp->cbd_bufaddr)
 				bdp->cbd_sc = BD_ENET_RX_EMPTY;
 			else
@@ -838,6 +917,10 @@ static void fec_enet_bd_init(struct net_device *dev)
 			bdp = fec_enet_get_nextdesc(bdp, fep, q);
 		}
 
+		/* A captured ring points at the capture slots instead */
+		if (fec_capture_active(fep, q))
+			fec_capture_ring_reset(fep, rxq);
+
 		/* Set the last buffer to wrap */
 		bdp = fec_enet_get_prevdesc(bdp, fep, q);
 		bdp->cbd_sc |= BD_SC_WRAP;
@@ -866,6 +949,8 @@ static void fec_enet_bd_init(struct net_device *dev)
 		bdp = fec_enet_get_prevdesc(bdp, fep, q);
 		bdp->cbd_sc |= BD_SC_WRAP;
 		txq->dirty_tx = bdp;
+
+		netdev_tx_reset_queue(netdev_get_tx_queue(dev, q));
 	}
 }
 
@@ -878,11 +963,33 @@ static void fec_enet_active_rxring(struct net_device *ndev)
 		writel(0, fep->hwp + FEC_R_DES_ACTIVE(i));
 }
 
+/*
+ * The AVB rings 1 and 2 are credit-based shaped (802.1Qav).  The share
+ * of the line rate a ring is given is idle_slope / (idle_slope + 512),
+ * derived here from the queue's tx_maxrate in Mbps.  Without a rate
+ * the rings keep the reset default of half the line rate.
+ */
+static u32 fec_enet_idle_slope(struct fec_enet_private *fep, int queue,
+			       unsigned long rate)
+{
+	int speed;
+
+	speed = fep->speed ? fep->speed : SPEED_1000;
+	if (!rate)
+		return IDLE_SLOPE(queue);
+	if (rate >= speed)
+		return IDLE_SLOPE_MASK;
+
+	return min_t(u32, DIV_ROUND_UP(512 * rate, speed - rate),
+		     IDLE_SLOPE_MASK);
+}
+
 static void fec_enet_enable_ring(struct net_device *ndev)
 {
 	struct fec_enet_private *fep = netdev_priv(ndev);
 	struct fec_enet_priv_tx_q *txq;
 	struct fec_enet_priv_rx_q *rxq;
+	unsigned long rate;
 	int i;
 
 	for (i = 0; i < fep->num_rx_queues; i++) {
@@ -901,9 +1008,11 @@ static void fec_enet_enable_ring(struct net_device *ndev)
 		writel(txq->bd_dma, fep->hwp + FEC_X_DES_START(i));
 
 		/* enable DMA1/2 */
-		if (i)
-			writel(DMA_CLASS_EN | IDLE_SLOPE(i),
+		if (i) {
+			rate = netdev_get_tx_queue(ndev, i)->tx_maxrate;
+			writel(DMA_CLASS_EN | fec_enet_idle_slope(fep, i, rate),
 			       fep->hwp + FEC_DMA_CFG(i));
+		}
 	}
 }
 
@@ -1107,8 +1216,8 @@ fec_restart(struct net_device *ndev)
 	else
 		writel(FEC_ENET_MII, fep->hwp + FEC_IMASK);
 
-	/* Init the interrupt coalescing */
-	fec_enet_itr_coal_init(ndev);
+	/* Restore the interrupt coalescing */
+	fec_enet_itr_coal_set(ndev);
 
 }
 
@@ -1194,7 +1303,7 @@ fec_timeout(struct net_device *ndev)
 
 	ndev->stats.tx_errors++;
 
-	schedule_work(&fep->tx_timeout_work);
+	queue_work(system_lowlat_wq, &fep->tx_timeout_work);
 }
 
 static void fec_enet_timeout_work(struct work_struct *work)
@@ -1215,6 +1324,35 @@ static void fec_enet_timeout_work(struct work_struct *work)
 	rtnl_unlock();
 }
 
+#ifdef CONFIG_FEC_CAPTURE
+/* Hand the first RX ring to the capture device or back to the stack.
+ * NAPI is stopped across the switch so it never sees a half-converted
+ * ring; the restart re-initialises every descriptor. Called with RTNL.
+ */
+void fec_enet_set_capture(struct net_device *ndev, bool on)
+{
+	struct fec_enet_private *fep = netdev_priv(ndev);
+
+	ASSERT_RTNL();
+
+	if (fep->capture_active == on)
+		return;
+
+	if (!netif_running(ndev)) {
+		fep->capture_active = on;
+		return;
+	}
+
+	napi_disable(&fep->napi);
+	netif_tx_lock_bh(ndev);
+	fep->capture_active = on;
+	fec_restart(ndev);
+	netif_tx_wake_all_queues(ndev);
+	netif_tx_unlock_bh(ndev);
+	napi_enable(&fep->napi);
+}
+#endif
+
 static void
 fec_enet_hwtstamp(struct fec_enet_private *fep, unsigned ts,
 	struct skb_shared_hwtstamps *hwtstamps)
@@ -1231,7 +1369,7 @@ fec_enet_hwtstamp(struct fec_enet_private *fep, unsigned ts,
 }
 
 static void
-fec_enet_tx_queue(struct net_device *ndev, u16 queue_id)
+fec_enet_tx_queue(struct net_device *ndev, u16 queue_id, int budget)
 {
 	struct	fec_enet_private *fep;
 	struct bufdesc *bdp, *bdp_t;
@@ -1242,6 +1380,7 @@ fec_enet_tx_queue(struct net_device *ndev, u16 queue_id)
 	int	index = 0;
 	int	i, bdnum;
 	int	entries_free;
+	unsigned int pkts_compl = 0, bytes_compl = 0;
 
 	fep = netdev_priv(ndev);
 
@@ -1320,8 +1459,18 @@ fec_enet_tx_queue(struct net_device *ndev, u16 queue_id)
 		if (status & BD_ENET_TX_DEF)
 			ndev->stats.collisions++;
 
+		pkts_compl++;
+		bytes_compl += skb->len;
+
+		if (unlikely(txq->tx_ts[index])) {
+			if (fep->priv_flags & FEC_PRIV_FLAG_LAT_HIST)
+				fec_enet_lat_hist_add(fep->xmit_compl_hist,
+						      txq->tx_ts[index]);
+			txq->tx_ts[index] = 0;
+		}
+
 		/* Free the sk buffer associated with this last transmit */
-		dev_kfree_skb_any(skb);
+		napi_consume_skb(skb, budget);
 
 		/* Make sure the update to bdp and tx_skbuff are performed
 		 * before dirty_tx
@@ -1331,16 +1480,28 @@ fec_enet_tx_queue(struct net_device *ndev, u16 queue_id)
 
 		/* Update pointer to next buffer descriptor to be transmitted */
 		bdp = fec_enet_get_nextdesc(bdp, fep, queue_id);
+	}
 
-		/* Since we have freed up a buffer, the ring is no longer full
-		 */
-		if (netif_queue_stopped(ndev)) {
+	/* Report the whole batch at once, then see whether the ring has
+	 * drained far enough to restart the queue.
+	 */
+	if (pkts_compl) {
+		fep->itr_tx_frames += pkts_compl;
+		netdev_tx_completed_queue(nq, pkts_compl, bytes_compl);
+
+		if (netif_tx_queue_stopped(nq)) {
 			entries_free = fec_enet_get_free_txdesc_num(fep, txq);
-			if (entries_free >= txq->tx_wake_threshold)
+			if (entries_free >= txq->tx_wake_threshold) {
 				netif_tx_wake_queue(nq);
+				txq->stats.queue_woken++;
+			}
 		}
 	}
 
+	trace_fec_tx_queue(ndev, queue_id, pkts_compl, bytes_compl,
+			   fec_enet_get_busy_txdesc_num(fep, txq),
+			   txq->tx_ring_size);
+
 	/* ERR006538: Keep the transmitter going */
 	if (bdp != txq->cur_tx &&
 	    readl(fep->hwp + FEC_X_DES_ACTIVE(queue_id)) == 0)
@@ -1348,63 +1509,145 @@ fec_enet_tx_queue(struct net_device *ndev, u16 queue_id)
 }
 
 static void
-fec_enet_tx(struct net_device *ndev)
+fec_enet_tx(struct net_device *ndev, int budget)
 {
 	struct fec_enet_private *fep = netdev_priv(ndev);
 	u16 queue_id;
 	/* First process class A queue, then Class B and Best Effort queue */
 	for_each_set_bit(queue_id, &fep->work_tx, FEC_ENET_MAX_TX_QS) {
 		clear_bit(queue_id, &fep->work_tx);
-		fec_enet_tx_queue(ndev, queue_id);
+		fec_enet_tx_queue(ndev, queue_id, budget);
 	}
 	return;
 }
 
-static int
-fec_enet_new_rxbdp(struct net_device *ndev, struct bufdesc *bdp, struct sk_buff *skb)
+static int fec_enet_rx_buf_alloc(struct fec_enet_private *fep,
+				 struct fec_enet_rx_buffer *rx_buf, gfp_t gfp)
 {
-	struct  fec_enet_private *fep = netdev_priv(ndev);
-	int off;
+	struct page *page;
+	dma_addr_t dma;
 
-	off = ((unsigned long)skb->data) & fep->rx_align;
-	if (off)
-		skb_reserve(skb, fep->rx_align + 1 - off);
+	page = __dev_alloc_page(gfp);
+	if (unlikely(!page))
+		return -ENOMEM;
 
-	bdp->cbd_bufaddr = dma_map_single(&fep->pdev->dev, skb->data,
-					  FEC_ENET_RX_FRSIZE - fep->rx_align,
-					  DMA_FROM_DEVICE);
-	if (dma_mapping_error(&fep->pdev->dev, bdp->cbd_bufaddr)) {
+	dma = dma_map_single(&fep->pdev->dev, page_address(page), PAGE_SIZE,
+			     DMA_FROM_DEVICE);
+	if (dma_mapping_error(&fep->pdev->dev, dma)) {
 		if (net_ratelimit())
-			netdev_err(ndev, "Rx DMA memory map failed\n");
+			netdev_err(fep->netdev, "Rx DMA memory map failed\n");
+		__free_page(page);
 		return -ENOMEM;
 	}
 
+	rx_buf->page = page;
+	rx_buf->page_offset = 0;
+	rx_buf->dma = dma;
+
 	return 0;
 }
 
-static bool fec_enet_copybreak(struct net_device *ndev, struct sk_buff **skb,
-			       struct bufdesc *bdp, u32 length, bool swap)
+static void fec_enet_rx_buf_unmap(struct fec_enet_private *fep, dma_addr_t dma)
+{
+	DEFINE_DMA_ATTRS(attrs);
+
+	/* Other slices of the page may still be in use by the stack and
+	 * dirty in the cache, so don't let the unmap invalidate them.
+	 */
+	dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+	dma_unmap_single_attrs(&fep->pdev->dev, dma, PAGE_SIZE,
+			       DMA_FROM_DEVICE, &attrs);
+}
+
+static void fec_enet_rx_buf_free(struct fec_enet_private *fep,
+				 struct fec_enet_rx_buffer *rx_buf)
+{
+	if (!rx_buf->page)
+		return;
+
+	fec_enet_rx_buf_unmap(fep, rx_buf->dma);
+	put_page(rx_buf->page);
+	rx_buf->page = NULL;
+}
+
+/* Give the current slice of the buffer back to the controller. */
+static void fec_enet_rx_buf_arm(struct fec_enet_private *fep,
+				struct bufdesc *bdp,
+				struct fec_enet_rx_buffer *rx_buf)
+{
+	dma_sync_single_range_for_device(&fep->pdev->dev, rx_buf->dma,
+					 rx_buf->page_offset +
+					 FEC_ENET_RX_HEADROOM,
+					 PKT_MAXBLR_SIZE, DMA_FROM_DEVICE);
+	bdp->cbd_bufaddr = fec_enet_rx_buf_dma(rx_buf);
+}
+
+/* Wrap the received slice in an skb without copying it. The ring's page
+ * reference moves to the skb; the slot then either takes a new reference
+ * and flips to the next slice (nobody else holds the page) or is refilled
+ * with a fresh page. If no page can be had the frame is dropped and the
+ * old slice is re-armed, so the ring never runs empty.
+ */
+static struct sk_buff *fec_enet_rx_build_skb(struct fec_enet_private *fep,
+					     struct fec_enet_priv_rx_q *rxq,
+					     struct fec_enet_rx_buffer *rx_buf)
+{
+	struct page *page = rx_buf->page;
+	dma_addr_t old_dma = rx_buf->dma;
+	struct sk_buff *skb;
+
+	skb = build_skb(page_address(page) + rx_buf->page_offset,
+			FEC_ENET_RX_FRSIZE);
+	if (unlikely(!skb)) {
+		rxq->stats.alloc_failed++;
+		return NULL;
+	}
+	skb_reserve(skb, FEC_ENET_RX_HEADROOM);
+
+	if (likely(page_count(page) == 1 && !page_is_pfmemalloc(page))) {
+		get_page(page);
+		rx_buf->page_offset += FEC_ENET_RX_FRSIZE;
+		if (rx_buf->page_offset >= PAGE_SIZE)
+			rx_buf->page_offset = 0;
+		rxq->stats.page_reuse++;
+		return skb;
+	}
+
+	if (fec_enet_rx_buf_alloc(fep, rx_buf, GFP_ATOMIC)) {
+		rxq->stats.alloc_failed++;
+		get_page(page);
+		kfree_skb(skb);
+		return NULL;
+	}
+	fec_enet_rx_buf_unmap(fep, old_dma);
+	rxq->stats.page_alloc++;
+
+	return skb;
+}
+
+static struct sk_buff *fec_enet_copybreak(struct net_device *ndev,
+					  struct fec_enet_rx_buffer *rx_buf,
+					  u32 length, bool swap)
 {
 	struct  fec_enet_private *fep = netdev_priv(ndev);
 	struct sk_buff *new_skb;
+	void *data;
 
 	if (length > fep->rx_copybreak)
-		return false;
+		return NULL;
 
-	new_skb = netdev_alloc_skb(ndev, length);
+	new_skb = napi_alloc_skb(&fep->napi, length);
 	if (!new_skb)
-		return false;
+		return NULL;
 
-	dma_sync_single_for_cpu(&fep->pdev->dev, bdp->cbd_bufaddr,
-				FEC_ENET_RX_FRSIZE - fep->rx_align,
-				DMA_FROM_DEVICE);
+	data = page_address(rx_buf->page) + rx_buf->page_offset +
+	       FEC_ENET_RX_HEADROOM;
 	if (!swap)
-		memcpy(new_skb->data, (*skb)->data, length);
+		memcpy(new_skb->data, data, length);
 	else
-		swap_buffer2(new_skb->data, (*skb)->data, length);
-	*skb = new_skb;
+		swap_buffer2(new_skb->data, data, length);
 
-	return true;
+	return new_skb;
 }
 
 /* During a receive, the cur_rx points to the current incoming buffer.
@@ -1419,7 +1662,7 @@ fec_enet_rx_queue(struct net_device *ndev, int budget, u16 queue_id)
 	struct fec_enet_priv_rx_q *rxq;
 	struct bufdesc *bdp;
 	unsigned short status;
-	struct  sk_buff *skb_new = NULL;
+	struct fec_enet_rx_buffer *rx_buf;
 	struct  sk_buff *skb;
 	ushort	pkt_len;
 	__u8 *data;
@@ -1430,6 +1673,7 @@ fec_enet_rx_queue(struct net_device *ndev, int budget, u16 queue_id)
 	int	index = 0;
 	bool	is_copybreak;
 	bool	need_swap = fep->quirks & FEC_QUIRK_SWAP_FRAME;
+	u32	act;
 
 #ifdef CONFIG_M532x
 	flush_cache_all();
@@ -1437,6 +1681,9 @@ fec_enet_rx_queue(struct net_device *ndev, int budget, u16 queue_id)
 	queue_id = FEC_ENET_GET_QUQUE(queue_id);
 	rxq = fep->rx_queue[queue_id];
 
+	if (fec_capture_active(fep, queue_id))
+		return fec_capture_rx(fep, rxq, budget);
+
 	/* First, grab all of the stats for the incoming packet.
 	 * These get messed up if we get called due to a busy condition.
 	 */
@@ -1444,8 +1691,10 @@ fec_enet_rx_queue(struct net_device *ndev, int budget, u16 queue_id)
 
 	while (!((status = bdp->cbd_sc) & BD_ENET_RX_EMPTY)) {
 
-		if (pkt_received >= budget)
+		if (pkt_received >= budget) {
+			rxq->stats.budget_exhausted++;
 			break;
+		}
 		pkt_received++;
 
 		writel(FEC_ENET_RXF, fep->hwp + FEC_IEVENT);
@@ -1482,23 +1731,40 @@ fec_enet_rx_queue(struct net_device *ndev, int budget, u16 queue_id)
 		ndev->stats.rx_bytes += pkt_len;
 
 		index = fec_enet_get_bd_index(rxq->rx_bd_base, bdp, fep);
-		skb = rxq->rx_skbuff[index];
+		rx_buf = &rxq->rx_buf[index];
+		dma_sync_single_range_for_cpu(&fep->pdev->dev, rx_buf->dma,
+					      rx_buf->page_offset +
+					      FEC_ENET_RX_HEADROOM,
+					      pkt_len, DMA_FROM_DEVICE);
+
+		/* Swapped frames are only byte ordered once copied */
+		act = BPF_RX_PASS;
+		if (!need_swap)
+			act = fec_rx_bpf_run(fep, page_address(rx_buf->page) +
+					     rx_buf->page_offset +
+					     FEC_ENET_RX_HEADROOM,
+					     pkt_len - 4);
+		if (unlikely(act == BPF_RX_DROP)) {
+			rxq->stats.bpf_drop++;
+			fec_enet_rx_buf_arm(fep, bdp, rx_buf);
+			goto rx_processing_done;
+		}
 
 		/* The packet length includes FCS, but we don't want to
 		 * include that when passing upstream as it messes up
 		 * bridging applications.
 		 */
-		is_copybreak = fec_enet_copybreak(ndev, &skb, bdp, pkt_len - 4,
-						  need_swap);
-		if (!is_copybreak) {
-			skb_new = netdev_alloc_skb(ndev, FEC_ENET_RX_FRSIZE);
-			if (unlikely(!skb_new)) {
+		skb = fec_enet_copybreak(ndev, rx_buf, pkt_len - 4, need_swap);
+		is_copybreak = skb != NULL;
+		if (is_copybreak) {
+			rxq->stats.copybreak++;
+		} else {
+			skb = fec_enet_rx_build_skb(fep, rxq, rx_buf);
+			if (unlikely(!skb)) {
 				ndev->stats.rx_dropped++;
+				fec_enet_rx_buf_arm(fep, bdp, rx_buf);
 				goto rx_processing_done;
 			}
-			dma_unmap_single(&fep->pdev->dev, bdp->cbd_bufaddr,
-					 FEC_ENET_RX_FRSIZE - fep->rx_align,
-					 DMA_FROM_DEVICE);
 		}
 
 		prefetch(skb->data - NET_IP_ALIGN);
@@ -1507,6 +1773,14 @@ fec_enet_rx_queue(struct net_device *ndev, int budget, u16 queue_id)
 		if (!is_copybreak && need_swap)
 			swap_buffer(data, pkt_len);
 
+		/* Forwarded as received, VLAN tag and all */
+		if (unlikely(act == BPF_RX_REDIRECT)) {
+			rxq->stats.bpf_redirect++;
+			fec_rx_bpf_redirect(fep, skb);
+			fec_enet_rx_buf_arm(fep, bdp, rx_buf);
+			goto rx_processing_done;
+		}
+
 		/* Extract the enhanced buffer descriptor */
 		ebdp = NULL;
 		if (fep->bufdesc_ex)
@@ -1550,16 +1824,10 @@ fec_enet_rx_queue(struct net_device *ndev, int budget, u16 queue_id)
 					       htons(ETH_P_8021Q),
 					       vlan_tag);
 
+		skb_mark_napi_id(skb, &fep->napi);
 		napi_gro_receive(&fep->napi, skb);
 
-		if (is_copybreak) {
-			dma_sync_single_for_device(&fep->pdev->dev, bdp->cbd_bufaddr,
-						   FEC_ENET_RX_FRSIZE - fep->rx_align,
-						   DMA_FROM_DEVICE);
-		} else {
-			rxq->rx_skbuff[index] = skb_new;
-			fec_enet_new_rxbdp(ndev, bdp, skb_new);
-		}
+		fec_enet_rx_buf_arm(fep, bdp, rx_buf);
 
 rx_processing_done:
 		/* Clear the status flags for this buffer */
@@ -1587,6 +1855,7 @@ rx_processing_done:
 		writel(0, fep->hwp + FEC_R_DES_ACTIVE(queue_id));
 	}
 	rxq->cur_rx = bdp;
+	trace_fec_rx_queue(ndev, queue_id, pkt_received, budget);
 	return pkt_received;
 }
 
@@ -1611,19 +1880,20 @@ fec_enet_collect_events(struct fec_enet_private *fep, uint int_events)
 	if (int_events == 0)
 		return false;
 
+	/* atomic, fec_enet_busy_poll() sets work_rx bits concurrently */
 	if (int_events & FEC_ENET_RXF)
-		fep->work_rx |= (1 << 2);
+		set_bit(2, &fep->work_rx);
 	if (int_events & FEC_ENET_RXF_1)
-		fep->work_rx |= (1 << 0);
+		set_bit(0, &fep->work_rx);
 	if (int_events & FEC_ENET_RXF_2)
-		fep->work_rx |= (1 << 1);
+		set_bit(1, &fep->work_rx);
 
 	if (int_events & FEC_ENET_TXF)
-		fep->work_tx |= (1 << 2);
+		set_bit(2, &fep->work_tx);
 	if (int_events & FEC_ENET_TXF_1)
-		fep->work_tx |= (1 << 0);
+		set_bit(0, &fep->work_tx);
 	if (int_events & FEC_ENET_TXF_2)
-		fep->work_tx |= (1 << 1);
+		set_bit(1, &fep->work_tx);
 
 	return true;
 }
@@ -1646,6 +1916,8 @@ fec_enet_interrupt(int irq, void *dev_id)
 		if (napi_schedule_prep(&fep->napi)) {
 			/* Disable the NAPI interrupts */
 			writel(FEC_ENET_MII, fep->hwp + FEC_IMASK);
+			if (fep->priv_flags & FEC_PRIV_FLAG_LAT_HIST)
+				fep->irq_ts = ktime_get_ns();
 			__napi_schedule(&fep->napi);
 		}
 	}
@@ -1667,9 +1939,22 @@ static int fec_enet_rx_napi(struct napi_struct *napi, int budget)
 	struct fec_enet_private *fep = netdev_priv(ndev);
 	int pkts;
 
+	if (unlikely(fep->irq_ts)) {
+		if (fep->priv_flags & FEC_PRIV_FLAG_LAT_HIST)
+			fec_enet_lat_hist_add(fep->irq_napi_hist, fep->irq_ts);
+		fep->irq_ts = 0;
+	}
+
+	fep->napi_polls++;
 	pkts = fec_enet_rx(ndev, budget);
+	if (pkts >= budget)
+		fep->napi_budget_exhausted++;
+	trace_fec_napi_poll(ndev, pkts, budget);
+
+	fec_enet_tx(ndev, budget);
 
-	fec_enet_tx(ndev);
+	if (fep->use_adaptive_rx_coal || fep->use_adaptive_tx_coal)
+		fec_enet_itr_adapt(ndev, pkts, budget);
 
 	if (pkts < budget) {
 		napi_complete(napi);
@@ -1678,6 +1963,57 @@ static int fec_enet_rx_napi(struct napi_struct *napi, int budget)
 	return pkts;
 }
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+#define FEC_BUSY_POLL_BUDGET	4
+
+/* Mark every RX queue for reaping, the inverse of FEC_ENET_GET_QUQUE() */
+static void fec_enet_rx_work_all(struct fec_enet_private *fep)
+{
+	int queue;
+
+	for (queue = 0; queue < fep->num_rx_queues; queue++)
+		set_bit(queue == 0 ? 2 : queue - 1, &fep->work_rx);
+}
+
+/*
+ * Called by a socket reader spinning in sk_busy_loop() with BHs off.
+ * Owning NAPI_STATE_SCHED keeps the NAPI poll, and napi_disable(), out
+ * while we reap the RX rings, so no further locking is needed.  The
+ * interrupt stays unmasked throughout: events it collects while we
+ * hold the context are handed to NAPI once we let go.
+ */
+static int fec_enet_busy_poll(struct napi_struct *napi)
+{
+	struct net_device *ndev = napi->dev;
+	struct fec_enet_private *fep = netdev_priv(ndev);
+	int pkts;
+
+	if (test_and_set_bit(NAPI_STATE_SCHED, &napi->state))
+		return LL_FLUSH_BUSY;
+
+	fec_enet_rx_work_all(fep);
+	pkts = fec_enet_rx(ndev, FEC_BUSY_POLL_BUDGET);
+	napi_gro_flush(napi, false);
+	/* the budget ran out with frames left, hand them to NAPI below */
+	if (pkts >= FEC_BUSY_POLL_BUDGET)
+		fec_enet_rx_work_all(fep);
+
+	smp_mb__before_atomic();
+	clear_bit(NAPI_STATE_SCHED, &napi->state);
+	/*
+	 * An interrupt that found SCHED set has only recorded its work;
+	 * order the clear against reading that work back, or both sides
+	 * may miss each other and the frames wait for the next interrupt.
+	 */
+	smp_mb__after_atomic();
+
+	if (fep->work_tx || fep->work_rx)
+		napi_schedule(napi);
+
+	return pkts;
+}
+#endif
+
 /* ------------------------------------------------------------------------- */
 static void fec_get_mac(struct net_device *ndev)
 {
@@ -1819,6 +2155,7 @@ static int fec_enet_mdio_read(struct mii_bus *bus, int mii_id, int regnum)
 	unsigned long time_left;
 
 	fep->mii_timeout = 0;
+	fep->mdio_ops++;
 	init_completion(&fep->mdio_done);
 
 	/* start a read op */
@@ -1831,6 +2168,7 @@ static int fec_enet_mdio_read(struct mii_bus *bus, int mii_id, int regnum)
 			usecs_to_jiffies(FEC_MII_TIMEOUT));
 	if (time_left == 0) {
 		fep->mii_timeout = 1;
+		fep->mdio_timeouts++;
 		netdev_err(fep->netdev, "MDIO read timeout\n");
 		return -ETIMEDOUT;
 	}
@@ -1846,6 +2184,7 @@ static int fec_enet_mdio_write(struct mii_bus *bus, int mii_id, int regnum,
 	unsigned long time_left;
 
 	fep->mii_timeout = 0;
+	fep->mdio_ops++;
 	init_completion(&fep->mdio_done);
 
 	/* start a write op */
@@ -1859,6 +2198,7 @@ static int fec_enet_mdio_write(struct mii_bus *bus, int mii_id, int regnum,
 			usecs_to_jiffies(FEC_MII_TIMEOUT));
 	if (time_left == 0) {
 		fep->mii_timeout = 1;
+		fep->mdio_timeouts++;
 		netdev_err(fep->netdev, "MDIO write timeout\n");
 		return -ETIMEDOUT;
 	}
@@ -2046,6 +2386,12 @@ static int fec_enet_mii_init(struct platform_device *pdev)
 			fep->mii_bus = fec0_mii_bus;
 			*fec_mii_bus_share = FEC0_MII_BUS_SHARE_TRUE;
 			mii_cnt++;
+			/*
+			 * Our PHY is reached through fec0, keep both in the
+			 * synchronous dpm_list order: fec0 resumes first and
+			 * suspends last.
+			 */
+			device_disable_async_suspend(fec0_mii_bus->parent);
 			return 0;
 		}
 		return -ENOENT;
@@ -2414,38 +2760,197 @@ static const struct fec_stat {
 	{ "IEEE_rx_octets_ok", IEEE_R_OCTETS_OK },
 };
 
+/* Software counters, kept in struct fec_enet_private */
+static const struct fec_sw_stat {
+	char name[ETH_GSTRING_LEN];
+	size_t offset;
+} fec_sw_stats[] = {
+	{ "napi_polls", offsetof(struct fec_enet_private, napi_polls) },
+	{ "napi_budget_exhausted",
+	  offsetof(struct fec_enet_private, napi_budget_exhausted) },
+	{ "mdio_ops", offsetof(struct fec_enet_private, mdio_ops) },
+	{ "mdio_timeouts", offsetof(struct fec_enet_private, mdio_timeouts) },
+};
+
+static const char fec_rxq_stats[][ETH_GSTRING_LEN] = {
+	"desc_pending",
+	"copybreak",
+	"page_reuse",
+	"page_alloc",
+	"alloc_failed",
+	"budget_exhausted",
+	"bpf_drop",
+	"bpf_redirect",
+};
+
+static const char fec_txq_stats[][ETH_GSTRING_LEN] = {
+	"desc_inflight",
+	"queue_stopped",
+	"queue_woken",
+	"bounce",
+};
+
+static const char fec_lat_hists[][ETH_GSTRING_LEN] = {
+	"irq_to_napi",
+	"xmit_to_compl",
+};
+
+static const char fec_priv_flags[][ETH_GSTRING_LEN] = {
+	"latency-histogram",
+};
+
+static int fec_enet_stats_count(struct fec_enet_private *fep)
+{
+	return ARRAY_SIZE(fec_stats) + ARRAY_SIZE(fec_sw_stats) +
+	       fep->num_rx_queues * ARRAY_SIZE(fec_rxq_stats) +
+	       fep->num_tx_queues * ARRAY_SIZE(fec_txq_stats) +
+	       ARRAY_SIZE(fec_lat_hists) * FEC_LAT_HIST_BUCKETS;
+}
+
+/* Number of RX descriptors holding frames that NAPI has not consumed */
+static int fec_enet_get_pending_rxdesc_num(struct fec_enet_private *fep,
+					   struct fec_enet_priv_rx_q *rxq)
+{
+	struct bufdesc *bdp = rxq->rx_bd_base;
+	int i, pending = 0;
+
+	for (i = 0; i < rxq->rx_ring_size; i++) {
+		if (!(READ_ONCE(bdp->cbd_sc) & BD_ENET_RX_EMPTY))
+			pending++;
+		bdp = fec_enet_get_nextdesc(bdp, fep, rxq->index);
+	}
+
+	return pending;
+}
+
 static void fec_enet_get_ethtool_stats(struct net_device *dev,
 	struct ethtool_stats *stats, u64 *data)
 {
 	struct fec_enet_private *fep = netdev_priv(dev);
-	int i;
+	struct fec_enet_priv_rx_q *rxq;
+	struct fec_enet_priv_tx_q *txq;
+	int i, q;
 
 	for (i = 0; i < ARRAY_SIZE(fec_stats); i++)
-		data[i] = readl(fep->hwp + fec_stats[i].offset);
+		*data++ = readl(fep->hwp + fec_stats[i].offset);
+
+	for (i = 0; i < ARRAY_SIZE(fec_sw_stats); i++)
+		*data++ = *(unsigned long *)((char *)fep +
+					     fec_sw_stats[i].offset);
+
+	for (q = 0; q < fep->num_rx_queues; q++) {
+		rxq = fep->rx_queue[q];
+		*data++ = netif_running(dev) ?
+			  fec_enet_get_pending_rxdesc_num(fep, rxq) : 0;
+		*data++ = rxq->stats.copybreak;
+		*data++ = rxq->stats.page_reuse;
+		*data++ = rxq->stats.page_alloc;
+		*data++ = rxq->stats.alloc_failed;
+		*data++ = rxq->stats.budget_exhausted;
+		*data++ = rxq->stats.bpf_drop;
+		*data++ = rxq->stats.bpf_redirect;
+	}
+
+	for (q = 0; q < fep->num_tx_queues; q++) {
+		txq = fep->tx_queue[q];
+		*data++ = netif_running(dev) ?
+			  fec_enet_get_busy_txdesc_num(fep, txq) : 0;
+		*data++ = txq->stats.queue_stopped;
+		*data++ = txq->stats.queue_woken;
+		*data++ = txq->stats.tx_bounce;
+	}
+
+	for (i = 0; i < FEC_LAT_HIST_BUCKETS; i++)
+		*data++ = fep->irq_napi_hist[i];
+	for (i = 0; i < FEC_LAT_HIST_BUCKETS; i++)
+		*data++ = fep->xmit_compl_hist[i];
 }
 
 static void fec_enet_get_strings(struct net_device *netdev,
 	u32 stringset, u8 *data)
 {
-	int i;
+	struct fec_enet_private *fep = netdev_priv(netdev);
+	int i, q;
+
 	switch (stringset) {
 	case ETH_SS_STATS:
-		for (i = 0; i < ARRAY_SIZE(fec_stats); i++)
-			memcpy(data + i * ETH_GSTRING_LEN,
-				fec_stats[i].name, ETH_GSTRING_LEN);
+		for (i = 0; i < ARRAY_SIZE(fec_stats); i++) {
+			memcpy(data, fec_stats[i].name, ETH_GSTRING_LEN);
+			data += ETH_GSTRING_LEN;
+		}
+		for (i = 0; i < ARRAY_SIZE(fec_sw_stats); i++) {
+			memcpy(data, fec_sw_stats[i].name, ETH_GSTRING_LEN);
+			data += ETH_GSTRING_LEN;
+		}
+		for (q = 0; q < fep->num_rx_queues; q++) {
+			for (i = 0; i < ARRAY_SIZE(fec_rxq_stats); i++) {
+				snprintf(data, ETH_GSTRING_LEN, "rx%d_%s",
+					 q, fec_rxq_stats[i]);
+				data += ETH_GSTRING_LEN;
+			}
+		}
+		for (q = 0; q < fep->num_tx_queues; q++) {
+			for (i = 0; i < ARRAY_SIZE(fec_txq_stats); i++) {
+				snprintf(data, ETH_GSTRING_LEN, "tx%d_%s",
+					 q, fec_txq_stats[i]);
+				data += ETH_GSTRING_LEN;
+			}
+		}
+		for (q = 0; q < ARRAY_SIZE(fec_lat_hists); q++) {
+			for (i = 0; i < FEC_LAT_HIST_BUCKETS - 1; i++) {
+				snprintf(data, ETH_GSTRING_LEN, "%s_lt_%uus",
+					 fec_lat_hists[q], 1U << i);
+				data += ETH_GSTRING_LEN;
+			}
+			snprintf(data, ETH_GSTRING_LEN, "%s_ge_%uus",
+				 fec_lat_hists[q], 1U << (i - 1));
+			data += ETH_GSTRING_LEN;
+		}
+		break;
+	case ETH_SS_PRIV_FLAGS:
+		memcpy(data, fec_priv_flags, sizeof(fec_priv_flags));
 		break;
 	}
 }
 
 static int fec_enet_get_sset_count(struct net_device *dev, int sset)
 {
+	struct fec_enet_private *fep = netdev_priv(dev);
+
 	switch (sset) {
 	case ETH_SS_STATS:
-		return ARRAY_SIZE(fec_stats);
+		return fec_enet_stats_count(fep);
+	case ETH_SS_PRIV_FLAGS:
+		return ARRAY_SIZE(fec_priv_flags);
 	default:
 		return -EOPNOTSUPP;
 	}
 }
+
+static u32 fec_enet_get_priv_flags(struct net_device *dev)
+{
+	struct fec_enet_private *fep = netdev_priv(dev);
+
+	return fep->priv_flags;
+}
+
+static int fec_enet_set_priv_flags(struct net_device *dev, u32 flags)
+{
+	struct fec_enet_private *fep = netdev_priv(dev);
+
+	if (flags & ~FEC_PRIV_FLAG_LAT_HIST)
+		return -EINVAL;
+
+	/* Start a fresh set of samples whenever the histograms are enabled */
+	if ((flags & FEC_PRIV_FLAG_LAT_HIST) &&
+	    !(fep->priv_flags & FEC_PRIV_FLAG_LAT_HIST)) {
+		memset(fep->irq_napi_hist, 0, sizeof(fep->irq_napi_hist));
+		memset(fep->xmit_compl_hist, 0, sizeof(fep->xmit_compl_hist));
+	}
+	fep->priv_flags = flags;
+
+	return 0;
+}
 #endif /* !defined(CONFIG_M5272) */
 
 static int fec_enet_nway_reset(struct net_device *dev)
@@ -2470,13 +2975,33 @@ static int fec_enet_us_to_itr_clock(struct net_device *ndev, int us)
 	return us * (fep->itr_clk_rate / 64000) / 1000;
 }
 
+/* Coalescing register value for one direction at the given level */
+static u32 fec_enet_itr_val(struct net_device *ndev, unsigned int level,
+			    unsigned int pkts, unsigned int us)
+{
+	if (level == FEC_ITR_LEVEL_LOW)
+		return 0;
+
+	if (level == FEC_ITR_LEVEL_MID) {
+		pkts = min_t(unsigned int, pkts, FEC_ITR_ADAPT_MID_FRAMES);
+		us = min_t(unsigned int, us, FEC_ITR_ADAPT_MID_USECS);
+	}
+
+	/* Select enet system clock as Interrupt Coalescing
+	 * timer Clock Source
+	 */
+	return FEC_ITR_CLK_SEL | FEC_ITR_EN | FEC_ITR_ICFT(pkts) |
+	       FEC_ITR_ICTT(fec_enet_us_to_itr_clock(ndev, us));
+}
+
 /* Set threshold for interrupt coalescing */
 static void fec_enet_itr_coal_set(struct net_device *ndev)
 {
 	struct fec_enet_private *fep = netdev_priv(ndev);
+	unsigned int rx_level, tx_level;
 	int rx_itr, tx_itr;
 
-	if (!(fep->quirks & FEC_QUIRK_HAS_AVB))
+	if (!(fep->quirks & FEC_QUIRK_HAS_COALESCE))
 		return;
 
 	/* Must be greater than zero to avoid unpredictable behavior */
@@ -2484,27 +3009,77 @@ static void fec_enet_itr_coal_set(struct net_device *ndev)
 	    !fep->tx_time_itr || !fep->tx_pkts_itr)
 		return;
 
-	/* Select enet system clock as Interrupt Coalescing
-	 * timer Clock Source
-	 */
-	rx_itr = FEC_ITR_CLK_SEL;
-	tx_itr = FEC_ITR_CLK_SEL;
+	rx_level = fep->use_adaptive_rx_coal ? fep->rx_itr_level :
+					       FEC_ITR_LEVEL_HIGH;
+	tx_level = fep->use_adaptive_tx_coal ? fep->tx_itr_level :
+					       FEC_ITR_LEVEL_HIGH;
 
 	/* set ICFT and ICTT */
-	rx_itr |= FEC_ITR_ICFT(fep->rx_pkts_itr);
-	rx_itr |= FEC_ITR_ICTT(fec_enet_us_to_itr_clock(ndev, fep->rx_time_itr));
-	tx_itr |= FEC_ITR_ICFT(fep->tx_pkts_itr);
-	tx_itr |= FEC_ITR_ICTT(fec_enet_us_to_itr_clock(ndev, fep->tx_time_itr));
-
-	rx_itr |= FEC_ITR_EN;
-	tx_itr |= FEC_ITR_EN;
+	rx_itr = fec_enet_itr_val(ndev, rx_level, fep->rx_pkts_itr,
+				  fep->rx_time_itr);
+	tx_itr = fec_enet_itr_val(ndev, tx_level, fep->tx_pkts_itr,
+				  fep->tx_time_itr);
 
 	writel(tx_itr, fep->hwp + FEC_TXIC0);
 	writel(rx_itr, fep->hwp + FEC_RXIC0);
-	writel(tx_itr, fep->hwp + FEC_TXIC1);
-	writel(rx_itr, fep->hwp + FEC_RXIC1);
-	writel(tx_itr, fep->hwp + FEC_TXIC2);
-	writel(rx_itr, fep->hwp + FEC_RXIC2);
+	if (fep->quirks & FEC_QUIRK_HAS_AVB) {
+		writel(tx_itr, fep->hwp + FEC_TXIC1);
+		writel(rx_itr, fep->hwp + FEC_RXIC1);
+		writel(tx_itr, fep->hwp + FEC_TXIC2);
+		writel(rx_itr, fep->hwp + FEC_RXIC2);
+	}
+}
+
+static unsigned int fec_enet_itr_level(unsigned int frames,
+				       unsigned long elapsed, bool busy)
+{
+	unsigned long pps;
+
+	/* NAPI ran out of budget: we are already behind, batch harder */
+	if (busy)
+		return FEC_ITR_LEVEL_HIGH;
+
+	pps = (unsigned long)frames * HZ / elapsed;
+	if (pps < FEC_ITR_ADAPT_LOW_PPS)
+		return FEC_ITR_LEVEL_LOW;
+	if (pps < FEC_ITR_ADAPT_HIGH_PPS)
+		return FEC_ITR_LEVEL_MID;
+	return FEC_ITR_LEVEL_HIGH;
+}
+
+/* Called from NAPI poll with the number of frames just received. Once per
+ * FEC_ITR_ADAPT_INTERVAL the accumulated rates pick new coalescing levels,
+ * and the registers are only touched when a level actually changes.
+ */
+static void fec_enet_itr_adapt(struct net_device *ndev, int pkts, int budget)
+{
+	struct fec_enet_private *fep = netdev_priv(ndev);
+	unsigned int rx_level, tx_level;
+	unsigned long elapsed;
+
+	fep->itr_rx_frames += pkts;
+	if (pkts >= budget)
+		fep->itr_busy = true;
+
+	elapsed = jiffies - fep->itr_last_update;
+	if (elapsed < FEC_ITR_ADAPT_INTERVAL)
+		return;
+
+	rx_level = fec_enet_itr_level(fep->itr_rx_frames, elapsed,
+				      fep->itr_busy);
+	tx_level = fec_enet_itr_level(fep->itr_tx_frames, elapsed, false);
+
+	fep->itr_rx_frames = 0;
+	fep->itr_tx_frames = 0;
+	fep->itr_busy = false;
+	fep->itr_last_update = jiffies;
+
+	if (rx_level == fep->rx_itr_level && tx_level == fep->tx_itr_level)
+		return;
+
+	fep->rx_itr_level = rx_level;
+	fep->tx_itr_level = tx_level;
+	fec_enet_itr_coal_set(ndev);
 }
 
 static int
@@ -2512,7 +3087,7 @@ fec_enet_get_coalesce(struct net_device *ndev, struct ethtool_coalesce *ec)
 {
 	struct fec_enet_private *fep = netdev_priv(ndev);
 
-	if (!(fep->quirks & FEC_QUIRK_HAS_AVB))
+	if (!(fep->quirks & FEC_QUIRK_HAS_COALESCE))
 		return -EOPNOTSUPP;
 
 	ec->rx_coalesce_usecs = fep->rx_time_itr;
@@ -2521,6 +3096,9 @@ fec_enet_get_coalesce(struct net_device *ndev, struct ethtool_coalesce *ec)
 	ec->tx_coalesce_usecs = fep->tx_time_itr;
 	ec->tx_max_coalesced_frames = fep->tx_pkts_itr;
 
+	ec->use_adaptive_rx_coalesce = fep->use_adaptive_rx_coal;
+	ec->use_adaptive_tx_coalesce = fep->use_adaptive_tx_coal;
+
 	return 0;
 }
 
@@ -2530,7 +3108,7 @@ fec_enet_set_coalesce(struct net_device *ndev, struct ethtool_coalesce *ec)
 	struct fec_enet_private *fep = netdev_priv(ndev);
 	unsigned int cycle;
 
-	if (!(fep->quirks & FEC_QUIRK_HAS_AVB))
+	if (!(fep->quirks & FEC_QUIRK_HAS_COALESCE))
 		return -EOPNOTSUPP;
 
 	if (ec->rx_max_coalesced_frames > 255) {
@@ -2543,15 +3121,15 @@ fec_enet_set_coalesce(struct net_device *ndev, struct ethtool_coalesce *ec)
 		return -EINVAL;
 	}
 
-	cycle = fec_enet_us_to_itr_clock(ndev, fep->rx_time_itr);
+	cycle = fec_enet_us_to_itr_clock(ndev, ec->rx_coalesce_usecs);
 	if (cycle > 0xFFFF) {
 		pr_err("Rx coalesed usec exceeed hardware limiation");
 		return -EINVAL;
 	}
 
-	cycle = fec_enet_us_to_itr_clock(ndev, fep->tx_time_itr);
+	cycle = fec_enet_us_to_itr_clock(ndev, ec->tx_coalesce_usecs);
 	if (cycle > 0xFFFF) {
-		pr_err("Rx coalesed usec exceeed hardware limiation");
+		pr_err("Tx coalesed usec exceeed hardware limiation");
 		return -EINVAL;
 	}
 
@@ -2561,6 +3139,18 @@ fec_enet_set_coalesce(struct net_device *ndev, struct ethtool_coalesce *ec)
 	fep->tx_time_itr = ec->tx_coalesce_usecs;
 	fep->tx_pkts_itr = ec->tx_max_coalesced_frames;
 
+	/* Start an adaptive direction out at lowest latency, NAPI will
+	 * raise the level as soon as traffic picks up.
+	 */
+	fep->use_adaptive_rx_coal = !!ec->use_adaptive_rx_coalesce;
+	fep->use_adaptive_tx_coal = !!ec->use_adaptive_tx_coalesce;
+	fep->rx_itr_level = FEC_ITR_LEVEL_LOW;
+	fep->tx_itr_level = FEC_ITR_LEVEL_LOW;
+	fep->itr_rx_frames = 0;
+	fep->itr_tx_frames = 0;
+	fep->itr_busy = false;
+	fep->itr_last_update = jiffies;
+
 	fec_enet_itr_coal_set(ndev);
 
 	return 0;
@@ -2568,7 +3158,7 @@ fec_enet_set_coalesce(struct net_device *ndev, struct ethtool_coalesce *ec)
 
 static void fec_enet_itr_coal_init(struct net_device *ndev)
 {
-	struct ethtool_coalesce ec;
+	struct ethtool_coalesce ec = { 0 };
 
 	ec.rx_coalesce_usecs = FEC_ITR_ICTT_DEFAULT;
 	ec.rx_max_coalesced_frames = FEC_ITR_ICFT_DEFAULT;
@@ -2666,6 +3256,8 @@ static const struct ethtool_ops fec_enet_ethtool_ops = {
 	.get_strings		= fec_enet_get_strings,
 	.get_ethtool_stats	= fec_enet_get_ethtool_stats,
 	.get_sset_count		= fec_enet_get_sset_count,
+	.get_priv_flags		= fec_enet_get_priv_flags,
+	.set_priv_flags		= fec_enet_set_priv_flags,
 #endif
 	.get_ts_info		= fec_enet_get_ts_info,
 	.get_tunable		= fec_enet_get_tunable,
@@ -2709,15 +3301,8 @@ static void fec_enet_free_buffers(struct net_device *ndev)
 		rxq = fep->rx_queue[q];
 		bdp = rxq->rx_bd_base;
 		for (i = 0; i < rxq->rx_ring_size; i++) {
-			skb = rxq->rx_skbuff[i];
-			rxq->rx_skbuff[i] = NULL;
-			if (skb) {
-				dma_unmap_single(&fep->pdev->dev,
-						 bdp->cbd_bufaddr,
-						 FEC_ENET_RX_FRSIZE - fep->rx_align,
-						 DMA_FROM_DEVICE);
-				dev_kfree_skb(skb);
-			}
+			fec_enet_rx_buf_free(fep, &rxq->rx_buf[i]);
+			bdp->cbd_bufaddr = 0;
 			bdp = fec_enet_get_nextdesc(bdp, fep, q);
 		}
 	}
@@ -2811,23 +3396,23 @@ fec_enet_alloc_rxq_buffers(struct net_device *ndev, unsigned int queue)
 {
 	struct fec_enet_private *fep = netdev_priv(ndev);
 	unsigned int i;
-	struct sk_buff *skb;
 	struct bufdesc	*bdp;
 	struct fec_enet_priv_rx_q *rxq;
 
+	/* build_skb() needs the headroom, the largest frame the controller
+	 * may write and the shared info to fit in one slice.
+	 */
+	BUILD_BUG_ON(FEC_ENET_RX_HEADROOM + PKT_MAXBLR_SIZE +
+		     SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) >
+		     FEC_ENET_RX_FRSIZE);
+
 	rxq = fep->rx_queue[queue];
 	bdp = rxq->rx_bd_base;
 	for (i = 0; i < rxq->rx_ring_size; i++) {
-		skb = netdev_alloc_skb(ndev, FEC_ENET_RX_FRSIZE);
-		if (!skb)
-			goto err_alloc;
-
-		if (fec_enet_new_rxbdp(ndev, bdp, skb)) {
-			dev_kfree_skb(skb);
+		if (fec_enet_rx_buf_alloc(fep, &rxq->rx_buf[i], GFP_KERNEL))
 			goto err_alloc;
-		}
 
-		rxq->rx_skbuff[i] = skb;
+		bdp->cbd_bufaddr = fec_enet_rx_buf_dma(&rxq->rx_buf[i]);
 		bdp->cbd_sc = BD_ENET_RX_EMPTY;
 
 		if (fep->bufdesc_ex) {
@@ -3192,6 +3777,10 @@ u16 fec_enet_select_queue(struct net_device *ndev, struct sk_buff *skb,
 	if (!(id_entry->driver_data & FEC_QUIRK_HAS_AVB))
 		return skb_tx_hash(ndev, skb);
 
+	/* mqprio owns the mapping, one ring per traffic class */
+	if (netdev_get_num_tc(ndev))
+		return netdev_get_prio_tc_map(ndev, skb->priority);
+
 	vlan_tag = fec_enet_get_raw_vlan_tci(skb);
 	if (!vlan_tag)
 		return vlan_tag;
@@ -3199,6 +3788,63 @@ u16 fec_enet_select_queue(struct net_device *ndev, struct sk_buff *skb,
 	return  fec_enet_vlan_pri_to_queue[vlan_tag >> 13];
 }
 
+/* mqprio hardware offload: traffic class N is transmitted from ring N */
+static int fec_enet_setup_tc(struct net_device *ndev, u8 num_tc)
+{
+	struct fec_enet_private *fep = netdev_priv(ndev);
+	int i;
+
+	if (!(fep->quirks & FEC_QUIRK_HAS_AVB))
+		return -EOPNOTSUPP;
+
+	if (!num_tc) {
+		netdev_reset_tc(ndev);
+		return 0;
+	}
+	if (num_tc != fep->num_tx_queues)
+		return -EINVAL;
+
+	netdev_set_num_tc(ndev, num_tc);
+	for (i = 0; i < num_tc; i++)
+		netdev_set_tc_queue(ndev, i, 1, i);
+
+	return 0;
+}
+
+/* Program the credit-based shaper of AVB ring queue, rate in Mbps */
+static int fec_enet_set_tx_maxrate(struct net_device *ndev, int queue,
+				   u32 rate)
+{
+	struct fec_enet_private *fep = netdev_priv(ndev);
+
+	/* ring 0 is the best effort class and has no shaper */
+	if (!(fep->quirks & FEC_QUIRK_HAS_AVB) || !queue)
+		return -EOPNOTSUPP;
+	if (rate >= SPEED_1000)
+		return -EINVAL;
+
+	if (netif_running(ndev) && fep->link)
+		writel(DMA_CLASS_EN | fec_enet_idle_slope(fep, queue, rate),
+		       fep->hwp + FEC_DMA_CFG(queue));
+
+	return 0;
+}
+
+static netdev_features_t fec_enet_features_check(struct sk_buff *skb,
+						 struct net_device *dev,
+						 netdev_features_t features)
+{
+	/* Software TSO builds every segment header in a TSO_HEADER_SIZE
+	 * slot; leave IPv4 options or IPv6 extension headers that don't
+	 * fit to the stack's GSO.
+	 */
+	if (skb_is_gso(skb) &&
+	    skb_transport_offset(skb) + tcp_hdrlen(skb) > TSO_HEADER_SIZE)
+		features &= ~NETIF_F_GSO_MASK;
+
+	return vlan_features_check(skb, features);
+}
+
 static const struct net_device_ops fec_netdev_ops = {
 	.ndo_open		= fec_enet_open,
 	.ndo_stop		= fec_enet_close,
@@ -3212,8 +3858,14 @@ static const struct net_device_ops fec_netdev_ops = {
 	.ndo_do_ioctl		= fec_enet_ioctl,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller	= fec_poll_controller,
+#endif
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	.ndo_busy_poll		= fec_enet_busy_poll,
 #endif
 	.ndo_set_features	= fec_set_features,
+	.ndo_features_check	= fec_enet_features_check,
+	.ndo_setup_tc		= fec_enet_setup_tc,
+	.ndo_set_tx_maxrate	= fec_enet_set_tx_maxrate,
 };
 
  /*
@@ -3247,14 +3899,21 @@ static int fec_enet_init(struct net_device *ndev)
 	bd_size = (fep->total_tx_ring_size + fep->total_rx_ring_size) *
 			fep->bufdesc_size;
 
-	/* Allocate memory for buffer descriptors. */
-	cbd_base = dma_alloc_coherent(NULL, bd_size, &bd_dma,
-				      GFP_KERNEL);
+	/*
+	 * Allocate memory for buffer descriptors, in OCRAM if the node has
+	 * an "iram" phandle: the descriptors are polled by the MAC for
+	 * every frame, and keeping them out of DDR helps DDR self-refresh.
+	 */
+	cbd_base = iram_dma_alloc_coherent(&fep->pdev->dev, bd_size, &bd_dma,
+					   GFP_KERNEL);
 	if (!cbd_base) {
 		return -ENOMEM;
 	}
 
 	memset(cbd_base, 0, bd_size);
+	fep->bd_base = cbd_base;
+	fep->bd_dma = bd_dma;
+	fep->bd_size = bd_size;
 
 	/* Get the Ethernet address */
 	fec_get_mac(ndev);
@@ -3310,7 +3969,8 @@ static int fec_enet_init(struct net_device *ndev)
 
 		/* enable hw accelerator */
 		ndev->features |= (NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM
-				| NETIF_F_RXCSUM | NETIF_F_SG | NETIF_F_TSO);
+				| NETIF_F_RXCSUM | NETIF_F_SG | NETIF_F_TSO
+				| NETIF_F_TSO6);
 		fep->csum_flags |= FLAG_RX_CSUM_ENABLED;
 	}
 
@@ -3321,6 +3981,9 @@ static int fec_enet_init(struct net_device *ndev)
 
 	ndev->hw_features = ndev->features;
 
+	/* Init the interrupt coalescing */
+	fec_enet_itr_coal_init(ndev);
+
 	fec_restart(ndev);
 
 	return 0;
@@ -3351,7 +4014,11 @@ static void fec_reset_phy(struct platform_device *pdev)
 		dev_err(&pdev->dev, "failed to get phy-reset-gpios: %d\n", err);
 		return;
 	}
-	msleep(msec);
+	/* msleep() of a few ms can take several jiffies, don't stall boot */
+	if (msec > 20)
+		msleep(msec);
+	else
+		usleep_range(msec * 1000, msec * 1000 + 1000);
 	gpio_set_value(phy_reset, 1);
 }
 #else /* CONFIG_OF */
@@ -3615,21 +4282,30 @@ fec_probe(struct platform_device *pdev)
 	ret = register_netdev(ndev);
 	if (ret)
 		goto failed_register;
+	napi_hash_add(&fep->napi);
 
 	device_init_wakeup(&ndev->dev, fep->wol_flag &
 			   FEC_WOL_HAS_MAGIC_PACKET);
 
+	/* PHY resume may take long, let it overlap with other devices */
+	if (fep->mii_bus->parent == &pdev->dev)
+		device_enable_async_suspend(&pdev->dev);
+
 	if (fep->bufdesc_ex && fep->ptp_clock)
 		netdev_info(ndev, "registered PHC device %d\n", fep->dev_id);
 
 	fep->rx_copybreak = COPYBREAK_DEFAULT;
 	INIT_WORK(&fep->tx_timeout_work, fec_enet_timeout_work);
+	fec_capture_init(fep);
+	fec_rx_bpf_init(fep);
 	return 0;
 
 failed_register:
 	fec_enet_mii_remove(fep);
 failed_mii_init:
 failed_irq:
+	iram_dma_free_coherent(&pdev->dev, fep->bd_size, fep->bd_base,
+			       fep->bd_dma);
 failed_init:
 	if (fep->reg_phy)
 		regulator_disable(fep->reg_phy);
@@ -3652,8 +4328,13 @@ fec_drv_remove(struct platform_device *pdev)
 
 	cancel_delayed_work_sync(&fep->time_keep);
 	cancel_work_sync(&fep->tx_timeout_work);
+	fec_capture_remove(fep);
+	fec_rx_bpf_remove(fep);
+	napi_hash_del(&fep->napi);
 	unregister_netdev(ndev);
 	fec_enet_mii_remove(fep);
+	iram_dma_free_coherent(&pdev->dev, fep->bd_size, fep->bd_base,
+			       fep->bd_dma);
 	if (fep->reg_phy)
 		regulator_disable(fep->reg_phy);
 	if (fep->ptp_clock)
@@ -3664,6 +4345,25 @@ fec_drv_remove(struct platform_device *pdev)
 	return 0;
 }
 
+/* Leave no DMA running into the memory of a kexec'd kernel */
+static void fec_shutdown(struct platform_device *pdev)
+{
+	struct net_device *ndev = platform_get_drvdata(pdev);
+	struct fec_enet_private *fep = netdev_priv(ndev);
+
+	rtnl_lock();
+	if (netif_running(ndev)) {
+		phy_stop(fep->phy_dev);
+		napi_disable(&fep->napi);
+		netif_tx_lock_bh(ndev);
+		netif_device_detach(ndev);
+		netif_tx_unlock_bh(ndev);
+		fec_stop(ndev);
+		fec_irqs_disable(ndev);
+	}
+	rtnl_unlock();
+}
+
 static int __maybe_unused fec_suspend(struct device *dev)
 {
 	struct net_device *ndev = dev_get_drvdata(dev);
@@ -3781,10 +4481,16 @@ static struct platform_driver fec_driver = {
 		.name	= DRIVER_NAME,
 		.pm	= &fec_pm_ops,
 		.of_match_table = fec_dt_ids,
+		/*
+		 * PHY reset and probe take long. One async attach walks all
+		 * fec devices in order, so fec1 still finds fec0's MDIO bus.
+		 */
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.id_table = fec_devtype,
 	.probe	= fec_probe,
 	.remove	= fec_drv_remove,
+	.shutdown = fec_shutdown,
 };
 
 module_platform_driver(fec_driver);
@@ -93,6 +93,9 @@
 #define MAX_TIMER_CHANNEL	3
 #define FEC_TMODE_TOGGLE	0x05
 #define FEC_HIGH_PULSE		0x0F
+#define FEC_TMODE_CAPTURE_RISE	0x01
+#define FEC_TMODE_CAPTURE_FALL	0x02
+#define FEC_TMODE_CAPTURE_BOTH	0x03
 
 #define FEC_CC_MULT	(1 << 31)
 #define FEC_COUNTER_PERIOD	(1 << 31)
@@ -100,6 +103,14 @@
 #define FEC_CHANNLE_0		0
 #define DEFAULT_PPS_CHANNEL	FEC_CHANNLE_0
 
+/* Every periodic output event costs an interrupt to load the next
+ * compare value, and the 31-bit counter wraps after about two seconds.
+ */
+#define FEC_PEROUT_MIN_PERIOD	NSEC_PER_MSEC
+#define FEC_PEROUT_MAX_PERIOD	NSEC_PER_SEC
+/* how far ahead of the counter the first compare value is placed */
+#define FEC_PEROUT_MARGIN	(10 * NSEC_PER_MSEC)
+
 /**
  * fec_ptp_enable_pps
  * @fep: the fec_enet_private structure handle
@@ -125,6 +136,9 @@ static int fec_ptp_enable_pps(struct fec_enet_private *fep, uint enable)
 	if (fep->pps_enable == enable)
 		return 0;
 
+	if (fep->ptp_chan[DEFAULT_PPS_CHANNEL].func != PTP_PF_NONE)
+		return -EBUSY;
+
 	fep->pps_channel = DEFAULT_PPS_CHANNEL;
 	fep->reload_period = PPS_OUPUT_RELOAD_PERIOD;
 	inc = fep->ptp_inc;
@@ -156,9 +170,8 @@ static int fec_ptp_enable_pps(struct fec_enet_private *fep, uint enable)
 		 * NSEC_PER_SEC - ts.tv_nsec. Add the remaining nanoseconds
 		 * to current timer would be next second.
 		 */
-		tempval = readl(fep->hwp + FEC_ATIME_CTRL);
-		tempval |= FEC_T_CTRL_CAPTURE;
-		writel(tempval, fep->hwp + FEC_ATIME_CTRL);
+		writel(fep->ptp_ctrl | FEC_T_CTRL_CAPTURE,
+		       fep->hwp + FEC_ATIME_CTRL);
 
 		tempval = readl(fep->hwp + FEC_ATIME);
 		/* Convert the ptp local counter to 1588 timestamp */
@@ -197,9 +210,8 @@ static int fec_ptp_enable_pps(struct fec_enet_private *fep, uint enable)
 		fep->next_counter = (val + fep->reload_period) & fep->cc.mask;
 
 		/* * Enable compare event when overflow */
-		val = readl(fep->hwp + FEC_ATIME_CTRL);
-		val |= FEC_T_CTRL_PINPER;
-		writel(val, fep->hwp + FEC_ATIME_CTRL);
+		fep->ptp_ctrl |= FEC_T_CTRL_PINPER;
+		writel(fep->ptp_ctrl, fep->hwp + FEC_ATIME_CTRL);
 
 		/* Compare channel setting. */
 		val = readl(fep->hwp + FEC_TCSR(fep->pps_channel));
@@ -238,11 +250,11 @@ static cycle_t fec_ptp_read(const struct cyclecounter *cc)
 		container_of(cc, struct fec_enet_private, cc);
 	const struct platform_device_id *id_entry =
 		platform_get_device_id(fep->pdev);
-	u32 tempval;
 
-	tempval = readl(fep->hwp + FEC_ATIME_CTRL);
-	tempval |= FEC_T_CTRL_CAPTURE;
-	writel(tempval, fep->hwp + FEC_ATIME_CTRL);
+	/* the control register is shadowed, so a read costs one register
+	 * write and one register read
+	 */
+	writel(fep->ptp_ctrl | FEC_T_CTRL_CAPTURE, fep->hwp + FEC_ATIME_CTRL);
 
 	if (id_entry->driver_data & FEC_QUIRK_BUG_CAPTURE)
 		udelay(1);
@@ -275,8 +287,8 @@ void fec_ptp_start_cyclecounter(struct net_device *ndev)
 	/* use 31-bit timer counter */
 	writel(FEC_COUNTER_PERIOD, fep->hwp + FEC_ATIME_EVT_PERIOD);
 
-	writel(FEC_T_CTRL_ENABLE | FEC_T_CTRL_PERIOD_RST,
-		fep->hwp + FEC_ATIME_CTRL);
+	fep->ptp_ctrl = FEC_T_CTRL_ENABLE | FEC_T_CTRL_PERIOD_RST;
+	writel(fep->ptp_ctrl, fep->hwp + FEC_ATIME_CTRL);
 
 	memset(&fep->cc, 0, sizeof(fep->cc));
 	fep->cc.read = fec_ptp_read;
@@ -446,6 +458,172 @@ static int fec_ptp_settime(struct ptp_clock_info *ptp,
 	return 0;
 }
 
+/* Stop a timer channel and wait for the mode to read back as cleared */
+static void fec_ptp_channel_stop(struct fec_enet_private *fep, int chan)
+{
+	u32 val;
+
+	writel(FEC_T_TF_MASK, fep->hwp + FEC_TCSR(chan));
+	val = readl(fep->hwp + FEC_TCSR(chan));
+	while (val & FEC_T_TMODE_MASK) {
+		val &= ~FEC_T_TMODE_MASK;
+		writel(val, fep->hwp + FEC_TCSR(chan));
+		val = readl(fep->hwp + FEC_TCSR(chan));
+	}
+}
+
+/* Find the timer channel a request index currently runs on */
+static int fec_ptp_channel_find(struct fec_enet_private *fep,
+				enum ptp_pin_function func, unsigned int index)
+{
+	int i;
+
+	for (i = 0; i < FEC_PTP_CHANNELS; i++)
+		if (fep->ptp_chan[i].func == func &&
+		    fep->ptp_chan[i].index == index)
+			return i;
+	return -1;
+}
+
+/*
+ * Arm compare channel chan to pulse every period ns, in phase with the
+ * PHC time start.  The first event is moved by whole periods to land
+ * between FEC_PEROUT_MARGIN and FEC_PEROUT_MARGIN + period from now, as
+ * the compare registers only reach one counter wrap ahead.  Called with
+ * tmreg_lock held.
+ */
+static void fec_ptp_perout_start(struct fec_enet_private *fep, int chan,
+				 u64 start, u32 period)
+{
+	struct fec_ptp_channel *ch = &fep->ptp_chan[chan];
+	u32 now_cyc, first, val;
+	s64 delta;
+	u64 now;
+
+	fec_ptp_channel_stop(fep, chan);
+
+	now_cyc = fep->cc.read(&fep->cc);
+	now = timecounter_cyc2time(&fep->tc, now_cyc);
+
+	delta = start - now;
+	if (delta <= FEC_PEROUT_MARGIN)
+		delta += (div_u64(FEC_PEROUT_MARGIN - delta, period) + 1) *
+			 period;
+	else
+		delta -= div_u64(delta - FEC_PEROUT_MARGIN - 1, period) *
+			 period;
+
+	first = (now_cyc + (u32)delta) & fep->cc.mask;
+	writel(first, fep->hwp + FEC_TCCR(chan));
+
+	fep->ptp_ctrl |= FEC_T_CTRL_PINPER;
+	writel(fep->ptp_ctrl, fep->hwp + FEC_ATIME_CTRL);
+
+	val = FEC_T_TF_MASK | FEC_T_TIE_MASK |
+	      (FEC_HIGH_PULSE << FEC_T_TMODE_OFFSET);
+	writel(val, fep->hwp + FEC_TCSR(chan));
+
+	/* the second compare value is buffered, as for the PPS output */
+	ch->period = period;
+	ch->next = (first + period) & fep->cc.mask;
+	writel(ch->next, fep->hwp + FEC_TCCR(chan));
+	ch->next = (ch->next + period) & fep->cc.mask;
+}
+
+static int fec_ptp_enable_perout(struct fec_enet_private *fep,
+				 struct ptp_perout_request *req, int on)
+{
+	unsigned long flags;
+	u64 start, period;
+	int chan;
+
+	chan = fec_ptp_channel_find(fep, PTP_PF_PEROUT, req->index);
+
+	if (!on) {
+		if (chan < 0)
+			return 0;
+		spin_lock_irqsave(&fep->tmreg_lock, flags);
+		fec_ptp_channel_stop(fep, chan);
+		fep->ptp_chan[chan].func = PTP_PF_NONE;
+		spin_unlock_irqrestore(&fep->tmreg_lock, flags);
+		return 0;
+	}
+
+	period = (u64)req->period.sec * NSEC_PER_SEC + req->period.nsec;
+	if (period < FEC_PEROUT_MIN_PERIOD || period > FEC_PEROUT_MAX_PERIOD)
+		return -ERANGE;
+	start = (u64)req->start.sec * NSEC_PER_SEC + req->start.nsec;
+
+	if (chan < 0) {
+		chan = ptp_find_pin(fep->ptp_clock, PTP_PF_PEROUT, req->index);
+		if (chan < 0)
+			return -EINVAL;
+		if (fep->ptp_chan[chan].func != PTP_PF_NONE ||
+		    (fep->pps_enable && chan == fep->pps_channel))
+			return -EBUSY;
+	}
+
+	spin_lock_irqsave(&fep->tmreg_lock, flags);
+	fep->ptp_chan[chan].func = PTP_PF_NONE;
+	fec_ptp_perout_start(fep, chan, start, period);
+	fep->ptp_chan[chan].index = req->index;
+	fep->ptp_chan[chan].func = PTP_PF_PEROUT;
+	spin_unlock_irqrestore(&fep->tmreg_lock, flags);
+
+	return 0;
+}
+
+static int fec_ptp_enable_extts(struct fec_enet_private *fep,
+				struct ptp_extts_request *req, int on)
+{
+	unsigned long flags;
+	u32 mode;
+	int chan;
+
+	chan = fec_ptp_channel_find(fep, PTP_PF_EXTTS, req->index);
+
+	if (!on) {
+		if (chan < 0)
+			return 0;
+		spin_lock_irqsave(&fep->tmreg_lock, flags);
+		fec_ptp_channel_stop(fep, chan);
+		fep->ptp_chan[chan].func = PTP_PF_NONE;
+		spin_unlock_irqrestore(&fep->tmreg_lock, flags);
+		return 0;
+	}
+
+	switch (req->flags & (PTP_RISING_EDGE | PTP_FALLING_EDGE)) {
+	case PTP_FALLING_EDGE:
+		mode = FEC_TMODE_CAPTURE_FALL;
+		break;
+	case PTP_RISING_EDGE | PTP_FALLING_EDGE:
+		mode = FEC_TMODE_CAPTURE_BOTH;
+		break;
+	default:
+		mode = FEC_TMODE_CAPTURE_RISE;
+		break;
+	}
+
+	if (chan < 0) {
+		chan = ptp_find_pin(fep->ptp_clock, PTP_PF_EXTTS, req->index);
+		if (chan < 0)
+			return -EINVAL;
+		if (fep->ptp_chan[chan].func != PTP_PF_NONE ||
+		    (fep->pps_enable && chan == fep->pps_channel))
+			return -EBUSY;
+	}
+
+	spin_lock_irqsave(&fep->tmreg_lock, flags);
+	fec_ptp_channel_stop(fep, chan);
+	writel(FEC_T_TF_MASK | FEC_T_TIE_MASK | (mode << FEC_T_TMODE_OFFSET),
+	       fep->hwp + FEC_TCSR(chan));
+	fep->ptp_chan[chan].index = req->index;
+	fep->ptp_chan[chan].func = PTP_PF_EXTTS;
+	spin_unlock_irqrestore(&fep->tmreg_lock, flags);
+
+	return 0;
+}
+
 /**
  * fec_ptp_enable
  * @ptp: the ptp clock structure
@@ -458,14 +636,31 @@ static int fec_ptp_enable(struct ptp_clock_info *ptp,
 {
 	struct fec_enet_private *fep =
 	    container_of(ptp, struct fec_enet_private, ptp_caps);
-	int ret = 0;
 
-	if (rq->type == PTP_CLK_REQ_PPS) {
-		ret = fec_ptp_enable_pps(fep, on);
+	switch (rq->type) {
+	case PTP_CLK_REQ_PPS:
+		return fec_ptp_enable_pps(fep, on);
+	case PTP_CLK_REQ_PEROUT:
+		return fec_ptp_enable_perout(fep, &rq->perout, on);
+	case PTP_CLK_REQ_EXTTS:
+		return fec_ptp_enable_extts(fep, &rq->extts, on);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
 
-		return ret;
+/* Every timer channel can capture or compare, but not synchronize */
+static int fec_ptp_verify(struct ptp_clock_info *ptp, unsigned int pin,
+			  enum ptp_pin_function func, unsigned int chan)
+{
+	switch (func) {
+	case PTP_PF_NONE:
+	case PTP_PF_EXTTS:
+	case PTP_PF_PEROUT:
+		return 0;
+	default:
+		return -EOPNOTSUPP;
 	}
-	return -EOPNOTSUPP;
 }
 
 /**
@@ -564,21 +759,31 @@ void fec_ptp_init(struct platform_device *pdev)
 {
 	struct net_device *ndev = platform_get_drvdata(pdev);
 	struct fec_enet_private *fep = netdev_priv(ndev);
+	int i;
 
 	fep->ptp_caps.owner = THIS_MODULE;
 	snprintf(fep->ptp_caps.name, 16, "fec ptp");
 
+	for (i = 0; i < FEC_PTP_CHANNELS; i++) {
+		snprintf(fep->ptp_pins[i].name, sizeof(fep->ptp_pins[i].name),
+			 "1588_EVENT%d", i);
+		fep->ptp_pins[i].index = i;
+		fep->ptp_pins[i].func = PTP_PF_NONE;
+	}
+
 	fep->ptp_caps.max_adj = 250000000;
 	fep->ptp_caps.n_alarm = 0;
-	fep->ptp_caps.n_ext_ts = 0;
-	fep->ptp_caps.n_per_out = 0;
-	fep->ptp_caps.n_pins = 0;
+	fep->ptp_caps.n_ext_ts = FEC_PTP_CHANNELS;
+	fep->ptp_caps.n_per_out = FEC_PTP_CHANNELS;
+	fep->ptp_caps.n_pins = FEC_PTP_CHANNELS;
 	fep->ptp_caps.pps = 1;
+	fep->ptp_caps.pin_config = fep->ptp_pins;
 	fep->ptp_caps.adjfreq = fec_ptp_adjfreq;
 	fep->ptp_caps.adjtime = fec_ptp_adjtime;
 	fep->ptp_caps.gettime64 = fec_ptp_gettime;
 	fep->ptp_caps.settime64 = fec_ptp_settime;
 	fep->ptp_caps.enable = fec_ptp_enable;
+	fep->ptp_caps.verify = fec_ptp_verify;
 
 	fep->cycle_speed = clk_get_rate(fep->clk_ptp);
 	fep->ptp_inc = NSEC_PER_SEC / fep->cycle_speed;
@@ -598,6 +803,38 @@ void fec_ptp_init(struct platform_device *pdev)
 	schedule_delayed_work(&fep->time_keep, HZ);
 }
 
+/* Reload a periodic output or report an external timestamp */
+static uint fec_ptp_check_channel(struct fec_enet_private *fep, int chan)
+{
+	struct fec_ptp_channel *ch = &fep->ptp_chan[chan];
+	struct ptp_clock_event event;
+	unsigned long flags;
+	u32 val, cyc;
+
+	val = readl(fep->hwp + FEC_TCSR(chan));
+	if (!(val & FEC_T_TF_MASK))
+		return 0;
+
+	if (ch->func == PTP_PF_PEROUT) {
+		writel(ch->next, fep->hwp + FEC_TCCR(chan));
+		writel(val, fep->hwp + FEC_TCSR(chan));
+		ch->next = (ch->next + ch->period) & fep->cc.mask;
+		return 1;
+	}
+
+	cyc = readl(fep->hwp + FEC_TCCR(chan));
+	writel(val, fep->hwp + FEC_TCSR(chan));
+
+	spin_lock_irqsave(&fep->tmreg_lock, flags);
+	event.timestamp = timecounter_cyc2time(&fep->tc, cyc);
+	spin_unlock_irqrestore(&fep->tmreg_lock, flags);
+
+	event.type = PTP_CLOCK_EXTTS;
+	event.index = ch->index;
+	ptp_clock_event(fep->ptp_clock, &event);
+	return 1;
+}
+
 /**
  * fec_ptp_check_pps_event
  * @fep: the fec_enet_private structure handle
@@ -609,6 +846,15 @@ uint fec_ptp_check_pps_event(struct fec_enet_private *fep)
 	u32 val;
 	u8 channel = fep->pps_channel;
 	struct ptp_clock_event event;
+	uint ret = 0;
+	int i;
+
+	for (i = 0; i < FEC_PTP_CHANNELS; i++)
+		if (fep->ptp_chan[i].func != PTP_PF_NONE)
+			ret |= fec_ptp_check_channel(fep, i);
+
+	if (!fep->pps_enable)
+		return ret;
 
 	val = readl(fep->hwp + FEC_TCSR(channel));
 	if (val & FEC_T_TF_MASK) {
@@ -628,5 +874,5 @@ uint fec_ptp_check_pps_event(struct fec_enet_private *fep)
 		return 1;
 	}
 
-	return 0;
+	return ret;
 }
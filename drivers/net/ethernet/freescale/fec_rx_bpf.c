@@ -0,0 +1,195 @@
+/*
+ * Fast Ethernet Controller (ENET) early RX BPF hook.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * A BPF_PROG_TYPE_RX_EARLY program written to the rx_bpf_prog attribute
+ * of the platform device (as a program fd, -1 detaches) runs on every
+ * received frame straight after the DMA sync, before an sk_buff exists.
+ * Dropped frames only cost the re-arm of their descriptor.  Redirected
+ * frames still get an sk_buff, but skip eth_type_trans() and GRO and are
+ * queued for transmission on the FEC named in rx_bpf_redirect.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/bpf.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/netdevice.h>
+#include <linux/platform_device.h>
+#include <linux/rtnetlink.h>
+#include <linux/skbuff.h>
+
+#include "fec.h"
+
+u32 __fec_rx_bpf_run(struct fec_enet_private *fep, void *data, u32 len)
+{
+	struct bpf_rx_frame frame = {
+		.len		= len,
+		.ifindex	= fep->netdev->ifindex,
+		.data		= data,
+	};
+	struct bpf_prog *prog;
+	u32 act = BPF_RX_PASS;
+
+	rcu_read_lock();
+	prog = rcu_dereference(fep->rx_prog);
+	if (prog)
+		act = BPF_PROG_RUN(prog, (void *)&frame);
+	rcu_read_unlock();
+
+	return act;
+}
+
+void fec_rx_bpf_redirect(struct fec_enet_private *fep, struct sk_buff *skb)
+{
+	struct net_device *dev;
+
+	rcu_read_lock();
+	dev = dev_get_by_index_rcu(dev_net(fep->netdev),
+				   READ_ONCE(fep->rx_redirect_ifindex));
+	if (unlikely(!dev || !(dev->flags & IFF_UP))) {
+		rcu_read_unlock();
+		fep->netdev->stats.rx_dropped++;
+		kfree_skb(skb);
+		return;
+	}
+
+	skb->dev = dev;
+	skb_reset_mac_header(skb);
+	skb->protocol = eth_hdr(skb)->h_proto;
+	dev_queue_xmit(skb);
+	rcu_read_unlock();
+}
+
+static void fec_rx_bpf_swap(struct fec_enet_private *fep,
+			    struct bpf_prog *prog)
+{
+	struct bpf_prog *old;
+
+	rtnl_lock();
+	old = rtnl_dereference(fep->rx_prog);
+	rcu_assign_pointer(fep->rx_prog, prog);
+	rtnl_unlock();
+
+	if (old) {
+		synchronize_net();
+		bpf_prog_put(old);
+	}
+}
+
+static ssize_t rx_bpf_prog_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct fec_enet_private *fep = netdev_priv(dev_get_drvdata(dev));
+
+	return sprintf(buf, "%d\n", rcu_access_pointer(fep->rx_prog) ? 1 : 0);
+}
+
+static ssize_t rx_bpf_prog_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct fec_enet_private *fep = netdev_priv(dev_get_drvdata(dev));
+	struct bpf_prog *prog = NULL;
+	int fd, ret;
+
+	ret = kstrtoint(buf, 0, &fd);
+	if (ret)
+		return ret;
+
+	if (fd >= 0) {
+		prog = bpf_prog_get(fd);
+		if (IS_ERR(prog))
+			return PTR_ERR(prog);
+		if (prog->type != BPF_PROG_TYPE_RX_EARLY) {
+			bpf_prog_put(prog);
+			return -EINVAL;
+		}
+	}
+
+	fec_rx_bpf_swap(fep, prog);
+	return count;
+}
+static DEVICE_ATTR_RW(rx_bpf_prog);
+
+static ssize_t rx_bpf_redirect_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct fec_enet_private *fep = netdev_priv(dev_get_drvdata(dev));
+	struct net_device *target;
+	ssize_t len;
+
+	rcu_read_lock();
+	target = dev_get_by_index_rcu(dev_net(fep->netdev),
+				      fep->rx_redirect_ifindex);
+	len = sprintf(buf, "%s\n", target ? target->name : "none");
+	rcu_read_unlock();
+
+	return len;
+}
+
+/* Only other FEC controllers are accepted, "none" clears the target */
+static ssize_t rx_bpf_redirect_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct fec_enet_private *fep = netdev_priv(dev_get_drvdata(dev));
+	struct net_device *target;
+	char name[IFNAMSIZ];
+	int ifindex = 0;
+
+	strlcpy(name, buf, sizeof(name));
+	strim(name);
+
+	if (strcmp(name, "none")) {
+		target = dev_get_by_name(dev_net(fep->netdev), name);
+		if (!target)
+			return -ENODEV;
+		if (target == fep->netdev ||
+		    target->netdev_ops != fep->netdev->netdev_ops) {
+			dev_put(target);
+			return -EINVAL;
+		}
+		ifindex = target->ifindex;
+		dev_put(target);
+	}
+
+	WRITE_ONCE(fep->rx_redirect_ifindex, ifindex);
+	return count;
+}
+static DEVICE_ATTR_RW(rx_bpf_redirect);
+
+static struct attribute *fec_rx_bpf_attrs[] = {
+	&dev_attr_rx_bpf_prog.attr,
+	&dev_attr_rx_bpf_redirect.attr,
+	NULL,
+};
+
+static const struct attribute_group fec_rx_bpf_group = {
+	.attrs = fec_rx_bpf_attrs,
+};
+
+void fec_rx_bpf_init(struct fec_enet_private *fep)
+{
+	int ret;
+
+	ret = sysfs_create_group(&fep->pdev->dev.kobj, &fec_rx_bpf_group);
+	if (ret)
+		netdev_warn(fep->netdev, "RX BPF hook disabled: %d\n", ret);
+}
+
+void fec_rx_bpf_remove(struct fec_enet_private *fep)
+{
+	sysfs_remove_group(&fep->pdev->dev.kobj, &fec_rx_bpf_group);
+	fec_rx_bpf_swap(fep, NULL);
+}
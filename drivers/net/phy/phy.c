@@ -496,6 +496,20 @@ void phy_start_machine(struct phy_device *phydev)
 	queue_delayed_work(system_power_efficient_wq, &phydev->state_queue, HZ);
 }
 
+/**
+ * phy_trigger_machine - trigger the state machine to run now
+ * @phydev: the phy_device struct
+ *
+ * Description: Runs the state machine as soon as possible instead of
+ *   waiting for the next poll, e.g. so that autonegotiation starts
+ *   right after phy_start().
+ */
+void phy_trigger_machine(struct phy_device *phydev)
+{
+	mod_delayed_work(system_power_efficient_wq, &phydev->state_queue, 0);
+}
+EXPORT_SYMBOL(phy_trigger_machine);
+
 /**
  * phy_stop_machine - stop the PHY state machine tracking
  * @phydev: target phy_device struct
@@ -771,6 +785,10 @@ void phy_start(struct phy_device *phydev)
 	/* if phy was suspended, bring the physical link up again */
 	if (do_resume)
 		phy_resume(phydev);
+
+	/* Don't leave the link down for a whole poll period */
+	if (!err)
+		phy_trigger_machine(phydev);
 }
 EXPORT_SYMBOL(phy_start);
 
@@ -831,6 +849,10 @@ void phy_state_machine(struct work_struct *work)
 			needs_aneg = true;
 		break;
 	case PHY_NOLINK:
+		/* With a working interrupt the PHY tells us about link up */
+		if (phy_interrupt_is_valid(phydev))
+			break;
+
 		err = phy_read_status(phydev);
 		if (err)
 			break;
@@ -991,6 +991,16 @@ sdioh_request_byte(sdioh_info_t *sd, uint rw, uint func, uint regaddr, uint8 *by
 uint
 sdioh_set_mode(sdioh_info_t *sd, uint mode)
 {
+	struct mmc_host *host = sd->func[1]->card->host;
+
+	/* multi-descriptor glom needs a scatter-gather entry per frame */
+	if (mode == SDPCM_TXGLOM_MDESC &&
+	    host->max_segs < SDIOH_SDMMC_MAX_SG_ENTRIES) {
+		sd_err(("%s: host takes %u segments, using copy glom\n",
+			__FUNCTION__, host->max_segs));
+		mode = SDPCM_TXGLOM_CPY;
+	}
+
 	if (mode == SDPCM_TXGLOM_CPY)
 		sd->txglom_mode = mode;
 	else if (mode == SDPCM_TXGLOM_MDESC)
@@ -1150,7 +1160,8 @@ sdioh_request_packet_chain(sdioh_info_t *sd, uint fix_inc, uint write, uint func
 			 * NOT something we can handle here, but in case it happens, PLEASE put
 			 * a restriction on max tx/glom count (based on host->max_segs).
 			 */
-			if (sg_count >= ARRAYSIZE(sd->sg_list)) {
+			if (sg_count >= ARRAYSIZE(sd->sg_list) ||
+			    sg_count >= host->max_segs) {
 				sd_err(("%s: sg list entries exceed limit %d\n", __FUNCTION__, sg_count));
 				return (SDIOH_API_RC_FAIL);
 			}
@@ -117,6 +117,19 @@ struct spi_imx_data {
 	struct completion dma_tx_completion;
 	struct dma_slave_config rx_config;
 	struct dma_slave_config tx_config;
+	/* DMA slave setup that was last handed to the channels */
+	u32 rx_burst_applied;
+	enum dma_slave_buswidth width_applied;
+
+	/* ECSPI registers as last written by mx51_ecspi_config() */
+	bool config_cached;
+	u32 ctrl_cache;
+	u32 cfg_cache;
+	u32 dma_cache;
+
+	/* zeroes clocked out while a flash read is received by DMA */
+	void *flash_dummy;
+	dma_addr_t flash_dummy_dma;
 
 	const struct spi_imx_devtype_data *devtype_data;
 	int chipselect[0];
@@ -205,15 +218,60 @@ static unsigned int spi_imx_clkdiv_2(unsigned int fin,
 	return 7;
 }
 
+static unsigned int dma_min_words;
+module_param(dma_min_words, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_min_words,
+		 "Shortest transfer in words done by DMA (default: 0, one FIFO fill)");
+
+static unsigned int spi_imx_bytes_per_word(unsigned int bpw)
+{
+	if (bpw <= 8)
+		return 1;
+	else if (bpw <= 16)
+		return 2;
+	else
+		return 4;
+}
+
+/*
+ * A transfer that fits the FIFO is done by PIO with a single interrupt,
+ * which beats the descriptor setup of a DMA transfer. Anything longer
+ * goes to DMA whatever its length, see spi_imx_dma_wml().
+ */
 static bool spi_imx_can_dma(struct spi_master *master, struct spi_device *spi,
 			 struct spi_transfer *transfer)
 {
 	struct spi_imx_data *spi_imx = spi_master_get_devdata(master);
+	unsigned int bpw, words;
+
+	if (!transfer || !spi_imx->dma_is_inited)
+		return false;
+
+	bpw = transfer->bits_per_word ? : spi->bits_per_word;
+	words = transfer->len / spi_imx_bytes_per_word(bpw);
+
+	if (dma_min_words)
+		return words >= dma_min_words;
+
+	return words > spi_imx_get_fifosize(spi_imx);
+}
 
-	if (transfer && spi_imx->dma_is_inited &&
-		(transfer->len > spi_imx_get_fifosize(spi_imx)))
-		return true;
-	return false;
+/*
+ * The RX DMA request only fires once the FIFO holds a full watermark,
+ * so pick the largest watermark that divides the transfer. There is
+ * then no tail for the DMA to miss and no PIO fixup at the end.
+ */
+static unsigned int spi_imx_dma_wml(struct spi_imx_data *spi_imx,
+				    unsigned int len, unsigned int bpw)
+{
+	unsigned int words = len / spi_imx_bytes_per_word(bpw);
+	unsigned int i;
+
+	for (i = spi_imx_get_fifosize(spi_imx) / 2; i > 1; i--)
+		if (!(words % i))
+			break;
+
+	return i;
 }
 
 #define MX51_ECSPI_CTRL		0x08
@@ -359,8 +417,23 @@ static int __maybe_unused mx51_ecspi_config(struct spi_imx_data *spi_imx,
 	if (config->mode & SPI_CS_HIGH)
 		cfg |= MX51_ECSPI_CONFIG_SSBPOL(config->cs);
 
+	/*
+	 * Back-to-back transfers to the same device mostly share speed and
+	 * mode: leave the controller alone and skip the settle delay then.
+	 */
+	if (spi_imx->config_cached && ctrl == spi_imx->ctrl_cache &&
+	    cfg == spi_imx->cfg_cache)
+		goto config_dma;
+
 	writel(ctrl, spi_imx->base + MX51_ECSPI_CTRL);
+	if (spi_imx->config_cached && cfg == spi_imx->cfg_cache) {
+		spi_imx->ctrl_cache = ctrl;
+		goto config_dma;
+	}
 	writel(cfg, spi_imx->base + MX51_ECSPI_CONFIG);
+	spi_imx->ctrl_cache = ctrl;
+	spi_imx->cfg_cache = cfg;
+	spi_imx->config_cached = true;
 
 	/*
 	 * Wait until the changes in the configuration register CONFIGREG
@@ -379,6 +452,7 @@ static int __maybe_unused mx51_ecspi_config(struct spi_imx_data *spi_imx,
 	else			/* SCLK is _very_ slow */
 		usleep_range(delay, delay + 10);
 
+config_dma:
 	/*
 	 * Configure the DMA register: setup the watermark
 	 * and enable DMA request.
@@ -390,7 +464,10 @@ static int __maybe_unused mx51_ecspi_config(struct spi_imx_data *spi_imx,
 		      | (spi_imx->tx_wml - 1) << MX51_ECSPI_DMA_TX_WML_OFFSET
 		      | (1 << MX51_ECSPI_DMA_TEDEN_OFFSET)
 		      | (1 << MX51_ECSPI_DMA_RXDEN_OFFSET);
-		writel(dma, spi_imx->base + MX51_ECSPI_DMA);
+		if (dma != spi_imx->dma_cache) {
+			writel(dma, spi_imx->base + MX51_ECSPI_DMA);
+			spi_imx->dma_cache = dma;
+		}
 	}
 
 	return 0;
@@ -784,6 +861,35 @@ static irqreturn_t spi_imx_isr(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/* Only talk to the DMA channels when the burst or width changed */
+static int spi_imx_dma_slave_config(struct spi_imx_data *spi_imx,
+				    struct spi_device *spi)
+{
+	struct spi_master *master = spi_imx->bitbang.master;
+	int ret;
+
+	if (spi_imx->rx_burst_applied == spi_imx->rx_config.src_maxburst &&
+	    spi_imx->width_applied == spi_imx->rx_config.src_addr_width)
+		return 0;
+
+	ret = dmaengine_slave_config(master->dma_tx, &spi_imx->tx_config);
+	if (ret) {
+		dev_err(&spi->dev, "error in TX dma configuration.\n");
+		return ret;
+	}
+
+	ret = dmaengine_slave_config(master->dma_rx, &spi_imx->rx_config);
+	if (ret) {
+		dev_err(&spi->dev, "error in RX dma configuration.\n");
+		return ret;
+	}
+
+	spi_imx->rx_burst_applied = spi_imx->rx_config.src_maxburst;
+	spi_imx->width_applied = spi_imx->rx_config.src_addr_width;
+
+	return 0;
+}
+
 static int spi_imx_setupxfer(struct spi_device *spi,
 				 struct spi_transfer *t)
 {
@@ -821,19 +927,12 @@ static int spi_imx_setupxfer(struct spi_device *spi,
 
 	if (spi_imx->bitbang.master->can_dma &&
 	    spi_imx_can_dma(spi_imx->bitbang.master, spi, t)) {
-		ret = dmaengine_slave_config(spi_imx->bitbang.master->dma_tx,
-						&spi_imx->tx_config);
-		if (ret) {
-			dev_err(&spi->dev, "error in TX dma configuration.\n");
-			return ret;
-		}
+		spi_imx->rx_wml = spi_imx_dma_wml(spi_imx, t->len, config.bpw);
+		spi_imx->rx_config.src_maxburst = spi_imx->rx_wml;
 
-		ret = dmaengine_slave_config(spi_imx->bitbang.master->dma_rx,
-						&spi_imx->rx_config);
-		if (ret) {
-			dev_err(&spi->dev, "error in RX dma configuration.\n");
+		ret = spi_imx_dma_slave_config(spi_imx, spi);
+		if (ret)
 			return ret;
-		}
 	}
 
 	spi_imx->devtype_data->config(spi_imx, &config);
@@ -845,6 +944,13 @@ static void spi_imx_sdma_exit(struct spi_imx_data *spi_imx)
 {
 	struct spi_master *master = spi_imx->bitbang.master;
 
+	if (spi_imx->flash_dummy) {
+		dma_free_coherent(master->dma_tx->device->dev,
+				  MAX_SDMA_BD_BYTES, spi_imx->flash_dummy,
+				  spi_imx->flash_dummy_dma);
+		spi_imx->flash_dummy = NULL;
+	}
+
 	if (master->dma_rx) {
 		dma_release_channel(master->dma_rx);
 		master->dma_rx = NULL;
@@ -930,33 +1036,11 @@ static void spi_imx_dma_tx_callback(void *cookie)
 	complete(&spi_imx->dma_tx_completion);
 }
 
-static void spi_imx_tail_pio_set(struct spi_imx_data *spi_imx, int left)
-{
-
-	switch (spi_imx->rx_config.src_addr_width) {
-	case DMA_SLAVE_BUSWIDTH_1_BYTE:
-		spi_imx->rx = spi_imx_buf_rx_u8;
-		break;
-	case DMA_SLAVE_BUSWIDTH_2_BYTES:
-		spi_imx->rx = spi_imx_buf_rx_u16;
-		break;
-	case DMA_SLAVE_BUSWIDTH_4_BYTES:
-		spi_imx->rx = spi_imx_buf_rx_u32;
-		break;
-	default:
-		spi_imx->rx = spi_imx_buf_rx_u8;
-		break;
-	}
-
-	spi_imx->txfifo = left / spi_imx->tx_config.dst_addr_width;
-}
-
 static int spi_imx_dma_transfer(struct spi_imx_data *spi_imx,
 				struct spi_transfer *transfer)
 {
 	struct dma_async_tx_descriptor *desc_tx = NULL, *desc_rx = NULL;
 	int ret;
-	int left = 0;
 	struct spi_master *master = spi_imx->bitbang.master;
 	struct sg_table *tx = &transfer->tx_sg, *rx = &transfer->rx_sg;
 
@@ -973,18 +1057,6 @@ static int spi_imx_dma_transfer(struct spi_imx_data *spi_imx,
 	}
 
 	if (rx) {
-		struct scatterlist *sgl_last = &rx->sgl[rx->nents - 1];
-		unsigned int	orig_length = sgl_last->length;
-		int	wml_mask = ~(spi_imx->rx_wml - 1);
-		/*
-		 * Adjust the transfer lenth of the last scattlist if there are
-		 * some tail data, use PIO read to get the tail data since DMA
-		 * sometimes miss the last tail interrupt.
-		 */
-		left = transfer->len % spi_imx->rx_wml;
-		if (left)
-			sgl_last->length = orig_length & wml_mask;
-
 		desc_rx = dmaengine_prep_slave_sg(master->dma_rx,
 					rx->sgl, rx->nents, DMA_DEV_TO_MEM,
 					DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
@@ -1022,25 +1094,6 @@ static int spi_imx_dma_transfer(struct spi_imx_data *spi_imx,
 				dev_name(&master->dev), transfer->len);
 			spi_imx->devtype_data->reset(spi_imx);
 			dmaengine_terminate_all(master->dma_rx);
-		} else if (left) {
-			/* read the tail data by PIO */
-			dma_sync_sg_for_cpu(master->dma_rx->device->dev,
-					    &rx->sgl[rx->nents - 1], 1,
-					    DMA_FROM_DEVICE);
-			spi_imx->rx_buf = transfer->rx_buf
-						+ (transfer->len - left);
-			spi_imx_tail_pio_set(spi_imx, left);
-			reinit_completion(&spi_imx->xfer_done);
-
-			spi_imx->devtype_data->intctrl(spi_imx, MXC_INT_TCEN);
-
-			ret = wait_for_completion_timeout(&spi_imx->xfer_done,
-						IMX_DMA_TIMEOUT(transfer->len));
-			if (!ret) {
-				pr_warn("%s %s: I/O Error in RX tail\n",
-					dev_driver_string(&master->dev),
-					dev_name(&master->dev));
-			}
 		}
 	}
 
@@ -1153,6 +1206,128 @@ spi_imx_unprepare_message(struct spi_master *master, struct spi_message *msg)
 	return 0;
 }
 
+/*
+ * SPI NOR reads bypass the message queue: the opcode, address and dummy
+ * bytes go out by PIO, then the whole data phase is received by a single
+ * DMA transfer. The chip select is held by GPIO in between, the native
+ * SS would be dropped by the ECSPI as soon as the TX FIFO runs empty.
+ */
+static bool spi_imx_flash_read_supported(struct spi_device *spi)
+{
+	struct spi_imx_data *spi_imx = spi_master_get_devdata(spi->master);
+
+	return spi_imx->dma_is_inited &&
+	       gpio_is_valid(spi_imx->chipselect[spi->chip_select]);
+}
+
+/* Point every TX entry at the zero buffer, matching the RX entries */
+static int spi_imx_flash_tx_sg(struct spi_imx_data *spi_imx,
+			       struct sg_table *tx, struct sg_table *rx)
+{
+	struct spi_master *master = spi_imx->bitbang.master;
+	struct scatterlist *rx_sg, *tx_sg;
+	int i, ret;
+
+	if (!spi_imx->flash_dummy) {
+		spi_imx->flash_dummy =
+			dma_zalloc_coherent(master->dma_tx->device->dev,
+					    MAX_SDMA_BD_BYTES,
+					    &spi_imx->flash_dummy_dma,
+					    GFP_KERNEL);
+		if (!spi_imx->flash_dummy)
+			return -ENOMEM;
+	}
+
+	ret = sg_alloc_table(tx, rx->nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	tx_sg = tx->sgl;
+	for_each_sg(rx->sgl, rx_sg, rx->nents, i) {
+		if (sg_dma_len(rx_sg) > MAX_SDMA_BD_BYTES) {
+			sg_free_table(tx);
+			return -EINVAL;
+		}
+		sg_dma_address(tx_sg) = spi_imx->flash_dummy_dma;
+		sg_dma_len(tx_sg) = sg_dma_len(rx_sg);
+		tx_sg = sg_next(tx_sg);
+	}
+
+	return 0;
+}
+
+static int spi_imx_flash_read(struct spi_device *spi,
+			      struct spi_flash_read_message *msg)
+{
+	struct spi_imx_data *spi_imx = spi_master_get_devdata(spi->master);
+	struct spi_master *master = spi->master;
+	struct spi_transfer cmd, data;
+	u8 cmdbuf[16];
+	int i, ret;
+
+	if (1 + msg->addr_width + msg->dummy_bytes > sizeof(cmdbuf))
+		return -EINVAL;
+
+	cmdbuf[0] = msg->read_opcode;
+	for (i = 0; i < msg->addr_width; i++)
+		cmdbuf[1 + i] = msg->from >> (8 * (msg->addr_width - 1 - i));
+	memset(&cmdbuf[1 + msg->addr_width], 0, msg->dummy_bytes);
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.tx_buf = cmdbuf;
+	cmd.len = 1 + msg->addr_width + msg->dummy_bytes;
+	cmd.bits_per_word = 8;
+	cmd.speed_hz = spi->max_speed_hz;
+
+	memset(&data, 0, sizeof(data));
+	data.rx_buf = msg->buf;
+	data.len = msg->len;
+	data.bits_per_word = 8;
+	data.speed_hz = spi->max_speed_hz;
+
+	ret = spi_imx_prepare_message(master, NULL);
+	if (ret)
+		return ret;
+
+	ret = spi_imx_setupxfer(spi, &cmd);
+	if (ret)
+		goto out_clk;
+
+	spi_imx_chipselect(spi, BITBANG_CS_ACTIVE);
+	ret = spi_imx_pio_transfer(spi, &cmd);
+	if (ret < 0)
+		goto out_cs;
+
+	ret = -EAGAIN;
+	if (msg->cur_msg_mapped && spi_imx_can_dma(master, spi, &data) &&
+	    !spi_imx_flash_tx_sg(spi_imx, &data.tx_sg, &msg->rx_sg)) {
+		data.rx_sg = msg->rx_sg;
+		ret = spi_imx_setupxfer(spi, &data);
+		if (!ret) {
+			spi_imx->usedma = true;
+			ret = spi_imx_dma_transfer(spi_imx, &data);
+			spi_imx->usedma = false;
+		}
+		sg_free_table(&data.tx_sg);
+	}
+
+	if (ret == -EAGAIN)
+		ret = spi_imx_pio_transfer(spi, &data);
+
+out_cs:
+	spi_imx_chipselect(spi, BITBANG_CS_INACTIVE);
+
+out_clk:
+	spi_imx_unprepare_message(master, NULL);
+
+	if (ret < 0)
+		return ret;
+
+	msg->retlen = msg->len;
+
+	return 0;
+}
+
 static int spi_imx_probe(struct platform_device *pdev)
 {
 	struct device_node *np = pdev->dev.of_node;
@@ -1216,6 +1391,9 @@ static int spi_imx_probe(struct platform_device *pdev)
 	spi_imx->bitbang.master->cleanup = spi_imx_cleanup;
 	spi_imx->bitbang.master->prepare_message = spi_imx_prepare_message;
 	spi_imx->bitbang.master->unprepare_message = spi_imx_unprepare_message;
+	spi_imx->bitbang.master->spi_flash_read = spi_imx_flash_read;
+	spi_imx->bitbang.master->flash_read_supported =
+					spi_imx_flash_read_supported;
 	spi_imx->bitbang.master->mode_bits = SPI_CPOL | SPI_CPHA | SPI_CS_HIGH;
 
 	init_completion(&spi_imx->xfer_done);
@@ -1325,6 +1503,12 @@ static int spi_imx_suspend(struct device *dev)
 
 static int spi_imx_resume(struct device *dev)
 {
+	struct spi_master *master = dev_get_drvdata(dev);
+	struct spi_imx_data *spi_imx = spi_master_get_devdata(master);
+
+	/* the controller may have lost its registers */
+	spi_imx->config_cached = false;
+	spi_imx->dma_cache = 0;
 	pinctrl_pm_select_default_state(dev);
 	return 0;
 }
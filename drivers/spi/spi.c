@@ -616,6 +616,19 @@ static inline int spi_unmap_msg(struct spi_master *master,
 {
 	return 0;
 }
+
+static inline int spi_map_buf(struct spi_master *master, struct device *dev,
+			      struct sg_table *sgt, void *buf, size_t len,
+			      enum dma_data_direction dir)
+{
+	return -EINVAL;
+}
+
+static inline void spi_unmap_buf(struct spi_master *master,
+				 struct device *dev, struct sg_table *sgt,
+				 enum dma_data_direction dir)
+{
+}
 #endif /* !CONFIG_HAS_DMA */
 
 static int spi_map_msg(struct spi_master *master, struct spi_message *msg)
@@ -792,8 +805,11 @@ static void __spi_pump_messages(struct spi_master *master, bool in_kthread)
 	/* Lock queue */
 	spin_lock_irqsave(&master->queue_lock, flags);
 
-	/* Make sure we are not already running a message */
-	if (master->cur_msg) {
+	/*
+	 * Make sure we are not already running a message, and keep off
+	 * the hardware while spi_flash_read() uses it; it kicks us after.
+	 */
+	if (master->cur_msg || master->flash_reading) {
 		spin_unlock_irqrestore(&master->queue_lock, flags);
 		return;
 	}
@@ -2207,6 +2223,143 @@ int spi_bus_unlock(struct spi_master *master)
 }
 EXPORT_SYMBOL_GPL(spi_bus_unlock);
 
+/*
+ * spi_async() messages of other devices can still be queued while the
+ * bus lock mutex is held.  Wait for the message pump to finish the one
+ * it is on, then hold it off until spi_flash_release_pump(); whatever
+ * is queued meanwhile runs after the flash read.
+ */
+static int spi_flash_claim_pump(struct spi_master *master)
+{
+	unsigned long flags;
+	unsigned limit = 500;
+	int ret = 0;
+
+	if (!master->queued)
+		return 0;
+
+	spin_lock_irqsave(&master->queue_lock, flags);
+
+	while ((master->cur_msg || master->idling) && limit--) {
+		spin_unlock_irqrestore(&master->queue_lock, flags);
+		usleep_range(100, 200);
+		spin_lock_irqsave(&master->queue_lock, flags);
+	}
+
+	if (master->cur_msg || master->idling)
+		ret = -EBUSY;
+	else
+		master->flash_reading = true;
+
+	spin_unlock_irqrestore(&master->queue_lock, flags);
+
+	return ret;
+}
+
+static void spi_flash_release_pump(struct spi_master *master)
+{
+	unsigned long flags;
+
+	if (!master->queued)
+		return;
+
+	spin_lock_irqsave(&master->queue_lock, flags);
+	master->flash_reading = false;
+	if (master->busy || !list_empty(&master->queue))
+		queue_kthread_work(&master->kworker, &master->pump_messages);
+	spin_unlock_irqrestore(&master->queue_lock, flags);
+}
+
+/**
+ * spi_flash_read - read from SPI flash through the master's fast path
+ * @spi: device the flash is attached to
+ * @msg: describes the read (opcode, address, dummy bytes and buffer)
+ * Context: can sleep
+ *
+ * Hands the whole read to the controller driver in one go instead of
+ * building an spi_message and going through the message queue. The
+ * receive buffer is mapped for DMA on the master's RX channel when it
+ * has one; @msg->cur_msg_mapped tells the driver whether @msg->rx_sg
+ * may be used.
+ *
+ * Only call this when spi_flash_read_supported() returns true.
+ *
+ * Like spi_sync(), this serialises against other synchronous users and
+ * spi_bus_lock() holders through the bus lock mutex, without locking
+ * the bus against spi_async().  -EBUSY means the message pump did not
+ * come free in time; callers can fall back to a regular message.
+ *
+ * It returns zero on success, else a negative error code.
+ */
+int spi_flash_read(struct spi_device *spi,
+		   struct spi_flash_read_message *msg)
+{
+	struct spi_master *master = spi->master;
+	struct device *rx_dev = NULL;
+	int ret;
+
+	if ((msg->opcode_nbits == SPI_NBITS_DUAL ||
+	     msg->addr_nbits == SPI_NBITS_DUAL) &&
+	    !(spi->mode & (SPI_TX_DUAL | SPI_TX_QUAD)))
+		return -EINVAL;
+	if ((msg->opcode_nbits == SPI_NBITS_QUAD ||
+	     msg->addr_nbits == SPI_NBITS_QUAD) &&
+	    !(spi->mode & SPI_TX_QUAD))
+		return -EINVAL;
+	if (msg->data_nbits == SPI_NBITS_DUAL &&
+	    !(spi->mode & (SPI_RX_DUAL | SPI_RX_QUAD)))
+		return -EINVAL;
+	if (msg->data_nbits == SPI_NBITS_QUAD &&
+	    !(spi->mode & SPI_RX_QUAD))
+		return -EINVAL;
+
+	mutex_lock(&master->bus_lock_mutex);
+
+	ret = spi_flash_claim_pump(master);
+	if (ret) {
+		dev_dbg(&master->dev, "message queue busy, no flash read\n");
+		goto out_unlock;
+	}
+
+	if (master->auto_runtime_pm) {
+		ret = pm_runtime_get_sync(master->dev.parent);
+		if (ret < 0) {
+			dev_err(&master->dev, "Failed to power device: %d\n",
+				ret);
+			pm_runtime_put_noidle(master->dev.parent);
+			goto out_release;
+		}
+	}
+
+	msg->cur_msg_mapped = false;
+	memset(&msg->rx_sg, 0, sizeof(msg->rx_sg));
+	if (master->dma_rx) {
+		rx_dev = master->dma_rx->device->dev;
+		ret = spi_map_buf(master, rx_dev, &msg->rx_sg,
+				  msg->buf, msg->len, DMA_FROM_DEVICE);
+		if (!ret)
+			msg->cur_msg_mapped = true;
+	}
+
+	ret = master->spi_flash_read(spi, msg);
+
+	if (msg->cur_msg_mapped)
+		spi_unmap_buf(master, rx_dev, &msg->rx_sg, DMA_FROM_DEVICE);
+
+	if (master->auto_runtime_pm) {
+		pm_runtime_mark_last_busy(master->dev.parent);
+		pm_runtime_put_autosuspend(master->dev.parent);
+	}
+
+out_release:
+	spi_flash_release_pump(master);
+out_unlock:
+	mutex_unlock(&master->bus_lock_mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(spi_flash_read);
+
 /* portable code must never pass more than 32 bytes */
 #define	SPI_BUFSIZ	max(32, SMP_CACHE_BYTES)
 
@@ -0,0 +1,379 @@
+/*
+ * drivers/staging/android/ion/imx/imx_ion.c
+ *
+ * Copyright (C) 2015 Freescale Semiconductor, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * One ion device for the capture, PXP, GPU and display pipeline, with up
+ * to three heaps described by the "fsl,imx-ion" node:
+ *
+ *   ion {
+ *	compatible = "fsl,imx-ion";
+ *	memory-region = <&ion_cma>;	   optional, else the default CMA
+ *	fsl,carveout = <&ion_reserved>;	   optional reserved-memory node
+ *	fsl,ocram = <&ocram>;		   optional mmio-sram node
+ *	fsl,ocram-size = <0x10000>;
+ *   };
+ *
+ * Heap ids are fixed so that user space can build its heap masks: 0 is
+ * the CMA heap, which also hands out cached buffers, 1 the carveout and
+ * 2 the OCRAM heap.  The carveout must not be "no-map", ion needs its
+ * struct pages.  OCRAM buffers are always uncached and are carved out of
+ * the mmio-sram pool at probe, so other OCRAM users keep the rest.
+ */
+
+#include <linux/err.h>
+#include <linux/genalloc.h>
+#include <linux/io.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/of_reserved_mem.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include "../ion.h"
+#include "../ion_priv.h"
+
+enum {
+	IMX_ION_HEAP_CMA,
+	IMX_ION_HEAP_CARVEOUT,
+	IMX_ION_HEAP_OCRAM,
+	IMX_ION_HEAP_NUM,
+};
+
+struct imx_ocram_heap {
+	struct ion_heap heap;
+	struct gen_pool *sram;		/* the mmio-sram pool */
+	unsigned long sram_vaddr;	/* our region of it */
+	size_t sram_size;
+	struct gen_pool *pool;		/* page granular, for buffers */
+};
+
+#define to_ocram_heap(x) container_of(x, struct imx_ocram_heap, heap)
+
+struct imx_ion {
+	struct ion_device *idev;
+	struct ion_heap *heaps[IMX_ION_HEAP_NUM];
+};
+
+static int imx_ocram_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
+			      unsigned long len, unsigned long align,
+			      unsigned long flags)
+{
+	struct imx_ocram_heap *ocram = to_ocram_heap(heap);
+	unsigned long vaddr;
+
+	if ((flags & ION_FLAG_CACHED) || align > PAGE_SIZE)
+		return -EINVAL;
+
+	vaddr = gen_pool_alloc(ocram->pool, len);
+	if (!vaddr)
+		return -ENOMEM;
+
+	memset_io((void __iomem *)vaddr, 0, len);
+	buffer->priv_virt = (void *)vaddr;
+	return 0;
+}
+
+static void imx_ocram_free(struct ion_buffer *buffer)
+{
+	struct imx_ocram_heap *ocram = to_ocram_heap(buffer->heap);
+
+	gen_pool_free(ocram->pool, (unsigned long)buffer->priv_virt,
+		      buffer->size);
+}
+
+static phys_addr_t imx_ocram_buffer_phys(struct ion_buffer *buffer)
+{
+	struct imx_ocram_heap *ocram = to_ocram_heap(buffer->heap);
+
+	return gen_pool_virt_to_phys(ocram->pool,
+				     (unsigned long)buffer->priv_virt);
+}
+
+static int imx_ocram_phys(struct ion_heap *heap, struct ion_buffer *buffer,
+			  ion_phys_addr_t *addr, size_t *len)
+{
+	*addr = imx_ocram_buffer_phys(buffer);
+	*len = buffer->size;
+	return 0;
+}
+
+/* There is no struct page behind OCRAM, only the dma address is filled in */
+static struct sg_table *imx_ocram_map_dma(struct ion_heap *heap,
+					  struct ion_buffer *buffer)
+{
+	struct sg_table *table;
+	int ret;
+
+	table = kmalloc(sizeof(struct sg_table), GFP_KERNEL);
+	if (!table)
+		return ERR_PTR(-ENOMEM);
+	ret = sg_alloc_table(table, 1, GFP_KERNEL);
+	if (ret) {
+		kfree(table);
+		return ERR_PTR(ret);
+	}
+
+	table->sgl->length = buffer->size;
+	sg_dma_address(table->sgl) = imx_ocram_buffer_phys(buffer);
+	sg_dma_len(table->sgl) = buffer->size;
+	return table;
+}
+
+static void imx_ocram_unmap_dma(struct ion_heap *heap,
+				struct ion_buffer *buffer)
+{
+	sg_free_table(buffer->sg_table);
+	kfree(buffer->sg_table);
+}
+
+static int imx_ocram_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
+			      struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if ((vma->vm_pgoff << PAGE_SHIFT) + size > buffer->size)
+		return -EINVAL;
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       PFN_DOWN(imx_ocram_buffer_phys(buffer)) +
+			       vma->vm_pgoff, size, vma->vm_page_prot);
+}
+
+/* the sram driver already mapped the whole of OCRAM write-combined */
+static void *imx_ocram_map_kernel(struct ion_heap *heap,
+				  struct ion_buffer *buffer)
+{
+	return buffer->priv_virt;
+}
+
+static void imx_ocram_unmap_kernel(struct ion_heap *heap,
+				   struct ion_buffer *buffer)
+{
+}
+
+static struct ion_heap_ops imx_ocram_ops = {
+	.allocate = imx_ocram_allocate,
+	.free = imx_ocram_free,
+	.phys = imx_ocram_phys,
+	.map_dma = imx_ocram_map_dma,
+	.unmap_dma = imx_ocram_unmap_dma,
+	.map_user = imx_ocram_map_user,
+	.map_kernel = imx_ocram_map_kernel,
+	.unmap_kernel = imx_ocram_unmap_kernel,
+};
+
+static struct ion_heap *imx_ocram_heap_create(struct gen_pool *sram,
+					      size_t size)
+{
+	struct imx_ocram_heap *ocram;
+	phys_addr_t phys;
+	unsigned long skip;
+	int ret = -ENOMEM;
+
+	ocram = kzalloc(sizeof(*ocram), GFP_KERNEL);
+	if (!ocram)
+		return ERR_PTR(-ENOMEM);
+
+	/* one page extra, the sram pool does not align its allocations */
+	ocram->sram = sram;
+	ocram->sram_size = size + PAGE_SIZE;
+	ocram->sram_vaddr = gen_pool_alloc(sram, ocram->sram_size);
+	if (!ocram->sram_vaddr)
+		goto err_free;
+
+	ocram->pool = gen_pool_create(PAGE_SHIFT, -1);
+	if (!ocram->pool)
+		goto err_sram;
+
+	phys = gen_pool_virt_to_phys(sram, ocram->sram_vaddr);
+	skip = PAGE_ALIGN(phys) - phys;
+	ret = gen_pool_add_virt(ocram->pool, ocram->sram_vaddr + skip,
+				phys + skip, size, -1);
+	if (ret)
+		goto err_pool;
+
+	ocram->heap.ops = &imx_ocram_ops;
+	ocram->heap.type = ION_HEAP_TYPE_CUSTOM;
+	ocram->heap.flags = ION_HEAP_FLAG_NO_PAGES;
+	ocram->heap.name = "ocram";
+	ocram->heap.id = IMX_ION_HEAP_OCRAM;
+	return &ocram->heap;
+
+err_pool:
+	gen_pool_destroy(ocram->pool);
+err_sram:
+	gen_pool_free(sram, ocram->sram_vaddr, ocram->sram_size);
+err_free:
+	kfree(ocram);
+	return ERR_PTR(ret);
+}
+
+static void imx_ocram_heap_destroy(struct ion_heap *heap)
+{
+	struct imx_ocram_heap *ocram = to_ocram_heap(heap);
+
+	gen_pool_destroy(ocram->pool);
+	gen_pool_free(ocram->sram, ocram->sram_vaddr, ocram->sram_size);
+	kfree(ocram);
+}
+
+static void imx_ion_destroy_heaps(struct imx_ion *imx)
+{
+	struct ion_heap *heap;
+	int i;
+
+	for (i = 0; i < IMX_ION_HEAP_NUM; i++) {
+		heap = imx->heaps[i];
+		if (heap && heap->type == ION_HEAP_TYPE_CUSTOM)
+			imx_ocram_heap_destroy(heap);
+		else
+			ion_heap_destroy(heap);
+	}
+}
+
+static int imx_ion_parse_carveout(struct device_node *np,
+				  struct ion_platform_heap *data)
+{
+	struct device_node *node;
+	struct resource res;
+	int ret;
+
+	node = of_parse_phandle(np, "fsl,carveout", 0);
+	if (!node)
+		return -ENOENT;
+	ret = of_address_to_resource(node, 0, &res);
+	of_node_put(node);
+	if (ret)
+		return ret;
+
+	data->base = res.start;
+	data->size = resource_size(&res);
+	return 0;
+}
+
+static int imx_ion_probe(struct platform_device *pdev)
+{
+	struct device_node *np = pdev->dev.of_node;
+	struct ion_platform_heap data;
+	struct gen_pool *sram;
+	struct imx_ion *imx;
+	struct ion_heap *heap;
+	u32 ocram_size;
+	int ret, i;
+
+	imx = devm_kzalloc(&pdev->dev, sizeof(*imx), GFP_KERNEL);
+	if (!imx)
+		return -ENOMEM;
+
+	/* the OCRAM pool comes from the sram driver, wait for it */
+	sram = NULL;
+	if (of_find_property(np, "fsl,ocram", NULL)) {
+		sram = of_get_named_gen_pool(np, "fsl,ocram", 0);
+		if (!sram)
+			return -EPROBE_DEFER;
+		if (of_property_read_u32(np, "fsl,ocram-size", &ocram_size) ||
+		    !ocram_size) {
+			dev_err(&pdev->dev, "fsl,ocram needs fsl,ocram-size\n");
+			return -EINVAL;
+		}
+	}
+
+	/* a dedicated CMA area, the default one otherwise */
+	ret = of_reserved_mem_device_init(&pdev->dev);
+	if (ret && ret != -ENODEV)
+		dev_warn(&pdev->dev, "using the default CMA area: %d\n", ret);
+
+	memset(&data, 0, sizeof(data));
+	data.type = ION_HEAP_TYPE_DMA;
+	data.id = IMX_ION_HEAP_CMA;
+	data.name = "cma";
+	data.priv = &pdev->dev;
+	heap = ion_heap_create(&data);
+	if (IS_ERR(heap)) {
+		ret = PTR_ERR(heap);
+		goto err;
+	}
+	imx->heaps[IMX_ION_HEAP_CMA] = heap;
+
+	memset(&data, 0, sizeof(data));
+	if (!imx_ion_parse_carveout(np, &data)) {
+		data.type = ION_HEAP_TYPE_CARVEOUT;
+		data.id = IMX_ION_HEAP_CARVEOUT;
+		data.name = "carveout";
+		heap = ion_heap_create(&data);
+		if (IS_ERR(heap)) {
+			ret = PTR_ERR(heap);
+			goto err;
+		}
+		imx->heaps[IMX_ION_HEAP_CARVEOUT] = heap;
+	}
+
+	if (sram) {
+		heap = imx_ocram_heap_create(sram, PAGE_ALIGN(ocram_size));
+		if (IS_ERR(heap)) {
+			ret = PTR_ERR(heap);
+			goto err;
+		}
+		imx->heaps[IMX_ION_HEAP_OCRAM] = heap;
+	}
+
+	imx->idev = ion_device_create(NULL);
+	if (IS_ERR_OR_NULL(imx->idev)) {
+		ret = imx->idev ? PTR_ERR(imx->idev) : -ENOMEM;
+		goto err;
+	}
+
+	for (i = 0; i < IMX_ION_HEAP_NUM; i++)
+		if (imx->heaps[i])
+			ion_device_add_heap(imx->idev, imx->heaps[i]);
+
+	platform_set_drvdata(pdev, imx);
+	return 0;
+
+err:
+	imx_ion_destroy_heaps(imx);
+	of_reserved_mem_device_release(&pdev->dev);
+	return ret;
+}
+
+static int imx_ion_remove(struct platform_device *pdev)
+{
+	struct imx_ion *imx = platform_get_drvdata(pdev);
+
+	ion_device_destroy(imx->idev);
+	imx_ion_destroy_heaps(imx);
+	of_reserved_mem_device_release(&pdev->dev);
+	return 0;
+}
+
+static const struct of_device_id imx_ion_dt_ids[] = {
+	{ .compatible = "fsl,imx-ion", },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, imx_ion_dt_ids);
+
+static struct platform_driver imx_ion_driver = {
+	.probe = imx_ion_probe,
+	.remove = imx_ion_remove,
+	.driver = {
+		.name = "ion-imx",
+		.of_match_table = imx_ion_dt_ids,
+	},
+};
+
+module_platform_driver(imx_ion_driver);
+
+MODULE_DESCRIPTION("i.MX ion heaps");
+MODULE_LICENSE("GPL v2");
@@ -20,6 +20,7 @@
 #include <linux/errno.h>
 #include <linux/err.h>
 #include <linux/dma-mapping.h>
+#include <linux/dma-contiguous.h>
 
 #include "ion.h"
 #include "ion_priv.h"
@@ -35,10 +36,50 @@ struct ion_cma_heap {
 
 struct ion_cma_buffer_info {
 	void *cpu_addr;
+	struct page *pages;	/* cached buffers only */
 	dma_addr_t handle;
 	struct sg_table *table;
 };
 
+/*
+ * Cached buffers are taken straight from the CMA area so that they keep
+ * the cacheable kernel mapping, instead of dma_alloc_coherent() which
+ * remaps them write-combined.  The ion core then syncs them around device
+ * and CPU access.
+ */
+static int ion_cma_allocate_cached(struct device *dev,
+				   struct ion_cma_buffer_info *info,
+				   unsigned long len)
+{
+	int nr_pages = PAGE_ALIGN(len) >> PAGE_SHIFT;
+	int ret;
+
+	info->pages = dma_alloc_from_contiguous(dev, nr_pages, 0);
+	if (!info->pages)
+		return -ENOMEM;
+
+	/*
+	 * Write back and drop whatever the previous owner left in the
+	 * cacheable alias first, so that it cannot land on top of the zeroes.
+	 */
+	ion_pages_sync_for_device(NULL, info->pages, len, DMA_BIDIRECTIONAL);
+	ret = ion_heap_pages_zero(info->pages, len,
+				  pgprot_writecombine(PAGE_KERNEL));
+	if (ret)
+		goto free_pages;
+
+	ret = sg_alloc_table(info->table, 1, GFP_KERNEL);
+	if (ret)
+		goto free_pages;
+	sg_set_page(info->table->sgl, info->pages, len, 0);
+	info->handle = page_to_phys(info->pages);
+	return 0;
+
+free_pages:
+	dma_release_from_contiguous(dev, info->pages, nr_pages);
+	return ret;
+}
+
 
 /* ION CMA heap operations functions */
 static int ion_cma_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
@@ -51,9 +92,6 @@ static int ion_cma_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
 
 	dev_dbg(dev, "Request buffer allocation len %ld\n", len);
 
-	if (buffer->flags & ION_FLAG_CACHED)
-		return -EINVAL;
-
 	if (align > PAGE_SIZE)
 		return -EINVAL;
 
@@ -61,6 +99,19 @@ static int ion_cma_allocate(struct ion_heap *heap, struct ion_buffer *buffer,
 	if (!info)
 		return ION_CMA_ALLOCATE_FAILED;
 
+	if (buffer->flags & ION_FLAG_CACHED) {
+		info->table = kmalloc(sizeof(struct sg_table), GFP_KERNEL);
+		if (!info->table)
+			goto err;
+		if (ion_cma_allocate_cached(dev, info, len)) {
+			dev_err(dev, "Fail to allocate cached buffer\n");
+			kfree(info->table);
+			goto err;
+		}
+		buffer->priv_virt = info;
+		return 0;
+	}
+
 	info->cpu_addr = dma_alloc_coherent(dev, len, &(info->handle),
 						GFP_HIGHUSER | __GFP_ZERO);
 
@@ -98,7 +149,12 @@ static void ion_cma_free(struct ion_buffer *buffer)
 
 	dev_dbg(dev, "Release buffer %p\n", buffer);
 	/* release memory */
-	dma_free_coherent(dev, buffer->size, info->cpu_addr, info->handle);
+	if (info->pages)
+		dma_release_from_contiguous(dev, info->pages,
+					    PAGE_ALIGN(buffer->size) >> PAGE_SHIFT);
+	else
+		dma_free_coherent(dev, buffer->size, info->cpu_addr,
+				  info->handle);
 	/* release sg table */
 	sg_free_table(info->table);
 	kfree(info->table);
@@ -142,6 +198,9 @@ static int ion_cma_mmap(struct ion_heap *mapper, struct ion_buffer *buffer,
 	struct device *dev = cma_heap->dev;
 	struct ion_cma_buffer_info *info = buffer->priv_virt;
 
+	if (info->pages)
+		return ion_heap_map_user(mapper, buffer, vma);
+
 	return dma_mmap_coherent(dev, vma, info->cpu_addr, info->handle,
 				 buffer->size);
 }
@@ -150,6 +209,9 @@ static void *ion_cma_map_kernel(struct ion_heap *heap,
 				struct ion_buffer *buffer)
 {
 	struct ion_cma_buffer_info *info = buffer->priv_virt;
+
+	if (info->pages)
+		return ion_heap_map_kernel(heap, buffer);
 	/* kernel memory mapping has been done at allocation time */
 	return info->cpu_addr;
 }
@@ -157,6 +219,10 @@ static void *ion_cma_map_kernel(struct ion_heap *heap,
 static void ion_cma_unmap_kernel(struct ion_heap *heap,
 					struct ion_buffer *buffer)
 {
+	struct ion_cma_buffer_info *info = buffer->priv_virt;
+
+	if (info->pages)
+		ion_heap_unmap_kernel(heap, buffer);
 }
 
 static struct ion_heap_ops ion_cma_ops = {
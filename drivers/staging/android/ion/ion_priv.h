@@ -127,6 +127,11 @@ struct ion_heap_ops {
  * heap flags - flags between the heaps and core ion code
  */
 #define ION_HEAP_FLAG_DEFER_FREE (1 << 0)
+/*
+ * Heap memory has no struct page behind it (on-chip SRAM): the heap fills
+ * in sg_dma_address itself, and its buffers are never cached.
+ */
+#define ION_HEAP_FLAG_NO_PAGES (1 << 1)
 
 /**
  * private flags - flags internal to ion
@@ -17,6 +17,14 @@
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
  *
+ * With CONFIG_ANDROID_LOW_MEMORY_KILLER_VMPRESSURE the thresholds are only
+ * checked once global vmpressure reaches vmpressure_level percent (0 goes
+ * back to the shrinker), from the vmpressure work rather than from within
+ * reclaim.  The victim then comes from a tree of processes sorted by
+ * oom_score_adj, which is kept up to date on fork, exit and oom_score_adj
+ * writes, so only its head needs looking at.  Kill counts, decision
+ * latency and the memory of the victims are in debugfs/lowmemorykiller.
+ *
  * Copyright (C) 2007-2008 Google, Inc.
  *
  * This software is licensed under the terms of the GNU General Public
@@ -41,6 +49,12 @@
 #include <linux/rcupdate.h>
 #include <linux/profile.h>
 #include <linux/notifier.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/rbtree.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/vmpressure.h>
 
 static uint32_t lowmem_debug_level = 1;
 static short lowmem_adj[6] = {
@@ -66,6 +80,325 @@ static unsigned long lowmem_deathpending_timeout;
 			pr_info(x);			\
 	} while (0)
 
+#define LOWMEM_RECENT_KILLS	16
+
+struct lowmem_kill_info {
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+	short adj;
+	int rss;		/* pages */
+	unsigned int pressure;
+	u32 latency_us;		/* from the vmpressure report to SIGKILL */
+};
+
+static struct {
+	unsigned long kills;
+	unsigned long shrinker_kills;
+	unsigned long events;	/* reports at or over vmpressure_level */
+	u64 latency_us_total;
+	u32 latency_us_max;
+	unsigned long rss_killed;
+	struct lowmem_kill_info recent[LOWMEM_RECENT_KILLS];
+	unsigned int next;
+} lowmem_stats;
+static DEFINE_SPINLOCK(lowmem_stats_lock);
+
+/* Returns the lowest oom_score_adj to kill at, OOM_SCORE_ADJ_MAX + 1 if none */
+static short lowmem_min_adj(int *other_free, int *other_file)
+{
+	int array_size = ARRAY_SIZE(lowmem_adj);
+	int i;
+
+	*other_free = global_page_state(NR_FREE_PAGES) - totalreserve_pages;
+	*other_file = global_page_state(NR_FILE_PAGES) -
+					global_page_state(NR_SHMEM) -
+					total_swapcache_pages();
+
+	if (lowmem_adj_size < array_size)
+		array_size = lowmem_adj_size;
+	if (lowmem_minfree_size < array_size)
+		array_size = lowmem_minfree_size;
+	for (i = 0; i < array_size; i++) {
+		if (*other_free < lowmem_minfree[i] &&
+		    *other_file < lowmem_minfree[i])
+			return lowmem_adj[i];
+	}
+	return OOM_SCORE_ADJ_MAX + 1;
+}
+
+static void lowmem_kill(struct task_struct *selected, short adj, int size)
+{
+	lowmem_print(1, "send sigkill to %d (%s), adj %hd, size %d\n",
+		     selected->pid, selected->comm, adj, size);
+	lowmem_deathpending_timeout = jiffies + HZ;
+	/*
+	 * FIXME: lowmemorykiller shouldn't abuse global OOM killer
+	 * infrastructure. There is no real reason why the selected
+	 * task should have access to the memory reserves.
+	 */
+	mark_tsk_oom_victim(selected);
+	send_sig(SIGKILL, selected, 0);
+}
+
+static void lowmem_account_kill(struct task_struct *selected, short adj,
+				int size, unsigned int pressure, ktime_t start)
+{
+	struct lowmem_kill_info *info;
+	unsigned long flags;
+	u32 latency_us;
+
+	spin_lock_irqsave(&lowmem_stats_lock, flags);
+	lowmem_stats.kills++;
+	lowmem_stats.rss_killed += size;
+	if (!ktime_to_ns(start)) {
+		lowmem_stats.shrinker_kills++;
+		spin_unlock_irqrestore(&lowmem_stats_lock, flags);
+		return;
+	}
+
+	latency_us = ktime_us_delta(ktime_get(), start);
+	lowmem_stats.latency_us_total += latency_us;
+	lowmem_stats.latency_us_max = max(lowmem_stats.latency_us_max,
+					  latency_us);
+
+	info = &lowmem_stats.recent[lowmem_stats.next++ % LOWMEM_RECENT_KILLS];
+	info->pid = task_tgid_nr(selected);
+	memcpy(info->comm, selected->comm, TASK_COMM_LEN);
+	info->adj = adj;
+	info->rss = size;
+	info->pressure = pressure;
+	info->latency_us = latency_us;
+	spin_unlock_irqrestore(&lowmem_stats_lock, flags);
+}
+
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_VMPRESSURE
+/* how many of the highest oom_score_adj processes are compared by size */
+#define LOWMEM_CANDIDATES	8
+
+static unsigned int lowmem_vmpressure_level = 90;
+
+static DEFINE_SPINLOCK(lowmem_adj_lock);
+static struct rb_root lowmem_adj_tree = RB_ROOT;
+
+/* Highest lowmem_adj leftmost, ties in insertion order */
+static void __lowmem_adj_insert(struct task_struct *tsk)
+{
+	struct rb_node **link = &lowmem_adj_tree.rb_node;
+	struct rb_node *parent = NULL;
+	short adj = tsk->signal->oom_score_adj;
+	struct task_struct *t;
+
+	while (*link) {
+		parent = *link;
+		t = rb_entry(parent, struct task_struct, lowmem_node);
+		if (adj > t->lowmem_adj)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	tsk->lowmem_adj = adj;
+	rb_link_node(&tsk->lowmem_node, parent, link);
+	rb_insert_color(&tsk->lowmem_node, &lowmem_adj_tree);
+}
+
+void lowmem_adj_insert(struct task_struct *tsk)
+{
+	unsigned long flags;
+
+	if (tsk->flags & PF_KTHREAD)
+		return;
+
+	/* exec inserts again, for tasks forked by a kernel thread */
+	spin_lock_irqsave(&lowmem_adj_lock, flags);
+	if (RB_EMPTY_NODE(&tsk->lowmem_node))
+		__lowmem_adj_insert(tsk);
+	spin_unlock_irqrestore(&lowmem_adj_lock, flags);
+}
+
+void lowmem_adj_remove(struct task_struct *tsk)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&lowmem_adj_lock, flags);
+	if (!RB_EMPTY_NODE(&tsk->lowmem_node)) {
+		rb_erase(&tsk->lowmem_node, &lowmem_adj_tree);
+		RB_CLEAR_NODE(&tsk->lowmem_node);
+	}
+	spin_unlock_irqrestore(&lowmem_adj_lock, flags);
+}
+
+void lowmem_adj_changed(struct task_struct *tsk)
+{
+	struct task_struct *leader;
+	unsigned long flags;
+
+	/* keeps the leader from being unhashed, or replaced by exec */
+	read_lock(&tasklist_lock);
+	leader = tsk->group_leader;
+	spin_lock_irqsave(&lowmem_adj_lock, flags);
+	if (!RB_EMPTY_NODE(&leader->lowmem_node) &&
+	    leader->lowmem_adj != leader->signal->oom_score_adj) {
+		rb_erase(&leader->lowmem_node, &lowmem_adj_tree);
+		__lowmem_adj_insert(leader);
+	}
+	spin_unlock_irqrestore(&lowmem_adj_lock, flags);
+	read_unlock(&tasklist_lock);
+}
+
+/*
+ * Collect up to LOWMEM_CANDIDATES leaders that can still be killed.
+ * Exiting ones are passed over so that they don't take up the slots
+ * of live processes further down the tree; they are giving their
+ * memory back already.  Returns -EBUSY while the last victim is
+ * still within its grace period.
+ */
+static int lowmem_get_candidates(short min_score_adj,
+				 struct task_struct **cand)
+{
+	struct task_struct *p, *t;
+	struct rb_node *node;
+	bool dying = false;
+	int n = 0;
+
+	rcu_read_lock();
+	spin_lock_irq(&lowmem_adj_lock);
+	for (node = rb_first(&lowmem_adj_tree);
+	     node && n < LOWMEM_CANDIDATES; node = rb_next(node)) {
+		p = rb_entry(node, struct task_struct, lowmem_node);
+		if (p->lowmem_adj < min_score_adj)
+			break;
+		if (test_tsk_thread_flag(p, TIF_MEMDIE)) {
+			if (time_before_eq(jiffies,
+					   lowmem_deathpending_timeout)) {
+				dying = true;
+				break;
+			}
+			continue;
+		}
+		/* the leader may be gone while its other threads still run */
+		if (p->signal->flags & SIGNAL_GROUP_EXIT)
+			continue;
+		t = find_lock_task_mm(p);
+		if (!t)
+			continue;
+		task_unlock(t);
+		get_task_struct(p);
+		cand[n++] = p;
+	}
+	spin_unlock_irq(&lowmem_adj_lock);
+	rcu_read_unlock();
+
+	if (dying) {
+		while (n--)
+			put_task_struct(cand[n]);
+		return -EBUSY;
+	}
+	return n;
+}
+
+static void lowmem_vmpressure_kill(unsigned int pressure)
+{
+	struct task_struct *cand[LOWMEM_CANDIDATES];
+	struct task_struct *selected = NULL;
+	short selected_oom_score_adj = 0;
+	int selected_tasksize = 0;
+	int other_free, other_file;
+	short min_score_adj;
+	ktime_t start;
+	int i, n;
+
+	start = ktime_get();
+	spin_lock_irq(&lowmem_stats_lock);
+	lowmem_stats.events++;
+	spin_unlock_irq(&lowmem_stats_lock);
+
+	min_score_adj = lowmem_min_adj(&other_free, &other_file);
+	lowmem_print(3, "vmpressure %u, ofree %d %d, ma %hd\n",
+		     pressure, other_free, other_file, min_score_adj);
+	if (min_score_adj == OOM_SCORE_ADJ_MAX + 1)
+		return;
+
+	n = lowmem_get_candidates(min_score_adj, cand);
+	if (n < 0)
+		return;
+
+	rcu_read_lock();
+	for (i = 0; i < n; i++) {
+		struct task_struct *p;
+		short oom_score_adj;
+		int tasksize;
+
+		p = find_lock_task_mm(cand[i]);
+		if (!p)
+			continue;
+
+		if (test_tsk_thread_flag(p, TIF_MEMDIE) &&
+		    time_before_eq(jiffies, lowmem_deathpending_timeout)) {
+			task_unlock(p);
+			selected = NULL;
+			break;
+		}
+		oom_score_adj = p->signal->oom_score_adj;
+		tasksize = get_mm_rss(p->mm);
+		task_unlock(p);
+		if (oom_score_adj < min_score_adj || tasksize <= 0)
+			continue;
+		if (selected) {
+			if (oom_score_adj < selected_oom_score_adj)
+				continue;
+			if (oom_score_adj == selected_oom_score_adj &&
+			    tasksize <= selected_tasksize)
+				continue;
+		}
+		selected = p;
+		selected_tasksize = tasksize;
+		selected_oom_score_adj = oom_score_adj;
+		lowmem_print(2, "select %d (%s), adj %hd, size %d, to kill\n",
+			     p->pid, p->comm, oom_score_adj, tasksize);
+	}
+	if (selected) {
+		lowmem_kill(selected, selected_oom_score_adj,
+			    selected_tasksize);
+		lowmem_account_kill(selected, selected_oom_score_adj,
+				    selected_tasksize, pressure, start);
+	}
+	rcu_read_unlock();
+
+	for (i = 0; i < n; i++)
+		put_task_struct(cand[i]);
+}
+
+static int lowmem_vmpressure_notify(struct notifier_block *nb,
+				    unsigned long pressure, void *data)
+{
+	unsigned int level = READ_ONCE(lowmem_vmpressure_level);
+
+	if (!level || pressure < level)
+		return NOTIFY_DONE;
+
+	lowmem_vmpressure_kill(pressure);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lowmem_vmpressure_nb = {
+	.notifier_call = lowmem_vmpressure_notify,
+};
+
+static inline bool lowmem_use_vmpressure(void)
+{
+	return READ_ONCE(lowmem_vmpressure_level);
+}
+
+module_param_named(vmpressure_level, lowmem_vmpressure_level, uint,
+		   S_IRUGO | S_IWUSR);
+#else
+static inline bool lowmem_use_vmpressure(void)
+{
+	return false;
+}
+#endif /* CONFIG_ANDROID_LOW_MEMORY_KILLER_VMPRESSURE */
+
 static unsigned long lowmem_count(struct shrinker *s,
 				  struct shrink_control *sc)
 {
@@ -81,27 +414,16 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 	struct task_struct *selected = NULL;
 	unsigned long rem = 0;
 	int tasksize;
-	int i;
-	short min_score_adj = OOM_SCORE_ADJ_MAX + 1;
+	short min_score_adj;
 	int selected_tasksize = 0;
 	short selected_oom_score_adj;
-	int array_size = ARRAY_SIZE(lowmem_adj);
-	int other_free = global_page_state(NR_FREE_PAGES) - totalreserve_pages;
-	int other_file = global_page_state(NR_FILE_PAGES) -
-						global_page_state(NR_SHMEM) -
-						total_swapcache_pages();
+	int other_free, other_file;
 
-	if (lowmem_adj_size < array_size)
-		array_size = lowmem_adj_size;
-	if (lowmem_minfree_size < array_size)
-		array_size = lowmem_minfree_size;
-	for (i = 0; i < array_size; i++) {
-		if (other_free < lowmem_minfree[i] &&
-		    other_file < lowmem_minfree[i]) {
-			min_score_adj = lowmem_adj[i];
-			break;
-		}
-	}
+	/* the vmpressure notifier takes the decisions then */
+	if (lowmem_use_vmpressure())
+		return 0;
+
+	min_score_adj = lowmem_min_adj(&other_free, &other_file);
 
 	lowmem_print(3, "lowmem_scan %lu, %x, ofree %d %d, ma %hd\n",
 			sc->nr_to_scan, sc->gfp_mask, other_free,
@@ -156,17 +478,10 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 			     p->pid, p->comm, oom_score_adj, tasksize);
 	}
 	if (selected) {
-		lowmem_print(1, "send sigkill to %d (%s), adj %hd, size %d\n",
-			     selected->pid, selected->comm,
-			     selected_oom_score_adj, selected_tasksize);
-		lowmem_deathpending_timeout = jiffies + HZ;
-		/*
-		 * FIXME: lowmemorykiller shouldn't abuse global OOM killer
-		 * infrastructure. There is no real reason why the selected
-		 * task should have access to the memory reserves.
-		 */
-		mark_tsk_oom_victim(selected);
-		send_sig(SIGKILL, selected, 0);
+		lowmem_kill(selected, selected_oom_score_adj,
+			    selected_tasksize);
+		lowmem_account_kill(selected, selected_oom_score_adj,
+				    selected_tasksize, 0, ktime_set(0, 0));
 		rem += selected_tasksize;
 	}
 
@@ -182,14 +497,69 @@ static struct shrinker lowmem_shrinker = {
 	.seeks = DEFAULT_SEEKS * 16
 };
 
+static int lowmem_stats_show(struct seq_file *s, void *unused)
+{
+	struct lowmem_kill_info *info;
+	unsigned long kills;
+	unsigned int i, n;
+
+	spin_lock_irq(&lowmem_stats_lock);
+	kills = lowmem_stats.kills - lowmem_stats.shrinker_kills;
+	seq_printf(s, "kills: %lu (%lu from the shrinker)\n",
+		   lowmem_stats.kills, lowmem_stats.shrinker_kills);
+	seq_printf(s, "vmpressure events: %lu\n", lowmem_stats.events);
+	seq_printf(s, "decision latency: avg %llu us, max %u us\n",
+		   kills ? div_u64(lowmem_stats.latency_us_total, kills) : 0,
+		   lowmem_stats.latency_us_max);
+	seq_printf(s, "victim rss: %lu kB\n",
+		   lowmem_stats.rss_killed << (PAGE_SHIFT - 10));
+
+	seq_puts(s, "\n  pid comm             adj   rss_kB pressure latency_us\n");
+	n = min_t(unsigned int, lowmem_stats.next, LOWMEM_RECENT_KILLS);
+	for (i = 0; i < n; i++) {
+		info = &lowmem_stats.recent[(lowmem_stats.next - 1 - i) %
+					    LOWMEM_RECENT_KILLS];
+		seq_printf(s, "%5d %-16s %4hd %8lu %7u%% %10u\n",
+			   info->pid, info->comm, info->adj,
+			   (unsigned long)info->rss << (PAGE_SHIFT - 10),
+			   info->pressure, info->latency_us);
+	}
+	spin_unlock_irq(&lowmem_stats_lock);
+
+	return 0;
+}
+
+static int lowmem_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lowmem_stats_show, inode->i_private);
+}
+
+static const struct file_operations lowmem_stats_fops = {
+	.open		= lowmem_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *lowmem_debugfs;
+
 static int __init lowmem_init(void)
 {
 	register_shrinker(&lowmem_shrinker);
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_VMPRESSURE
+	vmpressure_register_notifier(&lowmem_vmpressure_nb);
+#endif
+	lowmem_debugfs = debugfs_create_file("lowmemorykiller", S_IRUGO, NULL,
+					     NULL, &lowmem_stats_fops);
 	return 0;
 }
 
 static void __exit lowmem_exit(void)
 {
+	debugfs_remove(lowmem_debugfs);
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_VMPRESSURE
+	vmpressure_unregister_notifier(&lowmem_vmpressure_nb);
+#endif
 	unregister_shrinker(&lowmem_shrinker);
 }
 
@@ -254,3 +254,31 @@ int fbtft_write_vmem16_bus16(struct fbtft_par *par, size_t offset, size_t len)
 	return par->fbtftops.write(par, vmem16, len);
 }
 EXPORT_SYMBOL(fbtft_write_vmem16_bus16);
+
+/*
+ * 16 bit pixel over 8-bit SPI, sent as 16-bit words straight from video
+ * memory: the controller shifts each word out MSB first, which is the
+ * byte order the display wants, so there is no byteswapping copy through
+ * txbuf.  The whole range goes out in one transfer, which the SPI core
+ * maps for DMA when the master supports it.
+ */
+int fbtft_write_vmem16_spi16(struct fbtft_par *par, size_t offset, size_t len)
+{
+	struct spi_transfer t = {
+		.tx_buf = par->info->screen_base + offset,
+		.len = len,
+		.bits_per_word = 16,
+	};
+	struct spi_message m;
+
+	fbtft_par_dbg(DEBUG_WRITE_VMEM, par, "%s(offset=%zu, len=%zu)\n",
+		__func__, offset, len);
+
+	if (par->gpio.dc != -1)
+		gpio_set_value(par->gpio.dc, 1);
+
+	spi_message_init(&m);
+	spi_message_add_tail(&t, &m);
+	return spi_sync(par->spi, &m);
+}
+EXPORT_SYMBOL(fbtft_write_vmem16_spi16);
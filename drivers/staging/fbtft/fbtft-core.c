@@ -461,6 +461,31 @@ static void fbtft_mkdirty(struct fb_info *info, int y, int height)
 	schedule_delayed_work(&info->deferred_work, fbdefio->delay);
 }
 
+/*
+ * Update one run of dirty lines, taking in the lines marked dirty by the
+ * fb_ops drawing functions if they touch it.
+ */
+static void fbtft_update_run(struct fbtft_par *par, unsigned start,
+			     unsigned end, unsigned *dirty_start,
+			     unsigned *dirty_end)
+{
+	if (*dirty_start <= *dirty_end &&
+	    *dirty_start <= end + 1 && *dirty_end + 1 >= start) {
+		start = min(start, *dirty_start);
+		end = max(end, *dirty_end);
+		/* consumed */
+		*dirty_start = par->info->var.yres - 1;
+		*dirty_end = 0;
+	}
+
+	par->fbtftops.update_display(par, start, end);
+}
+
+/*
+ * The page list is sorted, so pages that were written to are coalesced
+ * into runs of consecutive lines and each run is sent on its own: the
+ * clean lines between two dirty areas are not sent at all.
+ */
 static void fbtft_deferred_io(struct fb_info *info, struct list_head *pagelist)
 {
 	struct fbtft_par *par = info->par;
@@ -468,6 +493,7 @@ static void fbtft_deferred_io(struct fb_info *info, struct list_head *pagelist)
 	struct page *page;
 	unsigned long index;
 	unsigned y_low = 0, y_high = 0;
+	unsigned run_start = 0, run_end = 0;
 	int count = 0;
 
 	spin_lock(&par->dirty_lock);
@@ -489,14 +515,24 @@ static void fbtft_deferred_io(struct fb_info *info, struct list_head *pagelist)
 			page->index, y_low, y_high);
 		if (y_high > info->var.yres - 1)
 			y_high = info->var.yres - 1;
-		if (y_low < dirty_lines_start)
-			dirty_lines_start = y_low;
-		if (y_high > dirty_lines_end)
-			dirty_lines_end = y_high;
+		if (count > 1 && y_low <= run_end + 1) {
+			run_end = max(run_end, y_high);
+			continue;
+		}
+		if (count > 1)
+			fbtft_update_run(par, run_start, run_end,
+					 &dirty_lines_start, &dirty_lines_end);
+		run_start = y_low;
+		run_end = y_high;
 	}
 
-	par->fbtftops.update_display(info->par,
-					dirty_lines_start, dirty_lines_end);
+	if (count)
+		fbtft_update_run(par, run_start, run_end,
+				 &dirty_lines_start, &dirty_lines_end);
+
+	if (dirty_lines_start <= dirty_lines_end)
+		par->fbtftops.update_display(par, dirty_lines_start,
+					     dirty_lines_end);
 }
 
 
@@ -1423,6 +1459,12 @@ int fbtft_probe_common(struct fbtft_display *display,
 	else if (display->buswidth == 16)
 		par->fbtftops.write_vmem = fbtft_write_vmem16_bus16;
 
+	/* 16-bit words over a DMA capable SPI master need no byteswapping */
+	if (dma && par->spi && display->buswidth == 8 && !par->startbyte &&
+	    par->info->var.bits_per_pixel == 16 && par->spi->master->can_dma &&
+	    (par->spi->master->bits_per_word_mask & SPI_BPW_MASK(16)))
+		par->fbtftops.write_vmem = fbtft_write_vmem16_spi16;
+
 	/* GPIO write() functions */
 	if (par->pdev) {
 		if (display->buswidth == 8)
@@ -93,7 +93,12 @@ enum imx_thermal_trip {
  * that will trigger cooling action when crossed.
  */
 #define IMX_TEMP_PASSIVE		85000
-#define IMX_TEMP_PASSIVE_COOL_DELTA	10000
+/* cooling is released one step at a time below trip - IMX_TEMP_PASSIVE_HYST */
+#define IMX_TEMP_PASSIVE_HYST		2000
+/* jump to full cooling this close to the critical trip */
+#define IMX_TEMP_CRITICAL_MARGIN	5000
+/* samples ahead the temperature slope is extrapolated */
+#define IMX_TREND_LOOKAHEAD		2
 
 #define IMX_POLLING_DELAY		2000 /* millisecond */
 #define IMX_PASSIVE_DELAY		1000
@@ -185,6 +190,10 @@ static struct thermal_soc_data thermal_imx6sx_data = {
 	.panic_alarm_ctrl = TEMPSENSE2,
 	.panic_alarm_mask = TEMPSENSE2_PANIC_VALUE_MASK,
 	.panic_alarm_shift = TEMPSENSE2_PANIC_VALUE_SHIFT,
+
+	.low_alarm_ctrl = TEMPSENSE2,
+	.low_alarm_mask = TEMPSENSE2_LOW_VALUE_MASK,
+	.low_alarm_shift = TEMPSENSE2_LOW_VALUE_SHIFT,
 };
 
 static struct thermal_soc_data thermal_imx7d_data = {
@@ -226,6 +235,7 @@ struct imx_thermal_data {
 	unsigned long temp_passive;
 	unsigned long temp_critical;
 	unsigned long alarm_temp;
+	unsigned long low_alarm_temp;
 	unsigned long last_temp;
 	bool irq_enabled;
 	int irq;
@@ -275,6 +285,34 @@ static void imx_set_alarm_temp(struct imx_thermal_data *data,
 		     alarm_value << soc_data->high_alarm_shift);
 }
 
+/*
+ * The low alarm fires when the temperature drops below low_alarm_temp, it
+ * is armed while cooling is active so that its release does not wait for
+ * the next poll. A temperature of 0 disarms it.
+ */
+static void imx_set_low_alarm_temp(struct imx_thermal_data *data,
+				   signed long low_temp)
+{
+	const struct thermal_soc_data *soc_data = data->socdata;
+	struct regmap *map = data->tempmon;
+	int low_value;
+
+	data->low_alarm_temp = low_temp;
+
+	if (!low_temp)
+		low_value = data->socdata->version == TEMPMON_IMX7 ? 0 :
+			soc_data->low_alarm_mask >> soc_data->low_alarm_shift;
+	else if (data->socdata->version == TEMPMON_IMX7)
+		low_value = low_temp / 1000 + data->c1 - 25;
+	else
+		low_value = (data->c2 - low_temp) / data->c1;
+
+	regmap_write(map, soc_data->low_alarm_ctrl + REG_CLR,
+		     soc_data->low_alarm_mask);
+	regmap_write(map, soc_data->low_alarm_ctrl + REG_SET,
+		     low_value << soc_data->low_alarm_shift);
+}
+
 static int imx_get_temp(struct thermal_zone_device *tz, unsigned long *temp)
 {
 	struct imx_thermal_data *data = tz->devdata;
@@ -357,6 +395,14 @@ static int imx_get_temp(struct thermal_zone_device *tz, unsigned long *temp)
 		}
 	}
 
+	if (soc_data->low_alarm_ctrl) {
+		if (!data->low_alarm_temp && *temp >= data->temp_passive)
+			imx_set_low_alarm_temp(data, data->temp_passive -
+					       IMX_TEMP_PASSIVE_HYST);
+		else if (data->low_alarm_temp && *temp < data->low_alarm_temp)
+			imx_set_low_alarm_temp(data, 0);
+	}
+
 	if (*temp != data->last_temp) {
 		dev_dbg(&tz->device, "millicelsius: %ld\n", *temp);
 		data->last_temp = *temp;
@@ -504,20 +550,40 @@ static int imx_unbind(struct thermal_zone_device *tz,
 	return 0;
 }
 
+/*
+ * Step the cooling devices one state, i.e. one OPP, per passive poll
+ * instead of jumping between no cooling and full cooling:
+ *  - above the trip, add a step while the temperature is not falling and
+ *    hold the current one once it does;
+ *  - below the trip, hold while the extrapolated temperature would be back
+ *    above it, and remove a step once it is also IMX_TEMP_PASSIVE_HYST
+ *    below the trip;
+ *  - close to the critical trip, apply full cooling.
+ */
 static int imx_get_trend(struct thermal_zone_device *tz,
 	int trip, enum thermal_trend *trend)
 {
-	int ret;
+	struct imx_thermal_data *data = tz->devdata;
+	long temp = tz->temperature;
+	long delta = temp - tz->last_temperature;
+	long predicted = temp + delta * IMX_TREND_LOOKAHEAD;
 	unsigned long trip_temp;
+	int ret;
 
 	ret = imx_get_trip_temp(tz, trip, &trip_temp);
 	if (ret < 0)
 		return ret;
 
-	if (tz->temperature >= (trip_temp - IMX_TEMP_PASSIVE_COOL_DELTA))
+	if (temp >= (long)data->temp_critical - IMX_TEMP_CRITICAL_MARGIN)
 		*trend = THERMAL_TREND_RAISE_FULL;
+	else if (temp >= (long)trip_temp)
+		*trend = delta >= 0 ? THERMAL_TREND_RAISING :
+				      THERMAL_TREND_STABLE;
+	else if (predicted < (long)trip_temp &&
+		 temp < (long)trip_temp - IMX_TEMP_PASSIVE_HYST)
+		*trend = THERMAL_TREND_DROPPING;
 	else
-		*trend = THERMAL_TREND_DROP_FULL;
+		*trend = THERMAL_TREND_STABLE;
 
 	return 0;
 }
@@ -854,6 +920,8 @@ static int imx_thermal_probe(struct platform_device *pdev)
 
 	if (data->socdata->version == TEMPMON_IMX6SX)
 		imx_set_panic_temp(data, data->temp_critical);
+	if (data->socdata->low_alarm_ctrl)
+		imx_set_low_alarm_temp(data, 0);
 
 	regmap_write(map, data->socdata->sensor_ctrl + REG_CLR,
 		     data->socdata->power_down_mask);
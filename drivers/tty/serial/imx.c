@@ -35,10 +35,12 @@
 #include <linux/delay.h>
 #include <linux/rational.h>
 #include <linux/slab.h>
+#include <linux/sizes.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
+#include <linux/hrtimer.h>
 
 #include <asm/irq.h>
 #include <linux/platform_data/serial-imx.h>
@@ -180,6 +182,8 @@
 
 #define UART_NR 8
 #define IMX_RXBD_NUM 20
+#define IMX_RS485_MAX_DELAY	100	/* ms */
+#define RX_BUF_SIZE	(PAGE_SIZE)
 #define IMX_MODULE_MAX_CLK_RATE	80000000
 
 /* i.MX21 type uart runs on all i.mx except i.MX1 and i.MX6q */
@@ -195,11 +199,11 @@ struct imx_uart_data {
 	enum imx_uart_type devtype;
 };
 
-struct imx_dma_bufinfo {
-	bool filled;
-	unsigned int rx_bytes;
-};
-
+/*
+ * RX runs a cyclic DMA over a ring of periods. The SDMA script closes a
+ * period early when the aging timer or the idle line detection fires,
+ * so every callback hands over exactly one period, full or not.
+ */
 struct imx_dma_rxbuf {
 	unsigned int		periods;
 	unsigned int		period_len;
@@ -208,15 +212,27 @@ struct imx_dma_rxbuf {
 	void			*buf;
 	dma_addr_t		dmaaddr;
 	unsigned int		cur_idx;
-	unsigned int		last_completed_idx;
 	dma_cookie_t		cookie;
-	struct imx_dma_bufinfo	buf_info[IMX_RXBD_NUM];
 };
 
+static unsigned int rx_dma_periods = IMX_RXBD_NUM;
+module_param(rx_dma_periods, uint, S_IRUGO);
+MODULE_PARM_DESC(rx_dma_periods, "Number of periods in the RX DMA ring (2-256)");
+
+static unsigned int rx_dma_period_len = RX_BUF_SIZE;
+module_param(rx_dma_period_len, uint, S_IRUGO);
+MODULE_PARM_DESC(rx_dma_period_len,
+		 "Size in bytes of an RX DMA period (64-32768)");
+
 struct imx_port {
 	struct uart_port	port;
 	struct timer_list	timer;
 	unsigned int		old_status;
+	/* rs485 RTS delays, run off the port lock, see imx_start_tx() */
+	struct hrtimer		rs485_before_timer;
+	struct hrtimer		rs485_after_timer;
+	unsigned int		rs485_starting:1;
+	unsigned int		rs485_stopping:1;
 	unsigned int		have_rtscts:1;
 	unsigned int		dte_mode:1;
 	unsigned int		irda_inv_rx:1;
@@ -375,6 +391,37 @@ static void imx_timeout(unsigned long data)
 	}
 }
 
+/* turn the rs485 bus around */
+static void imx_rs485_release_rts(struct imx_port *sport)
+{
+	struct uart_port *port = &sport->port;
+	unsigned long temp;
+
+	temp = readl(port->membase + UCR2);
+	if (port->rs485.flags & SER_RS485_RTS_AFTER_SEND)
+		temp &= ~UCR2_CTS;
+	else
+		temp |= UCR2_CTS;
+	writel(temp, port->membase + UCR2);
+}
+
+static enum hrtimer_restart imx_rs485_after_send(struct hrtimer *t)
+{
+	struct imx_port *sport = container_of(t, struct imx_port,
+					      rs485_after_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&sport->port.lock, flags);
+	/* imx_start_tx() clears it if more data came in meanwhile */
+	if (sport->rs485_stopping) {
+		sport->rs485_stopping = 0;
+		imx_rs485_release_rts(sport);
+	}
+	spin_unlock_irqrestore(&sport->port.lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
 /*
  * interrupts disabled on entry
  */
@@ -393,19 +440,35 @@ static void imx_stop_tx(struct uart_port *port)
 	temp = readl(port->membase + UCR1);
 	writel(temp & ~UCR1_TXMPTYEN, port->membase + UCR1);
 
-	/* in rs485 mode disable transmitter if shifter is empty */
-	if (port->rs485.flags & SER_RS485_ENABLED &&
-	    readl(port->membase + USR2) & USR2_TXDC) {
-		temp = readl(port->membase + UCR2);
-		if (port->rs485.flags & SER_RS485_RTS_AFTER_SEND)
-			temp &= ~UCR2_CTS;
-		else
-			temp |= UCR2_CTS;
-		writel(temp, port->membase + UCR2);
+	if (!(port->rs485.flags & SER_RS485_ENABLED))
+		return;
 
+	/* a start still waiting for delay_rts_before_send is off */
+	if (sport->rs485_starting) {
+		sport->rs485_starting = 0;
+		hrtimer_try_to_cancel(&sport->rs485_before_timer);
+	}
+
+	/*
+	 * In rs485 mode disable transmitter if shifter is empty.  The
+	 * delay is far too long to spin for with the port lock held,
+	 * a timer releases RTS once it has passed.
+	 */
+	if (readl(port->membase + USR2) & USR2_TXDC) {
 		temp = readl(port->membase + UCR4);
 		temp &= ~UCR4_TCEN;
 		writel(temp, port->membase + UCR4);
+
+		if (port->rs485.delay_rts_after_send > 0) {
+			if (!sport->rs485_stopping) {
+				sport->rs485_stopping = 1;
+				hrtimer_start(&sport->rs485_after_timer,
+				    ms_to_ktime(port->rs485.delay_rts_after_send),
+				    HRTIMER_MODE_REL);
+			}
+		} else {
+			imx_rs485_release_rts(sport);
+		}
 	}
 }
 
@@ -476,8 +539,20 @@ static inline void imx_transmit_buffer(struct imx_port *sport)
 			writel(temp, sport->port.membase + UCR1);
 		} else {
 			writel(temp, sport->port.membase + UCR1);
-			schedule_delayed_work(&sport->tsk_dma_tx, 0);
+			queue_delayed_work(system_lowlat_wq,
+					   &sport->tsk_dma_tx, 0);
 		}
+
+		/*
+		 * The pending bytes belong to the DMA, don't push them
+		 * again. In rs485 mode the transmitter complete irq is
+		 * re-armed by dma_tx_callback() once they are all out.
+		 */
+		if (sport->port.rs485.flags & SER_RS485_ENABLED) {
+			temp = readl(sport->port.membase + UCR4);
+			writel(temp & ~UCR4_TCEN, sport->port.membase + UCR4);
+		}
+		return;
 	}
 
 	while (!uart_circ_empty(xmit) &&
@@ -511,6 +586,17 @@ static void dma_tx_callback(void *data)
 	spin_lock_irqsave(&sport->port.lock, flags);
 	xmit->tail = (xmit->tail + sport->tx_bytes) & (UART_XMIT_SIZE - 1);
 	sport->port.icount.tx += sport->tx_bytes;
+
+	/*
+	 * In rs485 mode turn the bus around from the transmitter complete
+	 * irq, as soon as the shifter has drained the last byte.
+	 */
+	if (sport->port.rs485.flags & SER_RS485_ENABLED &&
+	    uart_circ_empty(xmit)) {
+		unsigned long temp = readl(sport->port.membase + UCR4);
+
+		writel(temp | UCR4_TCEN, sport->port.membase + UCR4);
+	}
 	spin_unlock_irqrestore(&sport->port.lock, flags);
 
 	dev_dbg(sport->port.dev, "we finish the TX DMA.\n");
@@ -519,7 +605,8 @@ static void dma_tx_callback(void *data)
 	smp_mb__after_atomic();
 	uart_write_wakeup(&sport->port);
 
-	schedule_delayed_work(&sport->tsk_dma_tx, msecs_to_jiffies(1));
+	queue_delayed_work(system_lowlat_wq, &sport->tsk_dma_tx,
+			   msecs_to_jiffies(1));
 
 	if (waitqueue_active(&sport->dma_wait)) {
 		wake_up(&sport->dma_wait);
@@ -544,7 +631,9 @@ static void dma_tx_work(struct work_struct *w)
 		return;
 
 	spin_lock_irqsave(&sport->port.lock, flags);
-	sport->tx_bytes = uart_circ_chars_pending(xmit);
+	/* RTS has not settled yet, imx_rs485_before_send() requeues us */
+	sport->tx_bytes = sport->rs485_starting ? 0 :
+		uart_circ_chars_pending(xmit);
 
 	if (sport->tx_bytes > 0) {
 		if (xmit->tail > xmit->head && xmit->head > 0) {
@@ -587,23 +676,13 @@ err_out:
 	smp_mb__after_atomic();
 }
 
-/*
- * interrupts disabled on entry
- */
-static void imx_start_tx(struct uart_port *port)
+static void __imx_start_tx(struct imx_port *sport)
 {
-	struct imx_port *sport = (struct imx_port *)port;
+	struct uart_port *port = &sport->port;
 	unsigned long temp;
 
-	if (port->rs485.flags & SER_RS485_ENABLED) {
-		/* enable transmitter and shifter empty irq */
-		temp = readl(port->membase + UCR2);
-		if (port->rs485.flags & SER_RS485_RTS_ON_SEND)
-			temp &= ~UCR2_CTS;
-		else
-			temp |= UCR2_CTS;
-		writel(temp, port->membase + UCR2);
-
+	/* with DMA, dma_tx_callback() enables it after the last byte */
+	if (port->rs485.flags & SER_RS485_ENABLED && !sport->dma_is_enabled) {
 		temp = readl(port->membase + UCR4);
 		temp |= UCR4_TCEN;
 		writel(temp, port->membase + UCR4);
@@ -625,11 +704,71 @@ static void imx_start_tx(struct uart_port *port)
 			return;
 		}
 
-		schedule_delayed_work(&sport->tsk_dma_tx, 0);
+		queue_delayed_work(system_lowlat_wq, &sport->tsk_dma_tx, 0);
 		return;
 	}
 }
 
+static enum hrtimer_restart imx_rs485_before_send(struct hrtimer *t)
+{
+	struct imx_port *sport = container_of(t, struct imx_port,
+					      rs485_before_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&sport->port.lock, flags);
+	/* imx_stop_tx() clears it if the start was called off */
+	if (sport->rs485_starting) {
+		sport->rs485_starting = 0;
+		__imx_start_tx(sport);
+	}
+	spin_unlock_irqrestore(&sport->port.lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * interrupts disabled on entry
+ */
+static void imx_start_tx(struct uart_port *port)
+{
+	struct imx_port *sport = (struct imx_port *)port;
+	unsigned long temp, ucr2;
+
+	if (port->rs485.flags & SER_RS485_ENABLED) {
+		/* RTS is still asserted, keep the bus and send right away */
+		if (sport->rs485_stopping) {
+			sport->rs485_stopping = 0;
+			hrtimer_try_to_cancel(&sport->rs485_after_timer);
+		}
+
+		/* the timer sends it all once delay_rts_before_send is over */
+		if (sport->rs485_starting)
+			return;
+
+		ucr2 = readl(port->membase + UCR2);
+		temp = ucr2;
+		if (port->rs485.flags & SER_RS485_RTS_ON_SEND)
+			temp &= ~UCR2_CTS;
+		else
+			temp |= UCR2_CTS;
+		writel(temp, port->membase + UCR2);
+
+		/*
+		 * Only wait when the transmitter was just switched on, and
+		 * not with the port lock held: leave the start to a timer.
+		 */
+		if (temp != ucr2 && port->rs485.delay_rts_before_send > 0) {
+			sport->rs485_starting = 1;
+			hrtimer_start(&sport->rs485_before_timer,
+				ms_to_ktime(port->rs485.delay_rts_before_send),
+				HRTIMER_MODE_REL);
+			return;
+		}
+	}
+
+	__imx_start_tx(sport);
+}
+
 static irqreturn_t imx_rtsint(int irq, void *dev_id)
 {
 	struct imx_port *sport = dev_id;
@@ -861,42 +1000,6 @@ static int imx_setup_ufcr(struct imx_port *sport, unsigned int mode)
 	return 0;
 }
 
-#define RX_BUF_SIZE	(PAGE_SIZE)
-static void dma_rx_push_data(struct imx_port *sport, struct tty_struct *tty,
-				unsigned int start, unsigned int end)
-{
-	unsigned int i;
-	struct tty_port *port = &sport->port.state->port;
-
-	for (i = start; i < end; i++) {
-		if (sport->rx_buf.buf_info[i].filled) {
-			tty_insert_flip_string(port, sport->rx_buf.buf + (i
-					* RX_BUF_SIZE), sport->rx_buf.buf_info[i].rx_bytes);
-			tty_flip_buffer_push(port);
-			sport->rx_buf.buf_info[i].filled = false;
-			sport->rx_buf.last_completed_idx++;
-			sport->rx_buf.last_completed_idx %= IMX_RXBD_NUM;
-			sport->port.icount.rx += sport->rx_buf.buf_info[i].rx_bytes;
-		}
-	}
-}
-
-static void dma_rx_work(struct imx_port *sport)
-{
-	struct tty_struct *tty = sport->port.state->port.tty;
-	unsigned int cur_idx = sport->rx_buf.cur_idx;
-
-	if (sport->rx_buf.last_completed_idx < cur_idx) {
-		dma_rx_push_data(sport, tty, sport->rx_buf.last_completed_idx + 1, cur_idx);
-	} else if (sport->rx_buf.last_completed_idx == (IMX_RXBD_NUM - 1)) {
-		dma_rx_push_data(sport, tty, 0, cur_idx);
-	} else {
-		dma_rx_push_data(sport, tty, sport->rx_buf.last_completed_idx + 1,
-					IMX_RXBD_NUM);
-		dma_rx_push_data(sport, tty, 0, cur_idx);
-	}
-}
-
 static void imx_rx_dma_done(struct imx_port *sport)
 {
 	sport->dma_is_rxing = 0;
@@ -920,10 +1023,12 @@ static void dma_rx_callback(void *data)
 {
 	struct imx_port *sport = data;
 	struct dma_chan	*chan = sport->dma_chan_rx;
-	struct tty_struct *tty = sport->port.state->port.tty;
+	struct tty_port *port = &sport->port.state->port;
+	struct tty_struct *tty = port->tty;
+	struct imx_dma_rxbuf *rx_buf = &sport->rx_buf;
 	struct dma_tx_state state;
-	enum dma_status status;
-	unsigned int count;
+	unsigned int count, copied;
+	void *period;
 
 	/* If we have finish the reading. we will not accept any more data. */
 	if (tty->closing) {
@@ -931,19 +1036,26 @@ static void dma_rx_callback(void *data)
 		return;
 	}
 
-	status = dmaengine_tx_status(chan, sport->rx_buf.cookie, &state);
-	count = RX_BUF_SIZE - state.residue;
-	sport->rx_buf.buf_info[sport->rx_buf.cur_idx].filled = true;
-	sport->rx_buf.buf_info[sport->rx_buf.cur_idx].rx_bytes = count;
-	sport->rx_buf.cur_idx++;
-	sport->rx_buf.cur_idx %= IMX_RXBD_NUM;
+	dmaengine_tx_status(chan, rx_buf->cookie, &state);
+	count = rx_buf->period_len - state.residue;
+	period = rx_buf->buf + rx_buf->cur_idx * rx_buf->period_len;
+	rx_buf->cur_idx++;
+	rx_buf->cur_idx %= rx_buf->periods;
 	dev_dbg(sport->port.dev, "We get %d bytes.\n", count);
 
-	if (sport->rx_buf.cur_idx == sport->rx_buf.last_completed_idx)
-		dev_err(sport->port.dev, "overwrite!\n");
+	if (!count)
+		return;
+
+	/*
+	 * Copy the period straight into the flip buffer and push it at
+	 * once: the SDMA refills it a whole ring later at the earliest.
+	 */
+	copied = tty_insert_flip_string(port, period, count);
+	sport->port.icount.rx += copied;
+	if (copied != count)
+		sport->port.icount.buf_overrun += count - copied;
 
-	if (count)
-		dma_rx_work(sport);
+	tty_flip_buffer_push(port);
 }
 
 static int start_rx_dma(struct imx_port *sport)
@@ -951,11 +1063,7 @@ static int start_rx_dma(struct imx_port *sport)
 	struct dma_chan	*chan = sport->dma_chan_rx;
 	struct dma_async_tx_descriptor *desc;
 
-	sport->rx_buf.periods = IMX_RXBD_NUM;
-	sport->rx_buf.period_len = RX_BUF_SIZE;
-	sport->rx_buf.buf_len = IMX_RXBD_NUM * RX_BUF_SIZE;
 	sport->rx_buf.cur_idx = 0;
-	sport->rx_buf.last_completed_idx = -1;
 	desc = dmaengine_prep_dma_cyclic(chan, sport->rx_buf.dmaaddr,
 		sport->rx_buf.buf_len, sport->rx_buf.period_len,
 		DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
@@ -982,7 +1090,7 @@ static void imx_uart_dma_exit(struct imx_port *sport)
 		sport->dma_chan_rx = NULL;
 
 		if (sport->rx_buf.buf) {
-			dma_free_coherent(NULL, IMX_RXBD_NUM * RX_BUF_SIZE,
+			dma_free_coherent(NULL, sport->rx_buf.buf_len,
 						(void *)sport->rx_buf.buf,
 						sport->rx_buf.dmaaddr);
 			sport->rx_buf.buf = NULL;
@@ -1001,7 +1109,7 @@ static int imx_uart_dma_init(struct imx_port *sport)
 {
 	struct dma_slave_config slave_config = {};
 	struct device *dev = sport->port.dev;
-	int ret, i;
+	int ret;
 
 	/* Prepare for RX : */
 	sport->dma_chan_rx = dma_request_slave_channel(dev, "rx");
@@ -1021,7 +1129,12 @@ static int imx_uart_dma_init(struct imx_port *sport)
 		goto err;
 	}
 
-	sport->rx_buf.buf = dma_alloc_coherent(NULL, IMX_RXBD_NUM * RX_BUF_SIZE,
+	sport->rx_buf.periods = clamp_t(unsigned int, rx_dma_periods, 2, 256);
+	sport->rx_buf.period_len = clamp_t(unsigned int, rx_dma_period_len,
+					   64, SZ_32K);
+	sport->rx_buf.buf_len = sport->rx_buf.periods *
+				sport->rx_buf.period_len;
+	sport->rx_buf.buf = dma_alloc_coherent(NULL, sport->rx_buf.buf_len,
 					&sport->rx_buf.dmaaddr, GFP_KERNEL);
 	if (!sport->rx_buf.buf) {
 		dev_err(dev, "cannot alloc DMA buffer.\n");
@@ -1029,11 +1142,6 @@ static int imx_uart_dma_init(struct imx_port *sport)
 		goto err;
 	}
 
-	for (i = 0; i < IMX_RXBD_NUM; i++) {
-		sport->rx_buf.buf_info[i].rx_bytes = 0;
-		sport->rx_buf.buf_info[i].filled = false;
-	}
-
 	/* Prepare for TX : */
 	sport->dma_chan_tx = dma_request_slave_channel(dev, "tx");
 	if (!sport->dma_chan_tx) {
@@ -1150,8 +1258,16 @@ static int imx_startup(struct uart_port *port)
 		&& !sport->dma_is_inited)
 		imx_uart_dma_init(sport);
 
-	if (sport->dma_is_inited)
+	if (sport->dma_is_inited) {
 		INIT_DELAYED_WORK(&sport->tsk_dma_tx, dma_tx_work);
+		/*
+		 * Let the flip buffers hold a full DMA ring on top of the
+		 * default 64 KiB, so a reader that falls behind at a few
+		 * Mbaud doesn't make us drop data.
+		 */
+		tty_buffer_set_limit(&port->state->port,
+				     SZ_64K + sport->rx_buf.buf_len);
+	}
 
 	spin_lock_irqsave(&sport->port.lock, flags);
 
@@ -1234,6 +1350,8 @@ static void imx_shutdown(struct uart_port *port)
 	 * Stop our timer.
 	 */
 	del_timer_sync(&sport->timer);
+	hrtimer_cancel(&sport->rs485_before_timer);
+	hrtimer_cancel(&sport->rs485_after_timer);
 
 	/*
 	 * Disable all interrupts, port and break condition.
@@ -1581,9 +1699,14 @@ static int imx_rs485_config(struct uart_port *port,
 {
 	struct imx_port *sport = (struct imx_port *)port;
 
-	/* unimplemented */
-	rs485conf->delay_rts_before_send = 0;
-	rs485conf->delay_rts_after_send = 0;
+	/*
+	 * The delays run from hrtimers, but transmission and the release
+	 * of the bus wait for them: bound them as later serial cores do.
+	 */
+	rs485conf->delay_rts_before_send =
+		min_t(__u32, rs485conf->delay_rts_before_send, IMX_RS485_MAX_DELAY);
+	rs485conf->delay_rts_after_send =
+		min_t(__u32, rs485conf->delay_rts_after_send, IMX_RS485_MAX_DELAY);
 	rs485conf->flags |= SER_RS485_RX_DURING_TX;
 
 	/* RTS is required to control the transmitter */
@@ -2008,6 +2131,12 @@ static int serial_imx_probe(struct platform_device *pdev)
 	init_timer(&sport->timer);
 	sport->timer.function = imx_timeout;
 	sport->timer.data     = (unsigned long)sport;
+	hrtimer_init(&sport->rs485_before_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	sport->rs485_before_timer.function = imx_rs485_before_send;
+	hrtimer_init(&sport->rs485_after_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL);
+	sport->rs485_after_timer.function = imx_rs485_after_send;
 
 	sport->clk_ipg = devm_clk_get(&pdev->dev, "ipg");
 	if (IS_ERR(sport->clk_ipg)) {
@@ -100,6 +100,8 @@ struct ci_hw_ep {
 	spinlock_t				*lock;
 	struct dma_pool				*td_pool;
 	struct td_node				*pending_td;
+	struct list_head			td_cache;
+	unsigned				td_cache_count;
 };
 
 enum ci_role {
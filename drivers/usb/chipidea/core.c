@@ -542,7 +542,7 @@ int hw_wait_reg(struct ci_hdrc *ci, enum ci_hw_regs reg, u32 mask,
 					mask, reg);
 			return -ETIMEDOUT;
 		}
-		msleep(20);
+		usleep_range(1000, 2000);
 	}
 
 	return 0;
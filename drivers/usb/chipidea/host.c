@@ -100,6 +100,7 @@ static int ehci_ci_reset(struct usb_hcd *hcd)
 {
 	struct device *dev = hcd->self.controller;
 	struct ci_hdrc *ci = dev_get_drvdata(dev);
+	struct ehci_hcd *ehci = hcd_to_ehci(hcd);
 	int ret;
 
 	ret = ehci_setup(hcd);
@@ -108,6 +109,14 @@ static int ehci_ci_reset(struct usb_hcd *hcd)
 
 	ci_platform_configure(ci);
 
+	/*
+	 * ehci_run() rewrites USBCMD from ehci->command; keep the interrupt
+	 * threshold the platform asked for (see "itc-setting") rather than
+	 * ehci-hcd's log2_irq_thresh, so completions can be coalesced.
+	 */
+	ehci->command &= ~(0xff << 16);
+	ehci->command |= ci->platdata->itc_setting << 16;
+
 	return ret;
 }
 
@@ -119,8 +119,16 @@ void ci_handle_id_switch(struct ci_hdrc *ci)
 		dev_dbg(ci->dev, "switching from %s to %s\n",
 			ci_role(ci)->name, ci->roles[role]->name);
 
-		/* Wait 6s ~ 9s for disconncet finish */
-		while (ci_hdrc_host_has_device(ci) && wait_count++ < 600) {
+		/*
+		 * Wait 6s ~ 9s for disconncet finish, but only while the
+		 * port still reports a connection: once the device is gone
+		 * usb_remove_hcd() disconnects the children itself, so a
+		 * dock that flips ID together with the cable does not have
+		 * to wait for hub_wq debounce before the role switch.
+		 */
+		while (ci_hdrc_host_has_device(ci) &&
+				hw_read(ci, OP_PORTSC, PORTSC_CCS) &&
+				wait_count++ < 600) {
 			enable_irq(ci->irq);
 			usleep_range(10000, 15000);
 			disable_irq_nosync(ci->irq);
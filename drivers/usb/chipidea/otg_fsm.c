@@ -639,6 +639,11 @@ static void ci_otg_start_pulse(struct otg_fsm *fsm)
 static int ci_otg_start_host(struct otg_fsm *fsm, int on)
 {
 	struct ci_hdrc	*ci = container_of(fsm, struct ci_hdrc, fsm);
+	enum ci_role role = on ? CI_ROLE_HOST : CI_ROLE_GADGET;
+
+	/* Nothing to rebuild if the controller already runs this role */
+	if (ci->role == role)
+		return 0;
 
 	if (on) {
 		ci_role_stop(ci);
@@ -18,6 +18,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/pm_runtime.h>
+#include <linux/scatterlist.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 #include <linux/usb/otg-fsm.h>
@@ -337,24 +338,79 @@ static int hw_usb_reset(struct ci_hdrc *ci)
  * UTIL block
  *****************************************************************************/
 
-static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
-			  unsigned length)
+/*
+ * Each endpoint keeps a few dTDs around so that queueing a request does
+ * not go to the dma_pool for every descriptor.  Caller holds hwep->lock.
+ */
+#define CI_TD_PREALLOC		4
+#define CI_TD_CACHE_MAX		32
+
+static struct td_node *ci_td_alloc(struct ci_hw_ep *hwep, gfp_t gfp)
 {
-	int i;
-	u32 temp;
-	struct td_node *lastnode, *node = kzalloc(sizeof(struct td_node),
-						  GFP_ATOMIC);
+	struct td_node *node;
 
+	node = kzalloc(sizeof(struct td_node), gfp);
 	if (node == NULL)
-		return -ENOMEM;
+		return NULL;
 
-	node->ptr = dma_pool_alloc(hwep->td_pool, GFP_ATOMIC,
-				   &node->dma);
+	node->ptr = dma_pool_alloc(hwep->td_pool, gfp, &node->dma);
 	if (node->ptr == NULL) {
 		kfree(node);
-		return -ENOMEM;
+		return NULL;
+	}
+	INIT_LIST_HEAD(&node->td);
+
+	return node;
+}
+
+static struct td_node *ci_td_get(struct ci_hw_ep *hwep, gfp_t gfp)
+{
+	struct td_node *node;
+
+	if (list_empty(&hwep->td_cache))
+		return ci_td_alloc(hwep, gfp);
+
+	node = list_first_entry(&hwep->td_cache, struct td_node, td);
+	list_del_init(&node->td);
+	hwep->td_cache_count--;
+
+	return node;
+}
+
+static void ci_td_put(struct ci_hw_ep *hwep, struct td_node *node)
+{
+	if (hwep->td_cache_count < CI_TD_CACHE_MAX) {
+		list_add(&node->td, &hwep->td_cache);
+		hwep->td_cache_count++;
+		return;
 	}
 
+	dma_pool_free(hwep->td_pool, node->ptr, node->dma);
+	kfree(node);
+}
+
+static void ci_td_cache_drain(struct ci_hw_ep *hwep)
+{
+	struct td_node *node, *tmpnode;
+
+	list_for_each_entry_safe(node, tmpnode, &hwep->td_cache, td) {
+		list_del(&node->td);
+		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
+		kfree(node);
+	}
+	hwep->td_cache_count = 0;
+}
+
+static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
+			  unsigned length, dma_addr_t dma)
+{
+	int i;
+	u32 temp;
+	struct td_node *lastnode, *node = ci_td_get(hwep, GFP_ATOMIC);
+
+	if (node == NULL)
+		return -ENOMEM;
+
 	memset(node->ptr, 0, sizeof(struct ci_hw_td));
 	node->ptr->token = cpu_to_le32(length << __ffs(TD_TOTAL_BYTES));
 	node->ptr->token &= cpu_to_le32(TD_TOTAL_BYTES);
@@ -368,7 +424,7 @@ static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
 		node->ptr->token |= mul << __ffs(TD_MULTO);
 	}
 
-	temp = (u32) (hwreq->req.dma + hwreq->req.actual);
+	temp = (u32) dma;
 	if (length) {
 		node->ptr->page[0] = cpu_to_le32(temp);
 		for (i = 1; i < TD_PAGE_COUNT; i++) {
@@ -378,8 +434,6 @@ static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
 		}
 	}
 
-	hwreq->req.actual += length;
-
 	if (!list_empty(&hwreq->tds)) {
 		/* get the last entry */
 		lastnode = list_entry(hwreq->tds.prev,
@@ -387,12 +441,117 @@ static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
 		lastnode->ptr->next = cpu_to_le32(node->dma);
 	}
 
-	INIT_LIST_HEAD(&node->td);
 	list_add_tail(&node->td, &hwreq->tds);
 
 	return 0;
 }
 
+/*
+ * One or more dTDs per scatterlist entry.  The controller only ends a
+ * transfer early on a short packet, so all entries but the last must
+ * hold whole packets.
+ */
+static int prepare_td_for_sg(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
+{
+	struct usb_request *req = &hwreq->req;
+	struct scatterlist *s;
+	int i, ret;
+
+	for_each_sg(req->sg, s, req->num_mapped_sgs, i) {
+		dma_addr_t dma = sg_dma_address(s);
+		unsigned rest = sg_dma_len(s);
+
+		if (i != req->num_mapped_sgs - 1 &&
+		    rest % hwep->ep.maxpacket) {
+			dev_err(hwep->ci->dev,
+				"sg entry %d is not a multiple of maxpacket\n",
+				i);
+			return -EINVAL;
+		}
+
+		while (rest > 0) {
+			int pages = TD_PAGE_COUNT;
+			unsigned count;
+
+			if (dma % CI_HDRC_PAGE_SIZE)
+				pages--;
+			count = min(rest, (unsigned)(pages * CI_HDRC_PAGE_SIZE));
+
+			ret = add_td_to_list(hwep, hwreq, count, dma);
+			if (ret < 0)
+				return ret;
+
+			dma += count;
+			rest -= count;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * An isochronous request goes out in one (micro)frame, so it has to fit a
+ * single dTD; other requests need whole packets in all but the last entry.
+ */
+static bool ci_req_needs_bounce(struct ci_hw_ep *hwep, struct usb_request *req)
+{
+	struct scatterlist *s;
+	int i;
+
+	if (!req->num_sgs)
+		return false;
+
+	if (hwep->type == USB_ENDPOINT_XFER_ISOC)
+		return req->num_sgs > 1;
+
+	for_each_sg(req->sg, s, req->num_sgs - 1, i)
+		if (s->length % hwep->ep.maxpacket)
+			return true;
+
+	return false;
+}
+
+/* Send a scatterlist we cannot describe from a linear copy instead. */
+static int ci_req_bounce(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
+{
+	struct usb_request *req = &hwreq->req;
+
+	if (hwreq->bounce_len < req->length) {
+		kfree(hwreq->bounce);
+		hwreq->bounce = kmalloc(req->length, GFP_ATOMIC);
+		hwreq->bounce_len = hwreq->bounce ? req->length : 0;
+		if (!hwreq->bounce)
+			return -ENOMEM;
+	}
+
+	if (hwep->dir == TX)
+		sg_copy_to_buffer(req->sg, req->num_sgs, hwreq->bounce,
+				  req->length);
+
+	hwreq->orig_buf = req->buf;
+	hwreq->orig_num_sgs = req->num_sgs;
+	req->buf = hwreq->bounce;
+	req->num_sgs = 0;
+	hwreq->bounced = true;
+
+	return 0;
+}
+
+static void ci_req_unbounce(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
+{
+	struct usb_request *req = &hwreq->req;
+
+	if (!hwreq->bounced)
+		return;
+
+	req->buf = hwreq->orig_buf;
+	req->num_sgs = hwreq->orig_num_sgs;
+	if (hwep->dir == RX)
+		sg_copy_from_buffer(req->sg, req->num_sgs, hwreq->bounce,
+				    req->actual);
+	hwreq->bounced = false;
+}
+
 /**
  * _usb_addr: calculates endpoint address from direction & number
  * @ep:  endpoint
@@ -423,9 +582,17 @@ static int _hardware_enqueue(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
 
 	hwreq->req.status = -EALREADY;
 
+	if (ci_req_needs_bounce(hwep, &hwreq->req)) {
+		ret = ci_req_bounce(hwep, hwreq);
+		if (ret)
+			return ret;
+	}
+
 	ret = usb_gadget_map_request(&ci->gadget, &hwreq->req, hwep->dir);
-	if (ret)
+	if (ret) {
+		ci_req_unbounce(hwep, hwreq);
 		return ret;
+	}
 
 	/*
 	 * The first buffer could be not page aligned.
@@ -435,24 +602,33 @@ static int _hardware_enqueue(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
 		pages--;
 
 	if (rest == 0) {
-		ret = add_td_to_list(hwep, hwreq, 0);
+		ret = add_td_to_list(hwep, hwreq, 0, 0);
+		if (ret < 0)
+			goto done;
+	}
+
+	if (hwreq->req.num_mapped_sgs) {
+		ret = prepare_td_for_sg(hwep, hwreq);
 		if (ret < 0)
 			goto done;
+		rest = 0;
 	}
 
 	while (rest > 0) {
 		unsigned count = min(hwreq->req.length - hwreq->req.actual,
 					(unsigned)(pages * CI_HDRC_PAGE_SIZE));
-		ret = add_td_to_list(hwep, hwreq, count);
+		ret = add_td_to_list(hwep, hwreq, count,
+				     hwreq->req.dma + hwreq->req.actual);
 		if (ret < 0)
 			goto done;
 
+		hwreq->req.actual += count;
 		rest -= count;
 	}
 
 	if (hwreq->req.zero && hwreq->req.length && hwep->dir == TX
 	    && (hwreq->req.length % hwep->ep.maxpacket == 0)) {
-		ret = add_td_to_list(hwep, hwreq, 0);
+		ret = add_td_to_list(hwep, hwreq, 0, 0);
 		if (ret < 0)
 			goto done;
 	}
@@ -523,9 +699,8 @@ static void free_pending_td(struct ci_hw_ep *hwep)
 {
 	struct td_node *pending = hwep->pending_td;
 
-	dma_pool_free(hwep->td_pool, pending->ptr, pending->dma);
 	hwep->pending_td = NULL;
-	kfree(pending);
+	ci_td_put(hwep, pending);
 }
 
 static int reprime_dtd(struct ci_hdrc *ci, struct ci_hw_ep *hwep,
@@ -611,6 +786,7 @@ static int _hardware_dequeue(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
 	usb_gadget_unmap_request(&hwep->ci->gadget, &hwreq->req, hwep->dir);
 
 	hwreq->req.actual += actual;
+	ci_req_unbounce(hwep, hwreq);
 
 	if (hwreq->req.status)
 		return hwreq->req.status;
@@ -642,14 +818,13 @@ __acquires(hwep->lock)
 						     struct ci_hw_req, queue);
 
 		list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-			dma_pool_free(hwep->td_pool, node->ptr, node->dma);
 			list_del_init(&node->td);
-			node->ptr = NULL;
-			kfree(node);
+			ci_td_put(hwep, node);
 		}
 
 		list_del_init(&hwreq->queue);
 		hwreq->req.status = -ESHUTDOWN;
+		ci_req_unbounce(hwep, hwreq);
 
 		if (hwreq->req.complete != NULL) {
 			spin_unlock(hwep->lock);
@@ -1412,12 +1587,11 @@ static void ep_free_request(struct usb_ep *ep, struct usb_request *req)
 	spin_lock_irqsave(hwep->lock, flags);
 
 	list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
 		list_del_init(&node->td);
-		node->ptr = NULL;
-		kfree(node);
+		ci_td_put(hwep, node);
 	}
 
+	kfree(hwreq->bounce);
 	kfree(hwreq);
 
 	spin_unlock_irqrestore(hwep->lock, flags);
@@ -1470,15 +1644,15 @@ static int ep_dequeue(struct usb_ep *ep, struct usb_request *req)
 		hw_ep_flush(hwep->ci, hwep->num, hwep->dir);
 
 	list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
-		list_del(&node->td);
-		kfree(node);
+		list_del_init(&node->td);
+		ci_td_put(hwep, node);
 	}
 
 	/* pop request */
 	list_del_init(&hwreq->queue);
 
 	usb_gadget_unmap_request(&hwep->ci->gadget, req, hwep->dir);
+	ci_req_unbounce(hwep, hwreq);
 
 	req->status = -ECONNRESET;
 
@@ -1699,6 +1873,7 @@ static int init_eps(struct ci_hdrc *ci)
 			hwep->ci          = ci;
 			hwep->lock         = &ci->lock;
 			hwep->td_pool      = ci->td_pool;
+			INIT_LIST_HEAD(&hwep->td_cache);
 
 			hwep->ep.name      = hwep->name;
 			hwep->ep.ops       = &usb_ep_ops;
@@ -1734,6 +1909,19 @@ static int init_eps(struct ci_hdrc *ci)
 			list_add_tail(&hwep->ep.ep_list, &ci->gadget.ep_list);
 		}
 
+	/* a short supply of dTDs per endpoint; more are added on demand */
+	for (i = 0; !retval && i < ci->hw_ep_max; i++) {
+		struct ci_hw_ep *hwep = &ci->ci_hw_ep[i];
+
+		for (j = 0; j < CI_TD_PREALLOC; j++) {
+			struct td_node *node = ci_td_alloc(hwep, GFP_KERNEL);
+
+			if (!node)
+				break;
+			ci_td_put(hwep, node);
+		}
+	}
+
 	return retval;
 }
 
@@ -1746,6 +1934,7 @@ static void destroy_eps(struct ci_hdrc *ci)
 
 		if (hwep->pending_td)
 			free_pending_td(hwep);
+		ci_td_cache_drain(hwep);
 		dma_pool_free(ci->qh_pool, hwep->qh.ptr, hwep->qh.dma);
 	}
 }
@@ -1921,6 +2110,7 @@ static int udc_start(struct ci_hdrc *ci)
 	ci->gadget.ops          = &usb_gadget_ops;
 	ci->gadget.speed        = USB_SPEED_UNKNOWN;
 	ci->gadget.max_speed    = USB_SPEED_HIGH;
+	ci->gadget.sg_supported = 1;
 	ci->gadget.name         = ci->platdata->name;
 	ci->gadget.otg_caps	= otg_caps;
 
@@ -79,6 +79,12 @@ struct ci_hw_req {
 	struct usb_request	req;
 	struct list_head	queue;
 	struct list_head	tds;
+	/* linear copy of a scatterlist the dTDs cannot describe */
+	void			*bounce;
+	unsigned		bounce_len;
+	bool			bounced;
+	void			*orig_buf;
+	unsigned		orig_num_sgs;
 };
 
 #ifdef CONFIG_USB_CHIPIDEA_UDC
@@ -60,6 +60,25 @@ static struct acm *acm_table[ACM_TTY_MINORS];
 
 static DEFINE_MUTEX(acm_table_lock);
 
+/*
+ * URB pool geometry, applied to each device as it is probed.  Bulk URBs
+ * complete on a short packet, so larger buffers cost no latency but let
+ * fast modems and MCU links stream without waiting on resubmission.
+ */
+static unsigned int rx_urbs = ACM_NR;
+module_param(rx_urbs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rx_urbs, "Number of bulk-in URBs per device (1-16)");
+
+static unsigned int rx_size;
+module_param(rx_size, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rx_size,
+	"Bytes per bulk-in URB, up to 32768 (default: 2 packets)");
+
+static unsigned int tx_size;
+module_param(tx_size, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_size,
+	"Bytes per bulk-out buffer, up to 32768 (default: 20 packets)");
+
 static void acm_tty_set_termios(struct tty_struct *tty,
 				struct ktermios *termios_old);
 
@@ -91,6 +110,20 @@ static struct acm *acm_get_by_index(unsigned index)
 	return acm;
 }
 
+/*
+ * Size of a URB buffer: the module parameter if set, rounded down to whole
+ * packets, else the given number of packets.
+ */
+static unsigned int acm_buf_size(unsigned int size, unsigned int maxp,
+				 unsigned int packets)
+{
+	if (!size || !maxp)
+		return maxp * packets;
+
+	size = clamp_t(unsigned int, size, maxp, ACM_MAX_BUFSIZE);
+	return rounddown(size, maxp);
+}
+
 /*
  * Try to find an available minor number and if found, associate it with 'acm'.
  */
@@ -1111,7 +1144,8 @@ static int acm_probe(struct usb_interface *intf,
 	if (quirks == IGNORE_DEVICE)
 		return -ENODEV;
 
-	num_rx_buf = (quirks == SINGLE_RX_URB) ? 1 : ACM_NR;
+	num_rx_buf = (quirks == SINGLE_RX_URB) ? 1 :
+					clamp_t(int, rx_urbs, 1, ACM_NR);
 
 	/* handle quirks deadly to normal probing*/
 	if (quirks == NO_UNION_NORMAL) {
@@ -1323,10 +1357,13 @@ made_compressed_probe:
 	}
 
 	ctrlsize = usb_endpoint_maxp(epctrl);
-	readsize = usb_endpoint_maxp(epread) *
+	if (quirks == SINGLE_RX_URB || usb_endpoint_xfer_int(epread))
+		readsize = usb_endpoint_maxp(epread) *
 				(quirks == SINGLE_RX_URB ? 1 : 2);
+	else
+		readsize = acm_buf_size(rx_size, usb_endpoint_maxp(epread), 2);
 	acm->combined_interfaces = combined_interfaces;
-	acm->writesize = usb_endpoint_maxp(epwrite) * 20;
+	acm->writesize = acm_buf_size(tx_size, usb_endpoint_maxp(epwrite), 20);
 	acm->control = control_interface;
 	acm->data = data_interface;
 	acm->minor = minor;
@@ -1348,6 +1385,9 @@ made_compressed_probe:
 		acm->bInterval = epread->bInterval;
 	tty_port_init(&acm->port);
 	acm->port.ops = &acm_port_ops;
+	/* room for every read URB to land twice before the ldisc catches up */
+	tty_buffer_set_limit(&acm->port,
+			     max(65536, 2 * num_rx_buf * readsize));
 	init_usb_anchor(&acm->delayed);
 	acm->quirks = quirks;
 
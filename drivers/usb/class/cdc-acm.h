@@ -62,6 +62,9 @@
 #define ACM_NW  16
 #define ACM_NR  16
 
+/* upper bound for the rx_size/tx_size module parameters */
+#define ACM_MAX_BUFSIZE	32768
+
 struct acm_wb {
 	unsigned char *buf;
 	dma_addr_t dmah;
@@ -32,6 +32,7 @@
 #include <linux/aio.h>
 #include <linux/mmu_context.h>
 #include <linux/poll.h>
+#include <linux/scatterlist.h>
 #include <linux/eventfd.h>
 
 #include "u_fs.h"
@@ -120,6 +121,19 @@ struct ffs_ep {
 	int				status;	/* P: epfile->mutex */
 };
 
+/*
+ * Pages userspace mmap()s from an endpoint file.  Transfers whose user
+ * buffer lies inside such a mapping are handed to the UDC as a
+ * scatterlist over these pages instead of being copied.
+ */
+#define FFS_POOL_MAX_SIZE	(8 << 20)
+
+struct ffs_buffer_pool {
+	struct kref			ref;
+	unsigned			nr_pages;
+	struct page			*pages[];
+};
+
 struct ffs_epfile {
 	/* Protects ep->ep and ep->req. */
 	struct mutex			mutex;
@@ -127,6 +141,7 @@ struct ffs_epfile {
 
 	struct ffs_data			*ffs;
 	struct ffs_ep			*ep;	/* P: ffs->eps_lock */
+	struct ffs_buffer_pool		*pool;	/* P: ffs->eps_lock */
 
 	struct dentry			*dentry;
 
@@ -156,6 +171,10 @@ struct ffs_io_data {
 	struct usb_request *req;
 
 	struct ffs_data *ffs;
+
+	/* Zero-copy transfer from/to the endpoint's buffer pool */
+	struct ffs_buffer_pool *pool;
+	struct sg_table sgt;
 };
 
 struct ffs_desc_helper {
@@ -628,6 +647,181 @@ static const struct file_operations ffs_ep0_operations = {
 };
 
 
+/* Endpoint buffer pools ****************************************************/
+
+static struct ffs_buffer_pool *ffs_pool_alloc(unsigned nr_pages)
+{
+	struct ffs_buffer_pool *pool;
+	unsigned i;
+
+	pool = kzalloc(sizeof(*pool) + nr_pages * sizeof(*pool->pages),
+		       GFP_KERNEL);
+	if (unlikely(!pool))
+		return NULL;
+
+	kref_init(&pool->ref);
+	pool->nr_pages = nr_pages;
+	for (i = 0; i < nr_pages; ++i) {
+		pool->pages[i] = alloc_page(GFP_KERNEL | __GFP_ZERO);
+		if (unlikely(!pool->pages[i]))
+			goto error;
+	}
+
+	return pool;
+
+error:
+	while (i--)
+		__free_page(pool->pages[i]);
+	kfree(pool);
+	return NULL;
+}
+
+static void ffs_pool_release(struct kref *ref)
+{
+	struct ffs_buffer_pool *pool =
+		container_of(ref, struct ffs_buffer_pool, ref);
+	unsigned i;
+
+	for (i = 0; i < pool->nr_pages; ++i)
+		__free_page(pool->pages[i]);
+	kfree(pool);
+}
+
+static void ffs_pool_put(struct ffs_buffer_pool *pool)
+{
+	if (pool)
+		kref_put(&pool->ref, ffs_pool_release);
+}
+
+static void ffs_pool_vm_open(struct vm_area_struct *vma)
+{
+	struct ffs_buffer_pool *pool = vma->vm_private_data;
+
+	kref_get(&pool->ref);
+}
+
+static void ffs_pool_vm_close(struct vm_area_struct *vma)
+{
+	ffs_pool_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct ffs_pool_vm_ops = {
+	.open =		ffs_pool_vm_open,
+	.close =	ffs_pool_vm_close,
+};
+
+/*
+ * The first mmap() of an endpoint file, at offset 0, sizes its pool; later
+ * ones may map any part of it.  The pool lives until the function goes
+ * away and the last mapping is gone.
+ */
+static int ffs_epfile_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct ffs_epfile *epfile = file->private_data;
+	struct ffs_buffer_pool *pool, *new = NULL;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long first = vma->vm_pgoff;
+	unsigned long i, n = size >> PAGE_SHIFT;
+	int ret;
+
+	ENTER();
+
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	spin_lock_irq(&epfile->ffs->eps_lock);
+	pool = epfile->pool;
+	spin_unlock_irq(&epfile->ffs->eps_lock);
+
+	if (!pool) {
+		if (first || size > FFS_POOL_MAX_SIZE)
+			return -EINVAL;
+		new = ffs_pool_alloc(n);
+		if (unlikely(!new))
+			return -ENOMEM;
+
+		spin_lock_irq(&epfile->ffs->eps_lock);
+		if (!epfile->pool) {
+			epfile->pool = new;
+			new = NULL;
+		}
+		pool = epfile->pool;
+		spin_unlock_irq(&epfile->ffs->eps_lock);
+		ffs_pool_put(new);
+	}
+
+	if (first >= pool->nr_pages || n > pool->nr_pages - first)
+		return -EINVAL;
+
+	for (i = 0; i < n; ++i) {
+		ret = vm_insert_page(vma, vma->vm_start + (i << PAGE_SHIFT),
+				     pool->pages[first + i]);
+		if (unlikely(ret))
+			return ret;
+	}
+
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP | VM_DONTCOPY;
+	vma->vm_ops = &ffs_pool_vm_ops;
+	vma->vm_private_data = pool;
+	kref_get(&pool->ref);
+
+	return 0;
+}
+
+/*
+ * If the whole user buffer of a transfer lies in a mapping of the
+ * endpoint's pool, describe it by a scatterlist over the pool pages.
+ */
+static bool ffs_epfile_map_pool(struct ffs_epfile *epfile,
+				struct ffs_io_data *io_data, size_t len)
+{
+	struct usb_gadget *gadget = epfile->ffs->gadget;
+	struct vm_area_struct *vma;
+	struct ffs_buffer_pool *pool;
+	unsigned long addr, offset;
+	bool mapped = false;
+
+	if (!gadget || !gadget->sg_supported || !len ||
+	    !iter_is_iovec(&io_data->data) ||
+	    iov_iter_single_seg_count(&io_data->data) != len)
+		return false;
+
+	addr = (unsigned long)io_data->data.iov->iov_base +
+		io_data->data.iov_offset;
+
+	down_read(&io_data->mm->mmap_sem);
+	vma = find_vma(io_data->mm, addr);
+	if (!vma || vma->vm_start > addr || vma->vm_ops != &ffs_pool_vm_ops ||
+	    len > vma->vm_end - addr)
+		goto out;
+
+	pool = vma->vm_private_data;
+	offset = addr - vma->vm_start + (vma->vm_pgoff << PAGE_SHIFT);
+	if (sg_alloc_table_from_pages(&io_data->sgt,
+				      &pool->pages[offset >> PAGE_SHIFT],
+				      PAGE_ALIGN((offset & ~PAGE_MASK) + len)
+						>> PAGE_SHIFT,
+				      offset & ~PAGE_MASK, len, GFP_KERNEL))
+		goto out;
+
+	kref_get(&pool->ref);
+	io_data->pool = pool;
+	mapped = true;
+out:
+	up_read(&io_data->mm->mmap_sem);
+	return mapped;
+}
+
+static void ffs_io_data_unmap_pool(struct ffs_io_data *io_data)
+{
+	if (!io_data->pool)
+		return;
+
+	sg_free_table(&io_data->sgt);
+	ffs_pool_put(io_data->pool);
+	io_data->pool = NULL;
+}
+
 /* "Normal" endpoints operations ********************************************/
 
 static void ffs_epfile_io_complete(struct usb_ep *_ep, struct usb_request *req)
@@ -647,7 +841,7 @@ static void ffs_user_copy_worker(struct work_struct *work)
 	int ret = io_data->req->status ? io_data->req->status :
 					 io_data->req->actual;
 
-	if (io_data->read && ret > 0) {
+	if (io_data->read && ret > 0 && !io_data->pool) {
 		use_mm(io_data->mm);
 		ret = copy_to_iter(io_data->buf, ret, &io_data->data);
 		if (iov_iter_count(&io_data->data))
@@ -662,6 +856,7 @@ static void ffs_user_copy_worker(struct work_struct *work)
 		eventfd_signal(io_data->ffs->ffs_eventfd, 1);
 
 	usb_ep_free_request(io_data->ep, io_data->req);
+	ffs_io_data_unmap_pool(io_data);
 
 	io_data->kiocb->private = NULL;
 	if (io_data->read)
@@ -741,6 +936,13 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 			data_len = usb_ep_align_maybe(gadget, ep->ep, data_len);
 		spin_unlock_irq(&epfile->ffs->eps_lock);
 
+		/*
+		 * A read is only sent in place if the aligned length still
+		 * fits the user buffer; extra data would land in the pool.
+		 */
+		if (ffs_epfile_map_pool(epfile, io_data, data_len))
+			goto queue;
+
 		data = kmalloc(data_len, GFP_KERNEL);
 		if (unlikely(!data))
 			return -ENOMEM;
@@ -753,6 +955,7 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 		}
 	}
 
+queue:
 	/* We will be using request */
 	ret = ffs_mutex_lock(&epfile->mutex, file->f_flags & O_NONBLOCK);
 	if (unlikely(ret))
@@ -798,6 +1001,10 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 
 			req->buf      = data;
 			req->length   = data_len;
+			if (io_data->pool) {
+				req->sg       = io_data->sgt.sgl;
+				req->num_sgs  = io_data->sgt.nents;
+			}
 
 			io_data->buf = data;
 			io_data->ep = ep->ep;
@@ -821,6 +1028,12 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 			req = ep->req;
 			req->buf      = data;
 			req->length   = data_len;
+			req->sg       = NULL;
+			req->num_sgs  = 0;
+			if (io_data->pool) {
+				req->sg       = io_data->sgt.sgl;
+				req->num_sgs  = io_data->sgt.nents;
+			}
 
 			req->context  = &done;
 			req->complete = ffs_epfile_io_complete;
@@ -844,13 +1057,15 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 				 * data then user space has space for.
 				 */
 				ret = ep->status;
-				if (io_data->read && ret > 0) {
+				if (io_data->read && ret > 0 &&
+				    !io_data->pool) {
 					ret = copy_to_iter(data, ret, &io_data->data);
 					if (!ret)
 						ret = -EFAULT;
 				}
 			}
 			kfree(data);
+			ffs_io_data_unmap_pool(io_data);
 		}
 	}
 
@@ -862,6 +1077,7 @@ error_lock:
 	mutex_unlock(&epfile->mutex);
 error:
 	kfree(data);
+	ffs_io_data_unmap_pool(io_data);
 	return ret;
 }
 
@@ -921,6 +1137,7 @@ static ssize_t ffs_epfile_write_iter(struct kiocb *kiocb, struct iov_iter *from)
 	p->kiocb = kiocb;
 	p->data = *from;
 	p->mm = current->mm;
+	p->pool = NULL;
 
 	kiocb->private = p;
 
@@ -966,6 +1183,7 @@ static ssize_t ffs_epfile_read_iter(struct kiocb *kiocb, struct iov_iter *to)
 		p->to_free = NULL;
 	}
 	p->mm = current->mm;
+	p->pool = NULL;
 
 	kiocb->private = p;
 
@@ -1064,6 +1282,7 @@ static const struct file_operations ffs_epfile_operations = {
 	.open =		ffs_epfile_open,
 	.write_iter =	ffs_epfile_write_iter,
 	.read_iter =	ffs_epfile_read_iter,
+	.mmap =		ffs_epfile_mmap,
 	.release =	ffs_epfile_release,
 	.unlocked_ioctl =	ffs_epfile_ioctl,
 };
@@ -1605,6 +1824,7 @@ static void ffs_epfiles_destroy(struct ffs_epfile *epfiles, unsigned count)
 			dput(epfile->dentry);
 			epfile->dentry = NULL;
 		}
+		ffs_pool_put(epfile->pool);
 	}
 
 	kfree(epfiles);
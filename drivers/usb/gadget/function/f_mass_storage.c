@@ -214,6 +214,7 @@
 #include <linux/string.h>
 #include <linux/freezer.h>
 #include <linux/module.h>
+#include <linux/pagemap.h>
 
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
@@ -635,6 +636,25 @@ static int sleep_thread(struct fsg_common *common, bool can_freeze)
 
 /*-------------------------------------------------------------------------*/
 
+/*
+ * Queue page cache reads for [offset, offset + amount) without waiting
+ * for them, so the backing device works ahead of the bulk-in pipeline.
+ */
+static void fsg_lun_readahead(struct fsg_lun *curlun, loff_t offset,
+			      u32 amount)
+{
+	struct file	*filp = curlun->filp;
+	unsigned long	nr_pages;
+
+	if (offset >= curlun->file_length)
+		return;
+	amount = min((loff_t)amount, curlun->file_length - offset);
+	nr_pages = DIV_ROUND_UP((offset & ~PAGE_CACHE_MASK) + amount,
+				PAGE_CACHE_SIZE);
+	page_cache_sync_readahead(filp->f_mapping, &filp->f_ra, filp,
+				  offset >> PAGE_CACHE_SHIFT, nr_pages);
+}
+
 static int do_read(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = common->curlun;
@@ -676,6 +696,17 @@ static int do_read(struct fsg_common *common)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	/*
+	 * Get the media reads for the whole command in flight up front.
+	 * If the host is streaming sequentially, it will most likely ask
+	 * for the same amount right after this; start on that as well.
+	 */
+	fsg_lun_readahead(curlun, file_offset, amount_left);
+	if (file_offset == curlun->next_read_offset)
+		fsg_lun_readahead(curlun, file_offset + amount_left,
+				  amount_left);
+	curlun->next_read_offset = file_offset + amount_left;
+
 	for (;;) {
 		/*
 		 * Figure out how much we need to read:
@@ -2690,10 +2721,10 @@ EXPORT_SYMBOL_GPL(fsg_common_put);
 /* check if fsg_num_buffers is within a valid range */
 static inline int fsg_num_buffers_validate(unsigned int fsg_num_buffers)
 {
-	if (fsg_num_buffers >= 2 && fsg_num_buffers <= 4)
+	if (fsg_num_buffers >= 2 && fsg_num_buffers <= 32)
 		return 0;
 	pr_err("fsg_num_buffers %u is out of range (%d to %d)\n",
-	       fsg_num_buffers, 2, 4);
+	       fsg_num_buffers, 2, 32);
 	return -EINVAL;
 }
 
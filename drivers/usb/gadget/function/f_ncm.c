@@ -105,8 +105,18 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
  * because it's used by default by the current linux host driver
  */
 #define NTB_DEFAULT_IN_SIZE	16384
+#define NTB_MIN_IN_SIZE		2048
+#define NTB_MAX_IN_SIZE		32768
 #define NTB_OUT_SIZE		16384
 
+/*
+ * Larger IN NTBs carry more datagrams per transfer at high speed; the
+ * upper bound keeps the GFP_ATOMIC NTB allocation reasonable.
+ */
+static unsigned int ntb_in_size = NTB_DEFAULT_IN_SIZE;
+module_param(ntb_in_size, uint, S_IRUGO);
+MODULE_PARM_DESC(ntb_in_size, "dwNtbInMaxSize offered to the host, in bytes");
+
 /* Allocation for storing the NDP, 32 should suffice for a
  * 16k packet. This allows a maximum of 32 * 507 Byte packets to
  * be transmitted in a single 16kB skb, though when sending full size
@@ -117,7 +127,9 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
 #define TX_MAX_NUM_DPE		32
 
 /* Delay for the transmit to wait before sending an unfilled NTB frame. */
-#define TX_TIMEOUT_NSECS	300000
+static unsigned int tx_timeout_us = 300;
+module_param(tx_timeout_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_timeout_us, "Time an unfilled NTB is held, in usecs");
 
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
@@ -465,7 +477,7 @@ static inline void ncm_reset_values(struct f_ncm *ncm)
 	ncm->port.header_len = 0;
 
 	ncm->port.fixed_out_len = le32_to_cpu(ntb_parameters.dwNtbOutMaxSize);
-	ncm->port.fixed_in_len = NTB_DEFAULT_IN_SIZE;
+	ncm->port.fixed_in_len = le32_to_cpu(ntb_parameters.dwNtbInMaxSize);
 }
 
 /*
@@ -975,6 +987,13 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			uint32_t	crc;
 			__le16		*crc_pos;
 
+			/* The CRC covers the finished, linear datagram */
+			if (skb->ip_summed == CHECKSUM_PARTIAL &&
+			    skb_checksum_help(skb))
+				goto err;
+			if (skb_linearize(skb))
+				goto err;
+
 			crc = ~crc32_le(~0,
 					skb->data,
 					skb->len);
@@ -1041,7 +1060,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 
 		/* Delay the timer. */
 		hrtimer_start(&ncm->task_timer,
-			      ktime_set(0, TX_TIMEOUT_NSECS),
+			      ktime_set(0, tx_timeout_us * NSEC_PER_USEC),
 			      HRTIMER_MODE_REL);
 
 		/* Add the datagram position entries */
@@ -1062,7 +1081,8 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		ntb_data = (void *) skb_put(ncm->skb_tx_data, dgram_pad);
 		memset(ntb_data, 0, dgram_pad);
 		ntb_data = (void *) skb_put(ncm->skb_tx_data, skb->len);
-		memcpy(ntb_data, skb->data, skb->len);
+		/* Gathers the fragments and fills in a pending checksum */
+		skb_copy_and_csum_dev(skb, (u8 *)ntb_data);
 		dev_kfree_skb_any(skb);
 		skb = NULL;
 
@@ -1350,6 +1370,9 @@ static int ncm_bind(struct usb_configuration *c, struct usb_function *f)
 	if (!can_support_ecm(cdev->gadget))
 		return -EINVAL;
 
+	ntb_parameters.dwNtbInMaxSize = cpu_to_le32(clamp_t(unsigned int,
+			ntb_in_size, NTB_MIN_IN_SIZE, NTB_MAX_IN_SIZE));
+
 	ncm_opts = container_of(f->fi, struct f_ncm_opts, func_inst);
 	/*
 	 * in drivers/usb/gadget/configfs.c:configfs_composite_bind()
@@ -1545,6 +1568,15 @@ static struct usb_function_instance *ncm_alloc_inst(void)
 		return ERR_CAST(net);
 	}
 
+	/*
+	 * Every datagram is copied into an NTB anyway, so take them
+	 * scattered and with the checksum still to be done: the stack then
+	 * builds GSO super-packets for us and ncm_wrap_ntb() folds gathering
+	 * and checksumming into that one copy.
+	 */
+	opts->net->hw_features |= NETIF_F_SG | NETIF_F_HW_CSUM;
+	opts->net->features |= NETIF_F_SG | NETIF_F_HW_CSUM | NETIF_F_HIGHDMA;
+
 	config_group_init_type_name(&opts->func_inst.group, "", &ncm_func_type);
 
 	return &opts->func_inst;
@@ -20,6 +20,8 @@
 #include <linux/module.h>
 #include <linux/device.h>
 #include <linux/etherdevice.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
 
 #include <linux/atomic.h>
 
@@ -81,8 +83,39 @@ struct f_rndis {
 	struct usb_ep			*notify;
 	struct usb_request		*notify_req;
 	atomic_t			notify_count;
+
+	/* IN packet batching, see rndis_add_header() */
+	struct net_device		*netdev;
+	struct sk_buff			*skb_tx_data;
+	unsigned			tx_pkts;
+	bool				timer_force_tx;
+	bool				timer_stopping;
+	struct tasklet_struct		tx_tasklet;
+	struct hrtimer			task_timer;
 };
 
+/*
+ * Windows hosts (and others that announce a large enough MaxTransferSize)
+ * take several REMOTE_NDIS_PACKET_MSGs per bulk transfer.  Batching them
+ * cuts the number of USB requests, and interrupts, per frame; a partial
+ * batch is held for at most tx_timeout_us before it is sent anyway.
+ */
+static unsigned int dl_max_pkts = 8;
+module_param(dl_max_pkts, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dl_max_pkts, "Max packets batched per IN transfer (1 = off)");
+
+static unsigned int ul_max_pkts = 8;
+module_param(ul_max_pkts, uint, S_IRUGO);
+MODULE_PARM_DESC(ul_max_pkts, "Max packets the host may batch per OUT transfer");
+
+static unsigned int tx_timeout_us = 300;
+module_param(tx_timeout_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_timeout_us, "Time a partial IN batch is held, in usecs");
+
+#define RNDIS_PKT_MAX_SIZE	(ETH_FRAME_LEN + sizeof(struct ethhdr) + \
+				 sizeof(struct rndis_packet_msg_type) + 22)
+#define RNDIS_TX_MAX_XFER	16384
+
 static inline struct f_rndis *func_to_rndis(struct usb_function *f)
 {
 	return container_of(f, struct f_rndis, port.func);
@@ -369,18 +402,130 @@ static struct usb_gadget_strings *rndis_strings[] = {
 
 /*-------------------------------------------------------------------------*/
 
+/* Largest IN transfer to build, or 0 when batching is off */
+static unsigned rndis_tx_max_size(struct f_rndis *rndis)
+{
+	unsigned max_size = rndis_get_host_max_xfer(rndis->config);
+
+	if (dl_max_pkts < 2)
+		return 0;
+
+	/* leave room for the byte u_ether adds instead of a ZLP */
+	max_size = min_t(unsigned, max_size, RNDIS_TX_MAX_XFER);
+	if (max_size < 2 * RNDIS_PKT_MAX_SIZE + 1)
+		return 0;
+
+	return max_size - 1;
+}
+
+static struct sk_buff *rndis_package_for_tx(struct f_rndis *rndis)
+{
+	struct sk_buff *skb2 = rndis->skb_tx_data;
+
+	hrtimer_try_to_cancel(&rndis->task_timer);
+	rndis->skb_tx_data = NULL;
+	rndis->tx_pkts = 0;
+
+	return skb2;
+}
+
+static void rndis_drop_tx_data(struct f_rndis *rndis)
+{
+	if (rndis->skb_tx_data) {
+		dev_kfree_skb_any(rndis->skb_tx_data);
+		rndis->skb_tx_data = NULL;
+	}
+	rndis->tx_pkts = 0;
+}
+
 static struct sk_buff *rndis_add_header(struct gether *port,
 					struct sk_buff *skb)
 {
-	struct sk_buff *skb2;
+	struct f_rndis *rndis = func_to_rndis(&port->func);
+	struct rndis_packet_msg_type *header;
+	struct sk_buff *skb2 = NULL;
+	unsigned max_size, len;
+
+	if (!skb) {
+		/* flush request from rndis_tx_tasklet() */
+		if (rndis->skb_tx_data && rndis->timer_force_tx)
+			skb2 = rndis_package_for_tx(rndis);
+		return skb2;
+	}
 
-	skb2 = skb_realloc_headroom(skb, sizeof(struct rndis_packet_msg_type));
-	rndis_add_hdr(skb2);
+	max_size = rndis_tx_max_size(rndis);
+	if (!max_size) {
+		/* an RNDIS reset turned batching off, the host lost it */
+		rndis_drop_tx_data(rndis);
+
+		skb2 = skb_realloc_headroom(skb,
+					    sizeof(struct rndis_packet_msg_type));
+		rndis_add_hdr(skb2);
+		if (!skb2 && rndis->netdev)
+			rndis->netdev->stats.tx_dropped++;
+
+		dev_kfree_skb(skb);
+		return skb2;
+	}
+
+	len = sizeof(*header) + skb->len;
+	if (rndis->skb_tx_data && (rndis->tx_pkts >= dl_max_pkts ||
+	    rndis->skb_tx_data->len + len > max_size))
+		skb2 = rndis_package_for_tx(rndis);
+
+	if (!rndis->skb_tx_data) {
+		rndis->skb_tx_data = alloc_skb(max_size + 1, GFP_ATOMIC);
+		if (!rndis->skb_tx_data) {
+			if (rndis->netdev)
+				rndis->netdev->stats.tx_dropped++;
+			dev_kfree_skb_any(skb);
+			return skb2;
+		}
+	}
+
+	header = (void *)skb_put(rndis->skb_tx_data, sizeof(*header));
+	memset(header, 0, sizeof(*header));
+	header->MessageType = cpu_to_le32(RNDIS_MSG_PACKET);
+	header->MessageLength = cpu_to_le32(len);
+	header->DataOffset = cpu_to_le32(36);
+	header->DataLength = cpu_to_le32(skb->len);
+	memcpy(skb_put(rndis->skb_tx_data, skb->len), skb->data, skb->len);
+	dev_kfree_skb_any(skb);
+	rndis->tx_pkts++;
+
+	if (!skb2 && rndis->tx_pkts >= dl_max_pkts)
+		skb2 = rndis_package_for_tx(rndis);
+	else
+		hrtimer_start(&rndis->task_timer,
+			      ktime_set(0, tx_timeout_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
 
-	dev_kfree_skb(skb);
 	return skb2;
 }
 
+/* Sends a partial batch once the stack stopped feeding us frames. */
+static void rndis_tx_tasklet(unsigned long data)
+{
+	struct f_rndis	*rndis = (void *)data;
+
+	if (rndis->timer_stopping || !rndis->netdev)
+		return;
+
+	if (rndis->skb_tx_data) {
+		rndis->timer_force_tx = true;
+		rndis->netdev->netdev_ops->ndo_start_xmit(NULL, rndis->netdev);
+		rndis->timer_force_tx = false;
+	}
+}
+
+static enum hrtimer_restart rndis_tx_timeout(struct hrtimer *data)
+{
+	struct f_rndis *rndis = container_of(data, struct f_rndis, task_timer);
+
+	tasklet_schedule(&rndis->tx_tasklet);
+	return HRTIMER_NORESTART;
+}
+
 static void rndis_response_available(void *_rndis)
 {
 	struct f_rndis			*rndis = _rndis;
@@ -560,8 +705,11 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 
 		if (rndis->port.in_ep->driver_data) {
 			DBG(cdev, "reset rndis\n");
+			rndis->timer_stopping = true;
 			gether_disconnect(&rndis->port);
 		}
+		hrtimer_try_to_cancel(&rndis->task_timer);
+		rndis_drop_tx_data(rndis);
 
 		if (!rndis->port.in_ep->desc || !rndis->port.out_ep->desc) {
 			DBG(cdev, "init rndis\n");
@@ -596,6 +744,8 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 		net = gether_connect(&rndis->port);
 		if (IS_ERR(net))
 			return PTR_ERR(net);
+		rndis->netdev = net;
+		rndis->timer_stopping = false;
 
 		rndis_set_param_dev(rndis->config, net,
 				&rndis->port.cdc_filter);
@@ -618,7 +768,9 @@ static void rndis_disable(struct usb_function *f)
 	DBG(cdev, "rndis deactivated\n");
 
 	rndis_uninit(rndis->config);
+	rndis->timer_stopping = true;
 	gether_disconnect(&rndis->port);
+	hrtimer_try_to_cancel(&rndis->task_timer);
 
 	usb_ep_disable(rndis->notify);
 	rndis->notify->driver_data = NULL;
@@ -796,6 +948,14 @@ rndis_bind(struct usb_configuration *c, struct usb_function *f)
 	rndis->port.open = rndis_open;
 	rndis->port.close = rndis_close;
 
+	tasklet_init(&rndis->tx_tasklet, rndis_tx_tasklet,
+		     (unsigned long) rndis);
+	hrtimer_init(&rndis->task_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	rndis->task_timer.function = rndis_tx_timeout;
+	rndis->timer_stopping = true;
+	rndis_set_max_pkt_per_xfer(rndis->config, ul_max_pkts,
+				   rndis->port.fixed_out_len);
+
 	rndis_set_param_medium(rndis->config, RNDIS_MEDIUM_802_3, 0);
 	rndis_set_host_mac(rndis->config, rndis->ethaddr);
 
@@ -960,6 +1120,10 @@ static void rndis_unbind(struct usb_configuration *c, struct usb_function *f)
 	f->os_desc_n = 0;
 	usb_free_all_descriptors(f);
 
+	hrtimer_cancel(&rndis->task_timer);
+	tasklet_kill(&rndis->tx_tasklet);
+	rndis_drop_tx_data(rndis);
+
 	kfree(rndis->notify_req->buf);
 	usb_ep_free_request(rndis->notify, rndis->notify_req);
 }
@@ -992,6 +1156,13 @@ static struct usb_function *rndis_alloc(struct usb_function_instance *fi)
 	rndis->port.header_len = sizeof(struct rndis_packet_msg_type);
 	rndis->port.wrap = rndis_add_header;
 	rndis->port.unwrap = rndis_rm_hdr;
+	rndis->port.supports_multi_frame = true;
+
+	/* OUT buffers big enough for a full batch from the host */
+	if (ul_max_pkts > 1) {
+		rndis->port.is_fixed = true;
+		rndis->port.fixed_out_len = ul_max_pkts * RNDIS_PKT_MAX_SIZE;
+	}
 
 	rndis->port.func.name = "rndis";
 	/* descriptors are per-instance copies */
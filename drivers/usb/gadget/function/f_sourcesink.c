@@ -18,6 +18,8 @@
 #include <linux/module.h>
 #include <linux/usb/composite.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 
 #include "g_zero.h"
 #include "gadget_chips.h"
@@ -36,12 +38,12 @@
  * mode is enabled, it provides good functional coverage for the "USBCV"
  * test harness from USB-IF.
  *
- * Note that because this doesn't queue more than one request at a time,
- * some other function must be used to test queueing logic.  The network
- * link (g_ether) is the best overall option for that, since its TX and RX
- * queues are relatively independent, will receive a range of packet sizes,
- * and can often be made to run out completely.  Those issues are important
- * when stress testing peripheral controller drivers.
+ * By default only one bulk request is queued per endpoint; the bulk_qlen
+ * and iso_qlen attributes raise the queue depth so the controller's
+ * queueing logic and throughput can be exercised too.  The read-only
+ * "stats" attribute reports, per endpoint, the request and byte counts,
+ * throughput and a log2 histogram of request turnaround (queue to
+ * completion) latency; writing anything to it clears the counters.
  *
  *
  * This is currently packaged as a configuration driver, which can't be
@@ -69,6 +71,8 @@ static unsigned isoc_maxpacket;
 static unsigned isoc_mult;
 static unsigned isoc_maxburst;
 static unsigned buflen;
+static unsigned bulk_qlen;
+static unsigned iso_qlen;
 
 /*-------------------------------------------------------------------------*/
 
@@ -302,9 +306,33 @@ static struct usb_gadget_strings *sourcesink_strings[] = {
 
 /*-------------------------------------------------------------------------*/
 
+static void ss_free_ep_req(struct usb_ep *ep, struct usb_request *req)
+{
+	kfree(req->context);
+	free_ep_req(ep, req);
+}
+
+/* req->context holds the time the request was last queued */
 static inline struct usb_request *ss_alloc_ep_req(struct usb_ep *ep, int len)
 {
-	return alloc_ep_req(ep, len, buflen);
+	struct usb_request	*req;
+
+	req = alloc_ep_req(ep, len, buflen);
+	if (!req)
+		return NULL;
+
+	req->context = kzalloc(sizeof(ktime_t), GFP_ATOMIC);
+	if (!req->context) {
+		free_ep_req(ep, req);
+		return NULL;
+	}
+	return req;
+}
+
+static int ss_queue_req(struct usb_ep *ep, struct usb_request *req)
+{
+	*(ktime_t *)req->context = ktime_get();
+	return usb_ep_queue(ep, req, GFP_ATOMIC);
 }
 
 void free_ep_req(struct usb_ep *ep, struct usb_request *req)
@@ -547,6 +575,48 @@ static void reinit_write_data(struct usb_ep *ep, struct usb_request *req)
 	}
 }
 
+static struct ss_ep_stats *ss_ep_stats(struct f_sourcesink *ss,
+		struct f_ss_opts *opts, struct usb_ep *ep)
+{
+	if (ep == ss->in_ep)
+		return &opts->stats[GZERO_SS_EP_IN];
+	if (ep == ss->out_ep)
+		return &opts->stats[GZERO_SS_EP_OUT];
+	if (ep == ss->iso_in_ep)
+		return &opts->stats[GZERO_SS_EP_ISO_IN];
+	return &opts->stats[GZERO_SS_EP_ISO_OUT];
+}
+
+static void ss_account_req(struct f_sourcesink *ss, struct usb_ep *ep,
+		struct usb_request *req)
+{
+	struct f_ss_opts	*opts;
+	struct ss_ep_stats	*stats;
+	unsigned long		flags;
+	ktime_t			now = ktime_get();
+	s64			us;
+	int			bucket;
+
+	us = ktime_us_delta(now, *(ktime_t *)req->context);
+	bucket = us > 0 ? ilog2(us) + 1 : 0;
+	if (bucket >= GZERO_SS_LAT_BUCKETS)
+		bucket = GZERO_SS_LAT_BUCKETS - 1;
+
+	opts = container_of(ss->function.fi, struct f_ss_opts, func_inst);
+	stats = ss_ep_stats(ss, opts, ep);
+
+	spin_lock_irqsave(&opts->stats_lock, flags);
+	if (!stats->requests)
+		stats->first = *(ktime_t *)req->context;
+	stats->last = now;
+	stats->requests++;
+	stats->bytes += req->actual;
+	if (req->status && req->status != -EREMOTEIO)
+		stats->errors++;
+	stats->latency[bucket]++;
+	spin_unlock_irqrestore(&opts->stats_lock, flags);
+}
+
 static void source_sink_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct usb_composite_dev	*cdev;
@@ -577,7 +647,7 @@ static void source_sink_complete(struct usb_ep *ep, struct usb_request *req)
 				req->actual, req->length);
 		if (ep == ss->out_ep)
 			check_read_data(ss, req);
-		free_ep_req(ep, req);
+		ss_free_ep_req(ep, req);
 		return;
 
 	case -EOVERFLOW:		/* buffer overrun on read means that
@@ -593,7 +663,9 @@ static void source_sink_complete(struct usb_ep *ep, struct usb_request *req)
 		break;
 	}
 
-	status = usb_ep_queue(ep, req, GFP_ATOMIC);
+	ss_account_req(ss, ep, req);
+
+	status = ss_queue_req(ep, req);
 	if (status) {
 		ERROR(cdev, "kill %s:  resubmit %d bytes --> %d\n",
 				ep->name, req->length, status);
@@ -607,9 +679,10 @@ static int source_sink_start_ep(struct f_sourcesink *ss, bool is_in,
 {
 	struct usb_ep		*ep;
 	struct usb_request	*req;
-	int			i, size, status;
+	int			i, size, status = 0;
+	unsigned		qlen = is_iso ? iso_qlen : bulk_qlen;
 
-	for (i = 0; i < 8; i++) {
+	for (i = 0; i < qlen; i++) {
 		if (is_iso) {
 			switch (speed) {
 			case USB_SPEED_SUPER:
@@ -640,7 +713,7 @@ static int source_sink_start_ep(struct f_sourcesink *ss, bool is_in,
 		else if (pattern != 2)
 			memset(req->buf, 0x55, req->length);
 
-		status = usb_ep_queue(ep, req, GFP_ATOMIC);
+		status = ss_queue_req(ep, req);
 		if (status) {
 			struct usb_composite_dev	*cdev;
 
@@ -648,11 +721,8 @@ static int source_sink_start_ep(struct f_sourcesink *ss, bool is_in,
 			ERROR(cdev, "start %s%s %s --> %d\n",
 			      is_iso ? "ISO-" : "", is_in ? "IN" : "OUT",
 			      ep->name, status);
-			free_ep_req(ep, req);
+			ss_free_ep_req(ep, req);
 		}
-
-		if (!is_iso)
-			break;
 	}
 
 	return status;
@@ -675,6 +745,14 @@ enable_source_sink(struct usb_composite_dev *cdev, struct f_sourcesink *ss,
 	int					result = 0;
 	int					speed = cdev->gadget->speed;
 	struct usb_ep				*ep;
+	struct f_ss_opts			*opts;
+	unsigned long				flags;
+
+	/* every (re)configuration starts a new measurement */
+	opts = container_of(ss->function.fi, struct f_ss_opts, func_inst);
+	spin_lock_irqsave(&opts->stats_lock, flags);
+	memset(opts->stats, 0, sizeof(opts->stats));
+	spin_unlock_irqrestore(&opts->stats_lock, flags);
 
 	/* one bulk endpoint writes (sources) zeroes IN (to the host) */
 	ep = ss->in_ep;
@@ -886,6 +964,8 @@ static struct usb_function *source_sink_alloc_func(
 	isoc_mult = ss_opts->isoc_mult;
 	isoc_maxburst = ss_opts->isoc_maxburst;
 	buflen = ss_opts->bulk_buflen;
+	bulk_qlen = ss_opts->bulk_qlen;
+	iso_qlen = ss_opts->iso_qlen;
 
 	ss->function.name = "source/sink";
 	ss->function.bind = sourcesink_bind;
@@ -1181,6 +1261,154 @@ static struct f_ss_opts_attribute f_ss_opts_bulk_buflen =
 			f_ss_opts_bulk_buflen_show,
 			f_ss_opts_bulk_buflen_store);
 
+static ssize_t f_ss_opts_bulk_qlen_show(struct f_ss_opts *opts, char *page)
+{
+	int result;
+
+	mutex_lock(&opts->lock);
+	result = sprintf(page, "%u", opts->bulk_qlen);
+	mutex_unlock(&opts->lock);
+
+	return result;
+}
+
+static ssize_t f_ss_opts_bulk_qlen_store(struct f_ss_opts *opts,
+					 const char *page, size_t len)
+{
+	int ret;
+	u32 num;
+
+	mutex_lock(&opts->lock);
+	if (opts->refcnt) {
+		ret = -EBUSY;
+		goto end;
+	}
+
+	ret = kstrtou32(page, 0, &num);
+	if (ret)
+		goto end;
+
+	if (num == 0 || num > 64) {
+		ret = -EINVAL;
+		goto end;
+	}
+
+	opts->bulk_qlen = num;
+	ret = len;
+end:
+	mutex_unlock(&opts->lock);
+	return ret;
+}
+
+static struct f_ss_opts_attribute f_ss_opts_bulk_qlen =
+	__CONFIGFS_ATTR(bulk_qlen, S_IRUGO | S_IWUSR,
+			f_ss_opts_bulk_qlen_show,
+			f_ss_opts_bulk_qlen_store);
+
+static ssize_t f_ss_opts_iso_qlen_show(struct f_ss_opts *opts, char *page)
+{
+	int result;
+
+	mutex_lock(&opts->lock);
+	result = sprintf(page, "%u", opts->iso_qlen);
+	mutex_unlock(&opts->lock);
+
+	return result;
+}
+
+static ssize_t f_ss_opts_iso_qlen_store(struct f_ss_opts *opts,
+					const char *page, size_t len)
+{
+	int ret;
+	u32 num;
+
+	mutex_lock(&opts->lock);
+	if (opts->refcnt) {
+		ret = -EBUSY;
+		goto end;
+	}
+
+	ret = kstrtou32(page, 0, &num);
+	if (ret)
+		goto end;
+
+	if (num == 0 || num > 64) {
+		ret = -EINVAL;
+		goto end;
+	}
+
+	opts->iso_qlen = num;
+	ret = len;
+end:
+	mutex_unlock(&opts->lock);
+	return ret;
+}
+
+static struct f_ss_opts_attribute f_ss_opts_iso_qlen =
+	__CONFIGFS_ATTR(iso_qlen, S_IRUGO | S_IWUSR,
+			f_ss_opts_iso_qlen_show,
+			f_ss_opts_iso_qlen_store);
+
+static const char * const ss_ep_names[GZERO_SS_NUM_EPS] = {
+	[GZERO_SS_EP_IN]	= "in",
+	[GZERO_SS_EP_OUT]	= "out",
+	[GZERO_SS_EP_ISO_IN]	= "iso-in",
+	[GZERO_SS_EP_ISO_OUT]	= "iso-out",
+};
+
+static ssize_t f_ss_opts_stats_show(struct f_ss_opts *opts, char *page)
+{
+	struct ss_ep_stats stats[GZERO_SS_NUM_EPS];
+	unsigned long flags;
+	ssize_t len = 0;
+	int i, j;
+
+	spin_lock_irqsave(&opts->stats_lock, flags);
+	memcpy(stats, opts->stats, sizeof(stats));
+	spin_unlock_irqrestore(&opts->stats_lock, flags);
+
+	for (i = 0; i < GZERO_SS_NUM_EPS; i++) {
+		struct ss_ep_stats *st = &stats[i];
+		s64 us = ktime_us_delta(st->last, st->first);
+		u64 kbps = 0;
+
+		if (!st->requests)
+			continue;
+		if (us > 0)
+			kbps = div64_u64(st->bytes * 1000, us);
+
+		len += scnprintf(page + len, PAGE_SIZE - len,
+				 "%s: requests %llu bytes %llu errors %llu KB/s %llu\n",
+				 ss_ep_names[i], st->requests, st->bytes,
+				 st->errors, kbps);
+		len += scnprintf(page + len, PAGE_SIZE - len,
+				 "%s: latency", ss_ep_names[i]);
+		for (j = 0; j < GZERO_SS_LAT_BUCKETS; j++)
+			len += scnprintf(page + len, PAGE_SIZE - len,
+					 " %u", st->latency[j]);
+		len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+static ssize_t f_ss_opts_stats_store(struct f_ss_opts *opts,
+				     const char *page, size_t len)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&opts->stats_lock, flags);
+	memset(opts->stats, 0, sizeof(opts->stats));
+	spin_unlock_irqrestore(&opts->stats_lock, flags);
+
+	return len;
+}
+
+static struct f_ss_opts_attribute f_ss_opts_stats =
+	__CONFIGFS_ATTR(stats, S_IRUGO | S_IWUSR,
+			f_ss_opts_stats_show,
+			f_ss_opts_stats_store);
+
 static struct configfs_attribute *ss_attrs[] = {
 	&f_ss_opts_pattern.attr,
 	&f_ss_opts_isoc_interval.attr,
@@ -1188,6 +1416,9 @@ static struct configfs_attribute *ss_attrs[] = {
 	&f_ss_opts_isoc_mult.attr,
 	&f_ss_opts_isoc_maxburst.attr,
 	&f_ss_opts_bulk_buflen.attr,
+	&f_ss_opts_bulk_qlen.attr,
+	&f_ss_opts_iso_qlen.attr,
+	&f_ss_opts_stats.attr,
 	NULL,
 };
 
@@ -1213,10 +1444,13 @@ static struct usb_function_instance *source_sink_alloc_inst(void)
 	if (!ss_opts)
 		return ERR_PTR(-ENOMEM);
 	mutex_init(&ss_opts->lock);
+	spin_lock_init(&ss_opts->stats_lock);
 	ss_opts->func_inst.free_func_inst = source_sink_free_instance;
 	ss_opts->isoc_interval = GZERO_ISOC_INTERVAL;
 	ss_opts->isoc_maxpacket = GZERO_ISOC_MAXPACKET;
 	ss_opts->bulk_buflen = GZERO_BULK_BUFLEN;
+	ss_opts->bulk_qlen = GZERO_SS_BULK_QLEN;
+	ss_opts->iso_qlen = GZERO_SS_ISO_QLEN;
 
 	config_group_init_type_name(&ss_opts->func_inst.group, "",
 				    &ss_func_type);
@@ -745,7 +745,7 @@ uvc_function_bind(struct usb_configuration *c, struct usb_function *f)
 	}
 
 	/* Initialise video. */
-	ret = uvcg_video_init(&uvc->video);
+	ret = uvcg_video_init(&uvc->video, cdev->gadget);
 	if (ret < 0)
 		goto error;
 
@@ -759,6 +759,7 @@ uvc_function_bind(struct usb_configuration *c, struct usb_function *f)
 	return 0;
 
 error:
+	uvcg_video_cleanup(&uvc->video);
 	v4l2_device_unregister(&uvc->v4l2_dev);
 
 	if (uvc->control_ep)
@@ -891,6 +892,7 @@ static void uvc_unbind(struct usb_configuration *c, struct usb_function *f)
 	INFO(cdev, "%s\n", __func__);
 
 	video_unregister_device(&uvc->vdev);
+	uvcg_video_cleanup(&uvc->video);
 	v4l2_device_unregister(&uvc->v4l2_dev);
 	uvc->control_ep->driver_data = NULL;
 	uvc->video.ep->driver_data = NULL;
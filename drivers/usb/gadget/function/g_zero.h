@@ -21,6 +21,29 @@ struct usb_zero_options {
 	unsigned qlen;
 };
 
+#define GZERO_SS_BULK_QLEN	1
+#define GZERO_SS_ISO_QLEN	8
+
+/* latency[n] counts requests turned around in under 2^n usec */
+#define GZERO_SS_LAT_BUCKETS	16
+
+enum {
+	GZERO_SS_EP_IN,
+	GZERO_SS_EP_OUT,
+	GZERO_SS_EP_ISO_IN,
+	GZERO_SS_EP_ISO_OUT,
+	GZERO_SS_NUM_EPS,
+};
+
+struct ss_ep_stats {
+	u64		requests;
+	u64		bytes;
+	u64		errors;
+	ktime_t		first;
+	ktime_t		last;
+	u32		latency[GZERO_SS_LAT_BUCKETS];
+};
+
 struct f_ss_opts {
 	struct usb_function_instance func_inst;
 	unsigned pattern;
@@ -29,6 +52,12 @@ struct f_ss_opts {
 	unsigned isoc_mult;
 	unsigned isoc_maxburst;
 	unsigned bulk_buflen;
+	unsigned bulk_qlen;
+	unsigned iso_qlen;
+
+	/* updated from completion handlers, hence the spinlock */
+	spinlock_t			stats_lock;
+	struct ss_ep_stats		stats[GZERO_SS_NUM_EPS];
 
 	/*
 	 * Read/write access to configfs attributes is handled by configfs.
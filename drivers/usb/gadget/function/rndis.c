@@ -568,10 +568,25 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 	rndis_init_cmplt_type *resp;
 	rndis_resp_t *r;
 	struct rndis_params *params = rndis_per_dev_params + configNr;
+	u32 pkt_size, max_pkts;
 
 	if (!params->dev)
 		return -ENOTSUPP;
 
+	/*
+	 * Never offer the host more than the OUT buffers hold, which can
+	 * happen when the MTU has been raised after they were sized.
+	 */
+	pkt_size = params->dev->mtu + sizeof(struct ethhdr) +
+		   sizeof(struct rndis_packet_msg_type) + 22;
+	max_pkts = params->max_pkt_per_xfer;
+	if (max_pkts > 1 && params->max_out_xfer)
+		max_pkts = clamp_t(u32, params->max_out_xfer / pkt_size,
+				   1, max_pkts);
+
+	/* what the host accepts per IN transfer, for packet batching */
+	params->host_max_xfer = le32_to_cpu(buf->MaxTransferSize);
+
 	r = rndis_add_response(configNr, sizeof(rndis_init_cmplt_type));
 	if (!r)
 		return -ENOMEM;
@@ -585,12 +600,8 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = cpu_to_le32(RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = cpu_to_le32(RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = cpu_to_le32(RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = cpu_to_le32(1);
-	resp->MaxTransferSize = cpu_to_le32(
-		  params->dev->mtu
-		+ sizeof(struct ethhdr)
-		+ sizeof(struct rndis_packet_msg_type)
-		+ 22);
+	resp->MaxPacketsPerTransfer = cpu_to_le32(max_pkts);
+	resp->MaxTransferSize = cpu_to_le32(max_pkts * pkt_size);
 	resp->PacketAlignmentFactor = cpu_to_le32(0);
 	resp->AFListOffset = cpu_to_le32(0);
 	resp->AFListSize = cpu_to_le32(0);
@@ -780,6 +791,7 @@ void rndis_uninit(int configNr)
 	if (configNr >= RNDIS_MAX_CONFIGS)
 		return;
 	rndis_per_dev_params[configNr].state = RNDIS_UNINITIALIZED;
+	rndis_per_dev_params[configNr].host_max_xfer = 0;
 
 	/* drain the response queue */
 	while ((buf = rndis_get_next_response(configNr, &length)))
@@ -888,6 +900,7 @@ int rndis_register(void (*resp_avail)(void *v), void *v)
 			rndis_per_dev_params[i].used = 1;
 			rndis_per_dev_params[i].resp_avail = resp_avail;
 			rndis_per_dev_params[i].v = v;
+			rndis_per_dev_params[i].max_pkt_per_xfer = 1;
 			pr_debug("%s: configNr = %d\n", __func__, i);
 			return i;
 		}
@@ -946,6 +959,33 @@ int rndis_set_param_medium(u8 configNr, u32 medium, u32 speed)
 }
 EXPORT_SYMBOL_GPL(rndis_set_param_medium);
 
+/*
+ * Number of concatenated REMOTE_NDIS_PACKET_MSGs the device accepts in one
+ * OUT transfer, and the size of its OUT buffers (0 if they only hold one
+ * packet); reported to the host in the INITIALIZE completion.
+ */
+void rndis_set_max_pkt_per_xfer(u8 configNr, u32 max_pkt_per_xfer,
+				u32 max_out_xfer)
+{
+	if (configNr >= RNDIS_MAX_CONFIGS)
+		return;
+
+	rndis_per_dev_params[configNr].max_pkt_per_xfer =
+		max_t(u32, max_pkt_per_xfer, 1);
+	rndis_per_dev_params[configNr].max_out_xfer = max_out_xfer;
+}
+EXPORT_SYMBOL_GPL(rndis_set_max_pkt_per_xfer);
+
+/* MaxTransferSize from the host's INITIALIZE message, 0 before it */
+u32 rndis_get_host_max_xfer(u8 configNr)
+{
+	if (configNr >= RNDIS_MAX_CONFIGS)
+		return 0;
+
+	return rndis_per_dev_params[configNr].host_max_xfer;
+}
+EXPORT_SYMBOL_GPL(rndis_get_host_max_xfer);
+
 void rndis_add_hdr(struct sk_buff *skb)
 {
 	struct rndis_packet_msg_type *header;
@@ -1021,25 +1061,58 @@ int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
-	/* tmp points to a struct rndis_packet_msg_type */
-	__le32 *tmp = (void *)skb->data;
+	struct sk_buff *skb2;
+	bool first = true;
 
-	/* MessageType, MessageLength */
-	if (cpu_to_le32(RNDIS_MSG_PACKET)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+	/*
+	 * The host may concatenate up to MaxPacketsPerTransfer messages in
+	 * one transfer; anything after the last valid one is padding.
+	 */
+	while (skb->len) {
+		/* tmp points to a struct rndis_packet_msg_type */
+		__le32 *tmp = (void *)skb->data;
+		u32 msg_len, data_offset, data_len;
+
+		/* MessageType, MessageLength */
+		if (skb->len < sizeof(struct rndis_packet_msg_type) ||
+		    cpu_to_le32(RNDIS_MSG_PACKET) != get_unaligned(tmp++)) {
+			if (!first)
+				break;
+			dev_kfree_skb_any(skb);
+			return -EINVAL;
+		}
+		msg_len = get_unaligned_le32(tmp++);
+
+		/* DataOffset, DataLength */
+		data_offset = get_unaligned_le32(tmp++) + 8;
+		data_len = get_unaligned_le32(tmp++);
+		if (data_offset + data_len > skb->len ||
+		    (msg_len && msg_len < data_offset + data_len)) {
+			dev_kfree_skb_any(skb);
+			return -EOVERFLOW;
+		}
+
+		if (!msg_len || msg_len >= skb->len) {
+			skb_pull(skb, data_offset);
+			skb_trim(skb, data_len);
+			skb_queue_tail(list, skb);
+			return 0;
+		}
+
+		skb2 = skb_clone(skb, GFP_ATOMIC);
+		if (!skb2) {
+			dev_kfree_skb_any(skb);
+			return -ENOMEM;
+		}
+		skb_pull(skb2, data_offset);
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		skb_pull(skb, msg_len);
+		first = false;
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
 
-	skb_queue_tail(list, skb);
+	dev_kfree_skb_any(skb);
 	return 0;
 }
 EXPORT_SYMBOL_GPL(rndis_rm_hdr);
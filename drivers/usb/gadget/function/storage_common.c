@@ -24,6 +24,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/backing-dev.h>
 #include <linux/blkdev.h>
 #include <linux/file.h>
 #include <linux/fs.h>
@@ -265,12 +266,22 @@ int fsg_lun_open(struct fsg_lun *curlun, const char *filename)
 	if (fsg_lun_is_open(curlun))
 		fsg_lun_close(curlun);
 
+	/*
+	 * The host reads the medium in long sequential runs; use the
+	 * same doubled readahead window as POSIX_FADV_SEQUENTIAL.
+	 */
+	spin_lock(&filp->f_lock);
+	filp->f_ra.ra_pages =
+		inode_to_bdi(filp->f_mapping->host)->ra_pages * 2;
+	spin_unlock(&filp->f_lock);
+
 	curlun->blksize = blksize;
 	curlun->blkbits = blkbits;
 	curlun->ro = ro;
 	curlun->filp = filp;
 	curlun->file_length = size;
 	curlun->num_sectors = num_sectors;
+	curlun->next_read_offset = -1;
 	LDBG(curlun, "open backing file: %s\n", filename);
 	return 0;
 
@@ -109,6 +109,7 @@ struct fsg_lun {
 	unsigned int	blkbits; /* Bits of logical block size
 						       of bound block device */
 	unsigned int	blksize; /* logical block size of bound block device */
+	loff_t		next_read_offset; /* expected start of the next READ */
 	struct device	dev;
 	const char	*name;		/* "lun.name" */
 	const char	**name_pfx;	/* "function.name" */
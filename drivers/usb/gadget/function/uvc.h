@@ -105,6 +105,21 @@ extern unsigned int uvc_gadget_trace_param;
  * Structures
  */
 
+struct uvc_video;
+
+struct uvc_request
+{
+	struct usb_request *req;
+	__u8 *req_buffer;
+	struct uvc_video *video;
+
+	/* Scatter-gather streaming: payload header and data pages */
+	struct sg_table sgt;
+	__u8 header[2];
+	/* Buffer whose last bytes this request carries */
+	struct uvc_buffer *last_buf;
+};
+
 struct uvc_video
 {
 	struct usb_ep *ep;
@@ -119,8 +134,7 @@ struct uvc_video
 
 	/* Requests */
 	unsigned int req_size;
-	struct usb_request *req[UVC_NUM_REQUESTS];
-	__u8 *req_buffer[UVC_NUM_REQUESTS];
+	struct uvc_request ureq[UVC_NUM_REQUESTS];
 	struct list_head req_free;
 	spinlock_t req_lock;
 
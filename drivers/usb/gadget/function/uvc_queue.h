@@ -5,6 +5,7 @@
 
 #include <linux/kernel.h>
 #include <linux/poll.h>
+#include <linux/scatterlist.h>
 #include <linux/videodev2.h>
 #include <media/videobuf2-core.h>
 
@@ -31,6 +32,9 @@ struct uvc_buffer {
 
 	enum uvc_buffer_state state;
 	void *mem;
+	struct sg_table *sgt;
+	struct scatterlist *sg;	/* Next sgt entry to send (scatter-gather) */
+	unsigned int offset;	/* Offset of the next byte in that entry */
 	unsigned int length;
 	unsigned int bytesused;
 };
@@ -47,6 +51,9 @@ struct uvc_video_queue {
 
 	unsigned int buf_used;
 
+	bool use_sg;		/* Buffers are sent in place (scatter-gather) */
+	void *alloc_ctx;
+
 	spinlock_t irqlock;	/* Protects flags and irqqueue */
 	struct list_head irqqueue;
 };
@@ -57,7 +64,9 @@ static inline int uvc_queue_streaming(struct uvc_video_queue *queue)
 }
 
 int uvcg_queue_init(struct uvc_video_queue *queue, enum v4l2_buf_type type,
-		    struct mutex *lock);
+		    struct mutex *lock, struct device *sg_dev);
+
+void uvcg_queue_cleanup(struct uvc_video_queue *queue);
 
 void uvcg_free_buffers(struct uvc_video_queue *queue);
 
@@ -85,6 +94,9 @@ void uvcg_queue_cancel(struct uvc_video_queue *queue, int disconnect);
 
 int uvcg_queue_enable(struct uvc_video_queue *queue, int enable);
 
+void uvcg_complete_buffer(struct uvc_video_queue *queue,
+			  struct uvc_buffer *buf);
+
 struct uvc_buffer *uvcg_queue_next_buffer(struct uvc_video_queue *queue,
 					  struct uvc_buffer *buf);
 
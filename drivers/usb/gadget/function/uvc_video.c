@@ -13,6 +13,7 @@
 #include <linux/kernel.h>
 #include <linux/device.h>
 #include <linux/errno.h>
+#include <linux/scatterlist.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 #include <linux/usb/video.h>
@@ -125,10 +126,87 @@ uvc_video_encode_isoc(struct usb_request *req, struct uvc_video *video,
 	}
 }
 
+/*
+ * Scatter-gather variant of uvc_video_encode_isoc(): the request carries the
+ * payload header from its own buffer followed by the video buffer pages, so
+ * the UDC reads the frame data in place.
+ */
+static void
+uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	struct uvc_request *ureq = req->context;
+	struct uvc_video_queue *queue = &video->queue;
+	struct scatterlist *sg = ureq->sgt.sgl;
+	unsigned int header_len;
+	unsigned int len;
+	unsigned int nents = 1;
+
+	sg_init_table(sg, ureq->sgt.orig_nents);
+
+	header_len = uvc_video_encode_header(video, buf, ureq->header,
+					     video->req_size);
+	sg_set_buf(sg, ureq->header, header_len);
+
+	len = min(video->req_size - header_len,
+		  buf->bytesused - queue->buf_used);
+	req->length = header_len + len;
+	queue->buf_used += len;
+
+	while (len) {
+		unsigned int offset = buf->sg->offset + buf->offset;
+		unsigned int part = min(len, buf->sg->length - buf->offset);
+		struct page *page = nth_page(sg_page(buf->sg),
+					     offset >> PAGE_SHIFT);
+
+		sg = sg_next(sg);
+		sg_set_page(sg, page, part, offset & ~PAGE_MASK);
+		nents++;
+
+		len -= part;
+		buf->offset += part;
+		if (buf->offset == buf->sg->length) {
+			buf->sg = sg_next(buf->sg);
+			buf->offset = 0;
+		}
+	}
+	sg_mark_end(sg);
+
+	req->sg = ureq->sgt.sgl;
+	req->num_sgs = nents;
+
+	if (buf->bytesused == queue->buf_used) {
+		/* Completed once the request is done with its pages. */
+		queue->buf_used = 0;
+		buf->state = UVC_BUF_STATE_DONE;
+		list_del(&buf->queue);
+		ureq->last_buf = buf;
+		video->fid ^= UVC_STREAM_FID;
+	}
+}
+
 /* --------------------------------------------------------------------------
  * Request handling
  */
 
+static void
+uvc_video_put_last_buf(struct uvc_request *ureq, bool error)
+{
+	struct uvc_video_queue *queue = &ureq->video->queue;
+	unsigned long flags;
+
+	if (ureq->last_buf == NULL)
+		return;
+
+	if (error)
+		ureq->last_buf->state = UVC_BUF_STATE_ERROR;
+
+	spin_lock_irqsave(&queue->irqlock, flags);
+	uvcg_complete_buffer(queue, ureq->last_buf);
+	spin_unlock_irqrestore(&queue->irqlock, flags);
+	ureq->last_buf = NULL;
+}
+
 /*
  * I somehow feel that synchronisation won't be easy to achieve here. We have
  * three events that control USB requests submission:
@@ -162,12 +240,15 @@ uvc_video_encode_isoc(struct usb_request *req, struct uvc_video *video,
 static void
 uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 {
-	struct uvc_video *video = req->context;
+	struct uvc_request *ureq = req->context;
+	struct uvc_video *video = ureq->video;
 	struct uvc_video_queue *queue = &video->queue;
 	struct uvc_buffer *buf;
 	unsigned long flags;
 	int ret;
 
+	uvc_video_put_last_buf(ureq, req->status != 0);
+
 	switch (req->status) {
 	case 0:
 		break;
@@ -197,6 +278,7 @@ uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 		printk(KERN_INFO "Failed to queue request (%d).\n", ret);
 		usb_ep_set_halt(ep);
 		spin_unlock_irqrestore(&video->queue.irqlock, flags);
+		uvc_video_put_last_buf(ureq, true);
 		uvcg_queue_cancel(queue, 0);
 		goto requeue;
 	}
@@ -216,15 +298,19 @@ uvc_video_free_requests(struct uvc_video *video)
 	unsigned int i;
 
 	for (i = 0; i < UVC_NUM_REQUESTS; ++i) {
-		if (video->req[i]) {
-			usb_ep_free_request(video->ep, video->req[i]);
-			video->req[i] = NULL;
+		struct uvc_request *ureq = &video->ureq[i];
+
+		if (ureq->req) {
+			usb_ep_free_request(video->ep, ureq->req);
+			ureq->req = NULL;
 		}
 
-		if (video->req_buffer[i]) {
-			kfree(video->req_buffer[i]);
-			video->req_buffer[i] = NULL;
+		if (ureq->req_buffer) {
+			kfree(ureq->req_buffer);
+			ureq->req_buffer = NULL;
 		}
+
+		sg_free_table(&ureq->sgt);
 	}
 
 	INIT_LIST_HEAD(&video->req_free);
@@ -246,20 +332,34 @@ uvc_video_alloc_requests(struct uvc_video *video)
 		 * (video->ep->mult + 1);
 
 	for (i = 0; i < UVC_NUM_REQUESTS; ++i) {
-		video->req_buffer[i] = kmalloc(req_size, GFP_KERNEL);
-		if (video->req_buffer[i] == NULL)
-			goto error;
+		struct uvc_request *ureq = &video->ureq[i];
+
+		/* The header entry, plus one per page the data may touch. */
+		if (video->queue.use_sg) {
+			ret = sg_alloc_table(&ureq->sgt,
+					DIV_ROUND_UP(req_size, PAGE_SIZE) + 2,
+					GFP_KERNEL);
+			if (ret < 0)
+				goto error;
+			ret = -ENOMEM;
+		} else {
+			ureq->req_buffer = kmalloc(req_size, GFP_KERNEL);
+			if (ureq->req_buffer == NULL)
+				goto error;
+		}
 
-		video->req[i] = usb_ep_alloc_request(video->ep, GFP_KERNEL);
-		if (video->req[i] == NULL)
+		ureq->req = usb_ep_alloc_request(video->ep, GFP_KERNEL);
+		if (ureq->req == NULL)
 			goto error;
 
-		video->req[i]->buf = video->req_buffer[i];
-		video->req[i]->length = 0;
-		video->req[i]->complete = uvc_video_complete;
-		video->req[i]->context = video;
+		ureq->video = video;
+		ureq->last_buf = NULL;
+		ureq->req->buf = ureq->req_buffer;
+		ureq->req->length = 0;
+		ureq->req->complete = uvc_video_complete;
+		ureq->req->context = ureq;
 
-		list_add_tail(&video->req[i]->list, &video->req_free);
+		list_add_tail(&ureq->req->list, &video->req_free);
 	}
 
 	video->req_size = req_size;
@@ -325,6 +425,7 @@ int uvcg_video_pump(struct uvc_video *video)
 			printk(KERN_INFO "Failed to queue request (%d)\n", ret);
 			usb_ep_set_halt(video->ep);
 			spin_unlock_irqrestore(&queue->irqlock, flags);
+			uvc_video_put_last_buf(req->context, true);
 			uvcg_queue_cancel(queue, 0);
 			break;
 		}
@@ -353,8 +454,8 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 
 	if (!enable) {
 		for (i = 0; i < UVC_NUM_REQUESTS; ++i)
-			if (video->req[i])
-				usb_ep_dequeue(video->ep, video->req[i]);
+			if (video->ureq[i].req)
+				usb_ep_dequeue(video->ep, video->ureq[i].req);
 
 		uvc_video_free_requests(video);
 		uvcg_queue_enable(&video->queue, 0);
@@ -370,16 +471,19 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 	if (video->max_payload_size) {
 		video->encode = uvc_video_encode_bulk;
 		video->payload_size = 0;
-	} else
+	} else if (video->queue.use_sg)
+		video->encode = uvc_video_encode_isoc_sg;
+	else
 		video->encode = uvc_video_encode_isoc;
 
 	return uvcg_video_pump(video);
 }
 
 /*
- * Initialize the UVC video stream.
+ * Initialize the UVC video stream. Frames are sent in place when the UDC
+ * accepts scatter-gather requests.
  */
-int uvcg_video_init(struct uvc_video *video)
+int uvcg_video_init(struct uvc_video *video, struct usb_gadget *gadget)
 {
 	INIT_LIST_HEAD(&video->req_free);
 	spin_lock_init(&video->req_lock);
@@ -391,8 +495,13 @@ int uvcg_video_init(struct uvc_video *video)
 	video->imagesize = 320 * 240 * 2;
 
 	/* Initialize the video buffers queue. */
-	uvcg_queue_init(&video->queue, V4L2_BUF_TYPE_VIDEO_OUTPUT,
-			&video->mutex);
-	return 0;
+	return uvcg_queue_init(&video->queue, V4L2_BUF_TYPE_VIDEO_OUTPUT,
+			       &video->mutex,
+			       gadget->sg_supported ? &gadget->dev : NULL);
+}
+
+void uvcg_video_cleanup(struct uvc_video *video)
+{
+	uvcg_queue_cleanup(&video->queue);
 }
 
@@ -19,6 +19,8 @@ int uvcg_video_pump(struct uvc_video *video);
 
 int uvcg_video_enable(struct uvc_video *video, int enable);
 
-int uvcg_video_init(struct uvc_video *video);
+int uvcg_video_init(struct uvc_video *video, struct usb_gadget *gadget);
+
+void uvcg_video_cleanup(struct uvc_video *video);
 
 #endif /* __UVC_VIDEO_H__ */
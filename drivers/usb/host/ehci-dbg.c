@@ -927,6 +927,13 @@ static ssize_t fill_registers_buffer(struct debug_buffer *buf)
 		ehci->stats.complete, ehci->stats.unlink);
 	size -= temp;
 	next += temp;
+
+	temp = scnprintf(next, size,
+		"periodic scans: intr %ld (%ld qh) isoc %ld (%ld frames)\n",
+		ehci->stats.intr_scan, ehci->stats.intr_qh,
+		ehci->stats.isoc_scan, ehci->stats.isoc_frame);
+	size -= temp;
+	next += temp;
 #endif
 
 done:
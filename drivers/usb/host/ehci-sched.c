@@ -854,8 +854,22 @@ done:
 	return retval;
 }
 
-/* "first fit" scheduling policy used the first time through,
- * or when the previous schedule slot can't be re-used.
+/* busiest uframe among the slots a periodic qh would occupy */
+static unsigned periodic_load(struct ehci_hcd *ehci, unsigned frame,
+		unsigned uframe, unsigned uperiod)
+{
+	unsigned	load = 0;
+
+	for (uframe += frame << 3; uframe < EHCI_BANDWIDTH_SIZE;
+			uframe += uperiod)
+		load = max_t(unsigned, load, ehci->bandwidth[uframe]);
+	return load;
+}
+
+/* "least loaded" scheduling policy used the first time through,
+ * or when the previous schedule slot can't be re-used.  Spreading
+ * interrupt qhs over the frames keeps any one frame's periodic list
+ * (and the completions it raises) short when many devices poll.
  */
 static int qh_schedule(struct ehci_hcd *ehci, struct ehci_qh *qh)
 {
@@ -888,18 +902,38 @@ static int qh_schedule(struct ehci_hcd *ehci, struct ehci_qh *qh)
 	/* "normal" case, uframing flexible except with splits */
 	if (qh->ps.bw_period) {
 		int		i;
-		unsigned	frame;
+		unsigned	frame, load;
+		unsigned	best_load = UINT_MAX;
+		unsigned	best_random = 0, best_uframe = 0;
+		unsigned	best_c_mask = 0;
 
 		for (i = qh->ps.bw_period; i > 0; --i) {
 			frame = ++ehci->random_frame & (qh->ps.bw_period - 1);
 			for (uframe = 0; uframe < 8; uframe++) {
-				status = check_intr_schedule(ehci,
-						frame, uframe, qh, &c_mask, tt);
-				if (status == 0)
-					goto got_it;
+				if (check_intr_schedule(ehci, frame, uframe,
+						qh, &c_mask, tt))
+					continue;
+				load = periodic_load(ehci, frame, uframe,
+						qh->ps.bw_uperiod);
+				if (load < best_load) {
+					best_load = load;
+					best_random = ehci->random_frame;
+					best_uframe = uframe;
+					best_c_mask = c_mask;
+				}
 			}
 		}
 
+		status = -ENOSPC;
+		if (best_load != UINT_MAX) {
+			/* the phase below is taken from random_frame */
+			ehci->random_frame = best_random;
+			uframe = best_uframe;
+			c_mask = best_c_mask;
+			status = 0;
+			goto got_it;
+		}
+
 	/* qh->ps.bw_period == 0 means every uframe */
 	} else {
 		status = check_intr_schedule(ehci, 0, 0, qh, &c_mask, tt);
@@ -993,8 +1027,10 @@ static void scan_intr(struct ehci_hcd *ehci)
 {
 	struct ehci_qh		*qh;
 
+	COUNT(ehci->stats.intr_scan);
 	list_for_each_entry_safe(qh, ehci->qh_scan_next, &ehci->intr_qh_list,
 			intr_node) {
+		COUNT(ehci->stats.intr_qh);
 
 		/* clean any finished work for this qh */
 		if (!list_empty(&qh->qtd_list)) {
@@ -2398,11 +2434,13 @@ static void scan_isoc(struct ehci_hcd *ehci)
 	}
 	ehci->now_frame = now_frame;
 
+	COUNT(ehci->stats.isoc_scan);
 	frame = ehci->last_iso_frame;
 	for (;;) {
 		union ehci_shadow	q, *q_p;
 		__hc32			type, *hw_p;
 
+		COUNT(ehci->stats.isoc_frame);
 restart:
 		/* scan each element in frame's queue for completions */
 		q_p = &ehci->pshadow [frame];
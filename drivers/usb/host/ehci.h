@@ -52,6 +52,12 @@ struct ehci_stats {
 	/* termination of urbs from core */
 	unsigned long		complete;
 	unsigned long		unlink;
+
+	/* periodic schedule scans */
+	unsigned long		intr_scan;
+	unsigned long		intr_qh;
+	unsigned long		isoc_scan;
+	unsigned long		isoc_frame;
 };
 
 /*
@@ -0,0 +1,178 @@
+/*
+ *  NEON accelerated paths for the generic fillrect and copyarea functions.
+ *
+ *  Copyright 2016 Freescale Semiconductor, Inc.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License.  See the file COPYING in the main directory of this archive for
+ *  more details.
+ *
+ *  Only the simple, common cases are handled here: 8, 16 and 32 bpp, solid
+ *  ROP_COPY fills and copies between different lines, which covers console
+ *  scrolling and clearing. Everything else falls through to the bitwise
+ *  implementations in cfbfillrect.c and cfbcopyarea.c.
+ *
+ *  A framebuffer mapped as device memory faults on the unaligned NEON
+ *  accesses, so drivers opt in with FBINFO_CFB_NEON once they know their
+ *  framebuffer is normal memory.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/fb.h>
+#include <asm/neon.h>
+#include "fb_draw.h"
+#include "cfb_neon.h"
+
+/* below this many bytes per line the NEON setup is not worth it */
+#define CFB_NEON_MIN_LEN	64
+
+#define CFB_NEON_BENCH_SIZE	(16 * 1024)
+#define CFB_NEON_BENCH_LOOPS	64
+
+void cfb_neon_fill_real(unsigned char *dst, unsigned int pat,
+			unsigned long len, unsigned int height, long pitch);
+void cfb_neon_copy_real(unsigned char *dst, const unsigned char *src,
+			unsigned long len, unsigned int height, long pitch);
+
+static bool cfb_neon_enabled;
+module_param_named(enable, cfb_neon_enabled, bool, 0644);
+MODULE_PARM_DESC(enable, "Use NEON for fillrect/copyarea (set by benchmark)");
+
+static bool cfb_neon_usable(struct fb_info *p)
+{
+	u32 bpp = p->var.bits_per_pixel;
+
+	if (!cfb_neon_enabled || !(p->flags & FBINFO_CFB_NEON) ||
+	    in_interrupt())
+		return false;
+
+	if (bpp != 8 && bpp != 16 && bpp != 32)
+		return false;
+
+	return !fb_be_math(p) && !fb_compute_bswapmask(p);
+}
+
+bool cfb_neon_fillrect(struct fb_info *p, const struct fb_fillrect *rect,
+		       u32 pat)
+{
+	unsigned long len = rect->width * (p->var.bits_per_pixel >> 3);
+	unsigned char *dst;
+
+	if (len < CFB_NEON_MIN_LEN || !cfb_neon_usable(p))
+		return false;
+
+	dst = (unsigned char __force *)p->screen_base +
+	      rect->dy * p->fix.line_length +
+	      rect->dx * (p->var.bits_per_pixel >> 3);
+
+	kernel_neon_begin();
+	cfb_neon_fill_real(dst, pat, len, rect->height, p->fix.line_length);
+	kernel_neon_end();
+
+	return true;
+}
+EXPORT_SYMBOL(cfb_neon_fillrect);
+
+bool cfb_neon_copyarea(struct fb_info *p, const struct fb_copyarea *area)
+{
+	unsigned long bytespp = p->var.bits_per_pixel >> 3;
+	unsigned long len = area->width * bytespp;
+	long pitch = p->fix.line_length;
+	unsigned char *dst, *src;
+	u32 dy = area->dy, sy = area->sy;
+
+	/*
+	 * Lines are copied front to back, so source and destination must
+	 * not share a line; overlapping areas are handled by walking the
+	 * lines bottom up when moving down.
+	 */
+	if (dy == sy || len < CFB_NEON_MIN_LEN || !cfb_neon_usable(p))
+		return false;
+
+	if (dy > sy) {
+		dy += area->height - 1;
+		sy += area->height - 1;
+		pitch = -pitch;
+	}
+
+	dst = (unsigned char __force *)p->screen_base +
+	      dy * p->fix.line_length + area->dx * bytespp;
+	src = (unsigned char __force *)p->screen_base +
+	      sy * p->fix.line_length + area->sx * bytespp;
+
+	kernel_neon_begin();
+	cfb_neon_copy_real(dst, src, len, area->height, pitch);
+	kernel_neon_end();
+
+	return true;
+}
+EXPORT_SYMBOL(cfb_neon_copyarea);
+
+static void cfb_neon_bench_fill_generic(unsigned char *dst, u32 pat,
+					unsigned long len)
+{
+	u32 *d = (u32 *)dst;
+
+	for (len >>= 2; len; len--)
+		*d++ = pat;
+}
+
+static void cfb_neon_bench_fill_neon(unsigned char *dst, u32 pat,
+				     unsigned long len)
+{
+	kernel_neon_begin();
+	cfb_neon_fill_real(dst, pat, len, 1, 0);
+	kernel_neon_end();
+}
+
+static u64 cfb_neon_bench(void (*fill)(unsigned char *, u32, unsigned long),
+			  unsigned char *buf)
+{
+	ktime_t start;
+	s64 ns;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < CFB_NEON_BENCH_LOOPS; i++)
+		fill(buf, 0x5a5a5a5a + i, CFB_NEON_BENCH_SIZE);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	/* MB/s */
+	return div64_u64((u64)CFB_NEON_BENCH_SIZE * CFB_NEON_BENCH_LOOPS *
+			 1000, max_t(s64, ns, 1));
+}
+
+/*
+ * Select the NEON paths only if they beat the plain word loop on this
+ * CPU. The benchmark runs on cached memory, so it only approximates the
+ * gain on a write-combined framebuffer, where wide stores matter most.
+ */
+static int __init cfb_neon_init(void)
+{
+	unsigned char *buf;
+	u64 generic, neon;
+
+	if (!cpu_has_neon())
+		return 0;
+
+	buf = kmalloc(CFB_NEON_BENCH_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	/* warm up the cache with one pass before timing */
+	cfb_neon_bench_fill_generic(buf, 0, CFB_NEON_BENCH_SIZE);
+	generic = cfb_neon_bench(cfb_neon_bench_fill_generic, buf);
+	neon = cfb_neon_bench(cfb_neon_bench_fill_neon, buf);
+	kfree(buf);
+
+	cfb_neon_enabled = neon > generic;
+	pr_info("cfb_neon: fill %llu MB/s generic, %llu MB/s neon, using %s\n",
+		generic, neon, cfb_neon_enabled ? "neon" : "generic");
+
+	return 0;
+}
+late_initcall(cfb_neon_init);
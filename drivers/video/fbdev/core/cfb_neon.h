@@ -0,0 +1,25 @@
+#ifndef _CFB_NEON_H
+#define _CFB_NEON_H
+
+#include <linux/fb.h>
+
+#ifdef CONFIG_FB_CFB_NEON
+extern bool cfb_neon_fillrect(struct fb_info *p,
+			      const struct fb_fillrect *rect, u32 pat);
+extern bool cfb_neon_copyarea(struct fb_info *p,
+			      const struct fb_copyarea *area);
+#else
+static inline bool cfb_neon_fillrect(struct fb_info *p,
+				     const struct fb_fillrect *rect, u32 pat)
+{
+	return false;
+}
+
+static inline bool cfb_neon_copyarea(struct fb_info *p,
+				     const struct fb_copyarea *area)
+{
+	return false;
+}
+#endif
+
+#endif /* _CFB_NEON_H */
@@ -0,0 +1,97 @@
+/*
+ *  NEON inner loops for the generic fillrect and copyarea functions.
+ *
+ *  Copyright 2016 Freescale Semiconductor, Inc.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License.  See the file COPYING in the main directory of this archive for
+ *  more details.
+ *
+ *  This file is built with -mfpu=neon and must only be entered between
+ *  kernel_neon_begin() and kernel_neon_end(). The GCC arm_neon.h header is
+ *  not compatible with the kernel headers, so none are included here.
+ */
+
+#include <arm_neon.h>
+
+void cfb_neon_fill_real(unsigned char *dst, unsigned int pat,
+			unsigned long len, unsigned int height, long pitch);
+void cfb_neon_copy_real(unsigned char *dst, const unsigned char *src,
+			unsigned long len, unsigned int height, long pitch);
+
+/*
+ * The pattern repeats every four bytes counted from the start of the row,
+ * which always lies on a pixel boundary.
+ */
+static inline unsigned char pat_byte(unsigned int pat, unsigned long i)
+{
+	return pat >> ((i & 3) * 8);
+}
+
+static inline unsigned int pat_ror(unsigned int pat, unsigned long i)
+{
+	unsigned int s = (i & 3) * 8;
+
+	return s ? (pat >> s) | (pat << (32 - s)) : pat;
+}
+
+void cfb_neon_fill_real(unsigned char *dst, unsigned int pat,
+			unsigned long len, unsigned int height, long pitch)
+{
+	while (height--) {
+		unsigned char *d = dst;
+		unsigned long i = 0;
+		uint32x4_t v;
+
+		for (; i < len && ((unsigned long)d & 15); i++, d++)
+			*d = pat_byte(pat, i);
+
+		v = vdupq_n_u32(pat_ror(pat, i));
+		for (; i + 64 <= len; i += 64, d += 64) {
+			vst1q_u32((uint32_t *)d, v);
+			vst1q_u32((uint32_t *)(d + 16), v);
+			vst1q_u32((uint32_t *)(d + 32), v);
+			vst1q_u32((uint32_t *)(d + 48), v);
+		}
+		for (; i + 16 <= len; i += 16, d += 16)
+			vst1q_u32((uint32_t *)d, v);
+
+		for (; i < len; i++, d++)
+			*d = pat_byte(pat, i);
+
+		dst += pitch;
+	}
+}
+
+void cfb_neon_copy_real(unsigned char *dst, const unsigned char *src,
+			unsigned long len, unsigned int height, long pitch)
+{
+	while (height--) {
+		unsigned char *d = dst;
+		const unsigned char *s = src;
+		unsigned long n = len;
+
+		for (; n && ((unsigned long)d & 15); n--)
+			*d++ = *s++;
+
+		for (; n >= 64; n -= 64, d += 64, s += 64) {
+			uint8x16_t a = vld1q_u8(s);
+			uint8x16_t b = vld1q_u8(s + 16);
+			uint8x16_t c = vld1q_u8(s + 32);
+			uint8x16_t e = vld1q_u8(s + 48);
+
+			vst1q_u8(d, a);
+			vst1q_u8(d + 16, b);
+			vst1q_u8(d + 32, c);
+			vst1q_u8(d + 48, e);
+		}
+		for (; n >= 16; n -= 16, d += 16, s += 16)
+			vst1q_u8(d, vld1q_u8(s));
+
+		while (n--)
+			*d++ = *s++;
+
+		dst += pitch;
+		src += pitch;
+	}
+}
@@ -29,6 +29,7 @@
 #include <asm/types.h>
 #include <asm/io.h>
 #include "fb_draw.h"
+#include "cfb_neon.h"
 
 #if BITS_PER_LONG == 32
 #  define FB_WRITEL fb_writel
@@ -410,6 +411,9 @@ void cfb_copyarea(struct fb_info *p, const struct fb_copyarea *area)
 	if (p->fbops->fb_sync)
 		p->fbops->fb_sync(p);
 
+	if (cfb_neon_copyarea(p, area))
+		return;
+
 	if (rev_copy) {
 		while (height--) {
 			dst_idx -= bits_per_line;
@@ -18,6 +18,7 @@
 #include <linux/fb.h>
 #include <asm/types.h>
 #include "fb_draw.h"
+#include "cfb_neon.h"
 
 #if BITS_PER_LONG == 32
 #  define FB_WRITEL fb_writel
@@ -302,6 +303,8 @@ void cfb_fillrect(struct fb_info *p, const struct fb_fillrect *rect)
 	left = bits % bpp;
 	if (p->fbops->fb_sync)
 		p->fbops->fb_sync(p);
+	if (rect->rop == ROP_COPY && cfb_neon_fillrect(p, rect, pat))
+		return;
 	if (!left) {
 		u32 bswapmask = fb_compute_bswapmask(p);
 		void (*fill_op32)(struct fb_info *p,
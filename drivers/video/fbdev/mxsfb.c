@@ -24,7 +24,8 @@
  * @brief LCDIF driver for i.MX23 and i.MX28
  *
  * The LCDIF support four modes of operation
- * - MPU interface (to drive smart displays) -> not supported yet
+ * - MPU interface (to drive smart displays) -> DCS command mode panels only,
+ *   refreshed on pan or through MXCFB_SET_UPDATE_RECT
  * - VSYNC interface (like MPU interface plus Vsync) -> not supported yet
  * - Dotclock interface (to drive LC displays with RGB data and sync signals)
  * - DVI (to drive ITU-R BT656)  -> not supported yet
@@ -41,6 +42,7 @@
 
 #include <linux/busfreq-imx.h>
 #include <linux/console.h>
+#include <linux/delay.h>
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/of_device.h>
@@ -50,16 +52,25 @@
 #include <linux/interrupt.h>
 #include <linux/clk.h>
 #include <linux/dma-mapping.h>
+#include <linux/file.h>
 #include <linux/io.h>
 #include <linux/pinctrl/consumer.h>
 #include <linux/fb.h>
 #include <linux/mxcfb.h>
 #include <linux/regulator/consumer.h>
+#include <video/mipi_display.h>
 #include <video/of_display_timing.h>
 #include <video/videomode.h>
 #include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 #include "mxc/mxc_dispdrv.h"
+#ifdef CONFIG_SW_SYNC
+#include "../../staging/android/sw_sync.h"
+#endif
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/mxsfb.h>
 
 #define REG_SET	4
 #define REG_CLR	8
@@ -130,6 +141,16 @@
 
 #define CTRL2_OUTSTANDING_REQS__REQ_16		(3 << 21)
 
+/* command mode bus timing, in pixel clock cycles */
+#define TIMING_CMD_HOLD(x)		(((x) & 0xff) << 24)
+#define TIMING_CMD_SETUP(x)		(((x) & 0xff) << 16)
+#define TIMING_DATA_HOLD(x)		(((x) & 0xff) << 8)
+#define TIMING_DATA_SETUP(x)		((x) & 0xff)
+#define TIMING_DEFAULT			(TIMING_CMD_HOLD(2) | \
+					 TIMING_CMD_SETUP(2) | \
+					 TIMING_DATA_HOLD(2) | \
+					 TIMING_DATA_SETUP(2))
+
 #define TRANSFER_COUNT_SET_VCOUNT(x)	(((x) & 0xffff) << 16)
 #define TRANSFER_COUNT_GET_VCOUNT(x)	(((x) >> 16) & 0xffff)
 #define TRANSFER_COUNT_SET_HCOUNT(x)	((x) & 0xffff)
@@ -192,6 +213,7 @@ struct mxsfb_devdata {
 	unsigned transfer_count;
 	unsigned cur_buf;
 	unsigned next_buf;
+	unsigned data;
 	unsigned debug0;
 	unsigned hs_wdth_mask;
 	unsigned hs_wdth_shift;
@@ -224,6 +246,16 @@ struct mxsfb_info {
 	struct mxc_dispdrv_handle *dispdrv;
 	int id;
 	struct fb_var_screeninfo var;
+	/* MPU (command mode) interface */
+	bool mpu_mode;
+	u32 mpu_timing;
+	u32 mpu_ctrl;		/* LCDC_CTRL for pixel data transfers */
+	u32 byte_packaging;
+	struct mutex mpu_lock;	/* serialises command mode transfers */
+	/* MXCFB_FLIP_FENCED, set up on first use */
+	struct workqueue_struct *flip_wq;
+	struct sw_sync_timeline *timeline;
+	u32 flip_seqno;
 };
 
 #define mxsfb_is_v3(host) (host->devdata->ipversion == 3)
@@ -234,6 +266,7 @@ static const struct mxsfb_devdata mxsfb_devdata[] = {
 		.transfer_count = LCDC_V3_TRANSFER_COUNT,
 		.cur_buf = LCDC_V3_CUR_BUF,
 		.next_buf = LCDC_V3_NEXT_BUF,
+		.data = LCDC_V3_DATA,
 		.debug0 = LCDC_V3_DEBUG0,
 		.hs_wdth_mask = 0xff,
 		.hs_wdth_shift = 24,
@@ -243,6 +276,7 @@ static const struct mxsfb_devdata mxsfb_devdata[] = {
 		.transfer_count = LCDC_V4_TRANSFER_COUNT,
 		.cur_buf = LCDC_V4_CUR_BUF,
 		.next_buf = LCDC_V4_NEXT_BUF,
+		.data = LCDC_V4_DATA,
 		.debug0 = LCDC_V4_DEBUG0,
 		.hs_wdth_mask = 0x3fff,
 		.hs_wdth_shift = 18,
@@ -404,6 +438,7 @@ static irqreturn_t mxsfb_irq_handler(int irq, void *dev_id)
 	enable = (ctrl1 & CTRL1_IRQ_ENABLE_MASK) >> CTRL1_IRQ_ENABLE_SHIFT;
 	status = (ctrl1 & CTRL1_IRQ_STATUS_MASK) >> CTRL1_IRQ_STATUS_SHIFT;
 	acked_status = (enable & status) << CTRL1_IRQ_STATUS_SHIFT;
+	trace_mxsfb_irq(host->fb_info->node, acked_status);
 
 	if ((acked_status & CTRL1_VSYNC_EDGE_IRQ) && host->wait4vsync) {
 		writel(CTRL1_VSYNC_EDGE_IRQ,
@@ -499,6 +534,158 @@ static int mxsfb_check_var(struct fb_var_screeninfo *var,
 	return 0;
 }
 
+/*
+ * MPU interface support for DCS command mode panels. The panel keeps its
+ * own frame memory, so the controller only transfers pixels when the
+ * picture changes instead of scanning out the whole frame continuously.
+ */
+
+/* wait for the command mode pixel transfer started last to finish */
+static int mxsfb_mpu_wait_idle(struct mxsfb_info *host)
+{
+	if (!(readl(host->base + LCDC_CTRL) & CTRL_RUN))
+		return 0;
+
+	if (!wait_for_completion_timeout(&host->flip_complete, HZ / 2) &&
+	    (readl(host->base + LCDC_CTRL) & CTRL_RUN)) {
+		dev_err(&host->pdev->dev, "mxs mpu transfer timeout\n");
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+/* a single word written by PIO through the DATA register */
+static int mxsfb_mpu_write(struct mxsfb_info *host, u32 val, bool data)
+{
+	unsigned loop = 1000;
+
+	writel(CTRL_DATA_SELECT, host->base + LCDC_CTRL +
+	       (data ? REG_SET : REG_CLR));
+	writel(TRANSFER_COUNT_SET_VCOUNT(1) | TRANSFER_COUNT_SET_HCOUNT(1),
+	       host->base + host->devdata->transfer_count);
+	writel(CTRL_RUN, host->base + LCDC_CTRL + REG_SET);
+	writel(val, host->base + host->devdata->data);
+
+	while (readl(host->base + LCDC_CTRL) & CTRL_RUN) {
+		if (!--loop) {
+			dev_err(&host->pdev->dev, "mxs mpu write timeout\n");
+			return -ETIMEDOUT;
+		}
+		udelay(1);
+	}
+
+	return 0;
+}
+
+/* send a DCS command and its parameters, 8 bits per bus cycle */
+static int mxsfb_mpu_cmd(struct mxsfb_info *host, u8 cmd,
+			 const u8 *params, int len)
+{
+	int i, ret;
+
+	writel(CTRL_SET_BUS_WIDTH(host->ld_intf_width) |
+	       CTRL_SET_WORD_LENGTH(1), host->base + LCDC_CTRL);
+	writel(CTRL1_SET_BYTE_PACKAGING(0xf), host->base + LCDC_CTRL1 + REG_CLR);
+	writel(CTRL1_SET_BYTE_PACKAGING(0x1), host->base + LCDC_CTRL1 + REG_SET);
+
+	ret = mxsfb_mpu_write(host, cmd, false);
+	for (i = 0; !ret && i < len; i++)
+		ret = mxsfb_mpu_write(host, params[i], true);
+
+	return ret;
+}
+
+/*
+ * Refresh lines [top, top + height) of the panel from the current
+ * framebuffer. There is no stride register, so the DMA can only fetch
+ * whole lines: the column window always spans the full width.
+ * The transfer runs in the background, mxsfb_mpu_wait_idle() waits for it.
+ */
+static int mxsfb_mpu_update(struct mxsfb_info *host, u32 top, u32 height)
+{
+	struct fb_info *fb_info = host->fb_info;
+	u32 xend = fb_info->var.xres - 1;
+	u32 yend = top + height - 1;
+	u8 col[4] = { 0, 0, xend >> 8, xend & 0xff };
+	u8 page[4] = { top >> 8, top & 0xff, yend >> 8, yend & 0xff };
+	unsigned offset;
+	int ret;
+
+	mutex_lock(&host->mpu_lock);
+
+	ret = mxsfb_mpu_wait_idle(host);
+	if (!ret)
+		ret = mxsfb_mpu_cmd(host, MIPI_DCS_SET_COLUMN_ADDRESS, col, 4);
+	if (!ret)
+		ret = mxsfb_mpu_cmd(host, MIPI_DCS_SET_PAGE_ADDRESS, page, 4);
+	if (!ret)
+		ret = mxsfb_mpu_cmd(host, MIPI_DCS_WRITE_MEMORY_START, NULL, 0);
+	if (ret)
+		goto out;
+
+	offset = fb_info->fix.line_length * (fb_info->var.yoffset + top);
+
+	writel(host->mpu_ctrl | CTRL_DATA_SELECT | CTRL_MASTER,
+	       host->base + LCDC_CTRL);
+	writel(CTRL1_SET_BYTE_PACKAGING(0xf), host->base + LCDC_CTRL1 + REG_CLR);
+	writel(CTRL1_SET_BYTE_PACKAGING(host->byte_packaging),
+	       host->base + LCDC_CTRL1 + REG_SET);
+	writel(TRANSFER_COUNT_SET_VCOUNT(height) |
+	       TRANSFER_COUNT_SET_HCOUNT(fb_info->var.xres),
+	       host->base + host->devdata->transfer_count);
+	writel(fb_info->fix.smem_start + offset,
+	       host->base + host->devdata->cur_buf);
+	writel(fb_info->fix.smem_start + offset,
+	       host->base + host->devdata->next_buf);
+
+	init_completion(&host->flip_complete);
+	writel(CTRL1_CUR_FRAME_DONE_IRQ, host->base + LCDC_CTRL1 + REG_CLR);
+	writel(CTRL1_CUR_FRAME_DONE_IRQ_EN,
+	       host->base + LCDC_CTRL1 + REG_SET);
+	writel(CTRL_RUN, host->base + LCDC_CTRL + REG_SET);
+
+out:
+	mutex_unlock(&host->mpu_lock);
+	return ret;
+}
+
+static void mxsfb_mpu_panel_on(struct mxsfb_info *host)
+{
+	struct fb_info *fb_info = host->fb_info;
+	u8 fmt;
+
+	if (fb_info->var.bits_per_pixel == 16)
+		fmt = 0x55;
+	else if (host->ld_intf_width == STMLCDIF_24BIT)
+		fmt = 0x77;
+	else
+		fmt = 0x66;
+
+	writel(host->mpu_timing, host->base + LCDC_TIMING);
+
+	mutex_lock(&host->mpu_lock);
+	mxsfb_mpu_cmd(host, MIPI_DCS_EXIT_SLEEP_MODE, NULL, 0);
+	msleep(120);
+	mxsfb_mpu_cmd(host, MIPI_DCS_SET_PIXEL_FORMAT, &fmt, 1);
+	mxsfb_mpu_cmd(host, MIPI_DCS_SET_DISPLAY_ON, NULL, 0);
+	mutex_unlock(&host->mpu_lock);
+
+	mxsfb_mpu_update(host, 0, fb_info->var.yres);
+}
+
+static void mxsfb_mpu_panel_off(struct mxsfb_info *host)
+{
+	mutex_lock(&host->mpu_lock);
+	if (!mxsfb_mpu_wait_idle(host)) {
+		mxsfb_mpu_cmd(host, MIPI_DCS_SET_DISPLAY_OFF, NULL, 0);
+		mxsfb_mpu_cmd(host, MIPI_DCS_ENTER_SLEEP_MODE, NULL, 0);
+	}
+	writel(CTRL1_CUR_FRAME_DONE_IRQ_EN,
+	       host->base + LCDC_CTRL1 + REG_CLR);
+	mutex_unlock(&host->mpu_lock);
+}
+
 static void mxsfb_enable_controller(struct fb_info *fb_info)
 {
 	struct mxsfb_info *host = fb_info->par;
@@ -550,6 +737,12 @@ static void mxsfb_enable_controller(struct fb_info *fb_info)
 	writel(CTRL2_OUTSTANDING_REQS__REQ_16,
 		host->base + LCDC_V4_CTRL2 + REG_SET);
 
+	if (host->mpu_mode) {
+		mxsfb_mpu_panel_on(host);
+		host->enabled = 1;
+		return;
+	}
+
 	/* if it was disabled, re-enable the mode again */
 	writel(CTRL_DOTCLK_MODE, host->base + LCDC_CTRL + REG_SET);
 
@@ -586,24 +779,29 @@ static void mxsfb_disable_controller(struct fb_info *fb_info)
 	if (host->dispdrv && host->dispdrv->drv->disable)
 		host->dispdrv->drv->disable(host->dispdrv, fb_info);
 
-	/*
-	 * Even if we disable the controller here, it will still continue
-	 * until its FIFOs are running out of data
-	 */
-	writel(CTRL_DOTCLK_MODE, host->base + LCDC_CTRL + REG_CLR);
-
-	loop = 1000;
-	while (loop) {
-		reg = readl(host->base + LCDC_CTRL);
-		if (!(reg & CTRL_RUN))
-			break;
-		loop--;
-	}
+	if (host->mpu_mode) {
+		mxsfb_mpu_panel_off(host);
+	} else {
+		/*
+		 * Even if we disable the controller here, it will still
+		 * continue until its FIFOs are running out of data
+		 */
+		writel(CTRL_DOTCLK_MODE, host->base + LCDC_CTRL + REG_CLR);
+
+		loop = 1000;
+		while (loop) {
+			reg = readl(host->base + LCDC_CTRL);
+			if (!(reg & CTRL_RUN))
+				break;
+			loop--;
+		}
 
-	writel(CTRL_MASTER, host->base + LCDC_CTRL + REG_CLR);
+		writel(CTRL_MASTER, host->base + LCDC_CTRL + REG_CLR);
 
-	reg = readl(host->base + LCDC_VDCTRL4);
-	writel(reg & ~VDCTRL4_SYNC_SIGNALS_ON, host->base + LCDC_VDCTRL4);
+		reg = readl(host->base + LCDC_VDCTRL4);
+		writel(reg & ~VDCTRL4_SYNC_SIGNALS_ON,
+		       host->base + LCDC_VDCTRL4);
+	}
 
 	host->enabled = 0;
 
@@ -690,6 +888,7 @@ static int mxsfb_set_par(struct fb_info *fb_info)
 	case 16:
 		dev_dbg(&host->pdev->dev, "Setting up RGB565 mode\n");
 		ctrl |= CTRL_SET_WORD_LENGTH(0);
+		host->byte_packaging = 0xf;
 		writel(CTRL1_SET_BYTE_PACKAGING(0xf), host->base + LCDC_CTRL1);
 		break;
 	case 32:
@@ -718,6 +917,7 @@ static int mxsfb_set_par(struct fb_info *fb_info)
 			break;
 		}
 		/* do not use packed pixels = one pixel per word instead */
+		host->byte_packaging = 0x7;
 		writel(CTRL1_SET_BYTE_PACKAGING(0x7), host->base + LCDC_CTRL1);
 		break;
 	default:
@@ -726,6 +926,12 @@ static int mxsfb_set_par(struct fb_info *fb_info)
 		return -EINVAL;
 	}
 
+	if (host->mpu_mode) {
+		/* command mode: each update starts its own transfer */
+		ctrl &= ~(CTRL_BYPASS_COUNT | CTRL_MASTER);
+		host->mpu_ctrl = ctrl;
+	}
+
 	writel(ctrl, host->base + LCDC_CTRL);
 
 	writel(TRANSFER_COUNT_SET_VCOUNT(fb_info->var.yres) |
@@ -838,6 +1044,14 @@ static int mxsfb_wait_for_vsync(struct fb_info *fb_info)
 		return -EINVAL;
 	}
 
+	/* no VSYNC on a command mode panel, wait for the last update */
+	if (host->mpu_mode) {
+		mutex_lock(&host->mpu_lock);
+		ret = mxsfb_mpu_wait_idle(host);
+		mutex_unlock(&host->mpu_lock);
+		return ret;
+	}
+
 	init_completion(&host->vsync_complete);
 
 	host->wait4vsync = 1;
@@ -856,6 +1070,174 @@ static int mxsfb_wait_for_vsync(struct fb_info *fb_info)
 	return ret;
 }
 
+static int mxsfb_update_rect(struct fb_info *fb_info,
+			     struct mxcfb_rect *rect)
+{
+	struct mxsfb_info *host = fb_info->par;
+
+	if (host->cur_blank != FB_BLANK_UNBLANK)
+		return -EINVAL;
+
+	if (!rect->width || !rect->height ||
+	    rect->left >= fb_info->var.xres ||
+	    rect->width > fb_info->var.xres - rect->left ||
+	    rect->top >= fb_info->var.yres ||
+	    rect->height > fb_info->var.yres - rect->top)
+		return -EINVAL;
+
+	/* a DOTCLK panel is refreshed every frame anyway */
+	if (!host->mpu_mode)
+		return 0;
+
+	return mxsfb_mpu_update(host, rect->top, rect->height);
+}
+
+#ifdef CONFIG_SW_SYNC
+/* how long a fenced flip waits for its buffer before going ahead */
+#define MXSFB_FENCE_TIMEOUT_MS	1000
+
+struct mxsfb_flip {
+	struct work_struct work;
+	struct mxsfb_info *host;
+	struct sync_fence *fence;
+	u32 yoffset;
+};
+
+static void mxsfb_flip_work(struct work_struct *work)
+{
+	struct mxsfb_flip *flip = container_of(work, struct mxsfb_flip, work);
+	struct mxsfb_info *host = flip->host;
+	struct fb_info *fb_info = host->fb_info;
+	struct fb_var_screeninfo var;
+
+	if (flip->fence) {
+		if (sync_fence_wait(flip->fence, MXSFB_FENCE_TIMEOUT_MS) < 0)
+			dev_warn(fb_info->device,
+				 "acquire fence not signalled, flipping anyway\n");
+		sync_fence_put(flip->fence);
+	}
+
+	/* same locking and lock order as FBIOPAN_DISPLAY */
+	console_lock();
+	if (lock_fb_info(fb_info)) {
+		var = fb_info->var;
+		var.yoffset = flip->yoffset;
+		if (fb_pan_display(fb_info, &var))
+			dev_dbg(fb_info->device, "fenced flip to %u failed\n",
+				flip->yoffset);
+		unlock_fb_info(fb_info);
+	}
+	console_unlock();
+
+	/* signalled on failure too, nobody would wait for it otherwise */
+	sw_sync_timeline_inc(host->timeline, 1);
+	kfree(flip);
+}
+
+/* Called with the fb_info lock held, like every fb_ioctl */
+static int mxsfb_flip_fenced(struct fb_info *fb_info, void __user *argp)
+{
+	struct mxsfb_info *host = fb_info->par;
+	struct mxcfb_flip req;
+	struct mxsfb_flip *flip;
+	struct sync_fence *fence;
+	struct sync_pt *pt;
+	int fd, ret;
+
+	if (copy_from_user(&req, argp, sizeof(req)))
+		return -EFAULT;
+
+	if (req.yoffset + fb_info->var.yres > fb_info->var.yres_virtual)
+		return -EINVAL;
+
+	if (!host->flip_wq) {
+		host->timeline =
+			sw_sync_timeline_create(dev_name(&host->pdev->dev));
+		if (!host->timeline)
+			return -ENOMEM;
+		host->flip_wq = alloc_ordered_workqueue("mxsfb_flip",
+							WQ_HIGHPRI);
+		if (!host->flip_wq) {
+			sync_timeline_destroy(&host->timeline->obj);
+			host->timeline = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	flip = kzalloc(sizeof(*flip), GFP_KERNEL);
+	if (!flip)
+		return -ENOMEM;
+	INIT_WORK(&flip->work, mxsfb_flip_work);
+	flip->host = host;
+	flip->yoffset = req.yoffset;
+
+	if (req.acquire_fence >= 0) {
+		flip->fence = sync_fence_fdget(req.acquire_fence);
+		if (!flip->fence) {
+			ret = -EINVAL;
+			goto err_free;
+		}
+	}
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		ret = fd;
+		goto err_fence;
+	}
+
+	pt = sw_sync_pt_create(host->timeline, host->flip_seqno + 1);
+	if (!pt) {
+		ret = -ENOMEM;
+		goto err_fd;
+	}
+	fence = sync_fence_create("mxsfb", pt);
+	if (!fence) {
+		sync_pt_free(pt);
+		ret = -ENOMEM;
+		goto err_fd;
+	}
+
+	req.release_fence = fd;
+	if (copy_to_user(argp, &req, sizeof(req))) {
+		sync_fence_put(fence);
+		ret = -EFAULT;
+		goto err_fd;
+	}
+
+	sync_fence_install(fence, fd);
+	host->flip_seqno++;
+	queue_work(host->flip_wq, &flip->work);
+	return 0;
+
+err_fd:
+	put_unused_fd(fd);
+err_fence:
+	if (flip->fence)
+		sync_fence_put(flip->fence);
+err_free:
+	kfree(flip);
+	return ret;
+}
+
+static void mxsfb_flip_release(struct mxsfb_info *host)
+{
+	if (!host->flip_wq)
+		return;
+
+	destroy_workqueue(host->flip_wq);
+	host->flip_wq = NULL;
+	sync_timeline_destroy(&host->timeline->obj);
+	host->timeline = NULL;
+}
+#else
+static int mxsfb_flip_fenced(struct fb_info *fb_info, void __user *argp)
+{
+	return -ENOTTY;
+}
+
+static inline void mxsfb_flip_release(struct mxsfb_info *host) { }
+#endif
+
 static int mxsfb_ioctl(struct fb_info *fb_info, unsigned int cmd,
 			unsigned long arg)
 {
@@ -865,6 +1247,20 @@ static int mxsfb_ioctl(struct fb_info *fb_info, unsigned int cmd,
 	case MXCFB_WAIT_FOR_VSYNC:
 		ret = mxsfb_wait_for_vsync(fb_info);
 		break;
+	case MXCFB_SET_UPDATE_RECT:
+		{
+			struct mxcfb_rect rect;
+
+			if (copy_from_user(&rect, (void __user *)arg,
+					   sizeof(rect)))
+				return -EFAULT;
+
+			ret = mxsfb_update_rect(fb_info, &rect);
+			break;
+		}
+	case MXCFB_FLIP_FENCED:
+		ret = mxsfb_flip_fenced(fb_info, (void __user *)arg);
+		break;
 	default:
 		break;
 	}
@@ -935,7 +1331,16 @@ static int mxsfb_pan_display(struct fb_var_screeninfo *var,
 		return -EINVAL;
 	}
 
+	if (host->mpu_mode) {
+		fb_info->var.yoffset = var->yoffset;
+		ret = mxsfb_mpu_update(host, 0, var->yres);
+		if (!ret)
+			ret = mxsfb_wait_for_vsync(fb_info);
+		return ret;
+	}
+
 	init_completion(&host->flip_complete);
+	trace_mxsfb_pan_start(fb_info->node, var->yoffset, 0);
 
 	offset = fb_info->fix.line_length * var->yoffset;
 
@@ -950,9 +1355,11 @@ static int mxsfb_pan_display(struct fb_var_screeninfo *var,
 	if (!ret) {
 		dev_err(fb_info->device,
 			"mxs wait for pan flip timeout\n");
+		trace_mxsfb_pan_done(fb_info->node, var->yoffset, -ETIMEDOUT);
 		return -ETIMEDOUT;
 	}
 
+	trace_mxsfb_pan_done(fb_info->node, var->yoffset, 0);
 	return 0;
 }
 
@@ -1149,6 +1556,11 @@ static int mxsfb_init_fbinfo_dt(struct mxsfb_info *host)
 		goto put_display_node;
 	}
 
+	host->mpu_mode = of_property_read_bool(display_np, "fsl,command-mode");
+	if (of_property_read_u32(display_np, "fsl,mpu-timing",
+				 &host->mpu_timing))
+		host->mpu_timing = TIMING_DEFAULT;
+
 	ret = of_property_read_u32(display_np, "bits-per-pixel",
 				   &var->bits_per_pixel);
 	if (ret < 0) {
@@ -1213,7 +1625,9 @@ static int mxsfb_init_fbinfo(struct mxsfb_info *host)
 	int ret;
 
 	fb_info->fbops = &mxsfb_ops;
-	fb_info->flags = FBINFO_FLAG_DEFAULT | FBINFO_READS_FAST;
+	/* the framebuffer comes from dma_alloc_writecombine() */
+	fb_info->flags = FBINFO_FLAG_DEFAULT | FBINFO_READS_FAST |
+			 FBINFO_CFB_NEON;
 	fb_info->fix.type = FB_TYPE_PACKED_PIXELS;
 	fb_info->fix.ypanstep = 1;
 	fb_info->fix.ywrapstep = 1;
@@ -1412,6 +1826,7 @@ static int mxsfb_probe(struct platform_device *pdev)
 	}
 	host->fb_info = fb_info;
 	fb_info->par = host;
+	mutex_init(&host->mpu_lock);
 
 	ret = devm_request_irq(&pdev->dev, irq, mxsfb_irq_handler, 0,
 			  dev_name(&pdev->dev), host);
@@ -1469,6 +1884,7 @@ static int mxsfb_probe(struct platform_device *pdev)
 	INIT_LIST_HEAD(&fb_info->modelist);
 
 	pm_runtime_enable(&host->pdev->dev);
+	device_enable_async_suspend(&pdev->dev);
 
 	ret = mxsfb_init_fbinfo(host);
 	if (ret != 0)
@@ -1535,6 +1951,8 @@ static int mxsfb_remove(struct platform_device *pdev)
 
 	pm_runtime_disable(&host->pdev->dev);
 	unregister_framebuffer(fb_info);
+	/* no MXCFB_FLIP_FENCED can come in any more */
+	mxsfb_flip_release(host);
 	mxsfb_free_videomem(host);
 
 	platform_set_drvdata(pdev, NULL);
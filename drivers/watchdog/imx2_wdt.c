@@ -29,16 +29,22 @@
 #include <linux/irq.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
+#include <linux/kernel_stat.h>
+#include <linux/kmsg_dump.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
+#include <linux/nmi.h>
 #include <linux/notifier.h>
 #include <linux/of_address.h>
 #include <linux/platform_device.h>
 #include <linux/reboot.h>
 #include <linux/regmap.h>
+#include <linux/sched.h>
 #include <linux/timer.h>
 #include <linux/watchdog.h>
 
+#include <asm/irq_regs.h>
+
 #define DRIVER_NAME "imx2-wdt"
 
 #define IMX2_WDT_WCR		0x00		/* Control Register */
@@ -67,6 +73,8 @@
 #define WDOG_SEC_TO_COUNT(s)	((s * 2 - 1) << 8)
 #define WDOG_SEC_TO_PRECOUNT(s)	(s * 2)		/* set WDOG pre timeout count*/
 
+#define IMX2_WDT_DUMP_IRQS	5	/* busiest interrupts to report */
+
 struct imx2_wdt_device {
 	struct clk *clk;
 	struct regmap *regmap;
@@ -74,6 +82,11 @@ struct imx2_wdt_device {
 	struct watchdog_device wdog;
 	struct notifier_block restart_handler;
 	bool wdog_b;
+#ifdef CONFIG_IMX2_WDT_PRETIMEOUT_DUMP
+	unsigned long last_ping;	/* jiffies */
+	unsigned int *irq_counts;	/* per-IRQ count at the last ping */
+	unsigned int nr_irq_counts;
+#endif
 };
 
 static bool nowayout = WATCHDOG_NOWAYOUT;
@@ -87,6 +100,13 @@ module_param(timeout, uint, 0);
 MODULE_PARM_DESC(timeout, "Watchdog timeout in seconds (default="
 				__MODULE_STRING(IMX2_WDT_DEFAULT_TIME) ")");
 
+#ifdef CONFIG_IMX2_WDT_PRETIMEOUT_DUMP
+static bool pretimeout_ftrace;
+module_param(pretimeout_ftrace, bool, 0644);
+MODULE_PARM_DESC(pretimeout_ftrace,
+		 "Dump the ftrace buffers on pretimeout (default=0)");
+#endif
+
 static const struct watchdog_info imx2_wdt_info = {
 	.identity = "imx2+ watchdog",
 	.options = WDIOF_KEEPALIVEPING | WDIOF_SETTIMEOUT | WDIOF_MAGICCLOSE | WDIOF_PRETIMEOUT,
@@ -155,12 +175,99 @@ static inline bool imx2_wdt_is_running(struct imx2_wdt_device *wdev)
 	return val & IMX2_WDT_WCR_WDE;
 }
 
+#ifdef CONFIG_IMX2_WDT_PRETIMEOUT_DUMP
+/* Remember the interrupt counts, to tell on pretimeout which ones ran since */
+static void imx2_wdt_snapshot(struct imx2_wdt_device *wdev)
+{
+	unsigned int i;
+
+	wdev->last_ping = jiffies;
+	for (i = 0; i < wdev->nr_irq_counts; i++)
+		wdev->irq_counts[i] = kstat_irqs(i);
+}
+
+/*
+ * Called from the pretimeout interrupt, with a few seconds left before
+ * the reset: log what this CPU was running when it was interrupted, the
+ * interrupts that fired most since the last ping and optionally the
+ * ftrace buffers, then have pstore record the log.
+ */
+static void imx2_wdt_pretimeout_dump(struct imx2_wdt_device *wdev)
+{
+	unsigned int top[IMX2_WDT_DUMP_IRQS] = { 0 };
+	unsigned int delta[IMX2_WDT_DUMP_IRQS] = { 0 };
+	struct pt_regs *regs = get_irq_regs();
+	struct irq_desc *desc;
+	unsigned int i, j, d;
+
+	pr_emerg("%s: pretimeout, last ping %u ms ago\n", DRIVER_NAME,
+		 jiffies_to_msecs(jiffies - wdev->last_ping));
+
+	pr_emerg("%s: interrupted %s[%d] on CPU%d\n", DRIVER_NAME,
+		 current->comm, task_pid_nr(current), smp_processor_id());
+	if (regs)
+		show_regs(regs);
+	trigger_all_cpu_backtrace();
+
+	for (i = 0; i < wdev->nr_irq_counts; i++) {
+		d = kstat_irqs(i) - wdev->irq_counts[i];
+		for (j = 0; j < IMX2_WDT_DUMP_IRQS && d <= delta[j]; j++)
+			;
+		if (j == IMX2_WDT_DUMP_IRQS)
+			continue;
+		memmove(&delta[j + 1], &delta[j],
+			(IMX2_WDT_DUMP_IRQS - j - 1) * sizeof(*delta));
+		memmove(&top[j + 1], &top[j],
+			(IMX2_WDT_DUMP_IRQS - j - 1) * sizeof(*top));
+		delta[j] = d;
+		top[j] = i;
+	}
+
+	for (j = 0; j < IMX2_WDT_DUMP_IRQS && delta[j]; j++) {
+		desc = irq_to_desc(top[j]);
+		pr_emerg("%s: irq %u: %u since last ping (%s)\n", DRIVER_NAME,
+			 top[j], delta[j],
+			 desc && desc->action ? desc->action->name : "-");
+	}
+
+	/* the dump stops tracing, otherwise keep the trace in the snapshot */
+	if (pretimeout_ftrace)
+		ftrace_dump(DUMP_ALL);
+	else
+		trace_flight_trigger("watchdog pretimeout");
+
+	/* ramoops only keeps oops and panic records */
+	kmsg_dump(KMSG_DUMP_OOPS);
+}
+
+static int imx2_wdt_dump_init(struct device *dev,
+			      struct imx2_wdt_device *wdev)
+{
+	wdev->irq_counts = devm_kcalloc(dev, nr_irqs, sizeof(unsigned int),
+					GFP_KERNEL);
+	if (!wdev->irq_counts)
+		return -ENOMEM;
+	wdev->nr_irq_counts = nr_irqs;
+	imx2_wdt_snapshot(wdev);
+	return 0;
+}
+#else
+static inline void imx2_wdt_snapshot(struct imx2_wdt_device *wdev) { }
+static inline void imx2_wdt_pretimeout_dump(struct imx2_wdt_device *wdev) { }
+static inline int imx2_wdt_dump_init(struct device *dev,
+				     struct imx2_wdt_device *wdev)
+{
+	return 0;
+}
+#endif
+
 static int imx2_wdt_ping(struct watchdog_device *wdog)
 {
 	struct imx2_wdt_device *wdev = watchdog_get_drvdata(wdog);
 
 	regmap_write(wdev->regmap, IMX2_WDT_WSR, IMX2_WDT_SEQ1);
 	regmap_write(wdev->regmap, IMX2_WDT_WSR, IMX2_WDT_SEQ2);
+	imx2_wdt_snapshot(wdev);
 	return 0;
 }
 
@@ -262,6 +369,7 @@ static irqreturn_t imx2_wdt_isr(int irq, void *dev_id)
 		regmap_write(wdev->regmap, IMX2_WDT_WICR, val);
 		dev_warn(&pdev->dev, "watchdog pre-timeout:%d, %d Seconds remained\n", \
 			 wdog->pretimeout, wdog->timeout-wdog->pretimeout);
+		imx2_wdt_pretimeout_dump(wdev);
 	}
 	return IRQ_HANDLED;
 }
@@ -315,6 +423,10 @@ static int __init imx2_wdt_probe(struct platform_device *pdev)
 		return PTR_ERR(wdev->clk);
 	}
 
+	ret = imx2_wdt_dump_init(&pdev->dev, wdev);
+	if (ret)
+		return ret;
+
 	irq = platform_get_irq(pdev, 0);
 	ret = devm_request_irq(&pdev->dev, irq, imx2_wdt_isr, 0,
 			       dev_name(&pdev->dev), pdev);
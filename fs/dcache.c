@@ -118,6 +118,17 @@ struct dentry_stat_t dentry_stat = {
 
 static DEFINE_PER_CPU(long, nr_dentry);
 static DEFINE_PER_CPU(long, nr_dentry_unused);
+static DEFINE_PER_CPU(long, nr_dentry_negative);
+
+/*
+ * Maximum number of unused negative dentries per superblock, 0 means no
+ * limit.  Repeated lookups of names that don't exist otherwise fill the
+ * LRU with negative dentries that only go away under memory pressure.
+ */
+long sysctl_negative_dentry_limit __read_mostly;
+
+static void prune_negative_dentries(struct work_struct *work);
+static DECLARE_WORK(negative_dentry_work, prune_negative_dentries);
 
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 
@@ -151,11 +162,21 @@ static long get_nr_dentry_unused(void)
 	return sum < 0 ? 0 : sum;
 }
 
+static long get_nr_dentry_negative(void)
+{
+	int i;
+	long sum = 0;
+	for_each_possible_cpu(i)
+		sum += per_cpu(nr_dentry_negative, i);
+	return sum < 0 ? 0 : sum;
+}
+
 int proc_nr_dentry(struct ctl_table *table, int write, void __user *buffer,
 		   size_t *lenp, loff_t *ppos)
 {
 	dentry_stat.nr_dentry = get_nr_dentry();
 	dentry_stat.nr_unused = get_nr_dentry_unused();
+	dentry_stat.nr_negative = get_nr_dentry_negative();
 	return proc_doulongvec_minmax(table, write, buffer, lenp, ppos);
 }
 #endif
@@ -269,6 +290,41 @@ static inline int dname_external(const struct dentry *dentry)
 	return dentry->d_name.name != dentry->d_iname;
 }
 
+/*
+ * Negative dentries are counted while they carry DCACHE_LRU_LIST, like
+ * nr_dentry_unused, both per cpu and per superblock.  d_lock must be held.
+ */
+static void d_negative_inc(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+	long limit = READ_ONCE(sysctl_negative_dentry_limit);
+
+	this_cpu_inc(nr_dentry_negative);
+	if (atomic_long_inc_return(&sb->s_nr_negative_dentry) > limit &&
+	    limit)
+		schedule_work(&negative_dentry_work);
+}
+
+static void d_negative_dec(struct dentry *dentry)
+{
+	this_cpu_dec(nr_dentry_negative);
+	atomic_long_dec(&dentry->d_sb->s_nr_negative_dentry);
+}
+
+static inline void d_lru_type_change(struct dentry *dentry, unsigned old,
+				     unsigned new)
+{
+	bool was_negative = (old & DCACHE_ENTRY_TYPE) == DCACHE_MISS_TYPE;
+	bool is_negative = (new & DCACHE_ENTRY_TYPE) == DCACHE_MISS_TYPE;
+
+	if (!(old & DCACHE_LRU_LIST) || was_negative == is_negative)
+		return;
+	if (is_negative)
+		d_negative_inc(dentry);
+	else
+		d_negative_dec(dentry);
+}
+
 /*
  * Make sure other CPUs see the inode attached before the type is set.
  */
@@ -276,14 +332,15 @@ static inline void __d_set_inode_and_type(struct dentry *dentry,
 					  struct inode *inode,
 					  unsigned type_flags)
 {
-	unsigned flags;
+	unsigned old, flags;
 
 	dentry->d_inode = inode;
 	smp_wmb();
-	flags = READ_ONCE(dentry->d_flags);
+	old = flags = READ_ONCE(dentry->d_flags);
 	flags &= ~(DCACHE_ENTRY_TYPE | DCACHE_FALLTHRU);
 	flags |= type_flags;
 	WRITE_ONCE(dentry->d_flags, flags);
+	d_lru_type_change(dentry, old, flags);
 }
 
 /*
@@ -296,12 +353,14 @@ static inline void __d_set_inode_and_type(struct dentry *dentry,
  */
 static inline void __d_clear_type_and_inode(struct dentry *dentry)
 {
-	unsigned flags = READ_ONCE(dentry->d_flags);
+	unsigned old, flags;
 
+	old = flags = READ_ONCE(dentry->d_flags);
 	flags &= ~(DCACHE_ENTRY_TYPE | DCACHE_FALLTHRU);
 	WRITE_ONCE(dentry->d_flags, flags);
 	smp_wmb();
 	dentry->d_inode = NULL;
+	d_lru_type_change(dentry, old, flags);
 }
 
 static void dentry_free(struct dentry *dentry)
@@ -392,7 +451,8 @@ static void dentry_unlink_inode(struct dentry * dentry)
  * on the shrink list (ie not on the superblock LRU list).
  *
  * The per-cpu "nr_dentry_unused" counters are updated with
- * the DCACHE_LRU_LIST bit.
+ * the DCACHE_LRU_LIST bit, and so are the negative dentry counters
+ * for negative dentries.
  *
  * These helper functions make sure we always follow the
  * rules. d_lock must be held by the caller.
@@ -403,6 +463,8 @@ static void d_lru_add(struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, 0);
 	dentry->d_flags |= DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_negative_inc(dentry);
 	WARN_ON_ONCE(!list_lru_add(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -411,6 +473,8 @@ static void d_lru_del(struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_negative_dec(dentry);
 	WARN_ON_ONCE(!list_lru_del(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -420,6 +484,8 @@ static void d_shrink_del(struct dentry *dentry)
 	list_del_init(&dentry->d_lru);
 	dentry->d_flags &= ~(DCACHE_SHRINK_LIST | DCACHE_LRU_LIST);
 	this_cpu_dec(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_negative_dec(dentry);
 }
 
 static void d_shrink_add(struct dentry *dentry, struct list_head *list)
@@ -428,6 +494,8 @@ static void d_shrink_add(struct dentry *dentry, struct list_head *list)
 	list_add(&dentry->d_lru, list);
 	dentry->d_flags |= DCACHE_SHRINK_LIST | DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_negative_inc(dentry);
 }
 
 /*
@@ -441,6 +509,8 @@ static void d_lru_isolate(struct list_lru_one *lru, struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_negative_dec(dentry);
 	list_lru_isolate(lru, &dentry->d_lru);
 }
 
@@ -1100,6 +1170,102 @@ long prune_dcache_sb(struct super_block *sb, struct shrink_control *sc)
 	return freed;
 }
 
+/* dentries looked at between two reschedule points */
+#define NEGATIVE_PRUNE_BATCH	1024
+
+struct negative_prune {
+	struct list_head	dispose;
+	long			nr;		/* left to prune */
+	unsigned long		skipped;	/* left in place by a batch */
+};
+
+static enum lru_status dentry_lru_isolate_negative(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
+{
+	struct negative_prune *np = arg;
+	struct dentry	*dentry = container_of(item, struct dentry, d_lru);
+
+	if (np->nr <= 0)
+		return LRU_SKIP;
+
+	/* positive dentries keep their place for the shrinker */
+	if (!spin_trylock(&dentry->d_lock)) {
+		np->skipped++;
+		return LRU_SKIP;
+	}
+	if (!d_is_negative(dentry)) {
+		spin_unlock(&dentry->d_lock);
+		np->skipped++;
+		return LRU_SKIP;
+	}
+
+	if (dentry->d_lockref.count) {
+		d_lru_isolate(lru, dentry);
+		spin_unlock(&dentry->d_lock);
+		return LRU_REMOVED;
+	}
+
+	/* keep the names that are still being looked up */
+	if (dentry->d_flags & DCACHE_REFERENCED) {
+		dentry->d_flags &= ~DCACHE_REFERENCED;
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
+	}
+
+	d_lru_shrink_move(lru, dentry, &np->dispose);
+	spin_unlock(&dentry->d_lock);
+	np->nr--;
+
+	return LRU_REMOVED;
+}
+
+/*
+ * Trim a superblock back to 7/8 of the negative dentry limit, so that a
+ * stream of new negative dentries doesn't queue a prune for each one.
+ * The LRU is walked in batches that drop the LRU lock and reschedule in
+ * between.  Each batch starts at the head again, past the dentries the
+ * previous ones left there, and all of them together walk no more than
+ * the LRU holds: with many positive dentries at the head the prune stops
+ * short rather than rescanning them.  It also gives up on a batch that
+ * frees nothing.
+ */
+static void prune_negative_sb(struct super_block *sb, void *unused)
+{
+	long limit = READ_ONCE(sysctl_negative_dentry_limit);
+	struct negative_prune np;
+	unsigned long left;
+	long before;
+
+	np.nr = atomic_long_read(&sb->s_nr_negative_dentry);
+	if (!limit || np.nr <= limit)
+		return;
+	np.nr -= limit - limit / 8;
+
+	np.skipped = 0;
+	left = list_lru_count(&sb->s_dentry_lru);
+	while (np.nr > 0 && left) {
+		unsigned long batch = min_t(unsigned long, left,
+					    np.skipped + NEGATIVE_PRUNE_BATCH);
+
+		before = np.nr;
+		np.skipped = 0;
+		INIT_LIST_HEAD(&np.dispose);
+		list_lru_walk(&sb->s_dentry_lru, dentry_lru_isolate_negative,
+			      &np, batch);
+		shrink_dentry_list(&np.dispose);
+		if (np.nr == before)
+			break;
+
+		left -= batch;
+		cond_resched();
+	}
+}
+
+static void prune_negative_dentries(struct work_struct *work)
+{
+	iterate_supers(prune_negative_sb, NULL);
+}
+
 static enum lru_status dentry_lru_isolate_shrink(struct list_head *item,
 		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
 {
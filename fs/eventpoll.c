@@ -92,7 +92,12 @@
  */
 
 /* Epoll private bits inside the event mask */
-#define EP_PRIVATE_BITS (EPOLLWAKEUP | EPOLLONESHOT | EPOLLET)
+#define EP_PRIVATE_BITS (EPOLLWAKEUP | EPOLLONESHOT | EPOLLET | EPOLLEXCLUSIVE)
+
+#define EPOLLINOUT_BITS (POLLIN | POLLOUT)
+
+#define EPOLLEXCLUSIVE_OK_BITS (EPOLLINOUT_BITS | POLLERR | POLLHUP | \
+				EPOLLWAKEUP | EPOLLET | EPOLLEXCLUSIVE)
 
 /* Maximum number of nesting allowed inside epoll sets */
 #define EP_MAX_NESTS 4
@@ -620,6 +625,13 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	ep->ovflist = NULL;
 	spin_unlock_irqrestore(&ep->lock, flags);
 
+	/*
+	 * Pairs with the barrier in ep_poll_callback(): either the callback
+	 * sees ->ovflist active and queues the item again, or "sproc" polls
+	 * the file after the event that triggered the callback.
+	 */
+	smp_mb();
+
 	/*
 	 * Now call the callback function.
 	 */
@@ -647,9 +659,10 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	/*
 	 * We need to set back ep->ovflist to EP_UNACTIVE_PTR, so that after
 	 * releasing the lock, events will be queued in the normal way inside
-	 * ep->rdllist.
+	 * ep->rdllist.  Release it after the list updates done by "sproc",
+	 * for the lockless check in ep_poll_callback().
 	 */
-	ep->ovflist = EP_UNACTIVE_PTR;
+	smp_store_release(&ep->ovflist, EP_UNACTIVE_PTR);
 
 	/*
 	 * Quickly re-inject items left on "txlist".
@@ -1002,6 +1015,27 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
+	int ewake = 0;
+
+	/*
+	 * A busy file keeps calling back while its item is still queued on
+	 * the ready list: that item is going to be reported anyway, and the
+	 * waiters have been woken when it was queued, so there is nothing to
+	 * do and no need to take ep->lock.  The barrier orders the event the
+	 * caller has just posted against the ready list and ->ovflist checks,
+	 * pairing with the one in ep_scan_ready_list().  The acquire pairs
+	 * with the release that ends a transfer there: an inactive ->ovflist
+	 * means the unlinking done by "sproc" is visible too, so a stale
+	 * rdllink is never mistaken for a queued item.  Exclusive items take
+	 * the locked path, their return value depends on the waiters.
+	 */
+	if (!((unsigned long)key & POLLFREE) &&
+	    !(epi->event.events & EPOLLEXCLUSIVE)) {
+		smp_mb();
+		if (smp_load_acquire(&ep->ovflist) == EP_UNACTIVE_PTR &&
+		    ep_is_linked(&epi->rdllink))
+			return 1;
+	}
 
 	if ((unsigned long)key & POLLFREE) {
 		ep_pwq_from_wait(wait)->whead = NULL;
@@ -1066,8 +1100,25 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
 	 */
-	if (waitqueue_active(&ep->wq))
+	if (waitqueue_active(&ep->wq)) {
+		if ((epi->event.events & EPOLLEXCLUSIVE) &&
+		    !((unsigned long)key & POLLFREE)) {
+			switch ((unsigned long)key & EPOLLINOUT_BITS) {
+			case POLLIN:
+				if (epi->event.events & POLLIN)
+					ewake = 1;
+				break;
+			case POLLOUT:
+				if (epi->event.events & POLLOUT)
+					ewake = 1;
+				break;
+			case 0:
+				ewake = 1;
+				break;
+			}
+		}
 		wake_up_locked(&ep->wq);
+	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -1078,7 +1129,11 @@ out_unlock:
 	if (pwake)
 		ep_poll_safewake(&ep->poll_wait);
 
-	return 1;
+	if (!(epi->event.events & EPOLLEXCLUSIVE))
+		return 1;
+
+	/* Returning 0 lets the wakeup go on to the next exclusive set */
+	return ewake;
 }
 
 /*
@@ -1095,7 +1150,10 @@ static void ep_ptable_queue_proc(struct file *file, wait_queue_head_t *whead,
 		init_waitqueue_func_entry(&pwq->wait, ep_poll_callback);
 		pwq->whead = whead;
 		pwq->base = epi;
-		add_wait_queue(whead, &pwq->wait);
+		if (epi->event.events & EPOLLEXCLUSIVE)
+			add_wait_queue_exclusive(whead, &pwq->wait);
+		else
+			add_wait_queue(whead, &pwq->wait);
 		list_add_tail(&pwq->llink, &epi->pwqlist);
 		epi->nwait++;
 	} else {
@@ -1861,6 +1919,18 @@ SYSCALL_DEFINE4(epoll_ctl, int, epfd, int, op, int, fd,
 	if (f.file == tf.file || !is_file_epoll(f.file))
 		goto error_tgt_fput;
 
+	/*
+	 * EPOLLEXCLUSIVE can only be set on EPOLL_CTL_ADD, for a file that is
+	 * not an epoll one and with in/out events only.
+	 */
+	if (ep_op_has_event(op) && (epds.events & EPOLLEXCLUSIVE)) {
+		if (op == EPOLL_CTL_MOD)
+			goto error_tgt_fput;
+		if (op == EPOLL_CTL_ADD && (is_file_epoll(tf.file) ||
+				(epds.events & ~EPOLLEXCLUSIVE_OK_BITS)))
+			goto error_tgt_fput;
+	}
+
 	/*
 	 * At this point it is safe to assume that the "private_data" contains
 	 * our own data structure.
@@ -1932,8 +2002,10 @@ SYSCALL_DEFINE4(epoll_ctl, int, epfd, int, op, int, fd,
 		break;
 	case EPOLL_CTL_MOD:
 		if (epi) {
-			epds.events |= POLLERR | POLLHUP;
-			error = ep_modify(ep, epi, &epds);
+			if (!(epi->event.events & EPOLLEXCLUSIVE)) {
+				epds.events |= POLLERR | POLLHUP;
+				error = ep_modify(ep, epi, &epds);
+			}
 		} else
 			error = -ENOENT;
 		break;
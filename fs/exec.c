@@ -984,6 +984,8 @@ static int de_thread(struct task_struct *tsk)
 
 		tsk->group_leader = tsk;
 		leader->group_leader = tsk;
+		lowmem_adj_remove(leader);
+		lowmem_adj_insert(tsk);
 
 		tsk->exit_signal = SIGCHLD;
 		leader->exit_signal = -1;
@@ -1105,6 +1107,8 @@ int flush_old_exec(struct linux_binprm * bprm)
 	set_fs(USER_DS);
 	current->flags &= ~(PF_RANDOMIZE | PF_FORKNOEXEC | PF_KTHREAD |
 					PF_NOFREEZE | PF_NO_SETAFFINITY);
+	/* a child of a kernel thread becomes a user process only now */
+	lowmem_adj_insert(current);
 	flush_thread();
 	current->personality &= ~bprm->per_clear;
 
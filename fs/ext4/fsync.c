@@ -134,6 +134,15 @@ int ext4_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 		goto out;
 	}
 
+	/*
+	 * There is no lighter record than a full jbd2 transaction: logging
+	 * just the inode size and extents would need a new journal format,
+	 * with replay both here and in e2fsck.  What keeps fsync cheap is
+	 * that i_datasync_tid only moves for changes needed to read the
+	 * data back.  An fdatasync() of overwritten, already allocated
+	 * blocks thus finds its transaction committed and only flushes the
+	 * cache, and concurrent fsyncs share a commit through batching.
+	 */
 	commit_tid = datasync ? ei->i_datasync_tid : ei->i_sync_tid;
 	if (journal->j_flags & JBD2_BARRIER &&
 	    !jbd2_trans_will_send_data_barrier(journal, commit_tid))
@@ -140,6 +140,7 @@ int f2fs_submit_page_bio(struct f2fs_sb_info *sbi, struct page *page,
 
 	trace_f2fs_submit_page_bio(page, fio);
 	f2fs_trace_ios(page, fio, 0);
+	f2fs_update_req_time(sbi);
 
 	/* Allocate a new bio */
 	bio = __bio_alloc(sbi, fio->blk_addr, 1, is_read_io(fio->rw));
@@ -164,6 +165,7 @@ void f2fs_submit_page_mbio(struct f2fs_sb_info *sbi, struct page *page,
 	io = is_read ? &sbi->read_io : &sbi->write_io[btype];
 
 	verify_block_addr(sbi, fio->blk_addr);
+	f2fs_update_req_time(sbi);
 
 	down_write(&io->io_rwsem);
 
@@ -85,6 +85,9 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 		si->block_count[i] = sbi->block_count[i];
 	}
 
+	for (i = CURSEG_HOT_DATA; i <= CURSEG_COLD_NODE; i++)
+		si->log_block_count[i] = sbi->log_block_count[i];
+
 	si->inplace_count = atomic_read(&sbi->inplace_count);
 }
 
@@ -312,6 +315,14 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->block_count[SSR], si->segment_count[SSR]);
 		seq_printf(s, "LFS: %u blocks in %u segments\n",
 			   si->block_count[LFS], si->segment_count[LFS]);
+		seq_printf(s, "Data writes: hot %u, warm %u, cold %u blocks\n",
+			   si->log_block_count[CURSEG_HOT_DATA],
+			   si->log_block_count[CURSEG_WARM_DATA],
+			   si->log_block_count[CURSEG_COLD_DATA]);
+		seq_printf(s, "Node writes: hot %u, warm %u, cold %u blocks\n",
+			   si->log_block_count[CURSEG_HOT_NODE],
+			   si->log_block_count[CURSEG_WARM_NODE],
+			   si->log_block_count[CURSEG_COLD_NODE]);
 
 		/* segment usage info */
 		update_sit_info(si->sbi);
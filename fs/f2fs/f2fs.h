@@ -321,6 +321,7 @@ struct extent_tree {
 #define FADVISE_LOST_PINO_BIT	0x02
 
 #define DEF_DIR_LEVEL		0
+#define DEF_IDLE_INTERVAL	5	/* seconds */
 
 struct f2fs_inode_info {
 	struct inode vfs_inode;		/* serve a vfs inode */
@@ -680,6 +681,10 @@ struct f2fs_sb_info {
 	/* maximum # of trials to find a victim segment for SSR and GC */
 	unsigned int max_victim_search;
 
+	/* for background GC idle detection */
+	unsigned long last_req_time;		/* jiffies of last I/O */
+	unsigned int idle_interval;		/* seconds without I/O */
+
 	/*
 	 * for stat information.
 	 * one is for the LFS mode, and the other is for the SSR mode.
@@ -688,6 +693,7 @@ struct f2fs_sb_info {
 	struct f2fs_stat_info *stat_info;	/* FS status information */
 	unsigned int segment_count[2];		/* # of allocated segments */
 	unsigned int block_count[2];		/* # of allocated blocks */
+	unsigned int log_block_count[NR_CURSEG_TYPE];	/* blocks per log */
 	atomic_t inplace_count;		/* # of inplace update */
 	int total_hit_ext, read_hit_ext;	/* extent cache hit ratio */
 	atomic_t inline_inode;			/* # of inline_data inodes */
@@ -731,6 +737,13 @@ static inline struct f2fs_sb_info *F2FS_P_SB(struct page *page)
 	return F2FS_M_SB(page->mapping);
 }
 
+static inline void f2fs_update_req_time(struct f2fs_sb_info *sbi)
+{
+	/* avoid dirtying the cache line on every page */
+	if (ACCESS_ONCE(sbi->last_req_time) != jiffies)
+		ACCESS_ONCE(sbi->last_req_time) = jiffies;
+}
+
 static inline struct f2fs_super_block *F2FS_RAW_SUPER(struct f2fs_sb_info *sbi)
 {
 	return (struct f2fs_super_block *)(sbi->raw_super);
@@ -1675,6 +1688,7 @@ struct f2fs_stat_info {
 
 	unsigned int segment_count[2];
 	unsigned int block_count[2];
+	unsigned int log_block_count[NR_CURSEG_TYPE];
 	unsigned int inplace_count;
 	unsigned base_mem, cache_mem, page_mem;
 };
@@ -1715,6 +1729,8 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 		((sbi)->segment_count[(curseg)->alloc_type]++)
 #define stat_inc_block_count(sbi, curseg)				\
 		((sbi)->block_count[(curseg)->alloc_type]++)
+#define stat_inc_log_block_count(sbi, type)				\
+		((sbi)->log_block_count[type]++)
 #define stat_inc_inplace_blocks(sbi)					\
 		(atomic_inc(&(sbi)->inplace_count))
 #define stat_inc_seg_count(sbi, type, gc_type)				\
@@ -1767,6 +1783,7 @@ void f2fs_destroy_root_stats(void);
 #define stat_dec_inline_dir(inode)
 #define stat_inc_seg_type(sbi, curseg)
 #define stat_inc_block_count(sbi, curseg)
+#define stat_inc_log_block_count(sbi, type)
 #define stat_inc_inplace_blocks(sbi)
 #define stat_inc_seg_count(sbi, type, gc_type)
 #define stat_inc_tot_blk_count(si, blks)
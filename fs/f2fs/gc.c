@@ -54,26 +54,31 @@ static int gc_thread_func(void *data)
 		 * 1. There are enough dirty segments.
 		 * 2. IO subsystem is idle by checking the # of writeback pages.
 		 * 3. IO subsystem is idle by checking the # of requests in
-		 *    bdev's request list.
+		 *    bdev's request list and the time since the last I/O.
 		 *
 		 * Note) We have to avoid triggering GCs frequently.
 		 * Because it is possible that some segments can be
 		 * invalidated soon after by user update or deletion.
 		 * So, I'd like to wait some time to collect dirty segments.
+		 *
+		 * Once free space is below urgent_free_ratio, waiting for idle
+		 * would only move the cost to foreground GC, which blocks the
+		 * writers, so GC runs every urgent_sleep_time regardless.
 		 */
 		if (!mutex_trylock(&sbi->gc_mutex))
 			continue;
 
-		if (!is_idle(sbi)) {
+		if (has_urgent_gc(sbi)) {
+			wait_ms = gc_th->urgent_sleep_time;
+		} else if (!is_idle(sbi)) {
 			increase_sleep_time(gc_th, &wait_ms);
 			mutex_unlock(&sbi->gc_mutex);
 			continue;
-		}
-
-		if (has_enough_invalid_blocks(sbi))
+		} else if (has_enough_invalid_blocks(sbi)) {
 			decrease_sleep_time(gc_th, &wait_ms);
-		else
+		} else {
 			increase_sleep_time(gc_th, &wait_ms);
+		}
 
 		stat_inc_bggc_count(sbi);
 
@@ -103,6 +108,8 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->min_sleep_time = DEF_GC_THREAD_MIN_SLEEP_TIME;
 	gc_th->max_sleep_time = DEF_GC_THREAD_MAX_SLEEP_TIME;
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
+	gc_th->urgent_sleep_time = DEF_GC_THREAD_URGENT_SLEEP_TIME;
+	gc_th->urgent_free_ratio = DEF_GC_URGENT_FREE_RATIO;
 
 	gc_th->gc_idle = 0;
 
@@ -16,6 +16,12 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_URGENT_SLEEP_TIME	500	/* 500 ms */
+#define DEF_GC_URGENT_FREE_RATIO	5	/*
+						 * percentage of free user
+						 * blocks below which GC runs
+						 * without waiting for idle
+						 */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -30,6 +36,10 @@ struct f2fs_gc_kthread {
 	unsigned int min_sleep_time;
 	unsigned int max_sleep_time;
 	unsigned int no_gc_sleep_time;
+	unsigned int urgent_sleep_time;
+
+	/* free space percentage for urgent gc, 0 disables it */
+	unsigned int urgent_free_ratio;
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
@@ -101,10 +111,27 @@ static inline bool has_enough_invalid_blocks(struct f2fs_sb_info *sbi)
 	return false;
 }
 
+static inline bool has_urgent_gc(struct f2fs_sb_info *sbi)
+{
+	unsigned int ratio = sbi->gc_thread->urgent_free_ratio;
+
+	return (u64)free_user_blocks(sbi) * 100 <
+			(u64)sbi->user_block_count * ratio;
+}
+
 static inline int is_idle(struct f2fs_sb_info *sbi)
 {
 	struct block_device *bdev = sbi->sb->s_bdev;
 	struct request_queue *q = bdev_get_queue(bdev);
 	struct request_list *rl = &q->root_rl;
+
+	/*
+	 * An empty request list only says nothing is queued right now.
+	 * Also wait for idle_interval without any f2fs I/O, so a GC pass
+	 * doesn't land between the writes and the flush of an fsync.
+	 */
+	if (time_before(jiffies, ACCESS_ONCE(sbi->last_req_time) +
+					sbi->idle_interval * HZ))
+		return 0;
 	return !(rl->count[BLK_RW_SYNC]) && !(rl->count[BLK_RW_ASYNC]);
 }
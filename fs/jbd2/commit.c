@@ -361,6 +361,15 @@ static void jbd2_block_tag_csum_set(journal_t *j, journal_block_tag_t *tag,
 	else
 		tag->t_checksum = cpu_to_be16(csum32);
 }
+/* Account the time since *start to a commit phase and restart the clock */
+static inline void jbd2_phase_end(u64 *phase_us, ktime_t *start)
+{
+	ktime_t now = ktime_get();
+
+	*phase_us += ktime_us_delta(now, *start);
+	*start = now;
+}
+
 /*
  * jbd2_journal_commit_transaction
  *
@@ -380,6 +389,8 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	unsigned long long blocknr;
 	ktime_t start_time;
 	u64 commit_time;
+	ktime_t phase_start;
+	u64 phase_us[JBD2_NR_PHASES] = { 0 };
 	char *tagp = NULL;
 	journal_header_t *header;
 	journal_block_tag_t *tag = NULL;
@@ -443,6 +454,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	stats.run.rs_wait = commit_transaction->t_max_wait;
 	stats.run.rs_request_delay = 0;
 	stats.run.rs_locked = jiffies;
+	phase_start = ktime_get();
 	if (commit_transaction->t_requested)
 		stats.run.rs_request_delay =
 			jbd2_time_diff(commit_transaction->t_requested,
@@ -536,6 +548,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	stats.run.rs_flushing = jiffies;
 	stats.run.rs_locked = jbd2_time_diff(stats.run.rs_locked,
 					     stats.run.rs_flushing);
+	jbd2_phase_end(&phase_us[JBD2_PHASE_LOCKED], &phase_start);
 
 	commit_transaction->t_state = T_FLUSH;
 	journal->j_committing_transaction = commit_transaction;
@@ -574,6 +587,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	stats.run.rs_logging = jiffies;
 	stats.run.rs_flushing = jbd2_time_diff(stats.run.rs_flushing,
 					       stats.run.rs_logging);
+	jbd2_phase_end(&phase_us[JBD2_PHASE_FLUSHING], &phase_start);
 	stats.run.rs_blocks =
 		atomic_read(&commit_transaction->t_outstanding_credits);
 	stats.run.rs_blocks_logged = 0;
@@ -752,7 +766,13 @@ start_journal_io:
 		}
 	}
 
+	/*
+	 * The ordered data was in flight while the metadata went out,
+	 * waiting for it belongs to the data phase.
+	 */
+	jbd2_phase_end(&phase_us[JBD2_PHASE_LOGGING], &phase_start);
 	err = journal_finish_inode_data_buffers(journal, commit_transaction);
+	jbd2_phase_end(&phase_us[JBD2_PHASE_FLUSHING], &phase_start);
 	if (err) {
 		printk(KERN_WARNING
 			"JBD2: Detected IO errors while flushing file data "
@@ -793,8 +813,12 @@ start_journal_io:
 	 */
 	if (commit_transaction->t_need_data_flush &&
 	    (journal->j_fs_dev != journal->j_dev) &&
-	    (journal->j_flags & JBD2_BARRIER))
+	    (journal->j_flags & JBD2_BARRIER)) {
+		jbd2_phase_end(&phase_us[JBD2_PHASE_LOGGING], &phase_start);
 		blkdev_issue_flush(journal->j_fs_dev, GFP_NOFS, NULL);
+		jbd2_phase_end(&phase_us[JBD2_PHASE_CACHE_FLUSH],
+			       &phase_start);
+	}
 
 	/* Done it all: now write the commit record asynchronously. */
 	if (JBD2_HAS_INCOMPAT_FEATURE(journal,
@@ -888,6 +912,7 @@ start_journal_io:
 	J_ASSERT(commit_transaction->t_state == T_COMMIT_DFLUSH);
 	commit_transaction->t_state = T_COMMIT_JFLUSH;
 	write_unlock(&journal->j_state_lock);
+	jbd2_phase_end(&phase_us[JBD2_PHASE_LOGGING], &phase_start);
 
 	if (!JBD2_HAS_INCOMPAT_FEATURE(journal,
 				       JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT)) {
@@ -898,10 +923,13 @@ start_journal_io:
 	}
 	if (cbh)
 		err = journal_wait_on_commit_record(journal, cbh);
+	jbd2_phase_end(&phase_us[JBD2_PHASE_COMMIT], &phase_start);
 	if (JBD2_HAS_INCOMPAT_FEATURE(journal,
 				      JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT) &&
 	    journal->j_flags & JBD2_BARRIER) {
 		blkdev_issue_flush(journal->j_dev, GFP_NOFS, NULL);
+		jbd2_phase_end(&phase_us[JBD2_PHASE_CACHE_FLUSH],
+			       &phase_start);
 	}
 
 	if (err)
@@ -1160,5 +1188,8 @@ restart_loop:
 	journal->j_stats.run.rs_handle_count += stats.run.rs_handle_count;
 	journal->j_stats.run.rs_blocks += stats.run.rs_blocks;
 	journal->j_stats.run.rs_blocks_logged += stats.run.rs_blocks_logged;
+	for (i = 0; i < JBD2_NR_PHASES; i++)
+		journal->j_commit_hist[i][min_t(int, fls64(phase_us[i]),
+					JBD2_HIST_BUCKETS - 1)]++;
 	spin_unlock(&journal->j_history_lock);
 }
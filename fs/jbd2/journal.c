@@ -1049,6 +1049,63 @@ static const struct file_operations jbd2_seq_info_fops = {
 	.release        = jbd2_seq_info_release,
 };
 
+static const char * const jbd2_phase_names[JBD2_NR_PHASES] = {
+	[JBD2_PHASE_LOCKED]		= "locked",
+	[JBD2_PHASE_FLUSHING]		= "data",
+	[JBD2_PHASE_LOGGING]		= "log",
+	[JBD2_PHASE_COMMIT]		= "commit",
+	[JBD2_PHASE_CACHE_FLUSH]	= "flush",
+};
+
+/*
+ * Commit phase latency histograms: the number of commits per phase whose
+ * duration fell in each power of two bucket of microseconds.
+ */
+static int jbd2_seq_hist_show(struct seq_file *seq, void *v)
+{
+	journal_t *journal = seq->private;
+	unsigned long hist[JBD2_NR_PHASES][JBD2_HIST_BUCKETS];
+	int i, b, last = 0;
+
+	spin_lock(&journal->j_history_lock);
+	memcpy(hist, journal->j_commit_hist, sizeof(hist));
+	spin_unlock(&journal->j_history_lock);
+
+	for (i = 0; i < JBD2_NR_PHASES; i++)
+		for (b = 0; b < JBD2_HIST_BUCKETS; b++)
+			if (hist[i][b] && b > last)
+				last = b;
+
+	seq_printf(seq, "%10s", "usecs");
+	for (i = 0; i < JBD2_NR_PHASES; i++)
+		seq_printf(seq, " %10s", jbd2_phase_names[i]);
+	seq_putc(seq, '\n');
+
+	for (b = 0; b <= last; b++) {
+		if (b == JBD2_HIST_BUCKETS - 1)
+			seq_printf(seq, "%9lu+", 1UL << (b - 1));
+		else
+			seq_printf(seq, "%10lu", b ? 1UL << (b - 1) : 0);
+		for (i = 0; i < JBD2_NR_PHASES; i++)
+			seq_printf(seq, " %10lu", hist[i][b]);
+		seq_putc(seq, '\n');
+	}
+	return 0;
+}
+
+static int jbd2_seq_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, jbd2_seq_hist_show, PDE_DATA(inode));
+}
+
+static const struct file_operations jbd2_seq_hist_fops = {
+	.owner		= THIS_MODULE,
+	.open		= jbd2_seq_hist_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct proc_dir_entry *proc_jbd2_stats;
 
 static void jbd2_stats_proc_init(journal_t *journal)
@@ -1057,11 +1114,14 @@ static void jbd2_stats_proc_init(journal_t *journal)
 	if (journal->j_proc_entry) {
 		proc_create_data("info", S_IRUGO, journal->j_proc_entry,
 				 &jbd2_seq_info_fops, journal);
+		proc_create_data("commit_hist", S_IRUGO, journal->j_proc_entry,
+				 &jbd2_seq_hist_fops, journal);
 	}
 }
 
 static void jbd2_stats_proc_exit(journal_t *journal)
 {
+	remove_proc_entry("commit_hist", journal->j_proc_entry);
 	remove_proc_entry("info", journal->j_proc_entry);
 	remove_proc_entry(journal->j_devname, proc_jbd2_stats);
 }
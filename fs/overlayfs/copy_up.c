@@ -196,7 +196,7 @@ int ovl_set_attr(struct dentry *upperdentry, struct kstat *stat)
 static int ovl_copy_up_locked(struct dentry *workdir, struct dentry *upperdir,
 			      struct dentry *dentry, struct path *lowerpath,
 			      struct kstat *stat, struct iattr *attr,
-			      const char *link)
+			      const char *link, bool metacopy)
 {
 	struct inode *wdir = workdir->d_inode;
 	struct inode *udir = upperdir->d_inode;
@@ -223,7 +223,26 @@ static int ovl_copy_up_locked(struct dentry *workdir, struct dentry *upperdir,
 	if (err)
 		goto out2;
 
-	if (S_ISREG(stat->mode)) {
+	/*
+	 * exec takes the set-id bits and owner from the inode the file was
+	 * opened on, so set-id files always get their data copied up.
+	 */
+	if (!S_ISREG(stat->mode) || !stat->size ||
+	    (stat->mode & (S_ISUID | S_ISGID)))
+		metacopy = false;
+
+	/*
+	 * A metadata only copy up leaves the data in the lower file until
+	 * the file is opened for write.  Fall back to a full copy if the
+	 * upper filesystem can't store the marker.
+	 */
+	if (metacopy) {
+		err = ovl_do_setxattr(newdentry, OVL_XATTR_METACOPY, "y", 1, 0);
+		if (err)
+			metacopy = false;
+	}
+
+	if (S_ISREG(stat->mode) && !metacopy) {
 		struct path upperpath;
 		ovl_path_upper(dentry, &upperpath);
 		BUG_ON(upperpath.dentry != NULL);
@@ -239,7 +258,16 @@ static int ovl_copy_up_locked(struct dentry *workdir, struct dentry *upperdir,
 		goto out_cleanup;
 
 	mutex_lock(&newdentry->d_inode->i_mutex);
-	err = ovl_set_attr(newdentry, stat);
+	err = 0;
+	if (metacopy) {
+		struct iattr sattr = {
+			.ia_valid = ATTR_SIZE,
+			.ia_size = stat->size,
+		};
+		err = notify_change(newdentry, &sattr, NULL);
+	}
+	if (!err)
+		err = ovl_set_attr(newdentry, stat);
 	if (!err && attr)
 		err = notify_change(newdentry, attr, NULL);
 	mutex_unlock(&newdentry->d_inode->i_mutex);
@@ -250,6 +278,8 @@ static int ovl_copy_up_locked(struct dentry *workdir, struct dentry *upperdir,
 	if (err)
 		goto out_cleanup;
 
+	/* ovl_dentry_update() orders this before the upper dentry */
+	ovl_dentry_set_metacopy(dentry, metacopy);
 	ovl_dentry_update(dentry, newdentry);
 	newdentry = NULL;
 
@@ -287,7 +317,7 @@ out_cleanup:
  */
 int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 		    struct path *lowerpath, struct kstat *stat,
-		    struct iattr *attr)
+		    struct iattr *attr, bool metacopy)
 {
 	struct dentry *workdir = ovl_workdir(dentry);
 	int err;
@@ -357,7 +387,8 @@ int ovl_copy_up_one(struct dentry *parent, struct dentry *dentry,
 	}
 
 	err = ovl_copy_up_locked(workdir, upperdir, dentry, lowerpath,
-				 stat, attr, link);
+				 stat, attr, link,
+				 metacopy && ovl_metacopy_enabled(dentry));
 	if (!err) {
 		/* Restore timestamps on parent (best effort) */
 		ovl_set_timestamps(upperdir, &pstat);
@@ -375,7 +406,99 @@ out_free_link:
 	return err;
 }
 
-int ovl_copy_up(struct dentry *dentry)
+/*
+ * Complete a metadata only copy up by copying the data from the lower
+ * file, or just truncate it if the caller is about to do that anyway.
+ * Copy up's exclusion on the upper parent also serialises this against
+ * other openers.
+ */
+int ovl_copy_up_data_finish(struct dentry *dentry, bool no_data)
+{
+	struct dentry *workdir = ovl_workdir(dentry);
+	struct dentry *parent;
+	struct dentry *upperdir;
+	struct path lowerpath;
+	struct path upperpath;
+	struct kstat stat;
+	const struct cred *old_cred;
+	struct cred *override_cred;
+	int err;
+
+	if (WARN_ON(!workdir))
+		return -EROFS;
+
+	err = -ENOMEM;
+	override_cred = prepare_creds();
+	if (!override_cred)
+		return err;
+
+	/*
+	 * CAP_SYS_ADMIN for removing the metacopy xattr
+	 * CAP_DAC_OVERRIDE for opening the upper file for write
+	 * CAP_FOWNER for timestamp update
+	 * CAP_FSETID for keeping the set-id bits while writing
+	 */
+	cap_raise(override_cred->cap_effective, CAP_SYS_ADMIN);
+	cap_raise(override_cred->cap_effective, CAP_DAC_OVERRIDE);
+	cap_raise(override_cred->cap_effective, CAP_FOWNER);
+	cap_raise(override_cred->cap_effective, CAP_FSETID);
+	old_cred = override_creds(override_cred);
+
+	parent = dget_parent(dentry);
+	upperdir = ovl_dentry_upper(parent);
+
+	err = -EIO;
+	if (lock_rename(workdir, upperdir) != NULL) {
+		pr_err("overlayfs: failed to lock workdir+upperdir\n");
+		goto out_unlock;
+	}
+
+	/* Raced with another opener? */
+	err = 0;
+	if (!ovl_dentry_is_metacopy(dentry))
+		goto out_unlock;
+
+	ovl_path_lower(dentry, &lowerpath);
+	ovl_path_upper(dentry, &upperpath);
+	err = vfs_getattr(&upperpath, &stat);
+	if (err)
+		goto out_unlock;
+
+	if (no_data) {
+		struct iattr attr = {
+			.ia_valid = ATTR_SIZE,
+			.ia_size = 0,
+		};
+
+		mutex_lock(&upperpath.dentry->d_inode->i_mutex);
+		err = notify_change(upperpath.dentry, &attr, NULL);
+		mutex_unlock(&upperpath.dentry->d_inode->i_mutex);
+	} else {
+		err = ovl_copy_up_data(&lowerpath, &upperpath, stat.size);
+	}
+	if (!err)
+		err = ovl_do_removexattr(upperpath.dentry, OVL_XATTR_METACOPY);
+	if (err)
+		goto out_unlock;
+
+	/* Restore timestamps (best effort) */
+	mutex_lock(&upperpath.dentry->d_inode->i_mutex);
+	ovl_set_timestamps(upperpath.dentry, &stat);
+	mutex_unlock(&upperpath.dentry->d_inode->i_mutex);
+
+	/* Data must be in place before opens stop going to the lower file */
+	smp_wmb();
+	ovl_dentry_set_metacopy(dentry, false);
+out_unlock:
+	unlock_rename(workdir, upperdir);
+	dput(parent);
+	revert_creds(old_cred);
+	put_cred(override_cred);
+
+	return err;
+}
+
+static int __ovl_copy_up(struct dentry *dentry, bool metacopy)
 {
 	int err;
 
@@ -406,7 +529,8 @@ int ovl_copy_up(struct dentry *dentry)
 		ovl_path_lower(next, &lowerpath);
 		err = vfs_getattr(&lowerpath, &stat);
 		if (!err)
-			err = ovl_copy_up_one(parent, next, &lowerpath, &stat, NULL);
+			err = ovl_copy_up_one(parent, next, &lowerpath, &stat,
+					      NULL, metacopy && next == dentry);
 
 		dput(parent);
 		dput(next);
@@ -414,3 +538,21 @@ int ovl_copy_up(struct dentry *dentry)
 
 	return err;
 }
+
+/* Copy up dentry and its ancestors including the data */
+int ovl_copy_up(struct dentry *dentry)
+{
+	int err;
+
+	err = __ovl_copy_up(dentry, false);
+	if (!err && ovl_dentry_is_metacopy(dentry))
+		err = ovl_copy_up_data_finish(dentry, false);
+
+	return err;
+}
+
+/* Copy up for a metadata change, the data may stay in the lower file */
+int ovl_copy_up_meta(struct dentry *dentry)
+{
+	return __ovl_copy_up(dentry, true);
+}
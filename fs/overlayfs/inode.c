@@ -33,7 +33,9 @@ static int ovl_copy_up_last(struct dentry *dentry, struct iattr *attr,
 	if (no_data)
 		stat.size = 0;
 
-	err = ovl_copy_up_one(parent, dentry, &lowerpath, &stat, attr);
+	/* Attribute only changes leave the data in the lower file */
+	err = ovl_copy_up_one(parent, dentry, &lowerpath, &stat, attr,
+			      attr && !(attr->ia_valid & ATTR_SIZE));
 
 out_dput_parent:
 	dput(parent);
@@ -51,12 +53,19 @@ int ovl_setattr(struct dentry *dentry, struct iattr *attr)
 
 	upperdentry = ovl_dentry_upper(dentry);
 	if (upperdentry) {
+		if ((attr->ia_valid & ATTR_SIZE) &&
+		    ovl_dentry_is_metacopy(dentry)) {
+			err = ovl_copy_up_data_finish(dentry, !attr->ia_size);
+			if (err)
+				goto out_drop_write;
+		}
 		mutex_lock(&upperdentry->d_inode->i_mutex);
 		err = notify_change(upperdentry, attr, NULL);
 		mutex_unlock(&upperdentry->d_inode->i_mutex);
 	} else {
 		err = ovl_copy_up_last(dentry, attr, false);
 	}
+out_drop_write:
 	ovl_drop_write(dentry);
 out:
 	return err;
@@ -222,7 +231,7 @@ int ovl_setxattr(struct dentry *dentry, const char *name,
 	if (ovl_is_private_xattr(name))
 		goto out_drop_write;
 
-	err = ovl_copy_up(dentry);
+	err = ovl_copy_up_meta(dentry);
 	if (err)
 		goto out_drop_write;
 
@@ -239,7 +248,8 @@ static bool ovl_need_xattr_filter(struct dentry *dentry,
 				  enum ovl_path_type type)
 {
 	if ((type & (__OVL_PATH_PURE | __OVL_PATH_UPPER)) == __OVL_PATH_UPPER)
-		return S_ISDIR(dentry->d_inode->i_mode);
+		return S_ISDIR(dentry->d_inode->i_mode) ||
+		       S_ISREG(dentry->d_inode->i_mode);
 	else
 		return false;
 }
@@ -307,7 +317,7 @@ int ovl_removexattr(struct dentry *dentry, const char *name)
 		if (err < 0)
 			goto out_drop_write;
 
-		err = ovl_copy_up(dentry);
+		err = ovl_copy_up_meta(dentry);
 		if (err)
 			goto out_drop_write;
 
@@ -346,7 +356,29 @@ struct inode *ovl_d_select_inode(struct dentry *dentry, unsigned file_flags)
 		return d_backing_inode(dentry);
 
 	type = ovl_path_real(dentry, &realpath);
-	if (ovl_open_need_copy_up(file_flags, type, realpath.dentry)) {
+	/* Pairs with smp_wmb() in ovl_dentry_update() */
+	smp_rmb();
+	if (OVL_TYPE_UPPER(type) && ovl_dentry_is_metacopy(dentry)) {
+		/*
+		 * exec must see the upper inode's mode and owner, so it
+		 * copies the data up like a write open does.
+		 */
+		if (!(OPEN_FMODE(file_flags) & FMODE_WRITE) &&
+		    !(file_flags & (O_TRUNC | __FMODE_EXEC))) {
+			/* Data hasn't been copied up yet */
+			ovl_path_lower(dentry, &realpath);
+			return d_backing_inode(realpath.dentry);
+		}
+
+		err = ovl_want_write(dentry);
+		if (err)
+			return ERR_PTR(err);
+
+		err = ovl_copy_up_data_finish(dentry, file_flags & O_TRUNC);
+		ovl_drop_write(dentry);
+		if (err)
+			return ERR_PTR(err);
+	} else if (ovl_open_need_copy_up(file_flags, type, realpath.dentry)) {
 		err = ovl_want_write(dentry);
 		if (err)
 			return ERR_PTR(err);
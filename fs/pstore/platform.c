@@ -28,7 +28,12 @@
 #include <linux/console.h>
 #include <linux/module.h>
 #include <linux/pstore.h>
+#ifdef CONFIG_PSTORE_ZLIB_COMPRESS
 #include <linux/zlib.h>
+#endif
+#ifdef CONFIG_PSTORE_LZ4_COMPRESS
+#include <linux/lz4.h>
+#endif
 #include <linux/string.h>
 #include <linux/timer.h>
 #include <linux/slab.h>
@@ -68,11 +73,16 @@ struct pstore_info *psinfo;
 
 static char *backend;
 
+#ifdef CONFIG_PSTORE_ZLIB_COMPRESS
 /* Compression parameters */
 #define COMPR_LEVEL 6
 #define WINDOW_BITS 12
 #define MEM_LEVEL 4
 static struct z_stream_s stream;
+#else
+static unsigned char *workspace;
+static unsigned char *lz4_buf;
+#endif
 
 static char *big_oops_buf;
 static size_t big_oops_buf_sz;
@@ -129,6 +139,7 @@ bool pstore_cannot_block_path(enum kmsg_dump_reason reason)
 }
 EXPORT_SYMBOL_GPL(pstore_cannot_block_path);
 
+#ifdef CONFIG_PSTORE_ZLIB_COMPRESS
 /* Derived from logfs_compress() */
 static int pstore_compress(const void *in, void *out, size_t inlen,
 							size_t outlen)
@@ -236,6 +247,59 @@ static void allocate_buf_for_compression(void)
 	}
 
 }
+#else
+/*
+ * LZ4 needs a worst case sized output buffer, so compress into lz4_buf
+ * and only keep the result if it fits the backend's buffer.
+ */
+static int pstore_compress(const void *in, void *out, size_t inlen,
+							size_t outlen)
+{
+	size_t len;
+	int err;
+
+	err = lz4_compress(in, inlen, lz4_buf, &len, workspace);
+	if (err || len > outlen || len >= inlen)
+		return -EIO;
+
+	memcpy(out, lz4_buf, len);
+	return len;
+}
+
+static int pstore_decompress(void *in, void *out, size_t inlen, size_t outlen)
+{
+	int err;
+
+	err = lz4_decompress_unknownoutputsize(in, inlen, out, &outlen);
+	if (err)
+		return -EIO;
+
+	return outlen;
+}
+
+static void allocate_buf_for_compression(void)
+{
+	/* kernel logs compress by a bit more than half with LZ4 */
+	big_oops_buf_sz = psinfo->bufsize * 2;
+	big_oops_buf = kmalloc(big_oops_buf_sz, GFP_KERNEL);
+	if (!big_oops_buf) {
+		pr_err("No memory for uncompressed data; skipping compression\n");
+		return;
+	}
+
+	workspace = kmalloc(LZ4_MEM_COMPRESS, GFP_KERNEL);
+	lz4_buf = kmalloc(lz4_compressbound(big_oops_buf_sz), GFP_KERNEL);
+	if (!workspace || !lz4_buf) {
+		pr_err("No memory for compression workspace; skipping compression\n");
+		kfree(lz4_buf);
+		kfree(workspace);
+		kfree(big_oops_buf);
+		lz4_buf = NULL;
+		workspace = NULL;
+		big_oops_buf = NULL;
+	}
+}
+#endif
 
 /*
  * Called when compression fails, since the printk buffer
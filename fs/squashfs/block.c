@@ -212,3 +212,29 @@ read_failure:
 	kfree(bh);
 	return -EIO;
 }
+
+/*
+ * Start reading a datablock without waiting for it.  A later
+ * squashfs_read_data() of the same block finds the buffers uptodate or
+ * in flight.  Called under a block plug, so the reads of consecutive
+ * datablocks are merged into large requests.
+ */
+void squashfs_read_data_ahead(struct super_block *sb, u64 index, int length)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	u64 cur_index = index >> msblk->devblksize_log2;
+	int bytes = -(index & ((1 << msblk->devblksize_log2) - 1));
+	struct buffer_head *bh;
+
+	length = SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
+	if ((index + length) > msblk->bytes_used)
+		return;
+
+	for (; bytes < length; cur_index++, bytes += msblk->devblksize) {
+		bh = sb_getblk(sb, cur_index);
+		if (bh == NULL)
+			return;
+		ll_rw_block(READ, 1, &bh);
+		put_bh(bh);
+	}
+}
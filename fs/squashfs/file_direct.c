@@ -13,6 +13,8 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/blkdev.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -174,3 +176,203 @@ out:
 	squashfs_cache_put(buffer);
 	return res;
 }
+
+/*
+ * Readahead.  All datablocks covered by the readahead window are submitted
+ * to the block layer at once, so they are read in a few large requests,
+ * and then decompressed in parallel straight into the page cache, one
+ * work item per block.  Each decompression grabs a decompressor the same
+ * way concurrent readers do, so how many blocks really run in parallel
+ * depends on the decompressor parallelisation option.
+ */
+struct squashfs_ra_block {
+	struct work_struct	work;
+	struct super_block	*sb;
+	struct page		**page;
+	int			pages;
+	u64			block;
+	int			bsize;
+};
+
+static void squashfs_ra_decompress(struct squashfs_ra_block *rab)
+{
+	struct squashfs_page_actor *actor;
+	int i, bytes, res = -ENOMEM;
+	void *pageaddr;
+
+	actor = squashfs_page_actor_init_special(rab->page, rab->pages, 0);
+	if (actor) {
+		res = squashfs_read_data(rab->sb, rab->block, rab->bsize, NULL,
+			actor);
+		kfree(actor);
+	}
+
+	/* Last page may have trailing bytes not filled */
+	bytes = res % PAGE_CACHE_SIZE;
+	if (res > 0 && bytes) {
+		pageaddr = kmap_atomic(rab->page[rab->pages - 1]);
+		memset(pageaddr + bytes, 0, PAGE_CACHE_SIZE - bytes);
+		kunmap_atomic(pageaddr);
+	}
+
+	for (i = 0; i < rab->pages; i++) {
+		flush_dcache_page(rab->page[i]);
+		if (res < 0)
+			SetPageError(rab->page[i]);
+		else
+			SetPageUptodate(rab->page[i]);
+		unlock_page(rab->page[i]);
+		page_cache_release(rab->page[i]);
+	}
+}
+
+static void squashfs_ra_work(struct work_struct *work)
+{
+	squashfs_ra_decompress(container_of(work, struct squashfs_ra_block,
+		work));
+}
+
+/*
+ * Set up the direct decompression of the datablock covering the locked
+ * readahead pages ra[0..n-1].  Returns false if the block has to go
+ * through squashfs_readpage(), because it is a fragment or sparse, or
+ * because some of its other pages could not be grabbed.
+ */
+static bool squashfs_ra_prepare(struct squashfs_ra_block *rab,
+	struct inode *inode, struct page **ra, int n)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int index = ra[0]->index >> shift;
+	int start_index = index << shift;
+	int end_index = start_index | ((1 << shift) - 1);
+	int i, j, bsize;
+	u64 block = 0;
+
+	if (index >= i_size_read(inode) >> msblk->block_log &&
+			squashfs_i(inode)->fragment_block !=
+			SQUASHFS_INVALID_BLK)
+		return false;
+
+	bsize = squashfs_read_blocklist(inode, index, &block);
+	if (bsize <= 0)
+		return false;
+
+	if (end_index > file_end)
+		end_index = file_end;
+
+	rab->pages = end_index - start_index + 1;
+	rab->page = kcalloc(rab->pages, sizeof(void *), GFP_KERNEL);
+	if (rab->page == NULL)
+		return false;
+
+	for (i = 0, j = 0; i < rab->pages; i++) {
+		if (j < n && ra[j]->index == start_index + i) {
+			rab->page[i] = ra[j++];
+			continue;
+		}
+
+		rab->page[i] = grab_cache_page_nowait(inode->i_mapping,
+			start_index + i);
+		if (rab->page[i] == NULL)
+			goto failed;
+		if (PageUptodate(rab->page[i])) {
+			unlock_page(rab->page[i]);
+			page_cache_release(rab->page[i]);
+			rab->page[i] = NULL;
+			goto failed;
+		}
+	}
+
+	rab->sb = inode->i_sb;
+	rab->block = block;
+	rab->bsize = bsize;
+	return true;
+
+failed:
+	/* Release the pages grabbed here, the readahead pages stay locked */
+	while (i--) {
+		if (j && rab->page[i] == ra[j - 1]) {
+			j--;
+			continue;
+		}
+		unlock_page(rab->page[i]);
+		page_cache_release(rab->page[i]);
+	}
+	kfree(rab->page);
+	rab->page = NULL;
+	return false;
+}
+
+int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	struct squashfs_ra_block *rab;
+	struct page **ra, *page;
+	int i, j, n, nr_ra = 0, blocks = 0;
+
+	ra = kmalloc_array(nr_pages, sizeof(void *), GFP_KERNEL);
+	rab = kcalloc(nr_pages, sizeof(*rab), GFP_KERNEL);
+	if (ra == NULL || rab == NULL)
+		goto out;
+
+	/* Pages come in ascending index order from the tail of the list */
+	while (!list_empty(pages)) {
+		page = list_entry(pages->prev, struct page, lru);
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+				GFP_KERNEL)) {
+			page_cache_release(page);
+			continue;
+		}
+		ra[nr_ra++] = page;
+	}
+
+	for (i = 0; i < nr_ra; i += n) {
+		for (n = 1; i + n < nr_ra; n++)
+			if (ra[i + n]->index >> shift != ra[i]->index >> shift)
+				break;
+
+		if (squashfs_ra_prepare(&rab[blocks], inode, ra + i, n)) {
+			squashfs_read_data_ahead(inode->i_sb,
+				rab[blocks].block, rab[blocks].bsize);
+			blocks++;
+			continue;
+		}
+
+		/*
+		 * Let squashfs_readpage() fill the whole block from the
+		 * first page, the others are dropped unread and read on
+		 * demand if it couldn't get them.
+		 */
+		for (j = 1; j < n; j++) {
+			unlock_page(ra[i + j]);
+			page_cache_release(ra[i + j]);
+		}
+		squashfs_readpage(file, ra[i]);
+		page_cache_release(ra[i]);
+	}
+
+	/* Hand the merged reads to the device before waiting on them */
+	blk_flush_plug(current);
+
+	for (i = 1; i < blocks; i++) {
+		INIT_WORK(&rab[i].work, squashfs_ra_work);
+		queue_work(system_unbound_wq, &rab[i].work);
+	}
+	if (blocks)
+		squashfs_ra_decompress(&rab[0]);
+	for (i = 1; i < blocks; i++)
+		flush_work(&rab[i].work);
+
+	for (i = 0; i < blocks; i++)
+		kfree(rab[i].page);
+out:
+	kfree(rab);
+	kfree(ra);
+	return 0;
+}
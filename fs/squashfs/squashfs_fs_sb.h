@@ -76,5 +76,7 @@ struct squashfs_sb_info {
 	long long				bytes_used;
 	unsigned int				inodes;
 	int					xattr_ids;
+	int					fragment_cache_size;
+	int					metadata_cache_size;
 };
 #endif
@@ -38,6 +38,8 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -49,6 +51,67 @@
 static struct file_system_type squashfs_fs_type;
 static const struct super_operations squashfs_super_ops;
 
+enum {
+	Opt_fragment_cache,
+	Opt_metadata_cache,
+	Opt_err
+};
+
+static const match_table_t squashfs_tokens = {
+	{Opt_fragment_cache, "fragment_cache=%u"},
+	{Opt_metadata_cache, "metadata_cache=%u"},
+	{Opt_err, NULL}
+};
+
+/*
+ * Parse the mount options.  fragment_cache= and metadata_cache= set the
+ * number of decompressed fragment and metadata blocks kept per mount, so
+ * that many concurrent readers of small files don't keep evicting each
+ * other's fragments.
+ */
+static int squashfs_parse_options(char *options, int *fragments,
+	int *metadata)
+{
+	substring_t args[MAX_OPT_ARGS];
+	bool warned = false;
+	int token, value;
+	char *p;
+
+	if (options == NULL)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		token = match_token(p, squashfs_tokens, args);
+		switch (token) {
+		case Opt_fragment_cache:
+		case Opt_metadata_cache:
+			if (match_int(&args[0], &value) || value < 1 ||
+					value > SQUASHFS_CACHE_MAX) {
+				ERROR("Invalid cache size \"%s\", must be 1 "
+					"to %d\n", p, SQUASHFS_CACHE_MAX);
+				return -EINVAL;
+			}
+			if (token == Opt_fragment_cache)
+				*fragments = value;
+			else
+				*metadata = value;
+			break;
+		default:
+			/* Squashfs has always ignored unknown options */
+			if (!warned)
+				WARNING("Ignoring unrecognised mount option "
+					"\"%s\"\n", p);
+			warned = true;
+			break;
+		}
+	}
+
+	return 0;
+}
+
 static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 	major, short minor, short id)
 {
@@ -97,6 +160,16 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	}
 	msblk = sb->s_fs_info;
 
+	msblk->fragment_cache_size = SQUASHFS_CACHED_FRAGMENTS;
+	msblk->metadata_cache_size = SQUASHFS_CACHED_BLKS;
+	err = squashfs_parse_options(data, &msblk->fragment_cache_size,
+		&msblk->metadata_cache_size);
+	if (err) {
+		kfree(msblk);
+		sb->s_fs_info = NULL;
+		return err;
+	}
+
 	msblk->devblksize = sb_min_blocksize(sb, SQUASHFS_DEVBLK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
 
@@ -202,7 +275,7 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			msblk->metadata_cache_size, SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
@@ -278,7 +351,7 @@ handle_fragments:
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		msblk->fragment_cache_size, msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -373,8 +446,38 @@ static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 
 static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 {
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int fragments = msblk->fragment_cache_size;
+	int metadata = msblk->metadata_cache_size;
+	int err;
+
 	sync_filesystem(sb);
 	*flags |= MS_RDONLY;
+
+	err = squashfs_parse_options(data, &fragments, &metadata);
+	if (err)
+		return err;
+
+	/* The caches are in use, they can only be sized at mount time */
+	if (fragments != msblk->fragment_cache_size ||
+			metadata != msblk->metadata_cache_size) {
+		ERROR("Cache sizes cannot be changed on remount\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int squashfs_show_options(struct seq_file *seq, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	if (msblk->fragment_cache_size != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(seq, ",fragment_cache=%d",
+			msblk->fragment_cache_size);
+	if (msblk->metadata_cache_size != SQUASHFS_CACHED_BLKS)
+		seq_printf(seq, ",metadata_cache=%d",
+			msblk->metadata_cache_size);
 	return 0;
 }
 
@@ -498,7 +601,8 @@ static const struct super_operations squashfs_super_ops = {
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
-	.remount_fs = squashfs_remount
+	.remount_fs = squashfs_remount,
+	.show_options = squashfs_show_options
 };
 
 module_init(init_squashfs_fs);
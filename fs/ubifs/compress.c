@@ -25,9 +25,14 @@
 /*
  * This file provides a single place to access to compression and
  * decompression.
+ *
+ * Every compressor has one cryptoapi handle per CPU, so that tasks writing
+ * back or reading different inodes compress and decompress in parallel
+ * instead of queueing up on a single handle.
  */
 
 #include <linux/crypto.h>
+#include <linux/percpu.h>
 #include "ubifs.h"
 
 /* Fake description object for the "none" compressor */
@@ -38,11 +43,8 @@ static struct ubifs_compressor none_compr = {
 };
 
 #ifdef CONFIG_UBIFS_FS_LZO
-static DEFINE_MUTEX(lzo_mutex);
-
 static struct ubifs_compressor lzo_compr = {
 	.compr_type = UBIFS_COMPR_LZO,
-	.comp_mutex = &lzo_mutex,
 	.name = "lzo",
 	.capi_name = "lzo",
 };
@@ -54,13 +56,8 @@ static struct ubifs_compressor lzo_compr = {
 #endif
 
 #ifdef CONFIG_UBIFS_FS_ZLIB
-static DEFINE_MUTEX(deflate_mutex);
-static DEFINE_MUTEX(inflate_mutex);
-
 static struct ubifs_compressor zlib_compr = {
 	.compr_type = UBIFS_COMPR_ZLIB,
-	.comp_mutex = &deflate_mutex,
-	.decomp_mutex = &inflate_mutex,
 	.name = "zlib",
 	.capi_name = "deflate",
 };
@@ -71,9 +68,45 @@ static struct ubifs_compressor zlib_compr = {
 };
 #endif
 
+/* Known so that nodes using it are reported, never compiled in */
+static struct ubifs_compressor zstd_compr = {
+	.compr_type = UBIFS_COMPR_ZSTD,
+	.name = "zstd",
+};
+
+#ifdef CONFIG_UBIFS_FS_LZ4
+static struct ubifs_compressor lz4_compr = {
+	.compr_type = UBIFS_COMPR_LZ4,
+	.name = "lz4",
+	.capi_name = "lz4",
+};
+#else
+static struct ubifs_compressor lz4_compr = {
+	.compr_type = UBIFS_COMPR_LZ4,
+	.name = "lz4",
+};
+#endif
+
 /* All UBIFS compressors */
 struct ubifs_compressor *ubifs_compressors[UBIFS_COMPR_TYPES_CNT];
 
+/**
+ * compr_ctx_lock - get and lock a compressor context.
+ * @compr: compressor description object
+ *
+ * This function returns the context of the current CPU locked. The task may
+ * be migrated to another CPU meanwhile, which does no harm, but usually it is
+ * the only user of the context and takes the mutex without contention.
+ */
+static struct ubifs_compr_ctx *compr_ctx_lock(struct ubifs_compressor *compr)
+{
+	struct ubifs_compr_ctx *ctx;
+
+	ctx = per_cpu_ptr(compr->ctx, raw_smp_processor_id());
+	mutex_lock(&ctx->mutex);
+	return ctx;
+}
+
 /**
  * ubifs_compress - compress data.
  * @in_buf: data to compress
@@ -97,6 +130,7 @@ void ubifs_compress(const struct ubifs_info *c, const void *in_buf,
 {
 	int err;
 	struct ubifs_compressor *compr = ubifs_compressors[*compr_type];
+	struct ubifs_compr_ctx *ctx;
 
 	if (*compr_type == UBIFS_COMPR_NONE)
 		goto no_compr;
@@ -105,12 +139,10 @@ void ubifs_compress(const struct ubifs_info *c, const void *in_buf,
 	if (in_len < UBIFS_MIN_COMPR_LEN)
 		goto no_compr;
 
-	if (compr->comp_mutex)
-		mutex_lock(compr->comp_mutex);
-	err = crypto_comp_compress(compr->cc, in_buf, in_len, out_buf,
+	ctx = compr_ctx_lock(compr);
+	err = crypto_comp_compress(ctx->cc, in_buf, in_len, out_buf,
 				   (unsigned int *)out_len);
-	if (compr->comp_mutex)
-		mutex_unlock(compr->comp_mutex);
+	mutex_unlock(&ctx->mutex);
 	if (unlikely(err)) {
 		ubifs_warn(c, "cannot compress %d bytes, compressor %s, error %d, leave data uncompressed",
 			   in_len, compr->name, err);
@@ -149,6 +181,7 @@ int ubifs_decompress(const struct ubifs_info *c, const void *in_buf,
 {
 	int err;
 	struct ubifs_compressor *compr;
+	struct ubifs_compr_ctx *ctx;
 
 	if (unlikely(compr_type < 0 || compr_type >= UBIFS_COMPR_TYPES_CNT)) {
 		ubifs_err(c, "invalid compression type %d", compr_type);
@@ -168,12 +201,10 @@ int ubifs_decompress(const struct ubifs_info *c, const void *in_buf,
 		return 0;
 	}
 
-	if (compr->decomp_mutex)
-		mutex_lock(compr->decomp_mutex);
-	err = crypto_comp_decompress(compr->cc, in_buf, in_len, out_buf,
+	ctx = compr_ctx_lock(compr);
+	err = crypto_comp_decompress(ctx->cc, in_buf, in_len, out_buf,
 				     (unsigned int *)out_len);
-	if (compr->decomp_mutex)
-		mutex_unlock(compr->decomp_mutex);
+	mutex_unlock(&ctx->mutex);
 	if (err)
 		ubifs_err(c, "cannot decompress %d bytes, compressor %s, error %d",
 			  in_len, compr->name, err);
@@ -181,6 +212,27 @@ int ubifs_decompress(const struct ubifs_info *c, const void *in_buf,
 	return err;
 }
 
+/**
+ * compr_exit - de-initialize a compressor.
+ * @compr: compressor description object
+ */
+static void compr_exit(struct ubifs_compressor *compr)
+{
+	int cpu;
+
+	if (!compr->ctx)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct ubifs_compr_ctx *ctx = per_cpu_ptr(compr->ctx, cpu);
+
+		if (!IS_ERR_OR_NULL(ctx->cc))
+			crypto_free_comp(ctx->cc);
+	}
+	free_percpu(compr->ctx);
+	compr->ctx = NULL;
+}
+
 /**
  * compr_init - initialize a compressor.
  * @compr: compressor description object
@@ -190,12 +242,27 @@ int ubifs_decompress(const struct ubifs_info *c, const void *in_buf,
  */
 static int __init compr_init(struct ubifs_compressor *compr)
 {
+	int cpu;
+
 	if (compr->capi_name) {
-		compr->cc = crypto_alloc_comp(compr->capi_name, 0, 0);
-		if (IS_ERR(compr->cc)) {
-			pr_err("UBIFS error (pid %d): cannot initialize compressor %s, error %ld",
-			       current->pid, compr->name, PTR_ERR(compr->cc));
-			return PTR_ERR(compr->cc);
+		compr->ctx = alloc_percpu(struct ubifs_compr_ctx);
+		if (!compr->ctx)
+			return -ENOMEM;
+
+		for_each_possible_cpu(cpu) {
+			struct ubifs_compr_ctx *ctx = per_cpu_ptr(compr->ctx,
+								  cpu);
+
+			mutex_init(&ctx->mutex);
+			ctx->cc = crypto_alloc_comp(compr->capi_name, 0, 0);
+			if (IS_ERR(ctx->cc)) {
+				int err = PTR_ERR(ctx->cc);
+
+				pr_err("UBIFS error (pid %d): cannot initialize compressor %s, error %d",
+				       current->pid, compr->name, err);
+				compr_exit(compr);
+				return err;
+			}
 		}
 	}
 
@@ -203,17 +270,6 @@ static int __init compr_init(struct ubifs_compressor *compr)
 	return 0;
 }
 
-/**
- * compr_exit - de-initialize a compressor.
- * @compr: compressor description object
- */
-static void compr_exit(struct ubifs_compressor *compr)
-{
-	if (compr->capi_name)
-		crypto_free_comp(compr->cc);
-	return;
-}
-
 /**
  * ubifs_compressors_init - initialize UBIFS compressors.
  *
@@ -232,9 +288,16 @@ int __init ubifs_compressors_init(void)
 	if (err)
 		goto out_lzo;
 
+	err = compr_init(&lz4_compr);
+	if (err)
+		goto out_zlib;
+
 	ubifs_compressors[UBIFS_COMPR_NONE] = &none_compr;
+	ubifs_compressors[UBIFS_COMPR_ZSTD] = &zstd_compr;
 	return 0;
 
+out_zlib:
+	compr_exit(&zlib_compr);
 out_lzo:
 	compr_exit(&lzo_compr);
 	return err;
@@ -247,4 +310,5 @@ void ubifs_compressors_exit(void)
 {
 	compr_exit(&lzo_compr);
 	compr_exit(&zlib_compr);
+	compr_exit(&lz4_compr);
 }
@@ -46,7 +46,7 @@
  * Similarly, @i_mutex is not always locked in 'ubifs_readpage()', e.g., the
  * read-ahead path does not lock it ("sys_read -> generic_file_aio_read ->
  * ondemand_readahead -> readpage"). In case of readahead, @I_SYNC flag is not
- * set as well. However, UBIFS disables readahead.
+ * set as well. However, UBIFS disables readahead unless bulk-read is enabled.
  */
 
 #include "ubifs.h"
@@ -894,6 +894,81 @@ static int ubifs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+/**
+ * ubifs_readpages - read-ahead pages.
+ * @file: file to read
+ * @mapping: address space of the file
+ * @pages: pages to read, in reverse order of their index
+ * @nr_pages: number of pages in @pages
+ *
+ * The pages are added to the page cache one by one. Each page which is not
+ * up-to-date yet starts a bulk-read, which also populates the following
+ * pages with the data nodes found consecutively in the same LEB. The
+ * read-ahead pages for those are then already cached and are dropped. If
+ * bulk-read is not possible, the pages are read one by one.
+ */
+static int ubifs_readpages(struct file *file, struct address_space *mapping,
+			   struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	struct ubifs_inode *ui = ubifs_inode(inode);
+	struct bu_info *bu = NULL;
+	int bulk = 0, allocated = 0;
+
+	/* See the comments in 'ubifs_bulk_read()' */
+	if (mutex_trylock(&ui->ui_mutex)) {
+		if (c->bu.buf && mutex_trylock(&c->bu_mutex))
+			bu = &c->bu;
+		else {
+			bu = kmalloc(sizeof(struct bu_info),
+				     GFP_NOFS | __GFP_NOWARN);
+			allocated = 1;
+		}
+		if (bu)
+			bulk = 1;
+		else
+			mutex_unlock(&ui->ui_mutex);
+	}
+
+	while (!list_empty(pages)) {
+		struct page *page = list_entry(pages->prev, struct page, lru);
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+					  GFP_NOFS)) {
+			/* Already cached, most likely by the last bulk-read */
+			page_cache_release(page);
+			continue;
+		}
+
+		if (bulk) {
+			if (allocated)
+				bu->buf = NULL;
+			bu->buf_len = c->max_bu_buf_len;
+			data_key_init(c, &bu->key, inode->i_ino,
+				      page->index << UBIFS_BLOCKS_PER_PAGE_SHIFT);
+			bulk = ubifs_do_bulk_read(c, bu, page);
+		}
+
+		if (!bulk) {
+			ui->last_page_read = page->index;
+			do_readpage(page);
+			unlock_page(page);
+		}
+		page_cache_release(page);
+	}
+
+	if (bu) {
+		if (allocated)
+			kfree(bu);
+		else
+			mutex_unlock(&c->bu_mutex);
+		mutex_unlock(&ui->ui_mutex);
+	}
+	return 0;
+}
+
 static int do_writepage(struct page *page, int len)
 {
 	int err = 0, i, blen;
@@ -1551,6 +1626,7 @@ static int ubifs_file_mmap(struct file *file, struct vm_area_struct *vma)
 
 const struct address_space_operations ubifs_file_address_operations = {
 	.readpage       = ubifs_readpage,
+	.readpages      = ubifs_readpages,
 	.writepage      = ubifs_writepage,
 	.write_begin    = ubifs_write_begin,
 	.write_end      = ubifs_write_end,
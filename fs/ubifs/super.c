@@ -1026,6 +1026,8 @@ static int ubifs_parse_options(struct ubifs_info *c, char *options,
 				c->mount_opts.compr_type = UBIFS_COMPR_LZO;
 			else if (!strcmp(name, "zlib"))
 				c->mount_opts.compr_type = UBIFS_COMPR_ZLIB;
+			else if (!strcmp(name, "lz4"))
+				c->mount_opts.compr_type = UBIFS_COMPR_LZ4;
 			else {
 				ubifs_err(c, "unknown compressor \"%s\"", name); //FIXME: is c ready?
 				kfree(name);
@@ -1112,6 +1114,9 @@ again:
 		c->bulk_read = 0;
 		return;
 	}
+
+	/* Let read-ahead hand us windows of one bulk-read */
+	c->bdi.ra_pages = UBIFS_MAX_BULK_READ >> UBIFS_BLOCKS_PER_PAGE_SHIFT;
 }
 
 /**
@@ -1240,6 +1245,13 @@ static int mount_ubifs(struct ubifs_info *c)
 		goto out_free;
 	}
 
+	c->tnc_cache = kcalloc(UBIFS_TNC_CACHE_SIZE,
+			       sizeof(struct ubifs_tnc_cache_entry), GFP_KERNEL);
+	if (!c->tnc_cache) {
+		err = -ENOMEM;
+		goto out_cbuf;
+	}
+
 	err = alloc_wbufs(c);
 	if (err)
 		goto out_cbuf;
@@ -1482,6 +1494,7 @@ out_master:
 out_wbufs:
 	free_wbufs(c);
 out_cbuf:
+	kfree(c->tnc_cache);
 	kfree(c->cbuf);
 out_free:
 	kfree(c->write_reserve_buf);
@@ -1520,6 +1533,7 @@ static void ubifs_umount(struct ubifs_info *c)
 	free_orphans(c);
 	ubifs_lpt_free(c, 0);
 
+	kfree(c->tnc_cache);
 	kfree(c->cbuf);
 	kfree(c->rcvrd_mst_node);
 	kfree(c->mst_node);
@@ -1864,6 +1878,7 @@ static int ubifs_remount_fs(struct super_block *sb, int *flags, char *data)
 		dbg_gen("disable bulk-read");
 		kfree(c->bu.buf);
 		c->bu.buf = NULL;
+		c->bdi.ra_pages = 0;
 	}
 
 	ubifs_assert(c->lst.taken_empty_lebs > 0);
@@ -1959,6 +1974,7 @@ static struct ubifs_info *alloc_ubifs_info(struct ubi_volume_desc *ubi)
 		init_rwsem(&c->commit_sem);
 		mutex_init(&c->lp_mutex);
 		mutex_init(&c->tnc_mutex);
+		seqlock_init(&c->tnc_cache_lock);
 		mutex_init(&c->log_mutex);
 		mutex_init(&c->umount_mutex);
 		mutex_init(&c->bu_mutex);
@@ -2011,7 +2027,9 @@ static int ubifs_fill_super(struct super_block *sb, void *data, int silent)
 	 * which means the user would have to wait not just for their own I/O
 	 * but the read-ahead I/O as well i.e. completely pointless.
 	 *
-	 * Read-ahead will be disabled because @c->bdi.ra_pages is 0.
+	 * Read-ahead will be disabled because @c->bdi.ra_pages is 0, unless
+	 * bulk-read is enabled: then 'ubifs_readpages()' reads the whole
+	 * read-ahead window with as few I/Os as the data node layout allows.
 	 */
 	c->bdi.name = "ubifs",
 	c->bdi.capabilities = 0;
@@ -2221,12 +2239,12 @@ static int __init ubifs_init(void)
 	BUILD_BUG_ON(UBIFS_REF_NODE_SZ != 64);
 
 	/*
-	 * We use 2 bit wide bit-fields to store compression type, which should
+	 * We use 3 bit wide bit-fields to store compression type, which should
 	 * be amended if more compressors are added. The bit-fields are:
 	 * @compr_type in 'struct ubifs_inode', @default_compr in
 	 * 'struct ubifs_info' and @compr_type in 'struct ubifs_mount_opts'.
 	 */
-	BUILD_BUG_ON(UBIFS_COMPR_TYPES_CNT > 4);
+	BUILD_BUG_ON(UBIFS_COMPR_TYPES_CNT > 8);
 
 	/*
 	 * We require that PAGE_CACHE_SIZE is greater-than-or-equal-to
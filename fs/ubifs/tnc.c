@@ -32,6 +32,7 @@
 
 #include <linux/crc32.h>
 #include <linux/slab.h>
+#include <linux/jhash.h>
 #include "ubifs.h"
 
 /*
@@ -474,6 +475,95 @@ static int try_read_node(const struct ubifs_info *c, void *buf, int type,
 	return 1;
 }
 
+/*
+ * The TNC lookup cache remembers where the nodes of recently looked up
+ * non-hashed keys (inode and data node keys) are, so that
+ * 'ubifs_tnc_locate()' can skip the TNC walk and the TNC mutex for them.
+ * Entries are only added and forgotten under the TNC mutex, by the same code
+ * which changes the corresponding zbranches, so a valid entry always points to
+ * the current node of the key. Hashed keys are not cached because their
+ * lookups have to resolve collisions in the TNC anyway.
+ */
+
+static struct ubifs_tnc_cache_entry *tnc_cache_slot(struct ubifs_info *c,
+						    const union ubifs_key *key)
+{
+	u32 hash = jhash_2words(key->u32[0], key->u32[1], 0);
+
+	return &c->tnc_cache[hash & (UBIFS_TNC_CACHE_SIZE - 1)];
+}
+
+/**
+ * tnc_cache_lookup - look up a key in the TNC lookup cache.
+ * @c: UBIFS file-system description object
+ * @key: key to look up
+ * @zbr: the location of the node is returned here
+ *
+ * This function may be called without the TNC mutex. Returns %1 if @key was
+ * found and %0 if not.
+ */
+static int tnc_cache_lookup(struct ubifs_info *c, const union ubifs_key *key,
+			    struct ubifs_zbranch *zbr)
+{
+	struct ubifs_tnc_cache_entry *e = tnc_cache_slot(c, key);
+	unsigned int seq;
+	int found;
+
+	do {
+		seq = read_seqbegin(&c->tnc_cache_lock);
+		found = e->len && keys_eq(c, &e->key, key);
+		if (found) {
+			zbr->lnum = e->lnum;
+			zbr->offs = e->offs;
+			zbr->len = e->len;
+		}
+	} while (read_seqretry(&c->tnc_cache_lock, seq));
+
+	if (found) {
+		key_copy(c, key, &zbr->key);
+		zbr->znode = NULL;
+	}
+	return found;
+}
+
+/**
+ * tnc_cache_add - add a non-hashed key to the TNC lookup cache.
+ * @c: UBIFS file-system description object
+ * @zbr: zbranch of the key, the TNC mutex has to be locked
+ */
+static void tnc_cache_add(struct ubifs_info *c, const struct ubifs_zbranch *zbr)
+{
+	struct ubifs_tnc_cache_entry *e = tnc_cache_slot(c, &zbr->key);
+
+	write_seqlock(&c->tnc_cache_lock);
+	key_copy(c, &zbr->key, &e->key);
+	e->lnum = zbr->lnum;
+	e->offs = zbr->offs;
+	e->len = zbr->len;
+	write_sequnlock(&c->tnc_cache_lock);
+}
+
+/**
+ * tnc_cache_forget - remove a key from the TNC lookup cache.
+ * @c: UBIFS file-system description object
+ * @key: key whose node is moved or removed, the TNC mutex has to be locked
+ */
+static void tnc_cache_forget(struct ubifs_info *c, const union ubifs_key *key)
+{
+	struct ubifs_tnc_cache_entry *e;
+
+	if (!c->tnc_cache || is_hash_key(c, key))
+		return;
+
+	e = tnc_cache_slot(c, key);
+	if (!e->len || !keys_eq(c, &e->key, key))
+		return;
+
+	write_seqlock(&c->tnc_cache_lock);
+	e->len = 0;
+	write_sequnlock(&c->tnc_cache_lock);
+}
+
 /**
  * fallible_read_node - try to read a leaf node.
  * @c: UBIFS file-system description object
@@ -1434,6 +1524,22 @@ int ubifs_tnc_locate(struct ubifs_info *c, const union ubifs_key *key,
 	struct ubifs_znode *znode;
 	struct ubifs_zbranch zbr, *zt;
 
+	if (c->tnc_cache && !is_hash_key(c, key)) {
+		/*
+		 * Sample the GC sequence before looking at the cache: GC
+		 * forgets the keys it moves before it bumps the sequence.
+		 */
+		gc_seq1 = c->gc_seq;
+		smp_rmb();
+		if (tnc_cache_lookup(c, key, &zbr)) {
+			if (lnum) {
+				*lnum = zbr.lnum;
+				*offs = zbr.offs;
+			}
+			goto read_unlocked;
+		}
+	}
+
 again:
 	mutex_lock(&c->tnc_mutex);
 	found = ubifs_lookup_level0(c, key, &znode, &n);
@@ -1464,8 +1570,11 @@ again:
 	/* Drop the TNC mutex prematurely and race with garbage collection */
 	zbr = znode->zbranch[n];
 	gc_seq1 = c->gc_seq;
+	if (c->tnc_cache)
+		tnc_cache_add(c, &zbr);
 	mutex_unlock(&c->tnc_mutex);
 
+read_unlocked:
 	if (ubifs_get_wbuf(c, zbr.lnum)) {
 		/* We do not GC journal heads */
 		err = ubifs_tnc_read_node(c, &zbr, node);
@@ -2169,6 +2278,7 @@ int ubifs_tnc_add(struct ubifs_info *c, const union ubifs_key *key, int lnum,
 		struct ubifs_zbranch *zbr = &znode->zbranch[n];
 
 		lnc_free(zbr);
+		tnc_cache_forget(c, key);
 		err = ubifs_add_dirt(c, zbr->lnum, zbr->len);
 		zbr->lnum = lnum;
 		zbr->offs = offs;
@@ -2217,6 +2327,7 @@ int ubifs_tnc_replace(struct ubifs_info *c, const union ubifs_key *key,
 		found = 0;
 		if (zbr->lnum == old_lnum && zbr->offs == old_offs) {
 			lnc_free(zbr);
+			tnc_cache_forget(c, key);
 			err = ubifs_add_dirt(c, zbr->lnum, zbr->len);
 			if (err)
 				goto out_unlock;
@@ -2384,6 +2495,7 @@ static int tnc_delete(struct ubifs_info *c, struct ubifs_znode *znode, int n)
 
 	zbr = &znode->zbranch[n];
 	lnc_free(zbr);
+	tnc_cache_forget(c, &zbr->key);
 
 	err = ubifs_add_dirt(c, zbr->lnum, zbr->len);
 	if (err) {
@@ -2630,6 +2742,7 @@ int ubifs_tnc_remove_range(struct ubifs_info *c, union ubifs_key *from_key,
 			if (!key_in_range(c, key, from_key, to_key))
 				break;
 			lnc_free(&znode->zbranch[i]);
+			tnc_cache_forget(c, key);
 			err = ubifs_add_dirt(c, znode->zbranch[i].lnum,
 					     znode->zbranch[i].len);
 			if (err) {
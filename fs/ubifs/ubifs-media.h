@@ -332,12 +332,20 @@ enum {
  * UBIFS_COMPR_NONE: no compression
  * UBIFS_COMPR_LZO: LZO compression
  * UBIFS_COMPR_ZLIB: ZLIB compression
+ * UBIFS_COMPR_ZSTD: ZSTD compression, assigned by mainline, not supported
+ * UBIFS_COMPR_LZ4: LZ4 compression, specific to this kernel
  * UBIFS_COMPR_TYPES_CNT: count of supported compression types
+ *
+ * LZ4 is not a mainline UBIFS format.  It takes a type mainline has not
+ * assigned, so that no other kernel decodes LZ4 nodes as ZSTD data; they
+ * fail with an unknown compression type instead.
  */
 enum {
 	UBIFS_COMPR_NONE,
 	UBIFS_COMPR_LZO,
 	UBIFS_COMPR_ZLIB,
+	UBIFS_COMPR_ZSTD,
+	UBIFS_COMPR_LZ4,
 	UBIFS_COMPR_TYPES_CNT,
 };
 
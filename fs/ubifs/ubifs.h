@@ -33,6 +33,7 @@
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
 #include <linux/rwsem.h>
+#include <linux/seqlock.h>
 #include <linux/mtd/ubi.h>
 #include <linux/pagemap.h>
 #include <linux/backing-dev.h>
@@ -173,6 +174,9 @@
 /* Maximum number of data nodes to bulk-read */
 #define UBIFS_MAX_BULK_READ 32
 
+/* Number of entries in the TNC lookup cache, must be a power of 2 */
+#define UBIFS_TNC_CACHE_SIZE 512
+
 /*
  * Lockdep classes for UBIFS inode @ui_mutex.
  */
@@ -412,7 +416,7 @@ struct ubifs_inode {
 	unsigned int dirty:1;
 	unsigned int xattr:1;
 	unsigned int bulk_read:1;
-	unsigned int compr_type:2;
+	unsigned int compr_type:3;
 	struct mutex ui_mutex;
 	spinlock_t ui_lock;
 	loff_t synced_i_size;
@@ -756,6 +760,20 @@ struct ubifs_zbranch {
 	int len;
 };
 
+/**
+ * struct ubifs_tnc_cache_entry - TNC lookup cache entry.
+ * @key: key
+ * @lnum: LEB number of the node
+ * @offs: node offset within @lnum
+ * @len: node length, zero if the entry is not used
+ */
+struct ubifs_tnc_cache_entry {
+	union ubifs_key key;
+	int lnum;
+	int offs;
+	int len;
+};
+
 /**
  * struct ubifs_znode - in-memory representation of an indexing node.
  * @parent: parent znode or NULL if it is the root
@@ -827,20 +845,26 @@ struct ubifs_node_range {
 	int max_len;
 };
 
+/**
+ * struct ubifs_compr_ctx - per-CPU compressor context.
+ * @cc: cryptoapi compressor handle
+ * @mutex: serializes users of @cc
+ */
+struct ubifs_compr_ctx {
+	struct crypto_comp *cc;
+	struct mutex mutex;
+};
+
 /**
  * struct ubifs_compressor - UBIFS compressor description structure.
  * @compr_type: compressor type (%UBIFS_COMPR_LZO, etc)
- * @cc: cryptoapi compressor handle
- * @comp_mutex: mutex used during compression
- * @decomp_mutex: mutex used during decompression
+ * @ctx: per-CPU compressor contexts
  * @name: compressor name
  * @capi_name: cryptoapi compressor name
  */
 struct ubifs_compressor {
 	int compr_type;
-	struct crypto_comp *cc;
-	struct mutex *comp_mutex;
-	struct mutex *decomp_mutex;
+	struct ubifs_compr_ctx __percpu *ctx;
 	const char *name;
 	const char *capi_name;
 };
@@ -948,7 +972,7 @@ struct ubifs_mount_opts {
 	unsigned int bulk_read:2;
 	unsigned int chk_data_crc:2;
 	unsigned int override_compr:1;
-	unsigned int compr_type:2;
+	unsigned int compr_type:3;
 };
 
 /**
@@ -1037,6 +1061,9 @@ struct ubifs_debug_info;
  *
  * @tnc_mutex: protects the Tree Node Cache (TNC), @zroot, @cnext, @enext, and
  *             @calc_idx_sz
+ * @tnc_cache: cache of recently looked up non-hashed keys and the location of
+ *             their nodes, changed under @tnc_mutex and @tnc_cache_lock
+ * @tnc_cache_lock: lets readers look up @tnc_cache without @tnc_mutex
  * @zroot: zbranch which points to the root index node and znode
  * @cnext: next znode to commit
  * @enext: next znode to commit to empty space
@@ -1273,10 +1300,12 @@ struct ubifs_info {
 	unsigned int space_fixup:1;
 	unsigned int no_chk_data_crc:1;
 	unsigned int bulk_read:1;
-	unsigned int default_compr:2;
+	unsigned int default_compr:3;
 	unsigned int rw_incompat:1;
 
 	struct mutex tnc_mutex;
+	struct ubifs_tnc_cache_entry *tnc_cache;
+	seqlock_t tnc_cache_lock;
 	struct ubifs_zbranch zroot;
 	struct ubifs_znode *cnext;
 	struct ubifs_znode *enext;
@@ -1,6 +1,7 @@
 #ifndef __DRM_GEM_CMA_HELPER_H__
 #define __DRM_GEM_CMA_HELPER_H__
 
+#include <linux/dma-direction.h>
 #include <drm/drmP.h>
 #include <drm/drm_gem.h>
 
@@ -10,6 +11,8 @@
  * @paddr: physical address of the backing memory
  * @sgt: scatter/gather table for imported PRIME buffers
  * @vaddr: kernel virtual address of the backing memory
+ * @pages: first page of the backing memory of cached objects
+ * @cached: backing memory is mapped cacheable rather than writecombined
  */
 struct drm_gem_cma_object {
 	struct drm_gem_object base;
@@ -18,6 +21,10 @@ struct drm_gem_cma_object {
 
 	/* For objects with DMA memory allocated by GEM CMA */
 	void *vaddr;
+
+	/* For cacheable objects allocated by drm_gem_cma_create_cached() */
+	struct page *pages;
+	bool cached;
 };
 
 static inline struct drm_gem_cma_object *
@@ -51,6 +58,16 @@ int drm_gem_cma_mmap(struct file *filp, struct vm_area_struct *vma);
 struct drm_gem_cma_object *drm_gem_cma_create(struct drm_device *drm,
 					      size_t size);
 
+/* allocate cacheable physical memory, see drm_gem_cma_cpu_prep() */
+struct drm_gem_cma_object *drm_gem_cma_create_cached(struct drm_device *drm,
+						     size_t size);
+
+/* cache maintenance around CPU access to cached objects */
+void drm_gem_cma_cpu_prep(struct drm_gem_cma_object *cma_obj,
+			  enum dma_data_direction dir);
+void drm_gem_cma_cpu_fini(struct drm_gem_cma_object *cma_obj,
+			  enum dma_data_direction dir);
+
 extern const struct vm_operations_struct drm_gem_cma_vm_ops;
 
 #ifdef CONFIG_DEBUG_FS
@@ -41,6 +41,8 @@ enum bdi_stat_item {
 	BDI_WRITEBACK,
 	BDI_DIRTIED,
 	BDI_WRITTEN,
+	BDI_THROTTLED,		/* balance_dirty_pages() calls that slept */
+	BDI_THROTTLE_TIME,	/* jiffies spent in them */
 	NR_BDI_STAT_ITEMS
 };
 
@@ -91,6 +93,8 @@ struct backing_dev_info {
 
 	unsigned int min_ratio;
 	unsigned int max_ratio, max_prop_frac;
+	unsigned int max_delay;		/* writer delay target in ms, 0 = off */
+	unsigned long throttle_max;	/* longest writer delay in jiffies */
 
 	struct bdi_writeback wb;  /* default writeback info for this bdi */
 	spinlock_t wb_lock;	  /* protects work_list & wb.dwork scheduling */
@@ -168,6 +168,11 @@ struct request {
 	struct request_list *rl;		/* rl this rq is alloced from */
 	unsigned long long start_time_ns;
 	unsigned long long io_start_time_ns;    /* when passed to hardware */
+#endif
+#ifdef CONFIG_BLK_DEV_LAT_HIST
+	u64 lat_queue_ns;		/* allocated, 0 if not sampled */
+	u64 lat_issue_ns;		/* handed to the driver */
+	unsigned int lat_bytes;		/* size when handed to the driver */
 #endif
 	/* Number of scatter-gather DMA addr+len pairs after
 	 * physical address coalescing is performed.
@@ -462,6 +467,10 @@ struct request_queue {
 	unsigned int		flush_not_queueable:1;
 	struct blk_flush_queue	*fq;
 
+#ifdef CONFIG_BLK_DEV_LAT_HIST
+	struct blk_lat_hist __percpu *lat_hist;
+#endif
+
 	struct list_head	requeue_list;
 	spinlock_t		requeue_lock;
 	struct work_struct	requeue_work;
@@ -513,6 +522,7 @@ struct request_queue {
 #define QUEUE_FLAG_INIT_DONE   20	/* queue is initialized */
 #define QUEUE_FLAG_NO_SG_MERGE 21	/* don't attempt to merge SG segments*/
 #define QUEUE_FLAG_SG_GAPS     22	/* queue doesn't support SG gaps */
+#define QUEUE_FLAG_LAT_HIST    23	/* keep latency histograms */
 
 #define QUEUE_FLAG_DEFAULT	((1 << QUEUE_FLAG_IO_STAT) |		\
 				 (1 << QUEUE_FLAG_STACKABLE)	|	\
@@ -46,6 +46,8 @@ enum bus_freq_mode {
 extern struct regulator *arm_reg;
 extern struct regulator *soc_reg;
 void request_bus_freq(enum bus_freq_mode mode);
+int request_bus_freq_async(enum bus_freq_mode mode,
+			   void (*done)(void *data), void *data);
 void release_bus_freq(enum bus_freq_mode mode);
 int register_busfreq_notifier(struct notifier_block *nb);
 int unregister_busfreq_notifier(struct notifier_block *nb);
@@ -54,6 +56,13 @@ int get_bus_freq_mode(void);
 static inline void request_bus_freq(enum bus_freq_mode mode)
 {
 }
+static inline int request_bus_freq_async(enum bus_freq_mode mode,
+					 void (*done)(void *data), void *data)
+{
+	if (done)
+		done(data);
+	return 0;
+}
 static inline void release_bus_freq(enum bus_freq_mode mode)
 {
 }
@@ -0,0 +1,15 @@
+#ifndef _MXS_DMA_H_
+#define _MXS_DMA_H_
+
+#include <linux/dmaengine.h>
+
+/*
+ * Driver specific flag for ->device_prep_slave_sg(), only meaningful on the
+ * APBH channels of the GPMI: used together with DMA_PREP_INTERRUPT, the
+ * descriptors chained onto the previous ones keep the NAND locked to this
+ * channel across the join, so that a command and its data phase run back to
+ * back as one chain.
+ */
+#define MXS_DMA_CTRL_NAND_LOCK	BIT(31)
+
+#endif /* _MXS_DMA_H_ */
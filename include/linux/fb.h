@@ -445,6 +445,12 @@ struct fb_tile_ops {
    output like oopses */
 #define FBINFO_CAN_FORCE_OUTPUT     0x200000
 
+/*
+ * The framebuffer is normal (e.g. write-combined) memory that takes
+ * NEON loads and stores, see FB_CFB_NEON.
+ */
+#define FBINFO_CFB_NEON		0x400000
+
 struct fb_info {
 	atomic_t count;
 	int node;
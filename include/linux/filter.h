@@ -330,6 +330,16 @@ struct sk_filter {
 
 #define BPF_PROG_RUN(filter, ctx)  (*filter->bpf_func)(ctx, filter->insnsi)
 
+/* In-kernel context of BPF_PROG_TYPE_RX_EARLY programs.  The leading
+ * fields mirror struct __rx_frame, data is only reachable through the
+ * rx_load_bytes() helper.
+ */
+struct bpf_rx_frame {
+	u32		len;
+	u32		ifindex;
+	void		*data;
+};
+
 static inline unsigned int bpf_prog_size(unsigned int proglen)
 {
 	return max(sizeof(struct bpf_prog),
@@ -1354,6 +1354,9 @@ struct super_block {
 	struct workqueue_struct *s_dio_done_wq;
 	struct hlist_head s_pins;
 
+	/* negative dentries on s_dentry_lru, see negative-dentry-limit */
+	atomic_long_t		s_nr_negative_dentry;
+
 	/*
 	 * Keep the lru lists last in the structure so they always sit on their
 	 * own individual cachelines.
@@ -68,4 +68,12 @@ static inline void exit_pi_state_list(struct task_struct *curr)
 {
 }
 #endif
+
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+extern void futex_private_hash_free(struct mm_struct *mm);
+#else
+static inline void futex_private_hash_free(struct mm_struct *mm)
+{
+}
+#endif
 #endif
@@ -134,4 +134,25 @@ static inline struct gen_pool *of_get_named_gen_pool(struct device_node *np,
 	return NULL;
 }
 #endif
+
+#if defined(CONFIG_GENERIC_ALLOCATOR) && defined(CONFIG_HAS_DMA)
+extern void *iram_dma_alloc_coherent(struct device *dev, size_t size,
+		dma_addr_t *dma, gfp_t gfp);
+extern void iram_dma_free_coherent(struct device *dev, size_t size,
+		void *vaddr, dma_addr_t dma);
+#else
+#include <linux/dma-mapping.h>
+
+static inline void *iram_dma_alloc_coherent(struct device *dev, size_t size,
+		dma_addr_t *dma, gfp_t gfp)
+{
+	return dma_alloc_coherent(dev, size, dma, gfp);
+}
+
+static inline void iram_dma_free_coherent(struct device *dev, size_t size,
+		void *vaddr, dma_addr_t dma)
+{
+	dma_free_coherent(dev, size, vaddr, dma);
+}
+#endif
 #endif /* __GENALLOC_H__ */
@@ -0,0 +1,135 @@
+/*
+ * Block based DMA buffer for the industrial I/O subsystem
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#ifndef __INDUSTRIALIO_BUFFER_DMA_H__
+#define __INDUSTRIALIO_BUFFER_DMA_H__
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/kref.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/iio/buffer.h>
+
+struct iio_dma_buffer_queue;
+struct iio_dma_buffer_ops;
+struct device;
+
+/**
+ * enum iio_block_state - state of a buffer block
+ * @IIO_BLOCK_STATE_DEQUEUED: owned by userspace or not in use
+ * @IIO_BLOCK_STATE_QUEUED: waiting for the buffer to be enabled
+ * @IIO_BLOCK_STATE_ACTIVE: handed to the driver to be filled
+ * @IIO_BLOCK_STATE_DONE: filled, waiting to be dequeued
+ */
+enum iio_block_state {
+	IIO_BLOCK_STATE_DEQUEUED,
+	IIO_BLOCK_STATE_QUEUED,
+	IIO_BLOCK_STATE_ACTIVE,
+	IIO_BLOCK_STATE_DONE,
+};
+
+/**
+ * struct iio_dma_buffer_block - IIO buffer block
+ * @head:	entry in the queue lists, free for use by the driver while
+ *		the block is active
+ * @block:	description of the block as seen by userspace
+ * @vaddr:	virtual address of the block memory
+ * @phys_addr:	DMA address of the block memory
+ * @size:	allocated size of the block memory
+ * @dev:	device the memory was allocated for
+ * @queue:	parent queue
+ * @state:	current state of the block
+ * @kref:	held by the queue and by every userspace mapping
+ */
+struct iio_dma_buffer_block {
+	struct list_head head;
+	struct iio_buffer_block block;
+
+	void *vaddr;
+	dma_addr_t phys_addr;
+	size_t size;
+	struct device *dev;
+	struct iio_dma_buffer_queue *queue;
+
+	enum iio_block_state state;
+	struct kref kref;
+};
+
+/**
+ * struct iio_dma_buffer_queue - DMA buffer base structure
+ * @buffer:	IIO buffer base structure
+ * @dev:	device used to allocate and map the block memory
+ * @ops:	driver callbacks
+ * @lock:	protects the block array, the incoming list and block states
+ * @list_lock:	protects the outgoing list, which is filled from the driver's
+ *		DMA completion callbacks
+ * @incoming:	blocks queued while the buffer was disabled
+ * @outgoing:	filled blocks waiting to be dequeued
+ * @blocks:	all allocated blocks, indexed by id
+ * @num_blocks:	number of allocated blocks
+ * @active:	whether the buffer is enabled
+ * @fileio:	the blocks were allocated internally for read() access
+ * @fileio_pos:	read offset into the first outgoing block
+ * @driver_data: driver private data
+ */
+struct iio_dma_buffer_queue {
+	struct iio_buffer buffer;
+	struct device *dev;
+	const struct iio_dma_buffer_ops *ops;
+
+	struct mutex lock;
+	spinlock_t list_lock;
+	struct list_head incoming;
+	struct list_head outgoing;
+
+	struct iio_dma_buffer_block **blocks;
+	unsigned int num_blocks;
+
+	bool active;
+	bool fileio;
+	size_t fileio_pos;
+
+	void *driver_data;
+};
+
+/**
+ * struct iio_dma_buffer_ops - DMA buffer callbacks
+ * @submit:	start filling @block; call iio_dma_buffer_block_done() once it
+ *		is full. Called with the queue lock held.
+ * @abort:	stop all transfers and give back the active blocks with
+ *		iio_dma_buffer_block_list_abort(). Called with the queue lock
+ *		held.
+ */
+struct iio_dma_buffer_ops {
+	int (*submit)(struct iio_dma_buffer_queue *queue,
+		      struct iio_dma_buffer_block *block);
+	void (*abort)(struct iio_dma_buffer_queue *queue);
+};
+
+static inline struct iio_dma_buffer_queue *
+iio_buffer_to_queue(struct iio_buffer *buffer)
+{
+	return container_of(buffer, struct iio_dma_buffer_queue, buffer);
+}
+
+void iio_dma_buffer_block_done(struct iio_dma_buffer_block *block);
+void iio_dma_buffer_block_list_abort(struct iio_dma_buffer_queue *queue,
+				     struct list_head *list);
+
+int iio_dma_buffer_enable(struct iio_buffer *buffer,
+			  struct iio_dev *indio_dev);
+int iio_dma_buffer_disable(struct iio_buffer *buffer,
+			   struct iio_dev *indio_dev);
+
+struct iio_buffer *iio_dma_buffer_alloc(struct device *dev,
+					const struct iio_dma_buffer_ops *ops,
+					void *driver_data);
+void iio_dma_buffer_free(struct iio_buffer *buffer);
+
+#endif
@@ -12,10 +12,12 @@
 #include <linux/sysfs.h>
 #include <linux/iio/iio.h>
 #include <linux/kref.h>
+#include <uapi/linux/iio/buffer.h>
 
 #ifdef CONFIG_IIO_BUFFER
 
 struct iio_buffer;
+struct vm_area_struct;
 
 /**
  * struct iio_buffer_access_funcs - access functions for buffers.
@@ -29,6 +31,12 @@ struct iio_buffer;
  * @set_length:		set number of datums in buffer
  * @release:		called when the last reference to the buffer is dropped,
  *			should free all resources allocated by the buffer.
+ * @alloc_blocks:	allocate blocks for mmap based access
+ * @free_blocks:	free all blocks allocated by @alloc_blocks
+ * @query_block:	describe a block
+ * @enqueue_block:	hand a block to the device to be filled
+ * @dequeue_block:	take back the oldest filled block, -EAGAIN if none
+ * @mmap:		map a block into userspace
  *
  * The purpose of this structure is to make the buffer element
  * modular as event for a given driver, different usecases may require
@@ -51,6 +59,17 @@ struct iio_buffer_access_funcs {
 	int (*set_length)(struct iio_buffer *buffer, int length);
 
 	void (*release)(struct iio_buffer *buffer);
+
+	int (*alloc_blocks)(struct iio_buffer *buffer,
+			    struct iio_buffer_block_alloc_req *req);
+	int (*free_blocks)(struct iio_buffer *buffer);
+	int (*query_block)(struct iio_buffer *buffer,
+			   struct iio_buffer_block *block);
+	int (*enqueue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*dequeue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*mmap)(struct iio_buffer *buffer, struct vm_area_struct *vma);
 };
 
 /**
@@ -15,6 +15,28 @@ struct irq_desc;
 struct irq_domain;
 struct pt_regs;
 
+/**
+ * struct irq_time_stats - handler time accounting of an interrupt
+ * @hard_count:		number of hard interrupt handler invocations
+ * @hard_time:		total time spent in the hard handlers (ns)
+ * @hard_max:		longest single run of the hard handlers (ns)
+ * @thread_count:	number of threaded handler runs
+ * @thread_wake_lat:	total latency from wakeup to thread handler start (ns)
+ * @thread_wake_max:	longest wakeup latency (ns)
+ * @thread_time:	total time spent in the threaded handlers (ns)
+ * @thread_max:		longest single threaded handler run (ns)
+ */
+struct irq_time_stats {
+	u64			hard_count;
+	u64			hard_time;
+	u64			hard_max;
+	u64			thread_count;
+	u64			thread_wake_lat;
+	u64			thread_wake_max;
+	u64			thread_time;
+	u64			thread_max;
+};
+
 /**
  * struct irq_desc - interrupt descriptor
  * @irq_data:		per irq and chip data passed down to chip functions
@@ -44,6 +66,7 @@ struct pt_regs;
  * @force_resume_depth:	number of irqactions on a irq descriptor with
  *			IRQF_FORCE_RESUME set
  * @dir:		/proc/irq/ procfs entry
+ * @time_stats:		handler runtime and thread wakeup latency
  * @name:		flow handler name for /proc/interrupts output
  */
 struct irq_desc {
@@ -83,6 +106,9 @@ struct irq_desc {
 #endif
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
+#endif
+#ifdef CONFIG_IRQ_TIME_STATS
+	struct irq_time_stats	time_stats;
 #endif
 	int			parent_irq;
 	struct module		*owner;
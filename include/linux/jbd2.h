@@ -672,6 +672,23 @@ struct transaction_stats_s {
 	struct transaction_run_stats_s run;
 };
 
+/*
+ * Commit phases timed for the latency histograms.  Without async commit
+ * the commit block is written with FLUSH/FUA, so its cache flush counts
+ * against JBD2_PHASE_COMMIT.
+ */
+enum jbd2_commit_phase {
+	JBD2_PHASE_LOCKED,		/* waiting for handles to stop */
+	JBD2_PHASE_FLUSHING,		/* writing ordered data */
+	JBD2_PHASE_LOGGING,		/* writing metadata to the log */
+	JBD2_PHASE_COMMIT,		/* writing the commit block */
+	JBD2_PHASE_CACHE_FLUSH,		/* explicit cache flushes */
+	JBD2_NR_PHASES
+};
+
+/* bucket n counts phases that took [2^(n-1), 2^n) microseconds */
+#define JBD2_HIST_BUCKETS	20
+
 static inline unsigned long
 jbd2_time_diff(unsigned long start, unsigned long end)
 {
@@ -750,6 +767,7 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_history_lock: Protect the transactions statistics history
  * @j_proc_entry: procfs entry for the jbd statistics directory
  * @j_stats: Overall statistics
+ * @j_commit_hist: Commit phase latency histograms
  * @j_private: An opaque pointer to fs-private information.
  */
 
@@ -978,6 +996,8 @@ struct journal_s
 	spinlock_t		j_history_lock;
 	struct proc_dir_entry	*j_proc_entry;
 	struct transaction_stats_s j_stats;
+	unsigned long		j_commit_hist[JBD2_NR_PHASES]
+					     [JBD2_HIST_BUCKETS];
 
 	/* Failed journal commit ID */
 	unsigned int		j_failed_commit;
@@ -712,6 +712,12 @@ ftrace_vprintk(const char *fmt, va_list ap)
 static inline void ftrace_dump(enum ftrace_dump_mode oops_dump_mode) { }
 #endif /* CONFIG_TRACING */
 
+#ifdef CONFIG_TRACE_FLIGHT_RECORDER
+void trace_flight_trigger(const char *reason);
+#else
+static inline void trace_flight_trigger(const char *reason) { }
+#endif
+
 /*
  * min()/max()/clamp() macros that also do
  * strict type-checking.. See the
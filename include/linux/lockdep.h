@@ -436,14 +436,58 @@ do {								\
 	lock_acquired(&(_lock)->dep_map, _RET_IP_);			\
 } while (0)
 
+#define lock_contention_begin() 0ULL
+#define lock_contention_end(lock, ip, start) do { (void)(start); } while (0)
+
 #else /* CONFIG_LOCK_STAT */
 
 #define lock_contended(lockdep_map, ip) do {} while (0)
 #define lock_acquired(lockdep_map, ip) do {} while (0)
 
+#ifdef CONFIG_LOCK_CONTENTION_SAMPLE
+
+extern unsigned int lock_contention_sample;
+extern u64 __lock_contention_begin(void);
+extern void __lock_contention_end(const void *lock, unsigned long ip,
+				  u64 start);
+
+/*
+ * Returns the start time of a sampled contended acquisition, or 0 if
+ * this one is not sampled.
+ */
+static inline u64 lock_contention_begin(void)
+{
+	if (likely(!lock_contention_sample))
+		return 0;
+	return __lock_contention_begin();
+}
+
+static inline void lock_contention_end(const void *lock, unsigned long ip,
+				       u64 start)
+{
+	if (unlikely(start))
+		__lock_contention_end(lock, ip, start);
+}
+
+#define LOCK_CONTENDED(_lock, try, lock)			\
+do {								\
+	if (!try(_lock)) {					\
+		u64 __lc_start = lock_contention_begin();	\
+		lock(_lock);					\
+		lock_contention_end(_lock, _RET_IP_, __lc_start); \
+	}							\
+} while (0)
+
+#else /* CONFIG_LOCK_CONTENTION_SAMPLE */
+
+#define lock_contention_begin() 0ULL
+#define lock_contention_end(lock, ip, start) do { (void)(start); } while (0)
+
 #define LOCK_CONTENDED(_lock, try, lock) \
 	lock(_lock)
 
+#endif /* CONFIG_LOCK_CONTENTION_SAMPLE */
+
 #endif /* CONFIG_LOCK_STAT */
 
 #ifdef CONFIG_LOCKDEP
@@ -456,6 +500,18 @@ do {								\
 #define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags) \
 	LOCK_CONTENDED((_lock), (try), (lock))
 
+#elif defined(CONFIG_LOCK_CONTENTION_SAMPLE)
+
+/* Like LOCK_CONTENDED(), keeping the irq-enabling spin of lockfl() */
+#define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags)	\
+do {								\
+	if (!try(_lock)) {					\
+		u64 __lc_start = lock_contention_begin();	\
+		lockfl((_lock), (flags));			\
+		lock_contention_end(_lock, _RET_IP_, __lc_start); \
+	}							\
+} while (0)
+
 #else /* CONFIG_LOCKDEP */
 
 #define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags) \
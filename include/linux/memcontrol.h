@@ -29,6 +29,9 @@ struct page;
 struct mm_struct;
 struct kmem_cache;
 
+/* Bits needed to store a memory cgroup ID, e.g. in page cache shadows */
+#define MEM_CGROUP_ID_SHIFT	16
+
 /*
  * The corresponding mem_cgroup_stat_names is defined in mm/memcontrol.c,
  * These two lists should keep in accord with each other.
@@ -57,6 +60,8 @@ enum mem_cgroup_events_index {
 	MEM_CGROUP_EVENTS_PGPGOUT,	/* # of pages paged out */
 	MEM_CGROUP_EVENTS_PGFAULT,	/* # of page-faults */
 	MEM_CGROUP_EVENTS_PGMAJFAULT,	/* # of major page-faults */
+	MEM_CGROUP_EVENTS_REFAULT,	/* # of refaults of evicted pages */
+	MEM_CGROUP_EVENTS_ACTIVATE,	/* # of refaults that were activated */
 	MEM_CGROUP_EVENTS_NSTATS,
 	/* default hierarchy events */
 	MEMCG_LOW = MEM_CGROUP_EVENTS_NSTATS,
@@ -67,6 +72,15 @@ enum mem_cgroup_events_index {
 };
 
 #ifdef CONFIG_MEMCG
+unsigned short mem_cgroup_id(struct mem_cgroup *memcg);
+struct mem_cgroup *mem_cgroup_from_id(unsigned short id);
+
+/*
+ * The caller has to keep page->mem_cgroup stable, e.g. by holding the
+ * page lock on an isolated page or by mem_cgroup_begin_page_stat().
+ */
+#define page_memcg(page)	((page)->mem_cgroup)
+
 void mem_cgroup_events(struct mem_cgroup *memcg,
 		       enum mem_cgroup_events_index idx,
 		       unsigned int nr);
@@ -195,6 +209,21 @@ void mem_cgroup_split_huge_fixup(struct page *head);
 #else /* CONFIG_MEMCG */
 struct mem_cgroup;
 
+static inline unsigned short mem_cgroup_id(struct mem_cgroup *memcg)
+{
+	return 0;
+}
+
+static inline struct mem_cgroup *page_memcg(struct page *page)
+{
+	return NULL;
+}
+
+static inline struct mem_cgroup *mem_cgroup_from_id(unsigned short id)
+{
+	return NULL;
+}
+
 static inline void mem_cgroup_events(struct mem_cgroup *memcg,
 				     enum mem_cgroup_events_index idx,
 				     unsigned int nr)
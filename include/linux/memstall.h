@@ -0,0 +1,61 @@
+#ifndef __LINUX_MEMSTALL_H
+#define __LINUX_MEMSTALL_H
+
+#include <linux/types.h>
+#include <linux/sched.h>
+
+/*
+ * Memory stall accounting: how often and for how long tasks were held up
+ * by memory shortage, system-wide in /proc/memstall and per memory cgroup
+ * in memory.stall.
+ */
+enum memstall_item {
+	MEMSTALL_RECLAIM,	/* direct and memcg limit reclaim */
+	MEMSTALL_COMPACT,	/* direct compaction */
+	MEMSTALL_THRASH,	/* refaults of recently evicted pages */
+	NR_MEMSTALL_ITEMS,
+};
+
+struct mem_cgroup;
+
+#ifdef CONFIG_MEMSTALL
+extern const char * const memstall_names[NR_MEMSTALL_ITEMS];
+
+extern void memstall_account(struct mem_cgroup *memcg,
+			     enum memstall_item item, u64 delta);
+
+/*
+ * Bracket a stall with memstall_begin()/memstall_end(). @memcg is the
+ * cgroup the task stalls on behalf of, NULL for the task's own.
+ */
+static inline u64 memstall_begin(void)
+{
+	return local_clock();
+}
+
+static inline void memstall_end(struct mem_cgroup *memcg,
+				enum memstall_item item, u64 start)
+{
+	memstall_account(memcg, item, local_clock() - start);
+}
+#else
+static inline void memstall_account(struct mem_cgroup *memcg,
+				    enum memstall_item item, u64 delta) {}
+static inline u64 memstall_begin(void)
+{
+	return 0;
+}
+static inline void memstall_end(struct mem_cgroup *memcg,
+				enum memstall_item item, u64 start) {}
+#endif /* CONFIG_MEMSTALL */
+
+#if defined(CONFIG_MEMSTALL) && defined(CONFIG_MEMCG)
+extern void mem_cgroup_account_stall(struct mem_cgroup *memcg,
+				     enum memstall_item item, u64 delta);
+#else
+static inline void mem_cgroup_account_stall(struct mem_cgroup *memcg,
+					    enum memstall_item item,
+					    u64 delta) {}
+#endif
+
+#endif /* __LINUX_MEMSTALL_H */
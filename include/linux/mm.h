@@ -1780,6 +1780,8 @@ extern void zone_pcp_reset(struct zone *zone);
 
 /* page_alloc.c */
 extern int min_free_kbytes;
+extern int watermark_scale_factor;
+extern int watermark_boost_factor;
 
 /* nommu.c */
 extern atomic_long_t mmap_pages_allocated;
@@ -22,6 +22,7 @@
 
 struct address_space;
 struct mem_cgroup;
+struct futex_private_hash;
 
 #define USE_SPLIT_PTE_PTLOCKS	(NR_CPUS >= CONFIG_SPLIT_PTLOCK_CPUS)
 #define USE_SPLIT_PMD_PTLOCKS	(USE_SPLIT_PTE_PTLOCKS && \
@@ -304,6 +305,10 @@ struct vm_area_struct {
 #ifdef CONFIG_NUMA
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
+#ifdef CONFIG_SWAP
+	/* last swap fault address, readahead window and hits */
+	atomic_long_t swap_readahead_info;
+#endif
 };
 
 struct core_thread {
@@ -453,6 +458,10 @@ struct mm_struct {
 	bool tlb_flush_pending;
 #endif
 	struct uprobes_state uprobes_state;
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	/* hash buckets for PROCESS_PRIVATE futexes, set up on first use */
+	struct futex_private_hash *futex_hash;
+#endif
 #ifdef CONFIG_X86_INTEL_MPX
 	/* address of the bounds directory */
 	void __user *bd_addr;
@@ -95,6 +95,22 @@ static inline bool task_will_free_mem(struct task_struct *task)
 		!(task->signal->flags & SIGNAL_GROUP_COREDUMP);
 }
 
+/*
+ * The lowmemorykiller keeps thread group leaders sorted by oom_score_adj.
+ * Insertion and removal are called with tasklist_lock held for writing,
+ * except for the insertion by a task from exec, and lowmem_adj_changed()
+ * after an update of signal->oom_score_adj.
+ */
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_VMPRESSURE
+extern void lowmem_adj_insert(struct task_struct *tsk);
+extern void lowmem_adj_remove(struct task_struct *tsk);
+extern void lowmem_adj_changed(struct task_struct *tsk);
+#else
+static inline void lowmem_adj_insert(struct task_struct *tsk) {}
+static inline void lowmem_adj_remove(struct task_struct *tsk) {}
+static inline void lowmem_adj_changed(struct task_struct *tsk) {}
+#endif
+
 /* sysctls */
 extern int sysctl_oom_dump_tasks;
 extern int sysctl_oom_kill_allocating_task;
@@ -76,4 +76,20 @@ static inline int imx_dma_is_general_purpose(struct dma_chan *chan)
 		!strcmp(chan->device->dev->driver->name, "imx-dma");
 }
 
+#if IS_REACHABLE(CONFIG_IMX_SDMA)
+void imx_sdma_memcpy(void *dst, const void *src, size_t len);
+int imx_sdma_memcpy_fromio(void *dst, phys_addr_t src, size_t len);
+#else
+static inline void imx_sdma_memcpy(void *dst, const void *src, size_t len)
+{
+	memcpy(dst, src, len);
+}
+
+static inline int imx_sdma_memcpy_fromio(void *dst, phys_addr_t src,
+					 size_t len)
+{
+	return -ENODEV;
+}
+#endif
+
 #endif
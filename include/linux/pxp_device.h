@@ -21,12 +21,19 @@
 
 #include <linux/idr.h>
 #include <linux/hash.h>
+#include <linux/kref.h>
 #include <uapi/linux/pxp_device.h>
 
+struct sw_sync_timeline;
+
 struct pxp_irq_info {
 	wait_queue_head_t waitq;
 	atomic_t irq_pending;
 	int hist_status;
+
+	/* advanced by every completed task, for PXP_IOC_START_FENCED */
+	struct sw_sync_timeline *timeline;
+	u32 submitted;
 };
 
 struct pxp_buffer_hash {
@@ -45,11 +52,24 @@ struct pxp_buf_obj {
 	void *virtual;
 
 	struct hlist_node item;
+
+	/* held by the handle and by every dma-buf exported from it */
+	struct kref refcount;
+
+	/* imported dma-buf, virtual is NULL for those */
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
 };
 
 struct pxp_chan_obj {
 	uint32_t handle;
 	struct dma_chan *chan;
+
+	/* orders PXP_IOC_START_FENCED, created on first use */
+	struct workqueue_struct *start_wq;
+	/* keeps tasks from being configured past a pending fenced start */
+	struct mutex start_lock;
 };
 
 /* File private data */
@@ -499,8 +499,10 @@ static inline int get_dumpable(struct mm_struct *mm)
 
 #define MMF_HAS_UPROBES		19	/* has uprobes */
 #define MMF_RECALC_UPROBES	20	/* MMF_HAS_UPROBES can be wrong */
+#define MMF_VM_MERGE_ANY	21	/* KSM may merge any compatible vma */
 
-#define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK)
+#define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK |\
+				 (1 << MMF_VM_MERGE_ANY))
 
 struct sighand_struct {
 	atomic_t		count;
@@ -1141,6 +1143,12 @@ struct sched_avg {
 };
 
 #ifdef CONFIG_SCHEDSTATS
+/*
+ * Latency histograms: bucket 0 counts delays below 1us, bucket n the
+ * ones in [2^(n-1), 2^n) us and the last bucket everything above.
+ */
+#define SCHED_LAT_HIST_BUCKETS	16
+
 struct sched_statistics {
 	u64			wait_start;
 	u64			wait_max;
@@ -1173,6 +1181,33 @@ struct sched_statistics {
 	u64			nr_wakeups_affine_attempts;
 	u64			nr_wakeups_passive;
 	u64			nr_wakeups_idle;
+
+	/* wakeup to first run, all scheduling classes */
+	u64			wakeup_lat_start;
+	u64			wakeup_lat_max;
+	u64			wakeup_lat_sum;
+	u64			wakeup_lat_count;
+	u32			wakeup_lat_hist[SCHED_LAT_HIST_BUCKETS];
+
+	/* involuntary preemption to running again */
+	u64			preempt_start;
+	u64			preempt_max;
+	u64			preempt_sum;
+	u64			preempt_count;
+	u32			preempt_hist[SCHED_LAT_HIST_BUCKETS];
+	pid_t			preempt_by_pid;
+	pid_t			preempt_max_pid;
+	char			preempt_by_comm[TASK_COMM_LEN];
+	char			preempt_max_comm[TASK_COMM_LEN];
+
+	/* hardirq and softirq time taken from the task while it ran */
+	u64			irq_start;
+	u64			irq_sum;
+	u64			irq_max;
+
+	/* SCHED_DEADLINE runtime overruns and lagging replenishments */
+	u64			nr_dl_overruns;
+	u64			nr_dl_lagged;
 };
 #endif
 
@@ -1263,8 +1298,14 @@ struct sched_dl_entity {
 	 *
 	 * @dl_yielded tells if task gave up the cpu before consuming
 	 * all its available runtime during the last job.
+	 *
+	 * @dl_overrun tells if the task asked to be informed about runtime
+	 * overruns (SCHED_FLAG_DL_OVERRUN) and one is pending delivery.
 	 */
-	int dl_throttled, dl_new, dl_boosted, dl_yielded;
+	int dl_throttled, dl_new, dl_boosted, dl_yielded, dl_overrun;
+
+	/* Delivers SIGXCPU on return to user space after an overrun */
+	struct callback_head dl_overrun_work;
 
 	/*
 	 * Bandwidth enforcement timer. Each -deadline task has its
@@ -1350,6 +1391,10 @@ struct task_struct {
 #endif
 
 	struct list_head tasks;
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_VMPRESSURE
+	struct rb_node lowmem_node;	/* group leaders, by lowmem_adj */
+	short lowmem_adj;
+#endif
 #ifdef CONFIG_SMP
 	struct plist_node pushable_tasks;
 	struct rb_node pushable_dl_tasks;
@@ -150,6 +150,7 @@ static inline void *spi_get_drvdata(struct spi_device *spi)
 }
 
 struct spi_message;
+struct spi_flash_read_message;
 struct spi_transfer;
 
 /**
@@ -260,6 +261,7 @@ static inline void spi_unregister_driver(struct spi_driver *sdrv)
  * @xfer_completion: used by core transfer_one_message()
  * @busy: message pump is busy
  * @running: message pump is running
+ * @flash_reading: spi_flash_read() owns the hardware, the pump holds off
  * @rt: whether this queue is set to run as a realtime task
  * @auto_runtime_pm: the core should ensure a runtime PM reference is held
  *                   while the hardware is prepared, using the parent
@@ -300,6 +302,10 @@ static inline void spi_unregister_driver(struct spi_driver *sdrv)
  * @dma_rx: DMA receive channel
  * @dummy_rx: dummy receive buffer for full-duplex devices
  * @dummy_tx: dummy transmit buffer for full-duplex devices
+ * @spi_flash_read: to support spi-controller hardwares that provide
+ *	accelerated interface to read from flash devices.
+ * @flash_read_supported: spi device supports flash read; optional, all
+ *	devices are assumed to be supported when this is not set.
  *
  * Each SPI master controller can communicate with one or more @spi_device
  * children.  These make a small bus, sharing MOSI, MISO and SCK signals
@@ -423,6 +429,7 @@ struct spi_master {
 	bool				idling;
 	bool				busy;
 	bool				running;
+	bool				flash_reading;
 	bool				rt;
 	bool				auto_runtime_pm;
 	bool                            cur_msg_prepared;
@@ -459,6 +466,11 @@ struct spi_master {
 	/* dummy data for full duplex devices */
 	void			*dummy_rx;
 	void			*dummy_tx;
+
+	/* accelerated read path for SPI flash, bypassing the message queue */
+	int (*spi_flash_read)(struct spi_device *spi,
+			      struct spi_flash_read_message *msg);
+	bool (*flash_read_supported)(struct spi_device *spi);
 };
 
 static inline void *spi_master_get_devdata(struct spi_master *master)
@@ -772,6 +784,48 @@ extern int spi_sync_locked(struct spi_device *spi, struct spi_message *message);
 extern int spi_bus_lock(struct spi_master *master);
 extern int spi_bus_unlock(struct spi_master *master);
 
+/**
+ * struct spi_flash_read_message - flash specific information for
+ * spi-masters that provide accelerated flash read interfaces
+ * @buf: buffer to read data
+ * @from: offset within the flash from where data is to be read
+ * @len: length of data to be read
+ * @retlen: actual length of data read
+ * @read_opcode: read_opcode to be used to communicate with flash
+ * @addr_width: number of address bytes
+ * @dummy_bytes: number of dummy bytes
+ * @opcode_nbits: number of lines to send opcode
+ * @addr_nbits: number of lines to send address
+ * @data_nbits: number of lines for data
+ * @rx_sg: scatterlist for receive data read from flash
+ * @cur_msg_mapped: message has been mapped for DMA
+ */
+struct spi_flash_read_message {
+	void *buf;
+	loff_t from;
+	size_t len;
+	size_t retlen;
+	u8 read_opcode;
+	u8 addr_width;
+	u8 dummy_bytes;
+	u8 opcode_nbits;
+	u8 addr_nbits;
+	u8 data_nbits;
+	struct sg_table rx_sg;
+	bool cur_msg_mapped;
+};
+
+/* SPI core interface for flash read support */
+static inline bool spi_flash_read_supported(struct spi_device *spi)
+{
+	return spi->master->spi_flash_read &&
+	       (!spi->master->flash_read_supported ||
+		spi->master->flash_read_supported(spi));
+}
+
+extern int spi_flash_read(struct spi_device *spi,
+			  struct spi_flash_read_message *msg);
+
 /**
  * spi_write - SPI synchronous write
  * @spi: device to which data will be written
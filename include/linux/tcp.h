@@ -170,6 +170,7 @@ struct tcp_sock {
 
 	struct list_head tsq_node; /* anchor in tsq_tasklet.head list */
 	unsigned long	tsq_flags;
+	struct hrtimer	pacing_timer;	/* for internal pacing */
 
 	/* Data for direct copy to user */
 	struct {
@@ -104,6 +104,9 @@ struct work_struct {
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
+#ifdef CONFIG_WQ_WORK_STATS
+	u64 queued_at;		/* local_clock() when last queued */
+#endif
 };
 
 #define WORK_DATA_INIT()	ATOMIC_LONG_INIT(WORK_STRUCT_NO_POOL)
@@ -332,6 +335,11 @@ enum {
  * system_highpri_wq is similar to system_wq but for work items which
  * require WQ_HIGHPRI.
  *
+ * system_lowlat_wq is an unbound WQ_HIGHPRI workqueue for short work
+ * items on a latency critical path, e.g. a driver's timeout recovery.
+ * Its workers are not concurrency managed, so the items never wait
+ * behind slow work the way they can on system_wq.
+ *
  * system_long_wq is similar to system_wq but may host long running
  * works.  Queue flushing might take relatively long.
  *
@@ -351,6 +359,7 @@ enum {
  */
 extern struct workqueue_struct *system_wq;
 extern struct workqueue_struct *system_highpri_wq;
+extern struct workqueue_struct *system_lowlat_wq;
 extern struct workqueue_struct *system_long_wq;
 extern struct workqueue_struct *system_unbound_wq;
 extern struct workqueue_struct *system_freezable_wq;
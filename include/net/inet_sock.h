@@ -119,6 +119,7 @@ struct inet_cork {
 	struct ip_options	*opt;
 	unsigned int		fragsize;
 	int			length; /* Total length of all frames */
+	u16			gso_size;
 	struct dst_entry	*dst;
 	u8			tx_flags;
 	__u8			ttl;
@@ -143,7 +143,7 @@ struct sk_buff *ip_make_skb(struct sock *sk, struct flowi4 *fl4,
 					int len, int odd, struct sk_buff *skb),
 			    void *from, int length, int transhdrlen,
 			    struct ipcm_cookie *ipc, struct rtable **rtp,
-			    unsigned int flags);
+			    struct inet_cork *cork, unsigned int flags);
 
 static inline struct sk_buff *ip_finish_skb(struct sock *sk, struct flowi4 *fl4)
 {
@@ -245,6 +245,20 @@ extern int sysctl_ip_early_demux;
 /* From ip_output.c */
 extern int sysctl_ip_dynaddr;
 
+/* From ip_flow_cache.c */
+#ifdef CONFIG_IP_FLOW_CACHE
+extern int sysctl_ip_flow_cache;
+
+bool ip_flow_cache_xmit(struct sk_buff *skb);
+void ip_flow_cache_learn(struct sk_buff *skb);
+#else
+static inline bool ip_flow_cache_xmit(struct sk_buff *skb)
+{
+	return false;
+}
+static inline void ip_flow_cache_learn(struct sk_buff *skb) {}
+#endif
+
 void ipfrag_init(void);
 
 void ip_static_sysctl_init(void);
@@ -115,6 +115,25 @@
  * In that callback the driver is therefore expected to release its own
  * buffered frames and afterwards also frames from the ieee80211_txq (obtained
  * via the usual ieee80211_tx_dequeue).
+ *
+ * To share the medium fairly between fast and slow stations, the driver
+ * should pick the queue to serve next with ieee80211_next_txq() and hand
+ * it back with ieee80211_return_txq().  mac80211 then runs a deficit round
+ * robin over the stations, charged with the airtime of their frames: the
+ * tx_time the driver reports in the TX status if it measures it, otherwise
+ * an estimate from the rates and retries used.  Each queue also keeps its
+ * standing delay down with CoDel, dropping frames that sat in it for too
+ * long.  The per-station airtime and queue delay are shown in debugfs.
+ *
+ * A driver using the scheduler serves an AC in a loop: get a queue with
+ * ieee80211_next_txq(), pull frames from it with ieee80211_tx_dequeue()
+ * for as long as the hardware has room, then always hand it back with
+ * ieee80211_return_txq(), whether or not it is empty.  A queue that is not
+ * handed back only gets on the schedule again when new frames arrive.
+ * The loop may run from .wake_tx_queue and from TX completion, but must
+ * not run for the same AC on two CPUs at once, since a queue can be on the
+ * schedule again while the driver still holds it.  Frames dequeued outside
+ * the loop are charged to the station all the same.
  */
 
 struct device;
@@ -852,7 +871,8 @@ struct ieee80211_tx_info {
 			struct ieee80211_vif *vif;
 			struct ieee80211_key_conf *hw_key;
 			u32 flags;
-			/* 4 bytes free */
+			/* intermediate TX queue entry, 1024 ns units */
+			u32 enqueue_time;
 		} control;
 		struct {
 			struct ieee80211_tx_rate rates[IEEE80211_TX_MAX_RATES];
@@ -5392,4 +5412,31 @@ void ieee80211_unreserve_tid(struct ieee80211_sta *sta, u8 tid);
  */
 struct sk_buff *ieee80211_tx_dequeue(struct ieee80211_hw *hw,
 				     struct ieee80211_txq *txq);
+
+/**
+ * ieee80211_next_txq - get the next software tx queue to serve
+ *
+ * @hw: pointer as obtained from ieee80211_alloc_hw()
+ * @ac: access category to pick a queue of
+ *
+ * Returns the next queue of @ac with frames pending, in an order that gives
+ * every station a fair share of airtime, or %NULL if there is none.  The
+ * queue is taken off the schedule until it is given back with
+ * ieee80211_return_txq(), which the driver must do for every queue this
+ * returns, after dequeuing from it with ieee80211_tx_dequeue().  Calls for
+ * the same @ac must be serialized by the driver.
+ */
+struct ieee80211_txq *ieee80211_next_txq(struct ieee80211_hw *hw, u8 ac);
+
+/**
+ * ieee80211_return_txq - give back a queue from ieee80211_next_txq()
+ *
+ * @hw: pointer as obtained from ieee80211_alloc_hw()
+ * @txq: the queue
+ *
+ * Puts @txq back on the schedule if it still has frames pending.  Must be
+ * called once for every queue returned by ieee80211_next_txq(), before the
+ * next ieee80211_next_txq() call for the same AC that should consider it.
+ */
+void ieee80211_return_txq(struct ieee80211_hw *hw, struct ieee80211_txq *txq);
 #endif /* MAC80211_H */
@@ -114,7 +114,10 @@ struct nf_conn {
 	/* Extensions */
 	struct nf_ct_ext *ext;
 
-	/* Storage reserved for other modules, must be the last member */
+	/* Storage reserved for other modules, must be the last member.
+	 * Entries of protocols without per-connection state are allocated
+	 * without it, see nf_ct_compact().
+	 */
 	union nf_conntrack_proto proto;
 };
 
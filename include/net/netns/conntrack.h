@@ -86,6 +86,7 @@ struct netns_ct {
 	struct ctl_table_header	*helper_sysctl_header;
 #endif
 	char			*slabname;
+	char			*compact_slabname;
 	unsigned int		sysctl_log_invalid; /* Log invalid packets */
 	int			sysctl_events;
 	int			sysctl_acct;
@@ -97,6 +98,7 @@ struct netns_ct {
 	unsigned int		htable_size;
 	seqcount_t		generation;
 	struct kmem_cache	*nf_conntrack_cachep;
+	struct kmem_cache	*nf_conntrack_compact_cachep;
 	struct hlist_nulls_head	*hash;
 	struct hlist_head	*expect_hash;
 	struct ct_pcpu __percpu *pcpu_lists;
@@ -0,0 +1,66 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM esdhc_imx
+
+#if !defined(_TRACE_ESDHC_IMX_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ESDHC_IMX_H
+
+#include <linux/mmc/host.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(esdhc_set_clock,
+
+	TP_PROTO(struct mmc_host *mmc, unsigned int clock),
+
+	TP_ARGS(mmc, clock),
+
+	TP_STRUCT__entry(
+		__string(	name,		mmc_hostname(mmc)	)
+		__field(	unsigned int,	clock			)
+		__field(	unsigned int,	actual			)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, mmc_hostname(mmc));
+		__entry->clock = clock;
+		__entry->actual = mmc->actual_clock;
+	),
+
+	TP_printk("%s clock=%u actual=%u", __get_str(name), __entry->clock,
+		  __entry->actual)
+);
+
+TRACE_EVENT(esdhc_tuning,
+
+	TP_PROTO(struct mmc_host *mmc, u32 opcode, int delay, bool cached,
+		 u64 ns, int ret),
+
+	TP_ARGS(mmc, opcode, delay, cached, ns, ret),
+
+	TP_STRUCT__entry(
+		__string(	name,		mmc_hostname(mmc)	)
+		__field(	u32,		opcode			)
+		__field(	int,		delay			)
+		__field(	bool,		cached			)
+		__field(	u64,		ns			)
+		__field(	int,		ret			)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, mmc_hostname(mmc));
+		__entry->opcode = opcode;
+		__entry->delay = delay;
+		__entry->cached = cached;
+		__entry->ns = ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("%s cmd%u delay=0x%x%s took %llu ns ret=%d",
+		  __get_str(name), __entry->opcode, __entry->delay,
+		  __entry->cached ? " cached" : "",
+		  (unsigned long long)__entry->ns, __entry->ret)
+);
+
+#endif /* _TRACE_ESDHC_IMX_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,89 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fec
+
+#if !defined(_TRACE_FEC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FEC_H
+
+#include <linux/netdevice.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(fec_napi_poll,
+
+	TP_PROTO(struct net_device *ndev, int pkts, int budget),
+
+	TP_ARGS(ndev, pkts, budget),
+
+	TP_STRUCT__entry(
+		__string(	name,		ndev->name	)
+		__field(	int,		pkts		)
+		__field(	int,		budget		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, ndev->name);
+		__entry->pkts = pkts;
+		__entry->budget = budget;
+	),
+
+	TP_printk("%s rx=%d budget=%d", __get_str(name), __entry->pkts,
+		  __entry->budget)
+);
+
+TRACE_EVENT(fec_rx_queue,
+
+	TP_PROTO(struct net_device *ndev, u16 queue, int pkts, int budget),
+
+	TP_ARGS(ndev, queue, pkts, budget),
+
+	TP_STRUCT__entry(
+		__string(	name,		ndev->name	)
+		__field(	u16,		queue		)
+		__field(	int,		pkts		)
+		__field(	int,		budget		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, ndev->name);
+		__entry->queue = queue;
+		__entry->pkts = pkts;
+		__entry->budget = budget;
+	),
+
+	TP_printk("%s q%u pkts=%d budget=%d", __get_str(name),
+		  __entry->queue, __entry->pkts, __entry->budget)
+);
+
+TRACE_EVENT(fec_tx_queue,
+
+	TP_PROTO(struct net_device *ndev, u16 queue, unsigned int pkts,
+		 unsigned int bytes, int used, int size),
+
+	TP_ARGS(ndev, queue, pkts, bytes, used, size),
+
+	TP_STRUCT__entry(
+		__string(	name,		ndev->name	)
+		__field(	u16,		queue		)
+		__field(	unsigned int,	pkts		)
+		__field(	unsigned int,	bytes		)
+		__field(	int,		used		)
+		__field(	int,		size		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, ndev->name);
+		__entry->queue = queue;
+		__entry->pkts = pkts;
+		__entry->bytes = bytes;
+		__entry->used = used;
+		__entry->size = size;
+	),
+
+	TP_printk("%s q%u completed=%u bytes=%u ring=%d/%d", __get_str(name),
+		  __entry->queue, __entry->pkts, __entry->bytes,
+		  __entry->used, __entry->size)
+);
+
+#endif /* _TRACE_FEC_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
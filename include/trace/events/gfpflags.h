@@ -37,6 +37,7 @@
 	{(unsigned long)__GFP_MOVABLE,		"GFP_MOVABLE"},		\
 	{(unsigned long)__GFP_NOTRACK,		"GFP_NOTRACK"},		\
 	{(unsigned long)__GFP_NO_KSWAPD,	"GFP_NO_KSWAPD"},	\
-	{(unsigned long)__GFP_OTHER_NODE,	"GFP_OTHER_NODE"}	\
+	{(unsigned long)__GFP_OTHER_NODE,	"GFP_OTHER_NODE"},	\
+	{(unsigned long)__GFP_CMA,		"GFP_CMA"}		\
 	) : "GFP_NOWAIT"
 
@@ -0,0 +1,60 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM gpmi_nand
+
+#if !defined(_TRACE_GPMI_NAND_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_GPMI_NAND_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(gpmi_read_page,
+
+	TP_PROTO(int page, u64 ns, unsigned int corrected,
+		 unsigned int max_bitflips, unsigned int failed),
+
+	TP_ARGS(page, ns, corrected, max_bitflips, failed),
+
+	TP_STRUCT__entry(
+		__field(	int,		page		)
+		__field(	u64,		ns		)
+		__field(	unsigned int,	corrected	)
+		__field(	unsigned int,	max_bitflips	)
+		__field(	unsigned int,	failed		)
+	),
+
+	TP_fast_assign(
+		__entry->page = page;
+		__entry->ns = ns;
+		__entry->corrected = corrected;
+		__entry->max_bitflips = max_bitflips;
+		__entry->failed = failed;
+	),
+
+	TP_printk("page=%d took %llu ns corrected=%u max_bitflips=%u failed=%u",
+		  __entry->page, (unsigned long long)__entry->ns,
+		  __entry->corrected, __entry->max_bitflips, __entry->failed)
+);
+
+TRACE_EVENT(gpmi_write_page,
+
+	TP_PROTO(u64 ns, int ret),
+
+	TP_ARGS(ns, ret),
+
+	TP_STRUCT__entry(
+		__field(	u64,		ns		)
+		__field(	int,		ret		)
+	),
+
+	TP_fast_assign(
+		__entry->ns = ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("took %llu ns ret=%d", (unsigned long long)__entry->ns,
+		  __entry->ret)
+);
+
+#endif /* _TRACE_GPMI_NAND_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
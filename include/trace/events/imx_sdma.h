@@ -0,0 +1,80 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM imx_sdma
+
+#if !defined(_TRACE_IMX_SDMA_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_IMX_SDMA_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(sdma_start_desc,
+
+	TP_PROTO(int channel, unsigned int num_bd, unsigned int bytes,
+		 bool cyclic),
+
+	TP_ARGS(channel, num_bd, bytes, cyclic),
+
+	TP_STRUCT__entry(
+		__field(	int,		channel		)
+		__field(	unsigned int,	num_bd		)
+		__field(	unsigned int,	bytes		)
+		__field(	bool,		cyclic		)
+	),
+
+	TP_fast_assign(
+		__entry->channel = channel;
+		__entry->num_bd = num_bd;
+		__entry->bytes = bytes;
+		__entry->cyclic = cyclic;
+	),
+
+	TP_printk("ch%d bds=%u bytes=%u%s", __entry->channel,
+		  __entry->num_bd, __entry->bytes,
+		  __entry->cyclic ? " cyclic" : "")
+);
+
+TRACE_EVENT(sdma_channel_irq,
+
+	TP_PROTO(int channel, unsigned int bytes, int status),
+
+	TP_ARGS(channel, bytes, status),
+
+	TP_STRUCT__entry(
+		__field(	int,		channel		)
+		__field(	unsigned int,	bytes		)
+		__field(	int,		status		)
+	),
+
+	TP_fast_assign(
+		__entry->channel = channel;
+		__entry->bytes = bytes;
+		__entry->status = status;
+	),
+
+	TP_printk("ch%d bytes=%u status=%d", __entry->channel,
+		  __entry->bytes, __entry->status)
+);
+
+TRACE_EVENT(sdma_run_channel0,
+
+	TP_PROTO(u64 ns, int ret),
+
+	TP_ARGS(ns, ret),
+
+	TP_STRUCT__entry(
+		__field(	u64,		ns		)
+		__field(	int,		ret		)
+	),
+
+	TP_fast_assign(
+		__entry->ns = ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("took %llu ns ret=%d", (unsigned long long)__entry->ns,
+		  __entry->ret)
+);
+
+#endif /* _TRACE_IMX_SDMA_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
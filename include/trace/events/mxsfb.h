@@ -0,0 +1,67 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM mxsfb
+
+#if !defined(_TRACE_MXSFB_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_MXSFB_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(mxsfb_irq,
+
+	TP_PROTO(int node, u32 status),
+
+	TP_ARGS(node, status),
+
+	TP_STRUCT__entry(
+		__field(	int,		node		)
+		__field(	u32,		status		)
+	),
+
+	TP_fast_assign(
+		__entry->node = node;
+		__entry->status = status;
+	),
+
+	TP_printk("fb%d status=0x%x", __entry->node, __entry->status)
+);
+
+DECLARE_EVENT_CLASS(mxsfb_pan,
+
+	TP_PROTO(int node, u32 yoffset, int ret),
+
+	TP_ARGS(node, yoffset, ret),
+
+	TP_STRUCT__entry(
+		__field(	int,		node		)
+		__field(	u32,		yoffset		)
+		__field(	int,		ret		)
+	),
+
+	TP_fast_assign(
+		__entry->node = node;
+		__entry->yoffset = yoffset;
+		__entry->ret = ret;
+	),
+
+	TP_printk("fb%d yoffset=%u ret=%d", __entry->node, __entry->yoffset,
+		  __entry->ret)
+);
+
+DEFINE_EVENT(mxsfb_pan, mxsfb_pan_start,
+
+	TP_PROTO(int node, u32 yoffset, int ret),
+
+	TP_ARGS(node, yoffset, ret)
+);
+
+DEFINE_EVENT(mxsfb_pan, mxsfb_pan_done,
+
+	TP_PROTO(int node, u32 yoffset, int ret),
+
+	TP_ARGS(node, yoffset, ret)
+);
+
+#endif /* _TRACE_MXSFB_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2016 Freescale Semiconductor, Inc. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __MXSFB_DRM_H__
+#define __MXSFB_DRM_H__
+
+#include <drm/drm.h>
+
+/*
+ * GEM buffers:
+ *
+ * Dumb buffers are writecombined, which makes CPU reads very slow. Buffers
+ * created with MXSFB_BO_CACHED are cacheable instead; CPU access to them
+ * must be bracketed by CPU_PREP and CPU_FINI so that the caches are
+ * invalidated before reading and written back before the buffer is
+ * scanned out. Map them with DRM_IOCTL_MODE_MAP_DUMB.
+ */
+#define MXSFB_BO_CACHED		0x00000001
+
+#define MXSFB_BO_FLAGS		(MXSFB_BO_CACHED)
+
+struct drm_mxsfb_gem_new {
+	uint64_t size;			/* in */
+	uint32_t flags;			/* in, mask of MXSFB_BO_x */
+	uint32_t handle;		/* out */
+};
+
+/* reports MXSFB_BO_CACHED only if cacheable memory could be allocated */
+struct drm_mxsfb_gem_info {
+	uint32_t handle;		/* in */
+	uint32_t flags;			/* out, mask of MXSFB_BO_x */
+};
+
+#define MXSFB_PREP_READ		0x01
+#define MXSFB_PREP_WRITE	0x02
+
+#define MXSFB_PREP_FLAGS	(MXSFB_PREP_READ | MXSFB_PREP_WRITE)
+
+struct drm_mxsfb_gem_cpu_prep {
+	uint32_t handle;		/* in */
+	uint32_t op;			/* in, mask of MXSFB_PREP_x */
+};
+
+struct drm_mxsfb_gem_cpu_fini {
+	uint32_t handle;		/* in */
+	uint32_t op;			/* in, op passed to CPU_PREP */
+};
+
+#define DRM_MXSFB_GEM_NEW		0x00
+#define DRM_MXSFB_GEM_INFO		0x01
+#define DRM_MXSFB_GEM_CPU_PREP		0x02
+#define DRM_MXSFB_GEM_CPU_FINI		0x03
+#define DRM_MXSFB_NUM_IOCTLS		0x04
+
+#define DRM_IOCTL_MXSFB_GEM_NEW		DRM_IOWR(DRM_COMMAND_BASE + DRM_MXSFB_GEM_NEW, struct drm_mxsfb_gem_new)
+#define DRM_IOCTL_MXSFB_GEM_INFO	DRM_IOWR(DRM_COMMAND_BASE + DRM_MXSFB_GEM_INFO, struct drm_mxsfb_gem_info)
+#define DRM_IOCTL_MXSFB_GEM_CPU_PREP	DRM_IOW (DRM_COMMAND_BASE + DRM_MXSFB_GEM_CPU_PREP, struct drm_mxsfb_gem_cpu_prep)
+#define DRM_IOCTL_MXSFB_GEM_CPU_FINI	DRM_IOW (DRM_COMMAND_BASE + DRM_MXSFB_GEM_CPU_FINI, struct drm_mxsfb_gem_cpu_fini)
+
+#endif /* __MXSFB_DRM_H__ */
@@ -121,6 +121,7 @@ enum bpf_prog_type {
 	BPF_PROG_TYPE_KPROBE,
 	BPF_PROG_TYPE_SCHED_CLS,
 	BPF_PROG_TYPE_SCHED_ACT,
+	BPF_PROG_TYPE_RX_EARLY,
 };
 
 #define BPF_PSEUDO_MAP_FD	1
@@ -210,6 +211,16 @@ enum bpf_func_id {
 	 * Return: 0 on success
 	 */
 	BPF_FUNC_l4_csum_replace,
+
+	/**
+	 * rx_load_bytes(ctx, offset, to, len) - copy bytes of a received frame
+	 * @ctx: pointer to struct __rx_frame
+	 * @offset: offset from the start of the Ethernet header
+	 * @to: pointer to the program stack
+	 * @len: number of bytes to copy
+	 * Return: 0 on success
+	 */
+	BPF_FUNC_rx_load_bytes,
 	__BPF_FUNC_MAX_ID,
 };
 
@@ -228,4 +239,19 @@ struct __sk_buff {
 	__u32 priority;
 };
 
+/* user accessible context of BPF_PROG_TYPE_RX_EARLY programs, which run
+ * on the raw receive buffer before an sk_buff is built for it
+ */
+struct __rx_frame {
+	__u32 len;
+	__u32 ifindex;
+};
+
+/* verdicts of BPF_PROG_TYPE_RX_EARLY programs, others are treated as pass */
+enum bpf_rx_action {
+	BPF_RX_PASS = 0,
+	BPF_RX_DROP,
+	BPF_RX_REDIRECT,
+};
+
 #endif /* _UAPI__LINUX_BPF_H__ */
@@ -58,6 +58,7 @@ enum {
 	CAN_RAW_RECV_OWN_MSGS,	/* receive my own msgs (default:off) */
 	CAN_RAW_FD_FRAMES,	/* allow CAN FD frames (default:off) */
 	CAN_RAW_JOIN_FILTERS,	/* all filters must match to trigger */
+	CAN_RAW_RECV_BATCH,	/* many frames per recvmsg (default:off) */
 };
 
 #endif /* !_UAPI_CAN_RAW_H */
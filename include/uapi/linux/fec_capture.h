@@ -0,0 +1,68 @@
+/*
+ * Zero-copy receive capture interface for the Freescale FEC
+ *
+ * The capture device exposes the RX DMA buffers of the controller's
+ * first receive ring to userspace. After FEC_CAPTURE_START the ring is
+ * detached from the network stack: the controller writes frames straight
+ * into the mmap()ed area and the driver only publishes their metadata.
+ *
+ * Layout of the mapping (see struct fec_capture_info):
+ *
+ *   meta_offset: nr_slots * struct fec_capture_meta
+ *   data_offset: nr_slots * slot_size bytes of frame data
+ *
+ * Slot n holds the frame described by meta[n]. A slot is handed to
+ * userspace by setting meta[n].status to FEC_CAPTURE_USER and is given
+ * back by writing FEC_CAPTURE_KERNEL to it. Slots are filled and must be
+ * returned in ring order; poll() reports POLLIN while the newest filled
+ * slot is still with userspace, and also re-arms slots returned since.
+ *
+ * A controller restart (link change, TX timeout) gives every slot back
+ * to the controller and restarts the ring at slot 0; the next poll()
+ * reports POLLERR once so userspace can resynchronise.
+ */
+#ifndef _UAPI_LINUX_FEC_CAPTURE_H
+#define _UAPI_LINUX_FEC_CAPTURE_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define FEC_CAPTURE_KERNEL	0
+#define FEC_CAPTURE_USER	1
+
+/* fec_capture_meta.flags */
+#define FEC_CAPTURE_F_ERROR	(1 << 0)	/* CRC, length or overrun error */
+#define FEC_CAPTURE_F_HWTSTAMP	(1 << 1)	/* ts_ns is a PTP clock stamp */
+#define FEC_CAPTURE_F_VLAN	(1 << 2)	/* frame carries a VLAN tag */
+
+struct fec_capture_meta {
+	__u32 status;
+	__u16 len;		/* frame length without FCS */
+	__u16 flags;
+	__u64 ts_ns;
+};
+
+struct fec_capture_info {
+	__u32 nr_slots;
+	__u32 slot_size;
+	__u32 meta_offset;
+	__u32 data_offset;
+	__u32 mmap_size;
+};
+
+struct fec_capture_stats {
+	__u64 frames;
+	__u64 errors;
+	__u64 ring_full;	/* refills with every slot held */
+};
+
+#define FEC_CAPTURE_IOC_MAGIC	0xfe
+
+#define FEC_CAPTURE_GET_INFO	_IOR(FEC_CAPTURE_IOC_MAGIC, 0, \
+				     struct fec_capture_info)
+#define FEC_CAPTURE_START	_IO(FEC_CAPTURE_IOC_MAGIC, 1)
+#define FEC_CAPTURE_STOP	_IO(FEC_CAPTURE_IOC_MAGIC, 2)
+#define FEC_CAPTURE_GET_STATS	_IOR(FEC_CAPTURE_IOC_MAGIC, 3, \
+				     struct fec_capture_stats)
+
+#endif /* _UAPI_LINUX_FEC_CAPTURE_H */
@@ -0,0 +1,62 @@
+/* The industrial I/O - block based buffer access from userspace
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+#ifndef _UAPI_IIO_BUFFER_H_
+#define _UAPI_IIO_BUFFER_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/**
+ * struct iio_buffer_block_alloc_req - request to allocate buffer blocks
+ * @type:	reserved, must be 0
+ * @size:	size of each block in bytes
+ * @count:	number of blocks to allocate, updated with the number
+ *		actually allocated
+ * @id:		set to the id of the first allocated block
+ */
+struct iio_buffer_block_alloc_req {
+	__u32	type;
+	__u32	size;
+	__u32	count;
+	__u32	id;
+};
+
+/* The timestamp field holds when the block was filled */
+#define IIO_BUFFER_BLOCK_FLAG_TIMESTAMP_VALID	(1 << 0)
+
+/**
+ * struct iio_buffer_block - description of a buffer block
+ * @id:		block id, from 0 to the number of allocated blocks - 1
+ * @size:	size of the block in bytes
+ * @bytes_used:	number of bytes holding samples, set on dequeue
+ * @type:	reserved, must be 0
+ * @flags:	IIO_BUFFER_BLOCK_FLAG_* flags
+ * @data.offset: offset to pass to mmap() to map this block
+ * @timestamp:	time the block was filled, if flagged as valid
+ *
+ * Blocks are handed to the device with IIO_BLOCK_ENQUEUE_IOCTL and handed
+ * back, filled, in the same order with IIO_BLOCK_DEQUEUE_IOCTL.
+ */
+struct iio_buffer_block {
+	__u32	id;
+	__u32	size;
+	__u32	bytes_used;
+	__u32	type;
+	__u32	flags;
+	union {
+		__u32 offset;
+	} data;
+	__u64	timestamp;
+};
+
+#define IIO_BLOCK_ALLOC_IOCTL	_IOWR('i', 0xa0, struct iio_buffer_block_alloc_req)
+#define IIO_BLOCK_FREE_IOCTL	_IO('i', 0xa1)
+#define IIO_BLOCK_QUERY_IOCTL	_IOWR('i', 0xa2, struct iio_buffer_block)
+#define IIO_BLOCK_ENQUEUE_IOCTL	_IOWR('i', 0xa3, struct iio_buffer_block)
+#define IIO_BLOCK_DEQUEUE_IOCTL	_IOWR('i', 0xa4, struct iio_buffer_block)
+
+#endif /* _UAPI_IIO_BUFFER_H_ */
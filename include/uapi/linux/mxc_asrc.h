@@ -18,6 +18,8 @@
 #ifndef __MXC_ASRC_UAPI_H__
 #define __MXC_ASRC_UAPI_H__
 
+#include <linux/types.h>
+
 #define ASRC_IOC_MAGIC		'C'
 
 #define ASRC_REQ_PAIR		_IOWR(ASRC_IOC_MAGIC, 0, struct asrc_req)
@@ -28,6 +30,8 @@
 #define ASRC_STOP_CONV		_IOW(ASRC_IOC_MAGIC, 5, enum asrc_pair_index)
 #define ASRC_STATUS		_IOW(ASRC_IOC_MAGIC, 6, struct asrc_status_flags)
 #define ASRC_FLUSH		_IOW(ASRC_IOC_MAGIC, 7, enum asrc_pair_index)
+#define ASRC_QUEUE_DMABUF	_IOWR(ASRC_IOC_MAGIC, 8, struct asrc_dmabuf_job)
+#define ASRC_DEQUEUE_DMABUF	_IOWR(ASRC_IOC_MAGIC, 9, struct asrc_dmabuf_job)
 
 enum asrc_pair_index {
 	ASRC_INVALID_PAIR = -1,
@@ -111,6 +115,26 @@ struct asrc_convert_buffer {
 	unsigned int output_buffer_length;
 };
 
+/*
+ * Zero-copy conversion job: input and output live in DMA-BUFs shared with
+ * the application, so no data goes through the driver's bounce buffers.
+ * Jobs queued with ASRC_QUEUE_DMABUF are converted back to back; each one
+ * is handed back by ASRC_DEQUEUE_DMABUF in queueing order with the final
+ * output length and status filled in. user_data is returned untouched.
+ * The layout is the same for 32-bit and 64-bit user space.
+ */
+struct asrc_dmabuf_job {
+	__s32 input_fd;
+	__s32 output_fd;
+	__u32 input_offset;
+	__u32 input_length;
+	__u32 output_offset;
+	__u32 output_length;
+	__u64 user_data;
+	__s32 status;
+	__u32 reserved;
+};
+
 struct asrc_status_flags {
 	enum asrc_pair_index index;
 	unsigned int overload_error;
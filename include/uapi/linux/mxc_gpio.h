@@ -0,0 +1,69 @@
+/*
+ * i.MX GPIO bank userspace interface
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Every GPIO bank is a /dev/mxc_gpioN character device, N being the bank
+ * number.  Lines have to be claimed with MXC_GPIO_IOC_REQUEST before they
+ * can be read or driven, and are given back when the file is closed.  All
+ * masks have one bit per line of the bank.
+ *
+ * Edges on claimed input lines selected with MXC_GPIO_IOC_WATCH are queued
+ * as struct mxc_gpio_event and read() from the device, as many at a time
+ * as fit into the buffer; poll() reports POLLIN while events are pending.
+ */
+#ifndef _UAPI_LINUX_MXC_GPIO_H
+#define _UAPI_LINUX_MXC_GPIO_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+struct mxc_gpio_request {
+	__u32 lines;		/* lines to claim */
+	__u32 outputs;		/* the claimed lines to drive */
+	__u32 values;		/* initial levels of the outputs */
+};
+
+struct mxc_gpio_values {
+	__u32 mask;		/* claimed lines to read or drive */
+	__u32 values;
+};
+
+/* drive the outputs in mask through count levels, delay_ns apart */
+struct mxc_gpio_sequence {
+	__u32 mask;
+	__u32 count;
+	__u32 delay_ns;
+	__u32 reserved;
+	__u64 values;		/* user pointer to count __u32 levels */
+};
+
+#define MXC_GPIO_SEQUENCE_MAX_DELAY	1000000
+
+#define MXC_GPIO_EDGE_RISING	1
+#define MXC_GPIO_EDGE_FALLING	2
+#define MXC_GPIO_EDGE_BOTH	3
+
+struct mxc_gpio_watch {
+	__u32 lines;		/* claimed input lines to report edges of */
+	__u32 edges;		/* MXC_GPIO_EDGE_* */
+};
+
+struct mxc_gpio_event {
+	__u64 timestamp;	/* CLOCK_MONOTONIC, in ns */
+	__u32 line;
+	__u32 level;		/* level the line changed to */
+	__u32 dropped;		/* events lost since the previous one */
+	__u32 reserved;
+};
+
+#define MXC_GPIO_IOC_REQUEST	_IOW('G', 0x80, struct mxc_gpio_request)
+#define MXC_GPIO_IOC_GET	_IOWR('G', 0x81, struct mxc_gpio_values)
+#define MXC_GPIO_IOC_SET	_IOW('G', 0x82, struct mxc_gpio_values)
+#define MXC_GPIO_IOC_SEQUENCE	_IOW('G', 0x83, struct mxc_gpio_sequence)
+#define MXC_GPIO_IOC_WATCH	_IOW('G', 0x84, struct mxc_gpio_watch)
+
+#endif
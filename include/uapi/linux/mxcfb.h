@@ -166,6 +166,17 @@ struct mxcfb_csc_matrix {
 	int param[5][3];
 };
 
+/*
+ * Pan to yoffset once acquire_fence (-1 for none) has signalled, without
+ * blocking the caller.  release_fence is a new fence fd that signals when
+ * the flip has been latched, i.e. the buffer shown before it is free.
+ */
+struct mxcfb_flip {
+	__u32 yoffset;
+	__s32 acquire_fence;
+	__s32 release_fence;
+};
+
 #define MXCFB_WAIT_FOR_VSYNC	_IOW('F', 0x20, u_int32_t)
 #define MXCFB_SET_GBL_ALPHA     _IOW('F', 0x21, struct mxcfb_gbl_alpha)
 #define MXCFB_SET_CLR_KEY       _IOW('F', 0x22, struct mxcfb_color_key)
@@ -182,6 +193,9 @@ struct mxcfb_csc_matrix {
 #define MXCFB_SET_GPU_SPLIT_FMT	_IOW('F', 0x2F, struct mxcfb_gpu_split_fmt)
 #define MXCFB_SET_PREFETCH	_IOW('F', 0x30, int)
 #define MXCFB_GET_PREFETCH	_IOR('F', 0x31, int)
+/* refresh a region of a command mode (MPU interface) LCDIF panel */
+#define MXCFB_SET_UPDATE_RECT	_IOW('F', 0x37, struct mxcfb_rect)
+#define MXCFB_FLIP_FENCED	_IOWR('F', 0x38, struct mxcfb_flip)
 
 /* IOCTLs for E-ink panel updates */
 #define MXCFB_SET_WAVEFORM_MODES	_IOW('F', 0x2B, struct mxcfb_waveform_modes)
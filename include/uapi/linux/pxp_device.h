@@ -39,6 +39,35 @@ struct pxp_mem_flush {
 	unsigned int type;
 };
 
+/*
+ * PXP_IOC_IMPORT_DMABUF: fd in; handle, size and phys_addr out.
+ * PXP_IOC_EXPORT_DMABUF: handle and flags (O_CLOEXEC) in; fd out.
+ * Imported buffers are released with PXP_IOC_PUT_PHYMEM like the
+ * allocated ones, and phys_addr is what goes into pxp_layer_param.
+ * Their cache maintenance is up to the exporter, PXP_IOC_FLUSH_PHYMEM
+ * refuses them.
+ */
+struct pxp_dmabuf_desc {
+	int fd;
+	unsigned int handle;
+	unsigned int size;
+	unsigned int flags;
+	dma_addr_t phys_addr;
+};
+
+/*
+ * PXP_IOC_START_FENCED: handle and in_fence (a sync fence fd, -1 for
+ * none) in; out_fence out.  Like PXP_IOC_START_CHAN, but the tasks
+ * configured so far only start once in_fence has signalled, without
+ * blocking the caller, and out_fence signals once they have completed,
+ * in place of PXP_IOC_WAIT4CMPLT.  Starts on one channel keep their order.
+ */
+struct pxp_fence_desc {
+	unsigned int handle;
+	int in_fence;
+	int out_fence;
+};
+
 #define PXP_IOC_MAGIC  'P'
 
 #define PXP_IOC_GET_CHAN      _IOR(PXP_IOC_MAGIC, 0, struct pxp_mem_desc)
@@ -49,6 +78,9 @@ struct pxp_mem_flush {
 #define PXP_IOC_PUT_PHYMEM    _IOW(PXP_IOC_MAGIC, 5, struct pxp_mem_desc)
 #define PXP_IOC_WAIT4CMPLT    _IOWR(PXP_IOC_MAGIC, 6, struct pxp_mem_desc)
 #define PXP_IOC_FLUSH_PHYMEM   _IOR(PXP_IOC_MAGIC, 7, struct pxp_mem_flush)
+#define PXP_IOC_IMPORT_DMABUF  _IOWR(PXP_IOC_MAGIC, 8, struct pxp_dmabuf_desc)
+#define PXP_IOC_EXPORT_DMABUF  _IOWR(PXP_IOC_MAGIC, 9, struct pxp_dmabuf_desc)
+#define PXP_IOC_START_FENCED   _IOWR(PXP_IOC_MAGIC, 10, struct pxp_fence_desc)
 
 /* Memory types supported*/
 #define MEMORY_TYPE_UNCACHED 0x0
@@ -276,6 +276,10 @@ enum
 	LINUX_MIB_TCPACKSKIPPEDFINWAIT2,	/* TCPACKSkippedFinWait2 */
 	LINUX_MIB_TCPACKSKIPPEDTIMEWAIT,	/* TCPACKSkippedTimeWait */
 	LINUX_MIB_TCPACKSKIPPEDCHALLENGE,	/* TCPACKSkippedChallenge */
+	LINUX_MIB_IPFLOWCACHEADD,		/* IPFlowCacheAdd */
+	LINUX_MIB_IPFLOWCACHEHIT,		/* IPFlowCacheHit */
+	LINUX_MIB_TCPSENDPAGE,			/* TCPSendPage */
+	LINUX_MIB_TCPSENDPAGECOPY,		/* TCPSendPageCopy */
 	__LINUX_MIB_MAX
 };
 
@@ -283,6 +283,15 @@ struct usb_functionfs_event {
 #define	FUNCTIONFS_ENDPOINT_DESC	_IOR('g', 130, \
 					     struct usb_endpoint_descriptor)
 
+/*
+ * Endpoint files can also be mmap()ed (MAP_SHARED).  The first mapping,
+ * at offset 0, allocates the endpoint's buffer pool (at most 8 MiB); a
+ * read() or write(), synchronous or AIO, whose single buffer lies inside
+ * a mapping of the pool is then transferred straight to/from those pages
+ * if the UDC supports scatter-gather.  Reads need a length the UDC does
+ * not have to round up; anything else falls back to copying.
+ */
+
 
 
 #endif /* _UAPI__LINUX_FUNCTIONFS_H__ */
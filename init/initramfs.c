@@ -8,6 +8,7 @@
 #warning "Sparse checking disabled for this file"
 #endif
 
+#include <linux/async.h>
 #include <linux/init.h>
 #include <linux/fs.h>
 #include <linux/slab.h>
@@ -605,7 +606,43 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+/*
+ * Unpacking runs from the async pool so that it overlaps with the driver
+ * initcalls; whoever needs the files first waits for it.
+ */
+static bool initramfs_async __initdata = true;
+static int __init initramfs_async_setup(char *str)
+{
+	strtobool(str, &initramfs_async);
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+static ASYNC_DOMAIN_EXCLUSIVE(initramfs_domain);
+static async_cookie_t initramfs_cookie;
+static bool initramfs_done;
+
+/**
+ * wait_for_initramfs - wait until rootfs has been populated
+ *
+ * Must be called before looking up anything the initramfs may provide,
+ * e.g. by the usermode helpers and the firmware loader.
+ */
+void wait_for_initramfs(void)
+{
+	if (smp_load_acquire(&initramfs_done))
+		return;
+	if (!initramfs_cookie) {
+		/* only legitimate before rootfs_initcall */
+		pr_warn_once("wait_for_initramfs() called before rootfs_initcalls\n");
+		return;
+	}
+	async_synchronize_cookie_domain(initramfs_cookie + 1,
+					&initramfs_domain);
+}
+EXPORT_SYMBOL_GPL(wait_for_initramfs);
+
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
 	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
 	if (err)
@@ -647,12 +684,28 @@ static int __init populate_rootfs(void)
 			printk(KERN_EMERG "Initramfs unpacking failed: %s\n", err);
 		free_initrd();
 #endif
-		/*
-		 * Try loading default modules from initramfs.  This gives
-		 * us a chance to load before device_initcalls.
-		 */
-		load_default_modules();
 	}
+	smp_store_release(&initramfs_done, true);
+}
+
+static int __init populate_rootfs(void)
+{
+	bool has_initrd = initrd_start;
+
+	initramfs_cookie = async_schedule_domain(do_populate_rootfs, NULL,
+						 &initramfs_domain);
+	if (initramfs_async)
+		return 0;
+
+	wait_for_initramfs();
+	/*
+	 * Try loading default modules from initramfs.  This gives us a
+	 * chance to load before device_initcalls.  request_module() cannot
+	 * be used from the async pool, so when unpacking asynchronously
+	 * this only happens from kernel_init_freeable().
+	 */
+	if (has_initrd)
+		load_default_modules();
 	return 0;
 }
 rootfs_initcall(populate_rootfs);
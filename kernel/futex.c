@@ -258,6 +258,59 @@ static unsigned long __read_mostly futex_hashsize;
 
 static struct futex_hash_bucket *futex_queues;
 
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+#define FUTEX_PRIVATE_HASH_SIZE	32
+
+/*
+ * Private hash of an mm.  mm->futex_hash is set exactly once, either
+ * to a table or, if that could not be allocated, to FUTEX_HASH_GLOBAL;
+ * a private key must never move between tables while waiters exist.
+ */
+struct futex_private_hash {
+	struct futex_hash_bucket queues[FUTEX_PRIVATE_HASH_SIZE];
+};
+
+#define FUTEX_HASH_GLOBAL	((struct futex_private_hash *)1UL)
+
+static void futex_private_hash_alloc(struct mm_struct *mm)
+{
+	struct futex_private_hash *fph;
+	int i;
+
+	fph = kmalloc(sizeof(*fph), GFP_KERNEL | __GFP_NOWARN);
+	if (fph) {
+		for (i = 0; i < FUTEX_PRIVATE_HASH_SIZE; i++) {
+			atomic_set(&fph->queues[i].waiters, 0);
+			plist_head_init(&fph->queues[i].chain);
+			spin_lock_init(&fph->queues[i].lock);
+		}
+	} else {
+		fph = FUTEX_HASH_GLOBAL;
+	}
+
+	if (cmpxchg(&mm->futex_hash, NULL, fph) && fph != FUTEX_HASH_GLOBAL)
+		kfree(fph);
+}
+
+void futex_private_hash_free(struct mm_struct *mm)
+{
+	if (mm->futex_hash != FUTEX_HASH_GLOBAL)
+		kfree(mm->futex_hash);
+	mm->futex_hash = NULL;
+}
+
+static inline struct futex_private_hash *
+futex_private_hash(union futex_key *key)
+{
+	struct futex_private_hash *fph;
+
+	if (key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED))
+		return NULL;
+	fph = ACCESS_ONCE(key->private.mm->futex_hash);
+	return fph == FUTEX_HASH_GLOBAL ? NULL : fph;
+}
+#endif /* CONFIG_FUTEX_PRIVATE_HASH */
+
 static inline void futex_get_mm(union futex_key *key)
 {
 	atomic_inc(&key->private.mm->mm_count);
@@ -311,6 +364,12 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	struct futex_private_hash *fph = futex_private_hash(key);
+
+	if (fph)
+		return &fph->queues[hash & (FUTEX_PRIVATE_HASH_SIZE - 1)];
+#endif
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
@@ -421,6 +480,10 @@ get_futex_key(u32 __user *uaddr, int fshared, union futex_key *key, int rw)
 	 *        but access_ok() should be faster than find_vma()
 	 */
 	if (!fshared) {
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+		if (unlikely(!mm->futex_hash))
+			futex_private_hash_alloc(mm);
+#endif
 		key->private.mm = mm;
 		key->private.address = address;
 		get_futex_key_refs(key);  /* implies MB (B) */
@@ -599,6 +662,16 @@ static int cmpxchg_futex_value_locked(u32 *curval, u32 __user *uaddr,
 	return ret;
 }
 
+/*
+ * The PI fast paths below touch the futex word before get_futex_key()
+ * has validated it, so do its alignment and range checks here.
+ */
+static inline bool futex_uaddr_ok(u32 __user *uaddr)
+{
+	return !((unsigned long)uaddr % sizeof(u32)) &&
+	       access_ok(VERIFY_WRITE, uaddr, sizeof(u32));
+}
+
 static int get_futex_value_locked(u32 *dest, u32 __user *from)
 {
 	int ret;
@@ -2264,8 +2337,19 @@ static int futex_lock_pi(u32 __user *uaddr, unsigned int flags,
 	struct hrtimer_sleeper timeout, *to = NULL;
 	struct futex_hash_bucket *hb;
 	struct futex_q q = futex_q_init;
+	u32 curval, vpid = task_pid_vnr(current);
 	int res, ret;
 
+	/*
+	 * The owner may have released the lock since user space saw it
+	 * taken.  Then there is no kernel state and no waiter, so take it
+	 * the way user space would, without the key lookup or hb->lock.
+	 * On a fault just fall through to the slow path to handle it.
+	 */
+	if (futex_uaddr_ok(uaddr) &&
+	    !cmpxchg_futex_value_locked(&curval, uaddr, 0, vpid) && !curval)
+		return 0;
+
 	if (refill_pi_state_cache())
 		return -ENOMEM;
 
@@ -2398,6 +2482,19 @@ retry:
 	if ((uval & FUTEX_TID_MASK) != vpid)
 		return -EPERM;
 
+	/*
+	 * Without FUTEX_WAITERS nobody is queued in the kernel: a waiter
+	 * sets it under hb->lock before it queues itself, and if it does
+	 * so now the cmpxchg fails and we take the slow path.
+	 */
+	if (uval == vpid && futex_uaddr_ok(uaddr)) {
+		if (cmpxchg_futex_value_locked(&curval, uaddr, uval, 0))
+			goto pi_fault_in;
+		if (curval == uval)
+			return 0;
+		goto retry;
+	}
+
 	ret = get_futex_key(uaddr, flags & FLAGS_SHARED, &key, VERIFY_WRITE);
 	if (ret)
 		return ret;
@@ -2446,6 +2543,7 @@ pi_faulted:
 	spin_unlock(&hb->lock);
 	put_futex_key(&key);
 
+pi_fault_in:
 	ret = fault_in_user_writeable(uaddr);
 	if (!ret)
 		goto retry;
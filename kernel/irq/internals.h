@@ -199,6 +199,76 @@ static inline void kstat_incr_irqs_this_cpu(unsigned int irq, struct irq_desc *d
 	__this_cpu_inc(kstat.irqs_sum);
 }
 
+#ifdef CONFIG_IRQ_TIME_STATS
+/*
+ * The counters are updated without locking.  The flow handlers keep a
+ * descriptor from running its hard handlers on two CPUs at once, so only
+ * per-cpu interrupts and multiple threads of a shared line can lose an
+ * update, which is acceptable for statistics.
+ */
+static inline u64 irq_stats_clock(void)
+{
+	return local_clock();
+}
+
+static inline void
+irq_stats_account_hard(struct irq_desc *desc, u64 start)
+{
+	struct irq_time_stats *st = &desc->time_stats;
+	u64 delta = local_clock() - start;
+
+	st->hard_count++;
+	st->hard_time += delta;
+	if (delta > st->hard_max)
+		st->hard_max = delta;
+}
+
+static inline void irq_stats_stamp_wake(struct irqaction *action)
+{
+	WRITE_ONCE(action->wake_stamp, local_clock());
+}
+
+/*
+ * Taken before the handler runs: the interrupt can fire again and
+ * restamp the action meanwhile, that wakeup belongs to the next run.
+ */
+static inline u64 irq_stats_wake_stamp(struct irqaction *action)
+{
+	return READ_ONCE(action->wake_stamp);
+}
+
+static inline void irq_stats_account_thread(struct irq_desc *desc,
+					    u64 woken, u64 start)
+{
+	struct irq_time_stats *st = &desc->time_stats;
+	/* local_clock() of the waking CPU may be a little ahead */
+	u64 lat = start > woken ? start - woken : 0;
+	u64 delta = local_clock() - start;
+
+	st->thread_count++;
+	st->thread_wake_lat += lat;
+	if (lat > st->thread_wake_max)
+		st->thread_wake_max = lat;
+	st->thread_time += delta;
+	if (delta > st->thread_max)
+		st->thread_max = delta;
+}
+
+static inline void irq_stats_reset(struct irq_desc *desc)
+{
+	memset(&desc->time_stats, 0, sizeof(desc->time_stats));
+}
+#else
+static inline u64 irq_stats_clock(void) { return 0; }
+static inline void
+irq_stats_account_hard(struct irq_desc *desc, u64 start) { }
+static inline void irq_stats_stamp_wake(struct irqaction *action) { }
+static inline u64 irq_stats_wake_stamp(struct irqaction *action) { return 0; }
+static inline void irq_stats_account_thread(struct irq_desc *desc,
+					    u64 woken, u64 start) { }
+static inline void irq_stats_reset(struct irq_desc *desc) { }
+#endif
+
 #ifdef CONFIG_PM_SLEEP
 bool irq_pm_check_wakeup(struct irq_desc *desc);
 void irq_pm_install_action(struct irq_desc *desc, struct irqaction *action);
@@ -901,12 +901,16 @@ static int irq_thread(void *data)
 
 	while (!irq_wait_for_interrupt(action)) {
 		irqreturn_t action_ret;
+		u64 woken, start;
 
 		irq_thread_check_affinity(desc, action);
 
+		woken = irq_stats_wake_stamp(action);
+		start = irq_stats_clock();
 		action_ret = handler_fn(desc, action);
 		if (action_ret == IRQ_HANDLED)
 			atomic_inc(&desc->threads_handled);
+		irq_stats_account_thread(desc, woken, start);
 
 		wake_threads_waitq(desc);
 	}
@@ -281,6 +281,64 @@ static const struct file_operations irq_spurious_proc_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_IRQ_TIME_STATS
+static u64 irq_stats_avg(u64 sum, u64 count)
+{
+	return count ? div64_u64(sum, count) : 0;
+}
+
+static int irq_stats_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	struct irq_time_stats st = desc->time_stats;
+
+	seq_printf(m, "hardirq_count %llu\n"
+		   "hardirq_time %llu ns\n"
+		   "hardirq_avg %llu ns\n"
+		   "hardirq_max %llu ns\n",
+		   st.hard_count, st.hard_time,
+		   irq_stats_avg(st.hard_time, st.hard_count), st.hard_max);
+	seq_printf(m, "thread_count %llu\n"
+		   "thread_time %llu ns\n"
+		   "thread_avg %llu ns\n"
+		   "thread_max %llu ns\n"
+		   "thread_wake_avg %llu ns\n"
+		   "thread_wake_max %llu ns\n",
+		   st.thread_count, st.thread_time,
+		   irq_stats_avg(st.thread_time, st.thread_count),
+		   st.thread_max,
+		   irq_stats_avg(st.thread_wake_lat, st.thread_count),
+		   st.thread_wake_max);
+	return 0;
+}
+
+static int irq_stats_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_stats_proc_show, PDE_DATA(inode));
+}
+
+static ssize_t irq_stats_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	struct irq_desc *desc = irq_to_desc((long)PDE_DATA(file_inode(file)));
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	irq_stats_reset(desc);
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return count;
+}
+
+static const struct file_operations irq_stats_proc_fops = {
+	.open		= irq_stats_proc_open,
+	.read		= seq_read,
+	.write		= irq_stats_proc_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -368,6 +426,12 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 	proc_create_data("spurious", 0444, desc->dir,
 			 &irq_spurious_proc_fops, (void *)(long)irq);
 
+#ifdef CONFIG_IRQ_TIME_STATS
+	/* create /proc/irq/<irq>/stats */
+	proc_create_data("stats", 0644, desc->dir,
+			 &irq_stats_proc_fops, (void *)(long)irq);
+#endif
+
 out_unlock:
 	mutex_unlock(&register_lock);
 }
@@ -385,6 +449,9 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("node", desc->dir);
 #endif
 	remove_proc_entry("spurious", desc->dir);
+#ifdef CONFIG_IRQ_TIME_STATS
+	remove_proc_entry("stats", desc->dir);
+#endif
 
 	memset(name, 0, MAX_NAMELEN);
 	sprintf(name, "%u", irq);
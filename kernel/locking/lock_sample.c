@@ -0,0 +1,161 @@
+/*
+ * kernel/locking/lock_sample.c
+ *
+ * Sampling lock contention profiler.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * One in lock_contention_sample contended acquisitions is timed from
+ * the failed fast path to the acquisition and accounted against its
+ * call site and lock in a fixed size table, so nothing is allocated
+ * on the lock paths.  The table is protected by a bare arch spinlock:
+ * every other lock type would recurse into the profiler.
+ */
+#include <linux/export.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/lockdep.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <asm/uaccess.h>
+
+#define LOCK_SAMPLE_BITS	8
+#define LOCK_SAMPLE_SIZE	(1 << LOCK_SAMPLE_BITS)
+
+struct lock_sample {
+	unsigned long		ip;
+	const void		*lock;
+	unsigned long		count;
+	u64			wait_total;
+	u64			wait_max;
+};
+
+unsigned int lock_contention_sample __read_mostly;
+EXPORT_SYMBOL(lock_contention_sample);
+
+static struct lock_sample lock_samples[LOCK_SAMPLE_SIZE];
+static unsigned long lock_samples_dropped;
+static arch_spinlock_t lock_samples_lock = __ARCH_SPIN_LOCK_UNLOCKED;
+static DEFINE_PER_CPU(unsigned int, lock_sample_seq);
+
+u64 __lock_contention_begin(void)
+{
+	unsigned int rate = ACCESS_ONCE(lock_contention_sample);
+
+	if (!rate || this_cpu_inc_return(lock_sample_seq) % rate)
+		return 0;
+	return local_clock();
+}
+EXPORT_SYMBOL(__lock_contention_begin);
+
+void __lock_contention_end(const void *lock, unsigned long ip, u64 start)
+{
+	u64 wait = local_clock() - start;
+	struct lock_sample *ls;
+	unsigned long flags;
+	unsigned int i, n;
+
+	i = hash_long(ip ^ (unsigned long)lock, LOCK_SAMPLE_BITS);
+
+	local_irq_save(flags);
+	arch_spin_lock(&lock_samples_lock);
+	for (n = 0; n < LOCK_SAMPLE_SIZE; n++) {
+		ls = &lock_samples[(i + n) & (LOCK_SAMPLE_SIZE - 1)];
+		if (!ls->ip) {
+			ls->ip = ip;
+			ls->lock = lock;
+		}
+		if (ls->ip == ip && ls->lock == lock) {
+			ls->count++;
+			ls->wait_total += wait;
+			if (wait > ls->wait_max)
+				ls->wait_max = wait;
+			break;
+		}
+	}
+	if (n == LOCK_SAMPLE_SIZE)
+		lock_samples_dropped++;
+	arch_spin_unlock(&lock_samples_lock);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(__lock_contention_end);
+
+static int lock_contention_show(struct seq_file *m, void *v)
+{
+	struct lock_sample ls;
+	unsigned long flags;
+	int i;
+
+	seq_printf(m, "# sample rate 1/%u, %lu dropped\n",
+		   lock_contention_sample, lock_samples_dropped);
+	seq_puts(m, "# call site, lock, samples, wait-total us, "
+		 "wait-avg us, wait-max us\n");
+
+	for (i = 0; i < LOCK_SAMPLE_SIZE; i++) {
+		local_irq_save(flags);
+		arch_spin_lock(&lock_samples_lock);
+		ls = lock_samples[i];
+		arch_spin_unlock(&lock_samples_lock);
+		local_irq_restore(flags);
+
+		if (!ls.count)
+			continue;
+		seq_printf(m, "%pS, %pS, %lu, %llu, %llu, %llu\n",
+			   (void *)ls.ip, ls.lock, ls.count,
+			   div_u64(ls.wait_total, NSEC_PER_USEC),
+			   div_u64(div64_u64(ls.wait_total, ls.count),
+				   NSEC_PER_USEC),
+			   div_u64(ls.wait_max, NSEC_PER_USEC));
+	}
+	return 0;
+}
+
+static int lock_contention_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lock_contention_show, NULL);
+}
+
+static ssize_t lock_contention_write(struct file *file,
+				     const char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+	char c;
+
+	if (count) {
+		if (get_user(c, buf))
+			return -EFAULT;
+
+		if (c != '0')
+			return count;
+
+		local_irq_save(flags);
+		arch_spin_lock(&lock_samples_lock);
+		memset(lock_samples, 0, sizeof(lock_samples));
+		lock_samples_dropped = 0;
+		arch_spin_unlock(&lock_samples_lock);
+		local_irq_restore(flags);
+	}
+	return count;
+}
+
+static const struct file_operations proc_lock_contention_operations = {
+	.open		= lock_contention_open,
+	.write		= lock_contention_write,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init lock_contention_proc_init(void)
+{
+	proc_create("lock_contention", S_IRUSR | S_IWUSR, NULL,
+		    &proc_lock_contention_operations);
+	return 0;
+}
+__initcall(lock_contention_proc_init);
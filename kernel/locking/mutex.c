@@ -512,13 +512,16 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 	struct task_struct *task = current;
 	struct mutex_waiter waiter;
 	unsigned long flags;
+	u64 contention_start;
 	int ret;
 
 	preempt_disable();
 	mutex_acquire_nest(&lock->dep_map, subclass, 0, nest_lock, ip);
+	contention_start = lock_contention_begin();
 
 	if (mutex_optimistic_spin(lock, ww_ctx, use_ww_ctx)) {
 		/* got the lock, yay! */
+		lock_contention_end(lock, ip, contention_start);
 		preempt_enable();
 		return 0;
 	}
@@ -589,6 +592,7 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 skip_wait:
 	/* got the lock - cleanup and rejoice! */
 	lock_acquired(&lock->dep_map, ip);
+	lock_contention_end(lock, ip, contention_start);
 	mutex_set_owner(lock);
 
 	if (use_ww_ctx) {
@@ -59,6 +59,7 @@
 #include <linux/jump_label.h>
 #include <linux/pfn.h>
 #include <linux/bsearch.h>
+#include <linux/jhash.h>
 #include <uapi/linux/module.h>
 #include "module-internal.h"
 
@@ -364,6 +365,8 @@ struct find_symbol_arg {
 	struct module *owner;
 	const unsigned long *crc;
 	const struct kernel_symbol *sym;
+	int licence;
+	bool unused;
 };
 
 static bool check_symbol(const struct symsearch *syms,
@@ -397,6 +400,8 @@ static bool check_symbol(const struct symsearch *syms,
 	fsa->owner = owner;
 	fsa->crc = symversion(syms->crcs, symnum);
 	fsa->sym = &syms->start[symnum];
+	fsa->licence = syms->licence;
+	fsa->unused = syms->unused;
 	return true;
 }
 
@@ -424,6 +429,85 @@ static bool find_symbol_in_section(const struct symsearch *syms,
 	return false;
 }
 
+/*
+ * Cache of recent find_symbol() results.  Loading a module resolves
+ * each of its undefined symbols by searching the kernel and then every
+ * loaded module in turn, and a burst of loads at boot resolves the same
+ * popular symbols over and over.  Entries are flushed whenever a module
+ * stops being searchable; symcache_gen keeps a lookup that raced with
+ * such a flush from inserting a stale entry afterwards.
+ */
+#define SYMCACHE_BITS	8
+#define SYMCACHE_SIZE	(1 << SYMCACHE_BITS)
+
+struct symcache_entry {
+	const struct kernel_symbol *sym;
+	struct module *owner;
+	const unsigned long *crc;
+	int licence;
+	bool unused;
+};
+
+static struct symcache_entry symcache[SYMCACHE_SIZE];
+static unsigned long symcache_gen;
+static DEFINE_SPINLOCK(symcache_lock);
+
+static inline unsigned int symcache_hash(const char *name)
+{
+	return jhash(name, strlen(name), 0) & (SYMCACHE_SIZE - 1);
+}
+
+static bool symcache_lookup(struct find_symbol_arg *fsa, unsigned long *gen)
+{
+	struct symcache_entry e;
+	struct symsearch syms;
+
+	spin_lock(&symcache_lock);
+	e = symcache[symcache_hash(fsa->name)];
+	*gen = symcache_gen;
+	spin_unlock(&symcache_lock);
+
+	if (!e.sym || strcmp(e.sym->name, fsa->name))
+		return false;
+
+	/* Redo the licence and unused checks of the slow path. */
+	syms.start = e.sym;
+	syms.stop = e.sym + 1;
+	syms.crcs = NULL;
+	syms.licence = e.licence;
+	syms.unused = e.unused;
+	if (!check_symbol(&syms, e.owner, 0, fsa))
+		return false;
+	fsa->crc = e.crc;
+	return true;
+}
+
+static void symcache_insert(const struct find_symbol_arg *fsa,
+			    unsigned long gen)
+{
+	struct symcache_entry *e;
+
+	spin_lock(&symcache_lock);
+	if (gen == symcache_gen) {
+		e = &symcache[symcache_hash(fsa->name)];
+		e->sym = fsa->sym;
+		e->owner = fsa->owner;
+		e->crc = fsa->crc;
+		e->licence = fsa->licence;
+		e->unused = fsa->unused;
+	}
+	spin_unlock(&symcache_lock);
+}
+
+/* Called once a module's symbols may no longer be handed out. */
+static void symcache_flush(void)
+{
+	spin_lock(&symcache_lock);
+	symcache_gen++;
+	memset(symcache, 0, sizeof(symcache));
+	spin_unlock(&symcache_lock);
+}
+
 /* Find a symbol and return it, along with, (optional) crc and
  * (optional) module which owns it.  Needs preempt disabled or module_mutex. */
 const struct kernel_symbol *find_symbol(const char *name,
@@ -433,21 +517,25 @@ const struct kernel_symbol *find_symbol(const char *name,
 					bool warn)
 {
 	struct find_symbol_arg fsa;
+	unsigned long gen;
 
 	fsa.name = name;
 	fsa.gplok = gplok;
 	fsa.warn = warn;
 
-	if (each_symbol_section(find_symbol_in_section, &fsa)) {
-		if (owner)
-			*owner = fsa.owner;
-		if (crc)
-			*crc = fsa.crc;
-		return fsa.sym;
+	if (!symcache_lookup(&fsa, &gen)) {
+		if (!each_symbol_section(find_symbol_in_section, &fsa)) {
+			pr_debug("Failed to find symbol %s\n", name);
+			return NULL;
+		}
+		symcache_insert(&fsa, gen);
 	}
 
-	pr_debug("Failed to find symbol %s\n", name);
-	return NULL;
+	if (owner)
+		*owner = fsa.owner;
+	if (crc)
+		*crc = fsa.crc;
+	return fsa.sym;
 }
 EXPORT_SYMBOL_GPL(find_symbol);
 
@@ -1838,6 +1926,7 @@ static void free_module(struct module *mod)
 	 * that noone uses it while it's being deconstructed. */
 	mutex_lock(&module_mutex);
 	mod->state = MODULE_STATE_UNFORMED;
+	symcache_flush();
 	mutex_unlock(&module_mutex);
 
 	/* Remove dynamic debug info */
@@ -3395,6 +3484,7 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	mutex_lock(&module_mutex);
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
+	symcache_flush();
 	wake_up_all(&module_wq);
 	/* Wait for RCU synchronizing before releasing mod->list. */
 	synchronize_rcu();
@@ -43,6 +43,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/utsname.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
@@ -997,6 +998,27 @@ static inline void boot_delay_msec(int level)
 static bool printk_time = IS_ENABLED(CONFIG_PRINTK_TIME);
 module_param_named(time, printk_time, bool, S_IRUGO | S_IWUSR);
 
+/*
+ * With console_offload set, printk() only stores the message and the
+ * "printk" kthread writes it to the consoles, so a slow serial console
+ * no longer stalls whoever printed.  Emergency messages, oopses, panics
+ * and early boot or shutdown output are still printed synchronously.
+ */
+static bool printk_console_offload;
+module_param_named(console_offload, printk_console_offload, bool,
+		   S_IRUGO | S_IWUSR);
+
+static struct task_struct *printk_kthread;
+static bool printk_kthread_need;
+
+static bool console_offload(void)
+{
+	return printk_console_offload && printk_kthread &&
+	       !oops_in_progress && system_state == SYSTEM_RUNNING;
+}
+
+static void defer_console_output(void);
+
 static size_t print_time(u64 ts, char *buf)
 {
 	unsigned long rem_nsec;
@@ -1756,6 +1778,12 @@ asmlinkage int vprintk_emit(int facility, int level,
 	lockdep_on();
 	local_irq_restore(flags);
 
+	/* Leave the console output to the printk kthread if offloading */
+	if (!in_sched && level != LOGLEVEL_EMERG && console_offload()) {
+		defer_console_output();
+		return printed_len;
+	}
+
 	/* If called from the scheduler, we can not call up(). */
 	if (!in_sched) {
 		lockdep_off();
@@ -2173,13 +2201,18 @@ void console_unlock(void)
 	static u64 seen_seq;
 	unsigned long flags;
 	bool wake_klogd = false;
-	bool retry;
+	bool do_cond_resched, retry;
 
 	if (console_suspended) {
 		up_console_sem();
 		return;
 	}
 
+	/*
+	 * A console_lock() holder may sleep, so let it reschedule between
+	 * records instead of draining a large backlog in one go.
+	 */
+	do_cond_resched = console_may_schedule;
 	console_may_schedule = 0;
 
 	/* flush buffered message fragment immediately to console */
@@ -2241,6 +2274,9 @@ skip:
 		call_console_drivers(level, text, len);
 		start_critical_timings();
 		local_irq_restore(flags);
+
+		if (do_cond_resched)
+			cond_resched();
 	}
 	console_locked = 0;
 
@@ -2608,9 +2644,13 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
-		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (console_offload()) {
+			ACCESS_ONCE(printk_kthread_need) = true;
+			wake_up_process(printk_kthread);
+		} else if (console_trylock()) {
+			/* If trylock fails, someone else is printing */
 			console_unlock();
+		}
 	}
 
 	if (pending & PRINTK_PENDING_WAKEUP)
@@ -2622,6 +2662,43 @@ static DEFINE_PER_CPU(struct irq_work, wake_up_klogd_work) = {
 	.flags = IRQ_WORK_LAZY,
 };
 
+static void defer_console_output(void)
+{
+	preempt_disable();
+	__this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
+	irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
+	preempt_enable();
+}
+
+static int printk_kthread_func(void *unused)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!ACCESS_ONCE(printk_kthread_need))
+			schedule();
+		__set_current_state(TASK_RUNNING);
+		ACCESS_ONCE(printk_kthread_need) = false;
+
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *t;
+
+	t = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(t)) {
+		pr_err("printk: unable to create printing thread\n");
+		return PTR_ERR(t);
+	}
+	printk_kthread = t;
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 void wake_up_klogd(void)
 {
 	preempt_disable();
@@ -36,12 +36,23 @@
 #include <linux/cpu.h>
 #include <linux/prefetch.h>
 #include <linux/ftrace_event.h>
+#include <linux/kthread.h>
+#include <linux/moduleparam.h>
 
 #include "rcu.h"
 
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "rcutiny."
+
+/* Maximum callbacks invoked per pass of __rcu_process_callbacks(). */
+static long blimit = 10;
+module_param(blimit, long, 0644);
+
 /* Forward declarations for tiny_plugin.h. */
 struct rcu_ctrlblk;
-static void __rcu_process_callbacks(struct rcu_ctrlblk *rcp);
+static bool __rcu_process_callbacks(struct rcu_ctrlblk *rcp);
 static void rcu_process_callbacks(struct softirq_action *unused);
 static void __call_rcu(struct rcu_head *head,
 		       void (*func)(struct rcu_head *rcu),
@@ -158,30 +169,40 @@ void rcu_check_callbacks(int user)
 }
 
 /*
- * Invoke the RCU callbacks on the specified rcu_ctrlkblk structure
- * whose grace period has elapsed.
+ * Invoke up to blimit of the RCU callbacks on the specified rcu_ctrlkblk
+ * structure whose grace period has elapsed.  Returns true if ready
+ * callbacks were left behind for a later pass.
  */
-static void __rcu_process_callbacks(struct rcu_ctrlblk *rcp)
+static bool __rcu_process_callbacks(struct rcu_ctrlblk *rcp)
 {
 	const char *rn = NULL;
 	struct rcu_head *next, *list;
+	struct rcu_head **tail;
 	unsigned long flags;
+	bool more;
+	long n = 0;
 	RCU_TRACE(int cb_count = 0);
 
-	/* Move the ready-to-invoke callbacks to a local list. */
+	/* Move at most blimit ready-to-invoke callbacks to a local list. */
 	local_irq_save(flags);
 	if (rcp->donetail == &rcp->rcucblist) {
 		/* No callbacks ready, so just leave. */
 		local_irq_restore(flags);
-		return;
+		return false;
 	}
-	RCU_TRACE(trace_rcu_batch_start(rcp->name, 0, rcp->qlen, -1));
+	RCU_TRACE(trace_rcu_batch_start(rcp->name, 0, rcp->qlen, blimit));
+	tail = &rcp->rcucblist;
+	do {
+		tail = &(*tail)->next;
+	} while (tail != rcp->donetail && ++n < blimit);
 	list = rcp->rcucblist;
-	rcp->rcucblist = *rcp->donetail;
-	*rcp->donetail = NULL;
-	if (rcp->curtail == rcp->donetail)
+	rcp->rcucblist = *tail;
+	*tail = NULL;
+	if (rcp->curtail == tail)
 		rcp->curtail = &rcp->rcucblist;
-	rcp->donetail = &rcp->rcucblist;
+	if (rcp->donetail == tail)
+		rcp->donetail = &rcp->rcucblist;
+	more = rcp->donetail != &rcp->rcucblist;
 	local_irq_restore(flags);
 
 	/* Invoke the callbacks on the local list. */
@@ -198,16 +219,90 @@ static void __rcu_process_callbacks(struct rcu_ctrlblk *rcp)
 	}
 	RCU_TRACE(rcu_trace_sub_qlen(rcp, cb_count));
 	RCU_TRACE(trace_rcu_batch_end(rcp->name,
-				      cb_count, 0, need_resched(),
+				      cb_count, more, need_resched(),
 				      is_idle_task(current),
 				      false));
+	return more;
+}
+
+/* Run one pass over both flavors, returning true if CBs remain ready. */
+static bool rcu_process_callbacks_once(void)
+{
+	/* Use "|" instead of "||" to defeat short circuiting. */
+	return __rcu_process_callbacks(&rcu_sched_ctrlblk) |
+	       __rcu_process_callbacks(&rcu_bh_ctrlblk);
+}
+
+#ifdef CONFIG_RCU_TINY_OFFLOAD
+
+static struct task_struct *rcu_cb_kthread_task;
+
+static bool rcu_cbs_ready(void)
+{
+	return ACCESS_ONCE(rcu_sched_ctrlblk.donetail) !=
+			&rcu_sched_ctrlblk.rcucblist ||
+	       ACCESS_ONCE(rcu_bh_ctrlblk.donetail) !=
+			&rcu_bh_ctrlblk.rcucblist;
+}
+
+/*
+ * Invoke the ready callbacks in blimit-sized batches from a normal
+ * priority kthread, letting anything more important run in between.
+ */
+static int rcu_cb_kthread(void *unused)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!rcu_cbs_ready())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		while (rcu_process_callbacks_once())
+			cond_resched();
+	}
+	return 0;
 }
 
 static void rcu_process_callbacks(struct softirq_action *unused)
 {
-	__rcu_process_callbacks(&rcu_sched_ctrlblk);
-	__rcu_process_callbacks(&rcu_bh_ctrlblk);
+	struct task_struct *t = ACCESS_ONCE(rcu_cb_kthread_task);
+
+	if (t) {
+		wake_up_process(t);
+		return;
+	}
+	/* Too early in boot for the kthread, invoke one batch here. */
+	if (rcu_process_callbacks_once())
+		raise_softirq(RCU_SOFTIRQ);
+}
+
+static int __init rcu_spawn_cb_kthread(void)
+{
+	struct task_struct *t;
+
+	t = kthread_run(rcu_cb_kthread, NULL, "rcuc");
+	if (WARN_ON(IS_ERR(t)))
+		return 0;
+	ACCESS_ONCE(rcu_cb_kthread_task) = t;
+	/* Pick up anything that became ready before the kthread existed. */
+	wake_up_process(t);
+	return 0;
 }
+early_initcall(rcu_spawn_cb_kthread);
+
+#else /* #ifdef CONFIG_RCU_TINY_OFFLOAD */
+
+/*
+ * Invoke one batch and leave the rest to a later softirq run, which
+ * __do_softirq() pushes to ksoftirqd once it keeps coming back.
+ */
+static void rcu_process_callbacks(struct softirq_action *unused)
+{
+	if (rcu_process_callbacks_once())
+		raise_softirq(RCU_SOFTIRQ);
+}
+
+#endif /* #else #ifdef CONFIG_RCU_TINY_OFFLOAD */
 
 /*
  * Wait for a grace period to elapse.  But it is illegal to invoke
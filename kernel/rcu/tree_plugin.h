@@ -2311,6 +2311,9 @@ static int rcu_nocb_kthread(void *arg)
 			c++;
 			local_bh_enable();
 			list = next;
+			/* Let other tasks in between batches of blimit CBs. */
+			if (list && blimit > 0 && !(c % blimit))
+				cond_resched_rcu_qs();
 		}
 		trace_rcu_batch_end(rdp->rsp->name, c, !!list, 0, 0, 1);
 		smp_mb__before_atomic();  /* _add after CB invocation. */
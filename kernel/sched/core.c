@@ -813,6 +813,12 @@ static void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_dequeued(rq, p);
+	/*
+	 * A wakeup stamp is only good against this rq's clock: drop it
+	 * when the task leaves before running, e.g. to migrate, rather
+	 * than account it against another CPU's clock later.
+	 */
+	schedstat_set(p->se.statistics.wakeup_lat_start, 0);
 	p->sched_class->dequeue_task(rq, p, flags);
 }
 
@@ -1449,6 +1455,11 @@ static void ttwu_activate(struct rq *rq, struct task_struct *p, int en_flags)
 {
 	activate_task(rq, p, en_flags);
 	p->on_rq = TASK_ON_RQ_QUEUED;
+	/*
+	 * Only a task put back on the runqueue waits to be switched in:
+	 * ttwu_remote() also wakes tasks that are running or preempted.
+	 */
+	schedstat_set(p->se.statistics.wakeup_lat_start, rq_clock(rq));
 
 	/* if a worker is waking up, notify workqueue */
 	if (p->flags & PF_WQ_WORKER)
@@ -1814,6 +1825,7 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 
 	RB_CLEAR_NODE(&p->dl.rb_node);
 	init_dl_task_timer(&p->dl);
+	init_dl_overrun_work(&p->dl);
 	__dl_clear_params(p);
 
 	INIT_LIST_HEAD(&p->rt.run_list);
@@ -2293,6 +2305,78 @@ asmlinkage __visible void schedule_tail(struct task_struct *prev)
 		put_user(task_pid_vnr(current), current->set_child_tid);
 }
 
+#ifdef CONFIG_SCHEDSTATS
+static void sched_lat_hist_add(u32 *hist, u64 delta)
+{
+	u64 us = div_u64(delta, NSEC_PER_USEC);
+	unsigned int bucket = us ? ilog2(us) + 1 : 0;
+
+	hist[min_t(unsigned int, bucket, SCHED_LAT_HIST_BUCKETS - 1)]++;
+}
+
+/*
+ * Latency statistics for tasks which need to know why they did not run
+ * when they expected to: the delay from wakeup to running, how long and
+ * by whom they were kept off the CPU while runnable, and the interrupt
+ * time taken from them while they ran.
+ */
+static void sched_lat_switch(struct rq *rq, struct task_struct *prev,
+			     struct task_struct *next)
+{
+	struct sched_statistics *ps = &prev->se.statistics;
+	struct sched_statistics *ns = &next->se.statistics;
+	u64 now = rq_clock(rq);
+	u64 delta;
+
+#ifdef CONFIG_IRQ_TIME_ACCOUNTING
+	{
+		u64 irq = irq_time_read(cpu_of(rq));
+
+		if (ps->irq_start) {
+			delta = irq - ps->irq_start;
+			ps->irq_sum += delta;
+			ps->irq_max = max(ps->irq_max, delta);
+		}
+		ns->irq_start = irq;
+	}
+#endif
+
+	if (task_on_rq_queued(prev)) {
+		ps->preempt_start = now;
+		ps->preempt_by_pid = task_pid_nr(next);
+		memcpy(ps->preempt_by_comm, next->comm, TASK_COMM_LEN);
+	}
+
+	if (ns->preempt_start) {
+		delta = now - ns->preempt_start;
+		ns->preempt_sum += delta;
+		ns->preempt_count++;
+		sched_lat_hist_add(ns->preempt_hist, delta);
+		if (delta > ns->preempt_max) {
+			ns->preempt_max = delta;
+			ns->preempt_max_pid = ns->preempt_by_pid;
+			memcpy(ns->preempt_max_comm, ns->preempt_by_comm,
+			       TASK_COMM_LEN);
+		}
+		ns->preempt_start = 0;
+	}
+
+	if (ns->wakeup_lat_start) {
+		delta = now - ns->wakeup_lat_start;
+		ns->wakeup_lat_sum += delta;
+		ns->wakeup_lat_count++;
+		ns->wakeup_lat_max = max(ns->wakeup_lat_max, delta);
+		sched_lat_hist_add(ns->wakeup_lat_hist, delta);
+		ns->wakeup_lat_start = 0;
+	}
+}
+#else
+static inline void sched_lat_switch(struct rq *rq, struct task_struct *prev,
+				    struct task_struct *next)
+{
+}
+#endif
+
 /*
  * context_switch - switch to the new MM and the new thread's register state.
  */
@@ -2802,6 +2886,7 @@ static void __sched __schedule(void)
 		rq->curr = next;
 		++*switch_count;
 
+		sched_lat_switch(rq, prev, next);
 		rq = context_switch(rq, prev, next); /* unlocks the rq */
 		cpu = cpu_of(rq);
 	} else
@@ -3441,7 +3526,8 @@ recheck:
 			return -EINVAL;
 	}
 
-	if (attr->sched_flags & ~(SCHED_FLAG_RESET_ON_FORK))
+	if (attr->sched_flags &
+	    ~(SCHED_FLAG_RESET_ON_FORK | SCHED_FLAG_DL_OVERRUN))
 		return -EINVAL;
 
 	/*
@@ -8072,7 +8158,8 @@ const u64 min_cfs_quota_period = 1 * NSEC_PER_MSEC; /* 1ms */
 
 static int __cfs_schedulable(struct task_group *tg, u64 period, u64 runtime);
 
-static int tg_set_cfs_bandwidth(struct task_group *tg, u64 period, u64 quota)
+static int tg_set_cfs_bandwidth(struct task_group *tg, u64 period, u64 quota,
+				u64 burst)
 {
 	int i, ret = 0, runtime_enabled, runtime_was_enabled;
 	struct cfs_bandwidth *cfs_b = &tg->cfs_bandwidth;
@@ -8096,6 +8183,13 @@ static int tg_set_cfs_bandwidth(struct task_group *tg, u64 period, u64 quota)
 	if (period > max_cfs_quota_period)
 		return -EINVAL;
 
+	/*
+	 * The burst is a carry-over of unused quota, so it can't be larger
+	 * than the quota itself.
+	 */
+	if (quota != RUNTIME_INF && burst > quota)
+		return -EINVAL;
+
 	/*
 	 * Prevent race between setting of cfs_rq->runtime_enabled and
 	 * unthrottle_offline_cfs_rqs().
@@ -8117,7 +8211,10 @@ static int tg_set_cfs_bandwidth(struct task_group *tg, u64 period, u64 quota)
 	raw_spin_lock_irq(&cfs_b->lock);
 	cfs_b->period = ns_to_ktime(period);
 	cfs_b->quota = quota;
+	cfs_b->burst = burst;
 
+	/* start from a full quota, without any carried over runtime */
+	cfs_b->runtime = 0;
 	__refill_cfs_bandwidth_runtime(cfs_b);
 	/* restart the period timer (if active) to handle new period expiry */
 	if (runtime_enabled && cfs_b->timer_active) {
@@ -8157,7 +8254,7 @@ int tg_set_cfs_quota(struct task_group *tg, long cfs_quota_us)
 	else
 		quota = (u64)cfs_quota_us * NSEC_PER_USEC;
 
-	return tg_set_cfs_bandwidth(tg, period, quota);
+	return tg_set_cfs_bandwidth(tg, period, quota, tg->cfs_bandwidth.burst);
 }
 
 long tg_get_cfs_quota(struct task_group *tg)
@@ -8180,7 +8277,7 @@ int tg_set_cfs_period(struct task_group *tg, long cfs_period_us)
 	period = (u64)cfs_period_us * NSEC_PER_USEC;
 	quota = tg->cfs_bandwidth.quota;
 
-	return tg_set_cfs_bandwidth(tg, period, quota);
+	return tg_set_cfs_bandwidth(tg, period, quota, tg->cfs_bandwidth.burst);
 }
 
 long tg_get_cfs_period(struct task_group *tg)
@@ -8193,6 +8290,29 @@ long tg_get_cfs_period(struct task_group *tg)
 	return cfs_period_us;
 }
 
+int tg_set_cfs_burst(struct task_group *tg, u64 cfs_burst_us)
+{
+	u64 quota, period, burst;
+
+	if (cfs_burst_us > U64_MAX / NSEC_PER_USEC)
+		return -EINVAL;
+
+	period = ktime_to_ns(tg->cfs_bandwidth.period);
+	quota = tg->cfs_bandwidth.quota;
+	burst = cfs_burst_us * NSEC_PER_USEC;
+
+	return tg_set_cfs_bandwidth(tg, period, quota, burst);
+}
+
+u64 tg_get_cfs_burst(struct task_group *tg)
+{
+	u64 burst_us = tg->cfs_bandwidth.burst;
+
+	do_div(burst_us, NSEC_PER_USEC);
+
+	return burst_us;
+}
+
 static s64 cpu_cfs_quota_read_s64(struct cgroup_subsys_state *css,
 				  struct cftype *cft)
 {
@@ -8217,6 +8337,18 @@ static int cpu_cfs_period_write_u64(struct cgroup_subsys_state *css,
 	return tg_set_cfs_period(css_tg(css), cfs_period_us);
 }
 
+static u64 cpu_cfs_burst_read_u64(struct cgroup_subsys_state *css,
+				  struct cftype *cft)
+{
+	return tg_get_cfs_burst(css_tg(css));
+}
+
+static int cpu_cfs_burst_write_u64(struct cgroup_subsys_state *css,
+				   struct cftype *cftype, u64 cfs_burst_us)
+{
+	return tg_set_cfs_burst(css_tg(css), cfs_burst_us);
+}
+
 struct cfs_schedulable_data {
 	struct task_group *tg;
 	u64 period, quota;
@@ -8299,11 +8431,18 @@ static int cpu_stats_show(struct seq_file *sf, void *v)
 {
 	struct task_group *tg = css_tg(seq_css(sf));
 	struct cfs_bandwidth *cfs_b = &tg->cfs_bandwidth;
+	int i;
 
 	seq_printf(sf, "nr_periods %d\n", cfs_b->nr_periods);
 	seq_printf(sf, "nr_throttled %d\n", cfs_b->nr_throttled);
 	seq_printf(sf, "throttled_time %llu\n", cfs_b->throttled_time);
 
+	/* "throttled_hist_us <lower bound> <count>" per bucket */
+	for (i = 0; i < CFS_THROTTLE_HIST_BUCKETS; i++)
+		seq_printf(sf, "throttled_hist_us %llu %llu\n",
+			   i ? 1ULL << (i - 1) : 0ULL,
+			   cfs_b->throttled_hist[i]);
+
 	return 0;
 }
 #endif /* CONFIG_CFS_BANDWIDTH */
@@ -8354,6 +8493,11 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_cfs_period_read_u64,
 		.write_u64 = cpu_cfs_period_write_u64,
 	},
+	{
+		.name = "cfs_burst_us",
+		.read_u64 = cpu_cfs_burst_read_u64,
+		.write_u64 = cpu_cfs_burst_write_u64,
+	},
 	{
 		.name = "stat",
 		.seq_show = cpu_stats_show,
@@ -17,6 +17,7 @@
 #include "sched.h"
 
 #include <linux/slab.h>
+#include <linux/task_work.h>
 
 struct dl_bandwidth def_dl_bandwidth;
 
@@ -393,6 +394,7 @@ static void replenish_dl_entity(struct sched_dl_entity *dl_se,
 	 */
 	if (dl_time_before(dl_se->deadline, rq_clock(rq))) {
 		printk_deferred_once("sched: DL replenish lagged to much\n");
+		schedstat_inc(dl_task_of(dl_se), se.statistics.nr_dl_lagged);
 		dl_se->deadline = rq_clock(rq) + pi_se->dl_deadline;
 		dl_se->runtime = pi_se->dl_runtime;
 	}
@@ -639,6 +641,41 @@ void init_dl_task_timer(struct sched_dl_entity *dl_se)
 	timer->function = dl_task_timer;
 }
 
+static void dl_overrun_notify(struct callback_head *work)
+{
+	current->dl.dl_overrun = 0;
+	send_sig(SIGXCPU, current, 0);
+}
+
+void init_dl_overrun_work(struct sched_dl_entity *dl_se)
+{
+	dl_se->dl_overrun = 0;
+	init_task_work(&dl_se->dl_overrun_work, dl_overrun_notify);
+}
+
+/*
+ * The task consumed its whole runtime before completing the job.  If
+ * it asked for it, tell it with a SIGXCPU: the signal can't be sent
+ * with the rq lock held, so queue it for the return to user space.
+ * dl_overrun stays set until then, which keeps the work from being
+ * queued twice.
+ */
+static void dl_runtime_overrun(struct task_struct *p)
+{
+	struct sched_dl_entity *dl_se = &p->dl;
+
+	schedstat_inc(p, se.statistics.nr_dl_overruns);
+
+	if (!(dl_se->flags & SCHED_FLAG_DL_OVERRUN) || dl_se->dl_overrun)
+		return;
+	if (p->flags & PF_KTHREAD)
+		return;
+
+	dl_se->dl_overrun = 1;
+	if (task_work_add(p, &dl_se->dl_overrun_work, true))
+		dl_se->dl_overrun = 0;
+}
+
 static
 int dl_runtime_exceeded(struct rq *rq, struct sched_dl_entity *dl_se)
 {
@@ -685,6 +722,8 @@ static void update_curr_dl(struct rq *rq)
 
 	dl_se->runtime -= dl_se->dl_yielded ? 0 : delta_exec;
 	if (dl_runtime_exceeded(rq, dl_se)) {
+		if (!dl_se->dl_yielded && !dl_se->dl_boosted)
+			dl_runtime_overrun(curr);
 		dl_se->dl_throttled = 1;
 		__dequeue_task_dl(rq, curr, 0);
 		if (unlikely(!start_dl_timer(dl_se, curr->dl.dl_boosted)))
@@ -557,6 +557,24 @@ static void sched_show_numa(struct task_struct *p, struct seq_file *m)
 #endif
 }
 
+/*
+ * One line per bucket: name, lower bound of the bucket in us, count.
+ */
+static void sched_show_lat_hist(struct task_struct *p, struct seq_file *m)
+{
+#ifdef CONFIG_SCHEDSTATS
+	struct sched_statistics *stats = &p->se.statistics;
+	int i;
+
+	for (i = 0; i < SCHED_LAT_HIST_BUCKETS; i++)
+		SEQ_printf(m, "wakeup_lat_hist_us, %u, %u\n",
+			   i ? 1U << (i - 1) : 0, stats->wakeup_lat_hist[i]);
+	for (i = 0; i < SCHED_LAT_HIST_BUCKETS; i++)
+		SEQ_printf(m, "preempt_hist_us, %u, %u\n",
+			   i ? 1U << (i - 1) : 0, stats->preempt_hist[i]);
+#endif
+}
+
 void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 {
 	unsigned long nr_switches;
@@ -609,6 +627,23 @@ void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 	P(se.statistics.nr_wakeups_affine_attempts);
 	P(se.statistics.nr_wakeups_passive);
 	P(se.statistics.nr_wakeups_idle);
+	PN(se.statistics.wakeup_lat_max);
+	PN(se.statistics.wakeup_lat_sum);
+	P(se.statistics.wakeup_lat_count);
+	PN(se.statistics.preempt_max);
+	PN(se.statistics.preempt_sum);
+	P(se.statistics.preempt_count);
+	SEQ_printf(m, "%-45s:%21s\n", "se.statistics.preempt_max_by",
+		   p->se.statistics.preempt_max_comm);
+	P(se.statistics.preempt_max_pid);
+#ifdef CONFIG_IRQ_TIME_ACCOUNTING
+	PN(se.statistics.irq_max);
+	PN(se.statistics.irq_sum);
+#endif
+	if (dl_policy(p->policy)) {
+		P(se.statistics.nr_dl_overruns);
+		P(se.statistics.nr_dl_lagged);
+	}
 
 	{
 		u64 avg_atom, avg_per_cpu;
@@ -664,6 +699,7 @@ void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 	}
 
 	sched_show_numa(p, m);
+	sched_show_lat_hist(p, m);
 }
 
 void proc_sched_set_task(struct task_struct *p)
@@ -3431,6 +3431,9 @@ static inline u64 sched_cfs_bandwidth_slice(void)
 
 /*
  * Replenish runtime according to assigned quota and update expiration time.
+ * Runtime left over from earlier periods is carried over up to the burst
+ * allowance, so a group that is idle on average can absorb a short spike
+ * of up to quota + burst in one period without being throttled.
  * We use sched_clock_cpu directly instead of rq->clock to avoid adding
  * additional synchronization around rq->lock.
  *
@@ -3444,7 +3447,8 @@ void __refill_cfs_bandwidth_runtime(struct cfs_bandwidth *cfs_b)
 		return;
 
 	now = sched_clock_cpu(smp_processor_id());
-	cfs_b->runtime = cfs_b->quota;
+	cfs_b->runtime = min(cfs_b->runtime + cfs_b->quota,
+			     cfs_b->quota + cfs_b->burst);
 	cfs_b->runtime_expires = now + ktime_to_ns(cfs_b->period);
 }
 
@@ -3680,6 +3684,8 @@ void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
 	struct sched_entity *se;
 	int enqueue = 1;
 	long task_delta;
+	u64 delta, delta_us;
+	int bucket = 0;
 
 	se = cfs_rq->tg->se[cpu_of(rq)];
 
@@ -3687,8 +3693,14 @@ void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
 
 	update_rq_clock(rq);
 
+	delta = rq_clock(rq) - cfs_rq->throttled_clock;
+	delta_us = div_u64(delta, NSEC_PER_USEC);
+	if (delta_us)
+		bucket = min(fls64(delta_us), CFS_THROTTLE_HIST_BUCKETS - 1);
+
 	raw_spin_lock(&cfs_b->lock);
-	cfs_b->throttled_time += rq_clock(rq) - cfs_rq->throttled_clock;
+	cfs_b->throttled_time += delta;
+	cfs_b->throttled_hist[bucket]++;
 	list_del_rcu(&cfs_rq->throttled_list);
 	raw_spin_unlock(&cfs_b->lock);
 
@@ -4032,6 +4044,7 @@ void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
 	raw_spin_lock_init(&cfs_b->lock);
 	cfs_b->runtime = 0;
 	cfs_b->quota = RUNTIME_INF;
+	cfs_b->burst = 0;
 	cfs_b->period = ns_to_ktime(default_cfs_period());
 
 	INIT_LIST_HEAD(&cfs_b->throttled_cfs_rq);
@@ -207,11 +207,14 @@ struct rt_rq;
 
 extern struct list_head task_groups;
 
+/* power-of-two microsecond buckets of throttled time, last one open ended */
+#define CFS_THROTTLE_HIST_BUCKETS	18
+
 struct cfs_bandwidth {
 #ifdef CONFIG_CFS_BANDWIDTH
 	raw_spinlock_t lock;
 	ktime_t period;
-	u64 quota, runtime;
+	u64 quota, runtime, burst;
 	s64 hierarchical_quota;
 	u64 runtime_expires;
 
@@ -222,6 +225,7 @@ struct cfs_bandwidth {
 	/* statistics */
 	int nr_periods, nr_throttled;
 	u64 throttled_time;
+	u64 throttled_hist[CFS_THROTTLE_HIST_BUCKETS];
 #endif
 };
 
@@ -1296,6 +1300,7 @@ extern void init_rt_bandwidth(struct rt_bandwidth *rt_b, u64 period, u64 runtime
 extern struct dl_bandwidth def_dl_bandwidth;
 extern void init_dl_bandwidth(struct dl_bandwidth *dl_b, u64 period, u64 runtime);
 extern void init_dl_task_timer(struct sched_dl_entity *dl_se);
+extern void init_dl_overrun_work(struct sched_dl_entity *dl_se);
 
 unsigned long to_ratio(u64 period, u64 runtime);
 
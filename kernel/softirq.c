@@ -26,6 +26,7 @@
 #include <linux/smpboot.h>
 #include <linux/tick.h>
 #include <linux/irq.h>
+#include <linux/sched/rt.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/irq.h>
@@ -77,6 +78,95 @@ static void wakeup_softirqd(void)
 		wake_up_process(tsk);
 }
 
+/*
+ * Vectors selected with softirq_threads= are not run from __do_softirq()
+ * but from a dedicated per-cpu thread each, "sirq-<name>/<cpu>", which
+ * can be given its own priority.  A NET_RX flood then competes with the
+ * rest of the system through the scheduler instead of running ahead of
+ * the timer softirq and every RT task.
+ *
+ * Raised vectors still go through the normal pending mask, so raising
+ * one stays as cheap as before.  Whoever would process them inline moves
+ * the threaded bits to softirq_thread_pending and wakes their threads
+ * instead, which only happens where ksoftirqd could be woken as well.
+ */
+static u32 softirq_threaded_mask __read_mostly;
+static u32 softirq_threads_requested __initdata;
+static int softirq_thread_prio[NR_SOFTIRQS] __read_mostly;
+
+static DEFINE_PER_CPU(u32, softirq_thread_pending);
+static DEFINE_PER_CPU(struct task_struct *, softirq_thread_task[NR_SOFTIRQS]);
+
+/*
+ * softirq_threads=<vector>[:<prio>][,<vector>[:<prio>]...]
+ * A priority of 1..MAX_USER_RT_PRIO-1 runs the thread as SCHED_FIFO, 0 or
+ * none as SCHED_NORMAL.
+ */
+static int __init softirq_threads_setup(char *str)
+{
+	char *tok, *prio;
+	int nr, val;
+
+	while ((tok = strsep(&str, ",")) != NULL) {
+		prio = strchr(tok, ':');
+		if (prio)
+			*prio++ = '\0';
+
+		for (nr = 0; nr < NR_SOFTIRQS; nr++)
+			if (!strcasecmp(tok, softirq_to_name[nr]))
+				break;
+		if (nr == NR_SOFTIRQS) {
+			pr_warn("softirq_threads: unknown vector %s\n", tok);
+			continue;
+		}
+
+		val = 0;
+		if (prio && (kstrtoint(prio, 0, &val) || val < 0 ||
+			     val >= MAX_USER_RT_PRIO)) {
+			pr_warn("softirq_threads: bad priority for %s\n", tok);
+			val = 0;
+		}
+
+		softirq_threads_requested |= 1U << nr;
+		softirq_thread_prio[nr] = val;
+	}
+	return 1;
+}
+__setup("softirq_threads=", softirq_threads_setup);
+
+static void wakeup_softirq_thread(unsigned int nr)
+{
+	struct task_struct *tsk = __this_cpu_read(softirq_thread_task[nr]);
+
+	if (tsk && tsk->state != TASK_RUNNING)
+		wake_up_process(tsk);
+}
+
+/*
+ * Hand the pending threaded vectors to their threads and return the
+ * ones left for inline processing.  Must run with interrupts disabled.
+ */
+static __u32 softirq_split_threaded(void)
+{
+	__u32 pending = local_softirq_pending();
+	__u32 threaded = pending & softirq_threaded_mask;
+	int softirq_bit;
+
+	if (likely(!threaded))
+		return pending;
+
+	pending &= ~threaded;
+	set_softirq_pending(pending);
+	__this_cpu_or(softirq_thread_pending, threaded);
+
+	while ((softirq_bit = ffs(threaded))) {
+		wakeup_softirq_thread(softirq_bit - 1);
+		threaded &= ~(1U << (softirq_bit - 1));
+	}
+
+	return pending;
+}
+
 /*
  * preempt_count and SOFTIRQ_OFFSET usage:
  * - preempt_count is changed by SOFTIRQ_OFFSET on entering or leaving
@@ -244,7 +334,7 @@ asmlinkage __visible void __do_softirq(void)
 	 */
 	current->flags &= ~PF_MEMALLOC;
 
-	pending = local_softirq_pending();
+	pending = softirq_split_threaded();
 	account_irq_enter_time(current);
 
 	__local_bh_disable_ip(_RET_IP_, SOFTIRQ_OFFSET);
@@ -285,7 +375,7 @@ restart:
 	rcu_bh_qs();
 	local_irq_disable();
 
-	pending = local_softirq_pending();
+	pending = softirq_split_threaded();
 	if (pending) {
 		if (time_before(jiffies, end) && !need_resched() &&
 		    --max_restart)
@@ -408,11 +498,15 @@ inline void raise_softirq_irqoff(unsigned int nr)
 	 * actually run the softirq once we return from
 	 * the irq or softirq.
 	 *
-	 * Otherwise we wake up ksoftirqd to make sure we
-	 * schedule the softirq soon.
+	 * Otherwise we wake up ksoftirqd, or the vector's own thread,
+	 * to make sure we schedule the softirq soon.
 	 */
-	if (!in_interrupt())
-		wakeup_softirqd();
+	if (!in_interrupt()) {
+		if (softirq_threaded_mask & (1U << nr))
+			softirq_split_threaded();
+		else
+			wakeup_softirqd();
+	}
 }
 
 void raise_softirq(unsigned int nr)
@@ -667,6 +761,116 @@ static void run_ksoftirqd(unsigned int cpu)
 	local_irq_enable();
 }
 
+/* The vector served by the calling thread */
+static unsigned int softirq_thread_vec(void)
+{
+	unsigned int nr;
+
+	for (nr = 0; nr < NR_SOFTIRQS; nr++)
+		if (this_cpu_read(softirq_thread_task[nr]) == current)
+			break;
+	BUG_ON(nr == NR_SOFTIRQS);
+	return nr;
+}
+
+static void softirq_thread_setup(unsigned int cpu)
+{
+	unsigned int nr = softirq_thread_vec();
+	struct sched_param param = {
+		.sched_priority = softirq_thread_prio[nr],
+	};
+
+	if (param.sched_priority)
+		sched_setscheduler_nocheck(current, SCHED_FIFO, &param);
+}
+
+static int softirq_thread_should_run(unsigned int cpu)
+{
+	return __this_cpu_read(softirq_thread_pending) &
+	       (1U << softirq_thread_vec());
+}
+
+/*
+ * Same context as __do_softirq() provides: bh disabled with
+ * SOFTIRQ_OFFSET, so in_serving_softirq() holds for the handler.  The
+ * time is not accounted as softirq time but to the thread, just like
+ * for ksoftirqd.
+ */
+static void run_softirq_thread(unsigned int cpu)
+{
+	unsigned int nr = softirq_thread_vec();
+	struct softirq_action *h = softirq_vec + nr;
+	bool in_hardirq;
+	int prev_count;
+
+	local_irq_disable();
+	if (!(__this_cpu_read(softirq_thread_pending) & (1U << nr))) {
+		local_irq_enable();
+		return;
+	}
+	__this_cpu_and(softirq_thread_pending, ~(1U << nr));
+
+	__local_bh_disable_ip(_RET_IP_, SOFTIRQ_OFFSET);
+	in_hardirq = lockdep_softirq_start();
+	local_irq_enable();
+
+	prev_count = preempt_count();
+	kstat_incr_softirqs_this_cpu(nr);
+
+	trace_softirq_entry(nr);
+	h->action(h);
+	trace_softirq_exit(nr);
+	if (unlikely(prev_count != preempt_count())) {
+		pr_err("huh, entered softirq %u %s %p with preempt_count %08x, exited with %08x?\n",
+		       nr, softirq_to_name[nr], h->action,
+		       prev_count, preempt_count());
+		preempt_count_set(prev_count);
+	}
+	rcu_bh_qs();
+
+	local_irq_disable();
+	lockdep_softirq_end(in_hardirq);
+	__local_bh_enable(SOFTIRQ_OFFSET);
+	local_irq_enable();
+
+	/* Vectors raised by the handler for inline processing */
+	if (local_softirq_pending())
+		do_softirq();
+
+	cond_resched_rcu_qs();
+}
+
+static struct smp_hotplug_thread softirq_vector_threads[NR_SOFTIRQS];
+
+static __init void spawn_softirq_threads(void)
+{
+	struct smp_hotplug_thread *ht;
+	unsigned int nr;
+
+	for (nr = 0; nr < NR_SOFTIRQS; nr++) {
+		if (!(softirq_threads_requested & (1U << nr)))
+			continue;
+
+		ht = &softirq_vector_threads[nr];
+		ht->store = &softirq_thread_task[nr];
+		ht->thread_should_run = softirq_thread_should_run;
+		ht->thread_fn = run_softirq_thread;
+		ht->setup = softirq_thread_setup;
+		ht->thread_comm = kasprintf(GFP_KERNEL, "sirq-%s/%%u",
+					    softirq_to_name[nr]);
+		if (!ht->thread_comm ||
+		    smpboot_register_percpu_thread(ht)) {
+			pr_err("failed to create %s softirq threads\n",
+			       softirq_to_name[nr]);
+			continue;
+		}
+
+		softirq_threaded_mask |= 1U << nr;
+		pr_info("%s runs in threads, priority %d\n",
+			softirq_to_name[nr], softirq_thread_prio[nr]);
+	}
+}
+
 #ifdef CONFIG_HOTPLUG_CPU
 /*
  * tasklet_kill_immediate is called to remove a tasklet which can already be
@@ -722,6 +926,11 @@ static void takeover_tasklets(unsigned int cpu)
 	}
 	raise_softirq_irqoff(HI_SOFTIRQ);
 
+	/* Threaded vectors the dead CPU did not get to */
+	or_softirq_pending(per_cpu(softirq_thread_pending, cpu));
+	per_cpu(softirq_thread_pending, cpu) = 0;
+	softirq_split_threaded();
+
 	local_irq_enable();
 }
 #endif /* CONFIG_HOTPLUG_CPU */
@@ -756,6 +965,7 @@ static __init int spawn_ksoftirqd(void)
 	register_cpu_notifier(&cpu_nfb);
 
 	BUG_ON(smpboot_register_percpu_thread(&softirq_threads));
+	spawn_softirq_threads();
 
 	return 0;
 }
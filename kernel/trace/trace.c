@@ -3602,6 +3602,12 @@ static int trace_set_options(struct trace_array *tr, char *option)
 	return ret;
 }
 
+/* Set an option of the top level instance, as written to trace_options */
+int trace_set_global_option(char *option)
+{
+	return trace_set_options(&global_trace, option);
+}
+
 static ssize_t
 tracing_trace_options_write(struct file *filp, const char __user *ubuf,
 			size_t cnt, loff_t *ppos)
@@ -1273,6 +1273,7 @@ void trace_printk_init_buffers(void);
 void trace_printk_start_comm(void);
 int trace_keep_overwrite(struct tracer *tracer, u32 mask, int set);
 int set_tracer_flag(struct trace_array *tr, unsigned int mask, int enabled);
+int trace_set_global_option(char *option);
 
 /*
  * Normal trace_printk() and friends allocates special buffers
@@ -0,0 +1,335 @@
+/*
+ * Flight recorder mode for the event tracer.
+ *
+ * Enables preset groups of events into the overwriting ring buffer and
+ * keeps it running in the background.  When something goes wrong - an
+ * interrupt handler runs longer than flight_irq_thresh_us, the watchdog
+ * pretimeout fires, or a driver calls trace_flight_trigger() - the live
+ * buffer is swapped into the snapshot buffer, which then holds the events
+ * leading up to the incident while recording carries on.  Only the first
+ * incident is kept until the recorder is re-armed.
+ *
+ *   echo sched,irq,sdma > /sys/kernel/debug/tracing/flight_recorder
+ *   echo 500 > /sys/kernel/debug/tracing/flight_irq_thresh_us
+ *   ...
+ *   cat /sys/kernel/debug/tracing/snapshot
+ *   echo arm > /sys/kernel/debug/tracing/flight_recorder
+ *
+ * or trace_flight=sched,irq on the command line.  Events are stored in
+ * the ring buffer in their binary form and only formatted when read; the
+ * recorder additionally turns off record-cmd, which otherwise saves the
+ * task comm on every sched_switch.
+ */
+
+#include <linux/ctype.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/tracefs.h>
+#include <linux/uaccess.h>
+
+#include <trace/events/irq.h>
+
+#include "trace.h"
+
+struct trace_flight_event {
+	const char		*system;
+	const char		*event;		/* NULL for the whole system */
+};
+
+struct trace_flight_preset {
+	const char		*name;
+	struct trace_flight_event events[5];
+};
+
+static const struct trace_flight_preset trace_flight_presets[] = {
+	{ "sched",	{ { "sched", "sched_switch" },
+			  { "sched", "sched_wakeup" } } },
+	{ "irq",	{ { "irq", "irq_handler_entry" },
+			  { "irq", "irq_handler_exit" },
+			  { "irq", "softirq_entry" },
+			  { "irq", "softirq_exit" } } },
+	{ "sdma",	{ { "imx_sdma", NULL } } },
+	{ "fec",	{ { "fec", NULL } } },
+	{ "usdhc",	{ { "esdhc_imx", NULL },
+			  { "block", "block_rq_issue" },
+			  { "block", "block_rq_complete" } } },
+	{ "gpmi",	{ { "gpmi_nand", NULL } } },
+	{ "mxsfb",	{ { "mxsfb", NULL } } },
+};
+
+static DEFINE_MUTEX(trace_flight_mutex);
+static unsigned long trace_flight_active;	/* bit per preset */
+static int trace_flight_armed;
+static unsigned long trace_flight_count;
+static const char *trace_flight_reason;
+
+static unsigned int trace_flight_irq_thresh;	/* usecs, 0 is off */
+static DEFINE_PER_CPU(u64, trace_flight_irq_start);
+
+static char trace_flight_boot[64] __initdata;
+
+/**
+ * trace_flight_trigger - keep the events leading up to an incident
+ * @reason: what happened, a string constant
+ *
+ * Swaps the live trace buffer into the snapshot buffer if the flight
+ * recorder is on and armed.  May be called from any context but NMI.
+ */
+void trace_flight_trigger(const char *reason)
+{
+	if (!READ_ONCE(trace_flight_active) || !xchg(&trace_flight_armed, 0))
+		return;
+
+	tracing_snapshot();
+	trace_flight_reason = reason;
+	trace_flight_count++;
+}
+EXPORT_SYMBOL_GPL(trace_flight_trigger);
+
+static void trace_flight_irq_entry(void *data, int irq,
+				   struct irqaction *action)
+{
+	this_cpu_write(trace_flight_irq_start, local_clock());
+}
+
+static void trace_flight_irq_exit(void *data, int irq,
+				  struct irqaction *action, int ret)
+{
+	u64 delta = local_clock() - this_cpu_read(trace_flight_irq_start);
+
+	if (delta > (u64)READ_ONCE(trace_flight_irq_thresh) * NSEC_PER_USEC)
+		trace_flight_trigger("irq handler latency");
+}
+
+/* Called with trace_flight_mutex held */
+static int trace_flight_set_irq_thresh(unsigned int thresh)
+{
+	int ret = 0;
+
+	if (!trace_flight_irq_thresh && thresh) {
+		ret = register_trace_irq_handler_entry(trace_flight_irq_entry,
+						       NULL);
+		if (ret)
+			return ret;
+		ret = register_trace_irq_handler_exit(trace_flight_irq_exit,
+						      NULL);
+		if (ret) {
+			unregister_trace_irq_handler_entry(
+				trace_flight_irq_entry, NULL);
+			return ret;
+		}
+	} else if (trace_flight_irq_thresh && !thresh) {
+		unregister_trace_irq_handler_exit(trace_flight_irq_exit, NULL);
+		unregister_trace_irq_handler_entry(trace_flight_irq_entry,
+						   NULL);
+		tracepoint_synchronize_unregister();
+	}
+
+	WRITE_ONCE(trace_flight_irq_thresh, thresh);
+	return ret;
+}
+
+static void trace_flight_set_preset(int idx, int set)
+{
+	const struct trace_flight_event *ev;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(trace_flight_presets[idx].events); i++) {
+		ev = &trace_flight_presets[idx].events[i];
+		if (!ev->system)
+			break;
+		if (trace_set_clr_event(ev->system, ev->event, set))
+			pr_warn("trace_flight: no event %s:%s\n", ev->system,
+				ev->event ? ev->event : "*");
+	}
+}
+
+/* Called with trace_flight_mutex held */
+static int trace_flight_enable(unsigned long presets)
+{
+	char norecord_cmd[] = "norecord-cmd";
+	char record_cmd[] = "record-cmd";
+	unsigned long old = trace_flight_active;
+	int ret, i;
+
+	if (presets && !old) {
+		ret = tracing_update_buffers();
+		if (ret < 0)
+			return ret;
+		ret = tracing_alloc_snapshot();
+		if (ret < 0)
+			return ret;
+		trace_set_global_option(norecord_cmd);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(trace_flight_presets); i++)
+		if ((presets ^ old) & BIT(i))
+			trace_flight_set_preset(i, !!(presets & BIT(i)));
+
+	if (!presets && old)
+		trace_set_global_option(record_cmd);
+
+	WRITE_ONCE(trace_flight_active, presets);
+	trace_flight_armed = !!presets;
+	return 0;
+}
+
+/* Parse a comma separated list of presets */
+static int trace_flight_parse(char *buf, unsigned long *presets)
+{
+	char *name;
+	int i;
+
+	*presets = 0;
+	while ((name = strsep(&buf, ",")) != NULL) {
+		name = strim(name);
+		if (!*name)
+			continue;
+		for (i = 0; i < ARRAY_SIZE(trace_flight_presets); i++)
+			if (!strcmp(name, trace_flight_presets[i].name))
+				break;
+		if (i == ARRAY_SIZE(trace_flight_presets))
+			return -EINVAL;
+		*presets |= BIT(i);
+	}
+	return 0;
+}
+
+static ssize_t trace_flight_read(struct file *filp, char __user *ubuf,
+				 size_t cnt, loff_t *ppos)
+{
+	char buf[256];
+	int i, len = 0;
+
+	mutex_lock(&trace_flight_mutex);
+	len += scnprintf(buf + len, sizeof(buf) - len, "presets:");
+	for (i = 0; i < ARRAY_SIZE(trace_flight_presets); i++)
+		len += scnprintf(buf + len, sizeof(buf) - len,
+				 trace_flight_active & BIT(i) ? " [%s]" : " %s",
+				 trace_flight_presets[i].name);
+	len += scnprintf(buf + len, sizeof(buf) - len,
+			 "\narmed: %d\ntriggers: %lu\nlast: %s\n",
+			 trace_flight_armed, trace_flight_count,
+			 trace_flight_reason ? trace_flight_reason : "-");
+	mutex_unlock(&trace_flight_mutex);
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, len);
+}
+
+/* A list of presets to record, "off" to stop or "arm" to re-arm */
+static ssize_t trace_flight_write(struct file *filp, const char __user *ubuf,
+				  size_t cnt, loff_t *ppos)
+{
+	unsigned long presets;
+	char buf[64], *cmd;
+	int ret;
+
+	if (cnt >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, cnt))
+		return -EFAULT;
+	buf[cnt] = 0;
+	cmd = strim(buf);
+
+	mutex_lock(&trace_flight_mutex);
+	if (!strcmp(cmd, "arm")) {
+		trace_flight_armed = !!trace_flight_active;
+		ret = 0;
+	} else if (!strcmp(cmd, "off")) {
+		ret = trace_flight_enable(0);
+	} else {
+		ret = trace_flight_parse(cmd, &presets);
+		if (!ret)
+			ret = trace_flight_enable(presets);
+	}
+	mutex_unlock(&trace_flight_mutex);
+
+	if (ret)
+		return ret;
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations trace_flight_fops = {
+	.open		= tracing_open_generic,
+	.read		= trace_flight_read,
+	.write		= trace_flight_write,
+	.llseek		= generic_file_llseek,
+};
+
+static ssize_t trace_flight_thresh_read(struct file *filp, char __user *ubuf,
+					size_t cnt, loff_t *ppos)
+{
+	char buf[16];
+	int len;
+
+	len = scnprintf(buf, sizeof(buf), "%u\n",
+			READ_ONCE(trace_flight_irq_thresh));
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, len);
+}
+
+static ssize_t trace_flight_thresh_write(struct file *filp,
+					 const char __user *ubuf,
+					 size_t cnt, loff_t *ppos)
+{
+	unsigned int thresh;
+	int ret;
+
+	ret = kstrtouint_from_user(ubuf, cnt, 10, &thresh);
+	if (ret)
+		return ret;
+
+	mutex_lock(&trace_flight_mutex);
+	ret = trace_flight_set_irq_thresh(thresh);
+	mutex_unlock(&trace_flight_mutex);
+
+	if (ret)
+		return ret;
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations trace_flight_thresh_fops = {
+	.open		= tracing_open_generic,
+	.read		= trace_flight_thresh_read,
+	.write		= trace_flight_thresh_write,
+	.llseek		= generic_file_llseek,
+};
+
+static int __init set_trace_flight(char *str)
+{
+	strlcpy(trace_flight_boot, str, sizeof(trace_flight_boot));
+	return 1;
+}
+__setup("trace_flight=", set_trace_flight);
+
+static __init int trace_flight_init(void)
+{
+	struct dentry *d_tracer;
+	unsigned long presets;
+
+	d_tracer = tracing_init_dentry();
+	if (IS_ERR(d_tracer))
+		return 0;
+
+	trace_create_file("flight_recorder", 0644, d_tracer, NULL,
+			  &trace_flight_fops);
+	trace_create_file("flight_irq_thresh_us", 0644, d_tracer, NULL,
+			  &trace_flight_thresh_fops);
+
+	if (!trace_flight_boot[0])
+		return 0;
+
+	mutex_lock(&trace_flight_mutex);
+	if (trace_flight_parse(trace_flight_boot, &presets) ||
+	    trace_flight_enable(presets))
+		pr_warn("trace_flight: failed to start \"%s\"\n",
+			trace_flight_boot);
+	mutex_unlock(&trace_flight_mutex);
+
+	return 0;
+}
+late_initcall(trace_flight_init);
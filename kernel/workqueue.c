@@ -48,6 +48,8 @@
 #include <linux/nodemask.h>
 #include <linux/moduleparam.h>
 #include <linux/uaccess.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "workqueue_internal.h"
 
@@ -318,6 +320,8 @@ struct workqueue_struct *system_wq __read_mostly;
 EXPORT_SYMBOL(system_wq);
 struct workqueue_struct *system_highpri_wq __read_mostly;
 EXPORT_SYMBOL_GPL(system_highpri_wq);
+struct workqueue_struct *system_lowlat_wq __read_mostly;
+EXPORT_SYMBOL_GPL(system_lowlat_wq);
 struct workqueue_struct *system_long_wq __read_mostly;
 EXPORT_SYMBOL_GPL(system_long_wq);
 struct workqueue_struct *system_unbound_wq __read_mostly;
@@ -1237,6 +1241,161 @@ fail:
 	return -EAGAIN;
 }
 
+#ifdef CONFIG_WQ_WORK_STATS
+/*
+ * Per work function statistics: how often it ran, how long it took and
+ * how long it waited between being queued and starting to execute.
+ * Shown in debugfs as workqueue/work_stats, writing to the file resets
+ * them.  The table is open addressed and never allocates; functions
+ * which do not fit any more are only counted as dropped.
+ */
+#define WQ_WORK_STATS_BITS	8
+#define WQ_WORK_STATS_SIZE	(1 << WQ_WORK_STATS_BITS)
+
+struct wq_work_stat {
+	work_func_t		func;
+	u64			count;
+	u64			exec_sum;
+	u64			exec_max;
+	u64			delay_sum;
+	u64			delay_max;
+};
+
+static struct wq_work_stat wq_work_stats[WQ_WORK_STATS_SIZE];
+static unsigned long wq_work_stats_dropped;
+static DEFINE_RAW_SPINLOCK(wq_work_stats_lock);
+
+static inline u64 wq_stats_clock(void)
+{
+	return local_clock();
+}
+
+static inline void work_stamp_queued(struct work_struct *work)
+{
+	work->queued_at = local_clock();
+}
+
+static inline u64 work_queued_at(struct work_struct *work)
+{
+	return work->queued_at;
+}
+
+static void wq_account_work(work_func_t func, u64 queued_at, u64 start)
+{
+	u64 exec = local_clock() - start;
+	u64 delay = queued_at ? start - queued_at : 0;
+	unsigned int h = hash_ptr((void *)func, WQ_WORK_STATS_BITS);
+	struct wq_work_stat *st;
+	unsigned long flags;
+	unsigned int i;
+
+	raw_spin_lock_irqsave(&wq_work_stats_lock, flags);
+	for (i = 0; i < WQ_WORK_STATS_SIZE; i++) {
+		st = &wq_work_stats[(h + i) & (WQ_WORK_STATS_SIZE - 1)];
+		if (st->func == func || !st->func)
+			break;
+	}
+	if (i == WQ_WORK_STATS_SIZE) {
+		wq_work_stats_dropped++;
+	} else {
+		st->func = func;
+		st->count++;
+		st->exec_sum += exec;
+		st->exec_max = max(st->exec_max, exec);
+		st->delay_sum += delay;
+		st->delay_max = max(st->delay_max, delay);
+	}
+	raw_spin_unlock_irqrestore(&wq_work_stats_lock, flags);
+}
+
+static int wq_work_stats_show(struct seq_file *m, void *v)
+{
+	struct wq_work_stat st;
+	int i;
+
+	seq_printf(m, "%-48s %10s %12s %12s %12s %12s\n", "function",
+		   "count", "exec_avg_us", "exec_max_us", "delay_avg_us",
+		   "delay_max_us");
+
+	for (i = 0; i < WQ_WORK_STATS_SIZE; i++) {
+		raw_spin_lock_irq(&wq_work_stats_lock);
+		st = wq_work_stats[i];
+		raw_spin_unlock_irq(&wq_work_stats_lock);
+
+		if (!st.func || !st.count)
+			continue;
+
+		seq_printf(m, "%-48pf %10llu %12llu %12llu %12llu %12llu\n",
+			   st.func, st.count,
+			   div_u64(div64_u64(st.exec_sum, st.count),
+				   NSEC_PER_USEC),
+			   div_u64(st.exec_max, NSEC_PER_USEC),
+			   div_u64(div64_u64(st.delay_sum, st.count),
+				   NSEC_PER_USEC),
+			   div_u64(st.delay_max, NSEC_PER_USEC));
+	}
+
+	seq_printf(m, "dropped %lu\n", wq_work_stats_dropped);
+	return 0;
+}
+
+static int wq_work_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_work_stats_show, NULL);
+}
+
+static ssize_t wq_work_stats_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	raw_spin_lock_irq(&wq_work_stats_lock);
+	memset(wq_work_stats, 0, sizeof(wq_work_stats));
+	wq_work_stats_dropped = 0;
+	raw_spin_unlock_irq(&wq_work_stats_lock);
+
+	return count;
+}
+
+static const struct file_operations wq_work_stats_fops = {
+	.open		= wq_work_stats_open,
+	.read		= seq_read,
+	.write		= wq_work_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_work_stats_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("workqueue", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("work_stats", 0644, dir, NULL,
+			    &wq_work_stats_fops);
+	return 0;
+}
+fs_initcall(wq_work_stats_init);
+#else
+static inline u64 wq_stats_clock(void)
+{
+	return 0;
+}
+
+static inline void work_stamp_queued(struct work_struct *work)
+{
+}
+
+static inline u64 work_queued_at(struct work_struct *work)
+{
+	return 0;
+}
+
+static inline void wq_account_work(work_func_t func, u64 queued_at, u64 start)
+{
+}
+#endif /* CONFIG_WQ_WORK_STATS */
+
 /**
  * insert_work - insert a work into a pool
  * @pwq: pwq @work belongs to
@@ -1256,6 +1415,7 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 	struct worker_pool *pool = pwq->pool;
 
 	/* we own @work, set data and link */
+	work_stamp_queued(work);
 	set_work_pwq(work, pwq, extra_flags);
 	list_add_tail(&work->entry, head);
 	get_pwq(pwq);
@@ -1952,6 +2112,7 @@ __acquires(&pool->lock)
 	bool cpu_intensive = pwq->wq->flags & WQ_CPU_INTENSIVE;
 	int work_color;
 	struct worker *collision;
+	u64 queued_at, start;
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -2022,12 +2183,15 @@ __acquires(&pool->lock)
 	lock_map_acquire_read(&pwq->wq->lockdep_map);
 	lock_map_acquire(&lockdep_map);
 	trace_workqueue_execute_start(work);
+	queued_at = work_queued_at(work);
+	start = wq_stats_clock();
 	worker->current_func(work);
 	/*
 	 * While we must be careful to not use "work" after this, the trace
 	 * point will only record its address.
 	 */
 	trace_workqueue_execute_end(work);
+	wq_account_work(worker->current_func, queued_at, start);
 	lock_map_release(&lockdep_map);
 	lock_map_release(&pwq->wq->lockdep_map);
 
@@ -5121,6 +5285,8 @@ static int __init init_workqueues(void)
 
 	system_wq = alloc_workqueue("events", 0, 0);
 	system_highpri_wq = alloc_workqueue("events_highpri", WQ_HIGHPRI, 0);
+	system_lowlat_wq = alloc_workqueue("events_lowlat",
+					   WQ_HIGHPRI | WQ_UNBOUND, 0);
 	system_long_wq = alloc_workqueue("events_long", 0, 0);
 	system_unbound_wq = alloc_workqueue("events_unbound", WQ_UNBOUND,
 					    WQ_UNBOUND_MAX_ACTIVE);
@@ -5131,7 +5297,8 @@ static int __init init_workqueues(void)
 	system_freezable_power_efficient_wq = alloc_workqueue("events_freezable_power_efficient",
 					      WQ_FREEZABLE | WQ_POWER_EFFICIENT,
 					      0);
-	BUG_ON(!system_wq || !system_highpri_wq || !system_long_wq ||
+	BUG_ON(!system_wq || !system_highpri_wq || !system_lowlat_wq ||
+	       !system_long_wq ||
 	       !system_unbound_wq || !system_freezable_wq ||
 	       !system_power_efficient_wq ||
 	       !system_freezable_power_efficient_wq);
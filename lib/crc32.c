@@ -27,9 +27,11 @@
 /* see: Documentation/crc32.txt for a description of algorithms */
 
 #include <linux/crc32.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/types.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 #include "crc32defs.h"
 
 #if CRC_LE_BITS > 8
@@ -131,6 +133,87 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 }
 #endif
 
+#if CRC_LE_BITS == 64 && defined(__LITTLE_ENDIAN)
+/*
+ * Slicing-by-8 is one long chain of dependent table loads, which in-order
+ * cores such as the Cortex-A7 cannot overlap.  For long buffers run three
+ * independent chains over consecutive CRC32_STRIDE byte blocks and fold
+ * them together at the end of each round:
+ *
+ *   crc(A B C) = crc(A) * x^(2 * 8 * STRIDE) + crc(B) * x^(8 * STRIDE) + crc(C)
+ *
+ * where crc(B) and crc(C) start from zero.  The multiplications are done
+ * with per-nibble tables built at boot.  Whether this actually beats
+ * plain slicing-by-8 depends on the core, so it is only switched on when
+ * a quick benchmark at boot says so.
+ */
+# define CRC32_INTERLEAVE
+# define CRC32_STRIDE	256
+
+static bool crc32_interleave __read_mostly;
+/* [0] multiplies by x^(2 * 8 * CRC32_STRIDE), [1] by x^(8 * CRC32_STRIDE) */
+static u32 crc32_stride_tab[2][8][16] __read_mostly;
+static u32 crc32c_stride_tab[2][8][16] __read_mostly;
+
+static inline u32 crc32_shift_stride(u32 crc, const u32 (*t)[16])
+{
+	u32 r = 0;
+	int i;
+
+	for (i = 0; i < 8; i++, crc >>= 4)
+		r ^= t[i][crc & 15];
+	return r;
+}
+
+static u32 __pure crc32_body_3way(u32 crc, unsigned char const *buf,
+				  size_t len, const u32 (*tab)[256],
+				  const u32 (*stride)[8][16])
+{
+# define DO_CRC4(q) (t3[(q) & 255] ^ t2[((q) >> 8) & 255] ^ \
+		     t1[((q) >> 16) & 255] ^ t0[(q) >> 24])
+# define DO_CRC8(q) (t7[(q) & 255] ^ t6[((q) >> 8) & 255] ^ \
+		     t5[((q) >> 16) & 255] ^ t4[(q) >> 24])
+	const u32 *t0 = tab[0], *t1 = tab[1], *t2 = tab[2], *t3 = tab[3];
+	const u32 *t4 = tab[4], *t5 = tab[5], *t6 = tab[6], *t7 = tab[7];
+	const int n = CRC32_STRIDE / 4;
+	size_t head = -(unsigned long)buf & 3;
+	const u32 *b;
+	u32 c1, c2, q0, q1, q2;
+	int i;
+
+	crc = crc32_body(crc, buf, head, tab);
+	buf += head;
+	len -= head;
+
+	while (len >= 3 * CRC32_STRIDE) {
+		b = (const u32 *)buf;
+		c1 = c2 = 0;
+		for (i = 0; i < n; i += 2) {
+			q0 = crc ^ b[i];
+			q1 = c1 ^ b[n + i];
+			q2 = c2 ^ b[2 * n + i];
+			crc = DO_CRC8(q0);
+			c1 = DO_CRC8(q1);
+			c2 = DO_CRC8(q2);
+			q0 = b[i + 1];
+			q1 = b[n + i + 1];
+			q2 = b[2 * n + i + 1];
+			crc ^= DO_CRC4(q0);
+			c1 ^= DO_CRC4(q1);
+			c2 ^= DO_CRC4(q2);
+		}
+		crc = crc32_shift_stride(crc, stride[0]) ^
+		      crc32_shift_stride(c1, stride[1]) ^ c2;
+		buf += 3 * CRC32_STRIDE;
+		len -= 3 * CRC32_STRIDE;
+	}
+
+	return crc32_body(crc, buf, len, tab);
+# undef DO_CRC4
+# undef DO_CRC8
+}
+#endif
+
 
 /**
  * crc32_le_generic() - Calculate bitwise little-endian Ethernet AUTODIN II
@@ -175,6 +258,13 @@ static inline u32 __pure crc32_le_generic(u32 crc, unsigned char const *p,
 	}
 # else
 	crc = (__force u32) __cpu_to_le32(crc);
+#  ifdef CRC32_INTERLEAVE
+	if (len >= 3 * CRC32_STRIDE + 3 && crc32_interleave)
+		crc = crc32_body_3way(crc, p, len, tab,
+				      polynomial == CRCPOLY_LE ?
+				      crc32_stride_tab : crc32c_stride_tab);
+	else
+#  endif
 	crc = crc32_body(crc, p, len, tab);
 	crc = __le32_to_cpu((__force __le32)crc);
 #endif
@@ -278,6 +368,75 @@ u32 __attribute_const__ __crc32c_le_shift(u32 crc, size_t len)
 EXPORT_SYMBOL(crc32_le_shift);
 EXPORT_SYMBOL(__crc32c_le_shift);
 
+#ifdef CRC32_INTERLEAVE
+static void __init crc32_stride_init(u32 (*t)[8][16], u32 polynomial)
+{
+	u32 k;
+	int j, i, v;
+
+	for (j = 0; j < 2; j++) {
+		/* 0x80000000 is x^0 in this bit order */
+		k = crc32_generic_shift(0x80000000, (2 - j) * CRC32_STRIDE,
+					polynomial);
+		for (i = 0; i < 8; i++)
+			for (v = 0; v < 16; v++)
+				t[j][i][v] = gf2_multiply(v << (4 * i), k,
+							  polynomial);
+	}
+}
+
+static u32 crc32_bench_sink __initdata;
+
+static u64 __init crc32_bench(const u8 *buf, size_t len)
+{
+	u64 start, ns;
+	u32 crc = 0;
+	int i;
+
+	preempt_disable();
+	start = local_clock();
+	for (i = 0; i < 8; i++)
+		crc = crc32_le(crc, buf, len);
+	ns = local_clock() - start;
+	preempt_enable();
+
+	crc32_bench_sink ^= crc;
+	return div64_u64(8ULL * len * 1000, max_t(u64, ns, 1));
+}
+
+static void __init crc32_interleave_select(void)
+{
+	const size_t len = 4096;
+	u64 plain, interleaved;
+	u8 *buf;
+	int i;
+
+	crc32_stride_init(crc32_stride_tab, CRCPOLY_LE);
+	crc32_stride_init(crc32c_stride_tab, CRC32C_POLY_LE);
+
+	buf = kmalloc(len, GFP_KERNEL);
+	if (!buf)
+		return;
+	for (i = 0; i < len; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	crc32_bench(buf, len);		/* warm the tables */
+	plain = crc32_bench(buf, len);
+	crc32_interleave = true;
+	interleaved = crc32_bench(buf, len);
+	crc32_interleave = interleaved > plain;
+	kfree(buf);
+
+	pr_info("crc32: slice-by-8 %llu MB/s, 3-way %llu MB/s, using %s\n",
+		plain, interleaved,
+		crc32_interleave ? "3-way" : "slice-by-8");
+}
+#else
+static inline void crc32_interleave_select(void)
+{
+}
+#endif
+
 /**
  * crc32_be_generic() - Calculate bitwise big-endian Ethernet AUTODIN II CRC32
  * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
@@ -1154,14 +1313,42 @@ static int __init crc32_combine_test(void)
 	return 0;
 }
 
-static int __init crc32test_init(void)
+static void __init crc32test_run(void)
 {
 	crc32_test();
 	crc32c_test();
 
 	crc32_combine_test();
 	crc32c_combine_test();
+}
+
+static void __init crc32test_init(void)
+{
+#ifdef CRC32_INTERLEAVE
+	bool interleave = crc32_interleave;
+
+	/* run everything through both implementations */
+	pr_info("crc32: testing slice-by-8\n");
+	crc32_interleave = false;
+	crc32test_run();
+	pr_info("crc32: testing 3-way interleaved\n");
+	crc32_interleave = true;
+	crc32test_run();
+	crc32_interleave = interleave;
+#else
+	crc32test_run();
+#endif
+}
+#else
+static inline void crc32test_init(void)
+{
+}
+#endif /* CONFIG_CRC32_SELFTEST */
 
+static int __init crc32_init(void)
+{
+	crc32_interleave_select();
+	crc32test_init();
 	return 0;
 }
 
@@ -1169,6 +1356,6 @@ static void __exit crc32_exit(void)
 {
 }
 
-module_init(crc32test_init);
+/* early, ahead of the flash filesystems */
+core_initcall(crc32_init);
 module_exit(crc32_exit);
-#endif /* CONFIG_CRC32_SELFTEST */
@@ -34,6 +34,7 @@
 #include <linux/rculist.h>
 #include <linux/interrupt.h>
 #include <linux/genalloc.h>
+#include <linux/dma-mapping.h>
 #include <linux/of_device.h>
 
 static inline size_t chunk_size(const struct gen_pool_chunk *chunk)
@@ -646,3 +647,59 @@ struct gen_pool *of_get_named_gen_pool(struct device_node *np,
 }
 EXPORT_SYMBOL_GPL(of_get_named_gen_pool);
 #endif /* CONFIG_OF */
+
+#ifdef CONFIG_HAS_DMA
+static struct gen_pool *dev_iram_pool(struct device *dev)
+{
+	if (!dev || !dev->of_node)
+		return NULL;
+	return of_get_named_gen_pool(dev->of_node, "iram", 0);
+}
+
+/**
+ * iram_dma_alloc_coherent - allocate coherent memory, preferably in SRAM
+ * @dev: device whose "iram" phandle names the SRAM pool
+ * @size: number of bytes to allocate
+ * @dma: dma-view physical address return value
+ * @gfp: flags for the dma_alloc_coherent() fallback
+ *
+ * Descriptor rings and other small, hot DMA buffers placed in on-chip
+ * SRAM cut the DRAM latency for both sides and let the DRAM controller
+ * idle.  Falls back to dma_alloc_coherent() when @dev has no pool or it
+ * is exhausted.  Free with iram_dma_free_coherent().
+ */
+void *iram_dma_alloc_coherent(struct device *dev, size_t size,
+			      dma_addr_t *dma, gfp_t gfp)
+{
+	struct gen_pool *pool = dev_iram_pool(dev);
+	void *vaddr = NULL;
+
+	if (pool)
+		vaddr = gen_pool_dma_alloc(pool, size, dma);
+	if (vaddr) {
+		memset(vaddr, 0, size);
+		return vaddr;
+	}
+	return dma_alloc_coherent(dev, size, dma, gfp);
+}
+EXPORT_SYMBOL_GPL(iram_dma_alloc_coherent);
+
+/**
+ * iram_dma_free_coherent - free memory from iram_dma_alloc_coherent()
+ * @dev: device the memory was allocated for
+ * @size: size of the allocation
+ * @vaddr: virtual address returned by iram_dma_alloc_coherent()
+ * @dma: dma address returned by iram_dma_alloc_coherent()
+ */
+void iram_dma_free_coherent(struct device *dev, size_t size, void *vaddr,
+			    dma_addr_t dma)
+{
+	struct gen_pool *pool = dev_iram_pool(dev);
+
+	if (pool && addr_in_gen_pool(pool, (unsigned long)vaddr, size))
+		gen_pool_free(pool, (unsigned long)vaddr, size);
+	else
+		dma_free_coherent(dev, size, vaddr, dma);
+}
+EXPORT_SYMBOL_GPL(iram_dma_free_coherent);
+#endif /* CONFIG_HAS_DMA */
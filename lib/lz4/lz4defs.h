@@ -22,9 +22,18 @@
  * Architecture-specific macros
  */
 #define BYTE	u8
-typedef struct _U16_S { u16 v; } U16_S;
-typedef struct _U32_S { u32 v; } U32_S;
-typedef struct _U64_S { u64 v; } U64_S;
+#if defined(CONFIG_ARM) && defined(ARM_EFFICIENT_UNALIGNED_ACCESS)
+/*
+ * SCTLR.A clear only covers single loads and stores: packing keeps GCC
+ * from merging neighbouring accesses into LDRD/LDM, which still fault.
+ */
+#define LZ4_UNALIGNED	__packed
+#else
+#define LZ4_UNALIGNED
+#endif
+typedef struct _U16_S { u16 v; } LZ4_UNALIGNED U16_S;
+typedef struct _U32_S { u32 v; } LZ4_UNALIGNED U32_S;
+typedef struct _U64_S { u64 v; } LZ4_UNALIGNED U64_S;
 #if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)		\
 	|| defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 6	\
 	&& defined(ARM_EFFICIENT_UNALIGNED_ACCESS)
@@ -78,6 +78,9 @@ static int bdi_debug_stats_show(struct seq_file *m, void *v)
 		   "BdiDirtied:         %10lu kB\n"
 		   "BdiWritten:         %10lu kB\n"
 		   "BdiWriteBandwidth:  %10lu kBps\n"
+		   "BdiThrottled:       %10lu\n"
+		   "BdiThrottleTime:    %10u ms\n"
+		   "BdiThrottleMax:     %10u ms\n"
 		   "b_dirty:            %10lu\n"
 		   "b_io:               %10lu\n"
 		   "b_more_io:          %10lu\n"
@@ -92,6 +95,9 @@ static int bdi_debug_stats_show(struct seq_file *m, void *v)
 		   (unsigned long) K(bdi_stat(bdi, BDI_DIRTIED)),
 		   (unsigned long) K(bdi_stat(bdi, BDI_WRITTEN)),
 		   (unsigned long) K(bdi->write_bandwidth),
+		   (unsigned long) bdi_stat(bdi, BDI_THROTTLED),
+		   jiffies_to_msecs(bdi_stat(bdi, BDI_THROTTLE_TIME)),
+		   jiffies_to_msecs(bdi->throttle_max),
 		   nr_dirty,
 		   nr_io,
 		   nr_more_io,
@@ -208,6 +214,23 @@ static ssize_t max_ratio_store(struct device *dev,
 }
 BDI_SHOW(max_ratio, bdi->max_ratio)
 
+static ssize_t max_delay_ms_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+	unsigned int ms;
+	ssize_t ret;
+
+	ret = kstrtouint(buf, 10, &ms);
+	if (ret < 0)
+		return ret;
+
+	bdi->max_delay = ms;
+
+	return count;
+}
+BDI_SHOW(max_delay_ms, bdi->max_delay)
+
 static ssize_t stable_pages_required_show(struct device *dev,
 					  struct device_attribute *attr,
 					  char *page)
@@ -223,6 +246,7 @@ static struct attribute *bdi_dev_attrs[] = {
 	&dev_attr_read_ahead_kb.attr,
 	&dev_attr_min_ratio.attr,
 	&dev_attr_max_ratio.attr,
+	&dev_attr_max_delay_ms.attr,
 	&dev_attr_stable_pages_required.attr,
 	NULL,
 };
@@ -387,6 +411,8 @@ int bdi_init(struct backing_dev_info *bdi)
 	bdi->min_ratio = 0;
 	bdi->max_ratio = 100;
 	bdi->max_prop_frac = FPROP_FRAC_BASE;
+	bdi->max_delay = 0;
+	bdi->throttle_max = 0;
 	spin_lock_init(&bdi->wb_lock);
 	INIT_LIST_HEAD(&bdi->bdi_list);
 	INIT_LIST_HEAD(&bdi->work_list);
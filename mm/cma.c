@@ -35,13 +35,13 @@
 #include <linux/cma.h>
 #include <linux/highmem.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <trace/events/cma.h>
 
 #include "cma.h"
 
 struct cma cma_areas[MAX_CMA_AREAS];
 unsigned cma_area_count;
-static DEFINE_MUTEX(cma_mutex);
 
 phys_addr_t cma_get_base(const struct cma *cma)
 {
@@ -128,6 +128,7 @@ static int __init cma_activate_area(struct cma *cma)
 	} while (--i);
 
 	mutex_init(&cma->lock);
+	mutex_init(&cma->alloc_mutex);
 
 #ifdef CONFIG_CMA_DEBUGFS
 	INIT_HLIST_HEAD(&cma->mem_head);
@@ -350,6 +351,23 @@ err:
 	return ret;
 }
 
+#ifdef CONFIG_CMA_DEBUGFS
+static void cma_account_alloc(struct cma *cma, ktime_t start,
+			      unsigned int retries)
+{
+	s64 ms = ktime_ms_delta(ktime_get(), start);
+	int bucket = ms > 0 ? ilog2(ms) + 1 : 0;
+
+	mutex_lock(&cma->lock);
+	cma->latency_hist[min(bucket, CMA_HIST_BUCKETS - 1)]++;
+	cma->retry_hist[min_t(unsigned int, retries, CMA_HIST_BUCKETS - 1)]++;
+	mutex_unlock(&cma->lock);
+}
+#else
+static inline void cma_account_alloc(struct cma *cma, ktime_t start,
+				     unsigned int retries) { }
+#endif
+
 /**
  * cma_alloc() - allocate pages from contiguous area
  * @cma:   Contiguous memory region for which the allocation is performed.
@@ -364,6 +382,8 @@ struct page *cma_alloc(struct cma *cma, unsigned int count, unsigned int align)
 	unsigned long mask, offset, pfn, start = 0;
 	unsigned long bitmap_maxno, bitmap_no, bitmap_count;
 	struct page *page = NULL;
+	unsigned int retries = 0;
+	ktime_t start_time;
 	int ret;
 
 	if (!cma || !cma->count)
@@ -379,6 +399,7 @@ struct page *cma_alloc(struct cma *cma, unsigned int count, unsigned int align)
 	offset = cma_bitmap_aligned_offset(cma, align);
 	bitmap_maxno = cma_bitmap_maxno(cma);
 	bitmap_count = cma_bitmap_pages_to_bits(cma, count);
+	start_time = ktime_get();
 
 	for (;;) {
 		mutex_lock(&cma->lock);
@@ -398,9 +419,15 @@ struct page *cma_alloc(struct cma *cma, unsigned int count, unsigned int align)
 		mutex_unlock(&cma->lock);
 
 		pfn = cma->base_pfn + (bitmap_no << cma->order_per_bit);
-		mutex_lock(&cma_mutex);
+		/*
+		 * Areas are aligned to MAX_ORDER_NR_PAGES and pageblocks, so
+		 * the range alloc_contig_range() isolates never reaches into
+		 * another area and a per-area mutex is enough; allocations
+		 * from different areas no longer wait on each other.
+		 */
+		mutex_lock(&cma->alloc_mutex);
 		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
-		mutex_unlock(&cma_mutex);
+		mutex_unlock(&cma->alloc_mutex);
 		if (ret == 0) {
 			page = pfn_to_page(pfn);
 			break;
@@ -414,8 +441,10 @@ struct page *cma_alloc(struct cma *cma, unsigned int count, unsigned int align)
 			 __func__, pfn_to_page(pfn));
 		/* try again with a bit different memory target */
 		start = bitmap_no + mask + 1;
+		retries++;
 	}
 
+	cma_account_alloc(cma, start_time, retries);
 	trace_cma_alloc(page ? pfn : -1UL, page, count, align);
 
 	pr_debug("%s(): returned %p\n", __func__, page);
@@ -1,15 +1,24 @@
 #ifndef __MM_CMA_H__
 #define __MM_CMA_H__
 
+/*
+ * latency_hist[n] counts cma_alloc() calls that took less than 2^n ms and
+ * retry_hist[n] those that hit n busy ranges; the last bucket is open-ended.
+ */
+#define CMA_HIST_BUCKETS	12
+
 struct cma {
 	unsigned long   base_pfn;
 	unsigned long   count;
 	unsigned long   *bitmap;
 	unsigned int order_per_bit; /* Order of pages represented by one bit */
 	struct mutex    lock;
+	struct mutex    alloc_mutex; /* serializes alloc_contig_range() */
 #ifdef CONFIG_CMA_DEBUGFS
 	struct hlist_head mem_head;
 	spinlock_t mem_head_lock;
+	u32 latency_hist[CMA_HIST_BUCKETS];
+	u32 retry_hist[CMA_HIST_BUCKETS];
 #endif
 };
 
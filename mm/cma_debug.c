@@ -184,6 +184,10 @@ static void cma_debugfs_add_one(struct cma *cma, int idx)
 				&cma->order_per_bit, &cma_debugfs_fops);
 	debugfs_create_file("used", S_IRUGO, tmp, cma, &cma_used_fops);
 	debugfs_create_file("maxchunk", S_IRUGO, tmp, cma, &cma_maxchunk_fops);
+	debugfs_create_u32_array("latency_hist", S_IRUGO, tmp,
+				 cma->latency_hist, CMA_HIST_BUCKETS);
+	debugfs_create_u32_array("retry_hist", S_IRUGO, tmp,
+				 cma->retry_hist, CMA_HIST_BUCKETS);
 
 	u32s = DIV_ROUND_UP(cma_bitmap_maxno(cma), BITS_PER_BYTE * sizeof(u32));
 	debugfs_create_u32_array("bitmap", S_IRUGO, tmp, (u32*)cma->bitmap, u32s);
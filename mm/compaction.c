@@ -17,6 +17,8 @@
 #include <linux/balloon_compaction.h>
 #include <linux/page-isolation.h>
 #include <linux/kasan.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #ifdef CONFIG_COMPACTION
@@ -1137,6 +1139,38 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 	return cc->nr_migratepages ? ISOLATE_SUCCESS : ISOLATE_NONE;
 }
 
+/*
+ * A zone's fragmentation score is the share of its free memory that
+ * cannot serve COMPACTION_PROACTIVE_ORDER allocations, weighted by the
+ * zone's size relative to its node so that small zones such as DMA do
+ * not keep kcompactd busy.
+ */
+unsigned int compaction_fragmentation_score(struct zone *zone)
+{
+	unsigned long node_present = zone->zone_pgdat->node_present_pages;
+	unsigned long score;
+
+	if (!node_present)
+		return 0;
+
+	score = zone->present_pages *
+		extfrag_for_order(zone, COMPACTION_PROACTIVE_ORDER);
+	return div64_ul(score, node_present);
+}
+
+/*
+ * Proactive compaction starts when a zone's score is above the high
+ * watermark and stops once it falls to the low one, which is
+ * 100 - sysctl_compaction_proactiveness.
+ */
+static unsigned int fragmentation_score_wmark(struct zone *zone, bool low)
+{
+	unsigned int wmark_low;
+
+	wmark_low = max(100 - sysctl_compaction_proactiveness, 5);
+	return low ? wmark_low : min(wmark_low + 10, 100U);
+}
+
 static int __compact_finished(struct zone *zone, struct compact_control *cc,
 			    const int migratetype)
 {
@@ -1165,6 +1199,15 @@ static int __compact_finished(struct zone *zone, struct compact_control *cc,
 		return COMPACT_COMPLETE;
 	}
 
+	/* kcompactd stops as soon as the zone is below its target */
+	if (cc->proactive_compaction) {
+		if (kthread_should_stop() ||
+		    compaction_fragmentation_score(zone) <=
+		    fragmentation_score_wmark(zone, true))
+			return COMPACT_PARTIAL;
+		return COMPACT_CONTINUE;
+	}
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -1664,6 +1707,141 @@ static void compact_nodes(void)
 		compact_node(nid);
 }
 
+/*
+ * Proactive compaction: kcompactd looks at every zone's fragmentation
+ * score each KCOMPACTD_INTERVAL_MSEC and compacts the zones that are
+ * above their high watermark, so high-order allocations find free blocks
+ * without having to compact directly. 0 disables it.
+ */
+int sysctl_compaction_proactiveness;
+
+#define KCOMPACTD_INTERVAL_MSEC		500
+#define KCOMPACTD_MAX_DEFER_SHIFT	6
+
+static struct task_struct *kcompactd;
+static DECLARE_WAIT_QUEUE_HEAD(kcompactd_wait);
+static bool kcompactd_kick;	/* the sysctl was written */
+
+static void kcompactd_compact_zone(struct zone *zone)
+{
+	struct compact_control cc = {
+		.order = -1,
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+		.proactive_compaction = true,
+		.zone = zone,
+	};
+
+	INIT_LIST_HEAD(&cc.freepages);
+	INIT_LIST_HEAD(&cc.migratepages);
+
+	compact_zone(zone, &cc);
+
+	VM_BUG_ON(!list_empty(&cc.freepages));
+	VM_BUG_ON(!list_empty(&cc.migratepages));
+}
+
+/* Returns true if at least one zone got less fragmented */
+static bool kcompactd_do_work(void)
+{
+	struct zone *zone;
+	bool progress = false;
+
+	lru_add_drain();
+
+	for_each_populated_zone(zone) {
+		unsigned int prev_score, score;
+
+		if (kthread_should_stop())
+			break;
+
+		prev_score = compaction_fragmentation_score(zone);
+		if (prev_score <= fragmentation_score_wmark(zone, false))
+			continue;
+
+		/* Migration needs free pages to move to */
+		if (!zone_watermark_ok(zone, 0, low_wmark_pages(zone), 0, 0))
+			continue;
+
+		kcompactd_compact_zone(zone);
+		count_compact_event(COMPACTPROACTIVE);
+
+		score = compaction_fragmentation_score(zone);
+		if (score < prev_score)
+			progress = true;
+	}
+
+	return progress;
+}
+
+static int kcompactd_fn(void *unused)
+{
+	unsigned int defer_shift = 0;
+
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+
+		if (sysctl_compaction_proactiveness)
+			timeout = msecs_to_jiffies(KCOMPACTD_INTERVAL_MSEC <<
+						   defer_shift);
+
+		wait_event_freezable_timeout(kcompactd_wait,
+				kthread_should_stop() || READ_ONCE(kcompactd_kick),
+				timeout);
+
+		/*
+		 * Cleared before the run, so that a write while it goes on
+		 * gets a run of its own.  A new setting starts without backoff.
+		 */
+		if (xchg(&kcompactd_kick, false))
+			defer_shift = 0;
+
+		if (kthread_should_stop() || !sysctl_compaction_proactiveness)
+			continue;
+
+		/*
+		 * Back off while compaction makes no difference, e.g. when
+		 * the remaining fragmentation comes from unmovable pages.
+		 */
+		if (kcompactd_do_work())
+			defer_shift = 0;
+		else if (defer_shift < KCOMPACTD_MAX_DEFER_SHIFT)
+			defer_shift++;
+	}
+
+	return 0;
+}
+
+int sysctl_compaction_proactiveness_handler(struct ctl_table *table,
+			int write, void __user *buffer, size_t *length,
+			loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (!ret && write) {
+		WRITE_ONCE(kcompactd_kick, true);
+		wake_up_interruptible(&kcompactd_wait);
+	}
+
+	return ret;
+}
+
+static int __init kcompactd_init(void)
+{
+	kcompactd = kthread_run(kcompactd_fn, NULL, "kcompactd");
+	if (IS_ERR(kcompactd)) {
+		pr_err("Failed to start kcompactd\n");
+		kcompactd = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+subsys_initcall(kcompactd_init)
+
 /* The written value is actually unused, all memory is compacted */
 int sysctl_compact_memory;
 
@@ -192,6 +192,7 @@ struct compact_control {
 					 * contention detected during
 					 * compaction
 					 */
+	bool proactive_compaction;	/* kcompactd proactive compaction */
 };
 
 unsigned long
@@ -154,6 +154,7 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @stable_gen: ksm_stable_gen after the last fruitless stable tree search
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -169,6 +170,7 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned int stable_gen;	/* of last failed stable search */
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -223,6 +225,22 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Upper bound for the sleep while batches merge nothing, 0 to disable */
+static unsigned int ksm_thread_max_sleep_millisecs = 2000;
+
+/* Sleep currently used by ksmd, adapted to the merge rate */
+static unsigned int ksm_thread_cur_sleep_millisecs = 20;
+
+/*
+ * Bumped whenever a node becomes reachable in the stable tree: a page
+ * whose checksum did not change since its last fruitless stable tree
+ * search cannot match if the tree has not gained any node since then.
+ */
+static unsigned int ksm_stable_gen = 1;
+
+/* The number of stable tree searches avoided by the checksum */
+static unsigned long ksm_stable_skipped;
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -1223,6 +1241,7 @@ again:
 	DO_NUMA(page_node->nid = nid);
 	rb_link_node(&page_node->node, parent, new);
 	rb_insert_color(&page_node->node, root);
+	ksm_stable_gen++;
 	get_page(page);
 	return page;
 
@@ -1231,6 +1250,7 @@ replace:
 		list_del(&page_node->list);
 		DO_NUMA(page_node->nid = nid);
 		rb_replace_node(&stable_node->node, &page_node->node, root);
+		ksm_stable_gen++;
 		get_page(page);
 	} else {
 		rb_erase(&stable_node->node, root);
@@ -1300,6 +1320,7 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 	DO_NUMA(stable_node->nid = nid);
 	rb_link_node(&stable_node->node, parent, new);
 	rb_insert_color(&stable_node->node, root);
+	ksm_stable_gen++;
 
 	return stable_node;
 }
@@ -1417,8 +1438,8 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	struct rmap_item *tree_rmap_item;
 	struct page *tree_page = NULL;
 	struct stable_node *stable_node;
-	struct page *kpage;
-	unsigned int checksum;
+	struct page *kpage = NULL;
+	unsigned int checksum, stable_gen;
 	int err;
 
 	stable_node = page_stable_node(page);
@@ -1435,11 +1456,27 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			return;
 	}
 
-	/* We first start with searching the page inside the stable tree */
-	kpage = stable_tree_search(page);
-	if (kpage == page && rmap_item->head == stable_node) {
-		put_page(kpage);
-		return;
+	/*
+	 * The checksum is much cheaper than the memcmp_pages() calls of a
+	 * stable tree walk: skip the walk if it already failed for these
+	 * contents and no node was added to the tree since.
+	 */
+	checksum = calc_checksum(page);
+	stable_gen = rmap_item->stable_gen;
+	rmap_item->stable_gen = 0;
+	if (!stable_node && stable_gen && stable_gen == ksm_stable_gen &&
+	    checksum == rmap_item->oldchecksum) {
+		rmap_item->stable_gen = stable_gen;
+		ksm_stable_skipped++;
+	} else {
+		/* Search the page inside the stable tree */
+		kpage = stable_tree_search(page);
+		if (kpage == page && rmap_item->head == stable_node) {
+			put_page(kpage);
+			return;
+		}
+		if (!kpage)
+			rmap_item->stable_gen = ksm_stable_gen;
 	}
 
 	remove_rmap_item_from_tree(rmap_item);
@@ -1465,7 +1502,6 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
@@ -1710,23 +1746,49 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+/*
+ * Back off exponentially while batches merge nothing, so that a set of
+ * processes which has already been merged stops costing a constant
+ * amount of scanning, and return to the base rate as soon as merging
+ * picks up again.  Called with ksm_thread_mutex held.
+ */
+static void ksm_adapt_sleep(unsigned long merged)
+{
+	unsigned int base = ksm_thread_sleep_millisecs;
+	unsigned int max = ksm_thread_max_sleep_millisecs;
+	unsigned int cur = ksm_thread_cur_sleep_millisecs;
+
+	if (merged || max <= base)
+		cur = base;
+	else
+		cur = clamp(cur * 2, base ? base : 1, max);
+
+	ksm_thread_cur_sleep_millisecs = cur;
+}
+
 static int ksm_scan_thread(void *nothing)
 {
+	unsigned long merged;
+
 	set_freezable();
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		wait_while_offlining();
-		if (ksmd_should_run())
+		if (ksmd_should_run()) {
+			merged = ksm_pages_shared + ksm_pages_sharing;
 			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_adapt_sleep(ksm_pages_shared + ksm_pages_sharing -
+					merged);
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
 			schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+			    msecs_to_jiffies(ksm_thread_cur_sleep_millisecs));
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1735,6 +1797,24 @@ static int ksm_scan_thread(void *nothing)
 	return 0;
 }
 
+static bool vma_ksm_compatible(unsigned long vm_flags)
+{
+	/*
+	 * Be somewhat over-protective for now!
+	 */
+	if (vm_flags & (VM_SHARED  | VM_MAYSHARE   |
+			VM_PFNMAP  | VM_IO      | VM_DONTEXPAND |
+			VM_HUGETLB | VM_MIXEDMAP))
+		return false;
+
+#ifdef VM_SAO
+	if (vm_flags & VM_SAO)
+		return false;
+#endif
+
+	return true;
+}
+
 int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 		unsigned long end, int advice, unsigned long *vm_flags)
 {
@@ -1743,19 +1823,10 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 
 	switch (advice) {
 	case MADV_MERGEABLE:
-		/*
-		 * Be somewhat over-protective for now!
-		 */
-		if (*vm_flags & (VM_MERGEABLE | VM_SHARED  | VM_MAYSHARE   |
-				 VM_PFNMAP    | VM_IO      | VM_DONTEXPAND |
-				 VM_HUGETLB | VM_MIXEDMAP))
+		if ((*vm_flags & VM_MERGEABLE) ||
+		    !vma_ksm_compatible(*vm_flags))
 			return 0;		/* just ignore the advice */
 
-#ifdef VM_SAO
-		if (*vm_flags & VM_SAO)
-			return 0;
-#endif
-
 		if (!test_bit(MMF_VM_MERGEABLE, &mm->flags)) {
 			err = __ksm_enter(mm);
 			if (err)
@@ -1782,6 +1853,76 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 	return 0;
 }
 
+/*
+ * Process wide opt-in, PR_SET_MEMORY_MERGE: every compatible mapping of
+ * the mm, present and future, is treated as if MADV_MERGEABLE had been
+ * applied to it.  The setting is kept across fork and exec so that it
+ * can be set once by whatever launches the workload.  The caller holds
+ * mmap_sem for writing.
+ */
+int ksm_enable_merge_any(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+	int err;
+
+	if (test_bit(MMF_VM_MERGE_ANY, &mm->flags))
+		return 0;
+
+	if (!test_bit(MMF_VM_MERGEABLE, &mm->flags)) {
+		err = __ksm_enter(mm);
+		if (err)
+			return err;
+	}
+
+	set_bit(MMF_VM_MERGE_ANY, &mm->flags);
+	for (vma = mm->mmap; vma; vma = vma->vm_next)
+		if (vma_ksm_compatible(vma->vm_flags))
+			vma->vm_flags |= VM_MERGEABLE;
+
+	return 0;
+}
+
+int ksm_disable_merge_any(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+	int err;
+
+	if (!test_bit(MMF_VM_MERGE_ANY, &mm->flags))
+		return 0;
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (!(vma->vm_flags & VM_MERGEABLE))
+			continue;
+		if (vma->anon_vma) {
+			err = unmerge_ksm_pages(vma, vma->vm_start,
+						vma->vm_end);
+			if (err)
+				return err;
+		}
+		vma->vm_flags &= ~VM_MERGEABLE;
+	}
+
+	clear_bit(MMF_VM_MERGE_ANY, &mm->flags);
+	return 0;
+}
+
+/*
+ * VM flags for a new mapping of an mm that opted in with
+ * PR_SET_MEMORY_MERGE.  Applied before vma_merge() is tried, so that
+ * the new range can still be merged with its mergeable neighbours.
+ */
+unsigned long __ksm_vma_flags(struct mm_struct *mm, unsigned long vm_flags)
+{
+	if (!vma_ksm_compatible(vm_flags))
+		return vm_flags;
+
+	/* an exec'ed mm inherits the opt-in but is not registered yet */
+	if (!test_bit(MMF_VM_MERGEABLE, &mm->flags) && __ksm_enter(mm))
+		return vm_flags;
+
+	return vm_flags | VM_MERGEABLE;
+}
+
 int __ksm_enter(struct mm_struct *mm)
 {
 	struct mm_slot *mm_slot;
@@ -1815,6 +1956,9 @@ int __ksm_enter(struct mm_struct *mm)
 	set_bit(MMF_VM_MERGEABLE, &mm->flags);
 	atomic_inc(&mm->mm_count);
 
+	/* new candidates: scan at the base rate again */
+	ksm_thread_cur_sleep_millisecs = ksm_thread_sleep_millisecs;
+
 	if (needs_wakeup)
 		wake_up_interruptible(&ksm_thread_wait);
 
@@ -2099,11 +2243,36 @@ static ssize_t sleep_millisecs_store(struct kobject *kobj,
 		return -EINVAL;
 
 	ksm_thread_sleep_millisecs = msecs;
+	ksm_thread_cur_sleep_millisecs = msecs;
 
 	return count;
 }
 KSM_ATTR(sleep_millisecs);
 
+static ssize_t max_sleep_millisecs_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_thread_max_sleep_millisecs);
+}
+
+static ssize_t max_sleep_millisecs_store(struct kobject *kobj,
+					 struct kobj_attribute *attr,
+					 const char *buf, size_t count)
+{
+	unsigned long msecs;
+	int err;
+
+	err = kstrtoul(buf, 10, &msecs);
+	if (err || msecs > UINT_MAX)
+		return -EINVAL;
+
+	ksm_thread_max_sleep_millisecs = msecs;
+	ksm_thread_cur_sleep_millisecs = ksm_thread_sleep_millisecs;
+
+	return count;
+}
+KSM_ATTR(max_sleep_millisecs);
+
 static ssize_t pages_to_scan_show(struct kobject *kobj,
 				  struct kobj_attribute *attr, char *buf)
 {
@@ -2278,8 +2447,16 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t stable_skipped_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_stable_skipped);
+}
+KSM_ATTR_RO(stable_skipped);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
+	&max_sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
@@ -2287,6 +2464,7 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&stable_skipped_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
 #endif
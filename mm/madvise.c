@@ -400,7 +400,7 @@ madvise_behavior_valid(int behavior)
 	case MADV_MERGEABLE:
 	case MADV_UNMERGEABLE:
 #endif
-#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) || defined(CONFIG_HAVE_ARCH_LARGE_PTE)
 	case MADV_HUGEPAGE:
 	case MADV_NOHUGEPAGE:
 #endif
@@ -56,6 +56,7 @@
 #include <linux/fs.h>
 #include <linux/seq_file.h>
 #include <linux/vmpressure.h>
+#include <linux/memstall.h>
 #include <linux/mm_inline.h>
 #include <linux/swap_cgroup.h>
 #include <linux/cpu.h>
@@ -99,6 +100,8 @@ static const char * const mem_cgroup_events_names[] = {
 	"pgpgout",
 	"pgfault",
 	"pgmajfault",
+	"workingset_refault",
+	"workingset_activate",
 };
 
 static const char * const mem_cgroup_lru_names[] = {
@@ -130,6 +133,10 @@ struct mem_cgroup_stat_cpu {
 	unsigned long events[MEMCG_NR_EVENTS];
 	unsigned long nr_page_events;
 	unsigned long targets[MEM_CGROUP_NTARGETS];
+#ifdef CONFIG_MEMSTALL
+	u64 stall_time[NR_MEMSTALL_ITEMS];
+	unsigned long stall_count[NR_MEMSTALL_ITEMS];
+#endif
 };
 
 struct reclaim_iter {
@@ -450,7 +457,7 @@ static inline bool mem_cgroup_is_root(struct mem_cgroup *memcg)
  */
 #define MEM_CGROUP_ID_MAX	USHRT_MAX
 
-static inline unsigned short mem_cgroup_id(struct mem_cgroup *memcg)
+unsigned short mem_cgroup_id(struct mem_cgroup *memcg)
 {
 	return memcg->css.id;
 }
@@ -461,7 +468,7 @@ static inline unsigned short mem_cgroup_id(struct mem_cgroup *memcg)
  * css_tryget_online() if the mem_cgroup is used for charging. (dropping
  * refcnt from swap can be called against removed memcg.)
  */
-static inline struct mem_cgroup *mem_cgroup_from_id(unsigned short id)
+struct mem_cgroup *mem_cgroup_from_id(unsigned short id)
 {
 	struct cgroup_subsys_state *css;
 
@@ -2226,6 +2233,7 @@ static int try_charge(struct mem_cgroup *memcg, gfp_t gfp_mask,
 	bool may_swap = true;
 	bool drained = false;
 	int ret = 0;
+	u64 stall;
 
 	if (mem_cgroup_is_root(memcg))
 		goto done;
@@ -2269,8 +2277,10 @@ retry:
 
 	mem_cgroup_events(mem_over_limit, MEMCG_MAX, 1);
 
+	stall = memstall_begin();
 	nr_reclaimed = try_to_free_mem_cgroup_pages(mem_over_limit, nr_pages,
 						    gfp_mask, may_swap);
+	memstall_end(mem_over_limit, MEMSTALL_RECLAIM, stall);
 
 	if (mem_cgroup_margin(mem_over_limit) >= nr_pages)
 		goto retry;
@@ -2333,7 +2343,9 @@ done_restock:
 		if (page_counter_read(&memcg->memory) <= memcg->high)
 			continue;
 		mem_cgroup_events(memcg, MEMCG_HIGH, 1);
+		stall = memstall_begin();
 		try_to_free_mem_cgroup_pages(memcg, nr_pages, gfp_mask, true);
+		memstall_end(memcg, MEMSTALL_RECLAIM, stall);
 	} while ((memcg = parent_mem_cgroup(memcg)));
 done:
 	return ret;
@@ -3449,6 +3461,53 @@ static int memcg_numa_stat_show(struct seq_file *m, void *v)
 }
 #endif /* CONFIG_NUMA */
 
+#ifdef CONFIG_MEMSTALL
+void mem_cgroup_account_stall(struct mem_cgroup *memcg,
+			      enum memstall_item item, u64 delta)
+{
+	if (mem_cgroup_disabled())
+		return;
+
+	rcu_read_lock();
+	if (!memcg)
+		memcg = mem_cgroup_from_task(current);
+	if (memcg) {
+		this_cpu_inc(memcg->stat->stall_count[item]);
+		this_cpu_add(memcg->stat->stall_time[item], delta);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Stalls are reported for the whole subtree, so a cgroup shows the
+ * pressure felt by all of its tasks. The counters only ever grow and
+ * are not drained on cpu hotplug, hence the walk over possible cpus.
+ */
+static int memcg_stall_show(struct seq_file *m, void *v)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(seq_css(m));
+	struct mem_cgroup *mi;
+	int i, cpu;
+
+	for (i = 0; i < NR_MEMSTALL_ITEMS; i++) {
+		unsigned long count = 0;
+		u64 time = 0;
+
+		for_each_mem_cgroup_tree(mi, memcg) {
+			for_each_possible_cpu(cpu) {
+				count += per_cpu(mi->stat->stall_count[i], cpu);
+				time += per_cpu(mi->stat->stall_time[i], cpu);
+			}
+		}
+
+		seq_printf(m, "%s stalls=%lu total=%llu\n", memstall_names[i],
+			   count, div_u64(time, NSEC_PER_USEC));
+	}
+
+	return 0;
+}
+#endif /* CONFIG_MEMSTALL */
+
 static int memcg_stat_show(struct seq_file *m, void *v)
 {
 	struct mem_cgroup *memcg = mem_cgroup_from_css(seq_css(m));
@@ -4253,6 +4312,12 @@ static struct cftype mem_cgroup_legacy_files[] = {
 		.name = "stat",
 		.seq_show = memcg_stat_show,
 	},
+#ifdef CONFIG_MEMSTALL
+	{
+		.name = "stall",
+		.seq_show = memcg_stall_show,
+	},
+#endif
 	{
 		.name = "force_empty",
 		.write = mem_cgroup_force_empty_write,
@@ -5373,6 +5438,12 @@ static struct cftype memory_files[] = {
 		.flags = CFTYPE_NOT_ON_ROOT,
 		.seq_show = memory_events_show,
 	},
+#ifdef CONFIG_MEMSTALL
+	{
+		.name = "stall",
+		.seq_show = memcg_stall_show,
+	},
+#endif
 	{ }	/* terminate */
 };
 
@@ -2076,7 +2076,8 @@ static int wp_page_copy(struct mm_struct *mm, struct vm_area_struct *vma,
 		if (!new_page)
 			goto oom;
 	} else {
-		new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, address);
+		new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE | __GFP_CMA,
+					  vma, address);
 		if (!new_page)
 			goto oom;
 		cow_user_page(new_page, old_page, address, vma);
@@ -2470,10 +2471,11 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		goto out;
 	}
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
-	page = lookup_swap_cache(entry);
+	page = lookup_swap_cache(entry, vma, address);
 	if (!page) {
 		page = swapin_readahead(entry,
-					GFP_HIGHUSER_MOVABLE, vma, address);
+					GFP_HIGHUSER_MOVABLE | __GFP_CMA,
+					vma, address);
 		if (!page) {
 			/*
 			 * Back out if somebody else faulted in this pte
@@ -2653,6 +2655,123 @@ static inline int check_stack_guard_page(struct vm_area_struct *vma, unsigned lo
 	return 0;
 }
 
+#ifdef CONFIG_HAVE_ARCH_LARGE_PTE
+int hugepage_madvise(struct vm_area_struct *vma,
+		     unsigned long *vm_flags, int advice)
+{
+	switch (advice) {
+	case MADV_HUGEPAGE:
+		if (*vm_flags & (VM_HUGEPAGE | VM_SPECIAL | VM_HUGETLB))
+			return -EINVAL;
+		*vm_flags &= ~VM_NOHUGEPAGE;
+		*vm_flags |= VM_HUGEPAGE;
+		break;
+	case MADV_NOHUGEPAGE:
+		if (*vm_flags & (VM_NOHUGEPAGE | VM_SPECIAL | VM_HUGETLB))
+			return -EINVAL;
+		*vm_flags &= ~VM_HUGEPAGE;
+		*vm_flags |= VM_NOHUGEPAGE;
+		break;
+	}
+
+	return 0;
+}
+
+/*
+ * Populate a whole naturally aligned LARGE_PTE_NR block of a
+ * MADV_HUGEPAGE region with physically contiguous pages, so the
+ * architecture can map it with a single TLB entry.  The block is split
+ * into order-0 pages right away and the rest of the VM treats them as
+ * ordinary anonymous pages.  Returns -EAGAIN when the block cannot be
+ * used and the caller should fall back to a single page.
+ */
+static int do_anonymous_large_page(struct mm_struct *mm,
+		struct vm_area_struct *vma, unsigned long address, pmd_t *pmd)
+{
+	unsigned long start = address & LARGE_PTE_MASK;
+	struct mem_cgroup *memcg[LARGE_PTE_NR];
+	struct page *page;
+	spinlock_t *ptl;
+	pte_t *pte;
+	int i, nr;
+
+	if (!(vma->vm_flags & VM_HUGEPAGE) || (vma->vm_flags & VM_LOCKED))
+		return -EAGAIN;
+	if (start < vma->vm_start || start + LARGE_PTE_SIZE > vma->vm_end)
+		return -EAGAIN;
+
+	pte = pte_offset_map(pmd, start);
+	for (i = 0; i < LARGE_PTE_NR; i++)
+		if (!pte_none(pte[i]))
+			break;
+	pte_unmap(pte);
+	if (i < LARGE_PTE_NR)
+		return -EAGAIN;
+
+	page = alloc_pages_vma(GFP_HIGHUSER_MOVABLE | __GFP_CMA |
+			       __GFP_NORETRY | __GFP_NOWARN,
+			       LARGE_PTE_ORDER, vma, start, numa_node_id(),
+			       false);
+	if (!page) {
+		count_vm_event(LARGE_PTE_FAULT_FALLBACK);
+		return -EAGAIN;
+	}
+	split_page(page, LARGE_PTE_ORDER);
+
+	for (nr = 0; nr < LARGE_PTE_NR; nr++) {
+		if (mem_cgroup_try_charge(page + nr, mm, GFP_KERNEL,
+					  &memcg[nr]))
+			goto release;
+		clear_user_highpage(page + nr, start + nr * PAGE_SIZE);
+		__SetPageUptodate(page + nr);
+	}
+
+	pte = pte_offset_map_lock(mm, pmd, start, &ptl);
+	for (i = 0; i < LARGE_PTE_NR; i++) {
+		if (!pte_none(pte[i])) {
+			pte_unmap_unlock(pte, ptl);
+			goto release;
+		}
+	}
+
+	for (i = 0; i < LARGE_PTE_NR; i++) {
+		unsigned long addr = start + i * PAGE_SIZE;
+		pte_t entry = mk_pte(page + i, vma->vm_page_prot);
+
+		if (vma->vm_flags & VM_WRITE)
+			entry = pte_mkwrite(pte_mkdirty(entry));
+
+		inc_mm_counter_fast(mm, MM_ANONPAGES);
+		page_add_new_anon_rmap(page + i, vma, addr);
+		mem_cgroup_commit_charge(page + i, memcg[i], false);
+		lru_cache_add_active_or_unevictable(page + i, vma);
+		set_pte_at(mm, addr, pte + i, entry);
+	}
+
+	/* No need to invalidate - it was non-present before */
+	i = (address - start) >> PAGE_SHIFT;
+	update_mmu_cache(vma, address, pte + i);
+	pte_unmap_unlock(pte, ptl);
+	count_vm_event(LARGE_PTE_FAULT_ALLOC);
+	return 0;
+
+release:
+	for (i = 0; i < LARGE_PTE_NR; i++) {
+		if (i < nr)
+			mem_cgroup_cancel_charge(page + i, memcg[i]);
+		page_cache_release(page + i);
+	}
+	count_vm_event(LARGE_PTE_FAULT_FALLBACK);
+	return -EAGAIN;
+}
+#else
+static inline int do_anonymous_large_page(struct mm_struct *mm,
+		struct vm_area_struct *vma, unsigned long address, pmd_t *pmd)
+{
+	return -EAGAIN;
+}
+#endif
+
 /*
  * We enter with non-exclusive mmap_sem (to exclude vma changes,
  * but allow concurrent faults), and pte mapped but not yet locked.
@@ -2690,6 +2809,8 @@ static int do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	/* Allocate our own private page. */
 	if (unlikely(anon_vma_prepare(vma)))
 		goto oom;
+	if (!do_anonymous_large_page(mm, vma, address, pmd))
+		return 0;
 	page = alloc_zeroed_user_highpage_movable(vma, address);
 	if (!page)
 		goto oom;
@@ -2971,7 +3092,8 @@ static int do_cow_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 	if (unlikely(anon_vma_prepare(vma)))
 		return VM_FAULT_OOM;
 
-	new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, address);
+	new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE | __GFP_CMA,
+				  vma, address);
 	if (!new_page)
 		return VM_FAULT_OOM;
 
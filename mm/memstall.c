@@ -0,0 +1,92 @@
+/*
+ * Memory stall accounting
+ *
+ * Tracks the number of times and the time tasks spend in direct reclaim,
+ * memcg limit reclaim and direct compaction, plus the number of working
+ * set refaults. The counters only ever grow; a watchdog samples them and
+ * looks at the rate, e.g. milliseconds stalled per second, to detect
+ * building memory pressure before latency suffers.
+ *
+ * The hooks cost a local_clock() read on entry and exit of the slow path
+ * and a few per-cpu increments, nothing on the allocation fast path.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+#include <linux/memstall.h>
+
+struct memstall_cpu {
+	u64 time[NR_MEMSTALL_ITEMS];
+	unsigned long count[NR_MEMSTALL_ITEMS];
+};
+
+static DEFINE_PER_CPU(struct memstall_cpu, memstall_cpu);
+
+const char * const memstall_names[NR_MEMSTALL_ITEMS] = {
+	"reclaim",
+	"compact",
+	"thrash",
+};
+
+/**
+ * memstall_account - account a memory stall
+ * @memcg: memory cgroup the stall is charged to, NULL for current's
+ * @item: cause of the stall
+ * @delta: time stalled in nanoseconds, 0 for events without a duration
+ */
+void memstall_account(struct mem_cgroup *memcg,
+		      enum memstall_item item, u64 delta)
+{
+	this_cpu_inc(memstall_cpu.count[item]);
+	this_cpu_add(memstall_cpu.time[item], delta);
+
+	mem_cgroup_account_stall(memcg, item, delta);
+}
+
+static int memstall_show(struct seq_file *m, void *v)
+{
+	int i, cpu;
+
+	for (i = 0; i < NR_MEMSTALL_ITEMS; i++) {
+		unsigned long count = 0;
+		u64 time = 0;
+
+		for_each_possible_cpu(cpu) {
+			struct memstall_cpu *ms = &per_cpu(memstall_cpu, cpu);
+
+			count += ms->count[i];
+			time += ms->time[i];
+		}
+
+		seq_printf(m, "%s stalls=%lu total=%llu\n", memstall_names[i],
+			   count, div_u64(time, NSEC_PER_USEC));
+	}
+
+	return 0;
+}
+
+static int memstall_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, memstall_show, NULL);
+}
+
+static const struct file_operations memstall_fops = {
+	.open		= memstall_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init memstall_init(void)
+{
+	proc_create("memstall", 0444, NULL, &memstall_fops);
+	return 0;
+}
+module_init(memstall_init);
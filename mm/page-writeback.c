@@ -1203,6 +1203,10 @@ static unsigned long bdi_max_pause(struct backing_dev_info *bdi,
 	t = bdi_dirty / (1 + bw / roundup_pow_of_two(1 + HZ / 8));
 	t++;
 
+	/* A writer delay target also bounds every single sleep */
+	if (bdi->max_delay)
+		t = min_t(unsigned long, t, msecs_to_jiffies(bdi->max_delay));
+
 	return min_t(unsigned long, t, MAX_PAUSE);
 }
 
@@ -1351,6 +1355,7 @@ static void balance_dirty_pages(struct address_space *mapping,
 	long min_pause;
 	int nr_dirtied_pause;
 	bool dirty_exceeded = false;
+	bool throttled = false;
 	unsigned long task_ratelimit;
 	unsigned long dirty_ratelimit;
 	unsigned long pos_ratio;
@@ -1494,6 +1499,7 @@ pause:
 					  start_time);
 		__set_current_state(TASK_KILLABLE);
 		io_schedule_timeout(pause);
+		throttled = true;
 
 		current->dirty_paused_when = now + pause;
 		current->nr_dirtied = 0;
@@ -1519,10 +1525,33 @@ pause:
 		if (bdi_dirty <= bdi_stat_error(bdi))
 			break;
 
+		/*
+		 * Flash devices can stop writing back for seconds while they
+		 * garbage collect, which makes the bandwidth estimate collapse.
+		 * With a delay target let the writer go once it has waited
+		 * that long, overrunning the dirty limit by at most 1/8.
+		 */
+		if (bdi->max_delay &&
+		    jiffies - start_time >= msecs_to_jiffies(bdi->max_delay) &&
+		    nr_dirty <= dirty_thresh + dirty_thresh / 8)
+			break;
+
 		if (fatal_signal_pending(current))
 			break;
 	}
 
+	if (throttled) {
+		unsigned long delay = jiffies - start_time;
+		unsigned long flags;
+
+		local_irq_save(flags);
+		__inc_bdi_stat(bdi, BDI_THROTTLED);
+		__add_bdi_stat(bdi, BDI_THROTTLE_TIME, delay);
+		local_irq_restore(flags);
+		if (delay > ACCESS_ONCE(bdi->throttle_max))
+			bdi->throttle_max = delay;
+	}
+
 	if (!dirty_exceeded && bdi->dirty_exceeded)
 		bdi->dirty_exceeded = 0;
 
@@ -61,6 +61,7 @@
 #include <linux/hugetlb.h>
 #include <linux/sched/rt.h>
 #include <linux/page_owner.h>
+#include <linux/memstall.h>
 
 #include <asm/sections.h>
 #include <asm/tlbflush.h>
@@ -209,6 +210,8 @@ static char * const zone_names[MAX_NR_ZONES] = {
 
 int min_free_kbytes = 1024;
 int user_min_free_kbytes = -1;
+int watermark_scale_factor = 10;
+int watermark_boost_factor __read_mostly = 15000;
 
 static unsigned long __meminitdata nr_kernel_pages;
 static unsigned long __meminitdata nr_all_pages;
@@ -744,6 +747,86 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	spin_unlock(&zone->lock);
 }
 
+/*
+ * Frees all pages on the high-order PCP lists. Unlike the order-0 lists
+ * these are small, so they are always emptied as a whole.
+ */
+static void free_pcppages_high_order(struct zone *zone,
+					struct per_cpu_pages *pcp)
+{
+	unsigned int order;
+	int migratetype;
+
+	spin_lock(&zone->lock);
+	for (order = 1; order <= PCP_MAX_ORDER; order++) {
+		for (migratetype = 0; migratetype < MIGRATE_PCPTYPES;
+		     migratetype++) {
+			struct list_head *list;
+
+			list = &pcp->hlists[order - 1][migratetype];
+			while (!list_empty(list)) {
+				struct page *page;
+				int mt;
+
+				page = list_entry(list->prev, struct page, lru);
+				list_del(&page->lru);
+				mt = get_freepage_migratetype(page);
+				if (unlikely(has_isolate_pageblock(zone)))
+					mt = get_pageblock_migratetype(page);
+				__free_one_page(page, page_to_pfn(page), zone,
+						order, mt);
+			}
+		}
+	}
+	pcp->hcount = 0;
+	spin_unlock(&zone->lock);
+}
+
+/*
+ * The high-order PCP lists hold at most a quarter of pcp->high pages and
+ * are refilled a few blocks at a time, fewer for the larger orders.
+ */
+static inline int pcp_high_order_limit(struct per_cpu_pages *pcp)
+{
+	return pcp->high >> 2;
+}
+
+static inline int pcp_high_order_batch(struct per_cpu_pages *pcp,
+				       unsigned int order)
+{
+	return max((pcp->batch >> order) >> 1, 1);
+}
+
+/*
+ * Try to keep a freed order 1..PCP_MAX_ORDER page on this cpu's lists.
+ * Must be called with interrupts disabled.
+ */
+static bool free_pcp_high_order(struct zone *zone, struct page *page,
+				unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp;
+
+	if (!order || order > PCP_MAX_ORDER)
+		return false;
+
+	/* Same rules as free_hot_cold_page() */
+	if (migratetype >= MIGRATE_PCPTYPES) {
+		if (is_migrate_isolate(migratetype) ||
+		    (IS_ENABLED(CONFIG_CMA_AVOID_PAGECACHE) &&
+		     is_migrate_cma(migratetype)))
+			return false;
+		migratetype = MIGRATE_MOVABLE;
+	}
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	if (pcp->hcount + (1 << order) > pcp_high_order_limit(pcp))
+		return false;
+
+	list_add(&page->lru, &pcp->hlists[order - 1][migratetype]);
+	pcp->hcount += 1 << order;
+	return true;
+}
+
 static void free_one_page(struct zone *zone,
 				struct page *page, unsigned long pfn,
 				unsigned int order,
@@ -828,7 +911,8 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 	local_irq_save(flags);
 	__count_vm_events(PGFREE, 1 << order);
 	set_freepage_migratetype(page, migratetype);
-	free_one_page(page_zone(page), page, pfn, order, migratetype);
+	if (!free_pcp_high_order(page_zone(page), page, order, migratetype))
+		free_one_page(page_zone(page), page, pfn, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -1056,6 +1140,18 @@ static inline struct page *__rmqueue_cma_fallback(struct zone *zone,
 					unsigned int order) { return NULL; }
 #endif
 
+/*
+ * With CONFIG_CMA_AVOID_PAGECACHE only __GFP_CMA allocations may use CMA
+ * pageblocks, and the per-cpu lists never hold CMA pages so that other
+ * movable allocations cannot pick them up from there.
+ */
+static inline bool gfp_allows_cma(gfp_t gfp_mask)
+{
+	if (IS_ENABLED(CONFIG_CMA_AVOID_PAGECACHE))
+		return !!(gfp_mask & __GFP_CMA);
+	return true;
+}
+
 /*
  * Move the free pages in a range to the free lists of the requested type.
  * Note that start_page and end_pages are not aligned on a pageblock
@@ -1170,6 +1266,28 @@ static bool can_steal_fallback(unsigned int order, int start_mt)
 	return false;
 }
 
+/*
+ * Raise the zone's kswapd target by a pageblock, up to
+ * watermark_boost_factor per ten thousand of the high watermark.
+ * Returns true if the zone got boosted.
+ */
+static bool boost_watermark(struct zone *zone)
+{
+	unsigned long max_boost;
+
+	if (!watermark_boost_factor)
+		return false;
+
+	max_boost = mult_frac(zone->watermark[WMARK_HIGH],
+			watermark_boost_factor, 10000);
+	max_boost = max(pageblock_nr_pages, max_boost);
+
+	zone->watermark_boost = min(zone->watermark_boost + pageblock_nr_pages,
+			max_boost);
+
+	return true;
+}
+
 /*
  * This function implements actual steal behaviour. If order is large enough,
  * we can steal whole pageblock. If not, we first move freepages in this
@@ -1189,6 +1307,14 @@ static void steal_suitable_fallback(struct zone *zone, struct page *page,
 		return;
 	}
 
+	/*
+	 * The pageblock now mixes migratetypes. Have kswapd reclaim some
+	 * extra pages so future allocations find free pages of their own
+	 * type instead of fragmenting more pageblocks.
+	 */
+	if (boost_watermark(zone))
+		set_bit(ZONE_BOOSTED_WATERMARK, &zone->flags);
+
 	pages = move_freepages_block(zone, page, start_type);
 
 	/* Claim the whole block if over half of it is free */
@@ -1290,7 +1416,7 @@ __rmqueue_fallback(struct zone *zone, unsigned int order, int start_migratetype)
  * Call me with the zone->lock already held.
  */
 static struct page *__rmqueue(struct zone *zone, unsigned int order,
-						int migratetype)
+						int migratetype, bool cma)
 {
 	struct page *page;
 
@@ -1298,7 +1424,7 @@ retry_reserve:
 	page = __rmqueue_smallest(zone, order, migratetype);
 
 	if (unlikely(!page) && migratetype != MIGRATE_RESERVE) {
-		if (migratetype == MIGRATE_MOVABLE)
+		if (migratetype == MIGRATE_MOVABLE && cma)
 			page = __rmqueue_cma_fallback(zone, order);
 
 		if (!page)
@@ -1332,7 +1458,8 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 
 	spin_lock(&zone->lock);
 	for (i = 0; i < count; ++i) {
-		struct page *page = __rmqueue(zone, order, migratetype);
+		struct page *page = __rmqueue(zone, order, migratetype,
+				!IS_ENABLED(CONFIG_CMA_AVOID_PAGECACHE));
 		if (unlikely(page == NULL))
 			break;
 
@@ -1405,6 +1532,8 @@ static void drain_pages_zone(unsigned int cpu, struct zone *zone)
 		free_pcppages_bulk(zone, pcp->count, pcp);
 		pcp->count = 0;
 	}
+	if (pcp->hcount)
+		free_pcppages_high_order(zone, pcp);
 	local_irq_restore(flags);
 }
 
@@ -1474,12 +1603,12 @@ void drain_all_pages(struct zone *zone)
 
 		if (zone) {
 			pcp = per_cpu_ptr(zone->pageset, cpu);
-			if (pcp->pcp.count)
+			if (pcp->pcp.count || pcp->pcp.hcount)
 				has_pcps = true;
 		} else {
 			for_each_populated_zone(z) {
 				pcp = per_cpu_ptr(z->pageset, cpu);
-				if (pcp->pcp.count) {
+				if (pcp->pcp.count || pcp->pcp.hcount) {
 					has_pcps = true;
 					break;
 				}
@@ -1559,7 +1688,9 @@ void free_hot_cold_page(struct page *page, bool cold)
 	 * excessively into the page allocator
 	 */
 	if (migratetype >= MIGRATE_PCPTYPES) {
-		if (unlikely(is_migrate_isolate(migratetype))) {
+		if (unlikely(is_migrate_isolate(migratetype)) ||
+		    (IS_ENABLED(CONFIG_CMA_AVOID_PAGECACHE) &&
+		     is_migrate_cma(migratetype))) {
 			free_one_page(zone, page, pfn, 0, migratetype);
 			goto out;
 		}
@@ -1695,7 +1826,36 @@ int split_free_page(struct page *page)
 }
 
 /*
- * Allocate a page from the given zone. Use pcplists for order-0 allocations.
+ * Take an order 1..PCP_MAX_ORDER page from this cpu's lists, refilling them
+ * from the buddy lists when empty. Must be called with interrupts disabled.
+ */
+static struct page *rmqueue_pcp_high_order(struct zone *zone,
+					unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	struct list_head *list = &pcp->hlists[order - 1][migratetype];
+	struct page *page;
+
+	if (list_empty(list)) {
+		__count_vm_event(PCP_HIGH_ORDER_MISS);
+		pcp->hcount += rmqueue_bulk(zone, order,
+				pcp_high_order_batch(pcp, order), list,
+				migratetype, false) << order;
+		if (unlikely(list_empty(list)))
+			return NULL;
+	} else {
+		__count_vm_event(PCP_HIGH_ORDER_HIT);
+	}
+
+	page = list_entry(list->next, struct page, lru);
+	list_del(&page->lru);
+	pcp->hcount -= 1 << order;
+	return page;
+}
+
+/*
+ * Allocate a page from the given zone. Use pcplists for orders up to
+ * PCP_MAX_ORDER.
  */
 static inline
 struct page *buffered_rmqueue(struct zone *preferred_zone,
@@ -1703,8 +1863,9 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 			gfp_t gfp_flags, int migratetype)
 {
 	unsigned long flags;
-	struct page *page;
+	struct page *page = NULL;
 	bool cold = ((gfp_flags & __GFP_COLD) != 0);
+	bool cma = gfp_allows_cma(gfp_flags);
 
 	if (likely(order == 0)) {
 		struct per_cpu_pages *pcp;
@@ -1717,17 +1878,32 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 			pcp->count += rmqueue_bulk(zone, 0,
 					pcp->batch, list,
 					migratetype, cold);
-			if (unlikely(list_empty(list)))
-				goto failed;
+			if (unlikely(list_empty(list))) {
+				if (!IS_ENABLED(CONFIG_CMA_AVOID_PAGECACHE) ||
+				    !cma)
+					goto failed;
+				/* CMA pages bypass the per-cpu lists */
+				spin_lock(&zone->lock);
+				page = __rmqueue(zone, 0, migratetype, true);
+				spin_unlock(&zone->lock);
+				if (!page)
+					goto failed;
+				__mod_zone_freepage_state(zone, -1,
+					get_freepage_migratetype(page));
+			}
 		}
 
-		if (cold)
-			page = list_entry(list->prev, struct page, lru);
-		else
-			page = list_entry(list->next, struct page, lru);
+		if (!page) {
+			if (cold)
+				page = list_entry(list->prev, struct page,
+						  lru);
+			else
+				page = list_entry(list->next, struct page,
+						  lru);
 
-		list_del(&page->lru);
-		pcp->count--;
+			list_del(&page->lru);
+			pcp->count--;
+		}
 	} else {
 		if (unlikely(gfp_flags & __GFP_NOFAIL)) {
 			/*
@@ -1742,13 +1918,18 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
-		page = __rmqueue(zone, order, migratetype);
-		spin_unlock(&zone->lock);
-		if (!page)
-			goto failed;
-		__mod_zone_freepage_state(zone, -(1 << order),
-					  get_freepage_migratetype(page));
+		local_irq_save(flags);
+		if (order <= PCP_MAX_ORDER)
+			page = rmqueue_pcp_high_order(zone, order, migratetype);
+		if (!page) {
+			spin_lock(&zone->lock);
+			page = __rmqueue(zone, order, migratetype, cma);
+			spin_unlock(&zone->lock);
+			if (!page)
+				goto failed;
+			__mod_zone_freepage_state(zone, -(1 << order),
+					get_freepage_migratetype(page));
+		}
 	}
 
 	__mod_zone_page_state(zone, NR_ALLOC_BATCH, -(1 << order));
@@ -1760,6 +1941,12 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 	zone_statistics(preferred_zone, zone, gfp_flags);
 	local_irq_restore(flags);
 
+	/* Separate test+clear to avoid unnecessary atomics */
+	if (test_bit(ZONE_BOOSTED_WATERMARK, &zone->flags)) {
+		clear_bit(ZONE_BOOSTED_WATERMARK, &zone->flags);
+		wakeup_kswapd(zone, 0, zone_idx(zone));
+	}
+
 	VM_BUG_ON_PAGE(bad_range(zone, page), page);
 	return page;
 
@@ -2438,14 +2625,17 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 {
 	unsigned long compact_result;
 	struct page *page;
+	u64 stall;
 
 	if (!order)
 		return NULL;
 
+	stall = memstall_begin();
 	current->flags |= PF_MEMALLOC;
 	compact_result = try_to_compact_pages(gfp_mask, order, alloc_flags, ac,
 						mode, contended_compaction);
 	current->flags &= ~PF_MEMALLOC;
+	memstall_end(NULL, MEMSTALL_COMPACT, stall);
 
 	switch (compact_result) {
 	case COMPACT_DEFERRED:
@@ -2503,11 +2693,13 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order,
 {
 	struct reclaim_state reclaim_state;
 	int progress;
+	u64 stall;
 
 	cond_resched();
 
 	/* We now go into synchronous reclaim */
 	cpuset_memory_pressure_bump();
+	stall = memstall_begin();
 	current->flags |= PF_MEMALLOC;
 	lockdep_set_current_reclaim_state(gfp_mask);
 	reclaim_state.reclaimed_slab = 0;
@@ -2519,6 +2711,7 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order,
 	current->reclaim_state = NULL;
 	lockdep_clear_current_reclaim_state();
 	current->flags &= ~PF_MEMALLOC;
+	memstall_end(NULL, MEMSTALL_RECLAIM, stall);
 
 	cond_resched();
 
@@ -2634,7 +2827,8 @@ gfp_to_alloc_flags(gfp_t gfp_mask)
 			alloc_flags |= ALLOC_NO_WATERMARKS;
 	}
 #ifdef CONFIG_CMA
-	if (gfpflags_to_migratetype(gfp_mask) == MIGRATE_MOVABLE)
+	if (gfpflags_to_migratetype(gfp_mask) == MIGRATE_MOVABLE &&
+	    gfp_allows_cma(gfp_mask))
 		alloc_flags |= ALLOC_CMA;
 #endif
 	return alloc_flags;
@@ -2872,7 +3066,8 @@ __alloc_pages_nodemask(gfp_t gfp_mask, unsigned int order,
 	if (unlikely(!zonelist->_zonerefs->zone))
 		return NULL;
 
-	if (IS_ENABLED(CONFIG_CMA) && ac.migratetype == MIGRATE_MOVABLE)
+	if (IS_ENABLED(CONFIG_CMA) && ac.migratetype == MIGRATE_MOVABLE &&
+	    gfp_allows_cma(gfp_mask))
 		alloc_flags |= ALLOC_CMA;
 
 retry_cpuset:
@@ -3260,7 +3455,8 @@ void show_free_areas(unsigned int filter)
 			continue;
 
 		for_each_online_cpu(cpu)
-			free_pcp += per_cpu_ptr(zone->pageset, cpu)->pcp.count;
+			free_pcp += per_cpu_ptr(zone->pageset, cpu)->pcp.count +
+				per_cpu_ptr(zone->pageset, cpu)->pcp.hcount;
 	}
 
 	printk("active_anon:%lu inactive_anon:%lu isolated_anon:%lu\n"
@@ -3297,7 +3493,8 @@ void show_free_areas(unsigned int filter)
 
 		free_pcp = 0;
 		for_each_online_cpu(cpu)
-			free_pcp += per_cpu_ptr(zone->pageset, cpu)->pcp.count;
+			free_pcp += per_cpu_ptr(zone->pageset, cpu)->pcp.count +
+				per_cpu_ptr(zone->pageset, cpu)->pcp.hcount;
 
 		show_node(zone);
 		printk("%s"
@@ -4326,14 +4523,17 @@ static void pageset_set_batch(struct per_cpu_pageset *p, unsigned long batch)
 static void pageset_init(struct per_cpu_pageset *p)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
 	pcp = &p->pcp;
 	pcp->count = 0;
-	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
+	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++) {
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+		for (order = 0; order < PCP_MAX_ORDER; order++)
+			INIT_LIST_HEAD(&pcp->hlists[order][migratetype]);
+	}
 }
 
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
@@ -5779,8 +5979,18 @@ static void __setup_per_zone_wmarks(void)
 			zone->watermark[WMARK_MIN] = tmp;
 		}
 
-		zone->watermark[WMARK_LOW]  = min_wmark_pages(zone) + (tmp >> 2);
-		zone->watermark[WMARK_HIGH] = min_wmark_pages(zone) + (tmp >> 1);
+		/*
+		 * Set the kswapd watermarks distance according to the
+		 * scale factor in proportion to available memory, but
+		 * ensure a minimum size on small systems.
+		 */
+		tmp = max_t(u64, tmp >> 2,
+			    mult_frac(zone->managed_pages,
+				      watermark_scale_factor, 10000));
+
+		zone->watermark_boost = 0;
+		zone->watermark[WMARK_LOW]  = min_wmark_pages(zone) + tmp;
+		zone->watermark[WMARK_HIGH] = min_wmark_pages(zone) + tmp * 2;
 
 		__mod_zone_page_state(zone, NR_ALLOC_BATCH,
 			high_wmark_pages(zone) - low_wmark_pages(zone) -
@@ -5922,6 +6132,21 @@ int min_free_kbytes_sysctl_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+int watermark_scale_factor_sysctl_handler(struct ctl_table *table, int write,
+	void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int rc;
+
+	rc = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (rc)
+		return rc;
+
+	if (write)
+		setup_per_zone_wmarks();
+
+	return 0;
+}
+
 #ifdef CONFIG_NUMA
 int sysctl_min_unmapped_ratio_sysctl_handler(struct ctl_table *table, int write,
 	void __user *buffer, size_t *length, loff_t *ppos)
@@ -61,6 +61,27 @@ unsigned long total_swapcache_pages(void)
 
 static atomic_t swapin_readahead_hits = ATOMIC_INIT(4);
 
+/*
+ * vma->swap_readahead_info packs the page aligned address of the last swap
+ * fault in the VMA with the readahead window used for it and the number
+ * of readahead pages hit since, in the bits below PAGE_SHIFT.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+/* largest power of two that fits, the window is used as a mask */
+#define SWAP_RA_WIN_MAX		(((SWAP_RA_WIN_MASK >> SWAP_RA_WIN_SHIFT) + 1) / 2)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
 void show_swap_cache_info(void)
 {
 	printk("%lu pages in swap cache\n", total_swapcache_pages());
@@ -272,7 +293,8 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
+			       unsigned long addr)
 {
 	struct page *page;
 
@@ -280,8 +302,22 @@ struct page * lookup_swap_cache(swp_entry_t entry)
 
 	if (page) {
 		INC_CACHE_INFO(find_success);
-		if (TestClearPageReadahead(page))
+		if (TestClearPageReadahead(page)) {
 			atomic_inc(&swapin_readahead_hits);
+			if (vma) {
+				unsigned long ra_val, hits;
+
+				/* racy, a lost hit only costs a smaller window */
+				ra_val = atomic_long_read(
+						&vma->swap_readahead_info);
+				hits = min(SWAP_RA_HITS(ra_val) + 1,
+					   SWAP_RA_HITS_MAX);
+				atomic_long_set(&vma->swap_readahead_info,
+					SWAP_RA_VAL(SWAP_RA_ADDR(ra_val),
+						    SWAP_RA_WIN(ra_val),
+						    hits));
+			}
+		}
 	}
 
 	INC_CACHE_INFO(find_total);
@@ -428,6 +464,59 @@ static unsigned long swapin_nr_pages(unsigned long offset)
 	return pages;
 }
 
+/*
+ * The same heuristic as swapin_nr_pages(), but fed from the VMA that
+ * faulted so that one task streaming through its heap is not mixed up
+ * with random faults elsewhere. A VMA that used up its whole window and
+ * keeps faulting sequentially may go past page_cluster, up to twice the
+ * previous window.
+ */
+static unsigned long swapin_nr_pages_vma(struct vm_area_struct *vma,
+					 unsigned long addr)
+{
+	unsigned long ra_val, prev_addr;
+	unsigned int pages, max_pages, prev_win, hits;
+	bool sequential;
+
+	addr &= PAGE_MASK;
+	ra_val = atomic_long_read(&vma->swap_readahead_info);
+	prev_addr = SWAP_RA_ADDR(ra_val);
+	prev_win = SWAP_RA_WIN(ra_val);
+	hits = SWAP_RA_HITS(ra_val);
+	sequential = addr == prev_addr + PAGE_SIZE ||
+		     addr == prev_addr - PAGE_SIZE;
+
+	max_pages = 1 << READ_ONCE(page_cluster);
+	if (max_pages <= 1) {
+		pages = 1;
+		goto out;
+	}
+
+	pages = hits + 2;
+	if (pages == 2) {
+		if (!sequential)
+			pages = 1;
+	} else {
+		unsigned int roundup = 4;
+		while (roundup < pages)
+			roundup <<= 1;
+		pages = roundup;
+	}
+
+	if (sequential && hits + 1 >= prev_win && prev_win >= max_pages)
+		max_pages = min_t(unsigned int, prev_win * 2, SWAP_RA_WIN_MAX);
+	if (pages > max_pages)
+		pages = max_pages;
+
+	/* Don't shrink readahead too fast */
+	if (pages < prev_win / 2)
+		pages = prev_win / 2;
+out:
+	atomic_long_set(&vma->swap_readahead_info,
+			SWAP_RA_VAL(addr, pages, 0));
+	return pages;
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -457,7 +546,15 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	unsigned long mask;
 	struct blk_plug plug;
 
-	mask = swapin_nr_pages(offset) - 1;
+	/* nothing to win on zram: every page read ahead is decompressed */
+	if (swp_swap_info(entry)->flags & SWP_SYNCHRONOUS_IO)
+		goto skip;
+
+	/* shmem passes a pseudo vma without mm and history */
+	if (vma && vma->vm_mm)
+		mask = swapin_nr_pages_vma(vma, addr) - 1;
+	else
+		mask = swapin_nr_pages(offset) - 1;
 	if (!mask)
 		goto skip;
 
@@ -2432,6 +2432,13 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 		error = -ENOMEM;
 		goto bad_swap;
 	}
+	/*
+	 * A device with ->rw_page (zram, brd, pmem) lives in memory and
+	 * completes reads in the faulting task, readahead only costs it.
+	 */
+	if ((p->flags & SWP_BLKDEV) && p->bdev->bd_disk->fops->rw_page)
+		p->flags |= SWP_SYNCHRONOUS_IO;
+
 	if (p->bdev && blk_queue_nonrot(bdev_get_queue(p->bdev))) {
 		p->flags |= SWP_SOLIDSTATE;
 		/*
@@ -2705,6 +2712,11 @@ struct swap_info_struct *page_swap_info(struct page *page)
 	return swap_info[swp_type(swap)];
 }
 
+struct swap_info_struct *swp_swap_info(swp_entry_t entry)
+{
+	return swap_info[swp_type(entry)];
+}
+
 /*
  * out-of-line __page_file_ methods to avoid include hell.
  */
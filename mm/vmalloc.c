@@ -463,6 +463,7 @@ found:
 overflow:
 	spin_unlock(&vmap_area_lock);
 	if (!purged) {
+		count_vm_event(VMAP_ALLOC_PURGE);
 		purge_vmap_area_lazy();
 		purged = 1;
 		goto retry;
@@ -563,14 +564,47 @@ static void vmap_debug_free_range(unsigned long start, unsigned long end)
  * a less aggressive log scale. It will still be an improvement over the old
  * code, and it will be simple to change the scale factor if we find that it
  * becomes a problem on bigger systems.
+ *
+ * 32 bit machines have only a few hundred MB of vmalloc space, though, and
+ * letting a quarter of it or more sit in lazily freed areas makes
+ * allocations run out of space and purge synchronously instead. Cap the
+ * lazy pages at an eighth of the vmalloc area there. Purges stay cheap in
+ * spite of the more frequent flushes since large ranges flush the whole
+ * TLB, see vmap_flush_tlb_kernel_range().
  */
 static unsigned long lazy_max_pages(void)
 {
+	unsigned long pages;
 	unsigned int log;
 
 	log = fls(num_online_cpus());
 
-	return log * (32UL * 1024 * 1024 / PAGE_SIZE);
+	pages = log * (32UL * 1024 * 1024 / PAGE_SIZE);
+	if (BITS_PER_LONG == 32)
+		pages = min(pages, (VMALLOC_END - VMALLOC_START) >>
+				   (PAGE_SHIFT + 3));
+
+	return pages;
+}
+
+/*
+ * Above this many pages flushing the whole TLB is cheaper than flushing
+ * the range page by page. The purged range spans everything between the
+ * lowest and highest lazily freed area, so it easily covers most of the
+ * vmalloc space, and ARMv7 broadcasts one TLBIMVAAIS per page for a ranged
+ * flush in kernel space. A few hundred pages is also about the size of
+ * the TLBs here, so a full flush loses little.
+ */
+#define VMAP_PURGE_FLUSH_ALL_PAGES	256
+
+static void vmap_flush_tlb_kernel_range(unsigned long start,
+					unsigned long end)
+{
+	if ((end - start) >> PAGE_SHIFT > VMAP_PURGE_FLUSH_ALL_PAGES) {
+		count_vm_event(VMAP_PURGE_FLUSH_ALL);
+		flush_tlb_all();
+	} else
+		flush_tlb_kernel_range(start, end);
 }
 
 static atomic_t vmap_lazy_nr = ATOMIC_INIT(0);
@@ -635,11 +669,15 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	}
 	rcu_read_unlock();
 
-	if (nr)
+	if (nr) {
 		atomic_sub(nr, &vmap_lazy_nr);
+		count_vm_events(VMAP_PURGE_PAGES, nr);
+	}
 
-	if (nr || force_flush)
-		flush_tlb_kernel_range(*start, *end);
+	if (nr || force_flush) {
+		count_vm_event(VMAP_PURGE);
+		vmap_flush_tlb_kernel_range(*start, *end);
+	}
 
 	if (nr) {
 		spin_lock(&vmap_area_lock);
@@ -22,6 +22,7 @@
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/printk.h>
+#include <linux/notifier.h>
 #include <linux/vmpressure.h>
 
 /*
@@ -70,6 +71,89 @@ static const unsigned int vmpressure_level_critical = 95;
  */
 static const unsigned int vmpressure_level_critical_prio = ilog2(100 / 10);
 
+static unsigned long vmpressure_calc_pressure(unsigned long scanned,
+					      unsigned long reclaimed)
+{
+	unsigned long scale = scanned + reclaimed;
+	unsigned long pressure;
+
+	/*
+	 * We calculate the ratio (in percents) of how many pages were
+	 * scanned vs. reclaimed in a given time frame (window). Note that
+	 * time is in VM reclaimer's "ticks", i.e. number of pages
+	 * scanned. This makes it possible to set desired reaction time
+	 * and serves as a ratelimit.
+	 */
+	pressure = scale - (reclaimed * scale / scanned);
+	pressure = pressure * 100 / scale;
+
+	pr_debug("%s: %3lu  (s: %lu  r: %lu)\n", __func__, pressure,
+		 scanned, reclaimed);
+
+	return pressure;
+}
+
+/*
+ * Global reclaim is also accounted outside of any memcg, and reported to
+ * in-kernel listeners (the Android lowmemorykiller) with the pressure in
+ * percents, from process context.
+ */
+static BLOCKING_NOTIFIER_HEAD(vmpressure_notifier);
+
+static DEFINE_SPINLOCK(global_sr_lock);
+static unsigned long global_scanned;
+static unsigned long global_reclaimed;
+
+static void vmpressure_global_work_fn(struct work_struct *work)
+{
+	unsigned long scanned, reclaimed;
+
+	spin_lock(&global_sr_lock);
+	scanned = global_scanned;
+	reclaimed = global_reclaimed;
+	global_scanned = 0;
+	global_reclaimed = 0;
+	spin_unlock(&global_sr_lock);
+
+	if (!scanned)
+		return;
+
+	blocking_notifier_call_chain(&vmpressure_notifier,
+			vmpressure_calc_pressure(scanned, reclaimed), NULL);
+}
+
+static DECLARE_WORK(vmpressure_global_work, vmpressure_global_work_fn);
+
+static void vmpressure_global(unsigned long scanned, unsigned long reclaimed)
+{
+	spin_lock(&global_sr_lock);
+	global_scanned += scanned;
+	global_reclaimed += reclaimed;
+	scanned = global_scanned;
+	spin_unlock(&global_sr_lock);
+
+	if (scanned >= vmpressure_win)
+		schedule_work(&vmpressure_global_work);
+}
+
+/**
+ * vmpressure_register_notifier() - Get global reclaim pressure reports
+ * @nb:		notifier block, called with the pressure in percents
+ *
+ * The notifier runs from a workqueue once per vmpressure window of
+ * globally scanned pages.
+ */
+int vmpressure_register_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&vmpressure_notifier, nb);
+}
+
+int vmpressure_unregister_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&vmpressure_notifier, nb);
+}
+
+#ifdef CONFIG_MEMCG
 static struct vmpressure *work_to_vmpressure(struct work_struct *work)
 {
 	return container_of(work, struct vmpressure, work);
@@ -111,23 +195,7 @@ static enum vmpressure_levels vmpressure_level(unsigned long pressure)
 static enum vmpressure_levels vmpressure_calc_level(unsigned long scanned,
 						    unsigned long reclaimed)
 {
-	unsigned long scale = scanned + reclaimed;
-	unsigned long pressure;
-
-	/*
-	 * We calculate the ratio (in percents) of how many pages were
-	 * scanned vs. reclaimed in a given time frame (window). Note that
-	 * time is in VM reclaimer's "ticks", i.e. number of pages
-	 * scanned. This makes it possible to set desired reaction time
-	 * and serves as a ratelimit.
-	 */
-	pressure = scale - (reclaimed * scale / scanned);
-	pressure = pressure * 100 / scale;
-
-	pr_debug("%s: %3lu  (s: %lu  r: %lu)\n", __func__, pressure,
-		 scanned, reclaimed);
-
-	return vmpressure_level(pressure);
+	return vmpressure_level(vmpressure_calc_pressure(scanned, reclaimed));
 }
 
 struct vmpressure_event {
@@ -194,6 +262,7 @@ static void vmpressure_work_fn(struct work_struct *work)
 		 */
 	} while ((vmpr = vmpressure_parent(vmpr)));
 }
+#endif /* CONFIG_MEMCG */
 
 /**
  * vmpressure() - Account memory pressure through scanned/reclaimed ratio
@@ -211,7 +280,9 @@ static void vmpressure_work_fn(struct work_struct *work)
 void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
 		unsigned long scanned, unsigned long reclaimed)
 {
-	struct vmpressure *vmpr = memcg_to_vmpressure(memcg);
+#ifdef CONFIG_MEMCG
+	struct vmpressure *vmpr;
+#endif
 
 	/*
 	 * Here we only want to account pressure that userland is able to
@@ -238,6 +309,11 @@ void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
 	if (!scanned)
 		return;
 
+	if (!memcg)
+		vmpressure_global(scanned, reclaimed);
+
+#ifdef CONFIG_MEMCG
+	vmpr = memcg_to_vmpressure(memcg);
 	spin_lock(&vmpr->sr_lock);
 	vmpr->scanned += scanned;
 	vmpr->reclaimed += reclaimed;
@@ -247,6 +323,7 @@ void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
 	if (scanned < vmpressure_win)
 		return;
 	schedule_work(&vmpr->work);
+#endif
 }
 
 /**
@@ -279,6 +356,7 @@ void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio)
 	vmpressure(gfp, memcg, vmpressure_win, 0);
 }
 
+#ifdef CONFIG_MEMCG
 /**
  * vmpressure_register_event() - Bind vmpressure notifications to an eventfd
  * @memcg:	memcg that is interested in vmpressure notifications
@@ -380,3 +458,4 @@ void vmpressure_cleanup(struct vmpressure *vmpr)
 	 */
 	flush_work(&vmpr->work);
 }
+#endif /* CONFIG_MEMCG */
@@ -2891,11 +2891,17 @@ static void age_active_anon(struct zone *zone, struct scan_control *sc)
 	} while (memcg);
 }
 
+/*
+ * kswapd balances a zone to its high watermark plus any boost raised by
+ * recent fragmenting fallback allocations.
+ */
 static bool zone_balanced(struct zone *zone, int order,
 			  unsigned long balance_gap, int classzone_idx)
 {
-	if (!zone_watermark_ok_safe(zone, order, high_wmark_pages(zone) +
-				    balance_gap, classzone_idx, 0))
+	unsigned long mark = high_wmark_pages(zone) + zone->watermark_boost;
+
+	if (!zone_watermark_ok_safe(zone, order, mark + balance_gap,
+				    classzone_idx, 0))
 		return false;
 
 	if (IS_ENABLED(CONFIG_COMPACTION) && order && compaction_suitable(zone,
@@ -3266,6 +3272,19 @@ static unsigned long balance_pgdat(pg_data_t *pgdat, int order,
 		 !pgdat_balanced(pgdat, order, *classzone_idx));
 
 out:
+	/* The boost is temporary, drop it once kswapd is done with the node */
+	for (i = 0; i < pgdat->nr_zones; i++) {
+		struct zone *zone = pgdat->node_zones + i;
+		unsigned long flags;
+
+		if (!zone->watermark_boost)
+			continue;
+
+		spin_lock_irqsave(&zone->lock, flags);
+		zone->watermark_boost = 0;
+		spin_unlock_irqrestore(&zone->lock, flags);
+	}
+
 	/*
 	 * Return the order we were reclaiming at so prepare_kswapd_sleep()
 	 * makes a decision on the order we were last reclaiming at. However,
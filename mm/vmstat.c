@@ -671,6 +671,23 @@ int fragmentation_index(struct zone *zone, unsigned int order)
 	fill_contig_page_info(zone, order, &info);
 	return __fragmentation_index(order, &info);
 }
+
+/*
+ * Percentage of the free memory in @zone that sits in blocks smaller than
+ * 2^@order pages, i.e. cannot be used for an allocation of that order.
+ */
+unsigned int extfrag_for_order(struct zone *zone, unsigned int order)
+{
+	struct contig_page_info info;
+
+	fill_contig_page_info(zone, order, &info);
+	if (info.free_pages == 0)
+		return 0;
+
+	return div_u64((info.free_pages -
+			(info.free_blocks_suitable << order)) * 100,
+			info.free_pages);
+}
 #endif
 
 #if defined(CONFIG_PROC_FS) || defined(CONFIG_SYSFS) || defined(CONFIG_NUMA)
@@ -756,6 +773,8 @@ const char * const vmstat_text[] = {
 	"pgfree",
 	"pgactivate",
 	"pgdeactivate",
+	"pcp_high_order_hit",
+	"pcp_high_order_miss",
 
 	"pgfault",
 	"pgmajfault",
@@ -782,6 +801,10 @@ const char * const vmstat_text[] = {
 
 	"drop_pagecache",
 	"drop_slab",
+	"vmap_purge",
+	"vmap_purge_pages",
+	"vmap_purge_flush_all",
+	"vmap_alloc_purge",
 
 #ifdef CONFIG_NUMA_BALANCING
 	"numa_pte_updates",
@@ -801,6 +824,7 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_proactive",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -824,6 +848,12 @@ const char * const vmstat_text[] = {
 	"thp_zero_page_alloc",
 	"thp_zero_page_alloc_failed",
 #endif
+#ifdef CONFIG_HAVE_ARCH_LARGE_PTE
+	"large_pte_fault_alloc",
+	"large_pte_fault_fallback",
+	"large_pte_promote",
+	"large_pte_split",
+#endif
 #ifdef CONFIG_MEMORY_BALLOON
 	"balloon_inflate",
 	"balloon_deflate",
@@ -1223,11 +1253,13 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   "\n    cpu: %i"
 			   "\n              count: %i"
 			   "\n              high:  %i"
-			   "\n              batch: %i",
+			   "\n              batch: %i"
+			   "\n              hcount: %i",
 			   i,
 			   pageset->pcp.count,
 			   pageset->pcp.high,
-			   pageset->pcp.batch);
+			   pageset->pcp.batch,
+			   pageset->pcp.hcount);
 #ifdef CONFIG_SMP
 		seq_printf(m, "\n  vm stats threshold: %d",
 				pageset->stat_threshold);
@@ -1673,6 +1705,52 @@ static const struct file_operations extfrag_file_ops = {
 	.release	= seq_release,
 };
 
+static void score_show_print(struct seq_file *m,
+					pg_data_t *pgdat, struct zone *zone)
+{
+	seq_printf(m, "Node %d, zone %8s %3u\n",
+				pgdat->node_id,
+				zone->name,
+				compaction_fragmentation_score(zone));
+}
+
+/*
+ * Display the fragmentation score proactive compaction works against:
+ * the percentage of free memory not usable for COMPACTION_PROACTIVE_ORDER
+ * allocations, scaled by the zone's share of the node's memory.
+ */
+static int score_show(struct seq_file *m, void *arg)
+{
+	pg_data_t *pgdat = (pg_data_t *)arg;
+
+	/* check memoryless node */
+	if (!node_state(pgdat->node_id, N_MEMORY))
+		return 0;
+
+	walk_zones_in_node(m, pgdat, score_show_print);
+
+	return 0;
+}
+
+static const struct seq_operations score_op = {
+	.start	= frag_start,
+	.next	= frag_next,
+	.stop	= frag_stop,
+	.show	= score_show,
+};
+
+static int score_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &score_op);
+}
+
+static const struct file_operations score_file_ops = {
+	.open		= score_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static int __init extfrag_debug_init(void)
 {
 	struct dentry *extfrag_debug_root;
@@ -1689,6 +1767,10 @@ static int __init extfrag_debug_init(void)
 			extfrag_debug_root, NULL, &extfrag_file_ops))
 		goto fail;
 
+	if (!debugfs_create_file("score", 0444,
+			extfrag_debug_root, NULL, &score_file_ops))
+		goto fail;
+
 	return 0;
 fail:
 	debugfs_remove_recursive(extfrag_debug_root);
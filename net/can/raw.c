@@ -89,6 +89,7 @@ struct raw_sock {
 	int recv_own_msgs;
 	int fd_frames;
 	int join_filters;
+	int recv_batch;
 	int count;                 /* number of active filters */
 	struct can_filter dfilter; /* default/single filter */
 	struct can_filter *filter; /* pointer to filter(s) */
@@ -325,6 +326,7 @@ static int raw_init(struct sock *sk)
 	ro->recv_own_msgs    = 0;
 	ro->fd_frames        = 0;
 	ro->join_filters     = 0;
+	ro->recv_batch       = 0;
 
 	/* alloc_percpu provides zero'ed memory */
 	ro->uniq = alloc_percpu(struct uniqframe);
@@ -627,6 +629,15 @@ static int raw_setsockopt(struct socket *sock, int level, int optname,
 
 		break;
 
+	case CAN_RAW_RECV_BATCH:
+		if (optlen != sizeof(ro->recv_batch))
+			return -EINVAL;
+
+		if (copy_from_user(&ro->recv_batch, optval, optlen))
+			return -EFAULT;
+
+		break;
+
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -697,6 +708,12 @@ static int raw_getsockopt(struct socket *sock, int level, int optname,
 		val = &ro->join_filters;
 		break;
 
+	case CAN_RAW_RECV_BATCH:
+		if (len > sizeof(int))
+			len = sizeof(int);
+		val = &ro->recv_batch;
+		break;
+
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -778,10 +795,86 @@ send_failed:
 	return err;
 }
 
+/*
+ * Take the next frame off the receive queue for a batched read, but only
+ * if it came from the same interface with the same message flags as the
+ * first one, as those are reported once for the whole batch.
+ */
+static struct sk_buff *raw_dequeue_batch(struct sock *sk,
+					 struct sk_buff *first)
+{
+	struct sk_buff_head *queue = &sk->sk_receive_queue;
+	struct sk_buff *skb;
+	unsigned long flags;
+
+	spin_lock_irqsave(&queue->lock, flags);
+	skb = skb_peek(queue);
+	if (skb &&
+	    (((struct sockaddr_can *)skb->cb)->can_ifindex !=
+	     ((struct sockaddr_can *)first->cb)->can_ifindex ||
+	     *raw_flags(skb) != *raw_flags(first)))
+		skb = NULL;
+	if (skb)
+		__skb_unlink(skb, queue);
+	spin_unlock_irqrestore(&queue->lock, flags);
+
+	return skb;
+}
+
+/*
+ * With CAN_RAW_RECV_BATCH every frame occupies a slot of CAN_MTU bytes,
+ * or CANFD_MTU bytes with CAN_RAW_FD_FRAMES where classic frames are
+ * zero padded. As many queued frames as fit are copied in one call and
+ * a timestamp control message is added for each of them, in order.
+ */
+static int raw_recvmsg_batch(struct sock *sk, struct msghdr *msg,
+			     size_t size, struct sk_buff *skb)
+{
+	static const u8 pad[CANFD_MTU];
+	struct raw_sock *ro = raw_sk(sk);
+	size_t slot = ro->fd_frames ? CANFD_MTU : CAN_MTU;
+	struct sk_buff *first = skb;
+	size_t copied = 0;
+	int err;
+
+	do {
+		err = memcpy_to_msg(msg, skb->data, skb->len);
+		if (!err && skb->len < slot)
+			err = memcpy_to_msg(msg, pad, slot - skb->len);
+		if (err < 0)
+			break;
+
+		sock_recv_ts_and_drops(msg, sk, skb);
+		copied += slot;
+
+		if (skb != first)
+			skb_free_datagram(sk, skb);
+		skb = NULL;
+		if (size - copied < slot)
+			break;
+	} while ((skb = raw_dequeue_batch(sk, first)));
+
+	if (skb && skb != first)
+		skb_free_datagram(sk, skb);
+
+	if (msg->msg_name) {
+		__sockaddr_check_size(sizeof(struct sockaddr_can));
+		msg->msg_namelen = sizeof(struct sockaddr_can);
+		memcpy(msg->msg_name, first->cb, msg->msg_namelen);
+	}
+
+	msg->msg_flags |= *(raw_flags(first));
+
+	skb_free_datagram(sk, first);
+
+	return copied ? copied : err;
+}
+
 static int raw_recvmsg(struct socket *sock, struct msghdr *msg, size_t size,
 		       int flags)
 {
 	struct sock *sk = sock->sk;
+	struct raw_sock *ro = raw_sk(sk);
 	struct sk_buff *skb;
 	int err = 0;
 	int noblock;
@@ -793,6 +886,10 @@ static int raw_recvmsg(struct socket *sock, struct msghdr *msg, size_t size,
 	if (!skb)
 		return err;
 
+	if (ro->recv_batch && !(flags & MSG_PEEK) &&
+	    size >= (ro->fd_frames ? CANFD_MTU : CAN_MTU))
+		return raw_recvmsg_batch(sk, msg, size, skb);
+
 	if (size < skb->len)
 		msg->msg_flags |= MSG_TRUNC;
 	else
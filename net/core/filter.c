@@ -1344,6 +1344,30 @@ const struct bpf_func_proto bpf_l4_csum_replace_proto = {
 	.arg5_type	= ARG_ANYTHING,
 };
 
+static u64 bpf_rx_load_bytes(u64 r1, u64 r2, u64 r3, u64 r4, u64 r5)
+{
+	const struct bpf_rx_frame *frame = (const void *) (long) r1;
+	u32 offset = (u32) r2;
+	void *to = (void *) (long) r3;
+	u32 len = (u32) r4;
+
+	if (unlikely(offset > frame->len || len > frame->len - offset))
+		return -EFAULT;
+
+	memcpy(to, frame->data + offset, len);
+	return 0;
+}
+
+static const struct bpf_func_proto bpf_rx_load_bytes_proto = {
+	.func		= bpf_rx_load_bytes,
+	.gpl_only	= false,
+	.ret_type	= RET_INTEGER,
+	.arg1_type	= ARG_PTR_TO_CTX,
+	.arg2_type	= ARG_ANYTHING,
+	.arg3_type	= ARG_PTR_TO_STACK,
+	.arg4_type	= ARG_CONST_STACK_SIZE,
+};
+
 static const struct bpf_func_proto *
 sk_filter_func_proto(enum bpf_func_id func_id)
 {
@@ -1378,6 +1402,17 @@ tc_cls_act_func_proto(enum bpf_func_id func_id)
 	}
 }
 
+static const struct bpf_func_proto *
+rx_early_func_proto(enum bpf_func_id func_id)
+{
+	switch (func_id) {
+	case BPF_FUNC_rx_load_bytes:
+		return &bpf_rx_load_bytes_proto;
+	default:
+		return sk_filter_func_proto(func_id);
+	}
+}
+
 static bool sk_filter_is_valid_access(int off, int size,
 				      enum bpf_access_type type)
 {
@@ -1455,6 +1490,45 @@ static u32 sk_filter_convert_ctx_access(int dst_reg, int src_reg, int ctx_off,
 	return insn - insn_buf;
 }
 
+static bool rx_early_is_valid_access(int off, int size,
+				     enum bpf_access_type type)
+{
+	if (type != BPF_READ)
+		return false;
+
+	if (off < 0 || off >= sizeof(struct __rx_frame))
+		return false;
+
+	if (off % size != 0)
+		return false;
+
+	/* all __rx_frame fields are __u32 */
+	if (size != 4)
+		return false;
+
+	return true;
+}
+
+static u32 rx_early_convert_ctx_access(int dst_reg, int src_reg, int ctx_off,
+				       struct bpf_insn *insn_buf)
+{
+	struct bpf_insn *insn = insn_buf;
+
+	switch (ctx_off) {
+	case offsetof(struct __rx_frame, len):
+		*insn++ = BPF_LDX_MEM(BPF_W, dst_reg, src_reg,
+				      offsetof(struct bpf_rx_frame, len));
+		break;
+
+	case offsetof(struct __rx_frame, ifindex):
+		*insn++ = BPF_LDX_MEM(BPF_W, dst_reg, src_reg,
+				      offsetof(struct bpf_rx_frame, ifindex));
+		break;
+	}
+
+	return insn - insn_buf;
+}
+
 static const struct bpf_verifier_ops sk_filter_ops = {
 	.get_func_proto = sk_filter_func_proto,
 	.is_valid_access = sk_filter_is_valid_access,
@@ -1467,6 +1541,12 @@ static const struct bpf_verifier_ops tc_cls_act_ops = {
 	.convert_ctx_access = sk_filter_convert_ctx_access,
 };
 
+static const struct bpf_verifier_ops rx_early_ops = {
+	.get_func_proto = rx_early_func_proto,
+	.is_valid_access = rx_early_is_valid_access,
+	.convert_ctx_access = rx_early_convert_ctx_access,
+};
+
 static struct bpf_prog_type_list sk_filter_type __read_mostly = {
 	.ops = &sk_filter_ops,
 	.type = BPF_PROG_TYPE_SOCKET_FILTER,
@@ -1482,11 +1562,17 @@ static struct bpf_prog_type_list sched_act_type __read_mostly = {
 	.type = BPF_PROG_TYPE_SCHED_ACT,
 };
 
+static struct bpf_prog_type_list rx_early_type __read_mostly = {
+	.ops = &rx_early_ops,
+	.type = BPF_PROG_TYPE_RX_EARLY,
+};
+
 static int __init register_sk_filter_ops(void)
 {
 	bpf_register_prog_type(&sk_filter_type);
 	bpf_register_prog_type(&sched_cls_type);
 	bpf_register_prog_type(&sched_act_type);
+	bpf_register_prog_type(&rx_early_type);
 
 	return 0;
 }
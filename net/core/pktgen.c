@@ -158,6 +158,7 @@
 #include <linux/etherdevice.h>
 #include <linux/kthread.h>
 #include <linux/prefetch.h>
+#include <linux/jhash.h>
 #include <net/net_namespace.h>
 #include <net/checksum.h>
 #include <net/ipv6.h>
@@ -218,6 +219,7 @@
 #define PKTGEN_MAGIC 0xbe9be955
 #define PG_PROC_DIR "pktgen"
 #define PGCTRL	    "pgctrl"
+#define PGRX	    "pgrx"
 
 #define MAX_CFLOWS  65536
 
@@ -410,11 +412,49 @@ struct pktgen_hdr {
 
 static int pg_net_id __read_mostly;
 
+/*
+ * RX sink: pktgen packets arriving on one device are accounted per UDP
+ * flow and consumed before the protocol stack sees them.  Loss is
+ * derived from the sequence numbers, so it is exact as long as each
+ * flow is sent by a single pktgen device.  Latency needs the sender's
+ * wall clock to be synchronized with ours, e.g. through PTP.
+ */
+#define PKTGEN_RX_FLOWS		64
+/* sequence numbers further back than this mean the sender restarted */
+#define PKTGEN_RX_LATE_WINDOW	1024
+
+struct pktgen_rx_flow {
+	__be32	saddr;
+	__be32	daddr;
+	__be16	sport;
+	__be16	dport;
+	u32	next_seq;
+	u64	pkts;
+	u64	bytes;
+	u64	lost;
+	u64	late;
+	u64	first_ns;
+	u64	last_ns;
+	u64	lat_pkts;
+	u64	lat_sum;	/* usec */
+	u32	lat_min;
+	u32	lat_max;
+};
+
+struct pktgen_rx {
+	struct net_device	*dev;
+	spinlock_t		lock;
+	unsigned int		nr_flows;
+	u64			no_flow;	/* flow table was full */
+	struct pktgen_rx_flow	flows[PKTGEN_RX_FLOWS];
+};
+
 struct pktgen_net {
 	struct net		*net;
 	struct proc_dir_entry	*proc_dir;
 	struct list_head	pktgen_threads;
 	bool			pktgen_exiting;
+	struct pktgen_rx	*rx;		/* protected by RTNL */
 };
 
 struct pktgen_thread {
@@ -466,6 +506,186 @@ static struct notifier_block pktgen_notifier_block = {
 	.notifier_call = pktgen_device_event,
 };
 
+static struct pktgen_rx_flow *pktgen_rx_flow_get(struct pktgen_rx *rx,
+						 const struct iphdr *iph,
+						 const struct udphdr *uh)
+{
+	u32 ports = ((__force u32)uh->source << 16) | (__force u32)uh->dest;
+	unsigned int i, n;
+	struct pktgen_rx_flow *f;
+
+	i = jhash_3words((__force u32)iph->saddr, (__force u32)iph->daddr,
+			 ports, 0);
+	for (n = 0; n < PKTGEN_RX_FLOWS; n++) {
+		f = &rx->flows[(i + n) & (PKTGEN_RX_FLOWS - 1)];
+		if (!f->pkts) {
+			f->saddr = iph->saddr;
+			f->daddr = iph->daddr;
+			f->sport = uh->source;
+			f->dport = uh->dest;
+			rx->nr_flows++;
+			return f;
+		}
+		if (f->saddr == iph->saddr && f->daddr == iph->daddr &&
+		    f->sport == uh->source && f->dport == uh->dest)
+			return f;
+	}
+	return NULL;
+}
+
+static void pktgen_rx_account(struct pktgen_rx *rx, const struct iphdr *iph,
+			      const struct udphdr *uh,
+			      const struct pktgen_hdr *pgh, unsigned int len)
+{
+	u32 seq = ntohl(pgh->seq_num);
+	u64 now = ktime_get_ns();
+	struct pktgen_rx_flow *f;
+	struct timeval tv;
+	s64 lat = -1;
+	s32 gap;
+
+	if (pgh->tv_sec || pgh->tv_usec) {
+		do_gettimeofday(&tv);
+		lat = (s64)(s32)((u32)tv.tv_sec - ntohl(pgh->tv_sec)) *
+		      USEC_PER_SEC + tv.tv_usec - (s64)ntohl(pgh->tv_usec);
+	}
+
+	spin_lock(&rx->lock);
+	f = pktgen_rx_flow_get(rx, iph, uh);
+	if (!f) {
+		rx->no_flow++;
+		goto out;
+	}
+
+	gap = seq - f->next_seq;
+	if (!f->pkts || gap < -PKTGEN_RX_LATE_WINDOW) {
+		f->first_ns = now;
+		f->next_seq = seq + 1;
+	} else if (gap >= 0) {
+		f->lost += gap;
+		f->next_seq = seq + 1;
+	} else {
+		/* already counted as lost when its successor arrived */
+		f->late++;
+		if (f->lost)
+			f->lost--;
+	}
+	f->pkts++;
+	f->bytes += len;
+	f->last_ns = now;
+
+	/* negative latency: the clocks are not synchronized */
+	if (lat >= 0 && lat <= U32_MAX) {
+		if (!f->lat_pkts || lat < f->lat_min)
+			f->lat_min = lat;
+		if (lat > f->lat_max)
+			f->lat_max = lat;
+		f->lat_sum += lat;
+		f->lat_pkts++;
+	}
+out:
+	spin_unlock(&rx->lock);
+}
+
+static rx_handler_result_t pktgen_rx_handler(struct sk_buff **pskb)
+{
+	struct sk_buff *skb = *pskb;
+	struct pktgen_rx *rx = rcu_dereference(skb->dev->rx_handler_data);
+	const struct pktgen_hdr *pgh;
+	const struct udphdr *uh;
+	const struct iphdr *iph;
+	struct pktgen_hdr _pgh;
+	struct udphdr _uh;
+	struct iphdr _iph;
+	unsigned int off;
+
+	if (skb->protocol != htons(ETH_P_IP))
+		return RX_HANDLER_PASS;
+
+	iph = skb_header_pointer(skb, 0, sizeof(_iph), &_iph);
+	if (!iph || iph->ihl < 5 || iph->protocol != IPPROTO_UDP ||
+	    ip_is_fragment(iph))
+		return RX_HANDLER_PASS;
+	off = iph->ihl * 4;
+
+	uh = skb_header_pointer(skb, off, sizeof(_uh), &_uh);
+	if (!uh)
+		return RX_HANDLER_PASS;
+	pgh = skb_header_pointer(skb, off + sizeof(_uh), sizeof(_pgh), &_pgh);
+	if (!pgh || pgh->pgh_magic != htonl(PKTGEN_MAGIC))
+		return RX_HANDLER_PASS;
+
+	pktgen_rx_account(rx, iph, uh, pgh, skb->len + skb->mac_len);
+	consume_skb(skb);
+	return RX_HANDLER_CONSUMED;
+}
+
+static int pktgen_rx_start(struct pktgen_net *pn, const char *ifname)
+{
+	struct net_device *dev;
+	struct pktgen_rx *rx;
+	int err;
+
+	rtnl_lock();
+	err = -EBUSY;
+	if (pn->rx)
+		goto out;
+	err = -ENODEV;
+	dev = __dev_get_by_name(pn->net, ifname);
+	if (!dev)
+		goto out;
+
+	err = -ENOMEM;
+	rx = kzalloc(sizeof(*rx), GFP_KERNEL);
+	if (!rx)
+		goto out;
+	spin_lock_init(&rx->lock);
+	rx->dev = dev;
+
+	err = netdev_rx_handler_register(dev, pktgen_rx_handler, rx);
+	if (err)
+		kfree(rx);
+	else
+		pn->rx = rx;
+out:
+	rtnl_unlock();
+	return err;
+}
+
+/* Called with RTNL held */
+static void __pktgen_rx_stop(struct pktgen_net *pn)
+{
+	if (!pn->rx)
+		return;
+
+	netdev_rx_handler_unregister(pn->rx->dev);
+	kfree(pn->rx);
+	pn->rx = NULL;
+}
+
+static void pktgen_rx_stop(struct pktgen_net *pn)
+{
+	rtnl_lock();
+	__pktgen_rx_stop(pn);
+	rtnl_unlock();
+}
+
+static void pktgen_rx_reset(struct pktgen_net *pn)
+{
+	struct pktgen_rx *rx;
+
+	rtnl_lock();
+	rx = pn->rx;
+	if (rx) {
+		spin_lock_bh(&rx->lock);
+		memset(rx->flows, 0, sizeof(rx->flows));
+		rx->nr_flows = 0;
+		rx->no_flow = 0;
+		spin_unlock_bh(&rx->lock);
+	}
+	rtnl_unlock();
+}
+
 /*
  * /proc handling functions
  *
@@ -506,6 +726,19 @@ static ssize_t pgctrl_write(struct file *file, const char __user *buf,
 	else if (!strcmp(data, "reset"))
 		pktgen_reset_all_threads(pn);
 
+	else if (!strncmp(data, "rx ", 3)) {
+		int err = pktgen_rx_start(pn, strim(data + 3));
+
+		if (err)
+			return err;
+	}
+
+	else if (!strcmp(data, "rx_stop"))
+		pktgen_rx_stop(pn);
+
+	else if (!strcmp(data, "rx_reset"))
+		pktgen_rx_reset(pn);
+
 	else
 		pr_warn("Unknown command: %s\n", data);
 
@@ -526,6 +759,75 @@ static const struct file_operations pktgen_fops = {
 	.release = single_release,
 };
 
+static void pgrx_show_flow(struct seq_file *seq,
+			   const struct pktgen_rx_flow *f)
+{
+	u64 usec = div_u64(f->last_ns - f->first_ns, NSEC_PER_USEC);
+
+	seq_printf(seq, "Flow: %pI4:%u -> %pI4:%u\n",
+		   &f->saddr, ntohs(f->sport), &f->daddr, ntohs(f->dport));
+	seq_printf(seq, "  pkts: %llu  bytes: %llu  lost: %llu  late: %llu\n",
+		   (unsigned long long)f->pkts,
+		   (unsigned long long)f->bytes,
+		   (unsigned long long)f->lost,
+		   (unsigned long long)f->late);
+	if (usec)
+		seq_printf(seq, "  rate: %llupps %lluMb/sec\n",
+			   (unsigned long long)div64_u64((f->pkts - 1) *
+							 USEC_PER_SEC, usec),
+			   (unsigned long long)div64_u64(f->bytes * 8, usec));
+	if (f->lat_pkts)
+		seq_printf(seq, "  latency: min %uus avg %lluus max %uus\n",
+			   f->lat_min,
+			   (unsigned long long)div64_u64(f->lat_sum,
+							 f->lat_pkts),
+			   f->lat_max);
+}
+
+static int pgrx_show(struct seq_file *seq, void *v)
+{
+	struct pktgen_net *pn = seq->private;
+	struct pktgen_rx_flow f;
+	struct pktgen_rx *rx;
+	int i;
+
+	rtnl_lock();
+	rx = pn->rx;
+	if (!rx) {
+		seq_puts(seq, "RX sink not attached\n");
+		goto out;
+	}
+
+	seq_printf(seq, "RX sink on %s: %u flows, %llu packets without flow\n",
+		   rx->dev->name, rx->nr_flows,
+		   (unsigned long long)rx->no_flow);
+
+	for (i = 0; i < PKTGEN_RX_FLOWS; i++) {
+		spin_lock_bh(&rx->lock);
+		f = rx->flows[i];
+		spin_unlock_bh(&rx->lock);
+
+		if (f.pkts)
+			pgrx_show_flow(seq, &f);
+	}
+out:
+	rtnl_unlock();
+	return 0;
+}
+
+static int pgrx_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pgrx_show, PDE_DATA(inode));
+}
+
+static const struct file_operations pktgen_rx_fops = {
+	.owner   = THIS_MODULE,
+	.open    = pgrx_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
 static int pktgen_if_show(struct seq_file *seq, void *v)
 {
 	const struct pktgen_dev *pkt_dev = seq->private;
@@ -1995,6 +2297,8 @@ static int pktgen_device_event(struct notifier_block *unused,
 
 	case NETDEV_UNREGISTER:
 		pktgen_mark_device(pn, dev->name);
+		if (pn->rx && pn->rx->dev == dev)
+			__pktgen_rx_stop(pn);
 		break;
 	}
 
@@ -3769,6 +4073,13 @@ static int __net_init pg_net_init(struct net *net)
 		goto remove;
 	}
 
+	pe = proc_create_data(PGRX, 0400, pn->proc_dir, &pktgen_rx_fops, pn);
+	if (pe == NULL) {
+		pr_err("cannot create %s procfs entry\n", PGRX);
+		ret = -EINVAL;
+		goto remove_ctrl;
+	}
+
 	for_each_online_cpu(cpu) {
 		int err;
 
@@ -3787,6 +4098,8 @@ static int __net_init pg_net_init(struct net *net)
 	return 0;
 
 remove_entry:
+	remove_proc_entry(PGRX, pn->proc_dir);
+remove_ctrl:
 	remove_proc_entry(PGCTRL, pn->proc_dir);
 remove:
 	remove_proc_entry(PG_PROC_DIR, pn->net->proc_net);
@@ -3802,6 +4115,7 @@ static void __net_exit pg_net_exit(struct net *net)
 
 	/* Stop all interfaces & threads */
 	pn->pktgen_exiting = true;
+	pktgen_rx_stop(pn);
 
 	mutex_lock(&pktgen_thread_lock);
 	list_splice_init(&pn->pktgen_threads, &list);
@@ -3814,6 +4128,7 @@ static void __net_exit pg_net_exit(struct net *net)
 		kfree(t);
 	}
 
+	remove_proc_entry(PGRX, pn->proc_dir);
 	remove_proc_entry(PGCTRL, pn->proc_dir);
 	remove_proc_entry(PG_PROC_DIR, pn->net->proc_net);
 }
@@ -795,6 +795,92 @@ void consume_skb(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(consume_skb);
 
+/*
+ * sk_buff shells consumed from NAPI context are collected per cpu and
+ * returned to skbuff_head_cache with one kmem_cache_free_bulk() call.
+ * Only softirq context touches the cache, so no further locking needed.
+ */
+#define NAPI_SKB_CACHE_SIZE	64
+
+struct napi_skb_cache {
+	size_t	count;
+	void	*skbs[NAPI_SKB_CACHE_SIZE];
+};
+static DEFINE_PER_CPU(struct napi_skb_cache, napi_skb_cache);
+
+void __kfree_skb_flush(void)
+{
+	struct napi_skb_cache *nc = this_cpu_ptr(&napi_skb_cache);
+
+	if (nc->count) {
+		kmem_cache_free_bulk(skbuff_head_cache, nc->count, nc->skbs);
+		nc->count = 0;
+	}
+}
+
+/**
+ *	__kfree_skb_defer - free an sk_buff from softirq context
+ *	@skb: buffer to free, with no users left and no fclone
+ *
+ *	Release everything attached to @skb now but queue the shell itself
+ *	for a bulk free. The caller must call __kfree_skb_flush() before
+ *	leaving softirq context.
+ */
+void __kfree_skb_defer(struct sk_buff *skb)
+{
+	struct napi_skb_cache *nc = this_cpu_ptr(&napi_skb_cache);
+
+	skb_release_all(skb);
+
+	nc->skbs[nc->count++] = skb;
+
+#ifdef CONFIG_SLUB
+	/* SLUB writes into objects when freeing */
+	prefetchw(skb);
+#endif
+
+	if (unlikely(nc->count == NAPI_SKB_CACHE_SIZE)) {
+		kmem_cache_free_bulk(skbuff_head_cache, NAPI_SKB_CACHE_SIZE,
+				     nc->skbs);
+		nc->count = 0;
+	}
+}
+
+/**
+ *	napi_consume_skb - consume an skbuff from a NAPI poll handler
+ *	@skb: buffer to free
+ *	@budget: NAPI budget of the caller, 0 when not called from NAPI
+ *
+ *	Like consume_skb(), but the sk_buff shell is freed in bulk at the end
+ *	of the NET_RX softirq. A zero @budget (e.g. netpoll) falls back to
+ *	dev_consume_skb_any().
+ */
+void napi_consume_skb(struct sk_buff *skb, int budget)
+{
+	if (unlikely(!skb))
+		return;
+
+	if (unlikely(!budget)) {
+		dev_consume_skb_any(skb);
+		return;
+	}
+
+	if (likely(atomic_read(&skb->users) == 1))
+		smp_rmb();
+	else if (likely(!atomic_dec_and_test(&skb->users)))
+		return;
+	trace_consume_skb(skb);
+
+	/* fclones are freed through their companion, keep the slow path */
+	if (skb->fclone != SKB_FCLONE_UNAVAILABLE) {
+		__kfree_skb(skb);
+		return;
+	}
+
+	__kfree_skb_defer(skb);
+}
+EXPORT_SYMBOL(napi_consume_skb);
+
 /* Make sure a field is enclosed inside headers_start/headers_end section */
 #define CHECK_SKB_FIELD(field) \
 	BUILD_BUG_ON(offsetof(struct sk_buff, field) <		\
@@ -2963,6 +3049,35 @@ int skb_append_datato_frags(struct sock *sk, struct sk_buff *skb,
 }
 EXPORT_SYMBOL(skb_append_datato_frags);
 
+/**
+ * skb_append_pagefrags - append a page reference to the frags of a skb
+ * @skb: skb to be appended to
+ * @page: page to be appended
+ * @offset: offset of the data in @page
+ * @size: length of the data
+ *
+ * Extends the last frag if @page continues it, otherwise takes a reference
+ * on @page and adds it as a new frag.  The length and truesize of @skb are
+ * left to the caller.  Returns -EMSGSIZE if all frags are in use.
+ */
+int skb_append_pagefrags(struct sk_buff *skb, struct page *page,
+			 int offset, size_t size)
+{
+	int i = skb_shinfo(skb)->nr_frags;
+
+	if (skb_can_coalesce(skb, i, page, offset)) {
+		skb_frag_size_add(&skb_shinfo(skb)->frags[i - 1], size);
+	} else if (i < MAX_SKB_FRAGS) {
+		get_page(page);
+		skb_fill_page_desc(skb, i, page, offset, size);
+	} else {
+		return -EMSGSIZE;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(skb_append_pagefrags);
+
 /**
  *	skb_pull_rcsum - pull skb and update receive checksum
  *	@skb: buffer to update
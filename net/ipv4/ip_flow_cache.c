@@ -0,0 +1,315 @@
+/*
+ * INET		An implementation of the TCP/IP protocol suite for the LINUX
+ *		operating system.  INET is implemented using the  BSD Socket
+ *		interface as the means of communication with the user level.
+ *
+ *		Forwarding flow cache.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ * Once conntrack has seen a forwarded TCP or UDP flow in both directions,
+ * ip_finish_output() records its 5-tuple, input interface and route in
+ * a direct-mapped table, once the POST_ROUTING hook has accepted it.
+ * ip_rcv() then hands further packets of the flow straight to the
+ * neighbour output of the cached route, skipping the PRE_ROUTING, FORWARD
+ * and POST_ROUTING hooks, the FIB lookup and the conntrack lookup.
+ *
+ * Entries only live for IP_FLOW_TIMEOUT: after that one packet takes the
+ * full path again, which refreshes the conntrack timeout and re-checks
+ * the ruleset, so netfilter changes take effect within that window.
+ * Packets carrying SYN, FIN or RST, options or fragments always take the
+ * full path, as do NATed flows, flows with a conntrack helper or a master
+ * (FTP, SIP, ... and their RELATED data connections) and packets carrying
+ * a mark.  Per-packet matches such as limit, quota, connbytes or string
+ * only see one packet per IP_FLOW_TIMEOUT, which is why the cache is off
+ * by default.  Conntrack does not see the sequence numbers of the packets
+ * that bypass it, so cached TCP flows are switched to liberal window
+ * tracking rather than being declared INVALID later.
+ */
+
+#include <linux/cache.h>
+#include <linux/jhash.h>
+#include <linux/netdevice.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <net/arp.h>
+#include <net/dst.h>
+#include <net/ip.h>
+#include <net/route.h>
+#include <net/netns/hash.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define IP_FLOW_CACHE_BITS	10
+#define IP_FLOW_CACHE_SIZE	(1 << IP_FLOW_CACHE_BITS)
+#define IP_FLOW_TIMEOUT		HZ
+
+struct ip_flow_key {
+	struct net		*net;
+	__be32			saddr;
+	__be32			daddr;
+	__be16			sport;
+	__be16			dport;
+	int			iif;
+	u8			protocol;
+};
+
+struct ip_flow {
+	struct ip_flow_key	key;
+	struct dst_entry	*dst;
+	unsigned long		expires;
+	struct rcu_head		rcu;
+};
+
+int sysctl_ip_flow_cache __read_mostly;
+
+static struct ip_flow __rcu *ip_flow_table[IP_FLOW_CACHE_SIZE];
+static DEFINE_SPINLOCK(ip_flow_lock);
+
+/* Fill in the key from a header-only IPv4 packet, false if uncacheable */
+static bool ip_flow_key(const struct sk_buff *skb, struct ip_flow_key *key)
+{
+	const struct iphdr *iph = ip_hdr(skb);
+	union {
+		struct tcphdr tcp;
+		struct udphdr udp;
+	} _hdr;
+	const void *hp;
+
+	if (iph->ihl != 5 || ip_is_fragment(iph))
+		return false;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		hp = skb_header_pointer(skb, sizeof(*iph),
+					sizeof(struct tcphdr), &_hdr);
+		if (!hp)
+			return false;
+		if (((const struct tcphdr *)hp)->syn ||
+		    ((const struct tcphdr *)hp)->fin ||
+		    ((const struct tcphdr *)hp)->rst)
+			return false;
+		break;
+	case IPPROTO_UDP:
+		hp = skb_header_pointer(skb, sizeof(*iph),
+					sizeof(struct udphdr), &_hdr);
+		if (!hp)
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	/* source and dest ports lead both headers */
+	key->sport = ((const struct udphdr *)hp)->source;
+	key->dport = ((const struct udphdr *)hp)->dest;
+	key->saddr = iph->saddr;
+	key->daddr = iph->daddr;
+	key->protocol = iph->protocol;
+	return true;
+}
+
+static inline unsigned int ip_flow_hash(const struct ip_flow_key *key)
+{
+	u32 ports = ((__force u32)key->sport << 16) | (__force u32)key->dport;
+
+	return jhash_3words((__force u32)key->saddr, (__force u32)key->daddr,
+			    ports ^ key->protocol,
+			    key->iif ^ net_hash_mix(key->net)) &
+	       (IP_FLOW_CACHE_SIZE - 1);
+}
+
+static inline bool ip_flow_key_eq(const struct ip_flow_key *a,
+				  const struct ip_flow_key *b)
+{
+	return a->net == b->net &&
+	       a->saddr == b->saddr && a->daddr == b->daddr &&
+	       a->sport == b->sport && a->dport == b->dport &&
+	       a->iif == b->iif && a->protocol == b->protocol;
+}
+
+static void ip_flow_free_rcu(struct rcu_head *head)
+{
+	struct ip_flow *flow = container_of(head, struct ip_flow, rcu);
+
+	dst_release(flow->dst);
+	kfree(flow);
+}
+
+static void ip_flow_replace(unsigned int slot, struct ip_flow *flow)
+{
+	struct ip_flow *old;
+
+	spin_lock_bh(&ip_flow_lock);
+	old = rcu_dereference_protected(ip_flow_table[slot],
+					lockdep_is_held(&ip_flow_lock));
+	rcu_assign_pointer(ip_flow_table[slot], flow);
+	spin_unlock_bh(&ip_flow_lock);
+
+	if (old)
+		call_rcu(&old->rcu, ip_flow_free_rcu);
+}
+
+/*
+ * Called from ip_rcv() before the PRE_ROUTING hook.  Returns true if the
+ * packet has been consumed.
+ */
+bool ip_flow_cache_xmit(struct sk_buff *skb)
+{
+	struct ip_flow_key key;
+	struct ip_flow *flow;
+	struct dst_entry *dst;
+	struct net_device *dev;
+	struct neighbour *neigh;
+	struct iphdr *iph;
+	u32 nexthop;
+
+	if (!sysctl_ip_flow_cache || skb->pkt_type != PACKET_HOST ||
+	    skb_is_gso(skb) || ip_hdr(skb)->ttl <= 1)
+		return false;
+	if (!ip_flow_key(skb, &key))
+		return false;
+	key.iif = skb->dev->ifindex;
+	key.net = dev_net(skb->dev);
+
+	flow = rcu_dereference(ip_flow_table[ip_flow_hash(&key)]);
+	if (!flow || !ip_flow_key_eq(&flow->key, &key) ||
+	    time_after(jiffies, READ_ONCE(flow->expires)))
+		return false;
+
+	dst = dst_check(flow->dst, 0);
+	if (!dst)
+		return false;
+	dev = dst->dev;
+	if (unlikely(!(dev->flags & IFF_UP) || skb->len > dst_mtu(dst)))
+		return false;
+
+	if (skb_cow(skb, LL_RESERVED_SPACE(dev) + dst->header_len))
+		return false;
+
+	skb_forward_csum(skb);
+	iph = ip_hdr(skb);
+	ip_decrease_ttl(iph);
+	skb->priority = rt_tos2priority(iph->tos);
+	IPCB(skb)->flags |= IPSKB_FORWARDED;
+
+	skb_dst_drop(skb);
+	dst_hold(dst);
+	skb_dst_set(skb, dst);
+	skb->dev = dev;
+	skb->protocol = htons(ETH_P_IP);
+	skb_sender_cpu_clear(skb);
+
+	NET_INC_STATS_BH(dev_net(dev), LINUX_MIB_IPFLOWCACHEHIT);
+	IP_INC_STATS_BH(dev_net(dev), IPSTATS_MIB_OUTFORWDATAGRAMS);
+	IP_ADD_STATS_BH(dev_net(dev), IPSTATS_MIB_OUTOCTETS, skb->len);
+
+	rcu_read_lock_bh();
+	nexthop = (__force u32) rt_nexthop((struct rtable *)dst, iph->daddr);
+	neigh = __ipv4_neigh_lookup_noref(dev, nexthop);
+	if (unlikely(!neigh))
+		neigh = __neigh_create(&arp_tbl, &nexthop, dev, false);
+	if (!IS_ERR(neigh))
+		dst_neigh_output(dst, neigh, skb);
+	else
+		kfree_skb(skb);
+	rcu_read_unlock_bh();
+
+	return true;
+}
+
+/*
+ * Called from ip_finish_output() for forwarded packets, once the FORWARD
+ * and POST_ROUTING hooks have accepted skb.
+ */
+void ip_flow_cache_learn(struct sk_buff *skb)
+{
+	struct rtable *rt = skb_rtable(skb);
+	enum ip_conntrack_info ctinfo;
+	struct ip_flow_key key;
+	struct ip_flow *flow;
+	struct nf_conn *ct;
+	unsigned int slot;
+
+	if (!sysctl_ip_flow_cache || rt->rt_type != RTN_UNICAST ||
+	    rt->dst.xfrm || (IPCB(skb)->flags & IPSKB_DOREDIRECT))
+		return;
+
+	/* the ruleset marks this flow, keep it on the full path */
+	if (skb->mark)
+		return;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || (ctinfo != IP_CT_ESTABLISHED &&
+		    ctinfo != IP_CT_ESTABLISHED_REPLY) ||
+	    (ct->status & IPS_NAT_MASK))
+		return;
+
+	/* helpers must see every packet to set up RELATED expectations */
+	if (nfct_help(ct) || ct->master)
+		return;
+
+	if (!ip_flow_key(skb, &key))
+		return;
+	key.iif = skb->skb_iif;
+	key.net = dev_net(rt->dst.dev);
+	slot = ip_flow_hash(&key);
+
+	rcu_read_lock();
+	flow = rcu_dereference(ip_flow_table[slot]);
+	if (flow && ip_flow_key_eq(&flow->key, &key) &&
+	    flow->dst == &rt->dst) {
+		WRITE_ONCE(flow->expires, jiffies + IP_FLOW_TIMEOUT);
+		rcu_read_unlock();
+		return;
+	}
+	rcu_read_unlock();
+
+	flow = kmalloc(sizeof(*flow), GFP_ATOMIC);
+	if (!flow)
+		return;
+	flow->key = key;
+	flow->dst = dst_clone(&rt->dst);
+	flow->expires = jiffies + IP_FLOW_TIMEOUT;
+
+	if (key.protocol == IPPROTO_TCP) {
+		spin_lock_bh(&ct->lock);
+		ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		ct->proto.tcp.seen[1].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		spin_unlock_bh(&ct->lock);
+	}
+
+	ip_flow_replace(slot, flow);
+	NET_INC_STATS_BH(dev_net(rt->dst.dev), LINUX_MIB_IPFLOWCACHEADD);
+}
+
+/* Cached routes pin their device, drop them all when one goes away */
+static int ip_flow_cache_netdev_event(struct notifier_block *this,
+				      unsigned long event, void *ptr)
+{
+	unsigned int i;
+
+	if (event != NETDEV_DOWN && event != NETDEV_UNREGISTER)
+		return NOTIFY_DONE;
+
+	for (i = 0; i < IP_FLOW_CACHE_SIZE; i++)
+		if (rcu_access_pointer(ip_flow_table[i]))
+			ip_flow_replace(i, NULL);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block ip_flow_cache_notifier = {
+	.notifier_call	= ip_flow_cache_netdev_event,
+};
+
+static int __init ip_flow_cache_init(void)
+{
+	return register_netdevice_notifier(&ip_flow_cache_notifier);
+}
+fs_initcall(ip_flow_cache_init);
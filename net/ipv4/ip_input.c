@@ -452,6 +452,9 @@ int ip_rcv(struct sk_buff *skb, struct net_device *dev, struct packet_type *pt,
 	/* Must drop socket now because of tproxy. */
 	skb_orphan(skb);
 
+	if (ip_flow_cache_xmit(skb))
+		return NET_RX_SUCCESS;
+
 	return NF_HOOK(NFPROTO_IPV4, NF_INET_PRE_ROUTING, NULL, skb,
 		       dev, NULL,
 		       ip_rcv_finish);
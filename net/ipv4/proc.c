@@ -298,6 +298,10 @@ static const struct snmp_mib snmp4_net_list[] = {
 	SNMP_MIB_ITEM("TCPACKSkippedFinWait2", LINUX_MIB_TCPACKSKIPPEDFINWAIT2),
 	SNMP_MIB_ITEM("TCPACKSkippedTimeWait", LINUX_MIB_TCPACKSKIPPEDTIMEWAIT),
 	SNMP_MIB_ITEM("TCPACKSkippedChallenge", LINUX_MIB_TCPACKSKIPPEDCHALLENGE),
+	SNMP_MIB_ITEM("IPFlowCacheAdd", LINUX_MIB_IPFLOWCACHEADD),
+	SNMP_MIB_ITEM("IPFlowCacheHit", LINUX_MIB_IPFLOWCACHEHIT),
+	SNMP_MIB_ITEM("TCPSendPage", LINUX_MIB_TCPSENDPAGE),
+	SNMP_MIB_ITEM("TCPSendPageCopy", LINUX_MIB_TCPSENDPAGECOPY),
 	SNMP_MIB_SENTINEL
 };
 
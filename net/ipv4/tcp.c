@@ -995,11 +995,15 @@ int tcp_sendpage(struct sock *sk, struct page *page, int offset,
 {
 	ssize_t res;
 
+	/* Without SG and checksum offload the page has to be copied */
 	if (!(sk->sk_route_caps & NETIF_F_SG) ||
-	    !(sk->sk_route_caps & NETIF_F_ALL_CSUM))
+	    !(sk->sk_route_caps & NETIF_F_ALL_CSUM)) {
+		NET_INC_STATS(sock_net(sk), LINUX_MIB_TCPSENDPAGECOPY);
 		return sock_no_sendpage(sk->sk_socket, page, offset, size,
 					flags);
+	}
 
+	NET_INC_STATS(sock_net(sk), LINUX_MIB_TCPSENDPAGE);
 	lock_sock(sk);
 	res = do_tcp_sendpages(sk, page, offset, size, flags);
 	release_sock(sk);
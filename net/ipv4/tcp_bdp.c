@@ -0,0 +1,331 @@
+/*
+ * TCP BDP: bandwidth-delay product based congestion control.
+ *
+ * A reduced take on the BBR model.  The sender estimates the bottleneck
+ * bandwidth as the windowed maximum of the delivery rate, and the path
+ * delay as the windowed minimum of the RTT.  Pacing rate and cwnd are
+ * both sized from their product instead of from loss, which keeps the
+ * pipe full without building a standing queue in deep buffers such as
+ * those of cellular modems.
+ *
+ * The state machine follows BBR: STARTUP doubles the rate each round
+ * until the bandwidth stops growing, DRAIN empties the queue built
+ * meanwhile, PROBE_BW cycles the pacing gain around 1 to track changes
+ * and PROBE_RTT briefly shrinks cwnd to re-measure the path delay once
+ * the minimum RTT gets stale.
+ *
+ * This kernel has no per-skb delivery rate sampling, so the delivery
+ * rate is taken from the ACK stream over rounds of one minimum RTT.
+ * The module sets TCP_CONG_PACING so TCP enforces the pacing rate
+ * itself, no sch_fq needed.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ */
+
+#include <linux/module.h>
+#include <linux/random.h>
+#include <net/tcp.h>
+
+#define BDP_SCALE		8	/* gains are in units of 1/256 */
+#define BDP_UNIT		(1 << BDP_SCALE)
+#define BW_SCALE		24	/* bw is in packets per usec << 24 */
+
+#define BDP_BW_ROUNDS		10	/* max bw filter length, in rounds */
+#define BDP_MIN_RTT_WIN		(10 * HZ)
+#define BDP_PROBE_RTT_MS	200
+#define BDP_MIN_ROUND_US	1000
+#define BDP_MIN_CWND		4
+#define BDP_FULL_BW_ROUNDS	3
+
+enum bdp_mode {
+	BDP_STARTUP,
+	BDP_DRAIN,
+	BDP_PROBE_BW,
+	BDP_PROBE_RTT,
+};
+
+/* 2/ln(2): the smallest gain that doubles the delivery rate each round */
+static const int bdp_high_gain = BDP_UNIT * 2885 / 1000 + 1;
+static const int bdp_drain_gain = BDP_UNIT * 1000 / 2885;
+static const int bdp_cwnd_gain = BDP_UNIT * 2;
+static const int bdp_pacing_gain[] = {
+	BDP_UNIT * 5 / 4,	/* probe for more bandwidth */
+	BDP_UNIT * 3 / 4,	/* drain the queue that may have built */
+	BDP_UNIT, BDP_UNIT, BDP_UNIT, BDP_UNIT, BDP_UNIT, BDP_UNIT,
+};
+#define BDP_CYCLE_LEN		ARRAY_SIZE(bdp_pacing_gain)
+
+struct bdp {
+	u32	min_rtt_us;
+	u32	min_rtt_stamp;		/* tcp_time_stamp of min_rtt_us */
+	u32	bw;			/* max delivery rate, BW_SCALE */
+	u32	bw_round;		/* round in which bw was measured */
+	u32	full_bw;		/* bw at the last STARTUP growth */
+	u32	round;			/* delivery rate rounds so far */
+	u32	round_start_us;
+	u32	round_delivered;	/* packets acked in this round */
+	u32	probe_rtt_done;		/* tcp_time_stamp to leave PROBE_RTT */
+	u32	prior_cwnd;		/* cwnd on entering PROBE_RTT */
+	u8	mode;
+	u8	full_bw_cnt;		/* rounds without bw growth */
+	u8	cycle_idx;
+};
+
+static inline u32 bdp_now_us(void)
+{
+	return (u32)div_u64(local_clock(), NSEC_PER_USEC);
+}
+
+/* cwnd that holds gain times the estimated bandwidth-delay product */
+static u32 bdp_target_cwnd(const struct sock *sk, int gain)
+{
+	const struct bdp *bdp = inet_csk_ca(sk);
+	u64 w;
+
+	if (!bdp->bw || bdp->min_rtt_us == ~0U)
+		return tcp_sk(sk)->snd_cwnd;
+
+	w = ((u64)bdp->bw * bdp->min_rtt_us) >> BW_SCALE;
+	w = (w * gain) >> BDP_SCALE;
+
+	/* room for delayed and stretched ACKs */
+	return max_t(u32, w + 3, BDP_MIN_CWND);
+}
+
+static int bdp_pacing_gain_now(const struct bdp *bdp)
+{
+	switch (bdp->mode) {
+	case BDP_STARTUP:
+		return bdp_high_gain;
+	case BDP_DRAIN:
+		return bdp_drain_gain;
+	case BDP_PROBE_BW:
+		return bdp_pacing_gain[bdp->cycle_idx];
+	default:
+		return BDP_UNIT;
+	}
+}
+
+static void bdp_set_pacing_rate(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct bdp *bdp = inet_csk_ca(sk);
+	int gain = bdp_pacing_gain_now(bdp);
+	u64 rate;
+
+	if (bdp->bw) {
+		rate = (u64)bdp->bw * tp->mss_cache * USEC_PER_SEC;
+		rate = (rate * gain) >> (BW_SCALE + BDP_SCALE);
+	} else if (tp->srtt_us) {
+		/* no sample yet: cwnd per smoothed RTT, like tcp_input.c */
+		rate = (u64)tp->mss_cache * tp->snd_cwnd * (USEC_PER_SEC << 3);
+		rate = (rate * gain) >> BDP_SCALE;
+		do_div(rate, tp->srtt_us);
+	} else {
+		return;
+	}
+
+	ACCESS_ONCE(sk->sk_pacing_rate) = min_t(u64, rate,
+						sk->sk_max_pacing_rate);
+}
+
+static void bdp_enter_probe_bw(struct bdp *bdp)
+{
+	bdp->mode = BDP_PROBE_BW;
+	/* never start in the draining phase */
+	bdp->cycle_idx = 2 + prandom_u32_max(BDP_CYCLE_LEN - 2);
+}
+
+static void bdp_update_min_rtt(struct sock *sk, s32 rtt_us)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bdp *bdp = inet_csk_ca(sk);
+	bool expired;
+
+	expired = after(tcp_time_stamp, bdp->min_rtt_stamp + BDP_MIN_RTT_WIN);
+	if (rtt_us > 0 && ((u32)rtt_us <= bdp->min_rtt_us || expired)) {
+		bdp->min_rtt_us = rtt_us;
+		bdp->min_rtt_stamp = tcp_time_stamp;
+	}
+
+	if (expired && bdp->mode != BDP_PROBE_RTT) {
+		bdp->mode = BDP_PROBE_RTT;
+		bdp->prior_cwnd = tp->snd_cwnd;
+		bdp->probe_rtt_done = tcp_time_stamp +
+				      msecs_to_jiffies(BDP_PROBE_RTT_MS);
+	} else if (bdp->mode == BDP_PROBE_RTT &&
+		   after(tcp_time_stamp, bdp->probe_rtt_done)) {
+		bdp->min_rtt_stamp = tcp_time_stamp;
+		tp->snd_cwnd = max(tp->snd_cwnd, bdp->prior_cwnd);
+		if (bdp->full_bw_cnt >= BDP_FULL_BW_ROUNDS)
+			bdp_enter_probe_bw(bdp);
+		else
+			bdp->mode = BDP_STARTUP;
+	}
+}
+
+static void bdp_round_done(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	struct bdp *bdp = inet_csk_ca(sk);
+
+	switch (bdp->mode) {
+	case BDP_STARTUP:
+		/* the pipe is full once bw stops growing by 25% a round */
+		if (bdp->bw >= bdp->full_bw + (bdp->full_bw >> 2)) {
+			bdp->full_bw = bdp->bw;
+			bdp->full_bw_cnt = 0;
+		} else if (++bdp->full_bw_cnt >= BDP_FULL_BW_ROUNDS) {
+			bdp->mode = BDP_DRAIN;
+		}
+		break;
+	case BDP_DRAIN:
+		if (tp->packets_out <= bdp_target_cwnd(sk, BDP_UNIT))
+			bdp_enter_probe_bw(bdp);
+		break;
+	case BDP_PROBE_BW:
+		bdp->cycle_idx = (bdp->cycle_idx + 1) % BDP_CYCLE_LEN;
+		break;
+	}
+}
+
+static void bdp_update_bw(struct sock *sk, u32 num_acked)
+{
+	struct bdp *bdp = inet_csk_ca(sk);
+	u32 now = bdp_now_us();
+	u32 elapsed, bw;
+
+	bdp->round_delivered += num_acked;
+	elapsed = now - bdp->round_start_us;
+	if (elapsed < max_t(u32, bdp->min_rtt_us == ~0U ? 0 : bdp->min_rtt_us,
+			    BDP_MIN_ROUND_US))
+		return;
+
+	bw = div_u64((u64)bdp->round_delivered << BW_SCALE, elapsed);
+	bdp->round++;
+	bdp->round_start_us = now;
+	bdp->round_delivered = 0;
+
+	/* an application limited round says nothing about the path */
+	if (bw >= bdp->bw ||
+	    (tcp_is_cwnd_limited(sk) &&
+	     bdp->round - bdp->bw_round > BDP_BW_ROUNDS)) {
+		bdp->bw = bw;
+		bdp->bw_round = bdp->round;
+	}
+
+	bdp_round_done(sk);
+}
+
+static void bdp_pkts_acked(struct sock *sk, u32 num_acked, s32 rtt_us)
+{
+	bdp_update_min_rtt(sk, rtt_us);
+	bdp_update_bw(sk, num_acked);
+	bdp_set_pacing_rate(sk);
+}
+
+static void bdp_cong_avoid(struct sock *sk, u32 ack, u32 acked)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bdp *bdp = inet_csk_ca(sk);
+	u32 target, cwnd;
+
+	if (!bdp->bw) {
+		if (tcp_is_cwnd_limited(sk))
+			tcp_slow_start(tp, acked);
+		return;
+	}
+
+	if (bdp->mode == BDP_PROBE_RTT)
+		target = BDP_MIN_CWND;
+	else
+		target = bdp_target_cwnd(sk, bdp->mode == BDP_PROBE_BW ?
+					 bdp_cwnd_gain : bdp_high_gain);
+
+	cwnd = tp->snd_cwnd;
+	if (cwnd < target)
+		cwnd = min(cwnd + acked, target);
+	else
+		cwnd = target;
+
+	tp->snd_cwnd = min(cwnd, tp->snd_cwnd_clamp);
+}
+
+/* Loss is not the congestion signal: recover to the model's window */
+static u32 bdp_ssthresh(struct sock *sk)
+{
+	const struct bdp *bdp = inet_csk_ca(sk);
+
+	if (!bdp->bw)
+		return tcp_reno_ssthresh(sk);
+	return bdp_target_cwnd(sk, BDP_UNIT);
+}
+
+static u32 bdp_undo_cwnd(struct sock *sk)
+{
+	return tcp_sk(sk)->snd_cwnd;
+}
+
+static void bdp_set_state(struct sock *sk, u8 new_state)
+{
+	struct bdp *bdp = inet_csk_ca(sk);
+
+	/* an RTO collapses cwnd: do not count the stall as a rate sample */
+	if (new_state == TCP_CA_Loss) {
+		bdp->round_start_us = bdp_now_us();
+		bdp->round_delivered = 0;
+	}
+}
+
+static void bdp_init(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bdp *bdp = inet_csk_ca(sk);
+
+	bdp->min_rtt_us = tp->srtt_us ? tp->srtt_us >> 3 : ~0U;
+	bdp->min_rtt_stamp = tcp_time_stamp;
+	bdp->bw = 0;
+	bdp->bw_round = 0;
+	bdp->full_bw = 0;
+	bdp->full_bw_cnt = 0;
+	bdp->round = 0;
+	bdp->round_start_us = bdp_now_us();
+	bdp->round_delivered = 0;
+	bdp->mode = BDP_STARTUP;
+	bdp->cycle_idx = 0;
+
+	bdp_set_pacing_rate(sk);
+}
+
+static struct tcp_congestion_ops tcp_bdp __read_mostly = {
+	.flags		= TCP_CONG_NON_RESTRICTED | TCP_CONG_PACING,
+	.init		= bdp_init,
+	.ssthresh	= bdp_ssthresh,
+	.cong_avoid	= bdp_cong_avoid,
+	.set_state	= bdp_set_state,
+	.undo_cwnd	= bdp_undo_cwnd,
+	.pkts_acked	= bdp_pkts_acked,
+
+	.owner		= THIS_MODULE,
+	.name		= "bdp",
+};
+
+static int __init bdp_register(void)
+{
+	BUILD_BUG_ON(sizeof(struct bdp) > ICSK_CA_PRIV_SIZE);
+	return tcp_register_congestion_control(&tcp_bdp);
+}
+
+static void __exit bdp_unregister(void)
+{
+	tcp_unregister_congestion_control(&tcp_bdp);
+}
+
+module_init(bdp_register);
+module_exit(bdp_unregister);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("TCP BDP (BBR-style delivery rate and min RTT model)");
@@ -222,7 +222,7 @@ ieee80211_agg_start_txq(struct sta_info *sta, int tid, bool enable)
 		clear_bit(IEEE80211_TXQ_AMPDU, &txqi->flags);
 
 	clear_bit(IEEE80211_TXQ_STOP, &txqi->flags);
-	drv_wake_tx_queue(sta->sdata->local, txqi);
+	ieee80211_schedule_txq(sta->sdata->local, txqi);
 }
 
 /*
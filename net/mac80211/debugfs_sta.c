@@ -391,6 +391,51 @@ static ssize_t sta_last_rx_rate_read(struct file *file, char __user *userbuf,
 }
 STA_OPS(last_rx_rate);
 
+static ssize_t sta_airtime_read(struct file *file, char __user *userbuf,
+				size_t count, loff_t *ppos)
+{
+	static const char * const ac_names[IEEE80211_NUM_ACS] = {
+		"VO", "VI", "BE", "BK"
+	};
+	struct sta_info *sta = file->private_data;
+	struct ieee80211_local *local = sta->local;
+	char buf[100 * (IEEE80211_NUM_ACS + 1)], *p = buf;
+	u32 sojourn[IEEE80211_NUM_ACS] = {}, max[IEEE80211_NUM_ACS] = {};
+	u32 drops[IEEE80211_NUM_ACS] = {};
+	u64 airtime;
+	s32 deficit;
+	int i, ac;
+
+	/* the delay of an AC is that of its busiest TID */
+	for (i = 0; sta->sta.txq[0] && i < IEEE80211_NUM_TIDS; i++) {
+		struct txq_info *txqi = to_txq_info(sta->sta.txq[i]);
+
+		ac = txqi->txq.ac;
+		sojourn[ac] = max_t(u32, sojourn[ac], txqi->codel.sojourn);
+		max[ac] = max_t(u32, max[ac], txqi->codel.max_sojourn);
+		drops[ac] += txqi->codel.drops;
+	}
+
+	p += scnprintf(p, sizeof(buf) + buf - p,
+		       "AC airtime-us deficit-us delay-us max-delay-us drops\n");
+	for (ac = 0; ac < IEEE80211_NUM_ACS; ac++) {
+		spin_lock_bh(&local->active_txq_lock);
+		airtime = sta->airtime[ac].tx_airtime;
+		deficit = sta->airtime[ac].deficit;
+		spin_unlock_bh(&local->active_txq_lock);
+
+		p += scnprintf(p, sizeof(buf) + buf - p,
+			       "%s %llu %d %llu %llu %u\n", ac_names[ac],
+			       airtime, deficit,
+			       div_u64((u64)sojourn[ac] << 10, NSEC_PER_USEC),
+			       div_u64((u64)max[ac] << 10, NSEC_PER_USEC),
+			       drops[ac]);
+	}
+
+	return simple_read_from_buffer(userbuf, count, ppos, buf, p - buf);
+}
+STA_OPS(airtime);
+
 #define DEBUGFS_ADD(name) \
 	debugfs_create_file(#name, 0400, \
 		sta->debugfs.dir, sta, &sta_ ##name## _ops);
@@ -444,6 +489,7 @@ void ieee80211_sta_debugfs_add(struct sta_info *sta)
 	DEBUGFS_ADD(last_ack_signal);
 	DEBUGFS_ADD(current_tx_rate);
 	DEBUGFS_ADD(last_rx_rate);
+	DEBUGFS_ADD(airtime);
 
 	DEBUGFS_ADD_COUNTER(rx_packets, rx_packets);
 	DEBUGFS_ADD_COUNTER(tx_packets, tx_packets);
@@ -813,9 +813,26 @@ enum txq_info_flags {
 	IEEE80211_TXQ_AMPDU,
 };
 
+/*
+ * CoDel state and delay statistics of an intermediate TX queue, times in
+ * the 1024 ns units of include/net/codel.h
+ */
+struct txq_codel {
+	u32 first_above_time;
+	u32 drop_next;
+	u32 count;
+	bool dropping;
+
+	u32 sojourn;		/* of the last dequeued frame */
+	u32 max_sojourn;
+	u32 drops;
+};
+
 struct txq_info {
 	struct sk_buff_head queue;
 	unsigned long flags;
+	struct list_head schedule_order;
+	struct txq_codel codel;
 
 	/* keep last! */
 	struct ieee80211_txq txq;
@@ -1100,6 +1117,10 @@ enum mac80211_scan_state {
 };
 
 struct ieee80211_local {
+	/* software TX queues with frames pending, by AC, for next_txq() */
+	struct list_head active_txqs[IEEE80211_NUM_ACS];
+	spinlock_t active_txq_lock;
+
 	/* embed the driver visible part.
 	 * don't cast (use the static inlines below), but we keep
 	 * it first anyway so they become a no-op */
@@ -1924,6 +1945,10 @@ static inline bool ieee80211_can_run_worker(struct ieee80211_local *local)
 void ieee80211_init_tx_queue(struct ieee80211_sub_if_data *sdata,
 			     struct sta_info *sta,
 			     struct txq_info *txq, int tid);
+void ieee80211_schedule_txq(struct ieee80211_local *local,
+			    struct txq_info *txqi);
+void ieee80211_unschedule_txq(struct ieee80211_local *local,
+			      struct txq_info *txqi);
 void ieee80211_send_auth(struct ieee80211_sub_if_data *sdata,
 			 u16 transaction, u16 auth_alg, u16 status,
 			 const u8 *extra, size_t extra_len, const u8 *bssid,
@@ -980,6 +980,7 @@ static void ieee80211_do_stop(struct ieee80211_sub_if_data *sdata,
 	if (sdata->vif.txq) {
 		struct txq_info *txqi = to_txq_info(sdata->vif.txq);
 
+		ieee80211_unschedule_txq(local, txqi);
 		ieee80211_purge_tx_queue(&local->hw, &txqi->queue);
 		atomic_set(&sdata->txqs_len[txqi->txq.ac], 0);
 	}
@@ -112,6 +112,7 @@ static void __cleanup_single_sta(struct sta_info *sta)
 			struct txq_info *txqi = to_txq_info(sta->sta.txq[i]);
 			int n = skb_queue_len(&txqi->queue);
 
+			ieee80211_unschedule_txq(local, txqi);
 			ieee80211_purge_tx_queue(&local->hw, &txqi->queue);
 			atomic_sub(n, &sdata->txqs_len[txqi->txq.ac]);
 		}
@@ -1156,7 +1157,7 @@ void ieee80211_sta_ps_deliver_wakeup(struct sta_info *sta)
 			if (!skb_queue_len(&txqi->queue))
 				continue;
 
-			drv_wake_tx_queue(local, txqi);
+			ieee80211_schedule_txq(local, txqi);
 		}
 	}
 
@@ -292,6 +292,9 @@ struct sta_ampdu_mlme {
  * @tx_filtered_count: number of frames the hardware filtered for this STA
  * @tx_retry_failed: number of frames that failed retry
  * @tx_retry_count: total number of retries for frames to this STA
+ * @airtime: per-AC airtime used by frames to this STA, in usecs, and its
+ *	deficit in the airtime fair scheduling of the software TX queues;
+ *	protected by local->active_txq_lock
  * @fail_avg: moving percentage of failed MSDUs
  * @tx_packets: number of RX/TX MSDUs
  * @tx_bytes: number of bytes transmitted to this STA
@@ -396,6 +399,10 @@ struct sta_info {
 	/* Updated from TX status path only, no locking requirements */
 	unsigned long tx_filtered_count;
 	unsigned long tx_retry_failed, tx_retry_count;
+	struct {
+		u64 tx_airtime;
+		s32 deficit;
+	} airtime[IEEE80211_NUM_ACS];
 	/* moving percentage of failed MSDUs */
 	unsigned int fail_avg;
 
@@ -588,6 +588,48 @@ static int ieee80211_tx_get_rates(struct ieee80211_hw *hw,
 	return rates_idx;
 }
 
+/* preamble, SIFS and ACK of each transmission attempt, usecs */
+#define IEEE80211_AIRTIME_OVERHEAD	100
+
+/*
+ * Charge a data frame to the airtime of its station: the time the driver
+ * measured if it reports one, otherwise an estimate from the final rate,
+ * as if every attempt had been made at it.
+ */
+static void ieee80211_sta_tx_airtime(struct ieee80211_local *local,
+				     struct sta_info *sta, struct sk_buff *skb,
+				     int rates_idx, int retry_count)
+{
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	struct rate_info rinfo;
+	u32 airtime = info->status.tx_time;
+	u16 rate;
+	u8 ac;
+
+	if (!sta->sta.txq[0])
+		return;
+
+	if (!airtime && rates_idx >= 0) {
+		sta_set_rate_info_tx(sta, &info->status.rates[rates_idx],
+				     &rinfo);
+		rate = cfg80211_calculate_bitrate(&rinfo);
+		/* rate is in 100 kbit/s */
+		if (rate)
+			airtime = (retry_count + 1) *
+				  (IEEE80211_AIRTIME_OVERHEAD +
+				   skb->len * 80 / rate);
+	}
+	if (!airtime)
+		return;
+
+	ac = ieee802_1d_to_ac[skb->priority & 7];
+
+	spin_lock_bh(&local->active_txq_lock);
+	sta->airtime[ac].tx_airtime += airtime;
+	sta->airtime[ac].deficit -= airtime;
+	spin_unlock_bh(&local->active_txq_lock);
+}
+
 void ieee80211_tx_status_noskb(struct ieee80211_hw *hw,
 			       struct ieee80211_sta *pubsta,
 			       struct ieee80211_tx_info *info)
@@ -759,6 +801,9 @@ void ieee80211_tx_status(struct ieee80211_hw *hw, struct sk_buff *skb)
 				if (!acked)
 					sta->tx_msdu_failed[tid]++;
 				sta->tx_msdu_retries[tid] += retry_count;
+				ieee80211_sta_tx_airtime(local, sta, skb,
+							 rates_idx,
+							 retry_count);
 			}
 		}
 
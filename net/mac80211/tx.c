@@ -1215,6 +1215,185 @@ ieee80211_tx_prepare(struct ieee80211_sub_if_data *sdata,
 	return TX_CONTINUE;
 }
 
+/*
+ * Software TX queue management.  Times are kept in the 1024 ns units of
+ * include/net/codel.h, which cannot be used directly as it is tied to a
+ * Qdisc.
+ */
+#define IEEE80211_CODEL_SHIFT		10
+#define IEEE80211_CODEL_TARGET		((5 * NSEC_PER_MSEC) >> \
+					 IEEE80211_CODEL_SHIFT)
+#define IEEE80211_CODEL_INTERVAL	((100 * NSEC_PER_MSEC) >> \
+					 IEEE80211_CODEL_SHIFT)
+
+/* airtime a station may use per round of the scheduler, usecs */
+#define IEEE80211_AIRTIME_QUANTUM	300
+
+static inline u32 ieee80211_txq_time(void)
+{
+	return ktime_get_ns() >> IEEE80211_CODEL_SHIFT;
+}
+
+static inline bool ieee80211_txq_time_after_eq(u32 a, u32 b)
+{
+	return (s32)(a - b) >= 0;
+}
+
+static u32 ieee80211_codel_control_law(u32 t, u32 count)
+{
+	return t + IEEE80211_CODEL_INTERVAL / int_sqrt(count);
+}
+
+/*
+ * Whether skb, dequeued at now, stood in the queue for too long.  The last
+ * frame of a queue is never dropped, so a station is not starved entirely.
+ */
+static bool ieee80211_codel_should_drop(struct txq_info *txqi,
+					struct sk_buff *skb, u32 now)
+{
+	struct txq_codel *cv = &txqi->codel;
+	u32 sojourn = now - IEEE80211_SKB_CB(skb)->control.enqueue_time;
+
+	cv->sojourn = sojourn;
+	if (sojourn > cv->max_sojourn)
+		cv->max_sojourn = sojourn;
+
+	if (sojourn < IEEE80211_CODEL_TARGET ||
+	    skb_queue_empty(&txqi->queue)) {
+		cv->first_above_time = 0;
+		return false;
+	}
+
+	if (!cv->first_above_time) {
+		cv->first_above_time = (now + IEEE80211_CODEL_INTERVAL) | 1;
+		return false;
+	}
+
+	return ieee80211_txq_time_after_eq(now, cv->first_above_time);
+}
+
+/* Called with txqi->queue.lock held, dropped frames go to the drop list */
+static struct sk_buff *ieee80211_codel_dequeue(struct txq_info *txqi,
+					       struct sk_buff_head *drops)
+{
+	struct txq_codel *cv = &txqi->codel;
+	u32 now = ieee80211_txq_time();
+	struct sk_buff *skb;
+	bool drop;
+
+	skb = __skb_dequeue(&txqi->queue);
+	if (!skb)
+		return NULL;
+
+	drop = ieee80211_codel_should_drop(txqi, skb, now);
+
+	if (cv->dropping) {
+		if (!drop) {
+			cv->dropping = false;
+			return skb;
+		}
+
+		while (cv->dropping &&
+		       ieee80211_txq_time_after_eq(now, cv->drop_next)) {
+			__skb_queue_tail(drops, skb);
+			cv->count++;
+			skb = __skb_dequeue(&txqi->queue);
+			if (!ieee80211_codel_should_drop(txqi, skb, now))
+				cv->dropping = false;
+			else
+				cv->drop_next = ieee80211_codel_control_law(
+						cv->drop_next, cv->count);
+		}
+	} else if (drop) {
+		__skb_queue_tail(drops, skb);
+		skb = __skb_dequeue(&txqi->queue);
+		cv->dropping = true;
+
+		/* resume near the old drop rate if we dropped recently */
+		if (cv->count > 2 &&
+		    now - cv->drop_next < 16 * IEEE80211_CODEL_INTERVAL)
+			cv->count -= 2;
+		else
+			cv->count = 1;
+		cv->drop_next = ieee80211_codel_control_law(now, cv->count);
+	}
+
+	return skb;
+}
+
+/* Put txqi on the schedule of its AC and tell the driver about it */
+void ieee80211_schedule_txq(struct ieee80211_local *local,
+			    struct txq_info *txqi)
+{
+	spin_lock_bh(&local->active_txq_lock);
+	if (list_empty(&txqi->schedule_order))
+		list_add_tail(&txqi->schedule_order,
+			      &local->active_txqs[txqi->txq.ac]);
+	spin_unlock_bh(&local->active_txq_lock);
+
+	drv_wake_tx_queue(local, txqi);
+}
+
+void ieee80211_unschedule_txq(struct ieee80211_local *local,
+			      struct txq_info *txqi)
+{
+	spin_lock_bh(&local->active_txq_lock);
+	list_del_init(&txqi->schedule_order);
+	spin_unlock_bh(&local->active_txq_lock);
+}
+
+/*
+ * Deficit round robin over the queues of an AC: a station that used up
+ * its airtime goes to the back with a new quantum, so every station gets
+ * the same share of airtime whatever its rate.  The vif queue carries no
+ * station and is not accounted.
+ */
+struct ieee80211_txq *ieee80211_next_txq(struct ieee80211_hw *hw, u8 ac)
+{
+	struct ieee80211_local *local = hw_to_local(hw);
+	struct txq_info *txqi;
+	struct sta_info *sta;
+
+	spin_lock_bh(&local->active_txq_lock);
+
+	for (;;) {
+		txqi = list_first_entry_or_null(&local->active_txqs[ac],
+						struct txq_info,
+						schedule_order);
+		if (!txqi || !txqi->txq.sta)
+			break;
+
+		sta = container_of(txqi->txq.sta, struct sta_info, sta);
+		if (sta->airtime[ac].deficit >= 0)
+			break;
+
+		sta->airtime[ac].deficit += IEEE80211_AIRTIME_QUANTUM;
+		list_move_tail(&txqi->schedule_order, &local->active_txqs[ac]);
+	}
+
+	if (txqi)
+		list_del_init(&txqi->schedule_order);
+
+	spin_unlock_bh(&local->active_txq_lock);
+
+	return txqi ? &txqi->txq : NULL;
+}
+EXPORT_SYMBOL(ieee80211_next_txq);
+
+void ieee80211_return_txq(struct ieee80211_hw *hw, struct ieee80211_txq *txq)
+{
+	struct ieee80211_local *local = hw_to_local(hw);
+	struct txq_info *txqi = to_txq_info(txq);
+
+	spin_lock_bh(&local->active_txq_lock);
+	if (list_empty(&txqi->schedule_order) &&
+	    !skb_queue_empty(&txqi->queue))
+		list_add_tail(&txqi->schedule_order,
+			      &local->active_txqs[txq->ac]);
+	spin_unlock_bh(&local->active_txq_lock);
+}
+EXPORT_SYMBOL(ieee80211_return_txq);
+
 static void ieee80211_drv_tx(struct ieee80211_local *local,
 			     struct ieee80211_vif *vif,
 			     struct ieee80211_sta *pubsta,
@@ -1253,8 +1432,9 @@ static void ieee80211_drv_tx(struct ieee80211_local *local,
 	if (atomic_read(&sdata->txqs_len[ac]) >= local->hw.txq_ac_max_pending)
 		netif_stop_subqueue(sdata->dev, ac);
 
+	info->control.enqueue_time = ieee80211_txq_time();
 	skb_queue_tail(&txqi->queue, skb);
-	drv_wake_tx_queue(local, txqi);
+	ieee80211_schedule_txq(local, txqi);
 
 	return;
 
@@ -1269,19 +1449,22 @@ struct sk_buff *ieee80211_tx_dequeue(struct ieee80211_hw *hw,
 	struct ieee80211_sub_if_data *sdata = vif_to_sdata(txq->vif);
 	struct txq_info *txqi = container_of(txq, struct txq_info, txq);
 	struct ieee80211_hdr *hdr;
-	struct sk_buff *skb = NULL;
+	struct sk_buff *skb = NULL, *drop;
+	struct sk_buff_head drops;
 	u8 ac = txq->ac;
 
+	__skb_queue_head_init(&drops);
 	spin_lock_bh(&txqi->queue.lock);
 
 	if (test_bit(IEEE80211_TXQ_STOP, &txqi->flags))
 		goto out;
 
-	skb = __skb_dequeue(&txqi->queue);
+	skb = ieee80211_codel_dequeue(txqi, &drops);
 	if (!skb)
 		goto out;
 
-	atomic_dec(&sdata->txqs_len[ac]);
+	atomic_sub(skb_queue_len(&drops) + 1, &sdata->txqs_len[ac]);
+	txqi->codel.drops += skb_queue_len(&drops);
 	if (__netif_subqueue_stopped(sdata->dev, ac))
 		ieee80211_propagate_queue_wake(local, sdata->vif.hw_queue[ac]);
 
@@ -1301,6 +1484,9 @@ struct sk_buff *ieee80211_tx_dequeue(struct ieee80211_hw *hw,
 out:
 	spin_unlock_bh(&txqi->queue.lock);
 
+	while ((drop = __skb_dequeue(&drops)))
+		ieee80211_free_txskb(hw, drop);
+
 	return skb;
 }
 EXPORT_SYMBOL(ieee80211_tx_dequeue);
@@ -3333,6 +3333,7 @@ void ieee80211_init_tx_queue(struct ieee80211_sub_if_data *sdata,
 			     struct txq_info *txqi, int tid)
 {
 	skb_queue_head_init(&txqi->queue);
+	INIT_LIST_HEAD(&txqi->schedule_order);
 	txqi->txq.vif = &sdata->vif;
 
 	if (sta) {
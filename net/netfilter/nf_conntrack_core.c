@@ -413,18 +413,17 @@ ____nf_conntrack_find(struct net *net, u16 zone,
 	struct hlist_nulls_node *n;
 	unsigned int bucket = hash_bucket(hash, net);
 
-	/* Disable BHs the entire time since we normally need to disable them
-	 * at least once for the stats anyway.
+	/* Pure RCU walk: the stats are bumped with the interrupt safe
+	 * per-cpu ops instead of keeping BHs off for the whole lookup,
+	 * which only costs anything for locally generated traffic.
 	 */
-	local_bh_disable();
 begin:
 	hlist_nulls_for_each_entry_rcu(h, n, &net->ct.hash[bucket], hnnode) {
 		if (nf_ct_key_equal(h, tuple, zone)) {
-			NF_CT_STAT_INC(net, found);
-			local_bh_enable();
+			NF_CT_STAT_INC_ATOMIC(net, found);
 			return h;
 		}
-		NF_CT_STAT_INC(net, searched);
+		NF_CT_STAT_INC_ATOMIC(net, searched);
 	}
 	/*
 	 * if the nulls value we got at the end of this lookup is
@@ -432,10 +431,9 @@ begin:
 	 * We probably met an item that was moved to another chain.
 	 */
 	if (get_nulls_value(n) != bucket) {
-		NF_CT_STAT_INC(net, search_restart);
+		NF_CT_STAT_INC_ATOMIC(net, search_restart);
 		goto begin;
 	}
-	local_bh_enable();
 
 	return NULL;
 }
@@ -787,6 +785,27 @@ void init_nf_conntrack_hash_rnd(void)
 	cmpxchg(&nf_conntrack_hash_rnd, 0, rand);
 }
 
+/* Protocols that never use nf_conn::proto get entries without it */
+static inline bool nf_ct_compact(const struct nf_conntrack_tuple *tuple)
+{
+	switch (tuple->dst.protonum) {
+	case IPPROTO_UDP:
+	case IPPROTO_UDPLITE:
+	case IPPROTO_ICMP:
+	case IPPROTO_ICMPV6:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline struct kmem_cache *
+nf_ct_cachep(struct net *net, const struct nf_conntrack_tuple *tuple)
+{
+	return nf_ct_compact(tuple) ? net->ct.nf_conntrack_compact_cachep :
+				      net->ct.nf_conntrack_cachep;
+}
+
 static struct nf_conn *
 __nf_conntrack_alloc(struct net *net, u16 zone,
 		     const struct nf_conntrack_tuple *orig,
@@ -817,7 +836,7 @@ __nf_conntrack_alloc(struct net *net, u16 zone,
 	 * Do not use kmem_cache_zalloc(), as this cache uses
 	 * SLAB_DESTROY_BY_RCU.
 	 */
-	ct = kmem_cache_alloc(net->ct.nf_conntrack_cachep, gfp);
+	ct = kmem_cache_alloc(nf_ct_cachep(net, orig), gfp);
 	if (ct == NULL) {
 		atomic_dec(&net->ct.count);
 		return ERR_PTR(-ENOMEM);
@@ -854,7 +873,7 @@ __nf_conntrack_alloc(struct net *net, u16 zone,
 #ifdef CONFIG_NF_CONNTRACK_ZONES
 out_free:
 	atomic_dec(&net->ct.count);
-	kmem_cache_free(net->ct.nf_conntrack_cachep, ct);
+	kmem_cache_free(nf_ct_cachep(net, orig), ct);
 	return ERR_PTR(-ENOMEM);
 #endif
 }
@@ -879,7 +898,8 @@ void nf_conntrack_free(struct nf_conn *ct)
 
 	nf_ct_ext_destroy(ct);
 	nf_ct_ext_free(ct);
-	kmem_cache_free(net->ct.nf_conntrack_cachep, ct);
+	kmem_cache_free(nf_ct_cachep(net,
+			&ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple), ct);
 	smp_mb__before_atomic();
 	atomic_dec(&net->ct.count);
 }
@@ -1504,7 +1524,9 @@ i_see_dead_people:
 		nf_conntrack_tstamp_pernet_fini(net);
 		nf_conntrack_acct_pernet_fini(net);
 		nf_conntrack_expect_pernet_fini(net);
+		kmem_cache_destroy(net->ct.nf_conntrack_compact_cachep);
 		kmem_cache_destroy(net->ct.nf_conntrack_cachep);
+		kfree(net->ct.compact_slabname);
 		kfree(net->ct.slabname);
 		free_percpu(net->ct.stat);
 		free_percpu(net->ct.pcpu_lists);
@@ -1770,6 +1792,20 @@ int nf_conntrack_init_net(struct net *net)
 		goto err_cache;
 	}
 
+	net->ct.compact_slabname = kasprintf(GFP_KERNEL,
+					     "nf_conntrack_compact_%p", net);
+	if (!net->ct.compact_slabname)
+		goto err_compact_slabname;
+
+	net->ct.nf_conntrack_compact_cachep =
+		kmem_cache_create(net->ct.compact_slabname,
+				  offsetof(struct nf_conn, proto), 0,
+				  SLAB_DESTROY_BY_RCU, NULL);
+	if (!net->ct.nf_conntrack_compact_cachep) {
+		printk(KERN_ERR "Unable to create nf_conn slab cache\n");
+		goto err_compact_cache;
+	}
+
 	net->ct.htable_size = nf_conntrack_htable_size;
 	net->ct.hash = nf_ct_alloc_hashtable(&net->ct.htable_size, 1);
 	if (!net->ct.hash) {
@@ -1809,6 +1845,10 @@ err_acct:
 err_expect:
 	nf_ct_free_hashtable(net->ct.hash, net->ct.htable_size);
 err_hash:
+	kmem_cache_destroy(net->ct.nf_conntrack_compact_cachep);
+err_compact_cache:
+	kfree(net->ct.compact_slabname);
+err_compact_slabname:
 	kmem_cache_destroy(net->ct.nf_conntrack_cachep);
 err_cache:
 	kfree(net->ct.slabname);
@@ -2139,7 +2139,7 @@ static int tpacket_fill_skb(struct packet_sock *po, struct sk_buff *skb,
 	struct socket *sock = po->sk.sk_socket;
 	struct page *page;
 	void *data;
-	int err;
+	int err, pull;
 
 	ph.raw = frame;
 
@@ -2218,6 +2218,18 @@ static int tpacket_fill_skb(struct packet_sock *po, struct sk_buff *skb,
 		to_write -= dev->hard_header_len;
 	}
 
+	/* Copy up to the next cache line of the ring into the linear part,
+	 * so the fragments start aligned and DMA engines with alignment
+	 * constraints can read them from the ring pages instead of bouncing
+	 * them.  tpacket_snd() leaves L1_CACHE_BYTES of tailroom for this.
+	 */
+	pull = min_t(int, PTR_ALIGN(data, L1_CACHE_BYTES) - data, to_write);
+	if (pull) {
+		memcpy(skb_put(skb, pull), data, pull);
+		data += pull;
+		to_write -= pull;
+	}
+
 	offset = offset_in_page(data);
 	len_max = PAGE_SIZE - offset;
 	len = ((to_write > len_max) ? len_max : to_write);
@@ -2314,8 +2326,8 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 		hlen = LL_RESERVED_SPACE(dev);
 		tlen = dev->needed_tailroom;
 		skb = sock_alloc_send_skb(&po->sk,
-				hlen + tlen + sizeof(struct sockaddr_ll),
-				!need_wait, &err);
+				hlen + tlen + sizeof(struct sockaddr_ll) +
+				L1_CACHE_BYTES, !need_wait, &err);
 
 		if (unlikely(skb == NULL)) {
 			/* we assume the socket was initially writeable ... */
@@ -0,0 +1,77 @@
+#!/bin/bash
+#
+# FEC benchmark profiles for pktgen.
+#
+# Run "sink" on the device under test and one of the send profiles on the
+# peer, then read /proc/net/pktgen/pgrx on the sink for per-flow rate,
+# loss and latency.  Latency figures need both clocks to be synchronized,
+# e.g. with ptp4l on the FEC PTP clock.
+#
+# Usage:
+#   pktgen_bench.sh sink <dev>
+#   pktgen_bench.sh {pps|mtu|latency} <dev> <dst-ip> <dst-mac> [count]
+#
+PGDIR=/proc/net/pktgen
+
+pgset() {
+	local file=$1
+	shift
+	echo "$@" > "$file" || { echo "$file: $* failed" >&2; exit 1; }
+}
+
+[ -d $PGDIR ] || modprobe pktgen || exit 1
+
+profile=$1
+dev=$2
+[ -n "$dev" ] || { sed -n 's/^#   //p' "$0"; exit 1; }
+
+if [ "$profile" = sink ]; then
+	pgset $PGDIR/pgctrl "rx_stop"
+	pgset $PGDIR/pgctrl "rx $dev"
+	echo "sink attached to $dev, results in $PGDIR/pgrx"
+	exit 0
+fi
+
+dst=$3
+dmac=$4
+count=${5:-1000000}
+[ -n "$dst" -a -n "$dmac" ] || { echo "missing destination" >&2; exit 1; }
+
+case $profile in
+pps)		# minimum size frames, one flow per TX queue
+	size=60; delay=0; flows=$(ls -d /sys/class/net/$dev/queues/tx-* | wc -l)
+	;;
+mtu)		# full size frames, throughput
+	size=1514; delay=0; flows=1
+	;;
+latency)	# light load so queueing does not hide the path latency
+	size=60; delay=100000; flows=1
+	;;
+*)
+	echo "unknown profile $profile" >&2; exit 1
+	;;
+esac
+
+pgset $PGDIR/pgctrl "reset"
+pgset $PGDIR/kpktgend_0 "rem_device_all"
+
+for ((i = 0; i < flows; i++)); do
+	pg=$PGDIR/$dev@$i
+	pgset $PGDIR/kpktgend_0 "add_device $dev@$i"
+	pgset $pg "count $count"
+	pgset $pg "pkt_size $size"
+	pgset $pg "delay $delay"
+	pgset $pg "dst $dst"
+	pgset $pg "dst_mac $dmac"
+	# a fixed port per device keeps the sink's sequence tracking exact
+	pgset $pg "udp_src_min $((9000 + i))"
+	pgset $pg "udp_src_max $((9000 + i))"
+	pgset $pg "queue_map_min $i"
+	pgset $pg "queue_map_max $i"
+done
+
+pgset $PGDIR/pgctrl "start"
+
+for ((i = 0; i < flows; i++)); do
+	grep -A2 "^Result" $PGDIR/$dev@$i
+done
@@ -13,6 +13,31 @@
 
 #define DIR_STR(dir) dir == IN ? "in" : "out"
 
+/* Conversion jobs a pair may have queued or awaiting dequeue at once */
+#define ASRC_M2M_MAX_JOBS	32
+
+/**
+ * fsl_asrc_m2m_job: DMA-BUF conversion job
+ *
+ * @list: entry in the pending or done list of the pair
+ * @user: job description from and to user space
+ * @dmabuf: input and output buffers
+ * @attach: attachments of the buffers to the DMA engine
+ * @sgt: mapping of the whole buffers
+ * @sg: DMA segments covering the part of the buffers to transfer
+ * @dma_len: bytes to transfer by DMA in each direction
+ */
+struct fsl_asrc_m2m_job {
+	struct list_head list;
+	struct asrc_dmabuf_job user;
+
+	struct dma_buf *dmabuf[2];
+	struct dma_buf_attachment *attach[2];
+	struct sg_table *sgt[2];
+	struct sg_table sg[2];
+	unsigned int dma_len[2];
+};
+
 struct fsl_asrc_m2m {
 	struct fsl_asrc_pair *pair;
 	struct completion complete[2];
@@ -27,6 +52,14 @@ struct fsl_asrc_m2m {
 	unsigned int last_period_size;
 	u32 watermark[2];
 	spinlock_t lock;
+
+	struct list_head job_queue;
+	struct list_head job_done;
+	unsigned int job_count;
+	unsigned int job_abort;
+	unsigned int convert_busy;
+	wait_queue_head_t job_wq;
+	struct work_struct job_work;
 };
 
 static struct miscdevice asrc_miscdev = {
@@ -79,20 +112,21 @@ static unsigned int fsl_asrc_get_output_FIFO_size(struct fsl_asrc_pair *pair)
 	return val >> ASRFSTi_OUTPUT_FIFO_SHIFT;
 }
 
-static void fsl_asrc_read_last_FIFO(struct fsl_asrc_pair *pair)
+/* Drain the output FIFO into @buf, returning the number of bytes kept */
+static unsigned int fsl_asrc_read_last_FIFO(struct fsl_asrc_pair *pair,
+					    void *buf)
 {
 	struct fsl_asrc_m2m *m2m = pair->private;
 	struct fsl_asrc *asrc_priv = pair->asrc_priv;
 	enum asrc_pair_index index = pair->index;
-	struct dma_block *output = &m2m->dma_block[OUT];
 	u32 i, reg, size, t_size = 0;
 	u32 *reg24 = NULL;
 	u16 *reg16 = NULL;
 
 	if (m2m->word_width[OUT] == ASRC_WIDTH_24_BIT)
-		reg24 = output->dma_vaddr + output->length;
+		reg24 = buf;
 	else
-		reg16 = output->dma_vaddr + output->length;
+		reg16 = buf;
 
 retry:
 	size = fsl_asrc_get_output_FIFO_size(pair);
@@ -116,9 +150,9 @@ retry:
 		t_size = m2m->last_period_size;
 
 	if (reg24)
-		output->length += t_size * pair->channels * 4;
+		return t_size * pair->channels * 4;
 	else
-		output->length += t_size * pair->channels * 2;
+		return t_size * pair->channels * 2;
 }
 
 static int fsl_allocate_dma_buf(struct fsl_asrc_pair *pair)
@@ -151,19 +185,16 @@ exit:
 	return -ENOMEM;
 }
 
-static int fsl_asrc_dmaconfig(struct fsl_asrc_pair *pair, struct dma_chan *chan,
-			      u32 dma_addr, void *buf_addr, u32 buf_len,
-			      bool dir, enum asrc_word_width word_width)
+static int fsl_asrc_slave_config(struct fsl_asrc_pair *pair,
+				 struct dma_chan *chan, u32 dma_addr, bool dir,
+				 enum asrc_word_width word_width)
 {
-	struct dma_async_tx_descriptor *desc = pair->desc[dir];
 	struct fsl_asrc *asrc_priv = pair->asrc_priv;
 	struct fsl_asrc_m2m *m2m = pair->private;
-	unsigned int sg_nent = m2m->sg_nodes[dir];
 	enum asrc_pair_index index = pair->index;
-	struct scatterlist *sg = m2m->sg[dir];
 	struct dma_slave_config slave_config;
 	enum dma_slave_buswidth buswidth;
-	int ret, i;
+	int ret;
 
 	switch (word_width) {
 	case ASRC_WIDTH_16_BIT:
@@ -198,6 +229,49 @@ static int fsl_asrc_dmaconfig(struct fsl_asrc_pair *pair, struct dma_chan *chan,
 		return -EINVAL;
 	}
 
+	return 0;
+}
+
+static int fsl_asrc_prep_desc(struct fsl_asrc_pair *pair, struct dma_chan *chan,
+			      struct scatterlist *sg, unsigned int sg_nent,
+			      bool dir)
+{
+	struct fsl_asrc *asrc_priv = pair->asrc_priv;
+	enum asrc_pair_index index = pair->index;
+	struct dma_async_tx_descriptor *desc;
+
+	desc = dmaengine_prep_slave_sg(chan, sg, sg_nent,
+			dir == IN ? DMA_MEM_TO_DEV : DMA_DEV_TO_MEM,
+			DMA_PREP_INTERRUPT);
+	if (!desc) {
+		pair_err("failed to prepare dmaengine for %sput task\n",
+				DIR_STR(dir));
+		return -EINVAL;
+	}
+
+	pair->desc[dir] = desc;
+
+	desc->callback = ASRC_xPUT_DMA_CALLBACK(dir);
+	desc->callback_param = pair;
+
+	return 0;
+}
+
+static int fsl_asrc_dmaconfig(struct fsl_asrc_pair *pair, struct dma_chan *chan,
+			      u32 dma_addr, void *buf_addr, u32 buf_len,
+			      bool dir, enum asrc_word_width word_width)
+{
+	struct fsl_asrc *asrc_priv = pair->asrc_priv;
+	struct fsl_asrc_m2m *m2m = pair->private;
+	unsigned int sg_nent = m2m->sg_nodes[dir];
+	enum asrc_pair_index index = pair->index;
+	struct scatterlist *sg = m2m->sg[dir];
+	int ret, i;
+
+	ret = fsl_asrc_slave_config(pair, chan, dma_addr, dir, word_width);
+	if (ret)
+		return ret;
+
 	sg_init_table(sg, sg_nent);
 	switch (sg_nent) {
 	case 1:
@@ -218,27 +292,14 @@ static int fsl_asrc_dmaconfig(struct fsl_asrc_pair *pair, struct dma_chan *chan,
 		return -EINVAL;
 	}
 
-	ret = dma_map_sg(NULL, sg, sg_nent, slave_config.direction);
+	ret = dma_map_sg(NULL, sg, sg_nent,
+			 dir == IN ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
 	if (ret != sg_nent) {
 		pair_err("failed to map DMA sg for %sput task\n", DIR_STR(dir));
 		return -EINVAL;
 	}
 
-	desc = dmaengine_prep_slave_sg(chan, sg, sg_nent,
-			slave_config.direction, DMA_PREP_INTERRUPT);
-	if (!desc) {
-		pair_err("failed to prepare dmaengine for %sput task\n",
-				DIR_STR(dir));
-		return -EINVAL;
-	}
-
-	pair->desc[dir] = desc;
-	pair->desc[dir]->callback = ASRC_xPUT_DMA_CALLBACK(dir);
-
-	desc->callback = ASRC_xPUT_DMA_CALLBACK(dir);
-	desc->callback_param = pair;
-
-	return 0;
+	return fsl_asrc_prep_desc(pair, chan, sg, sg_nent, dir);
 }
 
 static int fsl_asrc_prepare_io_buffer(struct fsl_asrc_pair *pair,
@@ -373,7 +434,8 @@ int fsl_asrc_process_buffer(struct fsl_asrc_pair *pair,
 	}
 	spin_unlock_irqrestore(&m2m->lock, lock_flags);
 
-	fsl_asrc_read_last_FIFO(pair);
+	m2m->dma_block[OUT].length += fsl_asrc_read_last_FIFO(pair,
+			m2m->dma_block[OUT].dma_vaddr + m2m->dma_block[OUT].length);
 
 	/* Update final lengths after getting last FIFO */
 	pbuf->input_buffer_length = m2m->dma_block[IN].length;
@@ -481,6 +543,340 @@ static void fsl_asrc_submit_dma(struct fsl_asrc_pair *pair)
 }
 #endif /* ASRC_POLLING_WITHOUT_DMA */
 
+static inline enum dma_data_direction fsl_asrc_dmabuf_dir(bool dir)
+{
+	return dir == IN ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+}
+
+/*
+ * Describe @len bytes at @offset of a mapped DMA-BUF as DMA segments no
+ * longer than the SDMA can handle. With @out NULL the segments are only
+ * counted. Returns 0 when the buffer is too short.
+ */
+static unsigned int fsl_asrc_dmabuf_window(struct sg_table *sgt,
+					   unsigned int offset,
+					   unsigned int len,
+					   struct scatterlist *out)
+{
+	struct scatterlist *sg;
+	unsigned int i, nents = 0;
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
+		dma_addr_t addr = sg_dma_address(sg);
+		unsigned int seg = sg_dma_len(sg);
+
+		if (offset >= seg) {
+			offset -= seg;
+			continue;
+		}
+
+		addr += offset;
+		seg -= offset;
+		offset = 0;
+
+		while (seg && len) {
+			unsigned int chunk = min3(seg, len,
+					(unsigned int)ASRC_MAX_BUFFER_SIZE);
+
+			if (out) {
+				sg_dma_address(out) = addr;
+				sg_dma_len(out) = chunk;
+				out = sg_next(out);
+			}
+
+			addr += chunk;
+			seg -= chunk;
+			len -= chunk;
+			nents++;
+		}
+
+		if (!len)
+			break;
+	}
+
+	return len ? 0 : nents;
+}
+
+static void fsl_asrc_dmabuf_unmap(struct fsl_asrc_m2m_job *job, bool dir)
+{
+	if (!job->attach[dir])
+		return;
+
+	sg_free_table(&job->sg[dir]);
+	if (job->sgt[dir])
+		dma_buf_unmap_attachment(job->attach[dir], job->sgt[dir],
+					 fsl_asrc_dmabuf_dir(dir));
+	dma_buf_detach(job->dmabuf[dir], job->attach[dir]);
+
+	job->sgt[dir] = NULL;
+	job->attach[dir] = NULL;
+}
+
+static void fsl_asrc_dmabuf_put(struct fsl_asrc_m2m_job *job)
+{
+	int dir;
+
+	for (dir = IN; dir <= OUT; dir++) {
+		fsl_asrc_dmabuf_unmap(job, dir);
+		if (job->dmabuf[dir])
+			dma_buf_put(job->dmabuf[dir]);
+		job->dmabuf[dir] = NULL;
+	}
+}
+
+static int fsl_asrc_dmabuf_map(struct fsl_asrc_pair *pair,
+			       struct fsl_asrc_m2m_job *job, bool dir)
+{
+	struct fsl_asrc *asrc_priv = pair->asrc_priv;
+	struct device *dev = pair->dma_chan[dir]->device->dev;
+	enum asrc_pair_index index = pair->index;
+	unsigned int offset, len = job->dma_len[dir];
+	struct dma_buf *dmabuf;
+	unsigned int nents;
+	int fd, ret;
+
+	if (dir == IN) {
+		fd = job->user.input_fd;
+		offset = job->user.input_offset;
+	} else {
+		fd = job->user.output_fd;
+		offset = job->user.output_offset;
+	}
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR(dmabuf)) {
+		pair_err("invalid %sput dmabuf fd: %d\n", DIR_STR(dir), fd);
+		return PTR_ERR(dmabuf);
+	}
+	job->dmabuf[dir] = dmabuf;
+
+	if ((u64)offset + len > dmabuf->size) {
+		pair_err("%sput dmabuf is too small: [%zu]\n",
+				DIR_STR(dir), dmabuf->size);
+		return -EINVAL;
+	}
+
+	job->attach[dir] = dma_buf_attach(dmabuf, dev);
+	if (IS_ERR(job->attach[dir])) {
+		ret = PTR_ERR(job->attach[dir]);
+		job->attach[dir] = NULL;
+		pair_err("failed to attach %sput dmabuf: %d\n",
+				DIR_STR(dir), ret);
+		return ret;
+	}
+
+	job->sgt[dir] = dma_buf_map_attachment(job->attach[dir],
+					       fsl_asrc_dmabuf_dir(dir));
+	if (IS_ERR(job->sgt[dir])) {
+		ret = PTR_ERR(job->sgt[dir]);
+		job->sgt[dir] = NULL;
+		pair_err("failed to map %sput dmabuf: %d\n", DIR_STR(dir), ret);
+		return ret;
+	}
+
+	nents = fsl_asrc_dmabuf_window(job->sgt[dir], offset, len, NULL);
+	if (!nents) {
+		pair_err("%sput dmabuf mapping is too short\n", DIR_STR(dir));
+		return -EINVAL;
+	}
+
+	ret = sg_alloc_table(&job->sg[dir], nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	fsl_asrc_dmabuf_window(job->sgt[dir], offset, len, job->sg[dir].sgl);
+
+	return 0;
+}
+
+/* Store the samples drained from the output FIFO behind the DMA data */
+static int fsl_asrc_dmabuf_write(struct dma_buf *dmabuf, unsigned int offset,
+				 const void *src, unsigned int len)
+{
+	unsigned int start = offset, total = len;
+	int ret;
+
+	ret = dma_buf_begin_cpu_access(dmabuf, start, total, DMA_BIDIRECTIONAL);
+	if (ret)
+		return ret;
+
+	while (len) {
+		unsigned long page = offset >> PAGE_SHIFT;
+		unsigned int poff = offset & ~PAGE_MASK;
+		unsigned int chunk = min_t(unsigned int, len, PAGE_SIZE - poff);
+		void *vaddr;
+
+		vaddr = dma_buf_kmap(dmabuf, page);
+		if (!vaddr) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		memcpy(vaddr + poff, src, chunk);
+		dma_buf_kunmap(dmabuf, page, vaddr);
+
+		src += chunk;
+		offset += chunk;
+		len -= chunk;
+	}
+
+	dma_buf_end_cpu_access(dmabuf, start, total, DMA_BIDIRECTIONAL);
+
+	return ret;
+}
+
+static int fsl_asrc_m2m_run_job(struct fsl_asrc_pair *pair,
+				struct fsl_asrc_m2m_job *job)
+{
+	struct fsl_asrc *asrc_priv = pair->asrc_priv;
+	struct fsl_asrc_m2m *m2m = pair->private;
+	enum asrc_pair_index index = pair->index;
+	unsigned long lock_flags;
+	unsigned int tail;
+	int ret, dir;
+
+	for (dir = IN; dir <= OUT; dir++) {
+		ret = fsl_asrc_slave_config(pair, pair->dma_chan[dir],
+				asrc_priv->paddr + REG_ASRDx(dir, index),
+				dir, m2m->word_width[dir]);
+		if (ret)
+			return ret;
+
+		ret = fsl_asrc_prep_desc(pair, pair->dma_chan[dir],
+				job->sg[dir].sgl, job->sg[dir].nents, dir);
+		if (ret)
+			return ret;
+	}
+
+	/* Arm the completions before an abort is able to signal them */
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	if (m2m->job_abort) {
+		spin_unlock_irqrestore(&m2m->lock, lock_flags);
+		return -ECANCELED;
+	}
+	init_completion(&m2m->complete[IN]);
+	init_completion(&m2m->complete[OUT]);
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	fsl_asrc_submit_dma(pair);
+
+	if (!wait_for_completion_timeout(&m2m->complete[IN], 10 * HZ) ||
+	    !wait_for_completion_timeout(&m2m->complete[OUT], 10 * HZ)) {
+		pair_err("dmabuf DMA task timeout\n");
+		dmaengine_terminate_all(pair->dma_chan[IN]);
+		dmaengine_terminate_all(pair->dma_chan[OUT]);
+		return -ETIME;
+	}
+
+	if (m2m->job_abort)
+		return -ECANCELED;
+
+	/* Hand the buffers back to the CPU before appending the FIFO tail */
+	fsl_asrc_dmabuf_unmap(job, IN);
+	fsl_asrc_dmabuf_unmap(job, OUT);
+
+	tail = fsl_asrc_read_last_FIFO(pair, m2m->dma_block[OUT].dma_vaddr);
+	if (tail) {
+		ret = fsl_asrc_dmabuf_write(job->dmabuf[OUT],
+				job->user.output_offset + job->dma_len[OUT],
+				m2m->dma_block[OUT].dma_vaddr, tail);
+		if (ret)
+			return ret;
+	}
+
+	job->user.output_length = job->dma_len[OUT] + tail;
+
+	return 0;
+}
+
+static void fsl_asrc_m2m_job_work(struct work_struct *work)
+{
+	struct fsl_asrc_m2m *m2m =
+		container_of(work, struct fsl_asrc_m2m, job_work);
+	struct fsl_asrc_pair *pair = m2m->pair;
+	struct fsl_asrc_m2m_job *job;
+	unsigned long lock_flags;
+
+	for (;;) {
+		/* The running job stays queued so an abort can find it */
+		spin_lock_irqsave(&m2m->lock, lock_flags);
+		job = list_first_entry_or_null(&m2m->job_queue,
+					       struct fsl_asrc_m2m_job, list);
+		spin_unlock_irqrestore(&m2m->lock, lock_flags);
+		if (!job)
+			break;
+
+		job->user.status = fsl_asrc_m2m_run_job(pair, job);
+		fsl_asrc_dmabuf_put(job);
+
+		spin_lock_irqsave(&m2m->lock, lock_flags);
+		list_move_tail(&job->list, &m2m->job_done);
+		spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+		wake_up_interruptible(&m2m->job_wq);
+	}
+}
+
+/* Cancel the queued jobs; they are still returned by ASRC_DEQUEUE_DMABUF */
+static void fsl_asrc_m2m_abort_jobs(struct fsl_asrc_pair *pair)
+{
+	struct fsl_asrc_m2m *m2m = pair->private;
+	struct fsl_asrc_m2m_job *job;
+	unsigned long lock_flags;
+	LIST_HEAD(aborted);
+
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	if (list_empty(&m2m->job_queue)) {
+		spin_unlock_irqrestore(&m2m->lock, lock_flags);
+		return;
+	}
+	m2m->job_abort = 1;
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	dmaengine_terminate_all(pair->dma_chan[IN]);
+	dmaengine_terminate_all(pair->dma_chan[OUT]);
+	complete(&m2m->complete[IN]);
+	complete(&m2m->complete[OUT]);
+
+	cancel_work_sync(&m2m->job_work);
+
+	/* unmapping the dma-bufs may sleep, do it off the lock */
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	list_splice_init(&m2m->job_queue, &aborted);
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	list_for_each_entry(job, &aborted, list) {
+		fsl_asrc_dmabuf_put(job);
+		job->user.status = -ECANCELED;
+	}
+
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	list_splice_tail(&aborted, &m2m->job_done);
+	m2m->job_abort = 0;
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	wake_up_interruptible(&m2m->job_wq);
+}
+
+static void fsl_asrc_m2m_free_jobs(struct fsl_asrc_pair *pair)
+{
+	struct fsl_asrc_m2m *m2m = pair->private;
+	struct fsl_asrc_m2m_job *job, *tmp;
+	unsigned long lock_flags;
+
+	fsl_asrc_m2m_abort_jobs(pair);
+	/* the worker may still be past its last job when the queue is empty */
+	cancel_work_sync(&m2m->job_work);
+
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	list_for_each_entry_safe(job, tmp, &m2m->job_done, list) {
+		list_del(&job->list);
+		kfree(job);
+	}
+	m2m->job_count = 0;
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+}
+
 static long fsl_asrc_ioctl_req_pair(struct fsl_asrc_pair *pair,
 				    void __user *user)
 {
@@ -612,6 +1008,7 @@ static long fsl_asrc_ioctl_release_pair(struct fsl_asrc_pair *pair,
 	if (index < 0)
 		return -EINVAL;
 
+	fsl_asrc_m2m_free_jobs(pair);
 	m2m->asrc_active = 0;
 
 	spin_lock_irqsave(&m2m->lock, lock_flags);
@@ -636,6 +1033,7 @@ static long fsl_asrc_ioctl_convert(struct fsl_asrc_pair *pair,
 	struct fsl_asrc *asrc_priv = pair->asrc_priv;
 	enum asrc_pair_index index = pair->index;
 	struct asrc_convert_buffer buf;
+	unsigned long lock_flags;
 	long ret;
 
 	ret = copy_from_user(&buf, user, sizeof(buf));
@@ -644,10 +1042,22 @@ static long fsl_asrc_ioctl_convert(struct fsl_asrc_pair *pair,
 		return ret;
 	}
 
+	/*
+	 * The pair is busy with DMA-BUF jobs until they are all dequeued,
+	 * and converts one ASRC_CONVERT buffer at a time.
+	 */
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	if (m2m->job_count || m2m->convert_busy) {
+		spin_unlock_irqrestore(&m2m->lock, lock_flags);
+		return -EBUSY;
+	}
+	m2m->convert_busy = 1;
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
 	ret = fsl_asrc_prepare_buffer(pair, &buf);
 	if (ret) {
 		pair_err("failed to prepare buffer: %ld\n", ret);
-		return ret;
+		goto out;
 	}
 
 	init_completion(&m2m->complete[IN]);
@@ -662,16 +1072,19 @@ static long fsl_asrc_ioctl_convert(struct fsl_asrc_pair *pair,
 	ret = fsl_asrc_process_buffer(pair, &buf);
 	if (ret) {
 		pair_err("failed to process buffer: %ld\n", ret);
-		return ret;
+		goto out;
 	}
 
 	ret = copy_to_user(user, &buf, sizeof(buf));
-	if (ret) {
+	if (ret)
 		pair_err("failed to send buf to user space: %ld\n", ret);
-		return ret;
-	}
 
-	return 0;
+out:
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	m2m->convert_busy = 0;
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	return ret;
 }
 
 static long fsl_asrc_ioctl_start_conv(struct fsl_asrc_pair *pair,
@@ -708,6 +1121,8 @@ static long fsl_asrc_ioctl_stop_conv(struct fsl_asrc_pair *pair,
 		return ret;
 	}
 
+	fsl_asrc_m2m_abort_jobs(pair);
+
 	dmaengine_terminate_all(pair->dma_chan[IN]);
 	dmaengine_terminate_all(pair->dma_chan[OUT]);
 
@@ -746,6 +1161,8 @@ static long fsl_asrc_ioctl_flush(struct fsl_asrc_pair *pair, void __user *user)
 	struct fsl_asrc *asrc_priv = pair->asrc_priv;
 	enum asrc_pair_index index = pair->index;
 
+	fsl_asrc_m2m_abort_jobs(pair);
+
 	/* Release DMA and request again */
 	dma_release_channel(pair->dma_chan[IN]);
 	dma_release_channel(pair->dma_chan[OUT]);
@@ -765,6 +1182,131 @@ static long fsl_asrc_ioctl_flush(struct fsl_asrc_pair *pair, void __user *user)
 	return 0;
 }
 
+static long fsl_asrc_ioctl_queue_dmabuf(struct fsl_asrc_pair *pair,
+					void __user *user)
+{
+	struct fsl_asrc_m2m *m2m = pair->private;
+	struct fsl_asrc *asrc_priv = pair->asrc_priv;
+	enum asrc_pair_index index = pair->index;
+	unsigned int word_size[2], tail_size;
+	struct fsl_asrc_m2m_job *job;
+	unsigned long lock_flags;
+	long ret;
+	int dir;
+
+	if (!pair->dma_chan[IN] || !pair->dma_chan[OUT])
+		return -EINVAL;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job)
+		return -ENOMEM;
+
+	ret = copy_from_user(&job->user, user, sizeof(job->user));
+	if (ret) {
+		pair_err("failed to get job from user space: %ld\n", ret);
+		goto err_free;
+	}
+
+	for (dir = IN; dir <= OUT; dir++)
+		word_size[dir] = m2m->word_width[dir] == ASRC_WIDTH_24_BIT ? 4 : 2;
+	tail_size = word_size[OUT] * pair->channels * m2m->last_period_size;
+
+	if (job->user.input_length < word_size[IN] * pair->channels *
+				     m2m->watermark[IN] ||
+	    job->user.output_length <= tail_size ||
+	    job->user.input_offset % word_size[IN] ||
+	    job->user.output_offset % word_size[OUT]) {
+		pair_err("dmabuf job size is error: [%d] [%d]\n",
+				job->user.input_length,
+				job->user.output_length);
+		ret = -EINVAL;
+		goto err_free;
+	}
+
+	/* As for ASRC_CONVERT, the tail in the output FIFO is read by CPU */
+	job->dma_len[IN] = job->user.input_length;
+	job->dma_len[OUT] = job->user.output_length - tail_size;
+
+	for (dir = IN; dir <= OUT; dir++) {
+		ret = fsl_asrc_dmabuf_map(pair, job, dir);
+		if (ret)
+			goto err_put;
+	}
+
+	/* ASRC_CONVERT drives the same DMA channels and completions */
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	if (m2m->convert_busy || m2m->job_count >= ASRC_M2M_MAX_JOBS) {
+		spin_unlock_irqrestore(&m2m->lock, lock_flags);
+		ret = -EBUSY;
+		goto err_put;
+	}
+	m2m->job_count++;
+	list_add_tail(&job->list, &m2m->job_queue);
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	schedule_work(&m2m->job_work);
+
+	return 0;
+
+err_put:
+	fsl_asrc_dmabuf_put(job);
+err_free:
+	kfree(job);
+
+	return ret;
+}
+
+static bool fsl_asrc_m2m_job_ready(struct fsl_asrc_m2m *m2m)
+{
+	unsigned long lock_flags;
+	bool ready;
+
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	ready = !list_empty(&m2m->job_done) || list_empty(&m2m->job_queue);
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	return ready;
+}
+
+static long fsl_asrc_ioctl_dequeue_dmabuf(struct fsl_asrc_pair *pair,
+					  void __user *user, bool nonblock)
+{
+	struct fsl_asrc_m2m *m2m = pair->private;
+	struct fsl_asrc *asrc_priv = pair->asrc_priv;
+	enum asrc_pair_index index = pair->index;
+	struct fsl_asrc_m2m_job *job;
+	unsigned long lock_flags;
+	long ret;
+
+	if (nonblock) {
+		if (!fsl_asrc_m2m_job_ready(m2m))
+			return -EAGAIN;
+	} else if (wait_event_interruptible(m2m->job_wq,
+					    fsl_asrc_m2m_job_ready(m2m))) {
+		return -ERESTARTSYS;
+	}
+
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	job = list_first_entry_or_null(&m2m->job_done,
+				       struct fsl_asrc_m2m_job, list);
+	if (job) {
+		list_del(&job->list);
+		m2m->job_count--;
+	}
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	if (!job)
+		return -ENODATA;
+
+	ret = copy_to_user(user, &job->user, sizeof(job->user));
+	if (ret)
+		pair_err("failed to send job to user space: %ld\n", ret);
+
+	kfree(job);
+
+	return ret;
+}
+
 static long fsl_asrc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct fsl_asrc_pair *pair = file->private_data;
@@ -797,6 +1339,13 @@ static long fsl_asrc_ioctl(struct file *file, unsigned int cmd, unsigned long ar
 	case ASRC_FLUSH:
 		ret = fsl_asrc_ioctl_flush(pair, user);
 		break;
+	case ASRC_QUEUE_DMABUF:
+		ret = fsl_asrc_ioctl_queue_dmabuf(pair, user);
+		break;
+	case ASRC_DEQUEUE_DMABUF:
+		ret = fsl_asrc_ioctl_dequeue_dmabuf(pair, user,
+				file->f_flags & O_NONBLOCK);
+		break;
 	default:
 		dev_err(&asrc_priv->pdev->dev, "invalid ioctl cmd!\n");
 		break;
@@ -805,6 +1354,23 @@ static long fsl_asrc_ioctl(struct file *file, unsigned int cmd, unsigned long ar
 	return ret;
 }
 
+static unsigned int fsl_asrc_poll(struct file *file, poll_table *wait)
+{
+	struct fsl_asrc_pair *pair = file->private_data;
+	struct fsl_asrc_m2m *m2m = pair->private;
+	unsigned long lock_flags;
+	unsigned int mask = 0;
+
+	poll_wait(file, &m2m->job_wq, wait);
+
+	spin_lock_irqsave(&m2m->lock, lock_flags);
+	if (!list_empty(&m2m->job_done))
+		mask = POLLIN | POLLRDNORM;
+	spin_unlock_irqrestore(&m2m->lock, lock_flags);
+
+	return mask;
+}
+
 static int fsl_asrc_open(struct inode *inode, struct file *file)
 {
 	struct fsl_asrc *asrc_priv = dev_get_drvdata(asrc_miscdev.this_device);
@@ -834,8 +1400,13 @@ static int fsl_asrc_open(struct inode *inode, struct file *file)
 
 	pair->private = m2m;
 	pair->asrc_priv = asrc_priv;
+	m2m->pair = pair;
 
 	spin_lock_init(&m2m->lock);
+	INIT_LIST_HEAD(&m2m->job_queue);
+	INIT_LIST_HEAD(&m2m->job_done);
+	init_waitqueue_head(&m2m->job_wq);
+	INIT_WORK(&m2m->job_work, fsl_asrc_m2m_job_work);
 
 	file->private_data = pair;
 
@@ -856,6 +1427,8 @@ static int fsl_asrc_close(struct inode *inode, struct file *file)
 	struct device *dev = &asrc_priv->pdev->dev;
 	unsigned long lock_flags;
 
+	fsl_asrc_m2m_free_jobs(pair);
+
 	if (m2m->asrc_active) {
 		m2m->asrc_active = 0;
 
@@ -898,6 +1471,7 @@ static int fsl_asrc_close(struct inode *inode, struct file *file)
 static const struct file_operations asrc_fops = {
 	.owner		= THIS_MODULE,
 	.unlocked_ioctl	= fsl_asrc_ioctl,
+	.poll		= fsl_asrc_poll,
 	.open		= fsl_asrc_open,
 	.release	= fsl_asrc_close,
 };
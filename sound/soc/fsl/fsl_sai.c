@@ -613,8 +613,18 @@ static int fsl_sai_startup(struct snd_pcm_substream *substream,
 
 	ret = snd_pcm_hw_constraint_list(substream->runtime, 0,
 			SNDRV_PCM_HW_PARAM_RATE, &fsl_sai_rate_constraints);
+	if (ret)
+		return ret;
 
-	return ret;
+	/*
+	 * Periods down to 1 ms are fine for low latency use, shorter ones
+	 * leave too little time to re-arm the SDMA BDs between FIFO bursts.
+	 */
+	ret = snd_pcm_hw_constraint_minmax(substream->runtime,
+			SNDRV_PCM_HW_PARAM_PERIOD_TIME,
+			FSL_SAI_MIN_PERIOD_US, UINT_MAX);
+
+	return ret < 0 ? ret : 0;
 }
 
 static void fsl_sai_shutdown(struct snd_pcm_substream *substream,
@@ -903,7 +913,8 @@ static int fsl_sai_probe(struct platform_device *pdev)
 		buffer_size = IMX_SAI_DMABUF_SIZE;
 
 	if (sai->sai_on_imx)
-		return imx_pcm_dma_init(pdev, buffer_size);
+		return imx_pcm_dma_init_period(pdev, buffer_size,
+					       FSL_SAI_MIN_PERIOD_BYTES);
 	else
 		return devm_snd_dmaengine_pcm_register(&pdev->dev, NULL,
 				SND_DMAENGINE_PCM_FLAG_NO_RESIDUE);
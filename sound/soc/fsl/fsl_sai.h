@@ -129,6 +129,11 @@
 #define FSL_SAI_MAXBURST_TX 6
 #define FSL_SAI_MAXBURST_RX 6
 
+/* Shortest period, in us, for which the SDMA keeps up with the FIFO */
+#define FSL_SAI_MIN_PERIOD_US	1000
+/* so that 1 ms periods fit at low rates, e.g. 8 kHz 16-bit mono */
+#define FSL_SAI_MIN_PERIOD_BYTES	16
+
 struct fsl_sai {
 	struct platform_device *pdev;
 	struct regmap *regmap;
@@ -39,7 +39,8 @@ static const struct snd_pcm_hardware imx_pcm_hardware = {
 		SNDRV_PCM_INFO_MMAP |
 		SNDRV_PCM_INFO_MMAP_VALID |
 		SNDRV_PCM_INFO_PAUSE |
-		SNDRV_PCM_INFO_RESUME,
+		SNDRV_PCM_INFO_RESUME |
+		SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
 	.buffer_bytes_max = IMX_DEFAULT_DMABUF_SIZE,
 	.period_bytes_min = 128,
 	.period_bytes_max = 65535, /* Limited by SDMA engine */
@@ -95,7 +96,12 @@ static const struct snd_dmaengine_pcm_config imx_dmaengine_pcm_config = {
 	.prealloc_buffer_size = IMX_DEFAULT_DMABUF_SIZE,
 };
 
-int imx_pcm_dma_init(struct platform_device *pdev, size_t size)
+/*
+ * Like imx_pcm_dma_init(), for DAIs that keep up with periods shorter than
+ * the default minimum. A zero period_bytes_min keeps the default.
+ */
+int imx_pcm_dma_init_period(struct platform_device *pdev, size_t size,
+			    size_t period_bytes_min)
 {
 	struct snd_dmaengine_pcm_config *config;
 	struct snd_pcm_hardware *pcm_hardware;
@@ -111,6 +117,8 @@ int imx_pcm_dma_init(struct platform_device *pdev, size_t size)
 	*pcm_hardware = imx_pcm_hardware;
 	if (size)
 		pcm_hardware->buffer_bytes_max = size;
+	if (period_bytes_min)
+		pcm_hardware->period_bytes_min = period_bytes_min;
 
 	config->pcm_hardware = pcm_hardware;
 
@@ -118,6 +126,12 @@ int imx_pcm_dma_init(struct platform_device *pdev, size_t size)
 		config,
 		SND_DMAENGINE_PCM_FLAG_COMPAT);
 }
+EXPORT_SYMBOL_GPL(imx_pcm_dma_init_period);
+
+int imx_pcm_dma_init(struct platform_device *pdev, size_t size)
+{
+	return imx_pcm_dma_init_period(pdev, size, 0);
+}
 EXPORT_SYMBOL_GPL(imx_pcm_dma_init);
 
 MODULE_LICENSE("GPL");
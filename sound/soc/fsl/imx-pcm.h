@@ -45,11 +45,19 @@ struct imx_pcm_fiq_params {
 
 #if IS_ENABLED(CONFIG_SND_SOC_IMX_PCM_DMA)
 int imx_pcm_dma_init(struct platform_device *pdev, size_t size);
+int imx_pcm_dma_init_period(struct platform_device *pdev, size_t size,
+			    size_t period_bytes_min);
 #else
 static inline int imx_pcm_dma_init(struct platform_device *pdev, size_t size)
 {
 	return -ENODEV;
 }
+
+static inline int imx_pcm_dma_init_period(struct platform_device *pdev,
+					  size_t size, size_t period_bytes_min)
+{
+	return -ENODEV;
+}
 #endif
 
 #if IS_ENABLED(CONFIG_SND_SOC_IMX_PCM_FIQ)
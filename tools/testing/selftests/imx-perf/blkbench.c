@@ -0,0 +1,170 @@
+/*
+ * Block and file I/O throughput.
+ *
+ *   blkbench [-w] [-r] [-c] [-p] [-b bs] [-s size_mb] [-t secs] path
+ *
+ * Reads (or with -w writes) path in bs sized requests, sequentially in
+ * one pass over size_mb or, with -r, at random offsets for secs
+ * seconds.  I/O is O_DIRECT unless -c is given, for file systems
+ * without direct I/O such as UBIFS: then the page cache is dropped for
+ * the file before reading and writes are fsync()ed before the clock
+ * stops.  Random reads of a block device never modify it.  -p first
+ * writes the size_mb sequentially, untimed, so that timed writes
+ * overwrite allocated blocks instead of measuring block allocation.
+ *
+ * Prints "iops <n> iops" and "throughput <MB/s> MB/s".
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#define NSEC_PER_SEC	1000000000LL
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / (double)NSEC_PER_SEC;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-w] [-r] [-c] [-p] [-b bs] [-s size_mb] [-t secs] path\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int wr = 0, rnd = 0, cached = 0, prealloc = 0, secs = 5, flags, fd, opt;
+	unsigned long long size = 0, bs = 4096, nr_blocks, off, done = 0;
+	double start, elapsed;
+	struct stat st;
+	void *buf;
+	ssize_t ret;
+
+	while ((opt = getopt(argc, argv, "wrcpb:s:t:")) != -1) {
+		switch (opt) {
+		case 'w':
+			wr = 1;
+			break;
+		case 'r':
+			rnd = 1;
+			break;
+		case 'c':
+			cached = 1;
+			break;
+		case 'p':
+			prealloc = 1;
+			break;
+		case 'b':
+			bs = strtoull(optarg, NULL, 0);
+			break;
+		case 's':
+			size = strtoull(optarg, NULL, 0) << 20;
+			break;
+		case 't':
+			secs = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || !bs || bs % 512 || (prealloc && !wr))
+		usage(argv[0]);
+
+	flags = wr ? O_RDWR | O_CREAT : O_RDONLY;
+	if (!cached)
+		flags |= O_DIRECT;
+	fd = open(argv[optind], flags, 0644);
+	if (fd < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (fstat(fd, &st)) {
+		perror("fstat");
+		return 1;
+	}
+	if (S_ISBLK(st.st_mode)) {
+		unsigned long long dev_size;
+
+		if (ioctl(fd, BLKGETSIZE64, &dev_size)) {
+			perror("BLKGETSIZE64");
+			return 1;
+		}
+		if (!size || size > dev_size)
+			size = dev_size;
+	} else if (!size) {
+		size = st.st_size;
+	}
+	nr_blocks = size / bs;
+	if (!nr_blocks) {
+		fprintf(stderr, "%s: smaller than one block, use -s\n",
+			argv[optind]);
+		return 1;
+	}
+
+	if (posix_memalign(&buf, 4096, bs)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	memset(buf, 0x5a, bs);
+
+	if (cached && !wr)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	srand48(getpid());
+
+	for (off = 0; prealloc && off < nr_blocks * bs; off += bs) {
+		if (pwrite(fd, buf, bs, off) != bs) {
+			perror("pwrite");
+			return 1;
+		}
+	}
+	if (prealloc && fsync(fd)) {
+		perror("fsync");
+		return 1;
+	}
+
+	start = now();
+	do {
+		if (rnd)
+			off = (lrand48() % nr_blocks) * bs;
+		else
+			off = done * bs;
+
+		if (wr)
+			ret = pwrite(fd, buf, bs, off);
+		else
+			ret = pread(fd, buf, bs, off);
+		if (ret != bs) {
+			perror(wr ? "pwrite" : "pread");
+			return 1;
+		}
+		done++;
+	} while (rnd ? now() - start < secs : done < nr_blocks);
+	if (wr && fsync(fd)) {
+		perror("fsync");
+		return 1;
+	}
+	elapsed = now() - start;
+	close(fd);
+
+	printf("iops %.0f iops\n", done / elapsed);
+	printf("throughput %.2f MB/s\n", done * bs / elapsed / (1 << 20));
+	return 0;
+}
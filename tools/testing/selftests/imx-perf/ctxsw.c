@@ -0,0 +1,86 @@
+/*
+ * Context switch cost: two processes pinned to one CPU bounce a byte
+ * over a pair of pipes, so that every transfer is a switch.
+ *
+ * Prints "ctxsw <usecs per switch> us".
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define NSEC_PER_SEC	1000000000LL
+
+static void pin(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set)) {
+		perror("sched_setaffinity");
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	long loops = argc > 1 ? atol(argv[1]) : 100000;
+	int ping[2], pong[2];
+	struct timespec start, end;
+	long long ns;
+	pid_t child;
+	char c = 0;
+	long i;
+
+	if (pipe(ping) || pipe(pong)) {
+		perror("pipe");
+		return 1;
+	}
+
+	pin(0);
+	child = fork();
+	if (child < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (!child) {
+		while (read(ping[0], &c, 1) == 1)
+			if (write(pong[1], &c, 1) != 1)
+				break;
+		_exit(0);
+	}
+
+	/* let the child settle before timing */
+	for (i = 0; i < 1000; i++)
+		if (write(ping[1], &c, 1) != 1 || read(pong[0], &c, 1) != 1)
+			goto err;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < loops; i++)
+		if (write(ping[1], &c, 1) != 1 || read(pong[0], &c, 1) != 1)
+			goto err;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	kill(child, SIGKILL);
+	waitpid(child, NULL, 0);
+
+	ns = (end.tv_sec - start.tv_sec) * NSEC_PER_SEC +
+	     end.tv_nsec - start.tv_nsec;
+	/* two switches per round trip */
+	printf("ctxsw %.2f us\n", ns / 1000.0 / (2 * loops));
+	return 0;
+err:
+	perror("pipe transfer");
+	kill(child, SIGKILL);
+	return 1;
+}
@@ -0,0 +1,146 @@
+/*
+ * PxP blit rate through /dev/pxp_device.
+ *
+ *   pxp_fps [-w width] [-h height] [-r rotation] [-n frames]
+ *
+ * Converts a width x height YUYV frame to RGB565 of the same size,
+ * rotated by rotation degrees, frames times back to back.
+ *
+ * Prints "fps <frames/s> fps" and "pixel_rate <Mpixels/s> Mpix/s".
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/pxp_device.h>
+
+#define NSEC_PER_SEC	1000000000LL
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / (double)NSEC_PER_SEC;
+}
+
+static int get_buf(int fd, struct pxp_mem_desc *mem, unsigned int size)
+{
+	memset(mem, 0, sizeof(*mem));
+	mem->size = size;
+	mem->mtype = MEMORY_TYPE_UNCACHED;
+	if (ioctl(fd, PXP_IOC_GET_PHYMEM, mem)) {
+		perror("PXP_IOC_GET_PHYMEM");
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int width = 1024, height = 768, rotate = 0, frames = 300, fd, opt, i;
+	struct pxp_chan_handle chan = { 0 };
+	struct pxp_mem_desc src, dst;
+	struct pxp_config_data conf;
+	struct pxp_proc_data *proc = &conf.proc_data;
+	double start, elapsed;
+	int ret = 1;
+
+	while ((opt = getopt(argc, argv, "w:h:r:n:")) != -1) {
+		switch (opt) {
+		case 'w':
+			width = atoi(optarg);
+			break;
+		case 'h':
+			height = atoi(optarg);
+			break;
+		case 'r':
+			rotate = atoi(optarg);
+			break;
+		case 'n':
+			frames = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-w width] [-h height] "
+				"[-r rotation] [-n frames]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (width <= 0 || height <= 0 || frames <= 0)
+		return 1;
+
+	fd = open("/dev/pxp_device", O_RDWR);
+	if (fd < 0) {
+		perror("/dev/pxp_device");
+		return 1;
+	}
+	if (ioctl(fd, PXP_IOC_GET_CHAN, &chan.handle)) {
+		perror("PXP_IOC_GET_CHAN");
+		goto out_close;
+	}
+	if (get_buf(fd, &src, width * height * 2))
+		goto out_chan;
+	if (get_buf(fd, &dst, width * height * 2))
+		goto out_src;
+
+	memset(&conf, 0, sizeof(conf));
+	conf.s0_param.pixel_fmt = PXP_PIX_FMT_YUYV;
+	conf.s0_param.width = width;
+	conf.s0_param.height = height;
+	conf.s0_param.stride = width;
+	conf.s0_param.paddr = src.phys_addr;
+
+	conf.out_param.pixel_fmt = PXP_PIX_FMT_RGB565;
+	conf.out_param.width = rotate % 180 ? height : width;
+	conf.out_param.height = rotate % 180 ? width : height;
+	conf.out_param.stride = conf.out_param.width;
+	conf.out_param.paddr = dst.phys_addr;
+
+	proc->srect.width = width;
+	proc->srect.height = height;
+	proc->drect.width = conf.out_param.width;
+	proc->drect.height = conf.out_param.height;
+	proc->rotate = rotate;
+	conf.layer_nr = 2;
+	conf.handle = chan.handle;
+
+	start = now();
+	for (i = 0; i < frames; i++) {
+		if (ioctl(fd, PXP_IOC_CONFIG_CHAN, &conf)) {
+			perror("PXP_IOC_CONFIG_CHAN");
+			goto out_dst;
+		}
+		if (ioctl(fd, PXP_IOC_START_CHAN, &chan.handle)) {
+			perror("PXP_IOC_START_CHAN");
+			goto out_dst;
+		}
+		if (ioctl(fd, PXP_IOC_WAIT4CMPLT, &chan)) {
+			perror("PXP_IOC_WAIT4CMPLT");
+			goto out_dst;
+		}
+	}
+	elapsed = now() - start;
+
+	printf("fps %.1f fps\n", frames / elapsed);
+	printf("pixel_rate %.1f Mpix/s\n",
+	       (double)width * height * frames / elapsed / 1e6);
+	ret = 0;
+
+out_dst:
+	ioctl(fd, PXP_IOC_PUT_PHYMEM, &dst);
+out_src:
+	ioctl(fd, PXP_IOC_PUT_PHYMEM, &src);
+out_chan:
+	ioctl(fd, PXP_IOC_PUT_CHAN, &chan.handle);
+out_close:
+	close(fd);
+	return ret;
+}
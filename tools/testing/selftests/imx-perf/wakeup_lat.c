@@ -0,0 +1,66 @@
+/*
+ * Interrupt to task latency: a SCHED_FIFO thread sleeps to absolute
+ * timer deadlines and measures how late it is woken, which covers the
+ * timer interrupt, any interrupt or preempt-off section in its way and
+ * the switch to the thread, like cyclictest does.
+ *
+ * Prints the minimum, average and maximum in "wakeup_lat_<x> <usecs> us"
+ * lines.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define NSEC_PER_SEC	1000000000LL
+
+static long long ts_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	long loops = argc > 1 ? atol(argv[1]) : 10000;
+	long interval = argc > 2 ? atol(argv[2]) : 1000;	/* usecs */
+	struct sched_param param = { .sched_priority = 99 };
+	long long next, now, lat, min = -1, max = 0, sum = 0;
+	struct timespec ts;
+	long i;
+
+	if (sched_setscheduler(0, SCHED_FIFO, &param)) {
+		perror("sched_setscheduler");
+		return 1;
+	}
+	if (mlockall(MCL_CURRENT | MCL_FUTURE))
+		perror("mlockall");
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	next = ts_ns(&ts);
+	for (i = 0; i < loops; i++) {
+		next += interval * 1000;
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		now = ts_ns(&ts);
+
+		lat = now - next;
+		if (min < 0 || lat < min)
+			min = lat;
+		if (lat > max)
+			max = lat;
+		sum += lat;
+	}
+
+	printf("wakeup_lat_min %.1f us\n", min / 1000.0);
+	printf("wakeup_lat_avg %.1f us\n", sum / 1000.0 / loops);
+	printf("wakeup_lat_max %.1f us\n", max / 1000.0);
+	return 0;
+}